@@ -1364,6 +1364,30 @@ static int confdb_get_domain_internal(struct confdb_ctx *cdb,
         goto done;
     }
 
+    ret = get_entry_as_uint32(res->msgs[0], &domain->cached_acct_timeout,
+                              CONFDB_DOMAIN_CACHED_ACCT_TIMEOUT, 0);
+    if (ret != EOK) {
+        DEBUG(SSSDBG_FATAL_FAILURE,
+              "Invalid value for [%s]\n", CONFDB_DOMAIN_CACHED_ACCT_TIMEOUT);
+        goto done;
+    }
+
+    /* Only decisions of access providers which depend on nothing but the
+     * group membership can be invalidated by the back end. Other providers
+     * check account expiration or lockout on the server, which is not
+     * noticed without contacting it. */
+    if (domain->cached_acct_timeout > 0) {
+        tmp = ldb_msg_find_attr_as_string(res->msgs[0],
+                                          CONFDB_DOMAIN_ACCESS_PROVIDER,
+                                          "permit");
+        if (strcasecmp(tmp, "permit") != 0 && strcasecmp(tmp, "simple") != 0) {
+            DEBUG(SSSDBG_MINOR_FAILURE,
+                  "[%s] is not supported with [%s] as an ACCESS provider, "
+                  "disabling it.\n", CONFDB_DOMAIN_CACHED_ACCT_TIMEOUT, tmp);
+            domain->cached_acct_timeout = 0;
+        }
+    }
+
     domain->has_views = false;
     domain->view_name = NULL;
 
@@ -303,6 +303,8 @@ class SSSDConfigTestSSSDService(unittest.TestCase):
             'debug_level',
             'debug_timestamps',
             'debug_microseconds',
+            'debug_buffered',
+            'debug_backtrace_level',
             'debug_to_files',
             'command',
             'reconnection_retries',
@@ -502,6 +504,8 @@ class SSSDConfigTestSSSDDomain(unittest.TestCase):
             'debug',
             'debug_level',
             'debug_timestamps',
+            'debug_buffered',
+            'debug_backtrace_level',
             'min_id',
             'max_id',
             'timeout',
@@ -525,10 +529,16 @@ class SSSDConfigTestSSSDDomain(unittest.TestCase):
             'entry_cache_sudo_timeout',
             'entry_cache_ssh_host_timeout',
             'refresh_expired_interval',
+            'dp_packed_transport',
+            'dp_request_limits',
             'lookup_family_order',
             'account_cache_expiration',
             'dns_resolver_timeout',
             'dns_discovery_domain',
+            'failover_probe_count',
+            'failover_probe_stagger',
+            'failover_probe_timeout',
+            'dns_cache_max_ttl',
             'dyndns_update',
             'dyndns_ttl',
             'dyndns_iface',
@@ -560,7 +570,8 @@ class SSSDConfigTestSSSDDomain(unittest.TestCase):
             'subdomain_inherit',
             'full_name_format',
             're_expression',
-            'cached_auth_timeout']
+            'cached_auth_timeout',
+            'cached_acct_timeout']
 
         self.assertTrue(type(options) == dict,
                         "Options should be a dictionary")
@@ -644,7 +655,9 @@ class SSSDConfigTestSSSDDomain(unittest.TestCase):
              'krb5_canonicalize',
              'krb5_use_enterprise_principal',
              'krb5_use_kdcinfo',
-             'krb5_map_user'])
+             'krb5_map_user',
+             'krb5_child_pool_size',
+             'krb5_child_pool_max_requests'])
 
         options = domain.list_options()
 
@@ -806,7 +819,9 @@ class SSSDConfigTestSSSDDomain(unittest.TestCase):
             'krb5_canonicalize',
             'krb5_use_enterprise_principal',
             'krb5_use_kdcinfo',
-            'krb5_map_user']
+            'krb5_map_user',
+            'krb5_child_pool_size',
+            'krb5_child_pool_max_requests']
 
         self.assertTrue(type(options) == dict,
                         "Options should be a dictionary")
@@ -870,6 +885,8 @@ class SSSDConfigTestSSSDDomain(unittest.TestCase):
             'debug',
             'debug_level',
             'debug_timestamps',
+            'debug_buffered',
+            'debug_backtrace_level',
             'min_id',
             'max_id',
             'timeout',
@@ -893,10 +910,16 @@ class SSSDConfigTestSSSDDomain(unittest.TestCase):
             'entry_cache_sudo_timeout',
             'entry_cache_ssh_host_timeout',
             'refresh_expired_interval',
+            'dp_packed_transport',
+            'dp_request_limits',
             'account_cache_expiration',
             'lookup_family_order',
             'dns_resolver_timeout',
             'dns_discovery_domain',
+            'failover_probe_count',
+            'failover_probe_stagger',
+            'failover_probe_timeout',
+            'dns_cache_max_ttl',
             'dyndns_update',
             'dyndns_ttl',
             'dyndns_iface',
@@ -928,7 +951,8 @@ class SSSDConfigTestSSSDDomain(unittest.TestCase):
             'subdomain_inherit',
             'full_name_format',
             're_expression',
-            'cached_auth_timeout']
+            'cached_auth_timeout',
+            'cached_acct_timeout']
 
         self.assertTrue(type(options) == dict,
                         "Options should be a dictionary")
@@ -1013,7 +1037,9 @@ class SSSDConfigTestSSSDDomain(unittest.TestCase):
              'krb5_canonicalize',
              'krb5_use_enterprise_principal',
              'krb5_use_kdcinfo',
-             'krb5_map_user'])
+             'krb5_map_user',
+             'krb5_child_pool_size',
+             'krb5_child_pool_max_requests'])
 
         options = domain.list_options()
 
@@ -27,7 +27,10 @@
 #include "db/sysdb_private.h"
 #include "confdb/confdb.h"
 #include "util/probes.h"
+#include "util/sss_trace.h"
+#include "util/sss_perf.h"
 #include <time.h>
+#include <tevent.h>
 
 errno_t sysdb_dn_sanitize(TALLOC_CTX *mem_ctx, const char *input,
                           char **sanitized)
@@ -881,6 +884,9 @@ int sysdb_transaction_start(struct sysdb_ctx *sysdb)
     ret = ldb_transaction_start(sysdb->ldb);
     if (ret == LDB_SUCCESS) {
         PROBE(SYSDB_TRANSACTION_START, sysdb->transaction_nesting);
+        if (sysdb->transaction_nesting == 0) {
+            sysdb->transaction_start = tevent_timeval_current();
+        }
         sysdb->transaction_nesting++;
     } else {
         DEBUG(SSSDBG_CRIT_FAILURE,
@@ -901,6 +907,11 @@ int sysdb_transaction_commit(struct sysdb_ctx *sysdb)
     if (ret == LDB_SUCCESS) {
         sysdb->transaction_nesting--;
         PROBE(SYSDB_TRANSACTION_COMMIT_AFTER, sysdb->transaction_nesting);
+        if (sysdb->transaction_nesting == 0) {
+            sss_trace_span(sss_trace_current(), SSS_TRACE_SYSDB_WRITE,
+                           &sysdb->transaction_start);
+            sss_perf_count(SSS_PERF_SYSDB_COMMIT);
+        }
     } else {
         DEBUG(SSSDBG_CRIT_FAILURE,
               "Failed to commit ldb transaction! (%d)\n", ret);
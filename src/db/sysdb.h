@@ -871,6 +871,19 @@ int sysdb_set_entry_attr(struct sysdb_ctx *sysdb,
                          struct sysdb_attrs *attrs,
                          int mod_op);
 
+/* Expires users or groups by setting their expiration timestamps (and the
+ * initgroups expiration if @initgr is true) in the timestamp cache only,
+ * all in one transaction. Entries that have no timestamp cache entry are
+ * left untouched and returned in @_missing. Returns ENOSYS if the domain
+ * has no timestamp cache. */
+errno_t sysdb_invalidate_ts_entries(TALLOC_CTX *mem_ctx,
+                                    struct sysdb_ctx *sysdb,
+                                    struct ldb_message **msgs,
+                                    size_t count,
+                                    bool initgr,
+                                    struct ldb_message ***_missing,
+                                    size_t *_num_missing);
+
 /* Replace user attrs */
 int sysdb_set_user_attr(struct sss_domain_info *domain,
                         const char *name,
@@ -1075,6 +1088,16 @@ int sysdb_search_users(TALLOC_CTX *mem_ctx,
                        size_t *msgs_count,
                        struct ldb_message ***msgs);
 
+/* Like sysdb_search_users() but stops the search after 'limit' entries,
+ * the entries beyond the limit are not loaded. 0 means no limit. */
+int sysdb_search_users_limit(TALLOC_CTX *mem_ctx,
+                             struct sss_domain_info *domain,
+                             const char *sub_filter,
+                             const char **attrs,
+                             size_t limit,
+                             size_t *msgs_count,
+                             struct ldb_message ***msgs);
+
 int sysdb_delete_user(struct sss_domain_info *domain,
                       const char *name, uid_t uid);
 
@@ -1085,6 +1108,16 @@ int sysdb_search_groups(TALLOC_CTX *mem_ctx,
                         size_t *msgs_count,
                         struct ldb_message ***msgs);
 
+/* Like sysdb_search_groups() but stops the search after 'limit' entries.
+ * 0 means no limit. */
+int sysdb_search_groups_limit(TALLOC_CTX *mem_ctx,
+                              struct sss_domain_info *domain,
+                              const char *sub_filter,
+                              const char **attrs,
+                              size_t limit,
+                              size_t *msgs_count,
+                              struct ldb_message ***msgs);
+
 int sysdb_delete_group(struct sss_domain_info *domain,
                        const char *name, gid_t gid);
 
@@ -254,6 +254,132 @@ done:
     return ret;
 }
 
+/* Collects at most 'limit' entries and stops the search afterwards, so
+ * that the entries beyond the limit are never loaded. */
+struct sysdb_limit_search_ctx {
+    struct ldb_result *res;
+    size_t limit;
+    bool truncated;
+};
+
+static int sysdb_limit_search_callback(struct ldb_request *req,
+                                       struct ldb_reply *ares)
+{
+    struct sysdb_limit_search_ctx *ctx;
+    struct ldb_result *res;
+
+    ctx = talloc_get_type(req->context, struct sysdb_limit_search_ctx);
+    res = ctx->res;
+
+    if (ares == NULL) {
+        return ldb_request_done(req, LDB_ERR_OPERATIONS_ERROR);
+    }
+    if (ares->error != LDB_SUCCESS) {
+        return ldb_request_done(req, ares->error);
+    }
+
+    switch (ares->type) {
+    case LDB_REPLY_ENTRY:
+        if (res->count >= ctx->limit) {
+            /* Makes the back end stop the search */
+            ctx->truncated = true;
+            talloc_free(ares);
+            return LDB_ERR_SIZE_LIMIT_EXCEEDED;
+        }
+
+        res->msgs = talloc_realloc(res, res->msgs, struct ldb_message *,
+                                   res->count + 2);
+        if (res->msgs == NULL) {
+            talloc_free(ares);
+            return ldb_request_done(req, LDB_ERR_OPERATIONS_ERROR);
+        }
+
+        res->msgs[res->count] = talloc_steal(res->msgs, ares->message);
+        res->count++;
+        res->msgs[res->count] = NULL;
+        break;
+    case LDB_REPLY_REFERRAL:
+        /* Not expected in the cache, ignore */
+        break;
+    case LDB_REPLY_DONE:
+        talloc_free(ares);
+        return ldb_request_done(req, LDB_SUCCESS);
+    }
+
+    talloc_free(ares);
+    return LDB_SUCCESS;
+}
+
+static int sysdb_cache_search_entry_limit(TALLOC_CTX *mem_ctx,
+                                          struct ldb_context *ldb,
+                                          struct ldb_dn *base_dn,
+                                          enum ldb_scope scope,
+                                          const char *filter,
+                                          const char **attrs,
+                                          size_t limit,
+                                          size_t *_msgs_count,
+                                          struct ldb_message ***_msgs)
+{
+    TALLOC_CTX *tmp_ctx;
+    struct sysdb_limit_search_ctx *ctx;
+    struct ldb_request *req;
+    int ret;
+
+    if (limit == 0) {
+        return sysdb_cache_search_entry(mem_ctx, ldb, base_dn, scope, filter,
+                                        attrs, _msgs_count, _msgs);
+    }
+
+    tmp_ctx = talloc_new(NULL);
+    if (tmp_ctx == NULL) {
+        return ENOMEM;
+    }
+
+    ctx = talloc_zero(tmp_ctx, struct sysdb_limit_search_ctx);
+    if (ctx == NULL) {
+        ret = ENOMEM;
+        goto done;
+    }
+    ctx->limit = limit;
+
+    ctx->res = talloc_zero(ctx, struct ldb_result);
+    if (ctx->res == NULL) {
+        ret = ENOMEM;
+        goto done;
+    }
+
+    ret = ldb_build_search_req(&req, ldb, tmp_ctx, base_dn, scope, filter,
+                               attrs, NULL, ctx, sysdb_limit_search_callback,
+                               NULL);
+    if (ret != LDB_SUCCESS) {
+        ret = sysdb_error_to_errno(ret);
+        goto done;
+    }
+
+    ret = ldb_request(ldb, req);
+    if (ret == LDB_SUCCESS) {
+        ret = ldb_wait(req->handle, LDB_WAIT_ALL);
+    }
+    if (ret != LDB_SUCCESS && !ctx->truncated) {
+        ret = sysdb_error_to_errno(ret);
+        goto done;
+    }
+
+    if (ctx->truncated) {
+        DEBUG(SSSDBG_TRACE_FUNC,
+              "Search stopped after %zu entries\n", ctx->res->count);
+    }
+
+    *_msgs_count = ctx->res->count;
+    *_msgs = talloc_steal(mem_ctx, ctx->res->msgs);
+
+    ret = ctx->res->count == 0 ? ENOENT : EOK;
+
+done:
+    talloc_free(tmp_ctx);
+    return ret;
+}
+
 int sysdb_search_entry(TALLOC_CTX *mem_ctx,
                        struct sysdb_ctx *sysdb,
                        struct ldb_dn *base_dn,
@@ -1260,6 +1386,123 @@ done:
     return ret;
 }
 
+/* =Invalidate-Entries-In-Timestamp-Cache================================ */
+
+errno_t sysdb_invalidate_ts_entries(TALLOC_CTX *mem_ctx,
+                                    struct sysdb_ctx *sysdb,
+                                    struct ldb_message **msgs,
+                                    size_t count,
+                                    bool initgr,
+                                    struct ldb_message ***_missing,
+                                    size_t *_num_missing)
+{
+    TALLOC_CTX *tmp_ctx;
+    struct sysdb_attrs *attrs;
+    struct ldb_message *msg;
+    struct ldb_message **missing;
+    size_t num_missing = 0;
+    bool in_transaction = false;
+    size_t i;
+    errno_t ret;
+    int lret;
+
+    if (sysdb->ldb_ts == NULL) {
+        return ENOSYS;
+    }
+
+    tmp_ctx = talloc_new(NULL);
+    if (tmp_ctx == NULL) {
+        return ENOMEM;
+    }
+
+    missing = talloc_array(tmp_ctx, struct ldb_message *, count + 1);
+    attrs = sysdb_new_attrs(tmp_ctx);
+    if (missing == NULL || attrs == NULL) {
+        ret = ENOMEM;
+        goto done;
+    }
+
+    ret = sysdb_attrs_add_time_t(attrs, SYSDB_CACHE_EXPIRE, 1);
+    if (ret != EOK) {
+        goto done;
+    }
+
+    if (initgr) {
+        ret = sysdb_attrs_add_time_t(attrs, SYSDB_INITGR_EXPIRE, 1);
+        if (ret != EOK) {
+            goto done;
+        }
+    }
+
+    /* One transaction for all entries instead of one for each modify */
+    lret = ldb_transaction_start(sysdb->ldb_ts);
+    if (lret != LDB_SUCCESS) {
+        DEBUG(SSSDBG_CRIT_FAILURE, "Failed to start ldb transaction on the "
+              "timestamp cache! (%d)\n", lret);
+        ret = sysdb_error_to_errno(lret);
+        goto done;
+    }
+    in_transaction = true;
+
+    for (i = 0; i < count; i++) {
+        if (!is_ts_ldb_dn(msgs[i]->dn)) {
+            missing[num_missing] = msgs[i];
+            num_missing++;
+            continue;
+        }
+
+        msg = sysdb_attrs2msg(tmp_ctx, msgs[i]->dn, attrs, SYSDB_MOD_REP);
+        if (msg == NULL) {
+            ret = ENOMEM;
+            goto done;
+        }
+
+        lret = ldb_modify(sysdb->ldb_ts, msg);
+        talloc_free(msg);
+        if (lret == LDB_ERR_NO_SUCH_OBJECT) {
+            /* Entry stored before the timestamp cache was introduced */
+            missing[num_missing] = msgs[i];
+            num_missing++;
+        } else if (lret != LDB_SUCCESS) {
+            DEBUG(SSSDBG_OP_FAILURE,
+                  "ldb_modify of [%s] failed: [%s](%d)[%s]\n",
+                  ldb_dn_get_linearized(msgs[i]->dn), ldb_strerror(lret),
+                  lret, ldb_errstring(sysdb->ldb_ts));
+            ret = sysdb_error_to_errno(lret);
+            goto done;
+        }
+    }
+
+    lret = ldb_transaction_commit(sysdb->ldb_ts);
+    if (lret != LDB_SUCCESS) {
+        DEBUG(SSSDBG_CRIT_FAILURE, "Failed to commit ldb transaction on the "
+              "timestamp cache! (%d)\n", lret);
+        ret = sysdb_error_to_errno(lret);
+        goto done;
+    }
+    in_transaction = false;
+
+    DEBUG(SSSDBG_TRACE_FUNC, "Invalidated [%zu] entries in the timestamp "
+          "cache, [%zu] have to be invalidated in the main cache.\n",
+          count - num_missing, num_missing);
+
+    missing[num_missing] = NULL;
+    *_missing = talloc_steal(mem_ctx, missing);
+    *_num_missing = num_missing;
+
+    ret = EOK;
+
+done:
+    if (in_transaction) {
+        lret = ldb_transaction_cancel(sysdb->ldb_ts);
+        if (lret != LDB_SUCCESS) {
+            DEBUG(SSSDBG_CRIT_FAILURE, "Could not cancel transaction\n");
+        }
+    }
+    talloc_free(tmp_ctx);
+    return ret;
+}
+
 /* =Replace-Attributes-On-User============================================ */
 
 int sysdb_set_user_attr(struct sss_domain_info *domain,
@@ -3370,6 +3613,7 @@ static int sysdb_cache_search_users(TALLOC_CTX *mem_ctx,
                                     struct ldb_context *ldb,
                                     const char *sub_filter,
                                     const char **attrs,
+                                    size_t limit,
                                     size_t *msgs_count,
                                     struct ldb_message ***msgs)
 {
@@ -3400,9 +3644,9 @@ static int sysdb_cache_search_users(TALLOC_CTX *mem_ctx,
     DEBUG(SSSDBG_TRACE_INTERNAL,
           "Search users with filter: %s\n", filter);
 
-    ret = sysdb_cache_search_entry(mem_ctx, ldb, basedn,
-                                   LDB_SCOPE_SUBTREE, filter, attrs,
-                                   msgs_count, msgs);
+    ret = sysdb_cache_search_entry_limit(mem_ctx, ldb, basedn,
+                                         LDB_SCOPE_SUBTREE, filter, attrs,
+                                         limit, msgs_count, msgs);
     if (ret) {
         goto fail;
     }
@@ -3427,11 +3671,23 @@ int sysdb_search_users(TALLOC_CTX *mem_ctx,
                        const char **attrs,
                        size_t *msgs_count,
                        struct ldb_message ***msgs)
+{
+    return sysdb_search_users_limit(mem_ctx, domain, sub_filter, attrs, 0,
+                                    msgs_count, msgs);
+}
+
+int sysdb_search_users_limit(TALLOC_CTX *mem_ctx,
+                             struct sss_domain_info *domain,
+                             const char *sub_filter,
+                             const char **attrs,
+                             size_t limit,
+                             size_t *msgs_count,
+                             struct ldb_message ***msgs)
 {
     errno_t ret;
 
     ret = sysdb_cache_search_users(mem_ctx, domain, domain->sysdb->ldb,
-                                   sub_filter, attrs, msgs_count, msgs);
+                                   sub_filter, attrs, limit, msgs_count, msgs);
     if (ret != EOK) {
         return ret;
     }
@@ -3461,7 +3717,7 @@ int sysdb_search_ts_users(TALLOC_CTX *mem_ctx,
     }
 
     ret = sysdb_cache_search_users(mem_ctx, domain, domain->sysdb->ldb_ts,
-                                    sub_filter, attrs, &msgs_count, &msgs);
+                                    sub_filter, attrs, 0, &msgs_count, &msgs);
     if (ret == EOK) {
         res->count = (unsigned)msgs_count;
         res->msgs = msgs;
@@ -3587,6 +3843,7 @@ static int sysdb_cache_search_groups(TALLOC_CTX *mem_ctx,
                                      struct ldb_context *ldb,
                                      const char *sub_filter,
                                      const char **attrs,
+                                     size_t limit,
                                      size_t *msgs_count,
                                      struct ldb_message ***msgs)
 {
@@ -3617,9 +3874,9 @@ static int sysdb_cache_search_groups(TALLOC_CTX *mem_ctx,
     DEBUG(SSSDBG_TRACE_INTERNAL,
           "Search groups with filter: %s\n", filter);
 
-    ret = sysdb_cache_search_entry(mem_ctx, ldb, basedn,
-                                   LDB_SCOPE_SUBTREE, filter, attrs,
-                                   msgs_count, msgs);
+    ret = sysdb_cache_search_entry_limit(mem_ctx, ldb, basedn,
+                                         LDB_SCOPE_SUBTREE, filter, attrs,
+                                         limit, msgs_count, msgs);
     if (ret) {
         goto fail;
     }
@@ -3644,11 +3901,24 @@ int sysdb_search_groups(TALLOC_CTX *mem_ctx,
                         const char **attrs,
                         size_t *msgs_count,
                         struct ldb_message ***msgs)
+{
+    return sysdb_search_groups_limit(mem_ctx, domain, sub_filter, attrs, 0,
+                                     msgs_count, msgs);
+}
+
+int sysdb_search_groups_limit(TALLOC_CTX *mem_ctx,
+                              struct sss_domain_info *domain,
+                              const char *sub_filter,
+                              const char **attrs,
+                              size_t limit,
+                              size_t *msgs_count,
+                              struct ldb_message ***msgs)
 {
     errno_t ret;
 
     ret = sysdb_cache_search_groups(mem_ctx, domain, domain->sysdb->ldb,
-                                    sub_filter, attrs, msgs_count, msgs);
+                                    sub_filter, attrs, limit, msgs_count,
+                                    msgs);
     if (ret != EOK) {
         return ret;
     }
@@ -3678,7 +3948,7 @@ int sysdb_search_ts_groups(TALLOC_CTX *mem_ctx,
     }
 
     ret = sysdb_cache_search_groups(mem_ctx, domain, domain->sysdb->ldb_ts,
-                                    sub_filter, attrs, &msgs_count, &msgs);
+                                    sub_filter, attrs, 0, &msgs_count, &msgs);
     if (ret == EOK) {
         res->count = (unsigned)msgs_count;
         res->msgs = msgs;
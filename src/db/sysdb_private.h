@@ -115,6 +115,8 @@ struct sysdb_ctx {
     char *ldb_ts_file;
 
     int transaction_nesting;
+    /* start of the outermost transaction */
+    struct timeval transaction_start;
 };
 
 /* Internal utility functions */
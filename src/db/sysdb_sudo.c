@@ -480,9 +480,9 @@ done:
     return ret;
 }
 
-static errno_t sysdb_sudo_set_refresh_time(struct sss_domain_info *domain,
-                                           const char *attr_name,
-                                           time_t value)
+static errno_t sysdb_sudo_set_container_value(struct sss_domain_info *domain,
+                                              const char *attr_name,
+                                              long long value)
 {
     TALLOC_CTX *tmp_ctx;
     struct ldb_dn *dn;
@@ -538,7 +538,7 @@ static errno_t sysdb_sudo_set_refresh_time(struct sss_domain_info *domain,
         }
     }
 
-    lret = ldb_msg_add_fmt(msg, attr_name, "%lld", (long long)value);
+    lret = ldb_msg_add_fmt(msg, attr_name, "%lld", value);
     if (lret != LDB_SUCCESS) {
         ret = sysdb_error_to_errno(lret);
         goto done;
@@ -562,9 +562,9 @@ done:
     return ret;
 }
 
-static errno_t sysdb_sudo_get_refresh_time(struct sss_domain_info *domain,
-                                           const char *attr_name,
-                                           time_t *value)
+static errno_t sysdb_sudo_get_container_value(struct sss_domain_info *domain,
+                                              const char *attr_name,
+                                              long long *value)
 {
     TALLOC_CTX *tmp_ctx;
     struct ldb_dn *dn;
@@ -608,7 +608,7 @@ static errno_t sysdb_sudo_get_refresh_time(struct sss_domain_info *domain,
         goto done;
     }
 
-    *value = ldb_msg_find_attr_as_int(res->msgs[0], attr_name, 0);
+    *value = ldb_msg_find_attr_as_int64(res->msgs[0], attr_name, 0);
 
     ret = EOK;
 
@@ -620,15 +620,73 @@ done:
 errno_t sysdb_sudo_set_last_full_refresh(struct sss_domain_info *domain,
                                          time_t value)
 {
-    return sysdb_sudo_set_refresh_time(domain,
-                                       SYSDB_SUDO_AT_LAST_FULL_REFRESH, value);
+    return sysdb_sudo_set_container_value(domain,
+                                          SYSDB_SUDO_AT_LAST_FULL_REFRESH,
+                                          value);
 }
 
 errno_t sysdb_sudo_get_last_full_refresh(struct sss_domain_info *domain,
                                          time_t *value)
 {
-    return sysdb_sudo_get_refresh_time(domain,
-                                       SYSDB_SUDO_AT_LAST_FULL_REFRESH, value);
+    long long refresh;
+    errno_t ret;
+
+    ret = sysdb_sudo_get_container_value(domain,
+                                         SYSDB_SUDO_AT_LAST_FULL_REFRESH,
+                                         &refresh);
+    if (ret != EOK) {
+        return ret;
+    }
+
+    *value = refresh;
+    return EOK;
+}
+
+errno_t sysdb_sudo_get_generation(struct sss_domain_info *domain,
+                                  uint32_t *_generation,
+                                  uint32_t *_purge_generation)
+{
+    long long value;
+    errno_t ret;
+
+    ret = sysdb_sudo_get_container_value(domain, SYSDB_SUDO_AT_GENERATION,
+                                         &value);
+    if (ret != EOK) {
+        return ret;
+    }
+    *_generation = value;
+
+    if (_purge_generation != NULL) {
+        ret = sysdb_sudo_get_container_value(domain,
+                                             SYSDB_SUDO_AT_PURGE_GENERATION,
+                                             &value);
+        if (ret != EOK) {
+            return ret;
+        }
+        *_purge_generation = value;
+    }
+
+    return EOK;
+}
+
+/* Must be called inside a transaction, after the rules were changed. The
+ * generation must be read before the changes because purging all rules
+ * removes the container. */
+static errno_t sysdb_sudo_set_generation(struct sss_domain_info *domain,
+                                         uint32_t generation,
+                                         bool purged)
+{
+    errno_t ret;
+
+    ret = sysdb_sudo_set_container_value(domain, SYSDB_SUDO_AT_GENERATION,
+                                         generation);
+    if (ret != EOK || !purged) {
+        return ret;
+    }
+
+    return sysdb_sudo_set_container_value(domain,
+                                          SYSDB_SUDO_AT_PURGE_GENERATION,
+                                          generation);
 }
 
 /* ====================  Purge functions ==================== */
@@ -775,6 +833,7 @@ errno_t sysdb_sudo_purge(struct sss_domain_info *domain,
                          size_t num_rules)
 {
     bool in_transaction = false;
+    uint32_t generation;
     errno_t sret;
     errno_t ret;
 
@@ -785,6 +844,11 @@ errno_t sysdb_sudo_purge(struct sss_domain_info *domain,
     }
     in_transaction = true;
 
+    ret = sysdb_sudo_get_generation(domain, &generation, NULL);
+    if (ret != EOK) {
+        goto done;
+    }
+
     if (delete_filter) {
         ret = sysdb_sudo_purge_byfilter(domain, delete_filter);
     } else {
@@ -795,6 +859,11 @@ errno_t sysdb_sudo_purge(struct sss_domain_info *domain,
         goto done;
     }
 
+    ret = sysdb_sudo_set_generation(domain, generation + 1, true);
+    if (ret != EOK) {
+        goto done;
+    }
+
     ret = sysdb_transaction_commit(domain->sysdb);
     if (ret != EOK) {
         DEBUG(SSSDBG_CRIT_FAILURE, "Failed to commit transaction\n");
@@ -822,7 +891,8 @@ static errno_t
 sysdb_sudo_add_sss_attrs(struct sysdb_attrs *rule,
                          const char *name,
                          int cache_timeout,
-                         time_t now)
+                         time_t now,
+                         uint32_t generation)
 {
     time_t expire;
     errno_t ret;
@@ -849,6 +919,14 @@ sysdb_sudo_add_sss_attrs(struct sysdb_attrs *rule,
         return ret;
     }
 
+    ret = sysdb_attrs_add_uint32(rule, SYSDB_SUDO_CACHE_AT_GENERATION,
+                                 generation);
+    if (ret != EOK) {
+        DEBUG(SSSDBG_OP_FAILURE, "Unable to add %s attribute [%d]: %s\n",
+              SYSDB_SUDO_CACHE_AT_GENERATION, ret, strerror(ret));
+        return ret;
+    }
+
     return EOK;
 }
 
@@ -856,7 +934,8 @@ static errno_t
 sysdb_sudo_store_rule(struct sss_domain_info *domain,
                       struct sysdb_attrs *rule,
                       int cache_timeout,
-                      time_t now)
+                      time_t now,
+                      uint32_t generation)
 {
     const char *name;
     errno_t ret;
@@ -868,7 +947,8 @@ sysdb_sudo_store_rule(struct sss_domain_info *domain,
 
     DEBUG(SSSDBG_TRACE_FUNC, "Adding sudo rule %s\n", name);
 
-    ret = sysdb_sudo_add_sss_attrs(rule, name, cache_timeout, now);
+    ret = sysdb_sudo_add_sss_attrs(rule, name, cache_timeout, now,
+                                   generation);
     if (ret != EOK) {
         return ret;
     }
@@ -889,6 +969,7 @@ sysdb_sudo_store(struct sss_domain_info *domain,
                  size_t num_rules)
 {
     bool in_transaction = false;
+    uint32_t generation;
     errno_t sret;
     errno_t ret;
     time_t now;
@@ -905,10 +986,16 @@ sysdb_sudo_store(struct sss_domain_info *domain,
     }
     in_transaction = true;
 
+    ret = sysdb_sudo_get_generation(domain, &generation, NULL);
+    if (ret != EOK) {
+        goto done;
+    }
+    generation++;
+
     now = time(NULL);
     for (i = 0; i < num_rules; i++) {
         ret = sysdb_sudo_store_rule(domain, rules[i],
-                                    domain->sudo_timeout, now);
+                                    domain->sudo_timeout, now, generation);
         if (ret == EINVAL) {
             /* Multiple CNs are error on server side, we can just ignore this
              * rule and save the others. Loud debug message is in logs. */
@@ -918,6 +1005,11 @@ sysdb_sudo_store(struct sss_domain_info *domain,
         }
     }
 
+    ret = sysdb_sudo_set_generation(domain, generation, false);
+    if (ret != EOK) {
+        goto done;
+    }
+
     ret = sysdb_transaction_commit(domain->sysdb);
     if (ret != EOK) {
         DEBUG(SSSDBG_CRIT_FAILURE, "Failed to commit transaction\n");
@@ -1020,7 +1112,11 @@ sysdb_set_sudo_rule_attr(struct sss_domain_info *domain,
                          int mod_op)
 {
     errno_t ret;
+    errno_t sret;
     struct ldb_dn *dn;
+    struct sysdb_attrs *gen_attrs;
+    uint32_t generation;
+    bool in_transaction = false;
     TALLOC_CTX *tmp_ctx;
 
     tmp_ctx = talloc_new(NULL);
@@ -1031,9 +1127,58 @@ sysdb_set_sudo_rule_attr(struct sss_domain_info *domain,
     dn = sysdb_sudo_rule_dn(tmp_ctx, domain, name);
     NULL_CHECK(dn, ret, done);
 
+    gen_attrs = sysdb_new_attrs(tmp_ctx);
+    NULL_CHECK(gen_attrs, ret, done);
+
+    ret = sysdb_transaction_start(domain->sysdb);
+    if (ret != EOK) {
+        DEBUG(SSSDBG_CRIT_FAILURE, "Failed to start transaction\n");
+        goto done;
+    }
+    in_transaction = true;
+
     ret = sysdb_set_entry_attr(domain->sysdb, dn, attrs, mod_op);
+    if (ret != EOK) {
+        goto done;
+    }
+
+    /* Let the responders know that the rule has changed */
+    ret = sysdb_sudo_get_generation(domain, &generation, NULL);
+    if (ret != EOK) {
+        goto done;
+    }
+    generation++;
+
+    ret = sysdb_attrs_add_uint32(gen_attrs, SYSDB_SUDO_CACHE_AT_GENERATION,
+                                 generation);
+    if (ret != EOK) {
+        goto done;
+    }
+
+    ret = sysdb_set_entry_attr(domain->sysdb, dn, gen_attrs, SYSDB_MOD_REP);
+    if (ret != EOK) {
+        goto done;
+    }
+
+    ret = sysdb_sudo_set_generation(domain, generation, false);
+    if (ret != EOK) {
+        goto done;
+    }
+
+    ret = sysdb_transaction_commit(domain->sysdb);
+    if (ret != EOK) {
+        DEBUG(SSSDBG_CRIT_FAILURE, "Failed to commit transaction\n");
+        goto done;
+    }
+    in_transaction = false;
 
 done:
+    if (in_transaction) {
+        sret = sysdb_transaction_cancel(domain->sysdb);
+        if (sret != EOK) {
+            DEBUG(SSSDBG_OP_FAILURE, "Could not cancel transaction\n");
+        }
+    }
     talloc_free(tmp_ctx);
     return ret;
 }
@@ -32,6 +32,12 @@
 #define SYSDB_SUDO_AT_REFRESHED      "refreshed"
 #define SYSDB_SUDO_AT_LAST_FULL_REFRESH "sudoLastFullRefreshTime"
 
+/* attributes of SUDORULE_SUBDIR
+ * incremented whenever cached rules are stored, modified or purged, the
+ * purge generation is the generation of the last purge */
+#define SYSDB_SUDO_AT_GENERATION        "sudoCacheGeneration"
+#define SYSDB_SUDO_AT_PURGE_GENERATION  "sudoCachePurgeGeneration"
+
 /* sysdb attributes */
 #define SYSDB_SUDO_CACHE_OC            "sudoRule"
 #define SYSDB_SUDO_CACHE_AT_CN         "cn"
@@ -45,6 +51,8 @@
 #define SYSDB_SUDO_CACHE_AT_NOTBEFORE  "sudoNotBefore"
 #define SYSDB_SUDO_CACHE_AT_NOTAFTER   "sudoNotAfter"
 #define SYSDB_SUDO_CACHE_AT_ORDER      "sudoOrder"
+/* generation of SUDORULE_SUBDIR in which the rule was last changed */
+#define SYSDB_SUDO_CACHE_AT_GENERATION "sudoCacheGeneration"
 
 /* sysdb ipa attributes */
 #define SYSDB_IPA_SUDORULE_OC                 "ipasudorule"
@@ -133,6 +141,10 @@ errno_t sysdb_sudo_set_last_full_refresh(struct sss_domain_info *domain,
 errno_t sysdb_sudo_get_last_full_refresh(struct sss_domain_info *domain,
                                          time_t *value);
 
+errno_t sysdb_sudo_get_generation(struct sss_domain_info *domain,
+                                  uint32_t *_generation,
+                                  uint32_t *_purge_generation);
+
 errno_t sysdb_sudo_purge(struct sss_domain_info *domain,
                          const char *delete_filter,
                          struct sysdb_attrs **rules,
@@ -142,71 +142,93 @@ enum hbac_eval_result_int hbac_evaluate_rule(struct hbac_rule *rule,
                                              struct hbac_eval_req *hbac_req,
                                              enum hbac_error_code *error);
 
+static bool hbac_info_new(struct hbac_info **info)
+{
+    if (info) {
+        *info = malloc(sizeof(struct hbac_info));
+        if (!*info) {
+            HBAC_DEBUG(HBAC_DBG_ERROR, "Out of memory.\n");
+            return false;
+        }
+        (*info)->code = HBAC_ERROR_UNKNOWN;
+        (*info)->rule_name = NULL;
+    }
+
+    return true;
+}
+
+/* Evaluates a single rule. Returns true if the evaluation is finished,
+ * either because the rule allowed access or because of an error.
+ */
+static bool hbac_evaluate_one(struct hbac_rule *rule,
+                              struct hbac_eval_req *hbac_req,
+                              struct hbac_info **info,
+                              enum hbac_eval_result *result)
+{
+    enum hbac_error_code ret;
+    enum hbac_eval_result_int intermediate_result;
+
+    hbac_rule_debug_print(rule);
+    intermediate_result = hbac_evaluate_rule(rule, hbac_req, &ret);
+    if (intermediate_result == HBAC_EVAL_UNMATCHED) {
+        /* This rule did not match at all. Skip it */
+        HBAC_DEBUG(HBAC_DBG_INFO, "The rule [%s] did not match.\n",
+                   rule->name);
+        return false;
+    } else if (intermediate_result == HBAC_EVAL_MATCHED) {
+        HBAC_DEBUG(HBAC_DBG_INFO, "ALLOWED by rule [%s].\n", rule->name);
+        *result = HBAC_EVAL_ALLOW;
+        if (info) {
+            (*info)->code = HBAC_SUCCESS;
+            (*info)->rule_name = strdup(rule->name);
+            if (!(*info)->rule_name) {
+                HBAC_DEBUG(HBAC_DBG_ERROR, "Out of memory.\n");
+                *result = HBAC_EVAL_ERROR;
+                (*info)->code = HBAC_ERROR_OUT_OF_MEMORY;
+            }
+        }
+        return true;
+    }
+
+    /* An error occurred processing this rule */
+    HBAC_DEBUG(HBAC_DBG_ERROR,
+               "Error %d occurred during evaluating of rule [%s].\n",
+               ret, rule->name);
+    *result = HBAC_EVAL_ERROR;
+    if (info) {
+        (*info)->code = ret;
+        (*info)->rule_name = strdup(rule->name);
+    }
+    /* Explicitly not checking the result of strdup(), since if
+     * it's NULL, we can't do anything anyway.
+     */
+    return true;
+}
+
 enum hbac_eval_result hbac_evaluate(struct hbac_rule **rules,
                                     struct hbac_eval_req *hbac_req,
                                     struct hbac_info **info)
 {
     uint32_t i;
 
-    enum hbac_error_code ret;
     enum hbac_eval_result result = HBAC_EVAL_DENY;
-    enum hbac_eval_result_int intermediate_result;
 
     HBAC_DEBUG(HBAC_DBG_INFO, "[< hbac_evaluate()\n");
     hbac_req_debug_print(hbac_req);
 
-    if (info) {
-        *info = malloc(sizeof(struct hbac_info));
-        if (!*info) {
-            HBAC_DEBUG(HBAC_DBG_ERROR, "Out of memory.\n");
-            return HBAC_EVAL_OOM;
-        }
-        (*info)->code = HBAC_ERROR_UNKNOWN;
-        (*info)->rule_name = NULL;
+    if (!hbac_info_new(info)) {
+        return HBAC_EVAL_OOM;
     }
 
     for (i = 0; rules[i]; i++) {
-        hbac_rule_debug_print(rules[i]);
-        intermediate_result = hbac_evaluate_rule(rules[i], hbac_req, &ret);
-        if (intermediate_result == HBAC_EVAL_UNMATCHED) {
-            /* This rule did not match at all. Skip it */
-            HBAC_DEBUG(HBAC_DBG_INFO, "The rule [%s] did not match.\n",
-                       rules[i]->name);
-            continue;
-        } else if (intermediate_result == HBAC_EVAL_MATCHED) {
-            HBAC_DEBUG(HBAC_DBG_INFO, "ALLOWED by rule [%s].\n", rules[i]->name);
-            result = HBAC_EVAL_ALLOW;
-            if (info) {
-                (*info)->code = HBAC_SUCCESS;
-                (*info)->rule_name = strdup(rules[i]->name);
-                if (!(*info)->rule_name) {
-                    HBAC_DEBUG(HBAC_DBG_ERROR, "Out of memory.\n");
-                    result = HBAC_EVAL_ERROR;
-                    (*info)->code = HBAC_ERROR_OUT_OF_MEMORY;
-                }
-            }
+        if (hbac_evaluate_one(rules[i], hbac_req, info, &result)) {
             break;
-        } else {
-            /* An error occurred processing this rule */
-            HBAC_DEBUG(HBAC_DBG_ERROR,
-                       "Error %d occurred during evaluating of rule [%s].\n",
-                       ret, rules[i]->name);
-            result = HBAC_EVAL_ERROR;
-            if (info) {
-                (*info)->code = ret;
-                (*info)->rule_name = strdup(rules[i]->name);
-            }
-            /* Explicitly not checking the result of strdup(), since if
-             * it's NULL, we can't do anything anyway.
-             */
-            goto done;
         }
     }
 
     /* If we've reached the end of the loop, we have either set the
      * result to ALLOW explicitly or we'll stick with the default DENY.
      */
-done:
 
     HBAC_DEBUG(HBAC_DBG_INFO, "hbac_evaluate() >]\n");
     return result;
@@ -356,6 +378,623 @@ static errno_t hbac_evaluate_element(struct hbac_rule_element *rule_el,
     return EOK;
 }
 
+/* Compiled rule sets
+ *
+ * Every element of the rules (users, services, target and source hosts) is
+ * indexed by name and by group in a hash table. Evaluating a request looks
+ * up the request names and groups in the index of the most selective element
+ * and runs the regular rule evaluation only on the rules found there, in
+ * their original order.
+ *
+ * The index is case-insensitive for ASCII names only. Rules with non-ASCII
+ * names as well as rules with a category of ALL are stored in a list of
+ * rules that are always evaluated; a request with a non-ASCII name falls
+ * back to evaluating all rules for that element.
+ *
+ * Comparing a name that is not valid UTF-8 fails, which the evaluation
+ * reports as an error as soon as it reaches the element, whichever element
+ * was looked up. Rules with such a name are therefore always evaluated for
+ * every element and requests with such a name do not use the index.
+ */
+
+enum hbac_element_type {
+    HBAC_ELEMENT_USERS,
+    HBAC_ELEMENT_SERVICES,
+    HBAC_ELEMENT_TARGETHOSTS,
+    HBAC_ELEMENT_SRCHOSTS,
+
+    HBAC_ELEMENT_SENTINEL
+};
+
+struct hbac_index_list {
+    size_t *rules;
+    size_t num_rules;
+    size_t max_rules;
+};
+
+struct hbac_index_entry {
+    char *key;
+    struct hbac_index_list list;
+    struct hbac_index_entry *next;
+};
+
+struct hbac_index_map {
+    struct hbac_index_entry **buckets;
+    size_t num_buckets;
+};
+
+struct hbac_element_index {
+    struct hbac_index_map names;
+    struct hbac_index_map groups;
+    struct hbac_index_list always;
+};
+
+struct hbac_compiled_rules {
+    struct hbac_rule **rules;
+    size_t num_rules;
+    struct hbac_element_index index[HBAC_ELEMENT_SENTINEL];
+};
+
+static char hbac_ascii_tolower(char c)
+{
+    if (c >= 'A' && c <= 'Z') {
+        return c - 'A' + 'a';
+    }
+    return c;
+}
+
+static bool hbac_is_ascii(const char *str)
+{
+    const unsigned char *p;
+
+    for (p = (const unsigned char *) str; *p != '\0'; p++) {
+        if (*p > 0x7f) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+/* FNV-1a over the lowercased string */
+static uint32_t hbac_index_hash(const char *str)
+{
+    uint32_t hash = 2166136261U;
+
+    for (; *str != '\0'; str++) {
+        hash ^= (unsigned char) hbac_ascii_tolower(*str);
+        hash *= 16777619U;
+    }
+
+    return hash;
+}
+
+static bool hbac_index_key_eq(const char *key, const char *str)
+{
+    for (; *key != '\0' && *str != '\0'; key++, str++) {
+        if (*key != hbac_ascii_tolower(*str)) {
+            return false;
+        }
+    }
+
+    return *key == *str;
+}
+
+static errno_t hbac_index_list_add(struct hbac_index_list *list, size_t rule)
+{
+    size_t *rules;
+    size_t max_rules;
+
+    /* rules are added in order, a rule may list a name twice */
+    if (list->num_rules > 0 && list->rules[list->num_rules - 1] == rule) {
+        return EOK;
+    }
+
+    if (list->num_rules == list->max_rules) {
+        max_rules = list->max_rules == 0 ? 4 : list->max_rules * 2;
+        rules = realloc(list->rules, max_rules * sizeof(size_t));
+        if (rules == NULL) {
+            return ENOMEM;
+        }
+        list->rules = rules;
+        list->max_rules = max_rules;
+    }
+
+    list->rules[list->num_rules] = rule;
+    list->num_rules++;
+
+    return EOK;
+}
+
+static struct hbac_index_entry *
+hbac_index_map_lookup(struct hbac_index_map *map, const char *name)
+{
+    struct hbac_index_entry *entry;
+
+    if (map->num_buckets == 0) {
+        return NULL;
+    }
+
+    entry = map->buckets[hbac_index_hash(name) % map->num_buckets];
+    for (; entry != NULL; entry = entry->next) {
+        if (hbac_index_key_eq(entry->key, name)) {
+            return entry;
+        }
+    }
+
+    return NULL;
+}
+
+static errno_t hbac_index_map_add(struct hbac_index_map *map,
+                                  const char *name,
+                                  size_t rule)
+{
+    struct hbac_index_entry *entry;
+    size_t bucket;
+    size_t i;
+
+    entry = hbac_index_map_lookup(map, name);
+    if (entry == NULL) {
+        entry = calloc(1, sizeof(struct hbac_index_entry));
+        if (entry == NULL) {
+            return ENOMEM;
+        }
+
+        entry->key = strdup(name);
+        if (entry->key == NULL) {
+            free(entry);
+            return ENOMEM;
+        }
+
+        for (i = 0; entry->key[i] != '\0'; i++) {
+            entry->key[i] = hbac_ascii_tolower(entry->key[i]);
+        }
+
+        bucket = hbac_index_hash(name) % map->num_buckets;
+        entry->next = map->buckets[bucket];
+        map->buckets[bucket] = entry;
+    }
+
+    return hbac_index_list_add(&entry->list, rule);
+}
+
+static errno_t hbac_index_add_names(struct hbac_element_index *index,
+                                    struct hbac_index_map *map,
+                                    const char **names,
+                                    size_t rule)
+{
+    errno_t ret;
+    size_t i;
+
+    if (names == NULL) {
+        return EOK;
+    }
+
+    for (i = 0; names[i] != NULL; i++) {
+        if (hbac_is_ascii(names[i])) {
+            ret = hbac_index_map_add(map, names[i], rule);
+        } else {
+            ret = hbac_index_list_add(&index->always, rule);
+        }
+        if (ret != EOK) {
+            return ret;
+        }
+    }
+
+    return EOK;
+}
+
+static errno_t hbac_element_index_add(struct hbac_element_index *index,
+                                      struct hbac_rule_element *el,
+                                      bool always,
+                                      size_t rule)
+{
+    errno_t ret;
+
+    /* A rule the evaluation may report as an error whatever the request is
+     * must be a candidate in every dimension */
+    if (always || el->category & HBAC_CATEGORY_ALL) {
+        return hbac_index_list_add(&index->always, rule);
+    }
+
+    ret = hbac_index_add_names(index, &index->names, el->names, rule);
+    if (ret != EOK) {
+        return ret;
+    }
+
+    return hbac_index_add_names(index, &index->groups, el->groups, rule);
+}
+
+static void hbac_index_map_free(struct hbac_index_map *map)
+{
+    struct hbac_index_entry *entry;
+    struct hbac_index_entry *next;
+    size_t i;
+
+    for (i = 0; i < map->num_buckets; i++) {
+        for (entry = map->buckets[i]; entry != NULL; entry = next) {
+            next = entry->next;
+            free(entry->key);
+            free(entry->list.rules);
+            free(entry);
+        }
+    }
+
+    free(map->buckets);
+}
+
+void hbac_free_compiled_rules(struct hbac_compiled_rules *compiled)
+{
+    int i;
+
+    if (compiled == NULL) return;
+
+    for (i = 0; i < HBAC_ELEMENT_SENTINEL; i++) {
+        hbac_index_map_free(&compiled->index[i].names);
+        hbac_index_map_free(&compiled->index[i].groups);
+        free(compiled->index[i].always.rules);
+    }
+
+    free(compiled->rules);
+    free(compiled);
+}
+
+static struct hbac_rule_element *hbac_rule_get_element(struct hbac_rule *rule,
+                                                       int type)
+{
+    switch (type) {
+    case HBAC_ELEMENT_USERS:
+        return rule->users;
+    case HBAC_ELEMENT_SERVICES:
+        return rule->services;
+    case HBAC_ELEMENT_TARGETHOSTS:
+        return rule->targethosts;
+    case HBAC_ELEMENT_SRCHOSTS:
+        return rule->srchosts;
+    }
+
+    return NULL;
+}
+
+static struct hbac_request_element *
+hbac_req_get_element(struct hbac_eval_req *req, int type)
+{
+    switch (type) {
+    case HBAC_ELEMENT_USERS:
+        return req->user;
+    case HBAC_ELEMENT_SERVICES:
+        return req->service;
+    case HBAC_ELEMENT_TARGETHOSTS:
+        return req->targethost;
+    case HBAC_ELEMENT_SRCHOSTS:
+        return req->srchost;
+    }
+
+    return NULL;
+}
+
+static bool hbac_names_valid(const char **names)
+{
+    size_t i;
+
+    if (names == NULL) {
+        return true;
+    }
+
+    for (i = 0; names[i] != NULL; i++) {
+        if (!hbac_is_ascii(names[i])
+                && !sss_utf8_check((const uint8_t *) names[i],
+                                   strlen(names[i]))) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+static bool hbac_rule_names_valid(struct hbac_rule *rule)
+{
+    struct hbac_rule_element *el;
+    int j;
+
+    for (j = 0; j < HBAC_ELEMENT_SENTINEL; j++) {
+        el = hbac_rule_get_element(rule, j);
+        if (!hbac_names_valid(el->names) || !hbac_names_valid(el->groups)) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+static bool hbac_req_element_valid(struct hbac_request_element *req_el)
+{
+    if (req_el->name != NULL
+            && !hbac_is_ascii(req_el->name)
+            && !sss_utf8_check((const uint8_t *) req_el->name,
+                               strlen(req_el->name))) {
+        return false;
+    }
+
+    return hbac_names_valid(req_el->groups);
+}
+
+enum hbac_error_code hbac_compile_rules(struct hbac_rule **rules,
+                                        struct hbac_compiled_rules **_compiled)
+{
+    struct hbac_compiled_rules *compiled;
+    size_t num_rules;
+    size_t num_buckets;
+    size_t i;
+    int j;
+    bool always;
+    errno_t ret;
+
+    for (num_rules = 0; rules[num_rules] != NULL; num_rules++);
+
+    compiled = calloc(1, sizeof(struct hbac_compiled_rules));
+    if (compiled == NULL) {
+        return HBAC_ERROR_OUT_OF_MEMORY;
+    }
+
+    compiled->rules = malloc((num_rules + 1) * sizeof(struct hbac_rule *));
+    if (compiled->rules == NULL) {
+        ret = ENOMEM;
+        goto done;
+    }
+
+    num_buckets = num_rules < 32 ? 64 : num_rules * 2;
+    for (j = 0; j < HBAC_ELEMENT_SENTINEL; j++) {
+        compiled->index[j].names.buckets = calloc(num_buckets,
+                                                  sizeof(struct hbac_index_entry *));
+        compiled->index[j].groups.buckets = calloc(num_buckets,
+                                                   sizeof(struct hbac_index_entry *));
+        if (compiled->index[j].names.buckets == NULL
+                || compiled->index[j].groups.buckets == NULL) {
+            ret = ENOMEM;
+            goto done;
+        }
+        compiled->index[j].names.num_buckets = num_buckets;
+        compiled->index[j].groups.num_buckets = num_buckets;
+    }
+
+    for (i = 0; i < num_rules; i++) {
+        /* Disabled rules never match, there is no need to index them */
+        if (!rules[i]->enabled) {
+            continue;
+        }
+
+        /* Incomplete rules and rules with malformed names may be reported
+         * as errors whatever element is looked up */
+        always = (rules[i]->users == NULL || rules[i]->services == NULL
+                  || rules[i]->targethosts == NULL
+                  || rules[i]->srchosts == NULL);
+        if (!always && !hbac_rule_names_valid(rules[i])) {
+            HBAC_DEBUG(HBAC_DBG_INFO,
+                       "Rule [%s] has names that are not valid UTF-8\n",
+                       rules[i]->name);
+            always = true;
+        }
+
+        for (j = 0; j < HBAC_ELEMENT_SENTINEL; j++) {
+            ret = hbac_element_index_add(&compiled->index[j],
+                                         hbac_rule_get_element(rules[i], j),
+                                         always, compiled->num_rules);
+            if (ret != EOK) {
+                goto done;
+            }
+        }
+
+        compiled->rules[compiled->num_rules] = rules[i];
+        compiled->num_rules++;
+    }
+    compiled->rules[compiled->num_rules] = NULL;
+
+    HBAC_DEBUG(HBAC_DBG_TRACE, "Compiled %lu of %lu HBAC rules\n",
+               (unsigned long) compiled->num_rules, (unsigned long) num_rules);
+
+    ret = EOK;
+
+done:
+    if (ret != EOK) {
+        HBAC_DEBUG(HBAC_DBG_ERROR, "Out of memory.\n");
+        hbac_free_compiled_rules(compiled);
+        return HBAC_ERROR_OUT_OF_MEMORY;
+    }
+
+    *_compiled = compiled;
+    return HBAC_SUCCESS;
+}
+
+/* Returns false if the element cannot be looked up in the index */
+static bool hbac_element_lookup(struct hbac_element_index *index,
+                                struct hbac_request_element *req_el,
+                                struct hbac_index_list **lists,
+                                size_t *_num_lists,
+                                size_t *_num_rules)
+{
+    struct hbac_index_entry *entry;
+    size_t num_lists = 0;
+    size_t num_rules = 0;
+    size_t i;
+
+    lists[num_lists++] = &index->always;
+    num_rules += index->always.num_rules;
+
+    if (req_el->name != NULL) {
+        if (!hbac_is_ascii(req_el->name)) {
+            return false;
+        }
+
+        entry = hbac_index_map_lookup(&index->names, req_el->name);
+        if (entry != NULL) {
+            lists[num_lists++] = &entry->list;
+            num_rules += entry->list.num_rules;
+        }
+    }
+
+    for (i = 0; req_el->groups != NULL && req_el->groups[i] != NULL; i++) {
+        if (!hbac_is_ascii(req_el->groups[i])) {
+            return false;
+        }
+
+        entry = hbac_index_map_lookup(&index->groups, req_el->groups[i]);
+        if (entry != NULL) {
+            lists[num_lists++] = &entry->list;
+            num_rules += entry->list.num_rules;
+        }
+    }
+
+    *_num_lists = num_lists;
+    *_num_rules = num_rules;
+    return true;
+}
+
+static size_t hbac_req_element_num_lists(struct hbac_request_element *req_el)
+{
+    size_t num = 2;
+    size_t i;
+
+    for (i = 0; req_el->groups != NULL && req_el->groups[i] != NULL; i++) {
+        num++;
+    }
+
+    return num;
+}
+
+static int hbac_rule_index_cmp(const void *a, const void *b)
+{
+    size_t ia = *(const size_t *) a;
+    size_t ib = *(const size_t *) b;
+
+    if (ia < ib) return -1;
+    if (ia > ib) return 1;
+    return 0;
+}
+
+enum hbac_eval_result hbac_evaluate_compiled(struct hbac_compiled_rules *compiled,
+                                             struct hbac_eval_req *hbac_req,
+                                             struct hbac_info **info)
+{
+    enum hbac_eval_result result = HBAC_EVAL_DENY;
+    struct hbac_index_list **lists = NULL;
+    struct hbac_index_list **best_lists = NULL;
+    struct hbac_index_list **tmp;
+    size_t num_lists;
+    size_t num_best_lists = 0;
+    size_t max_lists = 0;
+    size_t num_rules;
+    size_t best_rules = (size_t) -1;
+    size_t *candidates = NULL;
+    size_t num_candidates = 0;
+    size_t i;
+    size_t k;
+    int j;
+
+    HBAC_DEBUG(HBAC_DBG_INFO, "[< hbac_evaluate_compiled()\n");
+    hbac_req_debug_print(hbac_req);
+
+    if (!hbac_info_new(info)) {
+        return HBAC_EVAL_OOM;
+    }
+
+    for (j = 0; j < HBAC_ELEMENT_SENTINEL; j++) {
+        if (hbac_req_get_element(hbac_req, j) == NULL
+                || !hbac_req_element_valid(hbac_req_get_element(hbac_req, j))) {
+            /* Let the evaluator handle the incomplete or malformed request */
+            break;
+        }
+
+        num_lists = hbac_req_element_num_lists(hbac_req_get_element(hbac_req, j));
+        if (num_lists > max_lists) {
+            max_lists = num_lists;
+        }
+    }
+
+    if (j == HBAC_ELEMENT_SENTINEL) {
+        lists = malloc(max_lists * sizeof(struct hbac_index_list *));
+        best_lists = malloc(max_lists * sizeof(struct hbac_index_list *));
+        if (lists == NULL || best_lists == NULL) {
+            goto oom;
+        }
+
+        /* Pick the element whose index yields the fewest candidates */
+        for (j = 0; j < HBAC_ELEMENT_SENTINEL; j++) {
+            if (!hbac_element_lookup(&compiled->index[j],
+                                     hbac_req_get_element(hbac_req, j),
+                                     lists, &num_lists, &num_rules)) {
+                continue;
+            }
+
+            if (num_rules < best_rules) {
+                best_rules = num_rules;
+                num_best_lists = num_lists;
+                tmp = best_lists;
+                best_lists = lists;
+                lists = tmp;
+            }
+        }
+    }
+
+    if (best_rules == (size_t) -1) {
+        /* No usable index, evaluate all rules */
+        for (i = 0; i < compiled->num_rules; i++) {
+            if (hbac_evaluate_one(compiled->rules[i], hbac_req, info, &result)) {
+                break;
+            }
+        }
+        goto done;
+    }
+
+    HBAC_DEBUG(HBAC_DBG_TRACE, "Evaluating %lu of %lu HBAC rules\n",
+               (unsigned long) best_rules, (unsigned long) compiled->num_rules);
+
+    if (best_rules > 0) {
+        candidates = malloc(best_rules * sizeof(size_t));
+        if (candidates == NULL) {
+            goto oom;
+        }
+
+        for (i = 0; i < num_best_lists; i++) {
+            for (k = 0; k < best_lists[i]->num_rules; k++) {
+                candidates[num_candidates++] = best_lists[i]->rules[k];
+            }
+        }
+
+        /* Keep the order of the rules so that the same rule is reported */
+        qsort(candidates, num_candidates, sizeof(size_t), hbac_rule_index_cmp);
+    }
+
+    for (i = 0; i < num_candidates; i++) {
+        if (i > 0 && candidates[i] == candidates[i - 1]) {
+            continue;
+        }
+
+        if (hbac_evaluate_one(compiled->rules[candidates[i]], hbac_req,
+                              info, &result)) {
+            break;
+        }
+    }
+
+done:
+    free(candidates);
+    free(lists);
+    free(best_lists);
+    HBAC_DEBUG(HBAC_DBG_INFO, "hbac_evaluate_compiled() >]\n");
+    return result;
+
+oom:
+    HBAC_DEBUG(HBAC_DBG_ERROR, "Out of memory.\n");
+    free(candidates);
+    free(lists);
+    free(best_lists);
+    if (info) {
+        hbac_free_info(*info);
+        *info = NULL;
+    }
+    return HBAC_EVAL_OOM;
+}
+
 const char *hbac_result_string(enum hbac_eval_result result)
 {
     switch (result) {
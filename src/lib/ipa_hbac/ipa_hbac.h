@@ -309,6 +309,56 @@ const char *hbac_error_string(enum hbac_error_code code);
  */
 void hbac_free_info(struct hbac_info *info);
 
+/**
+ * Opaque type contained in hbac_evaluator.c
+ */
+struct hbac_compiled_rules;
+
+/**
+ * @brief Compile a set of HBAC rules for repeated evaluation
+ *
+ * The rules are indexed by the names and groups of their users, services,
+ * target hosts and source hosts, so that #hbac_evaluate_compiled only needs
+ * to evaluate the rules that may apply to a request.
+ *
+ * @param[in] rules      A NULL-terminated list of rules to compile. The
+ *                       rules are not copied and must not be modified or
+ *                       freed before the compiled rule set is freed.
+ * @param[out] compiled  The compiled rule set, to be freed with
+ *                       #hbac_free_compiled_rules
+ * @return
+ *  - #HBAC_SUCCESS:              The rules were compiled
+ *  - #HBAC_ERROR_OUT_OF_MEMORY:  Insufficient memory to compile the rules
+ */
+enum hbac_error_code hbac_compile_rules(struct hbac_rule **rules,
+                                        struct hbac_compiled_rules **compiled);
+
+/**
+ * @brief Evaluate an authorization request against a compiled rule set
+ *
+ * The result is the same as that of #hbac_evaluate on the rules the set
+ * was compiled from.
+ *
+ * @param[in] compiled A rule set compiled by #hbac_compile_rules
+ * @param[in] hbac_req A user authorization request
+ * @param[out] info    Extended information (including the name of the
+ *                     rule that allowed access (or caused a parse error)
+ * @return
+ *  - #HBAC_EVAL_ERROR: An error occurred
+ *  - #HBAC_EVAL_ALLOW: Access is granted
+ *  - #HBAC_EVAL_DENY:  Access is denied
+ *  - #HBAC_EVAL_OOM:   Insufficient memory to complete the evaluation
+ */
+enum hbac_eval_result hbac_evaluate_compiled(struct hbac_compiled_rules *compiled,
+                                             struct hbac_eval_req *hbac_req,
+                                             struct hbac_info **info);
+
+/**
+ * @brief Function to free a rule set returned by #hbac_compile_rules
+ * @param compiled #hbac_compiled_rules returned by #hbac_compile_rules
+ */
+void hbac_free_compiled_rules(struct hbac_compiled_rules *compiled);
+
 /** User element */
 #define HBAC_RULE_ELEMENT_USERS       0x01
 
@@ -50,6 +50,8 @@
 #include "sbus/sssd_dbus.h"
 #include "monitor/monitor_interfaces.h"
 #include "responder/common/responder_sbus.h"
+#include "sbus/sssd_dbus_errors.h"
+#include "util/sss_perf.h"
 
 #ifdef USE_KEYRING
 #include <keyutils.h>
@@ -297,13 +299,79 @@ static int client_registration(struct sbus_request *dbus_req, void *data)
                                    DBUS_TYPE_UINT16, &version,
                                    DBUS_TYPE_INVALID);
 
+    /* The init context is kept with the connection since it is the
+     * private data of the other monitor methods. */
+    return EOK;
+
 done:
-    /* init complete, get rid of temp init context */
+    /* init failed, get rid of temp init context */
     talloc_zfree(mini);
 
     return EOK;
 }
 
+static void get_perf_stats_done(DBusPendingCall *pending, void *ptr)
+{
+    struct sbus_request *dbus_req;
+
+    dbus_req = talloc_get_type(ptr, struct sbus_request);
+
+    sbus_request_forward_reply(dbus_req, pending);
+}
+
+/* An empty name selects the monitor itself. */
+static int get_perf_stats(struct sbus_request *dbus_req,
+                          void *data,
+                          const char *arg_name)
+{
+    struct mon_init_conn *mini;
+    struct mt_svc *svc;
+    DBusMessage *msg;
+    char *stats;
+    int ret;
+
+    mini = talloc_get_type(data, struct mon_init_conn);
+    if (mini == NULL) {
+        DEBUG(SSSDBG_FATAL_FAILURE, "Connection holds no valid init data\n");
+        return EINVAL;
+    }
+
+    if (arg_name[0] == '\0') {
+        ret = sss_perf_report(dbus_req, &stats);
+        if (ret != EOK) {
+            return ret;
+        }
+
+        return mon_srv_iface_getPerfStats_finish(dbus_req, stats);
+    }
+
+    for (svc = mini->ctx->svc_list; svc != NULL; svc = svc->next) {
+        if (strcasecmp(svc->name, arg_name) == 0) {
+            break;
+        }
+    }
+
+    if (svc == NULL || svc->conn == NULL) {
+        sbus_request_reply_error(dbus_req, SBUS_ERROR_NOT_FOUND,
+                                 "Service %s is not running", arg_name);
+        return EOK;
+    }
+
+    msg = dbus_message_new_method_call(NULL,
+                                       MONITOR_PATH,
+                                       MON_CLI_IFACE,
+                                       MON_CLI_IFACE_PERFSTATS);
+    if (msg == NULL) {
+        return ENOMEM;
+    }
+
+    ret = sbus_conn_send(svc->conn, msg, mini->ctx->service_id_timeout,
+                         get_perf_stats_done, dbus_req, NULL);
+    dbus_message_unref(msg);
+
+    return ret;
+}
+
 struct svc_spy {
     struct mt_svc *svc;
 };
@@ -511,6 +579,7 @@ struct mon_srv_iface monitor_methods = {
     { &mon_srv_iface_meta, 0 },
     .getVersion = get_monitor_version,
     .RegisterService = client_registration,
+    .getPerfStats = get_perf_stats,
 };
 
 /* monitor_dbus_init
@@ -6,6 +6,28 @@
 #include "sbus/sssd_dbus_invokers.h"
 #include "monitor_iface_generated.h"
 
+/* invokes a handler with a 's' DBus signature */
+static int invoke_s_method(struct sbus_request *dbus_req, void *function_ptr);
+
+/* arguments for org.freedesktop.sssd.monitor.getPerfStats */
+const struct sbus_arg_meta mon_srv_iface_getPerfStats__in[] = {
+    { "name", "s" },
+    { NULL, }
+};
+
+/* arguments for org.freedesktop.sssd.monitor.getPerfStats */
+const struct sbus_arg_meta mon_srv_iface_getPerfStats__out[] = {
+    { "stats", "s" },
+    { NULL, }
+};
+
+int mon_srv_iface_getPerfStats_finish(struct sbus_request *req, const char *arg_stats)
+{
+   return sbus_request_return_and_finish(req,
+                                         DBUS_TYPE_STRING, &arg_stats,
+                                         DBUS_TYPE_INVALID);
+}
+
 /* methods for org.freedesktop.sssd.monitor */
 const struct sbus_method_meta mon_srv_iface__methods[] = {
     {
@@ -22,6 +44,13 @@ const struct sbus_method_meta mon_srv_iface__methods[] = {
         offsetof(struct mon_srv_iface, RegisterService),
         NULL, /* no invoker */
     },
+    {
+        "getPerfStats", /* name */
+        mon_srv_iface_getPerfStats__in,
+        mon_srv_iface_getPerfStats__out,
+        offsetof(struct mon_srv_iface, getPerfStats),
+        invoke_s_method,
+    },
     { NULL, }
 };
 
@@ -34,6 +63,19 @@ const struct sbus_interface_meta mon_srv_iface_meta = {
     sbus_invoke_get_all, /* GetAll invoker */
 };
 
+/* arguments for org.freedesktop.sssd.service.perfStats */
+const struct sbus_arg_meta mon_cli_iface_perfStats__out[] = {
+    { "stats", "s" },
+    { NULL, }
+};
+
+int mon_cli_iface_perfStats_finish(struct sbus_request *req, const char *arg_stats)
+{
+   return sbus_request_return_and_finish(req,
+                                         DBUS_TYPE_STRING, &arg_stats,
+                                         DBUS_TYPE_INVALID);
+}
+
 /* methods for org.freedesktop.sssd.service */
 const struct sbus_method_meta mon_cli_iface__methods[] = {
     {
@@ -99,6 +141,13 @@ const struct sbus_method_meta mon_cli_iface__methods[] = {
         offsetof(struct mon_cli_iface, sysbusReconnect),
         NULL, /* no invoker */
     },
+    {
+        "perfStats", /* name */
+        NULL, /* no in_args */
+        mon_cli_iface_perfStats__out,
+        offsetof(struct mon_cli_iface, perfStats),
+        NULL, /* no invoker */
+    },
     { NULL, }
 };
 
@@ -110,3 +159,19 @@ const struct sbus_interface_meta mon_cli_iface_meta = {
     NULL, /* no properties */
     sbus_invoke_get_all, /* GetAll invoker */
 };
+
+/* invokes a handler with a 's' DBus signature */
+static int invoke_s_method(struct sbus_request *dbus_req, void *function_ptr)
+{
+    const char * arg_0;
+    int (*handler)(struct sbus_request *, void *, const char *) = function_ptr;
+
+    if (!sbus_request_parse_or_finish(dbus_req,
+                               DBUS_TYPE_STRING, &arg_0,
+                               DBUS_TYPE_INVALID)) {
+         return EOK; /* request handled */
+    }
+
+    return (handler)(dbus_req, dbus_req->intf->handler_data,
+                     arg_0);
+}
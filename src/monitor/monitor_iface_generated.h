@@ -15,6 +15,7 @@
 #define MON_SRV_IFACE "org.freedesktop.sssd.monitor"
 #define MON_SRV_IFACE_GETVERSION "getVersion"
 #define MON_SRV_IFACE_REGISTERSERVICE "RegisterService"
+#define MON_SRV_IFACE_GETPERFSTATS "getPerfStats"
 
 /* constants for org.freedesktop.sssd.service */
 #define MON_CLI_IFACE "org.freedesktop.sssd.service"
@@ -27,6 +28,7 @@
 #define MON_CLI_IFACE_CLEARMEMCACHE "clearMemcache"
 #define MON_CLI_IFACE_CLEARENUMCACHE "clearEnumCache"
 #define MON_CLI_IFACE_SYSBUSRECONNECT "sysbusReconnect"
+#define MON_CLI_IFACE_PERFSTATS "perfStats"
 
 /* ------------------------------------------------------------------------
  * DBus handlers
@@ -51,8 +53,12 @@ struct mon_srv_iface {
     struct sbus_vtable vtable; /* derive from sbus_vtable */
     sbus_msg_handler_fn getVersion;
     sbus_msg_handler_fn RegisterService;
+    int (*getPerfStats)(struct sbus_request *req, void *data, const char *arg_name);
 };
 
+/* finish function for getPerfStats */
+int mon_srv_iface_getPerfStats_finish(struct sbus_request *req, const char *arg_stats);
+
 /* vtable for org.freedesktop.sssd.service */
 struct mon_cli_iface {
     struct sbus_vtable vtable; /* derive from sbus_vtable */
@@ -65,8 +71,12 @@ struct mon_cli_iface {
     sbus_msg_handler_fn clearMemcache;
     sbus_msg_handler_fn clearEnumCache;
     sbus_msg_handler_fn sysbusReconnect;
+    int (*perfStats)(struct sbus_request *req, void *data);
 };
 
+/* finish function for perfStats */
+int mon_cli_iface_perfStats_finish(struct sbus_request *req, const char *arg_stats);
+
 /* ------------------------------------------------------------------------
  * DBus Interface Metadata
  *
@@ -48,7 +48,8 @@
 enum op_mode {
     OP_NONE,
     OP_AUTH,
-    OP_PREAUTH
+    OP_PREAUTH,
+    OP_VERIFICATION
 };
 
 enum pin_mode {
@@ -69,10 +70,66 @@ static char *password_passthrough(PK11SlotInfo *slot, PRBool retry, void *arg)
 
 
 
+/* The responder passes the SHA-256 digests of the certificates it has seen
+ * validated recently, see the cache_timeout verification option. */
+static bool cert_verified_recently(CERTCertificate *cert, char **verified)
+{
+    unsigned char digest[SSS_SHA256_LENGTH];
+    char hex[SSS_SHA256_LENGTH * 2 + 1];
+    SECStatus rv;
+    size_t c;
+
+    if (verified == NULL) {
+        return false;
+    }
+
+    rv = PK11_HashBuf(SEC_OID_SHA256, digest, cert->derCert.data,
+                      cert->derCert.len);
+    if (rv != SECSuccess) {
+        DEBUG(SSSDBG_OP_FAILURE, "PK11_HashBuf failed [%d].\n",
+                                 PR_GetError());
+        return false;
+    }
+
+    for (c = 0; c < SSS_SHA256_LENGTH; c++) {
+        snprintf(&hex[c * 2], 3, "%02x", digest[c]);
+    }
+
+    return string_in_list(hex, verified, false);
+}
+
+/* Validates a certificate on behalf of a responder so that network lookups,
+ * e.g. OCSP, do not block it, see sss_cert_cache. */
+static errno_t do_verification(TALLOC_CTX *mem_ctx, const char *nss_db,
+                               struct cert_verify_opts *cert_verify_opts,
+                               const char *cert_b64, time_t *_valid_until)
+{
+    unsigned char *der;
+    size_t der_size;
+    errno_t ret;
+
+    der = sss_base64_decode(mem_ctx, cert_b64, &der_size);
+    if (der == NULL) {
+        DEBUG(SSSDBG_OP_FAILURE, "sss_base64_decode failed.\n");
+        return EINVAL;
+    }
+
+    ret = cert_to_ssh_key_ex(mem_ctx, nss_db, der, der_size, cert_verify_opts,
+                             NULL, NULL, _valid_until);
+    talloc_free(der);
+    if (ret != EOK) {
+        DEBUG(SSSDBG_OP_FAILURE, "Certificate is not valid [%d]: %s\n",
+                                 ret, sss_strerror(ret));
+        return ret;
+    }
+
+    return EOK;
+}
+
 int do_work(TALLOC_CTX *mem_ctx, const char *nss_db, const char *slot_name_in,
             enum op_mode mode, const char *pin,
             struct cert_verify_opts *cert_verify_opts,
-            char **cert, char **token_name_out)
+            char **verified, char **cert, char **token_name_out)
 {
     int ret;
     SECStatus rv;
@@ -304,7 +361,14 @@ int do_work(TALLOC_CTX *mem_ctx, const char *nss_db, const char *slot_name_in,
                              cert_list_node->cert->nickname,
                              cert_list_node->cert->subjectName);
 
-            if (cert_verify_opts->do_verification) {
+            if (cert_verify_opts->do_verification
+                    && cert_verified_recently(cert_list_node->cert,
+                                              verified)) {
+                DEBUG(SSSDBG_TRACE_ALL,
+                      "Certificate [%s][%s] was validated recently.\n",
+                      cert_list_node->cert->nickname,
+                      cert_list_node->cert->subjectName);
+            } else if (cert_verify_opts->do_verification) {
                 rv = CERT_VerifyCertificateNow(handle, cert_list_node->cert,
                                                PR_TRUE,
                                                certificateUsageSSLClient,
@@ -489,6 +553,53 @@ static errno_t p11c_recv_data(TALLOC_CTX *mem_ctx, int fd, char **pin)
     return EOK;
 }
 
+/* Options a worker passes to do_work() for every request */
+struct p11c_worker_ctx {
+    const char *nss_db;
+    const char *slot_name_in;
+    enum op_mode mode;
+    struct cert_verify_opts *cert_verify_opts;
+    char **verified_list;
+};
+
+/* Workers only serve pre-auth requests which carry no data, the reply is
+ * what a helper started for the request would print to stdout. */
+static errno_t p11c_worker_handler(TALLOC_CTX *mem_ctx,
+                                   uint8_t *req_buf, uint32_t req_len,
+                                   uint8_t **_reply, uint32_t *_reply_len,
+                                   void *pvt)
+{
+    struct p11c_worker_ctx *wctx = talloc_get_type(pvt,
+                                                   struct p11c_worker_ctx);
+    char *cert = NULL;
+    char *token_name_out = NULL;
+    char *reply;
+    errno_t ret;
+
+    ret = do_work(mem_ctx, wctx->nss_db, wctx->slot_name_in, wctx->mode,
+                  NULL, wctx->cert_verify_opts, wctx->verified_list,
+                  &cert, &token_name_out);
+    if (ret != EOK) {
+        DEBUG(SSSDBG_OP_FAILURE, "do_work failed.\n");
+        return ret;
+    }
+
+    if (cert == NULL) {
+        *_reply = NULL;
+        *_reply_len = 0;
+        return EOK;
+    }
+
+    reply = talloc_asprintf(mem_ctx, "%s\n%s\n", token_name_out, cert);
+    if (reply == NULL) {
+        return ENOMEM;
+    }
+
+    *_reply = (uint8_t *) reply;
+    *_reply_len = strlen(reply);
+    return EOK;
+}
+
 int main(int argc, const char *argv[])
 {
     int opt;
@@ -505,6 +616,12 @@ int main(int argc, const char *argv[])
     char *nss_db = NULL;
     struct cert_verify_opts *cert_verify_opts;
     char *verify_opts = NULL;
+    char *verified = NULL;
+    char **verified_list = NULL;
+    char *cert_b64 = NULL;
+    time_t valid_until;
+    struct p11c_worker_ctx *wctx;
+    int worker = 0;
 
     struct poptOption long_options[] = {
         POPT_AUTOHELP
@@ -521,6 +638,10 @@ int main(int argc, const char *argv[])
          _("Send the debug output to stderr directly."), NULL },
         {"auth", 0, POPT_ARG_NONE, NULL, 'a', _("Run in auth mode"), NULL},
         {"pre", 0, POPT_ARG_NONE, NULL, 'p', _("Run in pre-auth mode"), NULL},
+        {"verification", 0, POPT_ARG_NONE, NULL, 'v',
+         _("Run in verification mode"), NULL},
+        {"certificate", 0, POPT_ARG_STRING, &cert_b64, 0,
+         _("Base64 encoded certificate to validate"), NULL},
         {"pin", 0, POPT_ARG_NONE, NULL, 'i', _("Expect PIN on stdin"), NULL},
         {"keypad", 0, POPT_ARG_NONE, NULL, 'k', _("Expect PIN on keypad"),
          NULL},
@@ -528,6 +649,10 @@ int main(int argc, const char *argv[])
          NULL},
         {"nssdb", 0, POPT_ARG_STRING, &nss_db, 0, _("NSS DB to use"),
          NULL},
+        {"verified", 0, POPT_ARG_STRING, &verified, 0,
+         _("Certificates validated recently"), NULL},
+        {"worker", 0, POPT_ARG_NONE, &worker, 0,
+         _("Serve framed requests until the input is closed"), NULL},
         POPT_TABLEEND
     };
 
@@ -550,8 +675,8 @@ int main(int argc, const char *argv[])
         case 'a':
             if (mode != OP_NONE) {
                 fprintf(stderr,
-                        "\n--auth and --pre are mutually exclusive and " \
-                        "should be only used once.\n\n");
+                        "\n--auth, --pre and --verification are mutually " \
+                        "exclusive and should be only used once.\n\n");
                 poptPrintUsage(pc, stderr, 0);
                 _exit(-1);
             }
@@ -560,13 +685,23 @@ int main(int argc, const char *argv[])
         case 'p':
             if (mode != OP_NONE) {
                 fprintf(stderr,
-                        "\n--auth and --pre are mutually exclusive and " \
-                        "should be only used once.\n\n");
+                        "\n--auth, --pre and --verification are mutually " \
+                        "exclusive and should be only used once.\n\n");
                 poptPrintUsage(pc, stderr, 0);
                 _exit(-1);
             }
             mode = OP_PREAUTH;
             break;
+        case 'v':
+            if (mode != OP_NONE) {
+                fprintf(stderr,
+                        "\n--auth, --pre and --verification are mutually " \
+                        "exclusive and should be only used once.\n\n");
+                poptPrintUsage(pc, stderr, 0);
+                _exit(-1);
+            }
+            mode = OP_VERIFICATION;
+            break;
         case 'i':
             if (pin_mode != PIN_NONE) {
                 fprintf(stderr, "\n--pin and --keypad are mutually exclusive " \
@@ -600,8 +735,13 @@ int main(int argc, const char *argv[])
     }
 
     if (mode == OP_NONE) {
-        fprintf(stderr, "\nMissing operation mode, " \
-                        "either --auth or --pre must be specified.\n\n");
+        fprintf(stderr, "\nMissing operation mode, either --auth, --pre " \
+                        "or --verification must be specified.\n\n");
+        poptPrintUsage(pc, stderr, 0);
+        _exit(-1);
+    } else if (mode == OP_VERIFICATION && cert_b64 == NULL) {
+        fprintf(stderr, "\nMissing certificate for verification, " \
+                        "--certificate must be specified.\n\n");
         poptPrintUsage(pc, stderr, 0);
         _exit(-1);
     } else if (mode == OP_AUTH && pin_mode == PIN_NONE) {
@@ -632,7 +772,9 @@ int main(int argc, const char *argv[])
 
     DEBUG(SSSDBG_TRACE_INTERNAL, "Running in [%s] mode.\n",
           mode == OP_AUTH ? "auth"
-                          : (mode == OP_PREAUTH ? "pre-auth" : "unknown"));
+                          : (mode == OP_PREAUTH ? "pre-auth"
+                          : (mode == OP_VERIFICATION ? "verification"
+                                                     : "unknown")));
 
     DEBUG(SSSDBG_TRACE_INTERNAL,
           "Running with effective IDs: [%"SPRIuid"][%"SPRIgid"].\n",
@@ -656,6 +798,50 @@ int main(int argc, const char *argv[])
         goto fail;
     }
 
+    if (verified != NULL) {
+        ret = split_on_separator(main_ctx, verified, ',', true, true,
+                                 &verified_list, NULL);
+        if (ret != EOK) {
+            DEBUG(SSSDBG_FATAL_FAILURE,
+                  "Failed to parse list of validated certificates.\n");
+            goto fail;
+        }
+    }
+
+    if (worker) {
+        if (mode != OP_PREAUTH) {
+            DEBUG(SSSDBG_FATAL_FAILURE, "Workers only serve pre-auth.\n");
+            goto fail;
+        }
+
+        wctx = talloc_zero(main_ctx, struct p11c_worker_ctx);
+        if (wctx == NULL) {
+            DEBUG(SSSDBG_CRIT_FAILURE, "talloc_zero failed.\n");
+            goto fail;
+        }
+        wctx->nss_db = nss_db;
+        wctx->slot_name_in = slot_name_in;
+        wctx->mode = mode;
+        wctx->cert_verify_opts = cert_verify_opts;
+        wctx->verified_list = verified_list;
+
+        sss_child_worker("p11_child", STDIN_FILENO, STDOUT_FILENO,
+                         p11c_worker_handler, wctx);
+    }
+
+    if (mode == OP_VERIFICATION) {
+        ret = do_verification(main_ctx, nss_db, cert_verify_opts, cert_b64,
+                              &valid_until);
+        if (ret != EOK) {
+            goto fail;
+        }
+
+        fprintf(stdout, "%lld\n", (long long) valid_until);
+
+        talloc_free(main_ctx);
+        return EXIT_SUCCESS;
+    }
+
     if (mode == OP_AUTH && pin_mode == PIN_STDIN) {
         ret = p11c_recv_data(main_ctx, STDIN_FILENO, &pin);
         if (ret != EOK) {
@@ -665,7 +851,7 @@ int main(int argc, const char *argv[])
     }
 
     ret = do_work(main_ctx, nss_db, slot_name_in, mode, pin, cert_verify_opts,
-                  &cert, &token_name_out);
+                  verified_list, &cert, &token_name_out);
     if (ret != EOK) {
         DEBUG(SSSDBG_OP_FAILURE, "do_work failed.\n");
         goto fail;
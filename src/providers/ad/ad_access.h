@@ -47,6 +47,8 @@ struct ad_access_ctx {
     } gpo_map_type;
     hash_table_t *gpo_map_options_table;
     enum gpo_map_type gpo_default_right;
+    /* evaluated GPO results, NULL if disabled */
+    struct ad_gpo_result_cache *gpo_result_cache;
 };
 
 struct tevent_req *
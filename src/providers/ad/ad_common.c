@@ -707,6 +707,16 @@ ad_failover_init(TALLOC_CTX *mem_ctx, struct be_ctx *bectx,
         goto done;
     }
 
+    /* The KDC runs on the same servers, so the LDAP port is probed for
+     * both. */
+    ret = be_fo_set_service_probe(bectx, ad_service, LDAP_PORT);
+    if (ret == EOK) {
+        ret = be_fo_set_service_probe(bectx, ad_gc_service, AD_GC_PORT);
+    }
+    if (ret != EOK) {
+        goto done;
+    }
+
     service->krb5_service->name = talloc_strdup(service->krb5_service,
                                                 ad_service);
     if (!service->krb5_service->name) {
@@ -53,6 +53,7 @@ enum ad_basic_opt {
     AD_ENABLE_GC,
     AD_GPO_ACCESS_CONTROL,
     AD_GPO_CACHE_TIMEOUT,
+    AD_GPO_RESULT_CACHE_INTERVAL,
     AD_GPO_MAP_INTERACTIVE,
     AD_GPO_MAP_REMOTE_INTERACTIVE,
     AD_GPO_MAP_NETWORK,
@@ -61,7 +62,10 @@ enum ad_basic_opt {
     AD_GPO_MAP_PERMIT,
     AD_GPO_MAP_DENY,
     AD_GPO_DEFAULT_RIGHT,
+    AD_GPO_CHILD_POOL_SIZE,
     AD_SITE,
+    AD_SITE_PING_COUNT,
+    AD_SITE_PING_REFRESH_INTERVAL,
     AD_KRB5_CONFD_PATH,
     AD_MAXIMUM_MACHINE_ACCOUNT_PASSWORD_AGE,
     AD_MACHINE_ACCOUNT_PASSWORD_RENEWAL_OPTS,
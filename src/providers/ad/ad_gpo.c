@@ -38,8 +38,10 @@
 #include "util/util.h"
 #include "util/strtonum.h"
 #include "util/child_common.h"
+#include "util/murmurhash3.h"
 #include "providers/data_provider.h"
 #include "providers/backend.h"
+#include "providers/be_ptask.h"
 #include "providers/ad/ad_access.h"
 #include "providers/ad/ad_common.h"
 #include "providers/ad/ad_domain_info.h"
@@ -65,6 +67,7 @@
 #define AD_AT_MACHINE_EXT_NAMES "gPCMachineExtensionNames"
 #define AD_AT_FUNC_VERSION "gPCFunctionalityVersion"
 #define AD_AT_FLAGS "flags"
+#define AD_AT_VERSION_NUMBER "versionNumber"
 
 #define UAC_WORKSTATION_TRUST_ACCOUNT 0x00001000
 #define UAC_SERVER_TRUST_ACCOUNT 0x00002000
@@ -105,6 +108,7 @@
 
 /* fd used by the gpo_child process for logging */
 int gpo_child_debug_fd = -1;
+static struct sss_child_pool *gpo_child_pool;
 
 /* == common data structures and declarations ============================= */
 
@@ -130,6 +134,8 @@ struct gp_gpo {
     int num_gpo_cse_guids;
     int gpo_func_version;
     int gpo_flags;
+    int gpo_version;
+    uint32_t gpo_sd_digest;
     bool send_to_child;
     const char *policy_filename;
 };
@@ -1411,9 +1417,71 @@ ad_gpo_access_check(TALLOC_CTX *mem_ctx,
 
 #define GPO_CHILD_LOG_FILE "gpo_child"
 
-static errno_t gpo_child_init(void)
+static errno_t gpo_child_init(struct tevent_context *ev,
+                              struct ad_access_ctx *access_ctx)
 {
-    return child_debug_init(GPO_CHILD_LOG_FILE, &gpo_child_debug_fd);
+    int pool_size;
+    errno_t ret;
+
+    ret = child_debug_init(GPO_CHILD_LOG_FILE, &gpo_child_debug_fd);
+    if (ret != EOK) {
+        return ret;
+    }
+
+    pool_size = dp_opt_get_int(access_ctx->ad_options, AD_GPO_CHILD_POOL_SIZE);
+    if (pool_size <= 0 || gpo_child_pool != NULL) {
+        return EOK;
+    }
+
+    /* Requests wait for a busy worker only as long as there are not more
+     * of them than workers, otherwise a new gpo_child is forked. */
+    ret = sss_child_pool_create(access_ctx, ev, GPO_CHILD, gpo_child_debug_fd,
+                                NULL, STDIN_FILENO, AD_GPO_CHILD_OUT_FILENO,
+                                pool_size, SSS_CHILD_POOL_MAX_JOBS, pool_size,
+                                &gpo_child_pool);
+    if (ret != EOK) {
+        DEBUG(SSSDBG_OP_FAILURE, "Cannot create gpo_child pool [%d]: %s\n",
+              ret, sss_strerror(ret));
+        return ret;
+    }
+
+    return EOK;
+}
+
+/*
+ * This function parses a raw policy setting value (a comma-separated list of
+ * asterisk-prefixed sids) into a sids_list. A NULL value yields an empty list.
+ */
+static errno_t
+ad_gpo_parse_sids_value(TALLOC_CTX *mem_ctx,
+                        const char *value,
+                        char ***_sids_list,
+                        int *_sids_list_size)
+{
+    int ret;
+    int i;
+    int sids_list_size = 0;
+    char **sids_list = NULL;
+
+    if (value != NULL) {
+        ret = split_on_separator(mem_ctx, value, ',', true, true,
+                                 &sids_list, &sids_list_size);
+        if (ret != EOK) {
+            DEBUG(SSSDBG_OP_FAILURE,
+                  "Cannot parse list of sids %s: %d\n", value, ret);
+            return EINVAL;
+        }
+
+        for (i = 0; i < sids_list_size; i++) {
+            /* remove the asterisk prefix found on sids */
+            sids_list[i]++;
+        }
+    }
+
+    *_sids_list = talloc_steal(mem_ctx, sids_list);
+    *_sids_list_size = sids_list_size;
+
+    return EOK;
 }
 
 /*
@@ -1430,10 +1498,7 @@ parse_policy_setting_value(TALLOC_CTX *mem_ctx,
                            int *_sids_list_size)
 {
     int ret;
-    int i;
     const char *value;
-    int sids_list_size;
-    char **sids_list = NULL;
 
     ret = sysdb_gpo_get_gpo_result_setting(mem_ctx, domain, key, &value);
     if (ret == ENOENT) {
@@ -1449,27 +1514,9 @@ parse_policy_setting_value(TALLOC_CTX *mem_ctx,
     if (value == NULL) {
         DEBUG(SSSDBG_TRACE_FUNC,
               "No value for key [%s] found in gpo result\n", key);
-        sids_list_size = 0;
-    } else {
-        ret = split_on_separator(mem_ctx, value, ',', true, true,
-                                 &sids_list, &sids_list_size);
-        if (ret != EOK) {
-            DEBUG(SSSDBG_OP_FAILURE,
-                  "Cannot parse list of sids %s: %d\n", value, ret);
-            ret = EINVAL;
-            goto done;
-        }
-
-        for (i = 0; i < sids_list_size; i++) {
-            /* remove the asterisk prefix found on sids */
-            sids_list[i]++;
-        }
     }
 
-    *_sids_list = talloc_steal(mem_ctx, sids_list);
-    *_sids_list_size = sids_list_size;
-
-    ret = EOK;
+    ret = ad_gpo_parse_sids_value(mem_ctx, value, _sids_list, _sids_list_size);
 
  done:
     return ret;
@@ -1545,6 +1592,275 @@ ad_gpo_perform_hbac_processing(TALLOC_CTX *mem_ctx,
     return ret;
 }
 
+/* == evaluated GPO result cache ============================================ */
+
+/*
+ * The result cache keeps the resultant allow/deny policy settings per policy
+ * target and SID set, so that repeated logons of the same user do not need to
+ * walk the SOM/GPO hierarchy and DACLs again. The cache is flushed whenever
+ * the digest of the candidate GPO list (DNs, versionNumbers, DACLs, flags and
+ * CSE GUIDs) changes, which is checked on each full evaluation and by a
+ * periodic task.
+ */
+struct ad_gpo_result_cache {
+    hash_table_t *table;
+    uint32_t digest;
+    bool digest_valid;
+    struct be_ptask *refresh_task;
+};
+
+struct ad_gpo_result_entry {
+    const char *allow_values[GPO_MAP_NUM_OPTS];
+    const char *deny_values[GPO_MAP_NUM_OPTS];
+};
+
+static int ad_gpo_sid_cmp(const void *a, const void *b)
+{
+    return strcmp(*(const char **) a, *(const char **) b);
+}
+
+static char *
+ad_gpo_result_cache_key(TALLOC_CTX *mem_ctx,
+                        const char *ad_hostname,
+                        const char *user,
+                        struct sss_domain_info *domain)
+{
+    TALLOC_CTX *tmp_ctx;
+    const char *user_sid;
+    const char **group_sids;
+    int group_size = 0;
+    char *key = NULL;
+    errno_t ret;
+    int i;
+
+    tmp_ctx = talloc_new(NULL);
+    if (tmp_ctx == NULL) {
+        return NULL;
+    }
+
+    ret = ad_gpo_get_sids(tmp_ctx, user, domain, &user_sid,
+                          &group_sids, &group_size);
+    if (ret != EOK) {
+        DEBUG(SSSDBG_TRACE_FUNC,
+              "Unable to retrieve SIDs of [%s], not using the GPO result "
+              "cache: [%d](%s)\n", user, ret, sss_strerror(ret));
+        goto done;
+    }
+
+    /* the group order depends on the cache, not on the memberships */
+    qsort(group_sids, group_size, sizeof(const char *), ad_gpo_sid_cmp);
+
+    key = talloc_asprintf(tmp_ctx, "%s\x1f%s", ad_hostname, user_sid);
+    for (i = 0; key != NULL && i < group_size; i++) {
+        key = talloc_asprintf_append(key, "\x1f%s", group_sids[i]);
+    }
+
+    key = talloc_steal(mem_ctx, key);
+
+done:
+    talloc_free(tmp_ctx);
+    return key;
+}
+
+static errno_t
+ad_gpo_result_cache_flush(struct ad_gpo_result_cache *cache)
+{
+    hash_table_t *table;
+    errno_t ret;
+
+    ret = sss_hash_create(cache, 0, &table);
+    if (ret != EOK) {
+        return ret;
+    }
+
+    talloc_free(cache->table);
+    cache->table = table;
+
+    return EOK;
+}
+
+/*
+ * Compares the digest of the candidate GPO list with the one the cached
+ * results were computed from and flushes the cache if they differ.
+ */
+static errno_t
+ad_gpo_result_cache_check_digest(struct ad_gpo_result_cache *cache,
+                                 struct gp_gpo **candidate_gpos,
+                                 int num_candidate_gpos)
+{
+    uint32_t digest = 0;
+    struct gp_gpo *gpo;
+    char *str;
+    int i;
+    int j;
+
+    for (i = 0; i < num_candidate_gpos; i++) {
+        gpo = candidate_gpos[i];
+
+        str = talloc_asprintf(NULL, "%s\x1f%s\x1f%d\x1f%"PRIu32"\x1f%d",
+                              gpo->gpo_dn, gpo->gpo_guid, gpo->gpo_version,
+                              gpo->gpo_sd_digest, gpo->gpo_flags);
+        for (j = 0; str != NULL && j < gpo->num_gpo_cse_guids; j++) {
+            str = talloc_asprintf_append(str, "\x1f%s",
+                                         gpo->gpo_cse_guids[j]);
+        }
+        if (str == NULL) {
+            return ENOMEM;
+        }
+
+        digest = murmurhash3(str, strlen(str), digest);
+        talloc_free(str);
+    }
+
+    if (cache->digest_valid && cache->digest != digest) {
+        DEBUG(SSSDBG_TRACE_FUNC,
+              "Applicable GPOs changed, flushing the GPO result cache\n");
+        cache->digest = digest;
+        return ad_gpo_result_cache_flush(cache);
+    }
+
+    cache->digest = digest;
+    cache->digest_valid = true;
+
+    return EOK;
+}
+
+/*
+ * Stores the resultant policy settings currently found in the GPO Result
+ * object. An empty entry is stored if there are no applicable GPOs.
+ */
+static errno_t
+ad_gpo_result_cache_store(struct ad_gpo_result_cache *cache,
+                          const char *cache_key,
+                          struct sss_domain_info *host_domain,
+                          bool empty)
+{
+    struct ad_gpo_result_entry *entry;
+    const char *value;
+    hash_key_t key;
+    hash_value_t val;
+    errno_t ret;
+    int hret;
+    int i;
+
+    if (cache == NULL || cache_key == NULL) {
+        return EOK;
+    }
+
+    entry = talloc_zero(cache->table, struct ad_gpo_result_entry);
+    if (entry == NULL) {
+        return ENOMEM;
+    }
+
+    for (i = 0; !empty && i < GPO_MAP_NUM_OPTS; i++) {
+        if (gpo_map_option_entries[i].allow_key == NULL) {
+            continue;
+        }
+
+        ret = sysdb_gpo_get_gpo_result_setting(entry, host_domain,
+                                               gpo_map_option_entries[i].allow_key,
+                                               &value);
+        if (ret != EOK && ret != ENOENT) {
+            goto done;
+        }
+        entry->allow_values[i] = ret == EOK ? value : NULL;
+
+        ret = sysdb_gpo_get_gpo_result_setting(entry, host_domain,
+                                               gpo_map_option_entries[i].deny_key,
+                                               &value);
+        if (ret != EOK && ret != ENOENT) {
+            goto done;
+        }
+        entry->deny_values[i] = ret == EOK ? value : NULL;
+    }
+
+    key.type = HASH_KEY_STRING;
+    key.str = discard_const(cache_key);
+
+    hret = hash_lookup(cache->table, &key, &val);
+    if (hret == HASH_SUCCESS) {
+        hash_delete(cache->table, &key);
+        talloc_free(val.ptr);
+    }
+
+    val.type = HASH_VALUE_PTR;
+    val.ptr = entry;
+
+    hret = hash_enter(cache->table, &key, &val);
+    if (hret != HASH_SUCCESS) {
+        DEBUG(SSSDBG_MINOR_FAILURE, "Could not update GPO result cache: "
+              "[%s]\n", hash_error_string(hret));
+        ret = EIO;
+        goto done;
+    }
+
+    ret = EOK;
+
+done:
+    if (ret != EOK) {
+        talloc_free(entry);
+    }
+    return ret;
+}
+
+/*
+ * Evaluates the cached policy settings for the given cache key. Returns
+ * ENOENT if there is no cached result, otherwise the result of the access
+ * check.
+ */
+static errno_t
+ad_gpo_result_cache_check(TALLOC_CTX *mem_ctx,
+                          struct ad_gpo_result_cache *cache,
+                          const char *cache_key,
+                          enum gpo_access_control_mode gpo_mode,
+                          enum gpo_map_type gpo_map_type,
+                          const char *user,
+                          struct sss_domain_info *user_domain)
+{
+    struct ad_gpo_result_entry *entry;
+    char **allow_sids;
+    int allow_size;
+    char **deny_sids;
+    int deny_size;
+    hash_key_t key;
+    hash_value_t val;
+    errno_t ret;
+    int hret;
+
+    key.type = HASH_KEY_STRING;
+    key.str = discard_const(cache_key);
+
+    hret = hash_lookup(cache->table, &key, &val);
+    if (hret == HASH_ERROR_KEY_NOT_FOUND) {
+        return ENOENT;
+    } else if (hret != HASH_SUCCESS) {
+        return EIO;
+    }
+
+    entry = talloc_get_type(val.ptr, struct ad_gpo_result_entry);
+    if (entry == NULL) {
+        return ENOENT;
+    }
+
+    DEBUG(SSSDBG_TRACE_FUNC, "Using cached GPO result for [%s]\n", user);
+
+    ret = ad_gpo_parse_sids_value(mem_ctx, entry->allow_values[gpo_map_type],
+                                  &allow_sids, &allow_size);
+    if (ret != EOK) {
+        return ret;
+    }
+
+    ret = ad_gpo_parse_sids_value(mem_ctx, entry->deny_values[gpo_map_type],
+                                  &deny_sids, &deny_size);
+    if (ret != EOK) {
+        return ret;
+    }
+
+    return ad_gpo_access_check(mem_ctx, gpo_mode, gpo_map_type, user,
+                               user_domain, allow_sids, allow_size,
+                               deny_sids, deny_size);
+}
+
 /* == ad_gpo_access_send/recv implementation ================================*/
 
 struct ad_gpo_access_state {
@@ -1569,6 +1885,9 @@ struct ad_gpo_access_state {
     struct gp_gpo **cse_filtered_gpos;
     int num_cse_filtered_gpos;
     int cse_gpo_index;
+    const char *result_cache_key;
+    /* only refresh the digest of the GPO result cache */
+    bool refresh;
 };
 
 static void ad_gpo_connect_done(struct tevent_req *subreq);
@@ -1579,6 +1898,22 @@ static void ad_gpo_process_gpo_done(struct tevent_req *subreq);
 static errno_t ad_gpo_cse_step(struct tevent_req *req);
 static void ad_gpo_cse_done(struct tevent_req *subreq);
 
+static void
+ad_gpo_access_cache_result(struct ad_gpo_access_state *state, bool empty)
+{
+    errno_t ret;
+
+    ret = ad_gpo_result_cache_store(state->access_ctx->gpo_result_cache,
+                                    state->result_cache_key,
+                                    state->host_domain, empty);
+    if (ret != EOK) {
+        /* not fatal, the next request evaluates the GPOs again */
+        DEBUG(SSSDBG_MINOR_FAILURE,
+              "Unable to cache GPO result: [%d](%s)\n",
+              ret, sss_strerror(ret));
+    }
+}
+
 struct tevent_req *
 ad_gpo_access_send(TALLOC_CTX *mem_ctx,
                    struct tevent_context *ev,
@@ -1596,8 +1931,8 @@ ad_gpo_access_send(TALLOC_CTX *mem_ctx,
     hash_value_t val;
     enum gpo_map_type gpo_map_type;
 
-    /* setup logging for gpo child */
-    gpo_child_init();
+    /* setup logging and the pool of workers for gpo child */
+    gpo_child_init(ev, ctx);
 
     req = tevent_req_create(mem_ctx, &state, struct ad_gpo_access_state);
     if (req == NULL) {
@@ -1671,6 +2006,23 @@ ad_gpo_access_send(TALLOC_CTX *mem_ctx,
     state->gpo_timeout_option = ctx->gpo_cache_timeout;
     state->ad_hostname = dp_opt_get_string(ctx->ad_options, AD_HOSTNAME);
     state->access_ctx = ctx;
+
+    if (ctx->gpo_result_cache != NULL) {
+        state->result_cache_key = ad_gpo_result_cache_key(state,
+                                                          state->ad_hostname,
+                                                          user, domain);
+    }
+
+    if (state->result_cache_key != NULL) {
+        ret = ad_gpo_result_cache_check(state, ctx->gpo_result_cache,
+                                        state->result_cache_key,
+                                        state->gpo_mode, gpo_map_type,
+                                        user, domain);
+        if (ret != ENOENT) {
+            goto immediately;
+        }
+    }
+
     state->opts = ctx->sdap_access_ctx->id_ctx->opts;
     state->timeout = dp_opt_get_int(state->opts->basic, SDAP_SEARCH_TIMEOUT);
     state->conn = ad_get_dom_ldap_conn(ctx->ad_id_ctx, state->host_domain);
@@ -1762,6 +2114,12 @@ ad_gpo_connect_done(struct tevent_req *subreq)
                   ret, sss_strerror(ret));
             goto done;
         } else {
+            if (state->refresh) {
+                ret = EOK;
+                tevent_req_done(req);
+                goto done;
+            }
+
             DEBUG(SSSDBG_TRACE_FUNC, "Preparing for offline operation.\n");
             ret = process_offline_gpos(state,
                                        state->user,
@@ -1884,6 +2242,12 @@ ad_gpo_target_dn_retrieval_done(struct tevent_req *subreq)
     if (ret != EOK) {
         ret = sdap_id_op_done(state->sdap_op, ret, &dp_error);
         if (ret == EAGAIN && dp_error == DP_ERR_OFFLINE) {
+            if (state->refresh) {
+                ret = EOK;
+                tevent_req_done(req);
+                goto done;
+            }
+
             DEBUG(SSSDBG_TRACE_FUNC, "Preparing for offline operation.\n");
             ret = process_offline_gpos(state,
                                        state->user,
@@ -2053,6 +2417,7 @@ ad_gpo_process_gpo_done(struct tevent_req *subreq)
     int num_candidate_gpos = 0;
     int i = 0;
     const char **cse_filtered_gpo_guids;
+    errno_t cache_ret;
 
     req = tevent_req_callback_data(subreq, struct tevent_req);
     state = tevent_req_data(req, struct ad_gpo_access_state);
@@ -2068,7 +2433,28 @@ ad_gpo_process_gpo_done(struct tevent_req *subreq)
               "Unable to get GPO list: [%d](%s)\n",
               ret, sss_strerror(ret));
         goto done;
-    } else if (ret == ENOENT) {
+    }
+
+    if (state->access_ctx->gpo_result_cache != NULL) {
+        cache_ret = ad_gpo_result_cache_check_digest(
+                                    state->access_ctx->gpo_result_cache,
+                                    candidate_gpos,
+                                    ret == ENOENT ? 0 : num_candidate_gpos);
+        if (cache_ret != EOK) {
+            DEBUG(SSSDBG_OP_FAILURE,
+                  "Unable to check GPO result cache: [%d](%s)\n",
+                  cache_ret, sss_strerror(cache_ret));
+            ret = cache_ret;
+            goto done;
+        }
+
+        if (state->refresh) {
+            ret = EOK;
+            goto done;
+        }
+    }
+
+    if (ret == ENOENT) {
         DEBUG(SSSDBG_TRACE_FUNC,
               "No GPOs found that apply to this system.\n");
         /*
@@ -2089,6 +2475,7 @@ ad_gpo_process_gpo_done(struct tevent_req *subreq)
             }
         }
 
+        ad_gpo_access_cache_result(state, true);
         ret = EOK;
         goto done;
     }
@@ -2128,6 +2515,7 @@ ad_gpo_process_gpo_done(struct tevent_req *subreq)
             }
         }
 
+        ad_gpo_access_cache_result(state, true);
         ret = EOK;
         goto done;
     }
@@ -2155,6 +2543,7 @@ ad_gpo_process_gpo_done(struct tevent_req *subreq)
         /* no gpos contain "SecuritySettings" cse_guid, nothing to enforce */
         DEBUG(SSSDBG_TRACE_FUNC,
               "no applicable gpos found after cse_guid filtering\n");
+        ad_gpo_access_cache_result(state, true);
         ret = EOK;
         goto done;
     }
@@ -2283,6 +2672,17 @@ ad_gpo_cse_step(struct tevent_req *req)
         if (policy_file_timeout >= time(NULL)) {
             send_to_child = false;
         }
+
+        /*
+         * With the result cache enabled the versionNumber of the GPO object
+         * is trusted to track the GPT.INI version, so the gpo_child is only
+         * needed if it differs from the cached one.
+         */
+        if (state->access_ctx->gpo_result_cache != NULL
+                && cse_filtered_gpo->gpo_version >= 0
+                && cse_filtered_gpo->gpo_version == cached_gpt_version) {
+            send_to_child = false;
+        }
     } else if (ret == ENOENT) {
         DEBUG(SSSDBG_TRACE_FUNC, "ENOENT\n");
         cached_gpt_version = -1;
@@ -2367,6 +2767,8 @@ ad_gpo_cse_done(struct tevent_req *subreq)
 
     if (ret == EOK) {
         /* ret is EOK only after all GPO policy files have been downloaded */
+        ad_gpo_access_cache_result(state, false);
+
         ret = ad_gpo_perform_hbac_processing(state,
                                              state->gpo_mode,
                                              state->gpo_map_type,
@@ -2398,6 +2800,129 @@ ad_gpo_access_recv(struct tevent_req *req)
     return EOK;
 }
 
+/* == GPO result cache revalidation ======================================== */
+
+/*
+ * The periodic task re-reads the applicable GPOs of the policy target and
+ * flushes the result cache if their digest changed. No policy files are
+ * downloaded; this happens on the next cache miss.
+ */
+static struct tevent_req *
+ad_gpo_result_cache_refresh_send(TALLOC_CTX *mem_ctx,
+                                 struct tevent_context *ev,
+                                 struct be_ctx *be_ctx,
+                                 struct be_ptask *be_ptask,
+                                 void *pvt)
+{
+    struct tevent_req *req;
+    struct tevent_req *subreq;
+    struct ad_gpo_access_state *state;
+    struct ad_access_ctx *ctx;
+    errno_t ret;
+
+    req = tevent_req_create(mem_ctx, &state, struct ad_gpo_access_state);
+    if (req == NULL) {
+        DEBUG(SSSDBG_CRIT_FAILURE, "tevent_req_create() failed\n");
+        return NULL;
+    }
+
+    ctx = talloc_get_type(pvt, struct ad_access_ctx);
+    if (ctx == NULL) {
+        ret = EINVAL;
+        goto immediately;
+    }
+
+    state->refresh = true;
+    state->ev = ev;
+    state->user_domain = be_ctx->domain;
+    state->host_domain = be_ctx->domain;
+    state->ldb_ctx = sysdb_ctx_get_ldb(state->host_domain->sysdb);
+    state->gpo_mode = ctx->gpo_access_control_mode;
+    state->gpo_timeout_option = ctx->gpo_cache_timeout;
+    state->ad_hostname = dp_opt_get_string(ctx->ad_options, AD_HOSTNAME);
+    state->access_ctx = ctx;
+    state->opts = ctx->sdap_access_ctx->id_ctx->opts;
+    state->timeout = dp_opt_get_int(state->opts->basic, SDAP_SEARCH_TIMEOUT);
+    state->conn = ad_get_dom_ldap_conn(ctx->ad_id_ctx, state->host_domain);
+    state->sdap_op = sdap_id_op_create(state, state->conn->conn_cache);
+    if (state->sdap_op == NULL) {
+        DEBUG(SSSDBG_OP_FAILURE, "sdap_id_op_create failed.\n");
+        ret = ENOMEM;
+        goto immediately;
+    }
+
+    DEBUG(SSSDBG_TRACE_FUNC, "Revalidating the GPO result cache\n");
+
+    subreq = sdap_id_op_connect_send(state->sdap_op, state, &ret);
+    if (subreq == NULL) {
+        DEBUG(SSSDBG_OP_FAILURE,
+              "sdap_id_op_connect_send failed: [%d](%s)\n",
+               ret, sss_strerror(ret));
+        goto immediately;
+    }
+    tevent_req_set_callback(subreq, ad_gpo_connect_done, req);
+
+    return req;
+
+immediately:
+    if (ret == EOK) {
+        tevent_req_done(req);
+    } else {
+        tevent_req_error(req, ret);
+    }
+    tevent_req_post(req, ev);
+
+    return req;
+}
+
+static errno_t
+ad_gpo_result_cache_refresh_recv(struct tevent_req *req)
+{
+    TEVENT_REQ_RETURN_ON_ERROR(req);
+
+    return EOK;
+}
+
+errno_t
+ad_gpo_result_cache_init(struct be_ctx *be_ctx,
+                         struct ad_access_ctx *access_ctx,
+                         time_t interval)
+{
+    struct ad_gpo_result_cache *cache;
+    errno_t ret;
+
+    cache = talloc_zero(access_ctx, struct ad_gpo_result_cache);
+    if (cache == NULL) {
+        return ENOMEM;
+    }
+
+    ret = sss_hash_create(cache, 0, &cache->table);
+    if (ret != EOK) {
+        goto done;
+    }
+
+    ret = be_ptask_create(cache, be_ctx, interval, interval, 0, 0, interval,
+                          BE_PTASK_OFFLINE_SKIP, 0,
+                          ad_gpo_result_cache_refresh_send,
+                          ad_gpo_result_cache_refresh_recv,
+                          access_ctx, "AD GPO Result Cache Refresh",
+                          &cache->refresh_task);
+    if (ret != EOK) {
+        DEBUG(SSSDBG_OP_FAILURE, "Unable to setup ptask "
+              "[%d]: %s\n", ret, sss_strerror(ret));
+        goto done;
+    }
+
+    access_ctx->gpo_result_cache = cache;
+    ret = EOK;
+
+done:
+    if (ret != EOK) {
+        talloc_free(cache);
+    }
+    return ret;
+}
+
 /* == ad_gpo_process_som_send/recv helpers ================================= */
 
 /*
@@ -3871,6 +4396,20 @@ ad_gpo_sd_process_attrs(struct tevent_req *req,
 
     DEBUG(SSSDBG_TRACE_ALL, "gpo_flags: %d\n", gp_gpo->gpo_flags);
 
+    /* retrieve AD_AT_VERSION_NUMBER; -1 means unknown */
+    ret = sysdb_attrs_get_int32_t(result, AD_AT_VERSION_NUMBER,
+                                  &gp_gpo->gpo_version);
+    if (ret == ENOENT) {
+        gp_gpo->gpo_version = -1;
+    } else if (ret != EOK) {
+        DEBUG(SSSDBG_OP_FAILURE,
+              "sysdb_attrs_get_int32_t failed: [%d](%s)\n",
+              ret, sss_strerror(ret));
+        goto done;
+    }
+
+    DEBUG(SSSDBG_TRACE_ALL, "gpo_version: %d\n", gp_gpo->gpo_version);
+
     /* retrieve AD_AT_NT_SEC_DESC */
     ret = sysdb_attrs_get_el(result, AD_AT_NT_SEC_DESC, &el);
     if (ret != EOK && ret != ENOENT) {
@@ -3891,6 +4430,10 @@ ad_gpo_sd_process_attrs(struct tevent_req *req,
         goto done;
     }
 
+    /* a change of the DACL invalidates the cached GPO results */
+    gp_gpo->gpo_sd_digest = murmurhash3((const char *) el[0].values[0].data,
+                                        el[0].values[0].length, 0);
+
     /* retrieve AD_AT_MACHINE_EXT_NAMES */
     ret = sysdb_attrs_get_el(result, AD_AT_MACHINE_EXT_NAMES, &el);
     if (ret != EOK && ret != ENOENT) {
@@ -4054,6 +4597,8 @@ struct ad_gpo_process_cse_state {
 static errno_t gpo_fork_child(struct tevent_req *req);
 static void gpo_cse_step(struct tevent_req *subreq);
 static void gpo_cse_done(struct tevent_req *subreq);
+static void gpo_cse_pool_done(struct tevent_req *subreq);
+static void gpo_cse_process_response(struct tevent_req *req);
 
 /*
  * This cse-specific function (GP_EXT_GUID_SECURITY) sends the input smb uri
@@ -4123,6 +4668,19 @@ ad_gpo_process_cse_send(TALLOC_CTX *mem_ctx,
         goto immediately;
     }
 
+    if (sss_child_pool_accepts(gpo_child_pool)) {
+        /* gpo_child forked for a single request has no timeout either */
+        subreq = sss_child_pool_send(state, ev, gpo_child_pool,
+                                     buf->data, buf->size, 0);
+        if (subreq == NULL) {
+            ret = ENOMEM;
+            goto immediately;
+        }
+        tevent_req_set_callback(subreq, gpo_cse_pool_done, req);
+
+        return req;
+    }
+
     ret = gpo_fork_child(req);
     if (ret != EOK) {
         DEBUG(SSSDBG_CRIT_FAILURE, "gpo_fork_child failed.\n");
@@ -4183,13 +4741,10 @@ static void gpo_cse_done(struct tevent_req *subreq)
 {
     struct tevent_req *req;
     struct ad_gpo_process_cse_state *state;
-    uint32_t sysvol_gpt_version = -1;
-    uint32_t child_result;
-    time_t now;
+    int ret;
 
     req = tevent_req_callback_data(subreq, struct tevent_req);
     state = tevent_req_data(req, struct ad_gpo_process_cse_state);
-    int ret;
 
     ret = read_pipe_recv(subreq, state, &state->buf, &state->len);
     talloc_zfree(subreq);
@@ -4200,6 +4755,38 @@ static void gpo_cse_done(struct tevent_req *subreq)
 
     PIPE_FD_CLOSE(state->io->read_from_child_fd);
 
+    gpo_cse_process_response(req);
+}
+
+static void gpo_cse_pool_done(struct tevent_req *subreq)
+{
+    struct tevent_req *req;
+    struct ad_gpo_process_cse_state *state;
+    int ret;
+
+    req = tevent_req_callback_data(subreq, struct tevent_req);
+    state = tevent_req_data(req, struct ad_gpo_process_cse_state);
+
+    ret = sss_child_pool_recv(subreq, state, &state->buf, &state->len);
+    talloc_zfree(subreq);
+    if (ret != EOK) {
+        tevent_req_error(req, ret);
+        return;
+    }
+
+    gpo_cse_process_response(req);
+}
+
+static void gpo_cse_process_response(struct tevent_req *req)
+{
+    struct ad_gpo_process_cse_state *state;
+    uint32_t sysvol_gpt_version = -1;
+    uint32_t child_result;
+    time_t now;
+    int ret;
+
+    state = tevent_req_data(req, struct ad_gpo_process_cse_state);
+
     ret = ad_gpo_parse_gpo_child_response(state->buf, state->len,
                                           &sysvol_gpt_version, &child_result);
     if (ret != EOK) {
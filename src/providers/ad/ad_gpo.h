@@ -32,6 +32,7 @@
                       AD_AT_MACHINE_EXT_NAMES, \
                       AD_AT_FUNC_VERSION, \
                       AD_AT_FLAGS, \
+                      AD_AT_VERSION_NUMBER, \
                       NULL}
 
 /*
@@ -62,4 +63,12 @@ ad_gpo_access_send(TALLOC_CTX *mem_ctx,
 
 errno_t ad_gpo_access_recv(struct tevent_req *req);
 
+/*
+ * Enables the cache of evaluated GPO results, which is revalidated against
+ * the GPOs in AD every interval seconds.
+ */
+errno_t ad_gpo_result_cache_init(struct be_ctx *be_ctx,
+                                 struct ad_access_ctx *access_ctx,
+                                 time_t interval);
+
 #endif /* AD_GPO_H_ */
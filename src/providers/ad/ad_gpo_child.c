@@ -614,35 +614,17 @@ copy_smb_file_to_gpo_cache(SMBCCTX *smbc_ctx,
  * - backend will read the policy file from the GPO_CACHE
  */
 static errno_t
-perform_smb_operations(int cached_gpt_version,
+perform_smb_operations(SMBCCTX *smbc_ctx,
+                       int cached_gpt_version,
                        const char *smb_server,
                        const char *smb_share,
                        const char *smb_path,
                        const char *smb_cse_suffix,
                        int *_sysvol_gpt_version)
 {
-    SMBCCTX *smbc_ctx;
     int ret;
     int sysvol_gpt_version;
 
-    smbc_ctx = smbc_new_context();
-    if (smbc_ctx == NULL) {
-        DEBUG(SSSDBG_CRIT_FAILURE, "Could not allocate new smbc context\n");
-        ret = ENOMEM;
-        goto done;
-    }
-
-    smbc_setOptionDebugToStderr(smbc_ctx, 1);
-    smbc_setFunctionAuthData(smbc_ctx, sssd_krb_get_auth_data_fn);
-    smbc_setOptionUseKerberos(smbc_ctx, 1);
-
-    /* Initialize the context using the previously specified options */
-    if (smbc_init_context(smbc_ctx) == NULL) {
-        DEBUG(SSSDBG_CRIT_FAILURE, "Could not initialize smbc context\n");
-        ret = ENOMEM;
-        goto done;
-    }
-
     /* download ini file */
     ret = copy_smb_file_to_gpo_cache(smbc_ctx, smb_server, smb_share, smb_path,
                                      GPT_INI);
@@ -677,10 +659,113 @@ perform_smb_operations(int cached_gpt_version,
     *_sysvol_gpt_version = sysvol_gpt_version;
 
  done:
-    smbc_free_context(smbc_ctx, 0);
     return ret;
 }
 
+static errno_t gpo_child_smbc_init(SMBCCTX **_smbc_ctx)
+{
+    SMBCCTX *smbc_ctx;
+
+    smbc_ctx = smbc_new_context();
+    if (smbc_ctx == NULL) {
+        DEBUG(SSSDBG_CRIT_FAILURE, "Could not allocate new smbc context\n");
+        return ENOMEM;
+    }
+
+    smbc_setOptionDebugToStderr(smbc_ctx, 1);
+    smbc_setFunctionAuthData(smbc_ctx, sssd_krb_get_auth_data_fn);
+    smbc_setOptionUseKerberos(smbc_ctx, 1);
+
+    /* Initialize the context using the previously specified options */
+    if (smbc_init_context(smbc_ctx) == NULL) {
+        DEBUG(SSSDBG_CRIT_FAILURE, "Could not initialize smbc context\n");
+        smbc_free_context(smbc_ctx, 0);
+        return ENOMEM;
+    }
+
+    *_smbc_ctx = smbc_ctx;
+    return EOK;
+}
+
+static errno_t gpo_child_process(TALLOC_CTX *mem_ctx,
+                                 SMBCCTX *smbc_ctx,
+                                 uint8_t *buf, size_t len,
+                                 struct response **_resp)
+{
+    struct input_buffer *ibuf;
+    int sysvol_gpt_version;
+    errno_t ret;
+
+    ibuf = talloc_zero(NULL, struct input_buffer);
+    if (ibuf == NULL) {
+        DEBUG(SSSDBG_CRIT_FAILURE, "talloc_zero failed.\n");
+        return ENOMEM;
+    }
+
+    ret = unpack_buffer(buf, len, ibuf);
+    if (ret != EOK) {
+        DEBUG(SSSDBG_CRIT_FAILURE,
+              "unpack_buffer failed.[%d][%s].\n", ret, strerror(ret));
+        goto done;
+    }
+
+    DEBUG(SSSDBG_TRACE_FUNC, "performing smb operations\n");
+
+    ret = perform_smb_operations(smbc_ctx,
+                                 ibuf->cached_gpt_version,
+                                 ibuf->smb_server,
+                                 ibuf->smb_share,
+                                 ibuf->smb_path,
+                                 ibuf->smb_cse_suffix,
+                                 &sysvol_gpt_version);
+    if (ret != EOK) {
+        DEBUG(SSSDBG_CRIT_FAILURE,
+              "perform_smb_operations failed.[%d][%s].\n",
+              ret, strerror(ret));
+        goto done;
+    }
+
+    ret = prepare_response(mem_ctx, sysvol_gpt_version, ret, _resp);
+    if (ret != EOK) {
+        DEBUG(SSSDBG_CRIT_FAILURE, "prepare_response failed. [%d][%s].\n",
+                    ret, strerror(ret));
+        goto done;
+    }
+
+done:
+    talloc_free(ibuf);
+    return ret;
+}
+
+/* The worker keeps the smbc context of the first request for the later
+ * ones, which saves the samba initialization on every download. */
+static errno_t gpo_child_worker_handler(TALLOC_CTX *mem_ctx,
+                                        uint8_t *req_buf, uint32_t req_len,
+                                        uint8_t **_reply,
+                                        uint32_t *_reply_len,
+                                        void *pvt)
+{
+    SMBCCTX **smbc_ctx = pvt;
+    struct response *resp = NULL;
+    errno_t ret;
+
+    if (*smbc_ctx == NULL) {
+        ret = gpo_child_smbc_init(smbc_ctx);
+        if (ret != EOK) {
+            return ret;
+        }
+    }
+
+    ret = gpo_child_process(mem_ctx, *smbc_ctx, req_buf, req_len, &resp);
+    if (ret != EOK) {
+        return ret;
+    }
+
+    *_reply = resp->buf;
+    *_reply_len = resp->size;
+    return EOK;
+}
+
 int
 main(int argc, const char *argv[])
 {
@@ -688,14 +773,13 @@ main(int argc, const char *argv[])
     poptContext pc;
     int debug_fd = -1;
     errno_t ret;
-    int sysvol_gpt_version;
-    int result;
     TALLOC_CTX *main_ctx = NULL;
     uint8_t *buf = NULL;
     ssize_t len = 0;
-    struct input_buffer *ibuf = NULL;
+    SMBCCTX *smbc_ctx = NULL;
     struct response *resp = NULL;
     ssize_t written;
+    int worker = 0;
 
     struct poptOption long_options[] = {
         POPT_AUTOHELP
@@ -710,6 +794,8 @@ main(int argc, const char *argv[])
         {"debug-to-stderr", 0, POPT_ARG_NONE | POPT_ARGFLAG_DOC_HIDDEN,
          &debug_to_stderr, 0,
          _("Send the debug output to stderr directly."), NULL },
+        {"worker", 0, POPT_ARG_NONE, &worker, 0,
+         _("Serve framed requests until the input is closed"), NULL},
         POPT_TABLEEND
     };
 
@@ -746,6 +832,11 @@ main(int argc, const char *argv[])
 
     DEBUG(SSSDBG_TRACE_FUNC, "gpo_child started.\n");
 
+    if (worker) {
+        sss_child_worker("gpo_child", STDIN_FILENO, AD_GPO_CHILD_OUT_FILENO,
+                         gpo_child_worker_handler, &smbc_ctx);
+    }
+
     main_ctx = talloc_new(NULL);
     if (main_ctx == NULL) {
         DEBUG(SSSDBG_CRIT_FAILURE, "talloc_new failed.\n");
@@ -760,12 +851,6 @@ main(int argc, const char *argv[])
         goto fail;
     }
 
-    ibuf = talloc_zero(main_ctx, struct input_buffer);
-    if (ibuf == NULL) {
-        DEBUG(SSSDBG_CRIT_FAILURE, "talloc_zero failed.\n");
-        goto fail;
-    }
-
     DEBUG(SSSDBG_TRACE_FUNC, "context initialized\n");
 
     errno = 0;
@@ -778,32 +863,14 @@ main(int argc, const char *argv[])
 
     close(STDIN_FILENO);
 
-    ret = unpack_buffer(buf, len, ibuf);
+    ret = gpo_child_smbc_init(&smbc_ctx);
     if (ret != EOK) {
-        DEBUG(SSSDBG_CRIT_FAILURE,
-              "unpack_buffer failed.[%d][%s].\n", ret, strerror(ret));
-        goto fail;
-    }
-
-    DEBUG(SSSDBG_TRACE_FUNC, "performing smb operations\n");
-
-    result = perform_smb_operations(ibuf->cached_gpt_version,
-                                    ibuf->smb_server,
-                                    ibuf->smb_share,
-                                    ibuf->smb_path,
-                                    ibuf->smb_cse_suffix,
-                                    &sysvol_gpt_version);
-    if (result != EOK) {
-        DEBUG(SSSDBG_CRIT_FAILURE,
-              "perform_smb_operations failed.[%d][%s].\n",
-              result, strerror(result));
         goto fail;
     }
 
-    ret = prepare_response(main_ctx, sysvol_gpt_version, result, &resp);
+    ret = gpo_child_process(main_ctx, smbc_ctx, buf, len, &resp);
+    smbc_free_context(smbc_ctx, 0);
     if (ret != EOK) {
-        DEBUG(SSSDBG_CRIT_FAILURE, "prepare_response failed. [%d][%s].\n",
-                    ret, strerror(ret));
         goto fail;
     }
 
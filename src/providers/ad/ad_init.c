@@ -31,6 +31,7 @@
 #include "util/util.h"
 #include "providers/ad/ad_common.h"
 #include "providers/ad/ad_access.h"
+#include "providers/ad/ad_gpo.h"
 #include "providers/ldap/ldap_common.h"
 #include "providers/ldap/sdap_access.h"
 #include "providers/ldap/sdap_idmap.h"
@@ -199,8 +200,9 @@ static errno_t ad_init_srv_plugin(struct be_ctx *be_ctx,
         return EOK;
     }
 
-    srv_ctx = ad_srv_plugin_ctx_init(be_ctx, be_ctx->be_res,
+    srv_ctx = ad_srv_plugin_ctx_init(be_ctx, be_ctx,
                                      default_host_dbs, ad_options->id,
+                                     ad_options->basic,
                                      hostname, ad_domain,
                                      ad_site_override);
     if (srv_ctx == NULL) {
@@ -390,7 +392,7 @@ static errno_t ad_init_misc(struct be_ctx *be_ctx,
 
     sdap_id_ctx->opts->sdom->pvt = ad_id_ctx;
 
-    ret = sdap_setup_child();
+    ret = sdap_setup_child(be_ctx, be_ctx->ev, sdap_id_ctx->opts);
     if (ret != EOK) {
         DEBUG(SSSDBG_CRIT_FAILURE, "sdap_setup_child() failed [%d]: %s\n",
               ret, sss_strerror(ret));
@@ -546,6 +548,7 @@ errno_t sssm_ad_access_init(TALLOC_CTX *mem_ctx,
 {
     struct ad_init_ctx *init_ctx;
     struct ad_access_ctx *access_ctx;
+    int gpo_result_cache_interval;
     errno_t ret;
 
     init_ctx = talloc_get_type(module_data, struct ad_init_ctx);
@@ -579,6 +582,19 @@ errno_t sssm_ad_access_init(TALLOC_CTX *mem_ctx,
         goto done;
     }
 
+    gpo_result_cache_interval = dp_opt_get_int(access_ctx->ad_options,
+                                               AD_GPO_RESULT_CACHE_INTERVAL);
+    if (access_ctx->gpo_access_control_mode != GPO_ACCESS_CONTROL_DISABLED
+            && gpo_result_cache_interval > 0) {
+        ret = ad_gpo_result_cache_init(be_ctx, access_ctx,
+                                       gpo_result_cache_interval);
+        if (ret != EOK) {
+            DEBUG(SSSDBG_CRIT_FAILURE, "Could not initialize GPO result "
+                  "cache [%d]: %s\n", ret, sss_strerror(ret));
+            goto done;
+        }
+    }
+
     dp_set_method(dp_methods, DPM_ACCESS_HANDLER,
                   ad_pam_access_handler_send, ad_pam_access_handler_recv, access_ctx,
                   struct ad_access_ctx, struct pam_data, struct pam_data *);
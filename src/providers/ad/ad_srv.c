@@ -28,6 +28,7 @@
 #include "util/sss_ldap.h"
 #include "resolv/async_resolv.h"
 #include "providers/backend.h"
+#include "providers/be_ptask.h"
 #include "providers/ad/ad_srv.h"
 #include "providers/ad/ad_common.h"
 #include "providers/fail_over.h"
@@ -230,118 +231,80 @@ static int ad_get_dc_servers_recv(TALLOC_CTX *mem_ctx,
     return EOK;
 }
 
-struct ad_get_client_site_state {
+/* Netlogon ping of a single domain controller. The round trip time of the
+ * netlogon search is reported together with the site and forest name. */
+struct ad_netlogon_ping_state {
     struct tevent_context *ev;
-    struct be_resolv_ctx *be_res;
-    enum host_database *host_db;
     struct sdap_options *opts;
     const char *ad_domain;
-    struct fo_server_info *dcs;
-    size_t num_dcs;
-    size_t dc_index;
-    struct fo_server_info dc;
+    char *host;
+    int port;
 
     struct sdap_handle *sh;
+    struct timeval start;
+    uint64_t rtt;
     char *site;
     char *forest;
 };
 
-static errno_t ad_get_client_site_next_dc(struct tevent_req *req);
-static void ad_get_client_site_connect_done(struct tevent_req *subreq);
-static void ad_get_client_site_done(struct tevent_req *subreq);
-
-struct tevent_req *ad_get_client_site_send(TALLOC_CTX *mem_ctx,
-                                           struct tevent_context *ev,
-                                           struct be_resolv_ctx *be_res,
-                                           enum host_database *host_db,
-                                           struct sdap_options *opts,
-                                           const char *ad_domain,
-                                           struct fo_server_info *dcs,
-                                           size_t num_dcs)
+static void ad_netlogon_ping_connect_done(struct tevent_req *subreq);
+static void ad_netlogon_ping_done(struct tevent_req *subreq);
+
+static struct tevent_req *
+ad_netlogon_ping_send(TALLOC_CTX *mem_ctx,
+                      struct tevent_context *ev,
+                      struct be_resolv_ctx *be_res,
+                      enum host_database *host_db,
+                      struct sdap_options *opts,
+                      const char *ad_domain,
+                      const char *host,
+                      int port)
 {
-    struct ad_get_client_site_state *state = NULL;
+    struct ad_netlogon_ping_state *state = NULL;
     struct tevent_req *req = NULL;
+    struct tevent_req *subreq = NULL;
     errno_t ret;
 
     req = tevent_req_create(mem_ctx, &state,
-                            struct ad_get_client_site_state);
+                            struct ad_netlogon_ping_state);
     if (req == NULL) {
         DEBUG(SSSDBG_CRIT_FAILURE, "tevent_req_create() failed\n");
         return NULL;
     }
 
-    if (be_res == NULL || host_db == NULL || opts == NULL) {
-        ret = EINVAL;
-        goto immediately;
-    }
-
     state->ev = ev;
-    state->be_res = be_res;
-    state->host_db = host_db;
     state->opts = opts;
     state->ad_domain = ad_domain;
-    state->dcs = dcs;
-    state->num_dcs = num_dcs;
+    state->port = port;
 
-    state->dc_index = 0;
-    ret = ad_get_client_site_next_dc(req);
-    if (ret == EOK) {
-        ret = ENOENT;
+    state->host = talloc_strdup(state, host);
+    if (state->host == NULL) {
+        ret = ENOMEM;
         goto immediately;
-    } else if (ret != EAGAIN) {
+    }
+
+    subreq = sdap_connect_host_send(state, ev, opts, be_res->resolv,
+                                    be_res->family_order, host_db, "ldap",
+                                    host, port, false);
+    if (subreq == NULL) {
+        ret = ENOMEM;
         goto immediately;
     }
 
+    tevent_req_set_callback(subreq, ad_netlogon_ping_connect_done, req);
+
     return req;
 
 immediately:
-    if (ret == EOK) {
-        tevent_req_done(req);
-    } else {
-        tevent_req_error(req, ret);
-    }
+    tevent_req_error(req, ret);
     tevent_req_post(req, ev);
 
     return req;
 }
 
-static errno_t ad_get_client_site_next_dc(struct tevent_req *req)
+static void ad_netlogon_ping_connect_done(struct tevent_req *subreq)
 {
-    struct ad_get_client_site_state *state = NULL;
-    struct tevent_req *subreq = NULL;
-    errno_t ret;
-
-    state = tevent_req_data(req, struct ad_get_client_site_state);
-
-    if (state->dc_index >= state->num_dcs) {
-        ret = EOK;
-        goto done;
-    }
-
-    state->dc = state->dcs[state->dc_index];
-
-    subreq = sdap_connect_host_send(state, state->ev, state->opts,
-                                    state->be_res->resolv,
-                                    state->be_res->family_order,
-                                    state->host_db, "ldap", state->dc.host,
-                                    state->dc.port, false);
-    if (subreq == NULL) {
-        ret = ENOMEM;
-        goto done;
-    }
-
-    tevent_req_set_callback(subreq, ad_get_client_site_connect_done, req);
-
-    state->dc_index++;
-    ret = EAGAIN;
-
-done:
-    return ret;
-}
-
-static void ad_get_client_site_connect_done(struct tevent_req *subreq)
-{
-    struct ad_get_client_site_state *state = NULL;
+    struct ad_netlogon_ping_state *state = NULL;
     struct tevent_req *req = NULL;
     static const char *attrs[] = {AD_AT_NETLOGON, NULL};
     char *filter = NULL;
@@ -349,19 +312,13 @@ static void ad_get_client_site_connect_done(struct tevent_req *subreq)
     errno_t ret;
 
     req = tevent_req_callback_data(subreq, struct tevent_req);
-    state = tevent_req_data(req, struct ad_get_client_site_state);
+    state = tevent_req_data(req, struct ad_netlogon_ping_state);
 
     ret = sdap_connect_host_recv(state, subreq, &state->sh);
     talloc_zfree(subreq);
     if (ret != EOK) {
         DEBUG(SSSDBG_MINOR_FAILURE, "Unable to connect to domain controller "
-              "[%s:%d]\n", state->dc.host, state->dc.port);
-
-        ret = ad_get_client_site_next_dc(req);
-        if (ret == EOK) {
-            ret = ENOENT;
-        }
-
+              "[%s:%d]\n", state->host, state->port);
         goto done;
     }
 
@@ -380,6 +337,10 @@ static void ad_get_client_site_connect_done(struct tevent_req *subreq)
         goto done;
     }
 
+    /* Only the netlogon search itself is timed so that the round trip time
+     * is not skewed by name resolution and connection setup. */
+    state->start = tevent_timeval_current();
+
     subreq = sdap_get_generic_send(state, state->ev, state->opts, state->sh,
                                    "", LDAP_SCOPE_BASE, filter,
                                    attrs, NULL, 0,
@@ -391,7 +352,7 @@ static void ad_get_client_site_connect_done(struct tevent_req *subreq)
         goto done;
     }
 
-    tevent_req_set_callback(subreq, ad_get_client_site_done, req);
+    tevent_req_set_callback(subreq, ad_netlogon_ping_done, req);
 
     ret = EAGAIN;
 
@@ -405,34 +366,41 @@ done:
     return;
 }
 
-static void ad_get_client_site_done(struct tevent_req *subreq)
+static void ad_netlogon_ping_done(struct tevent_req *subreq)
 {
-    struct ad_get_client_site_state *state = NULL;
+    struct ad_netlogon_ping_state *state = NULL;
     struct tevent_req *req = NULL;
     struct sysdb_attrs **reply = NULL;
+    struct timeval now;
+    struct timeval elapsed;
     size_t reply_count;
     errno_t ret;
 
     req = tevent_req_callback_data(subreq, struct tevent_req);
-    state = tevent_req_data(req, struct ad_get_client_site_state);
+    state = tevent_req_data(req, struct ad_netlogon_ping_state);
 
     ret = sdap_get_generic_recv(subreq, state, &reply_count, &reply);
     talloc_zfree(subreq);
 
+    now = tevent_timeval_current();
+    elapsed = tevent_timeval_until(&state->start, &now);
+    state->rtt = (uint64_t) elapsed.tv_sec * 1000000 + elapsed.tv_usec;
+    if (state->rtt == 0) {
+        /* zero means unknown */
+        state->rtt = 1;
+    }
+
     /* we're done with this LDAP, close connection */
     talloc_zfree(state->sh);
     if (ret != EOK) {
-        DEBUG(SSSDBG_OP_FAILURE, "Unable to get netlogon information\n");
-
-        ret = ad_get_client_site_next_dc(req);
-        if (ret == EOK) {
-            ret = ENOENT;
-        }
+        DEBUG(SSSDBG_OP_FAILURE, "Unable to get netlogon information "
+              "from [%s]\n", state->host);
         goto done;
     }
 
     if (reply_count == 0) {
-        DEBUG(SSSDBG_OP_FAILURE, "No netlogon information retrieved\n");
+        DEBUG(SSSDBG_OP_FAILURE, "No netlogon information retrieved "
+              "from [%s]\n", state->host);
         ret = ENOENT;
         goto done;
     }
@@ -446,8 +414,8 @@ static void ad_get_client_site_done(struct tevent_req *subreq)
         goto done;
     }
 
-    DEBUG(SSSDBG_TRACE_FUNC, "Found site: %s\n", state->site);
-    DEBUG(SSSDBG_TRACE_FUNC, "Found forest: %s\n", state->forest);
+    DEBUG(SSSDBG_TRACE_INTERNAL, "Domain controller [%s] answered in "
+          "%"PRIu64" us\n", state->host, state->rtt);
 
 done:
     if (ret != EOK) {
@@ -458,10 +426,216 @@ done:
     tevent_req_done(req);
 }
 
+static errno_t ad_netlogon_ping_recv(TALLOC_CTX *mem_ctx,
+                                     struct tevent_req *req,
+                                     char **_site,
+                                     char **_forest,
+                                     uint64_t *_rtt)
+{
+    struct ad_netlogon_ping_state *state = NULL;
+    state = tevent_req_data(req, struct ad_netlogon_ping_state);
+
+    TEVENT_REQ_RETURN_ON_ERROR(req);
+
+    if (_site != NULL) {
+        *_site = talloc_steal(mem_ctx, state->site);
+    }
+
+    if (_forest != NULL) {
+        *_forest = talloc_steal(mem_ctx, state->forest);
+    }
+
+    if (_rtt != NULL) {
+        *_rtt = state->rtt;
+    }
+
+    return EOK;
+}
+
+/* Netlogon pings are sent to up to ping_count domain controllers at once.
+ * When a ping fails, the next domain controller from the list is tried and
+ * the first valid answer wins, the remaining pings are cancelled. */
+struct ad_get_client_site_state {
+    struct tevent_context *ev;
+    struct be_resolv_ctx *be_res;
+    enum host_database *host_db;
+    struct sdap_options *opts;
+    const char *ad_domain;
+    struct fo_server_info *dcs;
+    size_t num_dcs;
+    size_t dc_index;
+    size_t num_pending;
+    TALLOC_CTX *pings;
+
+    char *host;
+    uint64_t rtt;
+    char *site;
+    char *forest;
+};
+
+static errno_t ad_get_client_site_next_dc(struct tevent_req *req);
+static void ad_get_client_site_done(struct tevent_req *subreq);
+
+struct tevent_req *ad_get_client_site_send(TALLOC_CTX *mem_ctx,
+                                           struct tevent_context *ev,
+                                           struct be_resolv_ctx *be_res,
+                                           enum host_database *host_db,
+                                           struct sdap_options *opts,
+                                           const char *ad_domain,
+                                           struct fo_server_info *dcs,
+                                           size_t num_dcs,
+                                           size_t ping_count)
+{
+    struct ad_get_client_site_state *state = NULL;
+    struct tevent_req *req = NULL;
+    size_t i;
+    errno_t ret;
+
+    req = tevent_req_create(mem_ctx, &state,
+                            struct ad_get_client_site_state);
+    if (req == NULL) {
+        DEBUG(SSSDBG_CRIT_FAILURE, "tevent_req_create() failed\n");
+        return NULL;
+    }
+
+    if (be_res == NULL || host_db == NULL || opts == NULL) {
+        ret = EINVAL;
+        goto immediately;
+    }
+
+    state->ev = ev;
+    state->be_res = be_res;
+    state->host_db = host_db;
+    state->opts = opts;
+    state->ad_domain = ad_domain;
+    state->dcs = dcs;
+    state->num_dcs = num_dcs;
+
+    state->pings = talloc_new(state);
+    if (state->pings == NULL) {
+        ret = ENOMEM;
+        goto immediately;
+    }
+
+    if (ping_count == 0) {
+        ping_count = 1;
+    }
+
+    state->dc_index = 0;
+    for (i = 0; i < ping_count; i++) {
+        ret = ad_get_client_site_next_dc(req);
+        if (ret == EOK) {
+            break;
+        } else if (ret != EAGAIN) {
+            goto immediately;
+        }
+    }
+
+    if (state->num_pending == 0) {
+        ret = ENOENT;
+        goto immediately;
+    }
+
+    return req;
+
+immediately:
+    if (ret == EOK) {
+        tevent_req_done(req);
+    } else {
+        tevent_req_error(req, ret);
+    }
+    tevent_req_post(req, ev);
+
+    return req;
+}
+
+static errno_t ad_get_client_site_next_dc(struct tevent_req *req)
+{
+    struct ad_get_client_site_state *state = NULL;
+    struct tevent_req *subreq = NULL;
+    struct fo_server_info *dc = NULL;
+    errno_t ret;
+
+    state = tevent_req_data(req, struct ad_get_client_site_state);
+
+    if (state->dc_index >= state->num_dcs) {
+        ret = EOK;
+        goto done;
+    }
+
+    dc = &state->dcs[state->dc_index];
+
+    subreq = ad_netlogon_ping_send(state->pings, state->ev, state->be_res,
+                                   state->host_db, state->opts,
+                                   state->ad_domain, dc->host, dc->port);
+    if (subreq == NULL) {
+        ret = ENOMEM;
+        goto done;
+    }
+
+    tevent_req_set_callback(subreq, ad_get_client_site_done, req);
+
+    state->dc_index++;
+    state->num_pending++;
+    ret = EAGAIN;
+
+done:
+    return ret;
+}
+
+static void ad_get_client_site_done(struct tevent_req *subreq)
+{
+    struct ad_get_client_site_state *state = NULL;
+    struct ad_netlogon_ping_state *ping = NULL;
+    struct tevent_req *req = NULL;
+    errno_t ret;
+
+    req = tevent_req_callback_data(subreq, struct tevent_req);
+    state = tevent_req_data(req, struct ad_get_client_site_state);
+    ping = tevent_req_data(subreq, struct ad_netlogon_ping_state);
+
+    state->num_pending--;
+
+    ret = ad_netlogon_ping_recv(state, subreq, &state->site, &state->forest,
+                                &state->rtt);
+    if (ret == EOK) {
+        state->host = talloc_steal(state, ping->host);
+    }
+    talloc_zfree(subreq);
+    if (ret != EOK) {
+        ret = ad_get_client_site_next_dc(req);
+        if (ret == EOK && state->num_pending == 0) {
+            ret = ENOENT;
+        } else if (ret == EOK) {
+            /* wait for the pings that are still running */
+            ret = EAGAIN;
+        }
+        goto done;
+    }
+
+    /* cancel the other pings, the first answer wins */
+    talloc_zfree(state->pings);
+    state->num_pending = 0;
+
+    DEBUG(SSSDBG_TRACE_FUNC, "Found site: %s\n", state->site);
+    DEBUG(SSSDBG_TRACE_FUNC, "Found forest: %s\n", state->forest);
+
+done:
+    if (ret == EOK) {
+        tevent_req_done(req);
+    } else if (ret != EAGAIN) {
+        tevent_req_error(req, ret);
+    }
+
+    return;
+}
+
 int ad_get_client_site_recv(TALLOC_CTX *mem_ctx,
                             struct tevent_req *req,
                             const char **_site,
-                            const char **_forest)
+                            const char **_forest,
+                            const char **_host,
+                            uint64_t *_rtt)
 {
     struct ad_get_client_site_state *state = NULL;
     state = tevent_req_data(req, struct ad_get_client_site_state);
@@ -471,35 +645,63 @@ int ad_get_client_site_recv(TALLOC_CTX *mem_ctx,
     *_site = talloc_steal(mem_ctx, state->site);
     *_forest = talloc_steal(mem_ctx, state->forest);
 
+    if (_host != NULL) {
+        *_host = talloc_steal(mem_ctx, state->host);
+    }
+
+    if (_rtt != NULL) {
+        *_rtt = state->rtt;
+    }
+
     return EOK;
 }
 
+/* Round trip times observed when pinging the domain controllers, kept in
+ * microseconds, zero means that the round trip time is not known. */
+struct ad_srv_rtt {
+    char *host;
+    int port;
+    uint64_t rtt;
+};
+
 struct ad_srv_plugin_ctx {
+    struct be_ctx *be_ctx;
     struct be_resolv_ctx *be_res;
     enum host_database *host_dbs;
     struct sdap_options *opts;
     const char *hostname;
     const char *ad_domain;
     const char *ad_site_override;
+
+    size_t ping_count;
+    time_t ping_refresh_interval;
+    struct be_ptask *ping_refresh_task;
+    char *ping_domain;
+    struct ad_srv_rtt *rtts;
+    size_t num_rtts;
 };
 
 struct ad_srv_plugin_ctx *
 ad_srv_plugin_ctx_init(TALLOC_CTX *mem_ctx,
-                       struct be_resolv_ctx *be_res,
+                       struct be_ctx *be_ctx,
                        enum host_database *host_dbs,
                        struct sdap_options *opts,
+                       struct dp_option *ad_opts,
                        const char *hostname,
                        const char *ad_domain,
                        const char *ad_site_override)
 {
     struct ad_srv_plugin_ctx *ctx = NULL;
+    int ping_count;
+    int refresh_interval;
 
     ctx = talloc_zero(mem_ctx, struct ad_srv_plugin_ctx);
     if (ctx == NULL) {
         return NULL;
     }
 
-    ctx->be_res = be_res;
+    ctx->be_ctx = be_ctx;
+    ctx->be_res = be_ctx->be_res;
     ctx->host_dbs = host_dbs;
     ctx->opts = opts;
 
@@ -520,6 +722,12 @@ ad_srv_plugin_ctx_init(TALLOC_CTX *mem_ctx,
         }
     }
 
+    ping_count = dp_opt_get_int(ad_opts, AD_SITE_PING_COUNT);
+    ctx->ping_count = ping_count > 0 ? ping_count : 1;
+
+    refresh_interval = dp_opt_get_int(ad_opts, AD_SITE_PING_REFRESH_INTERVAL);
+    ctx->ping_refresh_interval = refresh_interval > 0 ? refresh_interval : 0;
+
     return ctx;
 
 fail:
@@ -527,6 +735,338 @@ fail:
     return NULL;
 }
 
+static uint64_t ad_srv_rtt_get(struct ad_srv_plugin_ctx *ctx,
+                               const char *host)
+{
+    size_t i;
+
+    for (i = 0; i < ctx->num_rtts; i++) {
+        if (strcasecmp(ctx->rtts[i].host, host) == 0) {
+            return ctx->rtts[i].rtt;
+        }
+    }
+
+    return 0;
+}
+
+static void ad_srv_rtt_set(struct ad_srv_plugin_ctx *ctx,
+                           const char *host,
+                           uint64_t rtt)
+{
+    size_t i;
+
+    for (i = 0; i < ctx->num_rtts; i++) {
+        if (strcasecmp(ctx->rtts[i].host, host) == 0) {
+            ctx->rtts[i].rtt = rtt;
+            return;
+        }
+    }
+}
+
+/* The cache follows the list of primary servers, round trip times of hosts
+ * that are no longer listed are dropped. */
+static errno_t ad_srv_rtt_update_hosts(struct ad_srv_plugin_ctx *ctx,
+                                       const char *domain,
+                                       struct fo_server_info *srv,
+                                       size_t num)
+{
+    struct ad_srv_rtt *rtts = NULL;
+    char *ping_domain = NULL;
+    size_t num_rtts = 0;
+    size_t i, j;
+
+    rtts = talloc_zero_array(ctx, struct ad_srv_rtt, num);
+    if (rtts == NULL) {
+        return ENOMEM;
+    }
+
+    for (i = 0; i < num; i++) {
+        for (j = 0; j < num_rtts; j++) {
+            if (strcasecmp(rtts[j].host, srv[i].host) == 0) {
+                break;
+            }
+        }
+
+        if (j < num_rtts) {
+            /* duplicate */
+            continue;
+        }
+
+        rtts[num_rtts].host = talloc_strdup(rtts, srv[i].host);
+        if (rtts[num_rtts].host == NULL) {
+            talloc_free(rtts);
+            return ENOMEM;
+        }
+
+        rtts[num_rtts].port = srv[i].port;
+        rtts[num_rtts].rtt = ad_srv_rtt_get(ctx, srv[i].host);
+        num_rtts++;
+    }
+
+    ping_domain = talloc_strdup(ctx, domain);
+    if (ping_domain == NULL) {
+        talloc_free(rtts);
+        return ENOMEM;
+    }
+
+    talloc_free(ctx->rtts);
+    ctx->rtts = rtts;
+    ctx->num_rtts = num_rtts;
+
+    talloc_free(ctx->ping_domain);
+    ctx->ping_domain = ping_domain;
+
+    return EOK;
+}
+
+/* Returns true if a should be tried after b. Servers with known round trip
+ * time are preferred over the ones that were not measured yet. */
+static bool ad_srv_rtt_is_slower(uint64_t a, uint64_t b)
+{
+    if (a == 0) {
+        return false;
+    }
+
+    if (b == 0) {
+        return true;
+    }
+
+    return a > b;
+}
+
+/* Stable sort of servers of the same priority by their round trip time, the
+ * order set by ad_sort_servers_by_dns() is kept for servers with the same or
+ * unknown round trip time. */
+static errno_t ad_sort_servers_by_rtt(struct ad_srv_plugin_ctx *ctx,
+                                      struct fo_server_info *srv,
+                                      size_t num)
+{
+    struct fo_server_info tmp;
+    uint64_t *rtts;
+    uint64_t tmp_rtt;
+    size_t i, j;
+
+    if (num <= 1) {
+        return EOK;
+    }
+
+    rtts = talloc_array(ctx, uint64_t, num);
+    if (rtts == NULL) {
+        return ENOMEM;
+    }
+
+    for (i = 0; i < num; i++) {
+        rtts[i] = ad_srv_rtt_get(ctx, srv[i].host);
+    }
+
+    for (i = 1; i < num; i++) {
+        for (j = i; j > 0; j--) {
+            if (srv[j - 1].priority != srv[j].priority
+                    || !ad_srv_rtt_is_slower(rtts[j - 1], rtts[j])) {
+                break;
+            }
+
+            tmp = srv[j - 1];
+            srv[j - 1] = srv[j];
+            srv[j] = tmp;
+
+            tmp_rtt = rtts[j - 1];
+            rtts[j - 1] = rtts[j];
+            rtts[j] = tmp_rtt;
+        }
+    }
+
+    talloc_free(rtts);
+    return EOK;
+}
+
+/* Background refresh of the round trip times of the primary servers. Like
+ * the site lookup, at most ping_count domain controllers are pinged at once,
+ * the next one is pinged when a ping finishes. The servers are copied so that
+ * a lookup which changes the cached list meanwhile does not affect the
+ * refresh. */
+struct ad_srv_ping_refresh_state {
+    struct tevent_context *ev;
+    struct ad_srv_plugin_ctx *ctx;
+    struct ad_srv_rtt *servers;
+    size_t num_servers;
+    size_t server_index;
+    size_t num_pending;
+};
+
+static errno_t ad_srv_ping_refresh_next(struct tevent_req *req);
+static void ad_srv_ping_refresh_done(struct tevent_req *subreq);
+
+static struct tevent_req *
+ad_srv_ping_refresh_send(TALLOC_CTX *mem_ctx,
+                         struct tevent_context *ev,
+                         struct be_ctx *be_ctx,
+                         struct be_ptask *be_ptask,
+                         void *pvt)
+{
+    struct ad_srv_ping_refresh_state *state = NULL;
+    struct ad_srv_plugin_ctx *ctx = NULL;
+    struct tevent_req *req = NULL;
+    size_t i;
+    errno_t ret;
+
+    req = tevent_req_create(mem_ctx, &state,
+                            struct ad_srv_ping_refresh_state);
+    if (req == NULL) {
+        DEBUG(SSSDBG_CRIT_FAILURE, "tevent_req_create() failed\n");
+        return NULL;
+    }
+
+    ctx = talloc_get_type(pvt, struct ad_srv_plugin_ctx);
+    if (ctx == NULL) {
+        ret = EINVAL;
+        goto immediately;
+    }
+
+    state->ev = ev;
+    state->ctx = ctx;
+
+    DEBUG(SSSDBG_TRACE_FUNC, "Refreshing round trip time of %zu domain "
+          "controllers\n", ctx->num_rtts);
+
+    state->servers = talloc_zero_array(state, struct ad_srv_rtt,
+                                       ctx->num_rtts);
+    if (state->servers == NULL) {
+        ret = ENOMEM;
+        goto immediately;
+    }
+
+    for (i = 0; i < ctx->num_rtts; i++) {
+        state->servers[i].host = talloc_strdup(state->servers,
+                                               ctx->rtts[i].host);
+        if (state->servers[i].host == NULL) {
+            ret = ENOMEM;
+            goto immediately;
+        }
+        state->servers[i].port = ctx->rtts[i].port;
+    }
+    state->num_servers = ctx->num_rtts;
+
+    for (i = 0; i < ctx->ping_count; i++) {
+        ret = ad_srv_ping_refresh_next(req);
+        if (ret == EOK) {
+            break;
+        } else if (ret != EAGAIN) {
+            goto immediately;
+        }
+    }
+
+    if (state->num_pending == 0) {
+        ret = EOK;
+        goto immediately;
+    }
+
+    return req;
+
+immediately:
+    if (ret == EOK) {
+        tevent_req_done(req);
+    } else {
+        tevent_req_error(req, ret);
+    }
+    tevent_req_post(req, ev);
+
+    return req;
+}
+
+/* Returns EAGAIN if a ping was sent and EOK if all servers were pinged. */
+static errno_t ad_srv_ping_refresh_next(struct tevent_req *req)
+{
+    struct ad_srv_ping_refresh_state *state = NULL;
+    struct tevent_req *subreq = NULL;
+    struct ad_srv_rtt *server = NULL;
+
+    state = tevent_req_data(req, struct ad_srv_ping_refresh_state);
+
+    if (state->server_index >= state->num_servers) {
+        return EOK;
+    }
+
+    server = &state->servers[state->server_index];
+
+    subreq = ad_netlogon_ping_send(state, state->ev, state->ctx->be_res,
+                                   state->ctx->host_dbs, state->ctx->opts,
+                                   state->ctx->ping_domain,
+                                   server->host, server->port);
+    if (subreq == NULL) {
+        return ENOMEM;
+    }
+
+    tevent_req_set_callback(subreq, ad_srv_ping_refresh_done, req);
+
+    state->server_index++;
+    state->num_pending++;
+
+    return EAGAIN;
+}
+
+static void ad_srv_ping_refresh_done(struct tevent_req *subreq)
+{
+    struct ad_srv_ping_refresh_state *state = NULL;
+    struct ad_netlogon_ping_state *ping = NULL;
+    struct tevent_req *req = NULL;
+    uint64_t rtt;
+    errno_t ret;
+
+    req = tevent_req_callback_data(subreq, struct tevent_req);
+    state = tevent_req_data(req, struct ad_srv_ping_refresh_state);
+    ping = tevent_req_data(subreq, struct ad_netlogon_ping_state);
+
+    ret = ad_netlogon_ping_recv(state, subreq, NULL, NULL, &rtt);
+    if (ret != EOK) {
+        /* unreachable servers are tried last */
+        rtt = 0;
+    }
+
+    ad_srv_rtt_set(state->ctx, ping->host, rtt);
+    talloc_zfree(subreq);
+    state->num_pending--;
+
+    ret = ad_srv_ping_refresh_next(req);
+    if (ret != EOK && ret != EAGAIN) {
+        DEBUG(SSSDBG_MINOR_FAILURE, "Unable to ping next domain controller "
+              "[%d]: %s\n", ret, sss_strerror(ret));
+        /* finish the pings that are still running */
+    }
+
+    if (state->num_pending == 0) {
+        tevent_req_done(req);
+    }
+}
+
+static errno_t ad_srv_ping_refresh_recv(struct tevent_req *req)
+{
+    TEVENT_REQ_RETURN_ON_ERROR(req);
+
+    return EOK;
+}
+
+static void ad_srv_ping_refresh_setup(struct ad_srv_plugin_ctx *ctx)
+{
+    time_t period = ctx->ping_refresh_interval;
+    errno_t ret;
+
+    if (period == 0 || ctx->ping_refresh_task != NULL) {
+        return;
+    }
+
+    ret = be_ptask_create(ctx, ctx->be_ctx, period, period, 0, 0, period,
+                          BE_PTASK_OFFLINE_DISABLE, 0,
+                          ad_srv_ping_refresh_send, ad_srv_ping_refresh_recv,
+                          ctx, "AD DC Round Trip Time Refresh",
+                          &ctx->ping_refresh_task);
+    if (ret != EOK) {
+        DEBUG(SSSDBG_MINOR_FAILURE, "Unable to setup ptask "
+              "[%d]: %s\n", ret, sss_strerror(ret));
+        /* Ignore, the round trip times are measured on the next lookup. */
+    }
+}
+
 struct ad_srv_plugin_state {
     struct tevent_context *ev;
     struct ad_srv_plugin_ctx *ctx;
@@ -538,6 +1078,8 @@ struct ad_srv_plugin_state {
     char *dns_domain;
     uint32_t ttl;
     const char *forest;
+    const char *ping_host;
+    uint64_t ping_rtt;
     struct fo_server_info *primary_servers;
     size_t num_primary_servers;
     struct fo_server_info *backup_servers;
@@ -550,13 +1092,16 @@ static void ad_srv_plugin_servers_done(struct tevent_req *subreq);
 
 /* 1. Do a DNS lookup to find any DC in domain
  *    _ldap._tcp.domain.name
- * 2. Send a CLDAP ping to the found DC to get the desirable site
+ * 2. Send a CLDAP ping to several of the found DCs at once and get the
+ *    desirable site from the first one that answers
  * 3. Do a DNS lookup to find SRV in the site (a)
  *    _service._protocol.site-name._sites.domain.name
  * 4. Do a DNS lookup to find global SRV records (b)
  *    _service._protocol.domain.name
  * 5. If the site is found, use (a) as primary and (b) as backup servers,
  *    otherwise use (b) as primary servers
+ * 6. Prefer primary servers with the lowest round trip time, the round trip
+ *    times are refreshed periodically in the background
  */
 struct tevent_req *ad_srv_plugin_send(TALLOC_CTX *mem_ctx,
                                        struct tevent_context *ev,
@@ -654,7 +1199,7 @@ static void ad_srv_plugin_dcs_done(struct tevent_req *subreq)
                                      state->ctx->host_dbs,
                                      state->ctx->opts,
                                      state->discovery_domain,
-                                     dcs, num_dcs);
+                                     dcs, num_dcs, state->ctx->ping_count);
     if (subreq == NULL) {
         ret = ENOMEM;
         goto done;
@@ -685,7 +1230,8 @@ static void ad_srv_plugin_site_done(struct tevent_req *subreq)
     req = tevent_req_callback_data(subreq, struct tevent_req);
     state = tevent_req_data(req, struct ad_srv_plugin_state);
 
-    ret = ad_get_client_site_recv(state, subreq, &state->site, &state->forest);
+    ret = ad_get_client_site_recv(state, subreq, &state->site, &state->forest,
+                                  &state->ping_host, &state->ping_rtt);
     talloc_zfree(subreq);
     /* Ignore AD site found by dns discovery if specific site is set in
      * configuration file. */
@@ -802,6 +1348,29 @@ static void ad_srv_plugin_servers_done(struct tevent_req *subreq)
         /* continue */
     }
 
+    ret = ad_srv_rtt_update_hosts(state->ctx, state->discovery_domain,
+                                  state->primary_servers,
+                                  state->num_primary_servers);
+    if (ret != EOK) {
+        DEBUG(SSSDBG_MINOR_FAILURE, "Unable to update round trip times "
+              "[%d]: %s\n", ret, sss_strerror(ret));
+        /* continue */
+    }
+
+    if (state->ping_host != NULL) {
+        ad_srv_rtt_set(state->ctx, state->ping_host, state->ping_rtt);
+    }
+
+    ret = ad_sort_servers_by_rtt(state->ctx, state->primary_servers,
+                                 state->num_primary_servers);
+    if (ret != EOK) {
+        DEBUG(SSSDBG_MINOR_FAILURE, "Unable to sort primary servers by round "
+              "trip time [%d]: %s\n", ret, sss_strerror(ret));
+        /* continue */
+    }
+
+    ad_srv_ping_refresh_setup(state->ctx);
+
     ret = ad_sort_servers_by_dns(state, state->discovery_domain,
                                  &state->backup_servers,
                                  state->num_backup_servers);
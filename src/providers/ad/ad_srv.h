@@ -25,9 +25,10 @@ struct ad_srv_plugin_ctx;
 
 struct ad_srv_plugin_ctx *
 ad_srv_plugin_ctx_init(TALLOC_CTX *mem_ctx,
-                       struct be_resolv_ctx *be_res,
+                       struct be_ctx *be_ctx,
                        enum host_database *host_dbs,
                        struct sdap_options *opts,
+                       struct dp_option *ad_opts,
                        const char *hostname,
                        const char *ad_domain,
                        const char *ad_site_override);
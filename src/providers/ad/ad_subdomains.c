@@ -208,9 +208,10 @@ ad_subdom_ad_ctx_new(struct be_ctx *be_ctx,
     ad_options->id_ctx = ad_id_ctx;
 
     /* use AD plugin */
-    srv_ctx = ad_srv_plugin_ctx_init(be_ctx, be_ctx->be_res,
+    srv_ctx = ad_srv_plugin_ctx_init(be_ctx, be_ctx,
                                      default_host_dbs,
                                      ad_id_ctx->ad_options->id,
+                                     ad_id_ctx->ad_options->basic,
                                      hostname,
                                      ad_domain,
                                      ad_site_override);
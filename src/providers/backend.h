@@ -158,6 +158,8 @@ int be_fo_service_add_callback(TALLOC_CTX *memctx,
                                struct be_ctx *ctx, const char *service_name,
                                be_svc_callback_fn_t *fn, void *private_data);
 int be_fo_get_server_count(struct be_ctx *ctx, const char *service_name);
+int be_fo_set_service_probe(struct be_ctx *ctx, const char *service_name,
+                            int default_port);
 
 void be_fo_set_srv_lookup_plugin(struct be_ctx *ctx,
                                  fo_srv_lookup_plugin_send_t send_fn,
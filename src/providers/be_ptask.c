@@ -94,10 +94,50 @@ static void be_ptask_timeout(struct tevent_context *ev,
     DEBUG(SSSDBG_OP_FAILURE, "Task [%s]: timed out\n", task->name);
 
     talloc_zfree(task->req);
+    talloc_zfree(task->dp_slot);
     be_ptask_schedule(task, BE_PTASK_PERIOD, BE_PTASK_SCHEDULE_FROM_NOW);
 }
 
 static void be_ptask_done(struct tevent_req *req);
+static void be_ptask_slot_done(struct tevent_req *req);
+
+static void be_ptask_run(struct be_ptask *task)
+{
+    struct tevent_timer *timeout = NULL;
+    struct timeval tv;
+
+    task->req = task->send_fn(task, task->ev, task->be_ctx, task, task->pvt);
+    if (task->req == NULL) {
+        /* skip this iteration and try again later */
+        DEBUG(SSSDBG_OP_FAILURE, "Task [%s]: failed to execute task, "
+              "will try again later\n", task->name);
+
+        talloc_zfree(task->dp_slot);
+        be_ptask_schedule(task, BE_PTASK_PERIOD, BE_PTASK_SCHEDULE_FROM_NOW);
+        return;
+    }
+
+    tevent_req_set_callback(task->req, be_ptask_done, task);
+
+    /* schedule timeout */
+    if (task->timeout > 0) {
+        tv = tevent_timeval_current_ofs(task->timeout, 0);
+        timeout = tevent_add_timer(task->ev, task->req, tv,
+                                   be_ptask_timeout, task);
+        if (timeout == NULL) {
+            /* If we can't guarantee a timeout,
+             * we need to cancel the request. */
+            talloc_zfree(task->req);
+            talloc_zfree(task->dp_slot);
+
+            DEBUG(SSSDBG_OP_FAILURE, "Task [%s]: failed to set timeout, "
+                  "the task will be rescheduled\n", task->name);
+
+            be_ptask_schedule(task, BE_PTASK_PERIOD,
+                              BE_PTASK_SCHEDULE_FROM_NOW);
+        }
+    }
+}
 
 static void be_ptask_execute(struct tevent_context *ev,
                              struct tevent_timer *tt,
@@ -105,7 +145,6 @@ static void be_ptask_execute(struct tevent_context *ev,
                              void *pvt)
 {
     struct be_ptask *task = NULL;
-    struct tevent_timer *timeout = NULL;
 
     task = talloc_get_type(pvt, struct be_ptask);
     task->timer = NULL; /* timer is freed by tevent */
@@ -134,37 +173,46 @@ static void be_ptask_execute(struct tevent_context *ev,
 
     task->last_execution = tv.tv_sec;
 
-    task->req = task->send_fn(task, task->ev, task->be_ctx, task, task->pvt);
+    if (task->dp_target == DP_TARGET_SENTINEL
+            || task->be_ctx->provider == NULL) {
+        be_ptask_run(task);
+        return;
+    }
+
+    /* Wait until the scheduler lets us in so the task does not compete
+     * with requests from responders over the target's request limit. */
+    task->req = dp_sched_background_send(task, task->be_ctx->provider,
+                                         task->dp_target);
     if (task->req == NULL) {
-        /* skip this iteration and try again later */
-        DEBUG(SSSDBG_OP_FAILURE, "Task [%s]: failed to execute task, "
+        DEBUG(SSSDBG_OP_FAILURE, "Task [%s]: failed to request a slot, "
               "will try again later\n", task->name);
 
         be_ptask_schedule(task, BE_PTASK_PERIOD, BE_PTASK_SCHEDULE_FROM_NOW);
         return;
     }
 
-    tevent_req_set_callback(task->req, be_ptask_done, task);
+    tevent_req_set_callback(task->req, be_ptask_slot_done, task);
+}
 
-    /* schedule timeout */
-    if (task->timeout > 0) {
-        tv = tevent_timeval_current_ofs(task->timeout, 0);
-        timeout = tevent_add_timer(task->ev, task->req, tv,
-                                   be_ptask_timeout, task);
-        if (timeout == NULL) {
-            /* If we can't guarantee a timeout,
-             * we need to cancel the request. */
-            talloc_zfree(task->req);
+static void be_ptask_slot_done(struct tevent_req *req)
+{
+    struct be_ptask *task = NULL;
+    errno_t ret;
 
-            DEBUG(SSSDBG_OP_FAILURE, "Task [%s]: failed to set timeout, "
-                  "the task will be rescheduled\n", task->name);
+    task = tevent_req_callback_data(req, struct be_ptask);
 
-            be_ptask_schedule(task, BE_PTASK_PERIOD,
-                              BE_PTASK_SCHEDULE_FROM_NOW);
-        }
+    ret = dp_sched_background_recv(task, req, &task->dp_slot);
+    talloc_zfree(req);
+    task->req = NULL;
+    if (ret != EOK) {
+        DEBUG(SSSDBG_OP_FAILURE, "Task [%s]: unable to get a slot [%d]: %s\n",
+              task->name, ret, sss_strerror(ret));
+
+        be_ptask_schedule(task, BE_PTASK_PERIOD, BE_PTASK_SCHEDULE_FROM_NOW);
+        return;
     }
 
-    return;
+    be_ptask_run(task);
 }
 
 static void be_ptask_done(struct tevent_req *req)
@@ -177,6 +225,7 @@ static void be_ptask_done(struct tevent_req *req)
     ret = task->recv_fn(req);
     talloc_zfree(req);
     task->req = NULL;
+    talloc_zfree(task->dp_slot);
     switch (ret) {
     case EOK:
         DEBUG(SSSDBG_TRACE_FUNC, "Task [%s]: finished successfully\n",
@@ -309,6 +358,7 @@ errno_t be_ptask_create(TALLOC_CTX *mem_ctx,
         goto done;
     }
 
+    task->dp_target = DP_TARGET_SENTINEL;
     task->enabled = true;
 
     talloc_set_destructor((TALLOC_CTX*)task, be_ptask_destructor);
@@ -379,6 +429,11 @@ void be_ptask_destroy(struct be_ptask **task)
     talloc_zfree(*task);
 }
 
+void be_ptask_set_dp_target(struct be_ptask *task, enum dp_targets target)
+{
+    task->dp_target = target;
+}
+
 time_t be_ptask_get_period(struct be_ptask *task)
 {
     return task->period;
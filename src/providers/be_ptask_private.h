@@ -43,6 +43,11 @@ struct be_ptask {
     struct tevent_req *req; /* active tevent request */
     struct tevent_timer *timer; /* active tevent timer */
     bool enabled;
+
+    /* The task waits for a free slot of this target in the request
+     * scheduler, DP_TARGET_SENTINEL if it is not scheduled. */
+    enum dp_targets dp_target;
+    struct dp_sched_item *dp_slot; /* held while the task runs */
 };
 
 #endif /* DP_PTASK_PRIVATE_H_ */
@@ -41,12 +41,14 @@
 #include "confdb/confdb.h"
 #include "sbus/sssd_dbus.h"
 #include "sbus/sbus_client.h"
+#include "sbus/sbus_packed.h"
 #include "sss_client/sss_cli.h"
 #include "util/authtok.h"
 #include "providers/data_provider_req.h"
 
 #define DATA_PROVIDER_VERSION 0x0001
 #define DATA_PROVIDER_PIPE "private/sbus-dp"
+#define DATA_PROVIDER_PACKED_PIPE "private/sbus-dp-packed"
 
 #define DP_PATH "/org/freedesktop/sssd/dataprovider"
 
@@ -226,11 +228,25 @@ bool dp_pack_pam_response(DBusMessage *msg, struct pam_data *pd);
 bool dp_unpack_pam_response(DBusMessage *msg, struct pam_data *pd,
                             DBusError *dbus_error);
 
+/* The same as above but for the packed transport. */
+bool dp_pack_pam_request_packed(struct sbus_packed_buf *buf,
+                                struct pam_data *pd);
+bool dp_unpack_pam_request_packed(struct sbus_packed_buf *buf,
+                                  TALLOC_CTX *mem_ctx,
+                                  struct pam_data **new_pd);
+
+bool dp_pack_pam_response_packed(struct sbus_packed_buf *buf,
+                                 struct pam_data *pd);
+bool dp_unpack_pam_response_packed(struct sbus_packed_buf *buf,
+                                   struct pam_data *pd);
+
 void dp_id_callback(DBusPendingCall *pending, void *ptr);
 
 /* from dp_sbus.c */
 int dp_get_sbus_address(TALLOC_CTX *mem_ctx,
                         char **address, const char *domain_name);
+int dp_get_packed_address(TALLOC_CTX *mem_ctx,
+                          char **address, const char *domain_name);
 
 
 /* Helpers */
@@ -329,6 +345,10 @@ enum dp_res_opts {
     DP_RES_OPT_RESOLVER_TIMEOUT,
     DP_RES_OPT_RESOLVER_OP_TIMEOUT,
     DP_RES_OPT_DNS_DOMAIN,
+    DP_RES_OPT_PROBE_COUNT,
+    DP_RES_OPT_PROBE_STAGGER,
+    DP_RES_OPT_PROBE_TIMEOUT,
+    DP_RES_OPT_CACHE_MAX_TTL,
 
     DP_RES_OPTS /* attrs counter */
 };
@@ -94,6 +94,13 @@ errno_t dp_init(struct tevent_context *ev,
         goto done;
     }
 
+    ret = dp_sched_init(provider);
+    if (ret != EOK) {
+        DEBUG(SSSDBG_CRIT_FAILURE, "Unable to initialize request scheduler "
+              "[%d]: %s\n", ret, sss_strerror(ret));
+        goto done;
+    }
+
     /* Initialize data provider bus. Data provider can receive client
      * registration and other D-Bus methods. However no data provider
      * request will be executed as long as the modules and targets
@@ -108,6 +115,13 @@ errno_t dp_init(struct tevent_context *ev,
         goto done;
     }
 
+    ret = dp_init_packed_server(provider);
+    if (ret != EOK) {
+        DEBUG(SSSDBG_FATAL_FAILURE, "Unable to setup packed transport "
+              "[%d]: %s\n", ret, sss_strerror(ret));
+        goto done;
+    }
+
     be_ctx->provider = provider;
 
     ret = dp_init_modules(provider, &provider->modules);
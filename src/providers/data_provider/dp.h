@@ -81,6 +81,11 @@ enum dp_methods {
     DPM_HOSTID_HANDLER,
     DPM_DOMAINS_HANDLER,
 
+    /* Optional, DPT_ID target may implement it to process several account
+     * requests at once. Request data is struct dp_id_batch_data, output
+     * is struct dp_reply_batch. */
+    DPM_ACCOUNT_BATCH_HANDLER,
+
     DP_METHOD_SENTINEL
 };
 
@@ -161,4 +166,28 @@ bool dp_method_enabled(struct data_provider *provider,
 void dp_terminate_domain_requests(struct data_provider *provider,
                                   const char *domain);
 
+/* Waits for a free slot of @target in the request scheduler. The slot is
+ * requested with background priority and held until @_slot is freed.
+ * Periodic tasks use it to share the request limit of their target with
+ * requests sent by responders. */
+struct dp_sched_item;
+
+struct tevent_req *dp_sched_background_send(TALLOC_CTX *mem_ctx,
+                                            struct data_provider *provider,
+                                            enum dp_targets target);
+
+errno_t dp_sched_background_recv(TALLOC_CTX *mem_ctx,
+                                 struct tevent_req *req,
+                                 struct dp_sched_item **_slot);
+
+/* Start the periodic task through the request scheduler, see above. It is
+ * implemented in be_ptask.c, be_ptask.h cannot see enum dp_targets. */
+void be_ptask_set_dp_target(struct be_ptask *task, enum dp_targets target);
+
+/* Ask the PAM responder to forget cached account management decisions.
+ * A NULL user drops all decisions of the domain. */
+void dp_sbus_invalidate_pam_access(struct data_provider *provider,
+                                   const char *domain,
+                                   const char *user);
+
 #endif /* _DP_H_ */
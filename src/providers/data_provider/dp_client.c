@@ -59,6 +59,19 @@ const char *dp_client_to_string(enum dp_clients client)
     return "Invalid";
 }
 
+enum dp_clients dp_client_from_string(const char *name)
+{
+    enum dp_clients client;
+
+    for (client = 0; client != DP_CLIENT_SENTINEL; client++) {
+        if (strcasecmp(name, dp_client_to_string(client)) == 0) {
+            break;
+        }
+    }
+
+    return client;
+}
+
 static int dp_client_destructor(struct dp_client *dp_cli)
 {
     struct data_provider *provider;
@@ -113,13 +126,7 @@ dp_client_register(struct sbus_request *sbus_req,
     DEBUG(SSSDBG_CONF_SETTINGS, "Cancel DP ID timeout [%p]\n", dp_cli->timeout);
     talloc_zfree(dp_cli->timeout);
 
-    for (client = 0; client != DP_CLIENT_SENTINEL; client++) {
-        if (strcasecmp(client_name, dp_client_to_string(client)) == 0) {
-            provider->clients[client] = dp_cli;
-            break;
-        }
-    }
-
+    client = dp_client_from_string(client_name);
     if (client == DP_CLIENT_SENTINEL) {
         DEBUG(SSSDBG_CRIT_FAILURE, "Unknown client! [%s]\n", client_name);
         error = sbus_error_new(sbus_req, SBUS_ERROR_NOT_FOUND,
@@ -130,9 +137,11 @@ dp_client_register(struct sbus_request *sbus_req,
         return sbus_request_fail_and_finish(sbus_req, error);
     }
 
+    provider->clients[client] = dp_cli;
     talloc_set_destructor(dp_cli, dp_client_destructor);
 
-    ret = iface_dp_client_Register_finish(sbus_req);
+    ret = iface_dp_client_Register_finish(sbus_req,
+            provider->packed_address != NULL ? provider->packed_address : "");
     if (ret != EOK) {
         DEBUG(SSSDBG_CONF_SETTINGS, "Unable to send ack to the client [%s], "
               "disconnecting...\n", client_name);
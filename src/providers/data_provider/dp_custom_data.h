@@ -52,6 +52,11 @@ struct dp_id_data {
     const char *domain;
 };
 
+struct dp_id_batch_data {
+    uint32_t count;
+    struct dp_id_data **items;
+};
+
 /* Reply private data. */
 
 struct dp_reply_std {
@@ -60,6 +65,12 @@ struct dp_reply_std {
     const char *message;
 };
 
+/* Replies are in the same order as items of struct dp_id_batch_data. */
+struct dp_reply_batch {
+    uint32_t count;
+    struct dp_reply_std *replies;
+};
+
 void dp_reply_std_set(struct dp_reply_std *reply,
                       int dp_error,
                       int error,
@@ -71,4 +82,14 @@ void dp_req_reply_std(const char *request_name,
                       struct sbus_request *sbus_req,
                       struct dp_reply_std *reply);
 
+void dp_req_reply_batch(const char *request_name,
+                        struct sbus_request *sbus_req,
+                        struct dp_reply_batch *reply);
+
+struct sbus_packed_request;
+
+void dp_req_reply_std_packed(const char *request_name,
+                             struct sbus_packed_request *packed_req,
+                             struct dp_reply_std *reply);
+
 #endif /* _DP_CUSTOM_DATA_H_ */
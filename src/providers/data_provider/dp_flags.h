@@ -26,4 +26,10 @@
  */
 #define DP_FAST_REPLY   0x0001
 
+/**
+ * Nobody is waiting interactively for the result (enumeration, full
+ * refresh). Such requests are scheduled with the lowest priority.
+ */
+#define DP_BACKGROUND   0x0002
+
 #endif /* _DP_FLAGS_H_ */
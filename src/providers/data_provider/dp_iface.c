@@ -33,12 +33,15 @@ struct iface_dp iface_dp = {
     .autofsHandler = dp_autofs_handler,
     .hostHandler = dp_host_handler,
     .getDomains = dp_subdomains_handler,
-    .getAccountInfo = dp_get_account_info_handler
+    .getAccountInfo = dp_get_account_info_handler,
+    .getAccountInfoBatch = dp_get_account_info_batch_handler
 };
 
 struct iface_dp_backend iface_dp_backend = {
     {&iface_dp_backend_meta, 0},
-    .IsOnline = dp_backend_is_online
+    .IsOnline = dp_backend_is_online,
+    .SchedulerStats = dp_backend_scheduler_stats,
+    .DNSCacheStats = dp_backend_dns_cache_stats
 };
 
 struct iface_dp_failover iface_dp_failover = {
@@ -40,6 +40,18 @@ errno_t dp_get_account_info_handler(struct sbus_request *sbus_req,
                                     const char *domain,
                                     const char *extra);
 
+errno_t dp_get_account_info_batch_handler(struct sbus_request *sbus_req,
+                                          void *dp_cli,
+                                          uint32_t dp_flags,
+                                          uint32_t *entry_types,
+                                          int num_entry_types,
+                                          uint32_t attr_type,
+                                          const char **filters,
+                                          int num_filters,
+                                          const char *domain,
+                                          const char **extras,
+                                          int num_extras);
+
 errno_t dp_pam_handler(struct sbus_request *sbus_req, void *dp_cli);
 
 errno_t dp_sudo_handler(struct sbus_request *sbus_req, void *dp_cli);
@@ -64,6 +76,12 @@ errno_t dp_backend_is_online(struct sbus_request *sbus_req,
                              void *dp_cli,
                              const char *domain);
 
+errno_t dp_backend_scheduler_stats(struct sbus_request *sbus_req,
+                                   void *dp_cli);
+
+errno_t dp_backend_dns_cache_stats(struct sbus_request *sbus_req,
+                                   void *dp_cli);
+
 /* org.freedesktop.sssd.DataProvider.Failover */
 errno_t dp_failover_list_services(struct sbus_request *sbus_req,
                                   void *dp_cli,
@@ -58,3 +58,82 @@ errno_t dp_backend_is_online(struct sbus_request *sbus_req,
     iface_dp_backend_IsOnline_finish(sbus_req, online);
     return EOK;
 }
+
+errno_t dp_backend_scheduler_stats(struct sbus_request *sbus_req,
+                                   void *dp_cli)
+{
+    struct data_provider *provider;
+    struct dp_sched_target *stats;
+    enum dp_targets target;
+    const char **names;
+    uint32_t *limits;
+    uint32_t *active;
+    uint32_t *queued;
+    uint32_t *max_queued;
+    uint64_t *started;
+    uint64_t *delayed;
+    uint64_t *wait_total;
+    uint64_t *wait_max;
+    int count;
+
+    provider = dp_client_provider(dp_cli);
+
+    names = talloc_zero_array(sbus_req, const char *, DP_TARGET_SENTINEL);
+    limits = talloc_zero_array(sbus_req, uint32_t, DP_TARGET_SENTINEL);
+    active = talloc_zero_array(sbus_req, uint32_t, DP_TARGET_SENTINEL);
+    queued = talloc_zero_array(sbus_req, uint32_t, DP_TARGET_SENTINEL);
+    max_queued = talloc_zero_array(sbus_req, uint32_t, DP_TARGET_SENTINEL);
+    started = talloc_zero_array(sbus_req, uint64_t, DP_TARGET_SENTINEL);
+    delayed = talloc_zero_array(sbus_req, uint64_t, DP_TARGET_SENTINEL);
+    wait_total = talloc_zero_array(sbus_req, uint64_t, DP_TARGET_SENTINEL);
+    wait_max = talloc_zero_array(sbus_req, uint64_t, DP_TARGET_SENTINEL);
+    if (names == NULL || limits == NULL || active == NULL || queued == NULL
+            || max_queued == NULL || started == NULL || delayed == NULL
+            || wait_total == NULL || wait_max == NULL) {
+        return ENOMEM;
+    }
+
+    count = 0;
+    for (target = 0; target != DP_TARGET_SENTINEL; target++) {
+        if (!dp_target_initialized(provider->targets, target)) {
+            continue;
+        }
+
+        stats = &provider->sched.targets[target];
+        names[count] = dp_target_to_string(target);
+        limits[count] = stats->max_active;
+        active[count] = stats->num_active;
+        queued[count] = stats->num_queued;
+        max_queued[count] = stats->max_queued;
+        started[count] = stats->num_started;
+        delayed[count] = stats->num_delayed;
+        wait_total[count] = stats->wait_total;
+        wait_max[count] = stats->wait_max;
+        count++;
+    }
+
+    iface_dp_backend_SchedulerStats_finish(sbus_req, names, count,
+                                           limits, count, active, count,
+                                           queued, count, max_queued, count,
+                                           started, count, delayed, count,
+                                           wait_total, count, wait_max, count);
+    return EOK;
+}
+
+errno_t dp_backend_dns_cache_stats(struct sbus_request *sbus_req,
+                                   void *dp_cli)
+{
+    struct resolv_cache_stats stats = { 0 };
+    struct be_ctx *be_ctx;
+
+    be_ctx = dp_client_be(dp_cli);
+
+    if (be_ctx->be_res != NULL) {
+        resolv_get_cache_stats(be_ctx->be_res->resolv, &stats);
+    }
+
+    iface_dp_backend_DNSCacheStats_finish(sbus_req, stats.hits,
+                                          stats.negative_hits, stats.misses,
+                                          stats.entries);
+    return EOK;
+}
@@ -18,24 +18,82 @@ static int invoke_uss_method(struct sbus_request *dbus_req, void *function_ptr);
 /* invokes a handler with a 'uuusss' DBus signature */
 static int invoke_uuusss_method(struct sbus_request *dbus_req, void *function_ptr);
 
+/* invokes a handler with a 'uauuassas' DBus signature */
+static int invoke_uauuassas_method(struct sbus_request *dbus_req, void *function_ptr);
+
 /* arguments for org.freedesktop.sssd.DataProvider.Client.Register */
 const struct sbus_arg_meta iface_dp_client_Register__in[] = {
     { "Name", "s" },
     { NULL, }
 };
 
-int iface_dp_client_Register_finish(struct sbus_request *req)
+/* arguments for org.freedesktop.sssd.DataProvider.Client.Register */
+const struct sbus_arg_meta iface_dp_client_Register__out[] = {
+    { "PackedAddress", "s" },
+    { NULL, }
+};
+
+int iface_dp_client_Register_finish(struct sbus_request *req, const char *arg_PackedAddress)
 {
    return sbus_request_return_and_finish(req,
+                                         DBUS_TYPE_STRING, &arg_PackedAddress,
                                          DBUS_TYPE_INVALID);
 }
 
+errno_t iface_dp_client_Register_pack(struct sbus_packed_buf *buf, const char *arg_Name)
+{
+    errno_t ret;
+
+    ret = sbus_packed_put_string(buf, arg_Name);
+    if (ret != EOK) {
+        return ret;
+    }
+
+    return EOK;
+}
+
+errno_t iface_dp_client_Register_unpack(struct sbus_packed_buf *buf, const char **arg_Name)
+{
+    errno_t ret;
+
+    ret = sbus_packed_get_string(buf, arg_Name);
+    if (ret != EOK) {
+        return ret;
+    }
+
+    return EOK;
+}
+
+errno_t iface_dp_client_Register_pack_reply(struct sbus_packed_buf *buf, const char *arg_PackedAddress)
+{
+    errno_t ret;
+
+    ret = sbus_packed_put_string(buf, arg_PackedAddress);
+    if (ret != EOK) {
+        return ret;
+    }
+
+    return EOK;
+}
+
+errno_t iface_dp_client_Register_unpack_reply(struct sbus_packed_buf *buf, const char **arg_PackedAddress)
+{
+    errno_t ret;
+
+    ret = sbus_packed_get_string(buf, arg_PackedAddress);
+    if (ret != EOK) {
+        return ret;
+    }
+
+    return EOK;
+}
+
 /* methods for org.freedesktop.sssd.DataProvider.Client */
 const struct sbus_method_meta iface_dp_client__methods[] = {
     {
         "Register", /* name */
         iface_dp_client_Register__in,
-        NULL, /* no out_args */
+        iface_dp_client_Register__out,
         offsetof(struct iface_dp_client, Register),
         invoke_s_method,
     },
@@ -71,6 +129,54 @@ int iface_dp_backend_IsOnline_finish(struct sbus_request *req, bool arg_status)
                                          DBUS_TYPE_INVALID);
 }
 
+/* arguments for org.freedesktop.sssd.DataProvider.Backend.SchedulerStats */
+const struct sbus_arg_meta iface_dp_backend_SchedulerStats__out[] = {
+    { "targets", "as" },
+    { "limits", "au" },
+    { "active", "au" },
+    { "queued", "au" },
+    { "max_queued", "au" },
+    { "started", "at" },
+    { "delayed", "at" },
+    { "wait_total", "at" },
+    { "wait_max", "at" },
+    { NULL, }
+};
+
+int iface_dp_backend_SchedulerStats_finish(struct sbus_request *req, const char *arg_targets[], int len_targets, uint32_t arg_limits[], int len_limits, uint32_t arg_active[], int len_active, uint32_t arg_queued[], int len_queued, uint32_t arg_max_queued[], int len_max_queued, uint64_t arg_started[], int len_started, uint64_t arg_delayed[], int len_delayed, uint64_t arg_wait_total[], int len_wait_total, uint64_t arg_wait_max[], int len_wait_max)
+{
+   return sbus_request_return_and_finish(req,
+                                         DBUS_TYPE_ARRAY, DBUS_TYPE_STRING, &arg_targets, len_targets,
+                                         DBUS_TYPE_ARRAY, DBUS_TYPE_UINT32, &arg_limits, len_limits,
+                                         DBUS_TYPE_ARRAY, DBUS_TYPE_UINT32, &arg_active, len_active,
+                                         DBUS_TYPE_ARRAY, DBUS_TYPE_UINT32, &arg_queued, len_queued,
+                                         DBUS_TYPE_ARRAY, DBUS_TYPE_UINT32, &arg_max_queued, len_max_queued,
+                                         DBUS_TYPE_ARRAY, DBUS_TYPE_UINT64, &arg_started, len_started,
+                                         DBUS_TYPE_ARRAY, DBUS_TYPE_UINT64, &arg_delayed, len_delayed,
+                                         DBUS_TYPE_ARRAY, DBUS_TYPE_UINT64, &arg_wait_total, len_wait_total,
+                                         DBUS_TYPE_ARRAY, DBUS_TYPE_UINT64, &arg_wait_max, len_wait_max,
+                                         DBUS_TYPE_INVALID);
+}
+
+/* arguments for org.freedesktop.sssd.DataProvider.Backend.DNSCacheStats */
+const struct sbus_arg_meta iface_dp_backend_DNSCacheStats__out[] = {
+    { "hits", "t" },
+    { "negative_hits", "t" },
+    { "misses", "t" },
+    { "entries", "u" },
+    { NULL, }
+};
+
+int iface_dp_backend_DNSCacheStats_finish(struct sbus_request *req, uint64_t arg_hits, uint64_t arg_negative_hits, uint64_t arg_misses, uint32_t arg_entries)
+{
+   return sbus_request_return_and_finish(req,
+                                         DBUS_TYPE_UINT64, &arg_hits,
+                                         DBUS_TYPE_UINT64, &arg_negative_hits,
+                                         DBUS_TYPE_UINT64, &arg_misses,
+                                         DBUS_TYPE_UINT32, &arg_entries,
+                                         DBUS_TYPE_INVALID);
+}
+
 /* methods for org.freedesktop.sssd.DataProvider.Backend */
 const struct sbus_method_meta iface_dp_backend__methods[] = {
     {
@@ -80,6 +186,20 @@ const struct sbus_method_meta iface_dp_backend__methods[] = {
         offsetof(struct iface_dp_backend, IsOnline),
         invoke_s_method,
     },
+    {
+        "SchedulerStats", /* name */
+        NULL, /* no in_args */
+        iface_dp_backend_SchedulerStats__out,
+        offsetof(struct iface_dp_backend, SchedulerStats),
+        NULL, /* no invoker */
+    },
+    {
+        "DNSCacheStats", /* name */
+        NULL, /* no in_args */
+        iface_dp_backend_DNSCacheStats__out,
+        offsetof(struct iface_dp_backend, DNSCacheStats),
+        NULL, /* no invoker */
+    },
     { NULL, }
 };
 
@@ -284,6 +404,152 @@ int iface_dp_getAccountInfo_finish(struct sbus_request *req, uint16_t arg_dp_err
                                          DBUS_TYPE_INVALID);
 }
 
+errno_t iface_dp_getAccountInfo_pack(struct sbus_packed_buf *buf, uint32_t arg_dp_flags, uint32_t arg_entry_type, uint32_t arg_attr_type, const char *arg_filter, const char *arg_domain, const char *arg_extra)
+{
+    errno_t ret;
+
+    ret = sbus_packed_put_uint32(buf, arg_dp_flags);
+    if (ret != EOK) {
+        return ret;
+    }
+
+    ret = sbus_packed_put_uint32(buf, arg_entry_type);
+    if (ret != EOK) {
+        return ret;
+    }
+
+    ret = sbus_packed_put_uint32(buf, arg_attr_type);
+    if (ret != EOK) {
+        return ret;
+    }
+
+    ret = sbus_packed_put_string(buf, arg_filter);
+    if (ret != EOK) {
+        return ret;
+    }
+
+    ret = sbus_packed_put_string(buf, arg_domain);
+    if (ret != EOK) {
+        return ret;
+    }
+
+    ret = sbus_packed_put_string(buf, arg_extra);
+    if (ret != EOK) {
+        return ret;
+    }
+
+    return EOK;
+}
+
+errno_t iface_dp_getAccountInfo_unpack(struct sbus_packed_buf *buf, uint32_t *arg_dp_flags, uint32_t *arg_entry_type, uint32_t *arg_attr_type, const char **arg_filter, const char **arg_domain, const char **arg_extra)
+{
+    errno_t ret;
+
+    ret = sbus_packed_get_uint32(buf, arg_dp_flags);
+    if (ret != EOK) {
+        return ret;
+    }
+
+    ret = sbus_packed_get_uint32(buf, arg_entry_type);
+    if (ret != EOK) {
+        return ret;
+    }
+
+    ret = sbus_packed_get_uint32(buf, arg_attr_type);
+    if (ret != EOK) {
+        return ret;
+    }
+
+    ret = sbus_packed_get_string(buf, arg_filter);
+    if (ret != EOK) {
+        return ret;
+    }
+
+    ret = sbus_packed_get_string(buf, arg_domain);
+    if (ret != EOK) {
+        return ret;
+    }
+
+    ret = sbus_packed_get_string(buf, arg_extra);
+    if (ret != EOK) {
+        return ret;
+    }
+
+    return EOK;
+}
+
+errno_t iface_dp_getAccountInfo_pack_reply(struct sbus_packed_buf *buf, uint16_t arg_dp_error, uint32_t arg_error, const char *arg_error_message)
+{
+    errno_t ret;
+
+    ret = sbus_packed_put_uint16(buf, arg_dp_error);
+    if (ret != EOK) {
+        return ret;
+    }
+
+    ret = sbus_packed_put_uint32(buf, arg_error);
+    if (ret != EOK) {
+        return ret;
+    }
+
+    ret = sbus_packed_put_string(buf, arg_error_message);
+    if (ret != EOK) {
+        return ret;
+    }
+
+    return EOK;
+}
+
+errno_t iface_dp_getAccountInfo_unpack_reply(struct sbus_packed_buf *buf, uint16_t *arg_dp_error, uint32_t *arg_error, const char **arg_error_message)
+{
+    errno_t ret;
+
+    ret = sbus_packed_get_uint16(buf, arg_dp_error);
+    if (ret != EOK) {
+        return ret;
+    }
+
+    ret = sbus_packed_get_uint32(buf, arg_error);
+    if (ret != EOK) {
+        return ret;
+    }
+
+    ret = sbus_packed_get_string(buf, arg_error_message);
+    if (ret != EOK) {
+        return ret;
+    }
+
+    return EOK;
+}
+
+/* arguments for org.freedesktop.sssd.dataprovider.getAccountInfoBatch */
+const struct sbus_arg_meta iface_dp_getAccountInfoBatch__in[] = {
+    { "dp_flags", "u" },
+    { "entry_types", "au" },
+    { "attr_type", "u" },
+    { "filters", "as" },
+    { "domain", "s" },
+    { "extras", "as" },
+    { NULL, }
+};
+
+/* arguments for org.freedesktop.sssd.dataprovider.getAccountInfoBatch */
+const struct sbus_arg_meta iface_dp_getAccountInfoBatch__out[] = {
+    { "dp_errors", "aq" },
+    { "errors", "au" },
+    { "error_messages", "as" },
+    { NULL, }
+};
+
+int iface_dp_getAccountInfoBatch_finish(struct sbus_request *req, uint16_t arg_dp_errors[], int len_dp_errors, uint32_t arg_errors[], int len_errors, const char *arg_error_messages[], int len_error_messages)
+{
+   return sbus_request_return_and_finish(req,
+                                         DBUS_TYPE_ARRAY, DBUS_TYPE_UINT16, &arg_dp_errors, len_dp_errors,
+                                         DBUS_TYPE_ARRAY, DBUS_TYPE_UINT32, &arg_errors, len_errors,
+                                         DBUS_TYPE_ARRAY, DBUS_TYPE_STRING, &arg_error_messages, len_error_messages,
+                                         DBUS_TYPE_INVALID);
+}
+
 /* methods for org.freedesktop.sssd.dataprovider */
 const struct sbus_method_meta iface_dp__methods[] = {
     {
@@ -292,6 +558,7 @@ const struct sbus_method_meta iface_dp__methods[] = {
         NULL, /* no out_args */
         offsetof(struct iface_dp, pamHandler),
         NULL, /* no invoker */
+        true, /* traced */
     },
     {
         "sudoHandler", /* name */
@@ -299,6 +566,7 @@ const struct sbus_method_meta iface_dp__methods[] = {
         NULL, /* no out_args */
         offsetof(struct iface_dp, sudoHandler),
         NULL, /* no invoker */
+        true, /* traced */
     },
     {
         "autofsHandler", /* name */
@@ -306,6 +574,7 @@ const struct sbus_method_meta iface_dp__methods[] = {
         iface_dp_autofsHandler__out,
         offsetof(struct iface_dp, autofsHandler),
         invoke_us_method,
+        true, /* traced */
     },
     {
         "hostHandler", /* name */
@@ -313,6 +582,7 @@ const struct sbus_method_meta iface_dp__methods[] = {
         iface_dp_hostHandler__out,
         offsetof(struct iface_dp, hostHandler),
         invoke_uss_method,
+        true, /* traced */
     },
     {
         "getDomains", /* name */
@@ -320,6 +590,7 @@ const struct sbus_method_meta iface_dp__methods[] = {
         iface_dp_getDomains__out,
         offsetof(struct iface_dp, getDomains),
         invoke_s_method,
+        true, /* traced */
     },
     {
         "getAccountInfo", /* name */
@@ -327,6 +598,15 @@ const struct sbus_method_meta iface_dp__methods[] = {
         iface_dp_getAccountInfo__out,
         offsetof(struct iface_dp, getAccountInfo),
         invoke_uuusss_method,
+        true, /* traced */
+    },
+    {
+        "getAccountInfoBatch", /* name */
+        iface_dp_getAccountInfoBatch__in,
+        iface_dp_getAccountInfoBatch__out,
+        offsetof(struct iface_dp, getAccountInfoBatch),
+        invoke_uauuassas_method,
+        true, /* traced */
     },
     { NULL, }
 };
@@ -427,3 +707,40 @@ static int invoke_us_method(struct sbus_request *dbus_req, void *function_ptr)
                      arg_0,
                      arg_1);
 }
+
+/* invokes a handler with a 'uauuassas' DBus signature */
+static int invoke_uauuassas_method(struct sbus_request *dbus_req, void *function_ptr)
+{
+    uint32_t arg_0;
+    uint32_t *arg_1;
+    int len_1;
+    uint32_t arg_2;
+    const char * *arg_3;
+    int len_3;
+    const char * arg_4;
+    const char * *arg_5;
+    int len_5;
+    int (*handler)(struct sbus_request *, void *, uint32_t, uint32_t[], int, uint32_t, const char *[], int, const char *, const char *[], int) = function_ptr;
+
+    if (!sbus_request_parse_or_finish(dbus_req,
+                               DBUS_TYPE_UINT32, &arg_0,
+                               DBUS_TYPE_ARRAY, DBUS_TYPE_UINT32, &arg_1, &len_1,
+                               DBUS_TYPE_UINT32, &arg_2,
+                               DBUS_TYPE_ARRAY, DBUS_TYPE_STRING, &arg_3, &len_3,
+                               DBUS_TYPE_STRING, &arg_4,
+                               DBUS_TYPE_ARRAY, DBUS_TYPE_STRING, &arg_5, &len_5,
+                               DBUS_TYPE_INVALID)) {
+         return EOK; /* request handled */
+    }
+
+    return (handler)(dbus_req, dbus_req->intf->handler_data,
+                     arg_0,
+                     arg_1,
+                     len_1,
+                     arg_2,
+                     arg_3,
+                     len_3,
+                     arg_4,
+                     arg_5,
+                     len_5);
+}
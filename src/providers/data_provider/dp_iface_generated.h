@@ -4,6 +4,7 @@
 #define __DP_IFACE_XML__
 
 #include "sbus/sssd_dbus.h"
+#include "sbus/sbus_packed.h"
 
 /* ------------------------------------------------------------------------
  * DBus Constants
@@ -14,10 +15,13 @@
 /* constants for org.freedesktop.sssd.DataProvider.Client */
 #define IFACE_DP_CLIENT "org.freedesktop.sssd.DataProvider.Client"
 #define IFACE_DP_CLIENT_REGISTER "Register"
+#define IFACE_DP_CLIENT_REGISTER_OPCODE 1
 
 /* constants for org.freedesktop.sssd.DataProvider.Backend */
 #define IFACE_DP_BACKEND "org.freedesktop.sssd.DataProvider.Backend"
 #define IFACE_DP_BACKEND_ISONLINE "IsOnline"
+#define IFACE_DP_BACKEND_SCHEDULERSTATS "SchedulerStats"
+#define IFACE_DP_BACKEND_DNSCACHESTATS "DNSCacheStats"
 
 /* constants for org.freedesktop.sssd.DataProvider.Failover */
 #define IFACE_DP_FAILOVER "org.freedesktop.sssd.DataProvider.Failover"
@@ -33,6 +37,9 @@
 #define IFACE_DP_HOSTHANDLER "hostHandler"
 #define IFACE_DP_GETDOMAINS "getDomains"
 #define IFACE_DP_GETACCOUNTINFO "getAccountInfo"
+#define IFACE_DP_GETACCOUNTINFOBATCH "getAccountInfoBatch"
+#define IFACE_DP_PAMHANDLER_OPCODE 2
+#define IFACE_DP_GETACCOUNTINFO_OPCODE 3
 
 /* ------------------------------------------------------------------------
  * DBus handlers
@@ -59,17 +66,25 @@ struct iface_dp_client {
 };
 
 /* finish function for Register */
-int iface_dp_client_Register_finish(struct sbus_request *req);
+int iface_dp_client_Register_finish(struct sbus_request *req, const char *arg_PackedAddress);
 
 /* vtable for org.freedesktop.sssd.DataProvider.Backend */
 struct iface_dp_backend {
     struct sbus_vtable vtable; /* derive from sbus_vtable */
     int (*IsOnline)(struct sbus_request *req, void *data, const char *arg_domain_name);
+    int (*SchedulerStats)(struct sbus_request *req, void *data);
+    int (*DNSCacheStats)(struct sbus_request *req, void *data);
 };
 
 /* finish function for IsOnline */
 int iface_dp_backend_IsOnline_finish(struct sbus_request *req, bool arg_status);
 
+/* finish function for SchedulerStats */
+int iface_dp_backend_SchedulerStats_finish(struct sbus_request *req, const char *arg_targets[], int len_targets, uint32_t arg_limits[], int len_limits, uint32_t arg_active[], int len_active, uint32_t arg_queued[], int len_queued, uint32_t arg_max_queued[], int len_max_queued, uint64_t arg_started[], int len_started, uint64_t arg_delayed[], int len_delayed, uint64_t arg_wait_total[], int len_wait_total, uint64_t arg_wait_max[], int len_wait_max);
+
+/* finish function for DNSCacheStats */
+int iface_dp_backend_DNSCacheStats_finish(struct sbus_request *req, uint64_t arg_hits, uint64_t arg_negative_hits, uint64_t arg_misses, uint32_t arg_entries);
+
 /* vtable for org.freedesktop.sssd.DataProvider.Failover */
 struct iface_dp_failover {
     struct sbus_vtable vtable; /* derive from sbus_vtable */
@@ -96,6 +111,7 @@ struct iface_dp {
     int (*hostHandler)(struct sbus_request *req, void *data, uint32_t arg_dp_flags, const char *arg_name, const char *arg_alias);
     int (*getDomains)(struct sbus_request *req, void *data, const char *arg_domain_hint);
     int (*getAccountInfo)(struct sbus_request *req, void *data, uint32_t arg_dp_flags, uint32_t arg_entry_type, uint32_t arg_attr_type, const char *arg_filter, const char *arg_domain, const char *arg_extra);
+    int (*getAccountInfoBatch)(struct sbus_request *req, void *data, uint32_t arg_dp_flags, uint32_t arg_entry_types[], int len_entry_types, uint32_t arg_attr_type, const char *arg_filters[], int len_filters, const char *arg_domain, const char *arg_extras[], int len_extras);
 };
 
 /* finish function for autofsHandler */
@@ -110,6 +126,30 @@ int iface_dp_getDomains_finish(struct sbus_request *req, uint16_t arg_dp_error,
 /* finish function for getAccountInfo */
 int iface_dp_getAccountInfo_finish(struct sbus_request *req, uint16_t arg_dp_error, uint32_t arg_error, const char *arg_error_message);
 
+/* finish function for getAccountInfoBatch */
+int iface_dp_getAccountInfoBatch_finish(struct sbus_request *req, uint16_t arg_dp_errors[], int len_dp_errors, uint32_t arg_errors[], int len_errors, const char *arg_error_messages[], int len_error_messages);
+
+/* ------------------------------------------------------------------------
+ * Packed transport
+ *
+ * Methods annotated with org.freedesktop.sssd.Packed can be also called
+ * over the packed binary transport. The xxx_pack() and xxx_unpack()
+ * functions (un)marshall arguments of the call, xxx_pack_reply() and
+ * xxx_unpack_reply() its output. Unpacked strings point inside the buffer.
+ */
+
+/* packed transport functions for Register */
+errno_t iface_dp_client_Register_pack(struct sbus_packed_buf *buf, const char *arg_Name);
+errno_t iface_dp_client_Register_unpack(struct sbus_packed_buf *buf, const char **arg_Name);
+errno_t iface_dp_client_Register_pack_reply(struct sbus_packed_buf *buf, const char *arg_PackedAddress);
+errno_t iface_dp_client_Register_unpack_reply(struct sbus_packed_buf *buf, const char **arg_PackedAddress);
+
+/* packed transport functions for getAccountInfo */
+errno_t iface_dp_getAccountInfo_pack(struct sbus_packed_buf *buf, uint32_t arg_dp_flags, uint32_t arg_entry_type, uint32_t arg_attr_type, const char *arg_filter, const char *arg_domain, const char *arg_extra);
+errno_t iface_dp_getAccountInfo_unpack(struct sbus_packed_buf *buf, uint32_t *arg_dp_flags, uint32_t *arg_entry_type, uint32_t *arg_attr_type, const char **arg_filter, const char **arg_domain, const char **arg_extra);
+errno_t iface_dp_getAccountInfo_pack_reply(struct sbus_packed_buf *buf, uint16_t arg_dp_error, uint32_t arg_error, const char *arg_error_message);
+errno_t iface_dp_getAccountInfo_unpack_reply(struct sbus_packed_buf *buf, uint16_t *arg_dp_error, uint32_t *arg_error, const char **arg_error_message);
+
 /* ------------------------------------------------------------------------
  * DBus Interface Metadata
  *
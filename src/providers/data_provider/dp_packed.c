@@ -0,0 +1,173 @@
+/*
+    SSSD
+
+    Data provider side of the packed binary transport
+
+    Copyright (C) 2016 Red Hat
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <talloc.h>
+#include <tevent.h>
+
+#include "sbus/sbus_packed.h"
+#include "providers/data_provider/dp_private.h"
+#include "providers/data_provider/dp_iface_generated.h"
+#include "providers/backend.h"
+#include "util/util.h"
+
+struct dp_packed_client {
+    struct data_provider *provider;
+    enum dp_clients client;
+};
+
+errno_t dp_packed_client(void *conn_data,
+                         struct data_provider **_provider,
+                         struct dp_client **_dp_cli)
+{
+    struct dp_packed_client *packed_cli;
+    struct dp_client *dp_cli;
+
+    packed_cli = talloc_get_type(conn_data, struct dp_packed_client);
+    if (packed_cli == NULL) {
+        DEBUG(SSSDBG_CRIT_FAILURE, "Bug: packed_cli is NULL\n");
+        return EINVAL;
+    }
+
+    if (packed_cli->client == DP_CLIENT_SENTINEL) {
+        DEBUG(SSSDBG_CRIT_FAILURE, "Packed client is not registered\n");
+        return EACCES;
+    }
+
+    /* The client must keep its D-Bus connection to be able to use the
+     * packed one, requests are accounted to the D-Bus client. */
+    dp_cli = packed_cli->provider->clients[packed_cli->client];
+    if (dp_cli == NULL) {
+        DEBUG(SSSDBG_MINOR_FAILURE, "D-Bus client is no longer connected\n");
+        return ERR_OFFLINE;
+    }
+
+    *_provider = packed_cli->provider;
+    *_dp_cli = dp_cli;
+
+    return EOK;
+}
+
+static errno_t dp_packed_register(struct sbus_packed_request *req, void *data)
+{
+    struct dp_packed_client *packed_cli;
+    struct sbus_packed_buf *reply;
+    enum dp_clients client;
+    const char *name;
+    errno_t ret;
+
+    packed_cli = talloc_get_type(data, struct dp_packed_client);
+    if (packed_cli == NULL) {
+        DEBUG(SSSDBG_CRIT_FAILURE, "Bug: packed_cli is NULL\n");
+        return EINVAL;
+    }
+
+    ret = iface_dp_client_Register_unpack(req->body, &name);
+    if (ret != EOK) {
+        return ret;
+    }
+
+    client = dp_client_from_string(name);
+    if (client == DP_CLIENT_SENTINEL) {
+        DEBUG(SSSDBG_CRIT_FAILURE, "Unknown client! [%s]\n", name);
+        return ERR_INTERNAL;
+    }
+
+    reply = sbus_packed_buf_new(req);
+    if (reply == NULL) {
+        return ENOMEM;
+    }
+
+    /* There is no other address to redirect the client to. */
+    ret = iface_dp_client_Register_pack_reply(reply, "");
+    if (ret != EOK) {
+        return ret;
+    }
+
+    packed_cli->client = client;
+    DEBUG(SSSDBG_CONF_SETTINGS, "Added packed Frontend client [%s]\n", name);
+
+    return sbus_packed_request_finish(req, reply);
+}
+
+static errno_t dp_packed_conn_init(struct sbus_packed_conn *conn, void *pvt)
+{
+    struct dp_packed_client *packed_cli;
+
+    packed_cli = talloc_zero(conn, struct dp_packed_client);
+    if (packed_cli == NULL) {
+        return ENOMEM;
+    }
+
+    packed_cli->provider = talloc_get_type(pvt, struct data_provider);
+    packed_cli->client = DP_CLIENT_SENTINEL;
+
+    sbus_packed_conn_set_data(conn, packed_cli);
+
+    return EOK;
+}
+
+errno_t dp_init_packed_server(struct data_provider *provider)
+{
+    static const struct sbus_packed_method methods[] = {
+        {IFACE_DP_CLIENT_REGISTER_OPCODE, dp_packed_register},
+        {IFACE_DP_PAMHANDLER_OPCODE, dp_pam_packed_handler},
+        {IFACE_DP_GETACCOUNTINFO_OPCODE, dp_get_account_info_packed_handler},
+        {0, NULL}
+    };
+    struct be_ctx *be_ctx = provider->be_ctx;
+    char *address;
+    bool enabled;
+    errno_t ret;
+
+    ret = confdb_get_bool(be_ctx->cdb, be_ctx->conf_path,
+                          CONFDB_DOMAIN_DP_PACKED_TRANSPORT, false, &enabled);
+    if (ret != EOK) {
+        DEBUG(SSSDBG_CRIT_FAILURE, "Unable to read %s [%d]: %s\n",
+              CONFDB_DOMAIN_DP_PACKED_TRANSPORT, ret, sss_strerror(ret));
+        return ret;
+    }
+
+    if (!enabled) {
+        return EOK;
+    }
+
+    ret = dp_get_packed_address(provider, &address, be_ctx->domain->name);
+    if (ret != EOK) {
+        DEBUG(SSSDBG_FATAL_FAILURE, "Could not get packed backend address.\n");
+        return ret;
+    }
+
+    ret = sbus_packed_server_create(provider, provider->ev, address,
+                                    provider->uid, provider->gid, methods,
+                                    dp_packed_conn_init, provider,
+                                    &provider->packed_srv);
+    if (ret != EOK) {
+        DEBUG(SSSDBG_FATAL_FAILURE, "Could not set up packed server.\n");
+        talloc_free(address);
+        return ret;
+    }
+
+    provider->packed_address = address;
+    DEBUG(SSSDBG_CONF_SETTINGS, "Packed transport listening on [%s]\n",
+          address);
+
+    return EOK;
+}
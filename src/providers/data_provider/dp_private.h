@@ -24,6 +24,7 @@
 #include <tevent.h>
 #include <dhash.h>
 #include "sbus/sssd_dbus.h"
+#include "sbus/sbus_packed.h"
 #include "providers/data_provider/dp.h"
 #include "util/util.h"
 
@@ -45,6 +46,53 @@ enum dp_clients {
 struct dp_req;
 struct dp_client;
 
+enum dp_req_priority {
+    /* Authentication and access control, a user is waiting for it. */
+    DP_PRIO_INTERACTIVE,
+    /* Identity lookups issued by responders. */
+    DP_PRIO_LOOKUP,
+    /* Requests marked with DP_BACKGROUND. */
+    DP_PRIO_BACKGROUND,
+
+    DP_PRIO_SENTINEL
+};
+
+struct dp_sched_item;
+
+typedef void (*dp_sched_run_fn)(struct dp_sched_item *item, void *pvt);
+
+struct dp_sched_item {
+    struct data_provider *provider;
+    enum dp_targets target;
+    enum dp_req_priority priority;
+    struct timeval queued_at;
+    bool queued;
+    bool active;
+
+    dp_sched_run_fn run_fn;
+    void *pvt;
+
+    struct dp_sched_item *prev;
+    struct dp_sched_item *next;
+};
+
+struct dp_sched_target {
+    /* Maximum number of concurrently running requests, 0 is unlimited. */
+    uint32_t max_active;
+
+    uint32_t num_active;
+    uint32_t num_queued;
+    uint32_t max_queued;
+
+    /* Number of requests started and how many of them had to wait. */
+    uint64_t num_started;
+    uint64_t num_delayed;
+
+    /* Time spent in the queue in microseconds. */
+    uint64_t wait_total;
+    uint64_t wait_max;
+};
+
 struct dp_module {
     bool initialized;
     const char *name;
@@ -79,6 +127,8 @@ struct data_provider {
     struct be_ctx *be_ctx;
     struct tevent_context *ev;
     struct sbus_connection *srv_conn;
+    struct sbus_packed_server *packed_srv;
+    const char *packed_address;
     struct dp_client *clients[DP_CLIENT_SENTINEL];
     bool terminating;
 
@@ -97,6 +147,13 @@ struct data_provider {
         hash_table_t *reply_table;
     } requests;
 
+    struct {
+        /* Requests waiting for a free slot, one list per priority. */
+        struct dp_sched_item *queue[DP_PRIO_SENTINEL];
+        struct dp_sched_target targets[DP_TARGET_SENTINEL];
+        struct tevent_immediate *im;
+    } sched;
+
     struct dp_module **modules;
     struct dp_target **targets;
 };
@@ -138,6 +195,15 @@ void dp_req_reply_default(const char *req_name,
                           struct sbus_request *sbus_req,
                           void *data);
 
+typedef void (*dp_req_packed_reply_fn)(const char *req_name,
+                                       struct sbus_packed_request *packed_req,
+                                       void *data);
+
+/* Must finish @internal_req, output data is freed when it returns. */
+typedef void (*dp_req_internal_reply_fn)(const char *req_name,
+                                         struct tevent_req *internal_req,
+                                         void *data);
+
 /* Data provider request table. */
 
 struct dp_sbus_req_item;
@@ -148,11 +214,19 @@ struct dp_table_value {
 
     struct tevent_req *req;
     struct dp_sbus_req_item *list;
+
+    /* Set by the first waiting request of each transport. */
+    dp_req_reply_fn reply_fn;
+    dp_req_packed_reply_fn packed_reply_fn;
+    dp_req_internal_reply_fn internal_reply_fn;
 };
 
+/* Exactly one of sbus_req, packed_req and internal_req is set. */
 struct dp_sbus_req_item {
     struct dp_table_value *parent;
     struct sbus_request *sbus_req;
+    struct sbus_packed_request *packed_req;
+    struct tevent_req *internal_req;
 
     struct dp_sbus_req_item *prev;
     struct dp_sbus_req_item *next;
@@ -174,6 +248,16 @@ errno_t dp_req_table_add(hash_table_t *table,
                          struct tevent_req *req,
                          struct sbus_request *sbus_req);
 
+errno_t dp_req_table_add_packed(hash_table_t *table,
+                                const char *key,
+                                struct tevent_req *req,
+                                struct sbus_packed_request *packed_req);
+
+errno_t dp_req_table_add_internal(hash_table_t *table,
+                                  const char *key,
+                                  struct tevent_req *req,
+                                  struct tevent_req *internal_req);
+
 void dp_req_table_del(hash_table_t *table,
                       const char *key);
 
@@ -183,6 +267,25 @@ void dp_req_table_del_and_free(hash_table_t *table,
 bool dp_req_table_has_key(hash_table_t *table,
                           const char *key);
 
+/* Data provider request scheduler. */
+
+errno_t dp_sched_init(struct data_provider *provider);
+
+struct dp_sched_item *dp_sched_item_new(TALLOC_CTX *mem_ctx,
+                                        struct data_provider *provider,
+                                        enum dp_targets target,
+                                        enum dp_req_priority priority,
+                                        dp_sched_run_fn run_fn,
+                                        void *pvt);
+
+/* Returns true if the item may run immediately. Otherwise it is queued
+ * and run_fn is called once a slot for its target becomes available. */
+bool dp_sched_submit(struct dp_sched_item *item);
+
+/* Releases the slot of an active item or removes it from the queue.
+ * This is done automatically when the item is freed. */
+void dp_sched_release(struct dp_sched_item *item);
+
 /* Data provider request. */
 
 void dp_terminate_active_requests(struct data_provider *provider);
@@ -238,11 +341,109 @@ void _dp_req_with_reply(struct dp_client *dp_cli,
                          method, dp_flags, req_data, NULL, NULL, void,        \
                          reply_fn, output_dtype)
 
+void _dp_req_with_packed_reply(struct dp_client *dp_cli,
+                               const char *domain,
+                               const char *request_name,
+                               const char *custom_key,
+                               struct sbus_packed_request *packed_req,
+                               enum dp_targets target,
+                               enum dp_methods method,
+                               uint32_t dp_flags,
+                               void *request_data,
+                               dp_req_post_fn postprocess_fn,
+                               void *postprocess_data,
+                               dp_req_packed_reply_fn reply_fn,
+                               const char *output_dtype);
+
+/**
+ * Same as dp_req_with_reply_pp() for requests received over the packed
+ * transport. Both transports share the request table so identical requests
+ * are processed only once regardless of how they arrived.
+ */
+#define dp_req_with_packed_reply_pp(dp_cli, domain, req_name, req_key,        \
+                                    packed_req, target, method, dp_flags,     \
+                                    req_data, pp_fn, pp_data, pp_dtype,       \
+                                    reply_fn, output_dtype)                   \
+    do {                                                                      \
+        /* Check postprocess function parameter types. */                     \
+        void (*__pp_fn)(const char *, struct data_provider *,                 \
+            pp_dtype *, output_dtype *) = (pp_fn);                            \
+        pp_dtype *__pp_data = (pp_data);                                      \
+                                                                              \
+        /* Check reply function parameter types. */                           \
+        void (*__reply_fn)(const char *, struct sbus_packed_request *,        \
+            output_dtype *) = (reply_fn);                                     \
+                                                                              \
+        _dp_req_with_packed_reply(dp_cli, domain, req_name, req_key,          \
+                                  packed_req, target, method, dp_flags,       \
+                                  req_data, (dp_req_post_fn)__pp_fn,          \
+                                  __pp_data,                                  \
+                                  (dp_req_packed_reply_fn)__reply_fn,         \
+                                  #output_dtype);                             \
+    } while(0)
+
+#define dp_req_with_packed_reply(dp_cli, domain, req_name, req_key,           \
+                                 packed_req, target, method, dp_flags,        \
+                                 req_data, reply_fn, output_dtype)            \
+    dp_req_with_packed_reply_pp(dp_cli, domain, req_name, req_key,            \
+                                packed_req, target, method, dp_flags,         \
+                                req_data, NULL, NULL, void, reply_fn,         \
+                                output_dtype)
+
+void _dp_req_with_internal_reply(struct dp_client *dp_cli,
+                                 const char *domain,
+                                 const char *request_name,
+                                 const char *custom_key,
+                                 struct tevent_req *internal_req,
+                                 enum dp_targets target,
+                                 enum dp_methods method,
+                                 uint32_t dp_flags,
+                                 void *request_data,
+                                 dp_req_internal_reply_fn reply_fn,
+                                 const char *output_dtype);
+
+/**
+ * Same as dp_req_with_reply() for requests issued by the data provider
+ * itself. @internal_req is finished by @reply_fn or terminated with an
+ * error; its callback should be deferred since it may be called while
+ * other waiting requests are being replied to.
+ */
+#define dp_req_with_internal_reply(dp_cli, domain, req_name, req_key,         \
+                                   internal_req, target, method, dp_flags,    \
+                                   req_data, reply_fn, output_dtype)          \
+    do {                                                                      \
+        /* Check reply function parameter types. */                           \
+        void (*__reply_fn)(const char *, struct tevent_req *,                 \
+            output_dtype *) = (reply_fn);                                     \
+                                                                              \
+        _dp_req_with_internal_reply(dp_cli, domain, req_name, req_key,        \
+                                    internal_req, target, method, dp_flags,   \
+                                    req_data,                                 \
+                                    (dp_req_internal_reply_fn)__reply_fn,     \
+                                    #output_dtype);                           \
+    } while(0)
+
 /* Client shared functions. */
 
 errno_t dp_client_init(struct sbus_connection *conn, void *data);
 struct data_provider *dp_client_provider(struct dp_client *dp_cli);
 struct be_ctx *dp_client_be(struct dp_client *dp_cli);
 struct sbus_connection *dp_client_conn(struct dp_client *dp_cli);
+enum dp_clients dp_client_from_string(const char *name);
+
+/* Packed transport. */
+
+errno_t dp_init_packed_server(struct data_provider *provider);
+
+/* Returns provider and D-Bus client registered with the same name as the
+ * packed connection. */
+errno_t dp_packed_client(void *conn_data,
+                         struct data_provider **_provider,
+                         struct dp_client **_dp_cli);
+
+errno_t dp_get_account_info_packed_handler(struct sbus_packed_request *req,
+                                           void *data);
+
+errno_t dp_pam_packed_handler(struct sbus_packed_request *req, void *data);
 
 #endif /* _DP_PRIVATE_H_ */
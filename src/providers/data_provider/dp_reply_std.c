@@ -22,6 +22,7 @@
 
 #include "sbus/sssd_dbus.h"
 #include "providers/data_provider/dp_private.h"
+#include "providers/data_provider/dp_iface_generated.h"
 #include "providers/backend.h"
 #include "util/sss_utf8.h"
 #include "util/util.h"
@@ -85,6 +86,68 @@ void dp_req_reply_std(const char *request_name,
                                    DBUS_TYPE_INVALID);
 }
 
+void dp_req_reply_batch(const char *request_name,
+                        struct sbus_request *sbus_req,
+                        struct dp_reply_batch *reply)
+{
+    uint16_t *dp_errors;
+    uint32_t *errors;
+    const char **messages;
+    uint32_t i;
+
+    dp_errors = talloc_array(sbus_req, uint16_t, reply->count);
+    errors = talloc_array(sbus_req, uint32_t, reply->count);
+    messages = talloc_array(sbus_req, const char *, reply->count);
+    if (dp_errors == NULL || errors == NULL || messages == NULL) {
+        dp_req_reply_error(sbus_req, request_name, ENOMEM);
+        return;
+    }
+
+    for (i = 0; i < reply->count; i++) {
+        dp_errors[i] = reply->replies[i].dp_error;
+        errors[i] = reply->replies[i].error;
+        messages[i] = safe_be_req_err_msg(reply->replies[i].message,
+                                          reply->replies[i].dp_error);
+    }
+
+    DP_REQ_DEBUG(SSSDBG_TRACE_LIBS, request_name,
+                 "Returning %"PRIu32" results", reply->count);
+
+    iface_dp_getAccountInfoBatch_finish(sbus_req, dp_errors, reply->count,
+                                        errors, reply->count,
+                                        messages, reply->count);
+}
+
+void dp_req_reply_std_packed(const char *request_name,
+                             struct sbus_packed_request *packed_req,
+                             struct dp_reply_std *reply)
+{
+    struct sbus_packed_buf *body;
+    const char *safe_err_msg;
+    errno_t ret;
+
+    safe_err_msg = safe_be_req_err_msg(reply->message, reply->dp_error);
+
+    DP_REQ_DEBUG(SSSDBG_TRACE_LIBS, request_name, "Returning [%s]: %d,%d,%s",
+                 dp_err_to_string(reply->dp_error), reply->dp_error,
+                 reply->error, reply->message);
+
+    body = sbus_packed_buf_new(packed_req);
+    if (body == NULL) {
+        sbus_packed_request_fail(packed_req, ENOMEM);
+        return;
+    }
+
+    ret = iface_dp_getAccountInfo_pack_reply(body, reply->dp_error,
+                                             reply->error, safe_err_msg);
+    if (ret != EOK) {
+        sbus_packed_request_fail(packed_req, ret);
+        return;
+    }
+
+    sbus_packed_request_finish(packed_req, body);
+}
+
 void dp_reply_std_set(struct dp_reply_std *reply,
                       int dp_error,
                       int error,
@@ -27,6 +27,9 @@
 #include "providers/backend.h"
 #include "util/dlinklist.h"
 #include "util/util.h"
+#include "util/sss_trace.h"
+#include "util/sss_perf.h"
+#include "util/probes.h"
 
 struct dp_req {
     struct data_provider *provider;
@@ -43,8 +46,15 @@ struct dp_req {
 
     struct tevent_req *req;
     struct tevent_req *handler_req;
+    struct dp_req_params *params;
+    struct dp_sched_item *sched;
     void *request_data;
 
+    /* Tracing of the originating client request. */
+    uint64_t trace_id;
+    struct timeval created;
+    struct timeval started;
+
     /* Active request list. */
     struct dp_req *prev;
     struct dp_req *next;
@@ -160,6 +170,9 @@ dp_req_new(TALLOC_CTX *mem_ctx,
     dp_req->method = method;
     dp_req->request_data = request_data;
     dp_req->req = req;
+    dp_req->trace_id = sss_trace_current();
+    dp_req->created = tevent_timeval_current();
+    sss_perf_count(SSS_PERF_DP_REQUEST);
 
     ret = dp_attach_req(dp_req, provider, name, dp_flags);
     if (ret != EOK) {
@@ -169,6 +182,9 @@ dp_req_new(TALLOC_CTX *mem_ctx,
         return ret;
     }
 
+    PROBE(DP_REQ_NEW, dp_req->name, dp_target_to_string(target), method,
+          dp_req->trace_id);
+
     /* Now the request is created. We will return it even in case of error
      * so we can get better debug messages. */
 
@@ -190,6 +206,67 @@ dp_req_new(TALLOC_CTX *mem_ctx,
     return ret;
 }
 
+static enum dp_req_priority dp_req_priority(enum dp_targets target,
+                                            uint32_t dp_flags)
+{
+    if (dp_flags & DP_BACKGROUND) {
+        return DP_PRIO_BACKGROUND;
+    }
+
+    switch (target) {
+    case DPT_AUTH:
+    case DPT_ACCESS:
+    case DPT_CHPASS:
+    case DPT_SELINUX:
+        return DP_PRIO_INTERACTIVE;
+    default:
+        return DP_PRIO_LOOKUP;
+    }
+}
+
+static void dp_req_done(struct tevent_req *subreq);
+
+static errno_t dp_req_run(struct dp_req *dp_req)
+{
+    dp_req_send_fn send_fn;
+    uint64_t prev_trace_id;
+
+    sss_trace_span(dp_req->trace_id, SSS_TRACE_QUEUE, &dp_req->created);
+    dp_req->started = tevent_timeval_current();
+    PROBE(DP_REQ_RUN, dp_req->name, dp_target_to_string(dp_req->target));
+
+    /* The handler may be started from the scheduler so the trace
+     * identifier is not necessarily set here. */
+    prev_trace_id = sss_trace_set_current(dp_req->trace_id);
+    send_fn = dp_req->execute->send_fn;
+    dp_req->handler_req = send_fn(dp_req, dp_req->execute->method_data,
+                                  dp_req->request_data, dp_req->params);
+    sss_trace_set_current(prev_trace_id);
+    if (dp_req->handler_req == NULL) {
+        return ENOMEM;
+    }
+
+    tevent_req_set_callback(dp_req->handler_req, dp_req_done, dp_req->req);
+
+    return EOK;
+}
+
+static void dp_req_run_queued(struct dp_sched_item *item, void *pvt)
+{
+    struct dp_req *dp_req;
+    errno_t ret;
+
+    dp_req = talloc_get_type(pvt, struct dp_req);
+
+    DP_REQ_DEBUG(SSSDBG_TRACE_FUNC, dp_req->name, "Leaving queue.");
+
+    ret = dp_req_run(dp_req);
+    if (ret != EOK) {
+        dp_sched_release(item);
+        tevent_req_error(dp_req->req, ret);
+    }
+}
+
 static errno_t
 file_dp_request(TALLOC_CTX *mem_ctx,
                 struct data_provider *provider,
@@ -204,7 +281,6 @@ file_dp_request(TALLOC_CTX *mem_ctx,
                 struct dp_req **_dp_req)
 {
     struct dp_req_params *dp_params;
-    dp_req_send_fn send_fn;
     struct dp_req *dp_req;
     struct be_ctx *be_ctx;
     errno_t ret;
@@ -249,17 +325,17 @@ file_dp_request(TALLOC_CTX *mem_ctx,
     dp_params->domain = dp_req->domain;
     dp_params->target = dp_req->target;
     dp_params->method = dp_req->method;
+    dp_req->params = dp_params;
 
-    send_fn = dp_req->execute->send_fn;
-    dp_req->handler_req = send_fn(dp_req, dp_req->execute->method_data,
-                                  dp_req->request_data, dp_params);
-    if (dp_req->handler_req == NULL) {
+    /* The request is started by the scheduler. */
+    dp_req->sched = dp_sched_item_new(dp_req, provider, target,
+                                      dp_req_priority(target, dp_flags),
+                                      dp_req_run_queued, dp_req);
+    if (dp_req->sched == NULL) {
         ret = ENOMEM;
         goto done;
     }
 
-    *_dp_req = dp_req;
-
     ret = EOK;
 
 done:
@@ -272,8 +348,6 @@ struct dp_req_state {
     void *output_data;
 };
 
-static void dp_req_done(struct tevent_req *subreq);
-
 struct tevent_req *dp_req_send(TALLOC_CTX *mem_ctx,
                                struct data_provider *provider,
                                struct dp_client *dp_cli,
@@ -333,7 +407,17 @@ struct tevent_req *dp_req_send(TALLOC_CTX *mem_ctx,
 
     talloc_set_name_const(state->output_data, dp_req->execute->output_dtype);
 
-    tevent_req_set_callback(dp_req->handler_req, dp_req_done, req);
+    if (!dp_sched_submit(dp_req->sched)) {
+        DP_REQ_DEBUG(SSSDBG_TRACE_FUNC, dp_req->name,
+                     "Waiting for a free slot.");
+        return req;
+    }
+
+    ret = dp_req_run(dp_req);
+    if (ret != EOK) {
+        dp_sched_release(dp_req->sched);
+        goto immediately;
+    }
 
     return req;
 
@@ -362,9 +446,18 @@ static void dp_req_done(struct tevent_req *subreq)
     /* subreq is the same as dp_req->handler_req */
     talloc_zfree(subreq);
     state->dp_req->handler_req = NULL;
+    dp_sched_release(state->dp_req->sched);
+
+    sss_trace_span(state->dp_req->trace_id, SSS_TRACE_HANDLER,
+                   &state->dp_req->started);
+    sss_perf_record(SSS_PERF_HIST_DP_TARGET, state->dp_req->target,
+                    dp_target_to_string(state->dp_req->target),
+                    &state->dp_req->created);
 
     DP_REQ_DEBUG(SSSDBG_TRACE_FUNC, state->dp_req->name,
                  "Request handler finished [%d]: %s", ret, sss_strerror(ret));
+    PROBE(DP_REQ_DONE, state->dp_req->name,
+          dp_target_to_string(state->dp_req->target), ret);
 
     if (ret != EOK) {
         tevent_req_error(req, ret);
@@ -405,6 +498,15 @@ errno_t _dp_req_recv(TALLOC_CTX *mem_ctx,
 
 static void dp_terminate_request(struct dp_req *dp_req)
 {
+    if (dp_req->sched != NULL && dp_req->sched->queued) {
+        /* The request did not start yet. */
+        DP_REQ_DEBUG(SSSDBG_TRACE_ALL, dp_req->name, "Terminating queued.");
+
+        dp_sched_release(dp_req->sched);
+        tevent_req_error(dp_req->req, ERR_TERMINATED);
+        return;
+    }
+
     if (dp_req->handler_req == NULL) {
         /* This may occur when the handler already finished but the caller
          * of dp request did not yet recieved data/free dp_req. We just
@@ -417,6 +519,7 @@ static void dp_terminate_request(struct dp_req *dp_req)
     DP_REQ_DEBUG(SSSDBG_TRACE_ALL, dp_req->name, "Terminating.");
 
     talloc_zfree(dp_req->handler_req);
+    dp_sched_release(dp_req->sched);
     tevent_req_error(dp_req->req, ERR_TERMINATED);
 }
 
@@ -95,6 +95,38 @@ void dp_req_reply_error(struct sbus_request *sbus_req,
     sbus_request_fail_and_finish(sbus_req, error);
 }
 
+/* The request that waits for the reply, exactly one of them is set. */
+struct dp_req_waiter {
+    struct sbus_request *sbus_req;
+    dp_req_reply_fn reply_fn;
+
+    struct sbus_packed_request *packed_req;
+    dp_req_packed_reply_fn packed_reply_fn;
+
+    struct tevent_req *internal_req;
+    dp_req_internal_reply_fn internal_reply_fn;
+};
+
+/* Without @error the D-Bus request is killed with no reply. */
+static void dp_req_fail(struct sbus_request *sbus_req,
+                        struct sbus_packed_request *packed_req,
+                        struct tevent_req *internal_req,
+                        DBusError *error,
+                        errno_t ret)
+{
+    if (sbus_req != NULL) {
+        if (error != NULL) {
+            sbus_request_fail_and_finish(sbus_req, error);
+        } else {
+            talloc_free(sbus_req);
+        }
+    } else if (packed_req != NULL) {
+        sbus_packed_request_fail(packed_req, ret);
+    } else {
+        tevent_req_error(internal_req, ret);
+    }
+}
+
 static void dp_req_reply_list_error(struct dp_sbus_req_item *list,
                                     const char *req_name,
                                     errno_t ret)
@@ -107,26 +139,19 @@ static void dp_req_reply_list_error(struct dp_sbus_req_item *list,
     if (error == NULL) {
         DP_REQ_DEBUG(SSSDBG_CRIT_FAILURE, req_name,
                      "Out of memory, killing request...");
-
-        for (item = list; item != NULL; item = next_item) {
-            next_item = item->next;
-            talloc_free(item->sbus_req);
-        }
-
-        return;
     }
 
     for (item = list; item != NULL; item = next_item) {
         next_item = item->next;
-        sbus_request_fail_and_finish(item->sbus_req, error);
+        dp_req_fail(item->sbus_req, item->packed_req, item->internal_req,
+                    error, ret);
     }
 
     talloc_free(error);
     return;
 }
 
-static void dp_req_reply_list_success(struct dp_sbus_req_item *list,
-                                      dp_req_reply_fn reply_fn,
+static void dp_req_reply_list_success(struct dp_table_value *value,
                                       const char *request_name,
                                       void *output_data)
 {
@@ -135,9 +160,17 @@ static void dp_req_reply_list_success(struct dp_sbus_req_item *list,
 
     DP_REQ_DEBUG(SSSDBG_TRACE_FUNC, request_name, "Finished. Success.");
 
-    for (item = list; item != NULL; item = next_item) {
+    for (item = value->list; item != NULL; item = next_item) {
         next_item = item->next;
-        reply_fn(request_name, item->sbus_req, output_data);
+        if (item->sbus_req != NULL) {
+            value->reply_fn(request_name, item->sbus_req, output_data);
+        } else if (item->packed_req != NULL) {
+            value->packed_reply_fn(request_name, item->packed_req,
+                                   output_data);
+        } else {
+            value->internal_reply_fn(request_name, item->internal_req,
+                                     output_data);
+        }
     }
 }
 
@@ -148,41 +181,81 @@ struct dp_req_with_reply_state {
     dp_req_post_fn postprocess_fn;
 
     const char *output_dtype;
-    dp_req_reply_fn reply_fn;
     const char *key;
     const char *name;
 };
 
+/* Adds the waiting request to the reply table and remembers how to reply
+ * to it. */
+static errno_t dp_req_with_reply_add(struct data_provider *provider,
+                                     const char *key,
+                                     struct tevent_req *req,
+                                     const struct dp_req_waiter *waiter)
+{
+    hash_table_t *table = provider->requests.reply_table;
+    struct dp_table_value *value;
+    errno_t ret;
+
+    if (waiter->sbus_req != NULL) {
+        ret = dp_req_table_add(table, key, req, waiter->sbus_req);
+    } else if (waiter->packed_req != NULL) {
+        ret = dp_req_table_add_packed(table, key, req, waiter->packed_req);
+    } else {
+        ret = dp_req_table_add_internal(table, key, req,
+                                        waiter->internal_req);
+    }
+    if (ret != EOK) {
+        return ret;
+    }
+
+    value = dp_req_table_lookup(table, key);
+    if (value == NULL) {
+        return ERR_INTERNAL;
+    }
+
+    if (value->reply_fn == NULL) {
+        value->reply_fn = waiter->reply_fn;
+    }
+
+    if (value->packed_reply_fn == NULL) {
+        value->packed_reply_fn = waiter->packed_reply_fn;
+    }
+
+    if (value->internal_reply_fn == NULL) {
+        value->internal_reply_fn = waiter->internal_reply_fn;
+    }
+
+    return EOK;
+}
+
 static errno_t dp_req_with_reply_step(struct data_provider *provider,
                                       struct dp_client *dp_cli,
                                       const char *domain,
                                       const char *request_name,
                                       const char *custom_key,
-                                      struct sbus_request *sbus_req,
+                                      const struct dp_req_waiter *waiter,
                                       enum dp_targets target,
                                       enum dp_methods method,
                                       uint32_t dp_flags,
                                       void *request_data,
                                       dp_req_post_fn postprocess_fn,
                                       void *postprocess_data,
-                                      dp_req_reply_fn reply_fn,
                                       const char *output_dtype);
 
 static void dp_req_with_reply_done(struct tevent_req *req);
 
-void _dp_req_with_reply(struct dp_client *dp_cli,
-                        const char *domain,
-                        const char *request_name,
-                        const char *custom_key,
-                        struct sbus_request *sbus_req,
-                        enum dp_targets target,
-                        enum dp_methods method,
-                        uint32_t dp_flags,
-                        void *request_data,
-                        dp_req_post_fn postprocess_fn,
-                        void *postprocess_data,
-                        dp_req_reply_fn reply_fn,
-                        const char *output_dtype)
+static void dp_req_with_reply_internal(struct dp_client *dp_cli,
+                                       const char *domain,
+                                       const char *request_name,
+                                       const char *custom_key,
+                                       const struct dp_req_waiter *waiter,
+                                       enum dp_targets target,
+                                       enum dp_methods method,
+                                       uint32_t dp_flags,
+                                       void *request_data,
+                                       dp_req_post_fn postprocess_fn,
+                                       void *postprocess_data,
+                                       const char *output_dtype)
 {
     TALLOC_CTX *tmp_ctx;
     struct data_provider *provider;
@@ -203,7 +276,12 @@ void _dp_req_with_reply(struct dp_client *dp_cli,
          * to chain sbus request. In such cases, we generate a unique key from
          * sbus_req address that allows us to use the same code but the
          * chaining is logically disabled. */
-        custom_key = talloc_asprintf(tmp_ctx, "%p", sbus_req);
+        custom_key = talloc_asprintf(tmp_ctx, "%p",
+                                     waiter->sbus_req != NULL
+                                        ? (void *)waiter->sbus_req
+                                        : waiter->packed_req != NULL
+                                            ? (void *)waiter->packed_req
+                                            : (void *)waiter->internal_req);
         if (custom_key == NULL) {
             ret = ENOMEM;
             goto done;
@@ -218,8 +296,7 @@ void _dp_req_with_reply(struct dp_client *dp_cli,
 
     has_key = dp_req_table_has_key(provider->requests.reply_table, key);
     if (has_key) {
-        ret = dp_req_table_add(provider->requests.reply_table,
-                               key, NULL, sbus_req);
+        ret = dp_req_with_reply_add(provider, key, NULL, waiter);
         if (ret != EOK) {
             DEBUG(SSSDBG_CRIT_FAILURE, "Unable to attach sbus request to "
                   "existing data provider request [%d]: %s\n",
@@ -234,38 +311,112 @@ void _dp_req_with_reply(struct dp_client *dp_cli,
     }
 
     ret = dp_req_with_reply_step(provider, dp_cli, domain, request_name, key,
-                                 sbus_req, target, method, dp_flags,
-                                 request_data, postprocess_fn, postprocess_data,
-                                 reply_fn, output_dtype);
+                                 waiter, target, method, dp_flags,
+                                 request_data, postprocess_fn,
+                                 postprocess_data, output_dtype);
 
 done:
     if (ret == ENOMEM) {
         DEBUG(SSSDBG_CRIT_FAILURE, "Unable to allocate memory for "
               "new DP request, killing D-Bus request...\n");
-        talloc_zfree(sbus_req);
     } else if (ret != EOK) {
         DEBUG(SSSDBG_CRIT_FAILURE, "Unable to initialize "
               "DP request [%d: %s], killing D-Bus request...\n",
               ret, sss_strerror(ret));
-        talloc_zfree(sbus_req);
+    }
+
+    if (ret != EOK) {
+        dp_req_fail(waiter->sbus_req, waiter->packed_req,
+                    waiter->internal_req, NULL, ret);
     }
 
     talloc_free(tmp_ctx);
 }
 
+void _dp_req_with_reply(struct dp_client *dp_cli,
+                        const char *domain,
+                        const char *request_name,
+                        const char *custom_key,
+                        struct sbus_request *sbus_req,
+                        enum dp_targets target,
+                        enum dp_methods method,
+                        uint32_t dp_flags,
+                        void *request_data,
+                        dp_req_post_fn postprocess_fn,
+                        void *postprocess_data,
+                        dp_req_reply_fn reply_fn,
+                        const char *output_dtype)
+{
+    struct dp_req_waiter waiter = { 0 };
+
+    waiter.sbus_req = sbus_req;
+    waiter.reply_fn = reply_fn;
+
+    dp_req_with_reply_internal(dp_cli, domain, request_name, custom_key,
+                               &waiter, target, method, dp_flags,
+                               request_data, postprocess_fn, postprocess_data,
+                               output_dtype);
+}
+
+void _dp_req_with_packed_reply(struct dp_client *dp_cli,
+                               const char *domain,
+                               const char *request_name,
+                               const char *custom_key,
+                               struct sbus_packed_request *packed_req,
+                               enum dp_targets target,
+                               enum dp_methods method,
+                               uint32_t dp_flags,
+                               void *request_data,
+                               dp_req_post_fn postprocess_fn,
+                               void *postprocess_data,
+                               dp_req_packed_reply_fn reply_fn,
+                               const char *output_dtype)
+{
+    struct dp_req_waiter waiter = { 0 };
+
+    waiter.packed_req = packed_req;
+    waiter.packed_reply_fn = reply_fn;
+
+    dp_req_with_reply_internal(dp_cli, domain, request_name, custom_key,
+                               &waiter, target, method, dp_flags,
+                               request_data, postprocess_fn, postprocess_data,
+                               output_dtype);
+}
+
+void _dp_req_with_internal_reply(struct dp_client *dp_cli,
+                                 const char *domain,
+                                 const char *request_name,
+                                 const char *custom_key,
+                                 struct tevent_req *internal_req,
+                                 enum dp_targets target,
+                                 enum dp_methods method,
+                                 uint32_t dp_flags,
+                                 void *request_data,
+                                 dp_req_internal_reply_fn reply_fn,
+                                 const char *output_dtype)
+{
+    struct dp_req_waiter waiter = { 0 };
+
+    waiter.internal_req = internal_req;
+    waiter.internal_reply_fn = reply_fn;
+
+    dp_req_with_reply_internal(dp_cli, domain, request_name, custom_key,
+                               &waiter, target, method, dp_flags,
+                               request_data, NULL, NULL, output_dtype);
+}
+
 static errno_t dp_req_with_reply_step(struct data_provider *provider,
                                       struct dp_client *dp_cli,
                                       const char *domain,
                                       const char *request_name,
                                       const char *custom_key,
-                                      struct sbus_request *sbus_req,
+                                      const struct dp_req_waiter *waiter,
                                       enum dp_targets target,
                                       enum dp_methods method,
                                       uint32_t dp_flags,
                                       void *request_data,
                                       dp_req_post_fn postprocess_fn,
                                       void *postprocess_data,
-                                      dp_req_reply_fn reply_fn,
                                       const char *output_dtype)
 {
     TALLOC_CTX *tmp_ctx;
@@ -285,7 +436,6 @@ static errno_t dp_req_with_reply_step(struct data_provider *provider,
     }
 
     state->provider = provider;
-    state->reply_fn = reply_fn;
     state->key = talloc_strdup(state, custom_key);
     if (state->key == NULL) {
         ret = ENOMEM;
@@ -310,8 +460,7 @@ static errno_t dp_req_with_reply_step(struct data_provider *provider,
         goto done;
     }
 
-    ret = dp_req_table_add(provider->requests.reply_table,
-                           custom_key, req, sbus_req);
+    ret = dp_req_with_reply_add(provider, custom_key, req, waiter);
     if (ret != EOK) {
         DEBUG(SSSDBG_CRIT_FAILURE, "Unable to add request to table "
               "[%d]: %s\n", ret, sss_strerror(ret));
@@ -362,8 +511,7 @@ static void dp_req_with_reply_done(struct tevent_req *req)
     }
 
     /* Reply with data. */
-    dp_req_reply_list_success(value->list, state->reply_fn,
-                              state->name, output_data);
+    dp_req_reply_list_success(value, state->name, output_data);
 
 done:
     /* Freeing value will remove it from the table as well. */
@@ -0,0 +1,406 @@
+/*
+    SSSD
+
+    Data provider request scheduler
+
+    Copyright (C) 2016 Red Hat
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <talloc.h>
+#include <tevent.h>
+
+#include "providers/data_provider/dp_private.h"
+#include "providers/backend.h"
+#include "util/dlinklist.h"
+#include "util/strtonum.h"
+#include "util/util.h"
+
+/* Requests are started immediately as long as their target has a free
+ * slot. Otherwise they wait in one of the priority queues and are started
+ * in the order of priority when a running request of the same target
+ * finishes. Targets without a limit are never queued. */
+
+static errno_t dp_sched_parse_limit(struct data_provider *provider,
+                                    const char *limit)
+{
+    struct dp_sched_target *sched_target;
+    enum dp_targets target;
+    const char *name;
+    char *endptr;
+    char *sep;
+    uint32_t value;
+    size_t len;
+
+    sep = strchr(limit, ':');
+    if (sep == NULL) {
+        DEBUG(SSSDBG_CRIT_FAILURE, "Missing ':' in limit [%s]\n", limit);
+        return EINVAL;
+    }
+
+    len = sep - limit;
+    for (target = 0; target != DP_TARGET_SENTINEL; target++) {
+        name = dp_target_to_string(target);
+        if (strlen(name) == len && strncasecmp(limit, name, len) == 0) {
+            break;
+        }
+    }
+
+    if (target == DP_TARGET_SENTINEL) {
+        DEBUG(SSSDBG_CRIT_FAILURE, "Unknown target in limit [%s]\n", limit);
+        return EINVAL;
+    }
+
+    errno = 0;
+    value = strtouint32(sep + 1, &endptr, 10);
+    if (errno != 0 || *endptr != '\0' || endptr == sep + 1) {
+        DEBUG(SSSDBG_CRIT_FAILURE, "Invalid number in limit [%s]\n", limit);
+        return EINVAL;
+    }
+
+    sched_target = &provider->sched.targets[target];
+    sched_target->max_active = value;
+
+    DEBUG(SSSDBG_CONF_SETTINGS, "At most %u concurrent [%s] requests "
+          "will be running\n", value, dp_target_to_string(target));
+
+    return EOK;
+}
+
+errno_t dp_sched_init(struct data_provider *provider)
+{
+    struct be_ctx *be_ctx = provider->be_ctx;
+    TALLOC_CTX *tmp_ctx;
+    char **limits;
+    char *value;
+    errno_t ret;
+    int i;
+
+    tmp_ctx = talloc_new(NULL);
+    if (tmp_ctx == NULL) {
+        return ENOMEM;
+    }
+
+    ret = confdb_get_string(be_ctx->cdb, tmp_ctx, be_ctx->conf_path,
+                            CONFDB_DOMAIN_DP_REQUEST_LIMITS, NULL, &value);
+    if (ret != EOK) {
+        DEBUG(SSSDBG_CRIT_FAILURE, "Unable to read %s [%d]: %s\n",
+              CONFDB_DOMAIN_DP_REQUEST_LIMITS, ret, sss_strerror(ret));
+        goto done;
+    }
+
+    if (value == NULL) {
+        ret = EOK;
+        goto done;
+    }
+
+    ret = split_on_separator(tmp_ctx, value, ',', true, true, &limits, NULL);
+    if (ret != EOK) {
+        DEBUG(SSSDBG_CRIT_FAILURE, "Unable to parse %s [%d]: %s\n",
+              CONFDB_DOMAIN_DP_REQUEST_LIMITS, ret, sss_strerror(ret));
+        goto done;
+    }
+
+    for (i = 0; limits[i] != NULL; i++) {
+        ret = dp_sched_parse_limit(provider, limits[i]);
+        if (ret != EOK) {
+            goto done;
+        }
+    }
+
+    ret = EOK;
+
+done:
+    talloc_free(tmp_ctx);
+    return ret;
+}
+
+static uint64_t dp_sched_elapsed(struct timeval *start)
+{
+    struct timeval now;
+    struct timeval diff;
+
+    now = tevent_timeval_current();
+    diff = tevent_timeval_until(start, &now);
+
+    return (uint64_t)diff.tv_sec * 1000000 + diff.tv_usec;
+}
+
+static void dp_sched_activate(struct dp_sched_item *item)
+{
+    struct dp_sched_target *target;
+
+    target = &item->provider->sched.targets[item->target];
+    target->num_active++;
+    target->num_started++;
+    item->active = true;
+}
+
+static bool dp_sched_has_slot(struct data_provider *provider,
+                              enum dp_targets target)
+{
+    struct dp_sched_target *sched_target;
+
+    sched_target = &provider->sched.targets[target];
+
+    return sched_target->max_active == 0
+           || sched_target->num_active < sched_target->max_active;
+}
+
+static struct dp_sched_item *dp_sched_next(struct data_provider *provider)
+{
+    struct dp_sched_item *item;
+    enum dp_req_priority priority;
+
+    for (priority = 0; priority != DP_PRIO_SENTINEL; priority++) {
+        DLIST_FOR_EACH(item, provider->sched.queue[priority]) {
+            if (dp_sched_has_slot(provider, item->target)) {
+                return item;
+            }
+        }
+    }
+
+    return NULL;
+}
+
+static void dp_sched_dequeue(struct dp_sched_item *item)
+{
+    struct dp_sched_target *target;
+    uint64_t wait;
+
+    target = &item->provider->sched.targets[item->target];
+
+    DLIST_REMOVE(item->provider->sched.queue[item->priority], item);
+    item->queued = false;
+    target->num_queued--;
+
+    wait = dp_sched_elapsed(&item->queued_at);
+    target->wait_total += wait;
+    if (wait > target->wait_max) {
+        target->wait_max = wait;
+    }
+}
+
+static void dp_sched_dispatch(struct tevent_context *ev,
+                              struct tevent_immediate *im,
+                              void *private_data)
+{
+    struct data_provider *provider;
+    struct dp_sched_item *item;
+
+    provider = talloc_get_type(private_data, struct data_provider);
+
+    talloc_free(provider->sched.im);
+    provider->sched.im = NULL;
+
+    /* The run function may finish other requests synchronously so we
+     * look for the next item from the beginning every time. */
+    while ((item = dp_sched_next(provider)) != NULL) {
+        dp_sched_dequeue(item);
+        dp_sched_activate(item);
+
+        DEBUG(SSSDBG_TRACE_FUNC, "Starting queued [%s] request\n",
+              dp_target_to_string(item->target));
+
+        item->run_fn(item, item->pvt);
+    }
+}
+
+static void dp_sched_kick(struct data_provider *provider)
+{
+    enum dp_req_priority priority;
+    bool empty = true;
+
+    if (provider->sched.im != NULL || provider->terminating) {
+        return;
+    }
+
+    for (priority = 0; priority != DP_PRIO_SENTINEL; priority++) {
+        if (provider->sched.queue[priority] != NULL) {
+            empty = false;
+            break;
+        }
+    }
+
+    if (empty) {
+        return;
+    }
+
+    /* Do not start new requests from within the callback of the request
+     * that has just finished. */
+    provider->sched.im = tevent_create_immediate(provider);
+    if (provider->sched.im == NULL) {
+        DEBUG(SSSDBG_CRIT_FAILURE, "Out of memory?!\n");
+        return;
+    }
+
+    tevent_schedule_immediate(provider->sched.im, provider->ev,
+                              dp_sched_dispatch, provider);
+}
+
+void dp_sched_release(struct dp_sched_item *item)
+{
+    struct dp_sched_target *target;
+
+    target = &item->provider->sched.targets[item->target];
+
+    if (item->queued) {
+        DLIST_REMOVE(item->provider->sched.queue[item->priority], item);
+        item->queued = false;
+        target->num_queued--;
+        return;
+    }
+
+    if (!item->active) {
+        return;
+    }
+
+    item->active = false;
+    target->num_active--;
+
+    dp_sched_kick(item->provider);
+}
+
+static int dp_sched_item_destructor(struct dp_sched_item *item)
+{
+    dp_sched_release(item);
+
+    return 0;
+}
+
+struct dp_sched_item *dp_sched_item_new(TALLOC_CTX *mem_ctx,
+                                        struct data_provider *provider,
+                                        enum dp_targets target,
+                                        enum dp_req_priority priority,
+                                        dp_sched_run_fn run_fn,
+                                        void *pvt)
+{
+    struct dp_sched_item *item;
+
+    item = talloc_zero(mem_ctx, struct dp_sched_item);
+    if (item == NULL) {
+        return NULL;
+    }
+
+    item->provider = provider;
+    item->target = target;
+    item->priority = priority;
+    item->run_fn = run_fn;
+    item->pvt = pvt;
+
+    talloc_set_destructor(item, dp_sched_item_destructor);
+
+    return item;
+}
+
+bool dp_sched_submit(struct dp_sched_item *item)
+{
+    struct dp_sched_target *target;
+
+    target = &item->provider->sched.targets[item->target];
+
+    /* Respect requests that are already waiting for this target. */
+    if (target->num_queued == 0
+            && dp_sched_has_slot(item->provider, item->target)) {
+        dp_sched_activate(item);
+        return true;
+    }
+
+    item->queued_at = tevent_timeval_current();
+    item->queued = true;
+    DLIST_ADD_END(item->provider->sched.queue[item->priority], item,
+                  struct dp_sched_item *);
+
+    target->num_queued++;
+    target->num_delayed++;
+    if (target->num_queued > target->max_queued) {
+        target->max_queued = target->num_queued;
+    }
+
+    DEBUG(SSSDBG_TRACE_FUNC, "Request queued, [%s] has %u running and %u "
+          "waiting requests\n", dp_target_to_string(item->target),
+          target->num_active, target->num_queued);
+
+    return false;
+}
+
+struct dp_sched_background_state {
+    struct dp_sched_item *item;
+};
+
+static void dp_sched_background_run(struct dp_sched_item *item, void *pvt)
+{
+    struct tevent_req *req;
+
+    req = talloc_get_type(pvt, struct tevent_req);
+
+    tevent_req_done(req);
+}
+
+struct tevent_req *dp_sched_background_send(TALLOC_CTX *mem_ctx,
+                                            struct data_provider *provider,
+                                            enum dp_targets target)
+{
+    struct dp_sched_background_state *state;
+    struct tevent_req *req;
+    errno_t ret;
+
+    req = tevent_req_create(mem_ctx, &state,
+                            struct dp_sched_background_state);
+    if (req == NULL) {
+        DEBUG(SSSDBG_CRIT_FAILURE, "tevent_req_create() failed\n");
+        return NULL;
+    }
+
+    state->item = dp_sched_item_new(state, provider, target,
+                                    DP_PRIO_BACKGROUND,
+                                    dp_sched_background_run, req);
+    if (state->item == NULL) {
+        ret = ENOMEM;
+        goto immediately;
+    }
+
+    if (!dp_sched_submit(state->item)) {
+        DEBUG(SSSDBG_TRACE_FUNC, "Background [%s] request is waiting for "
+              "a free slot\n", dp_target_to_string(target));
+        return req;
+    }
+
+    ret = EOK;
+
+immediately:
+    if (ret == EOK) {
+        tevent_req_done(req);
+    } else {
+        tevent_req_error(req, ret);
+    }
+    tevent_req_post(req, provider->ev);
+
+    return req;
+}
+
+errno_t dp_sched_background_recv(TALLOC_CTX *mem_ctx,
+                                 struct tevent_req *req,
+                                 struct dp_sched_item **_slot)
+{
+    struct dp_sched_background_state *state;
+    state = tevent_req_data(req, struct dp_sched_background_state);
+
+    TEVENT_REQ_RETURN_ON_ERROR(req);
+
+    *_slot = talloc_steal(mem_ctx, state->item);
+
+    return EOK;
+}
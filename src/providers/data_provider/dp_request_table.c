@@ -57,14 +57,23 @@ dp_table_value_destructor(struct dp_table_value *value)
 
 static struct dp_sbus_req_item *
 dp_sbus_req_item_new(struct dp_table_value *value,
-                     struct sbus_request *sbus_req)
+                     struct sbus_request *sbus_req,
+                     struct sbus_packed_request *packed_req,
+                     struct tevent_req *internal_req)
 {
     struct dp_sbus_req_item *item;
 
     /* Attach to sbus_request so we ensure that this sbus_req is removed
      * from the list when it is unexpectedly freed, for example when
-     * client connection is dropped. */
-    item = talloc_zero(sbus_req, struct dp_sbus_req_item);
+     * client connection is dropped. Packed requests are freed together
+     * with their connection as well. */
+    if (sbus_req != NULL) {
+        item = talloc_zero(sbus_req, struct dp_sbus_req_item);
+    } else if (packed_req != NULL) {
+        item = talloc_zero(packed_req, struct dp_sbus_req_item);
+    } else {
+        item = talloc_zero(internal_req, struct dp_sbus_req_item);
+    }
     if (item == NULL) {
         DEBUG(SSSDBG_CRIT_FAILURE, "talloc_zero() failed\n");
         return NULL;
@@ -72,6 +81,8 @@ dp_sbus_req_item_new(struct dp_table_value *value,
 
     item->parent = value;
     item->sbus_req = sbus_req;
+    item->packed_req = packed_req;
+    item->internal_req = internal_req;
 
     talloc_set_destructor(item, dp_sbus_req_item_destructor);
 
@@ -119,7 +130,9 @@ struct dp_table_value *dp_req_table_lookup(hash_table_t *table,
 static errno_t dp_req_table_new_item(hash_table_t *table,
                                      const char *key,
                                      struct tevent_req *req,
-                                     struct sbus_request *sbus_req)
+                                     struct sbus_request *sbus_req,
+                                     struct sbus_packed_request *packed_req,
+                                     struct tevent_req *internal_req)
 {
     hash_key_t hkey;
     hash_value_t hvalue;
@@ -141,7 +154,8 @@ static errno_t dp_req_table_new_item(hash_table_t *table,
     }
 
     table_value->req = req;
-    table_value->list = dp_sbus_req_item_new(table_value, sbus_req);
+    table_value->list = dp_sbus_req_item_new(table_value, sbus_req,
+                                             packed_req, internal_req);
     if (table_value->list == NULL) {
         ret = ENOMEM;
         goto done;
@@ -175,11 +189,14 @@ done:
 
 static errno_t dp_req_table_mod_item(hash_table_t *table,
                                      struct dp_table_value *table_value,
-                                     struct sbus_request *sbus_req)
+                                     struct sbus_request *sbus_req,
+                                     struct sbus_packed_request *packed_req,
+                                     struct tevent_req *internal_req)
 {
     struct dp_sbus_req_item *item;
 
-    item = dp_sbus_req_item_new(table_value, sbus_req);
+    item = dp_sbus_req_item_new(table_value, sbus_req, packed_req,
+                                internal_req);
     if (item == NULL) {
         return ENOMEM;
     }
@@ -189,29 +206,67 @@ static errno_t dp_req_table_mod_item(hash_table_t *table,
     return EOK;
 }
 
+static errno_t dp_req_table_add_item(hash_table_t *table,
+                                     const char *key,
+                                     struct tevent_req *req,
+                                     struct sbus_request *sbus_req,
+                                     struct sbus_packed_request *packed_req,
+                                     struct tevent_req *internal_req)
+{
+    struct dp_table_value *table_value;
+
+    table_value = dp_req_table_lookup(table, key);
+    if (table_value == NULL) {
+        if (req == NULL) {
+            DEBUG(SSSDBG_CRIT_FAILURE, "Tevent request cannot be NULL\n");
+            return EINVAL;
+        }
+
+        return dp_req_table_new_item(table, key, req, sbus_req, packed_req,
+                                     internal_req);
+    }
+
+    return dp_req_table_mod_item(table, table_value, sbus_req, packed_req,
+                                 internal_req);
+}
+
 errno_t dp_req_table_add(hash_table_t *table,
                          const char *key,
                          struct tevent_req *req,
                          struct sbus_request *sbus_req)
 {
-    struct dp_table_value *table_value;
-
     if (sbus_req == NULL) {
         DEBUG(SSSDBG_CRIT_FAILURE, "SBUS request cannot be NULL\n");
         return EINVAL;
     }
 
-    table_value = dp_req_table_lookup(table, key);
-    if (table_value == NULL) {
-        if (req == NULL) {
-            DEBUG(SSSDBG_CRIT_FAILURE, "Tevent request cannot be NULL\n");
-            return EINVAL;
-        }
+    return dp_req_table_add_item(table, key, req, sbus_req, NULL, NULL);
+}
 
-        return dp_req_table_new_item(table, key, req, sbus_req);
+errno_t dp_req_table_add_packed(hash_table_t *table,
+                                const char *key,
+                                struct tevent_req *req,
+                                struct sbus_packed_request *packed_req)
+{
+    if (packed_req == NULL) {
+        DEBUG(SSSDBG_CRIT_FAILURE, "Packed request cannot be NULL\n");
+        return EINVAL;
+    }
+
+    return dp_req_table_add_item(table, key, req, NULL, packed_req, NULL);
+}
+
+errno_t dp_req_table_add_internal(hash_table_t *table,
+                                  const char *key,
+                                  struct tevent_req *req,
+                                  struct tevent_req *internal_req)
+{
+    if (internal_req == NULL) {
+        DEBUG(SSSDBG_CRIT_FAILURE, "Internal request cannot be NULL\n");
+        return EINVAL;
     }
 
-    return dp_req_table_mod_item(table, table_value, sbus_req);
+    return dp_req_table_add_item(table, key, req, NULL, NULL, internal_req);
 }
 
 void dp_req_table_del(hash_table_t *table,
@@ -26,4 +26,7 @@
 
 #define DP_PATH "/org/freedesktop/sssd/dataprovider"
 
+/* Maximum number of items in one getAccountInfoBatch call. */
+#define DP_ACCOUNT_BATCH_MAX 256
+
 #endif /* DP_RESPONDER_IFACE_H_ */
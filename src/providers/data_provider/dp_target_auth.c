@@ -27,6 +27,7 @@
 #include "providers/data_provider/dp_private.h"
 #include "providers/data_provider/dp_iface.h"
 #include "providers/backend.h"
+#include "responder/pam/pam_iface.h"
 #include "util/util.h"
 
 static void dp_pam_reply(struct sbus_request *sbus_req,
@@ -300,3 +301,207 @@ void dp_pam_handler_selinux_done(struct tevent_req *req)
     dp_pam_reply(state->sbus_req, state->request_name, pd);
     return;
 }
+
+static void dp_pam_packed_reply(struct sbus_packed_request *packed_req,
+                                const char *request_name,
+                                struct pam_data *pd)
+{
+    struct sbus_packed_buf *reply;
+    bool bret;
+
+    DP_REQ_DEBUG(SSSDBG_TRACE_LIBS, request_name,
+                 "Sending result [%d][%s]", pd->pam_status, pd->domain);
+
+    reply = sbus_packed_buf_new(packed_req);
+    if (reply == NULL) {
+        DP_REQ_DEBUG(SSSDBG_TRACE_LIBS, request_name,
+                     "Unable to acquire reply message");
+        sbus_packed_request_fail(packed_req, ENOMEM);
+        return;
+    }
+
+    bret = dp_pack_pam_response_packed(reply, pd);
+    if (!bret) {
+        DP_REQ_DEBUG(SSSDBG_TRACE_LIBS, request_name,
+                     "Unable to generate reply message");
+        sbus_packed_request_fail(packed_req, EIO);
+        return;
+    }
+
+    sbus_packed_request_finish(packed_req, reply);
+}
+
+struct dp_pam_packed_handler_state {
+    struct data_provider *provider;
+    struct dp_client *dp_cli;
+    struct sbus_packed_request *packed_req;
+    const char *request_name;
+};
+
+static void dp_pam_packed_handler_step_done(struct tevent_req *req);
+static void dp_pam_packed_handler_selinux_done(struct tevent_req *req);
+
+/* Same as dp_pam_handler(). PAM requests do not go through the reply table
+ * on either transport, each of them carries its own credentials and must
+ * reach the provider. */
+errno_t dp_pam_packed_handler(struct sbus_packed_request *packed_req,
+                              void *data)
+{
+    struct dp_pam_packed_handler_state *state;
+    struct data_provider *provider;
+    struct pam_data *pd = NULL;
+    struct dp_client *dp_cli;
+    enum dp_targets target;
+    enum dp_methods method;
+    const char *req_name;
+    struct tevent_req *req;
+    bool bret;
+    errno_t ret;
+
+    ret = dp_packed_client(data, &provider, &dp_cli);
+    if (ret != EOK) {
+        return ret;
+    }
+
+    state = talloc_zero(packed_req, struct dp_pam_packed_handler_state);
+    if (state == NULL) {
+        return ENOMEM;
+    }
+
+    bret = dp_unpack_pam_request_packed(packed_req->body, state, &pd);
+    if (bret == false) {
+        DEBUG(SSSDBG_CRIT_FAILURE, "Failed to parse message!\n");
+        return EINVAL;
+    }
+
+    pd->pam_status = PAM_SYSTEM_ERR;
+    if (pd->domain == NULL) {
+        pd->domain = talloc_strdup(pd, provider->be_ctx->domain->name);
+        if (pd->domain == NULL) {
+            return ENOMEM;
+        }
+    }
+
+    state->provider = provider;
+    state->dp_cli = dp_cli;
+    state->packed_req = packed_req;
+
+    DEBUG(SSSDBG_CONF_SETTINGS, "Got request with the following data\n");
+    DEBUG_PAM_DATA(SSSDBG_CONF_SETTINGS, pd);
+
+    choose_target(provider, pd, &target, &method, &req_name);
+    if (target == DP_TARGET_SENTINEL) {
+        dp_pam_packed_reply(packed_req, req_name, pd);
+        return EOK;
+    }
+
+    req = dp_req_send(state, provider, dp_cli, pd->domain, req_name,
+                      target, method, 0, pd, &state->request_name);
+    if (req == NULL) {
+        return ENOMEM;
+    }
+
+    tevent_req_set_callback(req, dp_pam_packed_handler_step_done, state);
+
+    return EOK;
+}
+
+static void dp_pam_packed_handler_step_done(struct tevent_req *req)
+{
+    struct dp_pam_packed_handler_state *state;
+    struct pam_data *pd;
+    errno_t ret;
+
+    state = tevent_req_callback_data(req, struct dp_pam_packed_handler_state);
+
+    ret = dp_req_recv(state, req, struct pam_data *, &pd);
+    talloc_zfree(req);
+    if (ret != EOK) {
+        sbus_packed_request_fail(state->packed_req, ret);
+        return;
+    }
+
+    if (!should_invoke_selinux(state->provider, pd)) {
+        /* State and request related data are freed with packed_req. */
+        dp_pam_packed_reply(state->packed_req, state->request_name, pd);
+        return;
+    }
+
+    req = dp_req_send(state, state->provider, state->dp_cli, pd->domain,
+                      "PAM SELinux", DPT_SELINUX, DPM_SELINUX_HANDLER,
+                      0, pd, NULL);
+    if (req == NULL) {
+        DP_REQ_DEBUG(SSSDBG_CRIT_FAILURE, state->request_name,
+                     "Unable to process SELinux, killing request...");
+        sbus_packed_request_fail(state->packed_req, ENOMEM);
+        return;
+    }
+
+    tevent_req_set_callback(req, dp_pam_packed_handler_selinux_done, state);
+}
+
+static void dp_pam_packed_handler_selinux_done(struct tevent_req *req)
+{
+    struct dp_pam_packed_handler_state *state;
+    struct pam_data *pd;
+    errno_t ret;
+
+    state = tevent_req_callback_data(req, struct dp_pam_packed_handler_state);
+
+    ret = dp_req_recv(state, req, struct pam_data *, &pd);
+    talloc_zfree(req);
+    if (ret != EOK) {
+        sbus_packed_request_fail(state->packed_req, ret);
+        return;
+    }
+
+    /* State and request related data are freed with packed_req. */
+    dp_pam_packed_reply(state->packed_req, state->request_name, pd);
+}
+
+void dp_sbus_invalidate_pam_access(struct data_provider *provider,
+                                   const char *domain,
+                                   const char *user)
+{
+    struct dp_client *dp_cli;
+    DBusMessage *msg;
+    dbus_bool_t dbret;
+
+    if (provider == NULL) {
+        return;
+    }
+
+    dp_cli = provider->clients[DPC_PAM];
+    if (dp_cli == NULL) {
+        return;
+    }
+
+    if (user == NULL) {
+        user = "";
+    }
+
+    msg = dbus_message_new_method_call(NULL,
+                                       PAM_ACCESSCACHE_PATH,
+                                       IFACE_PAM_ACCESSCACHE,
+                                       IFACE_PAM_ACCESSCACHE_INVALIDATE);
+    if (msg == NULL) {
+        DEBUG(SSSDBG_CRIT_FAILURE, "Out of memory?!\n");
+        return;
+    }
+
+    dbret = dbus_message_append_args(msg,
+                                     DBUS_TYPE_STRING, &user,
+                                     DBUS_TYPE_STRING, &domain,
+                                     DBUS_TYPE_INVALID);
+    if (!dbret) {
+        DEBUG(SSSDBG_CRIT_FAILURE, "Out of memory?!\n");
+        dbus_message_unref(msg);
+        return;
+    }
+
+    DEBUG(SSSDBG_TRACE_FUNC,
+          "Ordering PAM responder to invalidate account decisions\n");
+
+    sbus_conn_send_reply(dp_client_conn(dp_cli), msg);
+    dbus_message_unref(msg);
+}
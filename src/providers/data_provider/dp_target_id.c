@@ -18,6 +18,7 @@
     along with this program.  If not, see <http://www.gnu.org/licenses/>.
 */
 
+#include <stdlib.h>
 #include <talloc.h>
 #include <tevent.h>
 
@@ -91,6 +92,10 @@ struct dp_initgr_ctx {
     const char *domain;
     uint32_t gnum;
     uint32_t *groups;
+    /* sorted memberOf values of the user, including non-POSIX groups,
+     * only collected when the PAM responder is connected */
+    unsigned int mnum;
+    const char **memberof;
 };
 
 static struct dp_initgr_ctx *create_initgr_ctx(TALLOC_CTX *mem_ctx,
@@ -153,6 +158,153 @@ done:
     return ctx;
 }
 
+static int dp_initgr_gid_cmp(const void *a, const void *b)
+{
+    uint32_t gid_a = *(const uint32_t *)a;
+    uint32_t gid_b = *(const uint32_t *)b;
+
+    return gid_a < gid_b ? -1 : (gid_a > gid_b ? 1 : 0);
+}
+
+static int dp_initgr_memberof_cmp(const void *a, const void *b)
+{
+    return strcmp(*(const char * const *)a, *(const char * const *)b);
+}
+
+/* The initgroups result contains only POSIX groups, non-POSIX groups that
+ * access providers may check are taken from memberOf of the user. */
+static errno_t dp_initgr_get_memberof(TALLOC_CTX *mem_ctx,
+                                      struct sss_domain_info *domain,
+                                      const char *username,
+                                      unsigned int *_mnum,
+                                      const char ***_memberof)
+{
+    static const char *attrs[] = { SYSDB_MEMBEROF, NULL };
+    struct ldb_message_element *el;
+    struct ldb_result *res;
+    const char **memberof;
+    unsigned int i;
+    errno_t ret;
+
+    ret = sysdb_get_user_attr(mem_ctx, domain, username, attrs, &res);
+    if (ret != EOK) {
+        return ret;
+    }
+
+    if (res->count != 1) {
+        ret = ENOENT;
+        goto done;
+    }
+
+    el = ldb_msg_find_element(res->msgs[0], SYSDB_MEMBEROF);
+    if (el == NULL) {
+        *_mnum = 0;
+        *_memberof = NULL;
+        ret = EOK;
+        goto done;
+    }
+
+    memberof = talloc_array(mem_ctx, const char *, el->num_values);
+    if (memberof == NULL) {
+        ret = ENOMEM;
+        goto done;
+    }
+
+    for (i = 0; i < el->num_values; i++) {
+        memberof[i] = talloc_strndup(memberof,
+                                     (const char *)el->values[i].data,
+                                     el->values[i].length);
+        if (memberof[i] == NULL) {
+            talloc_free(memberof);
+            ret = ENOMEM;
+            goto done;
+        }
+    }
+
+    qsort(memberof, el->num_values, sizeof(const char *),
+          dp_initgr_memberof_cmp);
+
+    *_mnum = el->num_values;
+    *_memberof = memberof;
+    ret = EOK;
+
+done:
+    talloc_free(res);
+    return ret;
+}
+
+/* Compares the group membership cached before the request with the
+ * current one. Errors are reported as a change to stay on the safe side. */
+static bool dp_initgr_changed(struct data_provider *provider,
+                              struct dp_initgr_ctx *ctx)
+{
+    TALLOC_CTX *tmp_ctx;
+    struct sss_domain_info *domain;
+    struct dp_initgr_ctx *new_ctx;
+    struct ldb_result *res;
+    uint32_t *old_groups;
+    const char **memberof;
+    unsigned int mnum;
+    unsigned int i;
+    bool changed = true;
+    errno_t ret;
+
+    tmp_ctx = talloc_new(NULL);
+    if (tmp_ctx == NULL) {
+        return true;
+    }
+
+    domain = find_domain_by_name(provider->be_ctx->domain, ctx->domain, true);
+    if (domain == NULL) {
+        goto done;
+    }
+
+    ret = sysdb_initgroups(tmp_ctx, domain, ctx->username, &res);
+    if (ret != EOK || res->count == 0) {
+        goto done;
+    }
+
+    new_ctx = create_initgr_ctx(tmp_ctx, ctx->domain, res);
+    if (new_ctx == NULL || new_ctx->gnum != ctx->gnum) {
+        goto done;
+    }
+
+    if (ctx->gnum != 0) {
+        old_groups = talloc_memdup(tmp_ctx, ctx->groups,
+                                   ctx->gnum * sizeof(uint32_t));
+        if (old_groups == NULL) {
+            goto done;
+        }
+
+        qsort(old_groups, ctx->gnum, sizeof(uint32_t), dp_initgr_gid_cmp);
+        qsort(new_ctx->groups, new_ctx->gnum, sizeof(uint32_t),
+              dp_initgr_gid_cmp);
+
+        if (memcmp(old_groups, new_ctx->groups,
+                   ctx->gnum * sizeof(uint32_t)) != 0) {
+            goto done;
+        }
+    }
+
+    ret = dp_initgr_get_memberof(tmp_ctx, domain, ctx->username,
+                                 &mnum, &memberof);
+    if (ret != EOK || mnum != ctx->mnum) {
+        goto done;
+    }
+
+    for (i = 0; i < mnum; i++) {
+        if (strcmp(memberof[i], ctx->memberof[i]) != 0) {
+            goto done;
+        }
+    }
+
+    changed = false;
+
+done:
+    talloc_free(tmp_ctx);
+    return changed;
+}
+
 static void dp_req_initgr_pp(const char *req_name,
                              struct data_provider *provider,
                              struct dp_initgr_ctx *ctx,
@@ -163,6 +315,15 @@ static void dp_req_initgr_pp(const char *req_name,
     dbus_bool_t dbret;
     int num;
 
+    /* Access decisions cached by the PAM responder may depend on the
+     * group membership. */
+    if (provider->clients[DPC_PAM] != NULL
+            && dp_initgr_changed(provider, ctx)) {
+        DEBUG(SSSDBG_TRACE_FUNC, "Group membership of [%s] has changed\n",
+              ctx->username);
+        dp_sbus_invalidate_pam_access(provider, ctx->domain, ctx->username);
+    }
+
     dp_cli = provider->clients[DPC_NSS];
     if (dp_cli == NULL) {
         return;
@@ -199,20 +360,16 @@ static void dp_req_initgr_pp(const char *req_name,
     return;
 }
 
-static errno_t dp_initgroups(struct sbus_request *sbus_req,
-                             struct dp_client *dp_cli,
-                             const char *key,
-                             uint32_t dp_flags,
-                             struct dp_id_data *data)
+static errno_t dp_initgroups_prepare(TALLOC_CTX *mem_ctx,
+                                     struct be_ctx *be_ctx,
+                                     struct dp_id_data *data,
+                                     struct dp_initgr_ctx **_ctx)
 {
-    struct be_ctx *be_ctx;
     struct sss_domain_info *domain;
     struct dp_initgr_ctx *ctx;
     struct ldb_result *res;
     errno_t ret;
 
-    be_ctx = dp_client_be(dp_cli);
-
     if (data->domain == NULL) {
         domain = be_ctx->domain;
     } else {
@@ -222,7 +379,7 @@ static errno_t dp_initgroups(struct sbus_request *sbus_req,
         }
     }
 
-    ret = sysdb_initgroups(sbus_req, domain, data->filter_value, &res);
+    ret = sysdb_initgroups(mem_ctx, domain, data->filter_value, &res);
     if (ret == ENOENT || (ret == EOK && res->count == 0)) {
         /* There is no point in concacting NSS responder. Proceed as usual. */
         return EAGAIN;
@@ -232,17 +389,26 @@ static errno_t dp_initgroups(struct sbus_request *sbus_req,
         goto done;
     }
 
-    ctx = create_initgr_ctx(sbus_req, data->domain, res);
+    ctx = create_initgr_ctx(mem_ctx, data->domain, res);
     if (ctx == NULL) {
         ret = ENOMEM;
         goto done;
     }
 
-    dp_req_with_reply_pp(dp_cli, data->domain, "Initgroups", key,
-                      sbus_req, DPT_ID, DPM_ACCOUNT_HANDLER, dp_flags, data,
-                      dp_req_initgr_pp, ctx, struct dp_initgr_ctx,
-                      dp_req_reply_std, struct dp_reply_std);
+    if (be_ctx->provider->clients[DPC_PAM] != NULL) {
+        ret = dp_initgr_get_memberof(ctx, domain, ctx->username,
+                                     &ctx->mnum, &ctx->memberof);
+        if (ret != EOK) {
+            /* Cached access decisions are dropped after the request unless
+             * the user is not a member of any group. */
+            DEBUG(SSSDBG_MINOR_FAILURE, "Unable to get memberOf of [%s] "
+                  "[%d]: %s\n", ctx->username, ret, sss_strerror(ret));
+            ctx->mnum = 0;
+            ctx->memberof = NULL;
+        }
+    }
 
+    *_ctx = ctx;
     ret = EOK;
 
 done:
@@ -250,24 +416,43 @@ done:
     return ret;
 }
 
-errno_t dp_get_account_info_handler(struct sbus_request *sbus_req,
-                                    void *dp_cli,
-                                    uint32_t dp_flags,
-                                    uint32_t entry_type,
-                                    uint32_t attr_type,
-                                    const char *filter,
-                                    const char *domain,
-                                    const char *extra)
+static errno_t dp_initgroups(struct sbus_request *sbus_req,
+                             struct dp_client *dp_cli,
+                             const char *key,
+                             uint32_t dp_flags,
+                             struct dp_id_data *data)
 {
-    struct dp_id_data *data;
-    const char *key;
+    struct dp_initgr_ctx *ctx;
     errno_t ret;
 
+    ret = dp_initgroups_prepare(sbus_req, dp_client_be(dp_cli), data, &ctx);
+    if (ret != EOK) {
+        return ret;
+    }
+
+    dp_req_with_reply_pp(dp_cli, data->domain, "Initgroups", key,
+                      sbus_req, DPT_ID, DPM_ACCOUNT_HANDLER, dp_flags, data,
+                      dp_req_initgr_pp, ctx, struct dp_initgr_ctx,
+                      dp_req_reply_std, struct dp_reply_std);
+
+    return EOK;
+}
+
+static errno_t dp_id_data_create(TALLOC_CTX *mem_ctx,
+                                 uint32_t entry_type,
+                                 uint32_t attr_type,
+                                 const char *filter,
+                                 const char *domain,
+                                 const char *extra,
+                                 struct dp_id_data **_data)
+{
+    struct dp_id_data *data;
+
     if (!check_attr_type(attr_type)) {
         return EINVAL;
     }
 
-    data = talloc_zero(sbus_req, struct dp_id_data);
+    data = talloc_zero(mem_ctx, struct dp_id_data);
     if (data == NULL) {
         return ENOMEM;
     }
@@ -277,8 +462,8 @@ errno_t dp_get_account_info_handler(struct sbus_request *sbus_req,
     data->domain = domain;
 
     if (!check_and_parse_filter(data, filter, extra)) {
-        ret = EINVAL;
-        goto done;
+        talloc_free(data);
+        return EINVAL;
     }
 
     DEBUG(SSSDBG_FUNC_DATA,
@@ -286,6 +471,39 @@ errno_t dp_get_account_info_handler(struct sbus_request *sbus_req,
           data->entry_type, be_req2str(data->entry_type),
           attr_type, filter);
 
+    *_data = data;
+    return EOK;
+}
+
+/* Nobody waits interactively for enumeration. */
+static uint32_t dp_id_data_flags(struct dp_id_data *data, uint32_t dp_flags)
+{
+    if (data->filter_type == BE_FILTER_ENUM) {
+        return dp_flags | DP_BACKGROUND;
+    }
+
+    return dp_flags;
+}
+
+errno_t dp_get_account_info_handler(struct sbus_request *sbus_req,
+                                    void *dp_cli,
+                                    uint32_t dp_flags,
+                                    uint32_t entry_type,
+                                    uint32_t attr_type,
+                                    const char *filter,
+                                    const char *domain,
+                                    const char *extra)
+{
+    struct dp_id_data *data;
+    const char *key;
+    errno_t ret;
+
+    ret = dp_id_data_create(sbus_req, entry_type, attr_type, filter,
+                            domain, extra, &data);
+    if (ret != EOK) {
+        return ret;
+    }
+
     key = talloc_asprintf(data, "%u:%u:%s:%s:%s", data->entry_type,
                           data->attr_type, extra, domain, filter);
     if (key == NULL) {
@@ -301,7 +519,8 @@ errno_t dp_get_account_info_handler(struct sbus_request *sbus_req,
     }
 
     dp_req_with_reply(dp_cli, domain, "Account", key,
-                      sbus_req, DPT_ID, DPM_ACCOUNT_HANDLER, dp_flags, data,
+                      sbus_req, DPT_ID, DPM_ACCOUNT_HANDLER,
+                      dp_id_data_flags(data, dp_flags), data,
                       dp_req_reply_std, struct dp_reply_std);
 
     ret = EOK;
@@ -313,3 +532,446 @@ done:
 
     return ret;
 }
+
+/* Requests received over the packed transport share the reply table with
+ * the D-Bus ones, see dp_get_account_info_handler(). */
+errno_t dp_get_account_info_packed_handler(struct sbus_packed_request *req,
+                                           void *data)
+{
+    struct data_provider *provider;
+    struct dp_initgr_ctx *initgr_ctx;
+    struct dp_id_data *id_data;
+    struct dp_client *dp_cli;
+    uint32_t dp_flags;
+    uint32_t entry_type;
+    uint32_t attr_type;
+    const char *filter;
+    const char *domain;
+    const char *extra;
+    const char *key;
+    errno_t ret;
+
+    ret = dp_packed_client(data, &provider, &dp_cli);
+    if (ret != EOK) {
+        return ret;
+    }
+
+    ret = iface_dp_getAccountInfo_unpack(req->body, &dp_flags, &entry_type,
+                                         &attr_type, &filter, &domain, &extra);
+    if (ret != EOK) {
+        DEBUG(SSSDBG_CRIT_FAILURE, "Failed to parse message!\n");
+        return ret;
+    }
+
+    ret = dp_id_data_create(req, entry_type, attr_type, filter,
+                            domain, extra, &id_data);
+    if (ret != EOK) {
+        return ret;
+    }
+
+    key = talloc_asprintf(id_data, "%u:%u:%s:%s:%s", id_data->entry_type,
+                          id_data->attr_type, extra, domain, filter);
+    if (key == NULL) {
+        ret = ENOMEM;
+        goto done;
+    }
+
+    if ((id_data->entry_type & BE_REQ_TYPE_MASK) == BE_REQ_INITGROUPS) {
+        ret = dp_initgroups_prepare(req, provider->be_ctx, id_data,
+                                    &initgr_ctx);
+        if (ret == EOK) {
+            dp_req_with_packed_reply_pp(dp_cli, domain, "Initgroups", key,
+                                        req, DPT_ID, DPM_ACCOUNT_HANDLER,
+                                        dp_flags, id_data, dp_req_initgr_pp,
+                                        initgr_ctx, struct dp_initgr_ctx,
+                                        dp_req_reply_std_packed,
+                                        struct dp_reply_std);
+            goto done;
+        } else if (ret != EAGAIN) {
+            goto done;
+        }
+    }
+
+    dp_req_with_packed_reply(dp_cli, domain, "Account", key, req,
+                             DPT_ID, DPM_ACCOUNT_HANDLER,
+                             dp_id_data_flags(id_data, dp_flags), id_data,
+                             dp_req_reply_std_packed, struct dp_reply_std);
+
+    ret = EOK;
+
+done:
+    if (ret != EOK) {
+        talloc_free(id_data);
+    }
+
+    return ret;
+}
+
+struct dp_account_batch_state {
+    struct dp_reply_batch reply;
+
+    /* Position of each item passed to the batch handler in the reply. */
+    uint32_t *indexes;
+    uint32_t num_batched;
+    uint32_t num_pending;
+};
+
+struct dp_account_batch_item {
+    struct tevent_req *req;
+    uint32_t index;
+};
+
+static void dp_account_batch_item_reply(const char *req_name,
+                                        struct tevent_req *item_req,
+                                        struct dp_reply_std *reply);
+static void dp_account_batch_item_done(struct tevent_req *item_req);
+static void dp_account_batch_done(struct tevent_req *subreq);
+
+/* Items that are already being looked up and, when the provider does not
+ * implement batch lookups, all items are run as regular account requests
+ * through the request table so they are merged with identical getAccountInfo
+ * requests. The rest is passed to the provider as one batch. */
+static struct tevent_req *
+dp_account_batch_send(TALLOC_CTX *mem_ctx,
+                      struct tevent_context *ev,
+                      struct data_provider *provider,
+                      struct dp_client *dp_cli,
+                      const char *domain,
+                      uint32_t dp_flags,
+                      struct dp_id_batch_data *batch,
+                      const char **keys)
+{
+    struct dp_account_batch_state *state;
+    struct dp_account_batch_item *item;
+    struct dp_id_batch_data *subbatch = NULL;
+    struct tevent_req *item_req;
+    struct tevent_req *subreq;
+    struct tevent_req *req;
+    uint32_t item_flags;
+    bool use_batch;
+    char *table_key;
+    uint32_t i;
+    errno_t ret;
+
+    req = tevent_req_create(mem_ctx, &state, struct dp_account_batch_state);
+    if (req == NULL) {
+        DEBUG(SSSDBG_CRIT_FAILURE, "tevent_req_create() failed\n");
+        return NULL;
+    }
+
+    state->reply.count = batch->count;
+    state->reply.replies = talloc_zero_array(state, struct dp_reply_std,
+                                             batch->count);
+    if (state->reply.replies == NULL) {
+        ret = ENOMEM;
+        goto immediately;
+    }
+
+    use_batch = dp_method_enabled(provider, DPT_ID, DPM_ACCOUNT_BATCH_HANDLER);
+    if (use_batch) {
+        subbatch = talloc_zero(state, struct dp_id_batch_data);
+        state->indexes = talloc_zero_array(state, uint32_t, batch->count);
+        if (subbatch == NULL || state->indexes == NULL) {
+            ret = ENOMEM;
+            goto immediately;
+        }
+
+        subbatch->items = talloc_zero_array(subbatch, struct dp_id_data *,
+                                            batch->count);
+        if (subbatch->items == NULL) {
+            ret = ENOMEM;
+            goto immediately;
+        }
+    }
+
+    for (i = 0; i < batch->count; i++) {
+        item_flags = dp_id_data_flags(batch->items[i], dp_flags);
+
+        if (use_batch) {
+            table_key = dp_req_table_key(state, DPT_ID, DPM_ACCOUNT_HANDLER,
+                                         item_flags, keys[i]);
+            if (table_key == NULL) {
+                ret = ENOMEM;
+                goto immediately;
+            }
+
+            if (!dp_req_table_has_key(provider->requests.reply_table,
+                                      table_key)) {
+                state->indexes[subbatch->count] = i;
+                subbatch->items[subbatch->count] = batch->items[i];
+                subbatch->count++;
+                talloc_free(table_key);
+                continue;
+            }
+
+            talloc_free(table_key);
+        }
+
+        item_req = tevent_req_create(state, &item,
+                                     struct dp_account_batch_item);
+        if (item_req == NULL) {
+            ret = ENOMEM;
+            goto immediately;
+        }
+
+        item->req = req;
+        item->index = i;
+
+        /* The reply may arrive while the request table is walking through
+         * other waiting requests. */
+        tevent_req_defer_callback(item_req, ev);
+        tevent_req_set_callback(item_req, dp_account_batch_item_done, req);
+        state->num_pending++;
+
+        dp_req_with_internal_reply(dp_cli, domain, "Account", keys[i],
+                                   item_req, DPT_ID, DPM_ACCOUNT_HANDLER,
+                                   item_flags, batch->items[i],
+                                   dp_account_batch_item_reply,
+                                   struct dp_reply_std);
+    }
+
+    if (subbatch != NULL && subbatch->count > 0) {
+        subreq = dp_req_send(state, provider, dp_cli, domain, "Account Batch",
+                             DPT_ID, DPM_ACCOUNT_BATCH_HANDLER, dp_flags,
+                             subbatch, NULL);
+        if (subreq == NULL) {
+            ret = ENOMEM;
+            goto immediately;
+        }
+
+        tevent_req_set_callback(subreq, dp_account_batch_done, req);
+        state->num_batched = subbatch->count;
+        state->num_pending++;
+    }
+
+    return req;
+
+immediately:
+    tevent_req_error(req, ret);
+    tevent_req_post(req, ev);
+
+    return req;
+}
+
+static void dp_account_batch_finished(struct tevent_req *req)
+{
+    struct dp_account_batch_state *state;
+
+    state = tevent_req_data(req, struct dp_account_batch_state);
+
+    /* The request may have already failed while setting up the items. */
+    if (!tevent_req_is_in_progress(req)) {
+        return;
+    }
+
+    state->num_pending--;
+    if (state->num_pending == 0) {
+        tevent_req_done(req);
+    }
+}
+
+static void dp_account_batch_item_reply(const char *req_name,
+                                        struct tevent_req *item_req,
+                                        struct dp_reply_std *reply)
+{
+    struct dp_account_batch_state *state;
+    struct dp_account_batch_item *item;
+
+    item = tevent_req_data(item_req, struct dp_account_batch_item);
+    state = tevent_req_data(item->req, struct dp_account_batch_state);
+
+    dp_reply_std_set(&state->reply.replies[item->index],
+                     reply->dp_error, reply->error,
+                     talloc_strdup(state->reply.replies, reply->message));
+
+    tevent_req_done(item_req);
+}
+
+static void dp_account_batch_item_done(struct tevent_req *item_req)
+{
+    struct dp_account_batch_state *state;
+    struct dp_account_batch_item *item;
+    struct tevent_req *req;
+    enum tevent_req_state tstate;
+    uint64_t err;
+
+    req = tevent_req_callback_data(item_req, struct tevent_req);
+    state = tevent_req_data(req, struct dp_account_batch_state);
+    item = tevent_req_data(item_req, struct dp_account_batch_item);
+
+    if (tevent_req_is_error(item_req, &tstate, &err)) {
+        dp_reply_std_set(&state->reply.replies[item->index], DP_ERR_DECIDE,
+                         tstate == TEVENT_REQ_USER_ERROR ? err : EIO, NULL);
+    }
+    talloc_free(item_req);
+
+    dp_account_batch_finished(req);
+}
+
+static void dp_account_batch_done(struct tevent_req *subreq)
+{
+    struct dp_account_batch_state *state;
+    struct dp_reply_batch *reply;
+    struct dp_reply_std *output;
+    struct tevent_req *req;
+    uint32_t i;
+    errno_t ret;
+
+    req = tevent_req_callback_data(subreq, struct tevent_req);
+    state = tevent_req_data(req, struct dp_account_batch_state);
+
+    ret = dp_req_recv_ptr(state, subreq, struct dp_reply_batch, &reply);
+    talloc_zfree(subreq);
+    if (ret != EOK) {
+        tevent_req_error(req, ret);
+        return;
+    }
+
+    if (reply->count != state->num_batched) {
+        DEBUG(SSSDBG_CRIT_FAILURE, "Bug: provider returned %"PRIu32
+              " results for %"PRIu32" items\n",
+              reply->count, state->num_batched);
+        tevent_req_error(req, ERR_INTERNAL);
+        return;
+    }
+
+    for (i = 0; i < reply->count; i++) {
+        output = &state->reply.replies[state->indexes[i]];
+        dp_reply_std_set(output, reply->replies[i].dp_error,
+                         reply->replies[i].error,
+                         talloc_strdup(state->reply.replies,
+                                       reply->replies[i].message));
+    }
+    talloc_free(reply);
+
+    dp_account_batch_finished(req);
+}
+
+static errno_t dp_account_batch_recv(TALLOC_CTX *mem_ctx,
+                                     struct tevent_req *req,
+                                     struct dp_reply_batch **_reply)
+{
+    struct dp_account_batch_state *state;
+    struct dp_reply_batch *reply;
+    state = tevent_req_data(req, struct dp_account_batch_state);
+
+    TEVENT_REQ_RETURN_ON_ERROR(req);
+
+    reply = talloc_zero(mem_ctx, struct dp_reply_batch);
+    if (reply == NULL) {
+        return ENOMEM;
+    }
+
+    reply->count = state->reply.count;
+    reply->replies = talloc_steal(reply, state->reply.replies);
+    *_reply = reply;
+
+    return EOK;
+}
+
+struct dp_get_account_info_batch_state {
+    struct sbus_request *sbus_req;
+};
+
+static void dp_get_account_info_batch_done(struct tevent_req *subreq);
+
+errno_t dp_get_account_info_batch_handler(struct sbus_request *sbus_req,
+                                          void *dp_cli,
+                                          uint32_t dp_flags,
+                                          uint32_t *entry_types,
+                                          int num_entry_types,
+                                          uint32_t attr_type,
+                                          const char **filters,
+                                          int num_filters,
+                                          const char *domain,
+                                          const char **extras,
+                                          int num_extras)
+{
+    struct dp_get_account_info_batch_state *state;
+    struct dp_id_batch_data *batch;
+    struct data_provider *provider;
+    struct tevent_req *subreq;
+    const char **keys;
+    uint32_t i;
+    errno_t ret;
+
+    if (num_entry_types != num_filters || num_entry_types != num_extras
+            || num_entry_types <= 0 || num_entry_types > DP_ACCOUNT_BATCH_MAX) {
+        DEBUG(SSSDBG_CRIT_FAILURE, "Invalid batch size [%d:%d:%d]\n",
+              num_entry_types, num_filters, num_extras);
+        return EINVAL;
+    }
+
+    provider = dp_client_provider(dp_cli);
+
+    state = talloc_zero(sbus_req, struct dp_get_account_info_batch_state);
+    if (state == NULL) {
+        return ENOMEM;
+    }
+    state->sbus_req = sbus_req;
+
+    batch = talloc_zero(state, struct dp_id_batch_data);
+    if (batch == NULL) {
+        return ENOMEM;
+    }
+
+    batch->count = num_entry_types;
+    batch->items = talloc_zero_array(batch, struct dp_id_data *, batch->count);
+    keys = talloc_zero_array(batch, const char *, batch->count);
+    if (batch->items == NULL || keys == NULL) {
+        return ENOMEM;
+    }
+
+    for (i = 0; i < batch->count; i++) {
+        /* Initgroups needs post-processing of the whole request,
+         * send it with getAccountInfo instead. */
+        if ((entry_types[i] & BE_REQ_TYPE_MASK) == BE_REQ_INITGROUPS) {
+            DEBUG(SSSDBG_CRIT_FAILURE, "Initgroups can not be batched\n");
+            return EINVAL;
+        }
+
+        ret = dp_id_data_create(batch->items, entry_types[i], attr_type,
+                                filters[i], domain, extras[i],
+                                &batch->items[i]);
+        if (ret != EOK) {
+            return ret;
+        }
+
+        /* Same key as getAccountInfo uses. */
+        keys[i] = talloc_asprintf(keys, "%u:%u:%s:%s:%s", entry_types[i],
+                                  attr_type, extras[i], domain, filters[i]);
+        if (keys[i] == NULL) {
+            return ENOMEM;
+        }
+    }
+
+    subreq = dp_account_batch_send(state, provider->ev, provider, dp_cli,
+                                   domain, dp_flags, batch, keys);
+    if (subreq == NULL) {
+        return ENOMEM;
+    }
+
+    tevent_req_set_callback(subreq, dp_get_account_info_batch_done, state);
+
+    return EOK;
+}
+
+static void dp_get_account_info_batch_done(struct tevent_req *subreq)
+{
+    struct dp_get_account_info_batch_state *state;
+    struct dp_reply_batch *reply;
+    errno_t ret;
+
+    state = tevent_req_callback_data(subreq,
+                                     struct dp_get_account_info_batch_state);
+
+    ret = dp_account_batch_recv(state, subreq, &reply);
+    talloc_zfree(subreq);
+    if (ret != EOK) {
+        dp_req_reply_error(state->sbus_req, "Account Batch", ret);
+        return;
+    }
+
+    /* State and request related data are freed with sbus_req. */
+    dp_req_reply_batch("Account Batch", state->sbus_req, reply);
+}
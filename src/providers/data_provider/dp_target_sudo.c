@@ -191,6 +191,10 @@ errno_t dp_sudo_handler(struct sbus_request *sbus_req, void *dp_cli)
     key = dp_sudo_get_key(data->type);
     name = dp_sudo_get_name(data->type);
 
+    if (data->type == BE_REQ_SUDO_FULL) {
+        dp_flags |= DP_BACKGROUND;
+    }
+
     dp_req_with_reply(dp_cli, NULL, name, key, sbus_req, DPT_SUDO,
                       DPM_SUDO_HANDLER, dp_flags, data,
                       dp_req_reply_std, struct dp_reply_std);
@@ -65,6 +65,7 @@ struct mon_cli_iface monitor_be_methods = {
     .clearMemcache = NULL,
     .clearEnumCache = NULL,
     .sysbusReconnect = NULL,
+    .perfStats = monitor_common_perf_stats,
 };
 
 bool be_is_offline(struct be_ctx *ctx)
@@ -374,6 +375,7 @@ errno_t be_process_init(TALLOC_CTX *mem_ctx,
                         struct confdb_ctx *cdb)
 {
     uint32_t refresh_interval;
+    struct be_ptask *refresh_task;
     struct tevent_signal *tes;
     struct be_ctx *be_ctx;
     errno_t ret;
@@ -439,12 +441,15 @@ errno_t be_process_init(TALLOC_CTX *mem_ctx,
         ret = be_ptask_create(be_ctx, be_ctx, refresh_interval, 30, 5, 0,
                               refresh_interval, BE_PTASK_OFFLINE_SKIP, 0,
                               be_refresh_send, be_refresh_recv,
-                              be_ctx->refresh_ctx, "Refresh Records", NULL);
+                              be_ctx->refresh_ctx, "Refresh Records",
+                              &refresh_task);
         if (ret != EOK) {
             DEBUG(SSSDBG_FATAL_FAILURE,
                   "Unable to initialize refresh periodic task\n");
             goto done;
         }
+
+        be_ptask_set_dp_target(refresh_task, DPT_ID);
     }
 
     ret = dp_init(be_ctx->ev, be_ctx, be_ctx->uid, be_ctx->gid);
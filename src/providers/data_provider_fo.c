@@ -49,6 +49,12 @@ static int be_fo_get_options(struct be_ctx *ctx,
     opts->retry_timeout = 30;
     opts->srv_retry_neg_timeout = 15;
     opts->family_order = ctx->be_res->family_order;
+    opts->probe_count = dp_opt_get_int(ctx->be_res->opts,
+                                       DP_RES_OPT_PROBE_COUNT);
+    opts->probe_stagger = dp_opt_get_int(ctx->be_res->opts,
+                                         DP_RES_OPT_PROBE_STAGGER);
+    opts->probe_timeout = dp_opt_get_int(ctx->be_res->opts,
+                                         DP_RES_OPT_PROBE_TIMEOUT);
 
     return EOK;
 }
@@ -331,6 +337,21 @@ int be_fo_get_server_count(struct be_ctx *ctx, const char *service_name)
     return fo_get_server_count(svc_data->fo_service);
 }
 
+int be_fo_set_service_probe(struct be_ctx *ctx, const char *service_name,
+                            int default_port)
+{
+    struct be_svc_data *svc;
+
+    svc = be_fo_find_svc_data(ctx, service_name);
+    if (NULL == svc) {
+        return ENOENT;
+    }
+
+    fo_set_service_probe(svc->fo_service, default_port);
+
+    return EOK;
+}
+
 int be_fo_add_server(struct be_ctx *ctx, const char *service_name,
                      const char *server, int port, void *user_data,
                      bool primary)
@@ -824,6 +845,10 @@ static struct dp_option dp_res_default_opts[] = {
     { "dns_resolver_timeout", DP_OPT_NUMBER, { .number = 6 }, NULL_NUMBER },
     { "dns_resolver_op_timeout", DP_OPT_NUMBER, { .number = 6 }, NULL_NUMBER },
     { "dns_discovery_domain", DP_OPT_STRING, NULL_STRING, NULL_STRING },
+    { "failover_probe_count", DP_OPT_NUMBER, { .number = 0 }, NULL_NUMBER },
+    { "failover_probe_stagger", DP_OPT_NUMBER, { .number = 250 }, NULL_NUMBER },
+    { "failover_probe_timeout", DP_OPT_NUMBER, { .number = 3 }, NULL_NUMBER },
+    { "dns_cache_max_ttl", DP_OPT_NUMBER, { .number = 300 }, NULL_NUMBER },
     DP_OPTION_TERMINATOR
 };
 
@@ -864,6 +889,7 @@ static errno_t be_res_get_opts(struct be_resolv_ctx *res_ctx,
 
 errno_t be_res_init(struct be_ctx *ctx)
 {
+    int cache_max_ttl;
     errno_t ret;
 
     if (ctx->be_res != NULL) {
@@ -890,5 +916,10 @@ errno_t be_res_init(struct be_ctx *ctx)
         return ret;
     }
 
+    cache_max_ttl = dp_opt_get_int(ctx->be_res->opts, DP_RES_OPT_CACHE_MAX_TTL);
+    if (cache_max_ttl > 0) {
+        resolv_set_cache_max_ttl(ctx->be_res->resolv, cache_max_ttl);
+    }
+
     return EOK;
 }
@@ -321,3 +321,213 @@ bool dp_unpack_pam_response(DBusMessage *msg, struct pam_data *pd, DBusError *db
 
     return true;
 }
+
+static bool dp_pack_pam_authtok_packed(struct sbus_packed_buf *buf,
+                                       struct sss_auth_token *authtok)
+{
+    errno_t ret;
+
+    ret = sbus_packed_put_uint32(buf, sss_authtok_get_type(authtok));
+    if (ret != EOK) {
+        return false;
+    }
+
+    ret = sbus_packed_put_blob(buf, sss_authtok_get_data(authtok),
+                               sss_authtok_get_size(authtok));
+    if (ret != EOK) {
+        return false;
+    }
+
+    return true;
+}
+
+static bool dp_unpack_pam_authtok_packed(struct sbus_packed_buf *buf,
+                                         struct sss_auth_token *authtok)
+{
+    const uint8_t *data;
+    uint32_t type;
+    uint32_t len;
+    errno_t ret;
+
+    ret = sbus_packed_get_uint32(buf, &type);
+    if (ret != EOK) {
+        return false;
+    }
+
+    ret = sbus_packed_get_blob(buf, &data, &len);
+    if (ret != EOK) {
+        return false;
+    }
+
+    ret = sss_authtok_set(authtok, type, data, len);
+    if (ret != EOK) {
+        DEBUG(SSSDBG_CRIT_FAILURE,
+              "Failed to set auth token: %d [%s]\n", ret, strerror(ret));
+        return false;
+    }
+
+    return true;
+}
+
+bool dp_pack_pam_request_packed(struct sbus_packed_buf *buf,
+                                struct pam_data *pd)
+{
+    errno_t ret;
+
+    if (pd->user == NULL) return false;
+
+    ret = sbus_packed_put_int32(buf, pd->cmd);
+    if (ret != EOK) return false;
+    ret = sbus_packed_put_string(buf, pd->user);
+    if (ret != EOK) return false;
+    ret = sbus_packed_put_string(buf, pd->domain);
+    if (ret != EOK) return false;
+    /* Keep the same semantics as D-Bus which can't deal with NULL. */
+    ret = sbus_packed_put_string(buf, pd->service ? pd->service : "");
+    if (ret != EOK) return false;
+    ret = sbus_packed_put_string(buf, pd->tty ? pd->tty : "");
+    if (ret != EOK) return false;
+    ret = sbus_packed_put_string(buf, pd->ruser ? pd->ruser : "");
+    if (ret != EOK) return false;
+    ret = sbus_packed_put_string(buf, pd->rhost ? pd->rhost : "");
+    if (ret != EOK) return false;
+
+    if (!dp_pack_pam_authtok_packed(buf, pd->authtok)) return false;
+    if (!dp_pack_pam_authtok_packed(buf, pd->newauthtok)) return false;
+
+    ret = sbus_packed_put_int32(buf, pd->priv);
+    if (ret != EOK) return false;
+    ret = sbus_packed_put_uint32(buf, pd->cli_pid);
+    if (ret != EOK) return false;
+
+    return true;
+}
+
+bool dp_unpack_pam_request_packed(struct sbus_packed_buf *buf,
+                                  TALLOC_CTX *mem_ctx,
+                                  struct pam_data **new_pd)
+{
+    struct pam_data pd;
+    int32_t pd_cmd;
+    int32_t pd_priv;
+    errno_t ret;
+
+    memset(&pd, 0, sizeof(pd));
+    *new_pd = NULL;
+
+    ret = sbus_packed_get_int32(buf, &pd_cmd);
+    if (ret != EOK) goto fail;
+    ret = sbus_packed_get_string(buf, (const char **)&pd.user);
+    if (ret != EOK) goto fail;
+    ret = sbus_packed_get_string(buf, (const char **)&pd.domain);
+    if (ret != EOK) goto fail;
+    ret = sbus_packed_get_string(buf, (const char **)&pd.service);
+    if (ret != EOK) goto fail;
+    ret = sbus_packed_get_string(buf, (const char **)&pd.tty);
+    if (ret != EOK) goto fail;
+    ret = sbus_packed_get_string(buf, (const char **)&pd.ruser);
+    if (ret != EOK) goto fail;
+    ret = sbus_packed_get_string(buf, (const char **)&pd.rhost);
+    if (ret != EOK) goto fail;
+
+    if (pd.user == NULL) {
+        goto fail;
+    }
+
+    pd.cmd = pd_cmd;
+
+    ret = copy_pam_data(mem_ctx, &pd, new_pd);
+    if (ret != EOK) {
+        DEBUG(SSSDBG_CRIT_FAILURE, "copy_pam_data failed.\n");
+        return false;
+    }
+
+    if (!dp_unpack_pam_authtok_packed(buf, (*new_pd)->authtok)) goto fail;
+    if (!dp_unpack_pam_authtok_packed(buf, (*new_pd)->newauthtok)) goto fail;
+
+    ret = sbus_packed_get_int32(buf, &pd_priv);
+    if (ret != EOK) goto fail;
+    ret = sbus_packed_get_uint32(buf, &(*new_pd)->cli_pid);
+    if (ret != EOK) goto fail;
+
+    (*new_pd)->priv = pd_priv;
+
+    return true;
+
+fail:
+    DEBUG(SSSDBG_CRIT_FAILURE, "Unable to parse packed pam request.\n");
+    if (*new_pd != NULL) {
+        talloc_zfree(*new_pd);
+    }
+    return false;
+}
+
+bool dp_pack_pam_response_packed(struct sbus_packed_buf *buf,
+                                 struct pam_data *pd)
+{
+    struct response_data *resp;
+    uint32_t count;
+    errno_t ret;
+
+    ret = sbus_packed_put_uint32(buf, pd->pam_status);
+    if (ret != EOK) return false;
+    ret = sbus_packed_put_uint32(buf, pd->account_locked);
+    if (ret != EOK) return false;
+
+    for (count = 0, resp = pd->resp_list; resp != NULL; resp = resp->next) {
+        count++;
+    }
+
+    ret = sbus_packed_put_uint32(buf, count);
+    if (ret != EOK) return false;
+
+    for (resp = pd->resp_list; resp != NULL; resp = resp->next) {
+        ret = sbus_packed_put_uint32(buf, resp->type);
+        if (ret != EOK) return false;
+        ret = sbus_packed_put_blob(buf, resp->data, resp->len);
+        if (ret != EOK) return false;
+    }
+
+    return true;
+}
+
+bool dp_unpack_pam_response_packed(struct sbus_packed_buf *buf,
+                                   struct pam_data *pd)
+{
+    const uint8_t *data;
+    uint32_t pam_status;
+    uint32_t account_locked;
+    uint32_t count;
+    uint32_t type;
+    uint32_t len;
+    uint32_t i;
+    errno_t ret;
+
+    ret = sbus_packed_get_uint32(buf, &pam_status);
+    if (ret != EOK) goto fail;
+    ret = sbus_packed_get_uint32(buf, &account_locked);
+    if (ret != EOK) goto fail;
+    ret = sbus_packed_get_uint32(buf, &count);
+    if (ret != EOK) goto fail;
+
+    pd->pam_status = pam_status;
+    pd->account_locked = account_locked;
+
+    for (i = 0; i < count; i++) {
+        ret = sbus_packed_get_uint32(buf, &type);
+        if (ret != EOK) goto fail;
+        ret = sbus_packed_get_blob(buf, &data, &len);
+        if (ret != EOK) goto fail;
+
+        if (pam_add_response(pd, type, len, data) != EOK) {
+            DEBUG(SSSDBG_CRIT_FAILURE, "pam_add_response failed.\n");
+            return false;
+        }
+    }
+
+    return true;
+
+fail:
+    DEBUG(SSSDBG_CRIT_FAILURE, "pam response format error.\n");
+    return false;
+}
@@ -33,6 +33,7 @@
 #include "util/dlinklist.h"
 #include "util/refcount.h"
 #include "util/util.h"
+#include "util/sss_sockets.h"
 #include "providers/fail_over.h"
 #include "resolv/async_resolv.h"
 
@@ -71,6 +72,11 @@ struct fo_service {
     struct fo_server *last_tried_server;
     struct fo_server *server_list;
 
+    /* Probe servers in parallel when looking for a new one, using
+     * probe_port for servers that were added without a port. */
+    bool probe;
+    int probe_port;
+
     /* Function pointed by user_data_cmp returns 0 if user_data is equal
      * or nonzero value if not. Set to NULL if no user data comparison
      * is needed in fail over duplicate servers detection.
@@ -93,6 +99,10 @@ struct fo_server {
     struct timeval last_status_change;
     struct server_common *common;
 
+    /* Time in microseconds it took the server to accept a connection when
+     * it was last probed, 0 if it was not measured yet. */
+    uint64_t latency;
+
     TALLOC_CTX *fo_internal_owner;
 };
 
@@ -159,6 +169,9 @@ fo_context_init(TALLOC_CTX *mem_ctx, struct fo_options *opts)
     ctx->opts->retry_timeout = opts->retry_timeout;
     ctx->opts->family_order  = opts->family_order;
     ctx->opts->service_resolv_timeout = opts->service_resolv_timeout;
+    ctx->opts->probe_count = opts->probe_count;
+    ctx->opts->probe_stagger = opts->probe_stagger;
+    ctx->opts->probe_timeout = opts->probe_timeout;
 
     DEBUG(SSSDBG_TRACE_FUNC,
           "Created new fail over context, retry timeout is %ld\n",
@@ -996,6 +1009,16 @@ resolve_srv_send(TALLOC_CTX *mem_ctx, struct tevent_context *ev,
 static int
 resolve_srv_recv(struct tevent_req *req, struct fo_server **server);
 
+/* Forward declarations for parallel probing */
+static bool fo_probe_wanted(struct fo_server *server);
+static struct tevent_req *
+fo_probe_send(TALLOC_CTX *mem_ctx, struct tevent_context *ev,
+              struct resolv_ctx *resolv, struct fo_ctx *ctx,
+              struct fo_server *first);
+static int
+fo_probe_recv(struct tevent_req *req, struct fo_server **server);
+static void fo_resolve_service_probe_done(struct tevent_req *subreq);
+
 struct tevent_req *
 fo_resolve_service_send(TALLOC_CTX *mem_ctx, struct tevent_context *ev,
                         struct resolv_ctx *resolv, struct fo_ctx *ctx,
@@ -1130,6 +1153,17 @@ fo_resolve_service_server(struct tevent_req *req)
     struct tevent_req *subreq;
     int ret;
 
+    if (fo_probe_wanted(state->server)) {
+        subreq = fo_probe_send(state, state->ev, state->resolv,
+                               state->fo_ctx, state->server);
+        if (subreq == NULL) {
+            tevent_req_error(req, ENOMEM);
+            return true;
+        }
+        tevent_req_set_callback(subreq, fo_resolve_service_probe_done, req);
+        return false;
+    }
+
     switch (get_server_status(state->server)) {
     case SERVER_NAME_NOT_RESOLVED: /* Request name resolution. */
         subreq = resolv_gethostbyname_send(state->server->common,
@@ -1162,6 +1196,25 @@ fo_resolve_service_server(struct tevent_req *req)
     return false;
 }
 
+static void
+fo_resolve_service_probe_done(struct tevent_req *subreq)
+{
+    struct tevent_req *req = tevent_req_callback_data(subreq,
+                                                      struct tevent_req);
+    struct resolve_service_state *state = tevent_req_data(req,
+                                        struct resolve_service_state);
+    int ret;
+
+    ret = fo_probe_recv(subreq, &state->server);
+    talloc_zfree(subreq);
+    if (ret != EOK) {
+        tevent_req_error(req, ret);
+        return;
+    }
+
+    tevent_req_done(req);
+}
+
 static void
 fo_resolve_service_done(struct tevent_req *subreq)
 {
@@ -1482,6 +1535,506 @@ resolve_srv_recv(struct tevent_req *req, struct fo_server **server)
     return EOK;
 }
 
+/*******************************************************************
+ * Probe several servers in parallel.                              *
+ *******************************************************************/
+
+static bool
+fo_probe_wanted(struct fo_server *server)
+{
+    struct fo_service *service = server->service;
+
+    if (!service->probe || service->ctx->opts->probe_count < 2) {
+        return false;
+    }
+
+    /* A server that is known to work is used right away. */
+    if (server == service->active_server || server->common == NULL) {
+        return false;
+    }
+
+    return true;
+}
+
+static uint64_t
+fo_probe_key(struct fo_server *server)
+{
+    return server->latency == 0 ? UINT64_MAX : server->latency;
+}
+
+/*
+ * Collect up to probe_count servers of the same kind (primary or backup)
+ * as the first one. Servers that answered fast before are tried first,
+ * the order of the servers that were not measured yet is kept.
+ */
+static errno_t
+fo_probe_candidates(TALLOC_CTX *mem_ctx, struct fo_server *first,
+                    struct fo_server ***_candidates, size_t *_num)
+{
+    struct fo_service *service = first->service;
+    struct fo_server **candidates;
+    struct fo_server *server;
+    size_t num = 0;
+    size_t i;
+    size_t j;
+
+    candidates = talloc_zero_array(mem_ctx, struct fo_server *,
+                                   fo_get_server_count(service) + 1);
+    if (candidates == NULL) {
+        return ENOMEM;
+    }
+
+    candidates[num++] = first;
+    DLIST_FOR_EACH(server, service->server_list) {
+        if (server == first
+                || server->common == NULL
+                || server->primary != first->primary
+                || !service_works(server)) {
+            continue;
+        }
+
+        candidates[num++] = server;
+    }
+
+    for (i = 1; i < num; i++) {
+        server = candidates[i];
+        for (j = i; j > 0 && fo_probe_key(candidates[j - 1])
+                                            > fo_probe_key(server); j--) {
+            candidates[j] = candidates[j - 1];
+        }
+        candidates[j] = server;
+    }
+
+    if (num > (size_t) service->ctx->opts->probe_count) {
+        num = service->ctx->opts->probe_count;
+    }
+
+    for (i = 0; i < num; i++) {
+        fo_ref_server(candidates, candidates[i]);
+    }
+
+    *_candidates = candidates;
+    *_num = num;
+    return EOK;
+}
+
+/* Wait until the name of the server is resolved. */
+struct fo_probe_resolve_state {
+    struct fo_server *server;
+};
+
+static struct tevent_req *
+fo_probe_resolve_send(TALLOC_CTX *mem_ctx, struct tevent_context *ev,
+                      struct resolv_ctx *resolv, struct fo_ctx *ctx,
+                      struct fo_server *server)
+{
+    struct fo_probe_resolve_state *state;
+    struct tevent_req *req;
+    struct tevent_req *subreq;
+    int ret;
+
+    req = tevent_req_create(mem_ctx, &state, struct fo_probe_resolve_state);
+    if (req == NULL) {
+        return NULL;
+    }
+
+    state->server = server;
+
+    switch (get_server_status(server)) {
+    case SERVER_NAME_NOT_RESOLVED:
+        subreq = resolv_gethostbyname_send(server->common, ev, resolv,
+                                           server->common->name,
+                                           ctx->opts->family_order,
+                                           default_host_dbs);
+        if (subreq == NULL) {
+            ret = ENOMEM;
+            goto immediately;
+        }
+        tevent_req_set_callback(subreq, fo_resolve_service_done,
+                                server->common);
+        fo_set_server_status(server, SERVER_RESOLVING_NAME);
+        /* FALLTHROUGH */
+    case SERVER_RESOLVING_NAME:
+        ret = set_lookup_hook(ev, server, req);
+        if (ret != EOK) {
+            goto immediately;
+        }
+        return req;
+    case SERVER_NOT_WORKING:
+        ret = EAGAIN;
+        goto immediately;
+    default:
+        ret = EOK;
+        goto immediately;
+    }
+
+immediately:
+    if (ret == EOK) {
+        tevent_req_done(req);
+    } else {
+        tevent_req_error(req, ret);
+    }
+    tevent_req_post(req, ev);
+
+    return req;
+}
+
+static int
+fo_probe_resolve_recv(struct tevent_req *req)
+{
+    TEVENT_REQ_RETURN_ON_ERROR(req);
+
+    return EOK;
+}
+
+/* Resolve one server and open a TCP connection to it. */
+struct fo_probe_server_state {
+    struct tevent_context *ev;
+    struct fo_server *server;
+    int timeout;
+
+    struct timeval start;
+    uint64_t latency;
+};
+
+static void fo_probe_server_resolved(struct tevent_req *subreq);
+static void fo_probe_server_connected(struct tevent_req *subreq);
+
+static struct tevent_req *
+fo_probe_server_send(TALLOC_CTX *mem_ctx, struct tevent_context *ev,
+                     struct resolv_ctx *resolv, struct fo_ctx *ctx,
+                     struct fo_server *server)
+{
+    struct fo_probe_server_state *state;
+    struct tevent_req *req;
+    struct tevent_req *subreq;
+
+    req = tevent_req_create(mem_ctx, &state, struct fo_probe_server_state);
+    if (req == NULL) {
+        return NULL;
+    }
+
+    state->ev = ev;
+    state->server = server;
+    state->timeout = ctx->opts->probe_timeout;
+
+    DEBUG(SSSDBG_TRACE_FUNC, "Probing server '%s'\n", SERVER_NAME(server));
+
+    subreq = fo_probe_resolve_send(state, ev, resolv, ctx, server);
+    if (subreq == NULL) {
+        tevent_req_error(req, ENOMEM);
+        tevent_req_post(req, ev);
+        return req;
+    }
+    tevent_req_set_callback(subreq, fo_probe_server_resolved, req);
+
+    return req;
+}
+
+static void fo_probe_server_resolved(struct tevent_req *subreq)
+{
+    struct tevent_req *req = tevent_req_callback_data(subreq,
+                                                      struct tevent_req);
+    struct fo_probe_server_state *state = tevent_req_data(req,
+                                            struct fo_probe_server_state);
+    struct sockaddr_storage *sockaddr;
+    int port;
+    int ret;
+
+    ret = fo_probe_resolve_recv(subreq);
+    talloc_zfree(subreq);
+    if (ret != EOK) {
+        tevent_req_error(req, ret);
+        return;
+    }
+
+    port = state->server->port;
+    if (port == 0) {
+        port = state->server->service->probe_port;
+    }
+
+    if (port == 0) {
+        /* There is nothing to connect to, the name is all we can check. */
+        tevent_req_done(req);
+        return;
+    }
+
+    sockaddr = resolv_get_sockaddr_address(state,
+                                           state->server->common->rhostent,
+                                           port);
+    if (sockaddr == NULL) {
+        tevent_req_error(req, EIO);
+        return;
+    }
+
+    /* Only the connect time is compared, resolving the name may have been
+     * answered from the cache for some of the servers. */
+    state->start = tevent_timeval_current();
+
+    subreq = sssd_async_socket_init_send(state, state->ev, sockaddr,
+                                         sizeof(struct sockaddr_storage),
+                                         state->timeout);
+    if (subreq == NULL) {
+        tevent_req_error(req, ENOMEM);
+        return;
+    }
+    tevent_req_set_callback(subreq, fo_probe_server_connected, req);
+}
+
+static void fo_probe_server_connected(struct tevent_req *subreq)
+{
+    struct tevent_req *req = tevent_req_callback_data(subreq,
+                                                      struct tevent_req);
+    struct fo_probe_server_state *state = tevent_req_data(req,
+                                            struct fo_probe_server_state);
+    struct timeval now;
+    struct timeval diff;
+    int sd;
+    int ret;
+
+    ret = sssd_async_socket_init_recv(subreq, &sd);
+    talloc_zfree(subreq);
+    if (ret != EOK) {
+        tevent_req_error(req, ret);
+        return;
+    }
+
+    /* The caller opens its own connection. */
+    close(sd);
+
+    now = tevent_timeval_current();
+    diff = tevent_timeval_until(&state->start, &now);
+    state->latency = (uint64_t) diff.tv_sec * 1000000 + diff.tv_usec;
+    if (state->latency == 0) {
+        state->latency = 1;
+    }
+
+    tevent_req_done(req);
+}
+
+static int
+fo_probe_server_recv(struct tevent_req *req, uint64_t *_latency)
+{
+    struct fo_probe_server_state *state = tevent_req_data(req,
+                                            struct fo_probe_server_state);
+
+    TEVENT_REQ_RETURN_ON_ERROR(req);
+
+    *_latency = state->latency;
+
+    return EOK;
+}
+
+/*
+ * Probe the candidates one after another, starting the next one after
+ * probe_stagger milliseconds or as soon as the previous one failed. The
+ * first server that accepts a connection wins and the remaining probes
+ * are cancelled.
+ */
+struct fo_probe_state {
+    struct tevent_context *ev;
+    struct resolv_ctx *resolv;
+    struct fo_ctx *fo_ctx;
+
+    struct fo_server **candidates;
+    struct tevent_req **probes;
+    size_t num_candidates;
+    size_t next;
+    size_t pending;
+    struct tevent_timer *stagger_te;
+
+    struct fo_server *server;
+};
+
+static errno_t fo_probe_next(struct tevent_req *req);
+static void fo_probe_stagger(struct tevent_context *ev,
+                             struct tevent_timer *te,
+                             struct timeval tv, void *pvt);
+static void fo_probe_done(struct tevent_req *subreq);
+
+static struct tevent_req *
+fo_probe_send(TALLOC_CTX *mem_ctx, struct tevent_context *ev,
+              struct resolv_ctx *resolv, struct fo_ctx *ctx,
+              struct fo_server *first)
+{
+    struct fo_probe_state *state;
+    struct tevent_req *req;
+    errno_t ret;
+
+    req = tevent_req_create(mem_ctx, &state, struct fo_probe_state);
+    if (req == NULL) {
+        return NULL;
+    }
+
+    state->ev = ev;
+    state->resolv = resolv;
+    state->fo_ctx = ctx;
+    state->server = first;
+
+    ret = fo_probe_candidates(state, first, &state->candidates,
+                              &state->num_candidates);
+    if (ret != EOK) {
+        goto immediately;
+    }
+
+    state->probes = talloc_zero_array(state, struct tevent_req *,
+                                      state->num_candidates);
+    if (state->probes == NULL) {
+        ret = ENOMEM;
+        goto immediately;
+    }
+
+    DEBUG(SSSDBG_TRACE_FUNC, "Probing up to %zu servers of service '%s'\n",
+          state->num_candidates, first->service->name);
+
+    ret = fo_probe_next(req);
+    if (ret != EOK) {
+        goto immediately;
+    }
+
+    return req;
+
+immediately:
+    tevent_req_error(req, ret);
+    tevent_req_post(req, ev);
+
+    return req;
+}
+
+static errno_t fo_probe_next(struct tevent_req *req)
+{
+    struct fo_probe_state *state = tevent_req_data(req, struct fo_probe_state);
+    struct tevent_req *subreq;
+    struct timeval tv;
+
+    talloc_zfree(state->stagger_te);
+
+    if (state->next >= state->num_candidates) {
+        return EOK;
+    }
+
+    subreq = fo_probe_server_send(state, state->ev, state->resolv,
+                                  state->fo_ctx,
+                                  state->candidates[state->next]);
+    if (subreq == NULL) {
+        return ENOMEM;
+    }
+    tevent_req_set_callback(subreq, fo_probe_done, req);
+
+    state->probes[state->next] = subreq;
+    state->next++;
+    state->pending++;
+
+    if (state->next < state->num_candidates) {
+        tv = tevent_timeval_current_ofs(0,
+                               state->fo_ctx->opts->probe_stagger * 1000);
+        state->stagger_te = tevent_add_timer(state->ev, state, tv,
+                                             fo_probe_stagger, req);
+        if (state->stagger_te == NULL) {
+            return ENOMEM;
+        }
+    }
+
+    return EOK;
+}
+
+static void fo_probe_stagger(struct tevent_context *ev,
+                             struct tevent_timer *te,
+                             struct timeval tv, void *pvt)
+{
+    struct tevent_req *req = talloc_get_type(pvt, struct tevent_req);
+    struct fo_probe_state *state = tevent_req_data(req, struct fo_probe_state);
+    errno_t ret;
+
+    state->stagger_te = NULL;
+
+    ret = fo_probe_next(req);
+    if (ret != EOK) {
+        tevent_req_error(req, ret);
+    }
+}
+
+static void fo_probe_done(struct tevent_req *subreq)
+{
+    struct tevent_req *req = tevent_req_callback_data(subreq,
+                                                      struct tevent_req);
+    struct fo_probe_state *state = tevent_req_data(req, struct fo_probe_state);
+    struct fo_server *server = NULL;
+    uint64_t latency;
+    size_t i;
+    int ret;
+
+    for (i = 0; i < state->next; i++) {
+        if (state->probes[i] == subreq) {
+            server = state->candidates[i];
+            state->probes[i] = NULL;
+            break;
+        }
+    }
+    state->pending--;
+
+    ret = fo_probe_server_recv(subreq, &latency);
+    talloc_zfree(subreq);
+    if (server == NULL) {
+        tevent_req_error(req, EFAULT);
+        return;
+    }
+
+    if (ret != EOK) {
+        DEBUG(SSSDBG_MINOR_FAILURE, "Probe of server '%s' failed [%d]: %s\n",
+              SERVER_NAME(server), ret, sss_strerror(ret));
+        server->latency = 0;
+        if (ret != EAGAIN) {
+            /* EAGAIN means that the name was not resolved and the server
+             * is already marked accordingly. Otherwise only the probed port
+             * failed, other services of the same host may still work. */
+            fo_set_port_status(server, PORT_NOT_WORKING);
+        }
+
+        if (state->pending == 0 && state->next == state->num_candidates) {
+            /* Let the caller mark the first server and try again. */
+            tevent_req_error(req, EAGAIN);
+            return;
+        }
+
+        ret = fo_probe_next(req);
+        if (ret != EOK) {
+            tevent_req_error(req, ret);
+        }
+        return;
+    }
+
+    if (latency != 0) {
+        server->latency = latency;
+    }
+
+    DEBUG(SSSDBG_TRACE_FUNC, "Server '%s' answered first after %"PRIu64" us\n",
+          SERVER_NAME(server), latency);
+
+    /* Cancel the other probes. */
+    talloc_zfree(state->stagger_te);
+    for (i = 0; i < state->next; i++) {
+        talloc_zfree(state->probes[i]);
+    }
+
+    state->server = server;
+    server->service->last_tried_server = server;
+    tevent_req_done(req);
+}
+
+static int
+fo_probe_recv(struct tevent_req *req, struct fo_server **server)
+{
+    struct fo_probe_state *state = tevent_req_data(req, struct fo_probe_state);
+
+    /* always return the server, the caller marks it on error */
+    *server = state->server;
+
+    TEVENT_REQ_RETURN_ON_ERROR(req);
+
+    return EOK;
+}
+
 /*******************************************************************
  *     Get Fully Qualified Domain Name of the host machine         *
  *******************************************************************/
@@ -1519,6 +2072,9 @@ fo_set_port_status(struct fo_server *server, enum port_status status)
 
     server->port_status = status;
     gettimeofday(&server->last_status_change, NULL);
+    if (status == PORT_NOT_WORKING) {
+        server->latency = 0;
+    }
     if (status == PORT_WORKING) {
         fo_set_server_status(server, SERVER_WORKING);
         server->service->active_server = server;
@@ -1573,6 +2129,19 @@ fo_get_server_user_data(struct fo_server *server)
     return server->user_data;
 }
 
+uint64_t
+fo_get_server_latency(struct fo_server *server)
+{
+    return server->latency;
+}
+
+void
+fo_set_service_probe(struct fo_service *service, int default_port)
+{
+    service->probe = true;
+    service->probe_port = default_port;
+}
+
 int
 fo_get_server_port(struct fo_server *server)
 {
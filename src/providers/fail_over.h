@@ -76,12 +76,21 @@ struct fo_server;
  *
  * The family_order member specifies the order of address families to
  * try when looking up the service.
+ *
+ * The 'probe_count' member specifies how many servers of a service that
+ * enabled probing are tried in parallel when a new server is needed. The
+ * probes are started 'probe_stagger' milliseconds apart and a connection
+ * attempt is abandoned after 'probe_timeout' seconds. Values of
+ * 'probe_count' lower than 2 disable probing.
  */
 struct fo_options {
     time_t srv_retry_neg_timeout;
     time_t retry_timeout;
     int service_resolv_timeout;
     enum restrict_family family_order;
+    int probe_count;
+    int probe_stagger;
+    int probe_timeout;
 };
 
 /*
@@ -107,6 +116,14 @@ int fo_new_service(struct fo_ctx *ctx,
                    datacmp_fn user_data_cmp,
                    struct fo_service **_service);
 
+/*
+ * Let fo_resolve_service_send() probe several servers of 'service' in
+ * parallel by connecting to them over TCP and pick the one that answers
+ * first. Servers that were added without a port are probed on
+ * 'default_port', or only resolved if it is 0.
+ */
+void fo_set_service_probe(struct fo_service *service, int default_port);
+
 /*
  * Look up service named 'name' from the 'ctx' service list. Target of
  * '_service' will be set to the service if it was found.
@@ -190,6 +207,12 @@ void *fo_get_server_user_data(struct fo_server *server);
 
 int fo_get_server_port(struct fo_server *server);
 
+/*
+ * Time in microseconds the server needed to accept a connection when it
+ * was last probed, 0 if it was not measured.
+ */
+uint64_t fo_get_server_latency(struct fo_server *server);
+
 const char *fo_get_server_name(struct fo_server *server);
 
 const char *fo_get_server_str_name(struct fo_server *server);
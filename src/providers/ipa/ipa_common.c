@@ -957,6 +957,13 @@ int ipa_service_init(TALLOC_CTX *memctx, struct be_ctx *ctx,
         goto done;
     }
 
+    /* The KDC runs on the same servers, so the LDAP port is probed for
+     * both. */
+    ret = be_fo_set_service_probe(ctx, "IPA", LDAP_PORT);
+    if (ret != EOK) {
+        goto done;
+    }
+
     service->sdap->name = talloc_strdup(service, "IPA");
     if (!service->sdap->name) {
         ret = ENOMEM;
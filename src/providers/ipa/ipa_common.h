@@ -49,6 +49,7 @@ enum ipa_basic_opt {
     IPA_KRB5_REALM,
     IPA_HBAC_REFRESH,
     IPA_SELINUX_REFRESH,
+    IPA_SELINUX_CHILD_POOL_SIZE,
     IPA_HBAC_SUPPORT_SRCHOST,
     IPA_AUTOMOUNT_LOCATION,
     IPA_RANGES_SEARCH_BASE,
@@ -56,6 +57,9 @@ enum ipa_basic_opt {
     IPA_SERVER_MODE,
     IPA_VIEWS_SEARCH_BASE,
     IPA_KRB5_CONFD_PATH,
+    IPA_EXTDOM_MAX_OUTSTANDING,
+    IPA_OVERRIDE_INDEX_FULL_REFRESH,
+    IPA_OVERRIDE_INDEX_SMART_REFRESH,
 
     IPA_OPTS_BASIC /* opts counter */
 };
@@ -200,6 +204,8 @@ struct ipa_id_ctx {
     char *view_name;
     /* Only used with server mode */
     struct ipa_server_mode_ctx *server_mode;
+    /* NULL if disabled */
+    struct ipa_override_index *override_index;
 };
 
 struct ipa_options {
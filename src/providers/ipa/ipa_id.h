@@ -102,6 +102,9 @@ errno_t ipa_get_ad_override_recv(struct tevent_req *req, int *dp_error_out,
                                  TALLOC_CTX *mem_ctx,
                                  struct sysdb_attrs **override_attrs);
 
+errno_t ipa_override_index_setup(struct be_ctx *be_ctx,
+                                 struct ipa_id_ctx *ipa_ctx);
+
 struct tevent_req *ipa_subdomain_account_send(TALLOC_CTX *memctx,
                                               struct tevent_context *ev,
                                               struct ipa_id_ctx *ipa_ctx,
@@ -613,7 +613,7 @@ static errno_t ipa_init_misc(struct be_ctx *be_ctx,
         return ret;
     }
 
-    ret = sdap_setup_child();
+    ret = sdap_setup_child(be_ctx, be_ctx->ev, sdap_id_ctx->opts);
     if (ret != EOK) {
         DEBUG(SSSDBG_CRIT_FAILURE, "Unable to setup sdap child [%d]: %s\n",
               ret, sss_strerror(ret));
@@ -722,10 +722,19 @@ errno_t sssm_ipa_id_init(TALLOC_CTX *mem_ctx,
 {
     struct ipa_init_ctx *init_ctx;
     struct ipa_id_ctx *id_ctx;
+    errno_t ret;
 
     init_ctx = talloc_get_type(module_data, struct ipa_init_ctx);
     id_ctx = init_ctx->id_ctx;
 
+    ret = ipa_override_index_setup(be_ctx, id_ctx);
+    if (ret != EOK) {
+        DEBUG(SSSDBG_MINOR_FAILURE, "Unable to set up override index, "
+              "overrides will be searched on the server [%d]: %s\n",
+              ret, sss_strerror(ret));
+        /* Not fatal */
+    }
+
     dp_set_method(dp_methods, DPM_ACCOUNT_HANDLER,
                   ipa_account_info_handler_send, ipa_account_info_handler_recv, id_ctx,
                   struct ipa_id_ctx, struct dp_id_data, struct dp_reply_std);
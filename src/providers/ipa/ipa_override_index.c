@@ -0,0 +1,295 @@
+/*
+    SSSD
+
+    IPA Identity Backend Module: in-memory index of view overrides
+
+    Copyright (C) 2016 Red Hat
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "util/util.h"
+#include "providers/ipa/ipa_override_index.h"
+
+errno_t ipa_override_index_create(TALLOC_CTX *mem_ctx,
+                                  struct ipa_override_index **_index)
+{
+    struct ipa_override_index *index;
+
+    index = talloc_zero(mem_ctx, struct ipa_override_index);
+    if (index == NULL) {
+        return ENOMEM;
+    }
+
+    *_index = index;
+
+    return EOK;
+}
+
+void ipa_override_index_invalidate(struct ipa_override_index *index)
+{
+    if (index == NULL) {
+        return;
+    }
+
+    talloc_zfree(index->data);
+    talloc_zfree(index->view_name);
+    talloc_zfree(index->modstamp);
+    index->table = NULL;
+    index->last_full_refresh = 0;
+    index->count = 0;
+}
+
+bool ipa_override_index_is_loaded(struct ipa_override_index *index,
+                                  const char *view_name)
+{
+    if (index == NULL || index->view_name == NULL || view_name == NULL) {
+        return false;
+    }
+
+    return strcmp(index->view_name, view_name) == 0;
+}
+
+/* Copies all attributes except the modification timestamp. */
+static errno_t ipa_override_copy_attrs(TALLOC_CTX *mem_ctx,
+                                       struct sysdb_attrs *src,
+                                       struct sysdb_attrs **_dst)
+{
+    struct sysdb_attrs *dst;
+    size_t c;
+    errno_t ret;
+
+    dst = sysdb_new_attrs(mem_ctx);
+    if (dst == NULL) {
+        return ENOMEM;
+    }
+
+    for (c = 0; c < src->num; c++) {
+        if (strcmp(src->a[c].name, SYSDB_ORIG_MODSTAMP) == 0) {
+            continue;
+        }
+
+        ret = sysdb_attrs_copy_values(src, dst, src->a[c].name);
+        if (ret != EOK) {
+            talloc_free(dst);
+            return ret;
+        }
+    }
+
+    *_dst = dst;
+
+    return EOK;
+}
+
+static errno_t ipa_override_index_add(struct ipa_override_index *index,
+                                      TALLOC_CTX *data,
+                                      hash_table_t *table,
+                                      struct sysdb_attrs *override_attrs,
+                                      const char **_modstamp)
+{
+    TALLOC_CTX *tmp_ctx;
+    struct sysdb_attrs *attrs;
+    const char *anchor;
+    const char *modstamp;
+    hash_key_t key;
+    hash_value_t value;
+    errno_t ret;
+    int hret;
+
+    ret = sysdb_attrs_get_string(override_attrs, SYSDB_OVERRIDE_ANCHOR_UUID,
+                                 &anchor);
+    if (ret != EOK) {
+        DEBUG(SSSDBG_MINOR_FAILURE, "Override without anchor, skipping.\n");
+        return EOK;
+    }
+
+    ret = sysdb_attrs_get_string(override_attrs, SYSDB_ORIG_MODSTAMP,
+                                 &modstamp);
+    if (ret == EOK && (*_modstamp == NULL || strcmp(modstamp, *_modstamp) > 0)) {
+        *_modstamp = modstamp;
+    }
+
+    tmp_ctx = talloc_new(NULL);
+    if (tmp_ctx == NULL) {
+        return ENOMEM;
+    }
+
+    key.type = HASH_KEY_STRING;
+    key.str = sss_tc_utf8_str_tolower(tmp_ctx, anchor);
+    if (key.str == NULL) {
+        ret = ENOMEM;
+        goto done;
+    }
+
+    ret = ipa_override_copy_attrs(data, override_attrs, &attrs);
+    if (ret != EOK) {
+        goto done;
+    }
+
+    if (hash_lookup(table, &key, &value) == HASH_SUCCESS) {
+        talloc_free(value.ptr);
+        index->count--;
+    }
+
+    value.type = HASH_VALUE_PTR;
+    value.ptr = attrs;
+
+    hret = hash_enter(table, &key, &value);
+    if (hret != HASH_SUCCESS) {
+        DEBUG(SSSDBG_OP_FAILURE, "Unable to add override [%s]: %s\n",
+              anchor, hash_error_string(hret));
+        talloc_free(attrs);
+        ret = EIO;
+        goto done;
+    }
+    index->count++;
+
+    ret = EOK;
+
+done:
+    talloc_free(tmp_ctx);
+    return ret;
+}
+
+errno_t ipa_override_index_update(struct ipa_override_index *index,
+                                  const char *view_name,
+                                  bool full,
+                                  struct sysdb_attrs **overrides,
+                                  size_t count)
+{
+    TALLOC_CTX *data;
+    hash_table_t *table;
+    const char *modstamp;
+    char *new_modstamp = NULL;
+    char *new_view_name = NULL;
+    size_t old_count;
+    size_t c;
+    errno_t ret;
+
+    if (full) {
+        data = talloc_new(index);
+        if (data == NULL) {
+            return ENOMEM;
+        }
+
+        ret = sss_hash_create(data, count, &table);
+        if (ret != EOK) {
+            talloc_free(data);
+            return ret;
+        }
+
+        new_view_name = talloc_strdup(index, view_name);
+        if (new_view_name == NULL) {
+            talloc_free(data);
+            return ENOMEM;
+        }
+
+        modstamp = NULL;
+        old_count = index->count;
+        index->count = 0;
+    } else {
+        if (!ipa_override_index_is_loaded(index, view_name)) {
+            DEBUG(SSSDBG_OP_FAILURE,
+                  "View [%s] is not indexed, full refresh is needed.\n",
+                  view_name);
+            return EINVAL;
+        }
+
+        data = index->data;
+        table = index->table;
+        modstamp = index->modstamp;
+        old_count = index->count;
+    }
+
+    for (c = 0; c < count; c++) {
+        ret = ipa_override_index_add(index, data, table, overrides[c],
+                                     &modstamp);
+        if (ret != EOK) {
+            goto done;
+        }
+    }
+
+    if (full || modstamp != index->modstamp) {
+        if (modstamp != NULL) {
+            new_modstamp = talloc_strdup(index, modstamp);
+            if (new_modstamp == NULL) {
+                ret = ENOMEM;
+                goto done;
+            }
+        }
+        talloc_free(index->modstamp);
+        index->modstamp = new_modstamp;
+    }
+
+    if (full) {
+        talloc_free(index->data);
+        talloc_free(index->view_name);
+        index->data = data;
+        index->table = table;
+        index->view_name = new_view_name;
+        index->last_full_refresh = time(NULL);
+    }
+
+    DEBUG(SSSDBG_TRACE_FUNC, "%s refresh of view [%s] indexed [%zu] "
+          "overrides, [%zu] in total.\n", full ? "Full" : "Smart",
+          view_name, count, index->count);
+
+    ret = EOK;
+
+done:
+    if (ret != EOK) {
+        if (full) {
+            talloc_free(data);
+            talloc_free(new_view_name);
+            index->count = old_count;
+        } else {
+            /* Some overrides may already be replaced, start again */
+            ipa_override_index_invalidate(index);
+        }
+    }
+
+    return ret;
+}
+
+errno_t ipa_override_index_lookup(TALLOC_CTX *mem_ctx,
+                                  struct ipa_override_index *index,
+                                  const char *view_name,
+                                  const char *anchor,
+                                  struct sysdb_attrs **_override_attrs)
+{
+    hash_key_t key;
+    hash_value_t value;
+    errno_t ret;
+
+    if (!ipa_override_index_is_loaded(index, view_name)) {
+        return EAGAIN;
+    }
+
+    key.type = HASH_KEY_STRING;
+    key.str = sss_tc_utf8_str_tolower(NULL, anchor);
+    if (key.str == NULL) {
+        return ENOMEM;
+    }
+
+    if (hash_lookup(index->table, &key, &value) != HASH_SUCCESS) {
+        ret = ENOENT;
+        goto done;
+    }
+
+    ret = ipa_override_copy_attrs(mem_ctx, value.ptr, _override_attrs);
+
+done:
+    talloc_free(key.str);
+    return ret;
+}
@@ -0,0 +1,74 @@
+/*
+    SSSD
+
+    IPA Identity Backend Module: in-memory index of view overrides
+
+    Copyright (C) 2016 Red Hat
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef IPA_OVERRIDE_INDEX_H_
+#define IPA_OVERRIDE_INDEX_H_
+
+#include <talloc.h>
+#include "util/util.h"
+#include "db/sysdb.h"
+
+/* All overrides of one view, keyed by their ipaAnchorUUID. The index is
+ * loaded completely by a full refresh and then kept up to date with the
+ * overrides whose modifyTimestamp changed. Overrides removed from the
+ * server disappear from the index with the next full refresh. */
+struct ipa_override_index {
+    /* lower case anchor -> struct sysdb_attrs */
+    hash_table_t *table;
+    /* parent of the table and of the overrides */
+    TALLOC_CTX *data;
+
+    /* LDAP name of the indexed view, NULL if the index is not loaded */
+    char *view_name;
+    /* highest modifyTimestamp seen so far */
+    char *modstamp;
+    time_t last_full_refresh;
+    size_t count;
+};
+
+errno_t ipa_override_index_create(TALLOC_CTX *mem_ctx,
+                                  struct ipa_override_index **_index);
+
+/* Replaces the content of the index with the given overrides of the view
+ * if full is true, otherwise adds or replaces the given overrides in the
+ * already loaded index of the same view. The overrides must contain
+ * SYSDB_OVERRIDE_ANCHOR_UUID and may contain SYSDB_ORIG_MODSTAMP, which
+ * is not kept in the index. */
+errno_t ipa_override_index_update(struct ipa_override_index *index,
+                                  const char *view_name,
+                                  bool full,
+                                  struct sysdb_attrs **overrides,
+                                  size_t count);
+
+void ipa_override_index_invalidate(struct ipa_override_index *index);
+
+bool ipa_override_index_is_loaded(struct ipa_override_index *index,
+                                  const char *view_name);
+
+/* Returns a copy of the override with the given anchor, ENOENT if the view
+ * has no such override or EAGAIN if the view is not indexed. */
+errno_t ipa_override_index_lookup(TALLOC_CTX *mem_ctx,
+                                  struct ipa_override_index *index,
+                                  const char *view_name,
+                                  const char *anchor,
+                                  struct sysdb_attrs **_override_attrs);
+
+#endif /* IPA_OVERRIDE_INDEX_H_ */
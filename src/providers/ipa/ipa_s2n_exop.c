@@ -23,6 +23,7 @@
 #include "util/sss_nss.h"
 #include "util/strtonum.h"
 #include "util/crypto/sss_crypto.h"
+#include "util/probes.h"
 #include "providers/ldap/sdap_async_private.h"
 #include "providers/ldap/sdap_async_ad.h"
 #include "providers/ldap/ldap_common.h"
@@ -979,26 +980,62 @@ done:
     return ret;
 }
 
+/* The entries of the list are looked up with up to max_outstanding extdom
+ * operations in flight on the same connection. Replies are saved to the
+ * cache in batches of up to max_outstanding entries, in list order within
+ * a batch. */
+struct ipa_s2n_get_list_item {
+    struct tevent_req *req;
+    size_t idx;
+    struct req_input req_input;
+    struct sss_domain_info *obj_domain;
+    struct resp_attrs *attrs;
+    struct sysdb_attrs *override_attrs;
+    struct timeval start;
+};
+
 struct ipa_s2n_get_list_state {
     struct tevent_context *ev;
     struct ipa_id_ctx *ipa_ctx;
     struct sss_domain_info *dom;
     struct sdap_handle *sh;
-    struct req_input req_input;
+    enum req_input_type list_type;
     char **list;
     size_t list_idx;
     int exop_timeout;
     int entry_type;
     enum request_types request_type;
-    struct resp_attrs *attrs;
-    struct sss_domain_info *obj_domain;
-    struct sysdb_attrs *override_attrs;
+
+    /* parent of all items, freed to abort the operations in flight */
+    TALLOC_CTX *items_ctx;
+    size_t max_outstanding;
+    size_t outstanding;
+    struct ipa_s2n_get_list_item **ready;
+    size_t num_ready;
+
+    struct timeval start;
+    size_t num_exops;
+    size_t num_batches;
+    size_t max_seen_outstanding;
 };
 
 static errno_t ipa_s2n_get_list_step(struct tevent_req *req);
 static void ipa_s2n_get_list_get_override_done(struct tevent_req *subreq);
 static void ipa_s2n_get_list_next(struct tevent_req *subreq);
+static errno_t ipa_s2n_get_list_item_ready(struct ipa_s2n_get_list_item *item);
 static errno_t ipa_s2n_get_list_save_step(struct tevent_req *req);
+static void ipa_s2n_get_list_fail(struct tevent_req *req, errno_t ret);
+
+static uint64_t ipa_s2n_usec_since(const struct timeval *start)
+{
+    struct timeval now;
+    struct timeval diff;
+
+    now = tevent_timeval_current();
+    diff = tevent_timeval_until(start, &now);
+
+    return (uint64_t) diff.tv_sec * 1000000 + diff.tv_usec;
+}
 
 static struct tevent_req *ipa_s2n_get_list_send(TALLOC_CTX *mem_ctx,
                                                 struct tevent_context *ev,
@@ -1014,6 +1051,8 @@ static struct tevent_req *ipa_s2n_get_list_send(TALLOC_CTX *mem_ctx,
     int ret;
     struct ipa_s2n_get_list_state *state;
     struct tevent_req *req;
+    size_t num_entries;
+    int max_outstanding;
 
     req = tevent_req_create(mem_ctx, &state, struct ipa_s2n_get_list_state);
     if (req == NULL) {
@@ -1034,13 +1073,36 @@ static struct tevent_req *ipa_s2n_get_list_send(TALLOC_CTX *mem_ctx,
     state->sh = sh;
     state->list = list;
     state->list_idx = 0;
-    state->req_input.type = list_type;
-    state->req_input.inp.name = NULL;
+    state->list_type = list_type;
     state->exop_timeout = exop_timeout;
     state->entry_type = entry_type;
     state->request_type = request_type;
-    state->attrs = NULL;
-    state->override_attrs = NULL;
+    state->start = tevent_timeval_current();
+
+    num_entries = 0;
+    while (list[num_entries] != NULL) {
+        num_entries++;
+    }
+
+    max_outstanding = dp_opt_get_int(ipa_ctx->ipa_options->basic,
+                                     IPA_EXTDOM_MAX_OUTSTANDING);
+    state->max_outstanding = max_outstanding > 0 ? max_outstanding : 1;
+
+    PROBE(IPA_S2N_GET_LIST_SEND, entry_type, request_type, num_entries,
+          state->max_outstanding);
+
+    if (num_entries == 0) {
+        ret = EOK;
+        goto done;
+    }
+
+    state->items_ctx = talloc_new(state);
+    state->ready = talloc_array(state, struct ipa_s2n_get_list_item *,
+                                state->max_outstanding);
+    if (state->items_ctx == NULL || state->ready == NULL) {
+        ret = ENOMEM;
+        goto done;
+    }
 
     ret = ipa_s2n_get_list_step(req);
     if (ret != EOK) {
@@ -1048,16 +1110,21 @@ static struct tevent_req *ipa_s2n_get_list_send(TALLOC_CTX *mem_ctx,
         goto done;
     }
 
+    return req;
+
 done:
     if (ret != EOK) {
         tevent_req_error(req, ret);
-        tevent_req_post(req, ev);
+    } else {
+        tevent_req_done(req);
     }
+    tevent_req_post(req, ev);
 
     return req;
 }
 
-static errno_t ipa_s2n_get_list_step(struct tevent_req *req)
+static errno_t ipa_s2n_get_list_item_send(struct tevent_req *req,
+                                          struct ipa_s2n_get_list_item *item)
 {
     int ret;
     struct ipa_s2n_get_list_state *state = tevent_req_data(req,
@@ -1070,67 +1137,66 @@ static errno_t ipa_s2n_get_list_step(struct tevent_req *req)
     uint32_t id;
     char *endptr;
     bool need_v1 = false;
+    const char *entry = state->list[item->idx];
 
     parent_domain = get_domains_head(state->dom);
-    switch (state->req_input.type) {
+    switch (item->req_input.type) {
     case REQ_INP_NAME:
 
-        ret = sss_parse_name(state, state->dom->names, state->list[state->list_idx],
+        ret = sss_parse_name(item, state->dom->names, entry,
                              &domain_name, &short_name);
         if (ret != EOK) {
             DEBUG(SSSDBG_CRIT_FAILURE, "Unable to parse name '%s' [%d]: %s\n",
-                                        state->list[state->list_idx],
-                                        ret, sss_strerror(ret));
+                                        entry, ret, sss_strerror(ret));
             return ret;
         }
 
         if (domain_name) {
-            state->obj_domain = find_domain_by_name(parent_domain,
-                                                    domain_name, true);
-            if (state->obj_domain == NULL) {
+            item->obj_domain = find_domain_by_name(parent_domain,
+                                                   domain_name, true);
+            if (item->obj_domain == NULL) {
                 DEBUG(SSSDBG_OP_FAILURE, "find_domain_by_name failed.\n");
                 return ENOMEM;
             }
         } else {
-            state->obj_domain = parent_domain;
+            item->obj_domain = parent_domain;
         }
 
-        state->req_input.inp.name = short_name;
+        item->req_input.inp.name = short_name;
 
         break;
     case REQ_INP_ID:
         errno = 0;
-        id = strtouint32(state->list[state->list_idx], &endptr, 10);
-        if (errno != 0 || *endptr != '\0'
-                || (state->list[state->list_idx] == endptr)) {
+        id = strtouint32(entry, &endptr, 10);
+        if (errno != 0 || *endptr != '\0' || (entry == endptr)) {
             DEBUG(SSSDBG_OP_FAILURE, "strtouint32 failed.\n");
             return EINVAL;
         }
-        state->req_input.inp.id = id;
-        state->obj_domain = state->dom;
+        item->req_input.inp.id = id;
+        item->obj_domain = state->dom;
 
         break;
     case REQ_INP_SECID:
-        state->req_input.inp.secid = state->list[state->list_idx];
-        state->obj_domain = find_domain_by_sid(parent_domain,
-                                               state->req_input.inp.secid);
-        if (state->obj_domain == NULL) {
+        item->req_input.inp.secid = entry;
+        item->obj_domain = find_domain_by_sid(parent_domain,
+                                              item->req_input.inp.secid);
+        if (item->obj_domain == NULL) {
             DEBUG(SSSDBG_OP_FAILURE,
                   "find_domain_by_sid failed for SID [%s].\n",
-                  state->req_input.inp.secid);
+                  item->req_input.inp.secid);
             return EINVAL;
         }
 
         break;
     default:
         DEBUG(SSSDBG_OP_FAILURE, "Unexpected inoput type [%d].\n",
-                                 state->req_input.type);
+                                 item->req_input.type);
         return EINVAL;
     }
 
-    ret = s2n_encode_request(state, state->obj_domain->name, state->entry_type,
+    ret = s2n_encode_request(item, item->obj_domain->name, state->entry_type,
                              state->request_type,
-                             &state->req_input, &bv_req);
+                             &item->req_input, &bv_req);
     if (ret != EOK) {
         DEBUG(SSSDBG_OP_FAILURE, "s2n_encode_request failed.\n");
         return ret;
@@ -1140,13 +1206,52 @@ static errno_t ipa_s2n_get_list_step(struct tevent_req *req)
         need_v1 = true;
     }
 
-    subreq = ipa_s2n_exop_send(state, state->ev, state->sh, need_v1,
+    item->start = tevent_timeval_current();
+    subreq = ipa_s2n_exop_send(item, state->ev, state->sh, need_v1,
                                state->exop_timeout, bv_req);
     if (subreq == NULL) {
         DEBUG(SSSDBG_OP_FAILURE, "ipa_s2n_exop_send failed.\n");
         return ENOMEM;
     }
-    tevent_req_set_callback(subreq, ipa_s2n_get_list_next, req);
+    tevent_req_set_callback(subreq, ipa_s2n_get_list_next, item);
+
+    return EOK;
+}
+
+/* Fills the window of outstanding operations from the list. */
+static errno_t ipa_s2n_get_list_step(struct tevent_req *req)
+{
+    int ret;
+    struct ipa_s2n_get_list_state *state = tevent_req_data(req,
+                                               struct ipa_s2n_get_list_state);
+    struct ipa_s2n_get_list_item *item;
+
+    while (state->list[state->list_idx] != NULL
+            && state->outstanding < state->max_outstanding) {
+        item = talloc_zero(state->items_ctx, struct ipa_s2n_get_list_item);
+        if (item == NULL) {
+            return ENOMEM;
+        }
+
+        item->req = req;
+        item->idx = state->list_idx;
+        item->req_input.type = state->list_type;
+
+        ret = ipa_s2n_get_list_item_send(req, item);
+        if (ret != EOK) {
+            talloc_free(item);
+            return ret;
+        }
+
+        state->list_idx++;
+        state->outstanding++;
+        state->num_exops++;
+        if (state->outstanding > state->max_seen_outstanding) {
+            state->max_seen_outstanding = state->outstanding;
+        }
+
+        PROBE(IPA_S2N_GET_LIST_EXOP_SEND, state->outstanding);
+    }
 
     return EOK;
 }
@@ -1154,8 +1259,9 @@ static errno_t ipa_s2n_get_list_step(struct tevent_req *req)
 static void ipa_s2n_get_list_next(struct tevent_req *subreq)
 {
     int ret;
-    struct tevent_req *req = tevent_req_callback_data(subreq,
-                                                      struct tevent_req);
+    struct ipa_s2n_get_list_item *item = tevent_req_callback_data(subreq,
+                                                struct ipa_s2n_get_list_item);
+    struct tevent_req *req = item->req;
     struct ipa_s2n_get_list_state *state = tevent_req_data(req,
                                                struct ipa_s2n_get_list_state);
     char *retoid = NULL;
@@ -1163,47 +1269,45 @@ static void ipa_s2n_get_list_next(struct tevent_req *subreq)
     const char *sid_str;
     struct dp_id_data *ar;
 
-    ret = ipa_s2n_exop_recv(subreq, state, &retoid, &retdata);
+    ret = ipa_s2n_exop_recv(subreq, item, &retoid, &retdata);
     talloc_zfree(subreq);
+    PROBE(IPA_S2N_GET_LIST_EXOP_RECV, state->outstanding,
+          ipa_s2n_usec_since(&item->start));
     if (ret != EOK) {
         DEBUG(SSSDBG_OP_FAILURE, "s2n exop request failed.\n");
         goto fail;
     }
 
-    talloc_zfree(state->attrs);
-    ret = s2n_response_to_attrs(state, state->dom, retoid, retdata,
-                                &state->attrs);
+    ret = s2n_response_to_attrs(item, state->dom, retoid, retdata,
+                                &item->attrs);
     if (ret != EOK) {
         DEBUG(SSSDBG_OP_FAILURE, "s2n_response_to_attrs failed.\n");
         goto fail;
     }
 
     if (is_default_view(state->ipa_ctx->view_name)) {
-        ret = ipa_s2n_get_list_save_step(req);
-        if (ret == EOK) {
-            tevent_req_done(req);
-        } else if (ret != EAGAIN) {
-            DEBUG(SSSDBG_OP_FAILURE, "ipa_s2n_get_list_save_step failed.\n");
+        ret = ipa_s2n_get_list_item_ready(item);
+        if (ret != EOK) {
             goto fail;
         }
 
         return;
     }
 
-    ret = sysdb_attrs_get_string(state->attrs->sysdb_attrs, SYSDB_SID_STR,
+    ret = sysdb_attrs_get_string(item->attrs->sysdb_attrs, SYSDB_SID_STR,
                                  &sid_str);
     if (ret != EOK) {
         DEBUG(SSSDBG_OP_FAILURE, "sysdb_attrs_get_string failed.\n");
         goto fail;
     }
 
-    ret = get_dp_id_data_for_sid(state, sid_str, state->obj_domain->name, &ar);
+    ret = get_dp_id_data_for_sid(item, sid_str, item->obj_domain->name, &ar);
     if (ret != EOK) {
         DEBUG(SSSDBG_OP_FAILURE, "get_dp_id_data_for_sid failed.\n");
         goto fail;
     }
 
-    subreq = ipa_get_ad_override_send(state, state->ev,
+    subreq = ipa_get_ad_override_send(item, state->ev,
                            state->ipa_ctx->sdap_id_ctx,
                            state->ipa_ctx->ipa_options,
                            dp_opt_get_string(state->ipa_ctx->ipa_options->basic,
@@ -1215,62 +1319,59 @@ static void ipa_s2n_get_list_next(struct tevent_req *subreq)
         ret = ENOMEM;
         goto fail;
     }
-    tevent_req_set_callback(subreq, ipa_s2n_get_list_get_override_done, req);
+    tevent_req_set_callback(subreq, ipa_s2n_get_list_get_override_done, item);
 
     return;
 
 fail:
-    tevent_req_error(req,ret);
+    ipa_s2n_get_list_fail(req, ret);
     return;
 }
 
 static void ipa_s2n_get_list_get_override_done(struct tevent_req *subreq)
 {
     int ret;
-    struct tevent_req *req = tevent_req_callback_data(subreq,
-                                                      struct tevent_req);
-    struct ipa_s2n_get_list_state *state = tevent_req_data(req,
-                                               struct ipa_s2n_get_list_state);
+    struct ipa_s2n_get_list_item *item = tevent_req_callback_data(subreq,
+                                                struct ipa_s2n_get_list_item);
+    struct tevent_req *req = item->req;
 
-    ret = ipa_get_ad_override_recv(subreq, NULL, state, &state->override_attrs);
+    ret = ipa_get_ad_override_recv(subreq, NULL, item, &item->override_attrs);
     talloc_zfree(subreq);
     if (ret != EOK) {
         DEBUG(SSSDBG_OP_FAILURE, "IPA override lookup failed: %d\n", ret);
         goto fail;
     }
 
-    ret = ipa_s2n_get_list_save_step(req);
-    if (ret == EOK) {
-        tevent_req_done(req);
-    } else if (ret != EAGAIN) {
-        DEBUG(SSSDBG_OP_FAILURE, "ipa_s2n_get_list_save_step failed.\n");
+    ret = ipa_s2n_get_list_item_ready(item);
+    if (ret != EOK) {
         goto fail;
     }
 
     return;
 
 fail:
-    tevent_req_error(req,ret);
+    ipa_s2n_get_list_fail(req, ret);
     return;
 }
 
-static errno_t ipa_s2n_get_list_save_step(struct tevent_req *req)
+static errno_t ipa_s2n_get_list_item_ready(struct ipa_s2n_get_list_item *item)
 {
     int ret;
+    struct tevent_req *req = item->req;
     struct ipa_s2n_get_list_state *state = tevent_req_data(req,
                                                struct ipa_s2n_get_list_state);
 
-    ret = ipa_s2n_save_objects(state->dom, &state->req_input, state->attrs,
-                               NULL, state->ipa_ctx->view_name,
-                               state->override_attrs, false);
-    if (ret != EOK) {
-        DEBUG(SSSDBG_OP_FAILURE, "ipa_s2n_save_objects failed.\n");
-        return ret;
-    }
+    state->outstanding--;
+    state->ready[state->num_ready++] = item;
 
-    state->list_idx++;
-    if (state->list[state->list_idx] == NULL) {
-        return EOK;
+    /* Save a full batch, or whatever is left once nothing is in flight */
+    if (state->num_ready >= state->max_outstanding
+            || state->outstanding == 0) {
+        ret = ipa_s2n_get_list_save_step(req);
+        if (ret != EOK) {
+            DEBUG(SSSDBG_OP_FAILURE, "ipa_s2n_get_list_save_step failed.\n");
+            return ret;
+        }
     }
 
     ret = ipa_s2n_get_list_step(req);
@@ -1279,7 +1380,106 @@ static errno_t ipa_s2n_get_list_save_step(struct tevent_req *req)
         return ret;
     }
 
-    return EAGAIN;
+    if (state->outstanding == 0 && state->num_ready == 0) {
+        PROBE(IPA_S2N_GET_LIST_DONE, state->entry_type, state->request_type,
+              state->num_exops, state->num_batches,
+              state->max_seen_outstanding, ipa_s2n_usec_since(&state->start));
+        tevent_req_done(req);
+    }
+
+    return EOK;
+}
+
+static int ipa_s2n_get_list_item_cmp(const void *a, const void *b)
+{
+    const struct ipa_s2n_get_list_item *item_a =
+                                *(struct ipa_s2n_get_list_item *const *) a;
+    const struct ipa_s2n_get_list_item *item_b =
+                                *(struct ipa_s2n_get_list_item *const *) b;
+
+    if (item_a->idx < item_b->idx) {
+        return -1;
+    }
+
+    return item_a->idx > item_b->idx ? 1 : 0;
+}
+
+static errno_t ipa_s2n_get_list_save_step(struct tevent_req *req)
+{
+    int ret;
+    int sret;
+    struct ipa_s2n_get_list_state *state = tevent_req_data(req,
+                                               struct ipa_s2n_get_list_state);
+    struct ipa_s2n_get_list_item *item;
+    bool in_transaction = false;
+    size_t num_saved = state->num_ready;
+    size_t c;
+
+    qsort(state->ready, state->num_ready, sizeof(struct ipa_s2n_get_list_item *),
+          ipa_s2n_get_list_item_cmp);
+
+    DEBUG(SSSDBG_TRACE_INTERNAL, "Saving a batch of %zu entries.\n",
+                                 num_saved);
+    PROBE(IPA_S2N_GET_LIST_SAVE_BATCH_PRE, num_saved);
+
+    ret = sysdb_transaction_start(state->dom->sysdb);
+    if (ret != EOK) {
+        DEBUG(SSSDBG_CRIT_FAILURE, "Failed to start transaction\n");
+        goto done;
+    }
+    in_transaction = true;
+
+    for (c = 0; c < state->num_ready; c++) {
+        item = state->ready[c];
+
+        ret = ipa_s2n_save_objects(state->dom, &item->req_input, item->attrs,
+                                   NULL, state->ipa_ctx->view_name,
+                                   item->override_attrs, false);
+        if (ret != EOK) {
+            DEBUG(SSSDBG_OP_FAILURE, "ipa_s2n_save_objects failed.\n");
+            goto done;
+        }
+    }
+
+    ret = sysdb_transaction_commit(state->dom->sysdb);
+    if (ret != EOK) {
+        DEBUG(SSSDBG_CRIT_FAILURE, "Failed to commit transaction\n");
+        goto done;
+    }
+    in_transaction = false;
+
+    for (c = 0; c < state->num_ready; c++) {
+        talloc_free(state->ready[c]);
+    }
+    state->num_ready = 0;
+    state->num_batches++;
+
+    ret = EOK;
+
+done:
+    if (in_transaction) {
+        sret = sysdb_transaction_cancel(state->dom->sysdb);
+        if (sret != EOK) {
+            DEBUG(SSSDBG_CRIT_FAILURE, "Failed to cancel transaction\n");
+        }
+    }
+
+    PROBE(IPA_S2N_GET_LIST_SAVE_BATCH_POST, num_saved);
+
+    return ret;
+}
+
+static void ipa_s2n_get_list_fail(struct tevent_req *req, errno_t ret)
+{
+    struct ipa_s2n_get_list_state *state = tevent_req_data(req,
+                                               struct ipa_s2n_get_list_state);
+
+    /* Abort the other operations in flight, their replies are not needed */
+    talloc_zfree(state->items_ctx);
+    state->num_ready = 0;
+    state->outstanding = 0;
+
+    tevent_req_error(req, ret);
 }
 
 static int ipa_s2n_get_list_recv(struct tevent_req *req)
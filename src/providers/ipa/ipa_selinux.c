@@ -559,21 +559,27 @@ done:
 
 struct selinux_child_state {
     struct selinux_child_input *sci;
+    struct ipa_selinux_ctx *selinux_ctx;
     struct tevent_context *ev;
     struct io_buffer *buf;
     struct child_io_fds *io;
 };
 
-static errno_t selinux_child_init(void);
+static errno_t selinux_child_init(struct tevent_context *ev,
+                                  struct ipa_selinux_ctx *selinux_ctx);
 static errno_t selinux_child_create_buffer(struct selinux_child_state *state);
 static errno_t selinux_fork_child(struct selinux_child_state *state);
 static void selinux_child_step(struct tevent_req *subreq);
 static void selinux_child_done(struct tevent_req *subreq);
+static void selinux_child_pool_done(struct tevent_req *subreq);
+static void selinux_child_process_response(struct tevent_req *req,
+                                           uint8_t *buf, ssize_t len);
 static errno_t selinux_child_parse_response(uint8_t *buf, ssize_t len,
                                             uint32_t *_child_result);
 
 static struct tevent_req *selinux_child_send(TALLOC_CTX *mem_ctx,
                                              struct tevent_context *ev,
+                                             struct ipa_selinux_ctx *selinux_ctx,
                                              struct selinux_child_input *sci)
 {
     struct tevent_req *req;
@@ -588,6 +594,7 @@ static struct tevent_req *selinux_child_send(TALLOC_CTX *mem_ctx,
     }
 
     state->sci = sci;
+    state->selinux_ctx = selinux_ctx;
     state->ev = ev;
     state->io = talloc(state, struct child_io_fds);
     state->buf = talloc(state, struct io_buffer);
@@ -601,7 +608,7 @@ static struct tevent_req *selinux_child_send(TALLOC_CTX *mem_ctx,
     state->io->read_from_child_fd = -1;
     talloc_set_destructor((void *) state->io, child_io_destructor);
 
-    ret = selinux_child_init();
+    ret = selinux_child_init(ev, selinux_ctx);
     if (ret != EOK) {
         DEBUG(SSSDBG_OP_FAILURE, "Failed to init the child\n");
         goto immediately;
@@ -614,6 +621,20 @@ static struct tevent_req *selinux_child_send(TALLOC_CTX *mem_ctx,
         goto immediately;
     }
 
+    if (sss_child_pool_accepts(selinux_ctx->child_pool)) {
+        /* selinux_child forked for a single request has no timeout either */
+        subreq = sss_child_pool_send(state, ev, selinux_ctx->child_pool,
+                                     state->buf->data, state->buf->size, 0);
+        if (subreq == NULL) {
+            ret = ENOMEM;
+            goto immediately;
+        }
+        tevent_req_set_callback(subreq, selinux_child_pool_done, req);
+
+        ret = EOK;
+        goto immediately;
+    }
+
     ret = selinux_fork_child(state);
     if (ret != EOK) {
         DEBUG(SSSDBG_OP_FAILURE, "Failed to fork the child\n");
@@ -637,9 +658,37 @@ immediately:
     return req;
 }
 
-static errno_t selinux_child_init(void)
+static errno_t selinux_child_init(struct tevent_context *ev,
+                                  struct ipa_selinux_ctx *selinux_ctx)
 {
-    return child_debug_init(SELINUX_CHILD_LOG_FILE, &selinux_child_debug_fd);
+    int pool_size;
+    errno_t ret;
+
+    ret = child_debug_init(SELINUX_CHILD_LOG_FILE, &selinux_child_debug_fd);
+    if (ret != EOK) {
+        return ret;
+    }
+
+    pool_size = dp_opt_get_int(selinux_ctx->id_ctx->ipa_options->basic,
+                               IPA_SELINUX_CHILD_POOL_SIZE);
+    if (pool_size <= 0 || selinux_ctx->child_pool != NULL) {
+        return EOK;
+    }
+
+    /* Requests wait for a busy worker only as long as there are not more
+     * of them than workers, otherwise a new selinux_child is forked. */
+    ret = sss_child_pool_create(selinux_ctx, ev, SELINUX_CHILD,
+                                selinux_child_debug_fd, NULL,
+                                STDIN_FILENO, STDOUT_FILENO, pool_size,
+                                SSS_CHILD_POOL_MAX_JOBS, pool_size,
+                                &selinux_ctx->child_pool);
+    if (ret != EOK) {
+        DEBUG(SSSDBG_OP_FAILURE, "Cannot create selinux_child pool [%d]: %s\n",
+              ret, sss_strerror(ret));
+        return ret;
+    }
+
+    return EOK;
 }
 
 static errno_t selinux_child_create_buffer(struct selinux_child_state *state)
@@ -771,7 +820,6 @@ static void selinux_child_done(struct tevent_req *subreq)
 {
     struct tevent_req *req;
     struct selinux_child_state *state;
-    uint32_t child_result;
     errno_t ret;
     ssize_t len;
     uint8_t *buf;
@@ -789,6 +837,36 @@ static void selinux_child_done(struct tevent_req *subreq)
     close(state->io->read_from_child_fd);
     state->io->read_from_child_fd = -1;
 
+    selinux_child_process_response(req, buf, len);
+}
+
+static void selinux_child_pool_done(struct tevent_req *subreq)
+{
+    struct tevent_req *req;
+    struct selinux_child_state *state;
+    errno_t ret;
+    ssize_t len;
+    uint8_t *buf;
+
+    req = tevent_req_callback_data(subreq, struct tevent_req);
+    state = tevent_req_data(req, struct selinux_child_state);
+
+    ret = sss_child_pool_recv(subreq, state, &buf, &len);
+    talloc_zfree(subreq);
+    if (ret != EOK) {
+        tevent_req_error(req, ret);
+        return;
+    }
+
+    selinux_child_process_response(req, buf, len);
+}
+
+static void selinux_child_process_response(struct tevent_req *req,
+                                           uint8_t *buf, ssize_t len)
+{
+    uint32_t child_result;
+    errno_t ret;
+
     ret = selinux_child_parse_response(buf, len, &child_result);
     if (ret != EOK) {
         DEBUG(SSSDBG_CRIT_FAILURE,
@@ -1621,7 +1699,7 @@ static void ipa_selinux_handler_get_done(struct tevent_req *subreq)
     /* Update the SELinux context in a privileged child as the back end is
      * running unprivileged
      */
-    subreq = selinux_child_send(state, state->ev, sci);
+    subreq = selinux_child_send(state, state->ev, state->selinux_ctx, sci);
     if (subreq == NULL) {
         ret = ENOMEM;
         goto done;
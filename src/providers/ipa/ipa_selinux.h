@@ -34,10 +34,15 @@
     talloc_asprintf(mem_ctx, "%s/logins/%s", selinux_policy_root(), username)
 #endif /* HAVE_SELINUX_LOGIN_DIR */
 
+struct sss_child_pool;
+
 struct ipa_selinux_ctx {
     struct ipa_id_ctx *id_ctx;
     time_t last_update;
 
+    /* Pool of selinux_child workers, NULL if disabled */
+    struct sss_child_pool *child_pool;
+
     struct sdap_search_base **selinux_search_bases;
     struct sdap_search_base **host_search_bases;
     struct sdap_search_base **hbac_search_bases;
@@ -27,6 +27,7 @@
 #include "util/cert.h"
 #include "providers/ldap/sdap_async.h"
 #include "providers/ipa/ipa_id.h"
+#include "providers/ipa/ipa_override_index.h"
 
 static errno_t dp_id_data_to_override_filter(TALLOC_CTX *mem_ctx,
                                               struct ipa_options *ipa_opts,
@@ -275,6 +276,8 @@ struct ipa_get_ad_override_state {
 };
 
 static void ipa_get_ad_override_connect_done(struct tevent_req *subreq);
+static errno_t ipa_get_ad_override_from_index(
+                                struct ipa_get_ad_override_state *state);
 static errno_t ipa_get_ad_override_qualify_name(
                                 struct ipa_get_ad_override_state *state);
 static void ipa_get_ad_override_done(struct tevent_req *subreq);
@@ -319,6 +322,11 @@ struct tevent_req *ipa_get_ad_override_send(TALLOC_CTX *mem_ctx,
         state->ipa_view_name = view_name;
     }
 
+    ret = ipa_get_ad_override_from_index(state);
+    if (ret != EAGAIN) {
+        goto done;
+    }
+
     state->sdap_op = sdap_id_op_create(state,
                                        state->sdap_id_ctx->conn->conn_cache);
     if (state->sdap_op == NULL) {
@@ -477,6 +485,59 @@ fail:
     return;
 }
 
+/* Returns EAGAIN if the override has to be searched on the server. */
+static errno_t ipa_get_ad_override_from_index(
+                                struct ipa_get_ad_override_state *state)
+{
+    struct ipa_override_index *index = NULL;
+    char *anchor;
+    errno_t ret;
+
+    if (state->ipa_options->id_ctx != NULL) {
+        index = state->ipa_options->id_ctx->override_index;
+    }
+
+    if (!ipa_override_index_is_loaded(index, state->ipa_view_name)) {
+        return EAGAIN;
+    }
+
+    switch (state->ar->filter_type) {
+    case BE_FILTER_SECID:
+        anchor = talloc_asprintf(state, ":SID:%s", state->ar->filter_value);
+        break;
+    case BE_FILTER_UUID:
+        anchor = talloc_asprintf(state, ":IPA:%s:%s",
+                         dp_opt_get_string(state->ipa_options->basic,
+                                           IPA_DOMAIN),
+                         state->ar->filter_value);
+        break;
+    default:
+        /* Only anchors are indexed */
+        return EAGAIN;
+    }
+    if (anchor == NULL) {
+        return ENOMEM;
+    }
+
+    ret = ipa_override_index_lookup(state, index, state->ipa_view_name,
+                                    anchor, &state->override_attrs);
+    if (ret == ENOENT) {
+        DEBUG(SSSDBG_TRACE_ALL, "No override for [%s] in the index.\n",
+                                anchor);
+        ret = EOK;
+    } else if (ret == EOK) {
+        DEBUG(SSSDBG_TRACE_ALL, "Found override for [%s] in the index.\n",
+                                anchor);
+        ret = ipa_get_ad_override_qualify_name(state);
+        if (ret != EOK) {
+            DEBUG(SSSDBG_OP_FAILURE, "Cannot qualify object name\n");
+        }
+    }
+
+    talloc_free(anchor);
+    return ret;
+}
+
 static errno_t ipa_get_ad_override_qualify_name(
                                 struct ipa_get_ad_override_state *state)
 {
@@ -523,3 +584,262 @@ errno_t ipa_get_ad_override_recv(struct tevent_req *req, int *dp_error_out,
 
     return EOK;
 }
+
+struct ipa_override_index_refresh_state {
+    struct tevent_context *ev;
+    struct ipa_id_ctx *ipa_ctx;
+    struct sdap_id_op *sdap_op;
+    struct sdap_attr_map *map;
+    const char *view_name;
+    char *filter;
+    bool full;
+};
+
+static void ipa_override_index_refresh_connect_done(struct tevent_req *subreq);
+static void ipa_override_index_refresh_done(struct tevent_req *subreq);
+
+static struct tevent_req *
+ipa_override_index_refresh_send(TALLOC_CTX *mem_ctx,
+                                struct tevent_context *ev,
+                                struct be_ctx *be_ctx,
+                                struct be_ptask *be_ptask,
+                                void *pvt)
+{
+    struct ipa_override_index_refresh_state *state;
+    struct ipa_id_ctx *ipa_ctx;
+    struct ipa_override_index *index;
+    struct ipa_options *ipa_opts;
+    struct tevent_req *req;
+    struct tevent_req *subreq;
+    time_t full_interval;
+    int ret;
+
+    req = tevent_req_create(mem_ctx, &state,
+                            struct ipa_override_index_refresh_state);
+    if (req == NULL) {
+        DEBUG(SSSDBG_OP_FAILURE, "tevent_req_create failed.\n");
+        return NULL;
+    }
+
+    ipa_ctx = talloc_get_type(pvt, struct ipa_id_ctx);
+    ipa_opts = ipa_ctx->ipa_options;
+    index = ipa_ctx->override_index;
+
+    state->ev = ev;
+    state->ipa_ctx = ipa_ctx;
+
+    if (ipa_ctx->view_name == NULL) {
+        DEBUG(SSSDBG_TRACE_FUNC, "View not known yet, nothing to index.\n");
+        ret = EOK;
+        goto done;
+    }
+
+    if (is_default_view(ipa_ctx->view_name)) {
+        state->view_name = IPA_DEFAULT_VIEW_NAME;
+    } else {
+        state->view_name = ipa_ctx->view_name;
+    }
+
+    full_interval = dp_opt_get_int(ipa_opts->basic,
+                                   IPA_OVERRIDE_INDEX_FULL_REFRESH);
+
+    state->full = !ipa_override_index_is_loaded(index, state->view_name)
+                  || index->modstamp == NULL
+                  || time(NULL) - index->last_full_refresh >= full_interval;
+
+    if (state->full) {
+        state->filter = talloc_asprintf(state, "(objectClass=%s)",
+                            ipa_opts->override_map[IPA_OC_OVERRIDE].name);
+    } else {
+        state->filter = talloc_asprintf(state,
+                            "(&(objectClass=%s)(modifyTimestamp>=%s))",
+                            ipa_opts->override_map[IPA_OC_OVERRIDE].name,
+                            index->modstamp);
+    }
+    if (state->filter == NULL) {
+        ret = ENOMEM;
+        goto done;
+    }
+
+    /* The override map extended with the modification timestamp */
+    state->map = talloc_zero_array(state, struct sdap_attr_map,
+                                   IPA_OPTS_OVERRIDE + 2);
+    if (state->map == NULL) {
+        ret = ENOMEM;
+        goto done;
+    }
+    memcpy(state->map, ipa_opts->override_map,
+           sizeof(struct sdap_attr_map) * IPA_OPTS_OVERRIDE);
+    state->map[IPA_OPTS_OVERRIDE].opt_name = "ipa_override_modstamp";
+    state->map[IPA_OPTS_OVERRIDE].def_name = "modifyTimestamp";
+    state->map[IPA_OPTS_OVERRIDE].sys_name = SYSDB_ORIG_MODSTAMP;
+    state->map[IPA_OPTS_OVERRIDE].name = discard_const("modifyTimestamp");
+
+    state->sdap_op = sdap_id_op_create(state,
+                                       ipa_ctx->sdap_id_ctx->conn->conn_cache);
+    if (state->sdap_op == NULL) {
+        DEBUG(SSSDBG_OP_FAILURE, "sdap_id_op_create failed\n");
+        ret = ENOMEM;
+        goto done;
+    }
+
+    subreq = sdap_id_op_connect_send(state->sdap_op, state, &ret);
+    if (subreq == NULL) {
+        DEBUG(SSSDBG_OP_FAILURE, "sdap_id_op_connect_send failed: %d(%s).\n",
+                                  ret, strerror(ret));
+        goto done;
+    }
+
+    tevent_req_set_callback(subreq, ipa_override_index_refresh_connect_done,
+                            req);
+
+    return req;
+
+done:
+    if (ret != EOK) {
+        tevent_req_error(req, ret);
+    } else {
+        tevent_req_done(req);
+    }
+    tevent_req_post(req, ev);
+
+    return req;
+}
+
+static void ipa_override_index_refresh_connect_done(struct tevent_req *subreq)
+{
+    struct tevent_req *req = tevent_req_callback_data(subreq,
+                                                      struct tevent_req);
+    struct ipa_override_index_refresh_state *state = tevent_req_data(req,
+                                     struct ipa_override_index_refresh_state);
+    struct sdap_id_ctx *sdap_id_ctx = state->ipa_ctx->sdap_id_ctx;
+    char *search_base;
+    int dp_error;
+    int ret;
+
+    ret = sdap_id_op_connect_recv(subreq, &dp_error);
+    talloc_zfree(subreq);
+    if (ret != EOK) {
+        DEBUG(SSSDBG_MINOR_FAILURE,
+              "Failed to connect to IPA server: [%d](%s)\n",
+              ret, strerror(ret));
+        goto fail;
+    }
+
+    search_base = talloc_asprintf(state, "cn=%s,%s", state->view_name,
+                state->ipa_ctx->ipa_options->views_search_bases[0]->basedn);
+    if (search_base == NULL) {
+        DEBUG(SSSDBG_OP_FAILURE, "talloc_asprintf failed.\n");
+        ret = ENOMEM;
+        goto fail;
+    }
+
+    DEBUG(SSSDBG_TRACE_FUNC,
+          "Indexing overrides in view [%s] with filter [%s].\n",
+          state->view_name, state->filter);
+
+    subreq = sdap_get_generic_send(state, state->ev, sdap_id_ctx->opts,
+                                 sdap_id_op_handle(state->sdap_op), search_base,
+                                 LDAP_SCOPE_SUBTREE,
+                                 state->filter, NULL,
+                                 state->map, IPA_OPTS_OVERRIDE + 1,
+                                 dp_opt_get_int(sdap_id_ctx->opts->basic,
+                                                SDAP_ENUM_SEARCH_TIMEOUT),
+                                 true);
+    if (subreq == NULL) {
+        DEBUG(SSSDBG_OP_FAILURE, "sdap_get_generic_send failed.\n");
+        ret = ENOMEM;
+        goto fail;
+    }
+
+    tevent_req_set_callback(subreq, ipa_override_index_refresh_done, req);
+    return;
+
+fail:
+    tevent_req_error(req, ret);
+    return;
+}
+
+static void ipa_override_index_refresh_done(struct tevent_req *subreq)
+{
+    struct tevent_req *req = tevent_req_callback_data(subreq,
+                                                      struct tevent_req);
+    struct ipa_override_index_refresh_state *state = tevent_req_data(req,
+                                     struct ipa_override_index_refresh_state);
+    size_t reply_count = 0;
+    struct sysdb_attrs **reply = NULL;
+    int ret;
+
+    ret = sdap_get_generic_recv(subreq, state, &reply_count, &reply);
+    talloc_zfree(subreq);
+    if (ret != EOK) {
+        DEBUG(SSSDBG_OP_FAILURE, "Override index refresh failed.\n");
+        goto fail;
+    }
+
+    ret = ipa_override_index_update(state->ipa_ctx->override_index,
+                                    state->view_name, state->full,
+                                    reply, reply_count);
+    if (ret != EOK) {
+        DEBUG(SSSDBG_OP_FAILURE, "Unable to update override index "
+              "[%d]: %s\n", ret, sss_strerror(ret));
+        goto fail;
+    }
+
+    tevent_req_done(req);
+    return;
+
+fail:
+    tevent_req_error(req, ret);
+    return;
+}
+
+static errno_t ipa_override_index_refresh_recv(struct tevent_req *req)
+{
+    TEVENT_REQ_RETURN_ON_ERROR(req);
+
+    return EOK;
+}
+
+errno_t ipa_override_index_setup(struct be_ctx *be_ctx,
+                                 struct ipa_id_ctx *ipa_ctx)
+{
+    struct ipa_options *ipa_opts = ipa_ctx->ipa_options;
+    time_t full_interval;
+    time_t smart_interval;
+    time_t period;
+    errno_t ret;
+
+    full_interval = dp_opt_get_int(ipa_opts->basic,
+                                   IPA_OVERRIDE_INDEX_FULL_REFRESH);
+    smart_interval = dp_opt_get_int(ipa_opts->basic,
+                                    IPA_OVERRIDE_INDEX_SMART_REFRESH);
+    if (full_interval <= 0) {
+        DEBUG(SSSDBG_TRACE_FUNC, "Override index is disabled.\n");
+        return EOK;
+    }
+
+    period = full_interval;
+    if (smart_interval > 0 && smart_interval < full_interval) {
+        period = smart_interval;
+    }
+
+    ret = ipa_override_index_create(ipa_ctx, &ipa_ctx->override_index);
+    if (ret != EOK) {
+        return ret;
+    }
+
+    ret = be_ptask_create(ipa_ctx, be_ctx, period, 0, 0, 0, period,
+                          BE_PTASK_OFFLINE_SKIP, 0,
+                          ipa_override_index_refresh_send,
+                          ipa_override_index_refresh_recv, ipa_ctx,
+                          "Override Index Refresh", NULL);
+    if (ret != EOK) {
+        DEBUG(SSSDBG_CRIT_FAILURE, "Unable to setup ptask "
+              "[%d]: %s\n", ret, sss_strerror(ret));
+        talloc_zfree(ipa_ctx->override_index);
+        return ret;
+    }
+
+    return EOK;
+}
@@ -188,6 +188,67 @@ static bool seuser_needs_update(struct input_buffer *ibuf)
     return needs_update;
 }
 
+static errno_t selinux_child_process(TALLOC_CTX *mem_ctx,
+                                     uint8_t *buf, size_t len,
+                                     struct response **_resp)
+{
+    struct input_buffer *ibuf;
+    errno_t ret;
+
+    ibuf = talloc_zero(NULL, struct input_buffer);
+    if (ibuf == NULL) {
+        DEBUG(SSSDBG_CRIT_FAILURE, "talloc_zero failed.\n");
+        return ENOMEM;
+    }
+
+    ret = unpack_buffer(buf, len, ibuf);
+    if (ret != EOK) {
+        DEBUG(SSSDBG_CRIT_FAILURE,
+              "unpack_buffer failed.[%d][%s].\n", ret, strerror(ret));
+        goto done;
+    }
+
+    DEBUG(SSSDBG_TRACE_FUNC, "performing selinux operations\n");
+
+    if (seuser_needs_update(ibuf)) {
+        ret = sc_set_seuser(ibuf->username, ibuf->seuser, ibuf->mls_range);
+        if (ret != EOK) {
+            DEBUG(SSSDBG_CRIT_FAILURE, "Cannot set SELinux login context.\n");
+            goto done;
+        }
+    }
+
+    ret = prepare_response(mem_ctx, EOK, _resp);
+    if (ret != EOK) {
+        DEBUG(SSSDBG_CRIT_FAILURE, "Failed to prepare response buffer.\n");
+        goto done;
+    }
+
+done:
+    talloc_free(ibuf);
+    return ret;
+}
+
+static errno_t selinux_child_worker_handler(TALLOC_CTX *mem_ctx,
+                                            uint8_t *req_buf,
+                                            uint32_t req_len,
+                                            uint8_t **_reply,
+                                            uint32_t *_reply_len,
+                                            void *pvt)
+{
+    struct response *resp = NULL;
+    errno_t ret;
+
+    ret = selinux_child_process(mem_ctx, req_buf, req_len, &resp);
+    if (ret != EOK) {
+        return ret;
+    }
+
+    *_reply = resp->buf;
+    *_reply_len = resp->size;
+    return EOK;
+}
+
 int main(int argc, const char *argv[])
 {
     int opt;
@@ -197,10 +258,9 @@ int main(int argc, const char *argv[])
     TALLOC_CTX *main_ctx = NULL;
     uint8_t *buf = NULL;
     ssize_t len = 0;
-    struct input_buffer *ibuf = NULL;
     struct response *resp = NULL;
     ssize_t written;
-    bool needs_update;
+    int worker = 0;
 
     struct poptOption long_options[] = {
         POPT_AUTOHELP
@@ -215,6 +275,8 @@ int main(int argc, const char *argv[])
         {"debug-to-stderr", 0, POPT_ARG_NONE | POPT_ARGFLAG_DOC_HIDDEN,
          &debug_to_stderr, 0,
          _("Send the debug output to stderr directly."), NULL },
+        {"worker", 0, POPT_ARG_NONE, &worker, 0,
+         _("Serve framed requests until the input is closed"), NULL},
         POPT_TABLEEND
     };
 
@@ -279,6 +341,11 @@ int main(int argc, const char *argv[])
           "Running with real IDs [%"SPRIuid"][%"SPRIgid"].\n",
           getuid(), getgid());
 
+    if (worker) {
+        sss_child_worker("selinux_child", STDIN_FILENO, STDOUT_FILENO,
+                         selinux_child_worker_handler, NULL);
+    }
+
     main_ctx = talloc_new(NULL);
     if (main_ctx == NULL) {
         DEBUG(SSSDBG_CRIT_FAILURE, "talloc_new failed.\n");
@@ -293,12 +360,6 @@ int main(int argc, const char *argv[])
         goto fail;
     }
 
-    ibuf = talloc_zero(main_ctx, struct input_buffer);
-    if (ibuf == NULL) {
-        DEBUG(SSSDBG_CRIT_FAILURE, "talloc_zero failed.\n");
-        goto fail;
-    }
-
     DEBUG(SSSDBG_TRACE_FUNC, "context initialized\n");
 
     errno = 0;
@@ -311,27 +372,8 @@ int main(int argc, const char *argv[])
 
     close(STDIN_FILENO);
 
-    ret = unpack_buffer(buf, len, ibuf);
+    ret = selinux_child_process(main_ctx, buf, len, &resp);
     if (ret != EOK) {
-        DEBUG(SSSDBG_CRIT_FAILURE,
-              "unpack_buffer failed.[%d][%s].\n", ret, strerror(ret));
-        goto fail;
-    }
-
-    DEBUG(SSSDBG_TRACE_FUNC, "performing selinux operations\n");
-
-    needs_update = seuser_needs_update(ibuf);
-    if (needs_update == true) {
-        ret = sc_set_seuser(ibuf->username, ibuf->seuser, ibuf->mls_range);
-        if (ret != EOK) {
-            DEBUG(SSSDBG_CRIT_FAILURE, "Cannot set SELinux login context.\n");
-            goto fail;
-        }
-    }
-
-    ret = prepare_response(main_ctx, ret, &resp);
-    if (ret != EOK) {
-        DEBUG(SSSDBG_CRIT_FAILURE, "Failed to prepare response buffer.\n");
         goto fail;
     }
 
@@ -95,6 +95,12 @@ struct tevent_req *handle_child_send(TALLOC_CTX *mem_ctx,
 int handle_child_recv(struct tevent_req *req, TALLOC_CTX *mem_ctx,
                       uint8_t **buf, ssize_t *len);
 
+/* Pre-fork krb5_child workers if krb5_child_pool_size is set. The workers
+ * are then used by handle_child_send() instead of forking a new krb5_child
+ * for every request. */
+errno_t krb5_child_pool_init(struct krb5_ctx *krb5_ctx,
+                             struct tevent_context *ev);
+
 struct krb5_child_response {
     int32_t msg_status;
     struct tgt_times tgtt;
@@ -65,6 +65,7 @@ struct krb5_req {
     char *realm;
     char *ccname;
     char *keytab;
+    krb5_keytab mem_keytab;
     bool validate;
     bool send_pac;
     bool use_enterprise_princ;
@@ -995,21 +996,11 @@ static errno_t k5c_attach_ccname_msg(struct krb5_req *kr)
     return ret;
 }
 
-static errno_t k5c_send_data(struct krb5_req *kr, int fd, errno_t error)
+static errno_t k5c_send_data(int fd, uint8_t *buf, size_t len)
 {
     ssize_t written;
-    uint8_t *buf;
-    size_t len;
     int ret;
 
-    DEBUG(SSSDBG_FUNC_DATA, "Received error code %d\n", error);
-
-    ret = pack_response_packet(kr, error, kr->pd->resp_list, &buf, &len);
-    if (ret != EOK) {
-        DEBUG(SSSDBG_CRIT_FAILURE, "pack_response_packet failed.\n");
-        return ret;
-    }
-
     errno = 0;
     written = sss_atomic_write_s(fd, buf, len);
     if (written == -1) {
@@ -1991,8 +1982,15 @@ static int krb5_cleanup(struct krb5_req *kr)
         sss_krb5_free_unparsed_name(kr->ctx, kr->name);
     if (kr->princ != NULL)
         krb5_free_principal(kr->ctx, kr->princ);
-    if (kr->ctx != NULL)
+    /* The MEMORY keytab lives as long as a handle is open, a worker must
+     * start the next request with a fresh copy. */
+    if (kr->mem_keytab != NULL)
+        krb5_kt_close(kr->ctx, kr->mem_keytab);
+    if (kr->ctx != NULL) {
+        if (krb5_error_ctx == kr->ctx)
+            krb5_error_ctx = NULL;
         krb5_free_context(kr->ctx);
+    }
 
     memset(kr, 0, sizeof(struct krb5_req));
 
@@ -2224,12 +2222,18 @@ done:
     return kerr;
 }
 
-static errno_t k5c_recv_data(struct krb5_req *kr, int fd, uint32_t *offline)
+static errno_t k5c_recv_data(TALLOC_CTX *mem_ctx, int fd,
+                             uint8_t **_buf, size_t *_len)
 {
-    uint8_t buf[IN_BUF_SIZE];
+    uint8_t *buf;
     ssize_t len;
     errno_t ret;
 
+    buf = talloc_size(mem_ctx, IN_BUF_SIZE);
+    if (buf == NULL) {
+        return ENOMEM;
+    }
+
     errno = 0;
     len = sss_atomic_read_s(fd, buf, IN_BUF_SIZE);
     if (len == -1) {
@@ -2237,15 +2241,13 @@ static errno_t k5c_recv_data(struct krb5_req *kr, int fd, uint32_t *offline)
         ret = (ret == 0) ? EINVAL: ret;
         DEBUG(SSSDBG_CRIT_FAILURE,
               "read failed [%d][%s].\n", ret, strerror(ret));
+        talloc_free(buf);
         return ret;
     }
 
-    ret = unpack_buffer(buf, len, kr, offline);
-    if (ret != EOK) {
-        DEBUG(SSSDBG_CRIT_FAILURE, "unpack_buffer failed.\n");
-    }
-
-    return ret;
+    *_buf = buf;
+    *_len = len;
+    return EOK;
 }
 
 static int k5c_setup_fast(struct krb5_req *kr, bool demand)
@@ -2628,7 +2630,7 @@ static krb5_error_code privileged_krb5_setup(struct krb5_req *kr,
     if (!(offline ||
             (kr->fast_val == K5C_FAST_NEVER && kr->validate == false))) {
         kerr = copy_keytab_into_memory(kr, kr->ctx, kr->keytab, &mem_keytab,
-                                       NULL);
+                                       &kr->mem_keytab);
         if (kerr != 0) {
             DEBUG(SSSDBG_OP_FAILURE, "copy_keytab_into_memory failed.\n");
             return kerr;
@@ -2680,91 +2682,42 @@ static void try_open_krb5_conf(void)
     }
 }
 
-int main(int argc, const char *argv[])
-{
-    struct krb5_req *kr = NULL;
-    uint32_t offline;
-    int opt;
-    poptContext pc;
-    int debug_fd = -1;
-    errno_t ret;
-    krb5_error_code kerr;
+struct k5c_worker_ctx {
     uid_t fast_uid;
     gid_t fast_gid;
+    bool sss_loops;
+};
 
-    struct poptOption long_options[] = {
-        POPT_AUTOHELP
-        {"debug-level", 'd', POPT_ARG_INT, &debug_level, 0,
-         _("Debug level"), NULL},
-        {"debug-timestamps", 0, POPT_ARG_INT, &debug_timestamps, 0,
-         _("Add debug timestamps"), NULL},
-        {"debug-microseconds", 0, POPT_ARG_INT, &debug_microseconds, 0,
-         _("Show timestamps with microseconds"), NULL},
-        {"debug-fd", 0, POPT_ARG_INT, &debug_fd, 0,
-         _("An open file descriptor for the debug logs"), NULL},
-        {"debug-to-stderr", 0, POPT_ARG_NONE | POPT_ARGFLAG_DOC_HIDDEN,
-         &debug_to_stderr, 0,
-         _("Send the debug output to stderr directly."), NULL },
-        {"fast-ccache-uid", 0, POPT_ARG_INT, &fast_uid, 0,
-          _("The user to create FAST ccache as"), NULL},
-        {"fast-ccache-gid", 0, POPT_ARG_INT, &fast_gid, 0,
-          _("The group to create FAST ccache as"), NULL},
-        POPT_TABLEEND
-    };
-
-    /* Set debug level to invalid value so we can decide if -d 0 was used. */
-    debug_level = SSSDBG_INVALID;
-
-    pc = poptGetContext(argv[0], argc, argv, long_options, 0);
-    while((opt = poptGetNextOpt(pc)) != -1) {
-        switch(opt) {
-        default:
-        fprintf(stderr, "\nInvalid option %s: %s\n\n",
-                  poptBadOption(pc, 0), poptStrerror(opt));
-            poptPrintUsage(pc, stderr, 0);
-            _exit(-1);
-        }
-    }
-
-    poptFreeContext(pc);
-
-    DEBUG_INIT(debug_level);
-
-    debug_prg_name = talloc_asprintf(NULL, "[sssd[krb5_child[%d]]]", getpid());
-    if (!debug_prg_name) {
-        debug_prg_name = "[sssd[krb5_child]]";
-        DEBUG(SSSDBG_CRIT_FAILURE, "talloc_asprintf failed.\n");
-        ret = ENOMEM;
-        goto done;
-    }
-
-    if (debug_fd != -1) {
-        ret = set_debug_file_from_fd(debug_fd);
-        if (ret != EOK) {
-            DEBUG(SSSDBG_CRIT_FAILURE, "set_debug_file_from_fd failed.\n");
-        }
-    }
-
-    DEBUG(SSSDBG_TRACE_FUNC, "krb5_child started.\n");
+/* Handles one request and packs the reply. A helper started for this
+ * request only drops the privileges for good, a worker switches to the user
+ * for the request and back to root afterwards. */
+static errno_t k5c_process(TALLOC_CTX *mem_ctx,
+                           uint8_t *buf, size_t len,
+                           uid_t fast_uid, gid_t fast_gid,
+                           bool worker,
+                           uint8_t **_reply, size_t *_reply_len)
+{
+    struct krb5_req *kr;
+    struct sss_creds *saved_creds = NULL;
+    uint32_t offline;
+    krb5_error_code kerr;
+    errno_t ret;
 
     kr = talloc_zero(NULL, struct krb5_req);
     if (kr == NULL) {
         DEBUG(SSSDBG_CRIT_FAILURE, "talloc failed.\n");
-        ret = ENOMEM;
-        goto done;
+        return ENOMEM;
     }
-    talloc_steal(kr, debug_prg_name);
 
     kr->fast_uid = fast_uid;
     kr->fast_gid = fast_gid;
 
-    ret = k5c_recv_data(kr, STDIN_FILENO, &offline);
+    ret = unpack_buffer(buf, len, kr, &offline);
     if (ret != EOK) {
+        DEBUG(SSSDBG_CRIT_FAILURE, "unpack_buffer failed.\n");
         goto done;
     }
 
-    close(STDIN_FILENO);
-
     kerr = privileged_krb5_setup(kr, offline);
     if (kerr != 0) {
         DEBUG(SSSDBG_CRIT_FAILURE, "privileged_krb5_setup failed.\n");
@@ -2772,9 +2725,13 @@ int main(int argc, const char *argv[])
         goto done;
     }
 
-    kerr = become_user(kr->uid, kr->gid);
+    if (worker) {
+        kerr = switch_creds(kr, kr->uid, kr->gid, 0, NULL, &saved_creds);
+    } else {
+        kerr = become_user(kr->uid, kr->gid);
+    }
     if (kerr != 0) {
-        DEBUG(SSSDBG_CRIT_FAILURE, "become_user failed.\n");
+        DEBUG(SSSDBG_CRIT_FAILURE, "Cannot drop privileges.\n");
         ret = EFAULT;
         goto done;
     }
@@ -2832,7 +2789,160 @@ int main(int argc, const char *argv[])
         goto done;
     }
 
-    ret = k5c_send_data(kr, STDOUT_FILENO, ret);
+    DEBUG(SSSDBG_FUNC_DATA, "Received error code %d\n", ret);
+
+    ret = pack_response_packet(mem_ctx, ret, kr->pd->resp_list,
+                               _reply, _reply_len);
+    sss_authtok_set_empty(kr->pd->authtok);
+    if (ret != EOK) {
+        DEBUG(SSSDBG_CRIT_FAILURE, "pack_response_packet failed.\n");
+        goto done;
+    }
+
+done:
+    if (saved_creds != NULL) {
+        if (restore_creds(saved_creds) != EOK) {
+            DEBUG(SSSDBG_CRIT_FAILURE, "Cannot restore privileges.\n");
+            ret = EPERM;
+        }
+    }
+    krb5_cleanup(kr);
+    talloc_free(kr);
+    return ret;
+}
+
+static errno_t k5c_worker_handler(TALLOC_CTX *mem_ctx,
+                                  uint8_t *req_buf, uint32_t req_len,
+                                  uint8_t **_reply, uint32_t *_reply_len,
+                                  void *pvt)
+{
+    struct k5c_worker_ctx *wctx = pvt;
+    size_t reply_len;
+    errno_t ret;
+
+    ret = k5c_process(mem_ctx, req_buf, req_len, wctx->fast_uid,
+                      wctx->fast_gid, true, _reply, &reply_len);
+
+    /* Account management unsets _SSS_LOOPS for krb5_kuserok(), the next
+     * request must not call back into SSSD. */
+    if (wctx->sss_loops && setenv("_SSS_LOOPS", "NO", 1) != 0) {
+        DEBUG(SSSDBG_CRIT_FAILURE, "Cannot restore _SSS_LOOPS.\n");
+        return EIO;
+    }
+
+    if (ret != EOK) {
+        return ret;
+    }
+
+    *_reply_len = reply_len;
+    return EOK;
+}
+
+int main(int argc, const char *argv[])
+{
+    TALLOC_CTX *main_ctx = NULL;
+    struct k5c_worker_ctx wctx;
+    uint8_t *buf = NULL;
+    size_t len = 0;
+    uint8_t *reply = NULL;
+    size_t reply_len = 0;
+    int opt;
+    poptContext pc;
+    int debug_fd = -1;
+    errno_t ret;
+    uid_t fast_uid;
+    gid_t fast_gid;
+    int worker = 0;
+
+    struct poptOption long_options[] = {
+        POPT_AUTOHELP
+        {"debug-level", 'd', POPT_ARG_INT, &debug_level, 0,
+         _("Debug level"), NULL},
+        {"debug-timestamps", 0, POPT_ARG_INT, &debug_timestamps, 0,
+         _("Add debug timestamps"), NULL},
+        {"debug-microseconds", 0, POPT_ARG_INT, &debug_microseconds, 0,
+         _("Show timestamps with microseconds"), NULL},
+        {"debug-fd", 0, POPT_ARG_INT, &debug_fd, 0,
+         _("An open file descriptor for the debug logs"), NULL},
+        {"debug-to-stderr", 0, POPT_ARG_NONE | POPT_ARGFLAG_DOC_HIDDEN,
+         &debug_to_stderr, 0,
+         _("Send the debug output to stderr directly."), NULL },
+        {"fast-ccache-uid", 0, POPT_ARG_INT, &fast_uid, 0,
+          _("The user to create FAST ccache as"), NULL},
+        {"fast-ccache-gid", 0, POPT_ARG_INT, &fast_gid, 0,
+          _("The group to create FAST ccache as"), NULL},
+        {"worker", 0, POPT_ARG_NONE, &worker, 0,
+          _("Serve framed requests until the input is closed"), NULL},
+        POPT_TABLEEND
+    };
+
+    /* Set debug level to invalid value so we can decide if -d 0 was used. */
+    debug_level = SSSDBG_INVALID;
+
+    pc = poptGetContext(argv[0], argc, argv, long_options, 0);
+    while((opt = poptGetNextOpt(pc)) != -1) {
+        switch(opt) {
+        default:
+        fprintf(stderr, "\nInvalid option %s: %s\n\n",
+                  poptBadOption(pc, 0), poptStrerror(opt));
+            poptPrintUsage(pc, stderr, 0);
+            _exit(-1);
+        }
+    }
+
+    poptFreeContext(pc);
+
+    DEBUG_INIT(debug_level);
+
+    debug_prg_name = talloc_asprintf(NULL, "[sssd[krb5_child[%d]]]", getpid());
+    if (!debug_prg_name) {
+        debug_prg_name = "[sssd[krb5_child]]";
+        DEBUG(SSSDBG_CRIT_FAILURE, "talloc_asprintf failed.\n");
+        ret = ENOMEM;
+        goto done;
+    }
+
+    if (debug_fd != -1) {
+        ret = set_debug_file_from_fd(debug_fd);
+        if (ret != EOK) {
+            DEBUG(SSSDBG_CRIT_FAILURE, "set_debug_file_from_fd failed.\n");
+        }
+    }
+
+    DEBUG(SSSDBG_TRACE_FUNC, "krb5_child started.\n");
+
+    if (worker) {
+        /* The worker stays root and switches to the user of each request
+         * only while handling it. */
+        wctx.fast_uid = fast_uid;
+        wctx.fast_gid = fast_gid;
+        wctx.sss_loops = getenv("_SSS_LOOPS") != NULL;
+        sss_child_worker("krb5_child", STDIN_FILENO, STDOUT_FILENO,
+                         k5c_worker_handler, &wctx);
+    }
+
+    main_ctx = talloc_new(NULL);
+    if (main_ctx == NULL) {
+        DEBUG(SSSDBG_CRIT_FAILURE, "talloc failed.\n");
+        ret = ENOMEM;
+        goto done;
+    }
+    talloc_steal(main_ctx, debug_prg_name);
+
+    ret = k5c_recv_data(main_ctx, STDIN_FILENO, &buf, &len);
+    if (ret != EOK) {
+        goto done;
+    }
+
+    close(STDIN_FILENO);
+
+    ret = k5c_process(main_ctx, buf, len, fast_uid, fast_gid, false,
+                      &reply, &reply_len);
+    if (ret != EOK) {
+        goto done;
+    }
+
+    ret = k5c_send_data(STDOUT_FILENO, reply, reply_len);
     if (ret != EOK) {
         DEBUG(SSSDBG_CRIT_FAILURE, "Failed to send reply\n");
     }
@@ -2845,7 +2955,6 @@ done:
         DEBUG(SSSDBG_CRIT_FAILURE, "krb5_child failed!\n");
         ret = -1;
     }
-    krb5_cleanup(kr);
-    talloc_free(kr);
+    talloc_free(main_ctx);
     exit(ret);
 }
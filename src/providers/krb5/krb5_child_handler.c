@@ -353,8 +353,53 @@ fail:
     return ret;
 }
 
+errno_t krb5_child_pool_init(struct krb5_ctx *krb5_ctx,
+                             struct tevent_context *ev)
+{
+    const char *k5c_extra_args[3];
+    int pool_size;
+    int max_requests;
+    errno_t ret;
+
+    pool_size = dp_opt_get_int(krb5_ctx->opts, KRB5_CHILD_POOL_SIZE);
+    if (pool_size <= 0) {
+        DEBUG(SSSDBG_TRACE_FUNC, "krb5_child pool is disabled.\n");
+        return EOK;
+    }
+
+    max_requests = dp_opt_get_int(krb5_ctx->opts,
+                                  KRB5_CHILD_POOL_MAX_REQUESTS);
+
+    k5c_extra_args[0] = talloc_asprintf(krb5_ctx, "--fast-ccache-uid=%"SPRIuid, getuid());
+    k5c_extra_args[1] = talloc_asprintf(krb5_ctx, "--fast-ccache-gid=%"SPRIgid, getgid());
+    k5c_extra_args[2] = NULL;
+    if (k5c_extra_args[0] == NULL || k5c_extra_args[1] == NULL) {
+        ret = ENOMEM;
+        goto done;
+    }
+
+    /* Nothing is queued, a request that does not find an idle worker
+     * forks a krb5_child of its own. */
+    ret = sss_child_pool_create(krb5_ctx, ev, KRB5_CHILD,
+                                krb5_ctx->child_debug_fd, k5c_extra_args,
+                                STDIN_FILENO, STDOUT_FILENO, pool_size,
+                                max_requests > 0 ? max_requests : 0, 0,
+                                &krb5_ctx->child_pool);
+    if (ret != EOK) {
+        DEBUG(SSSDBG_CRIT_FAILURE, "Cannot create krb5_child pool [%d]: %s\n",
+              ret, sss_strerror(ret));
+        goto done;
+    }
+
+done:
+    talloc_free(discard_const(k5c_extra_args[0]));
+    talloc_free(discard_const(k5c_extra_args[1]));
+    return ret;
+}
+
 static void handle_child_step(struct tevent_req *subreq);
 static void handle_child_done(struct tevent_req *subreq);
+static void handle_child_pool_done(struct tevent_req *subreq);
 
 struct tevent_req *handle_child_send(TALLOC_CTX *mem_ctx,
                                      struct tevent_context *ev,
@@ -393,6 +438,20 @@ struct tevent_req *handle_child_send(TALLOC_CTX *mem_ctx,
         goto fail;
     }
 
+    if (sss_child_pool_accepts(kr->krb5_ctx->child_pool)) {
+        subreq = sss_child_pool_send(state, ev, kr->krb5_ctx->child_pool,
+                                     buf->data, buf->size,
+                                     dp_opt_get_int(kr->krb5_ctx->opts,
+                                                    KRB5_AUTH_TIMEOUT));
+        if (subreq == NULL) {
+            ret = ENOMEM;
+            goto fail;
+        }
+        tevent_req_set_callback(subreq, handle_child_pool_done, req);
+
+        return req;
+    }
+
     ret = fork_child(req);
     if (ret != EOK) {
         DEBUG(SSSDBG_CRIT_FAILURE, "fork_child failed.\n");
@@ -463,6 +522,25 @@ static void handle_child_done(struct tevent_req *subreq)
     return;
 }
 
+static void handle_child_pool_done(struct tevent_req *subreq)
+{
+    struct tevent_req *req = tevent_req_callback_data(subreq,
+                                                      struct tevent_req);
+    struct handle_child_state *state = tevent_req_data(req,
+                                                    struct handle_child_state);
+    int ret;
+
+    ret = sss_child_pool_recv(subreq, state, &state->buf, &state->len);
+    talloc_zfree(subreq);
+    if (ret != EOK) {
+        tevent_req_error(req, ret);
+        return;
+    }
+
+    tevent_req_done(req);
+    return;
+}
+
 int handle_child_recv(struct tevent_req *req, TALLOC_CTX *mem_ctx,
                       uint8_t **buf, ssize_t *len)
 {
@@ -68,6 +68,8 @@ enum krb5_opts {
     KRB5_USE_ENTERPRISE_PRINCIPAL,
     KRB5_USE_KDCINFO,
     KRB5_MAP_USER,
+    KRB5_CHILD_POOL_SIZE,
+    KRB5_CHILD_POOL_MAX_REQUESTS,
 
     KRB5_OPTS
 };
@@ -83,6 +85,7 @@ struct krb5_service {
 struct fo_service;
 struct deferred_auth_ctx;
 struct renew_tgt_ctx;
+struct sss_child_pool;
 
 enum krb5_config_type {
     K5C_GENERIC,
@@ -136,6 +139,8 @@ struct krb5_ctx {
     enum krb5_config_type config_type;
 
     struct map_id_name_to_krb_primary *name_to_primary;
+
+    struct sss_child_pool *child_pool;
 };
 
 struct remove_info_files_ctx {
@@ -91,6 +91,12 @@ errno_t krb5_child_init(struct krb5_ctx *krb5_auth_ctx,
         goto done;
     }
 
+    ret = krb5_child_pool_init(krb5_auth_ctx, bectx->ev);
+    if (ret != EOK) {
+        DEBUG(SSSDBG_OP_FAILURE, "krb5_child_pool_init failed.\n");
+        goto done;
+    }
+
     ret = parse_krb5_map_user(krb5_auth_ctx,
                               dp_opt_get_cstring(krb5_auth_ctx->opts,
                                                  KRB5_MAP_USER),
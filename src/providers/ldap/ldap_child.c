@@ -73,6 +73,7 @@ struct input_buffer {
     char *keytab_name;
     krb5_deltat lifetime;
     krb5_context context;
+    krb5_keytab mem_keytab;
     uid_t uid;
     gid_t gid;
 };
@@ -524,7 +525,6 @@ static krb5_error_code ldap_child_get_tgt_sync(TALLOC_CTX *memctx,
 done:
     if (krberr != 0) KRB5_SYSLOG(krberr);
     if (keytab) krb5_kt_close(context, keytab);
-    if (context) krb5_free_context(context);
     talloc_free(tmp_ctx);
     return krberr;
 }
@@ -583,7 +583,7 @@ static krb5_error_code privileged_krb5_setup(struct input_buffer *ibuf)
     DEBUG(SSSDBG_TRACE_INTERNAL, "Kerberos context initialized\n");
 
     kerr = copy_keytab_into_memory(ibuf, ibuf->context, ibuf->keytab_name,
-                                   &keytab_name, NULL);
+                                   &keytab_name, &ibuf->mem_keytab);
     if (kerr != 0) {
         DEBUG(SSSDBG_OP_FAILURE, "copy_keytab_into_memory failed.\n");
         return kerr;
@@ -594,21 +594,140 @@ static krb5_error_code privileged_krb5_setup(struct input_buffer *ibuf)
     return 0;
 }
 
+static void krb5_cleanup(struct input_buffer *ibuf)
+{
+    if (ibuf->context == NULL) {
+        return;
+    }
+
+    /* The MEMORY keytab lives as long as a handle is open, close it so that
+     * the next request of a worker starts with a fresh copy. */
+    if (ibuf->mem_keytab != NULL) {
+        krb5_kt_close(ibuf->context, ibuf->mem_keytab);
+        ibuf->mem_keytab = NULL;
+    }
+
+    krb5_error_ctx = NULL;
+    krb5_free_context(ibuf->context);
+    ibuf->context = NULL;
+}
+
+/* Handles one request. A helper started for this request only drops the
+ * privileges for good, a worker switches back to them afterwards. */
+static errno_t ldap_child_process(TALLOC_CTX *mem_ctx,
+                                  uint8_t *buf, size_t len,
+                                  bool worker,
+                                  struct response **_resp)
+{
+    TALLOC_CTX *tmp_ctx;
+    struct input_buffer *ibuf;
+    struct sss_creds *saved_creds = NULL;
+    const char *ccname = NULL;
+    time_t expire_time = 0;
+    krb5_error_code kerr;
+    errno_t ret;
+
+    tmp_ctx = talloc_new(NULL);
+    if (tmp_ctx == NULL) {
+        return ENOMEM;
+    }
+
+    ibuf = talloc_zero(tmp_ctx, struct input_buffer);
+    if (ibuf == NULL) {
+        DEBUG(SSSDBG_CRIT_FAILURE, "talloc_zero failed.\n");
+        ret = ENOMEM;
+        goto done;
+    }
+
+    ret = unpack_buffer(buf, len, ibuf);
+    if (ret != EOK) {
+        DEBUG(SSSDBG_CRIT_FAILURE,
+              "unpack_buffer failed.[%d][%s].\n", ret, strerror(ret));
+        goto done;
+    }
+
+    kerr = privileged_krb5_setup(ibuf);
+    if (kerr != EOK) {
+        DEBUG(SSSDBG_CRIT_FAILURE, "Privileged Krb5 setup failed.\n");
+        ret = EFAULT;
+        goto done;
+    }
+    DEBUG(SSSDBG_TRACE_INTERNAL, "Kerberos context initialized\n");
+
+    if (worker) {
+        ret = switch_creds(tmp_ctx, ibuf->uid, ibuf->gid, 0, NULL,
+                           &saved_creds);
+    } else {
+        ret = become_user(ibuf->uid, ibuf->gid);
+    }
+    if (ret != EOK) {
+        DEBUG(SSSDBG_CRIT_FAILURE, "Cannot drop privileges.\n");
+        goto done;
+    }
+
+    DEBUG(SSSDBG_TRACE_INTERNAL,
+          "Running as [%"SPRIuid"][%"SPRIgid"].\n", geteuid(), getegid());
+
+    DEBUG(SSSDBG_TRACE_INTERNAL, "getting TGT sync\n");
+    kerr = ldap_child_get_tgt_sync(tmp_ctx, ibuf->context,
+                                   ibuf->realm_str, ibuf->princ_str,
+                                   ibuf->keytab_name, ibuf->lifetime,
+                                   &ccname, &expire_time);
+    if (kerr != EOK) {
+        DEBUG(SSSDBG_CRIT_FAILURE, "ldap_child_get_tgt_sync failed.\n");
+        /* Do not return, must report failure */
+    }
+
+    ret = prepare_response(mem_ctx, ccname, expire_time, kerr, _resp);
+    if (ret != EOK) {
+        DEBUG(SSSDBG_CRIT_FAILURE, "prepare_response failed. [%d][%s].\n",
+                    ret, strerror(ret));
+        goto done;
+    }
+
+done:
+    if (saved_creds != NULL) {
+        if (restore_creds(saved_creds) != EOK) {
+            DEBUG(SSSDBG_CRIT_FAILURE, "Cannot restore privileges.\n");
+            ret = EPERM;
+        }
+    }
+    krb5_cleanup(ibuf);
+    talloc_free(tmp_ctx);
+    return ret;
+}
+
+static errno_t ldap_child_worker_handler(TALLOC_CTX *mem_ctx,
+                                         uint8_t *req_buf, uint32_t req_len,
+                                         uint8_t **_reply,
+                                         uint32_t *_reply_len,
+                                         void *pvt)
+{
+    struct response *resp = NULL;
+    errno_t ret;
+
+    ret = ldap_child_process(mem_ctx, req_buf, req_len, true, &resp);
+    if (ret != EOK) {
+        return ret;
+    }
+
+    *_reply = resp->buf;
+    *_reply_len = resp->size;
+    return EOK;
+}
+
 int main(int argc, const char *argv[])
 {
     int ret;
-    int kerr;
     int opt;
     int debug_fd = -1;
     poptContext pc;
     TALLOC_CTX *main_ctx = NULL;
     uint8_t *buf = NULL;
     ssize_t len = 0;
-    const char *ccname = NULL;
-    time_t expire_time = 0;
-    struct input_buffer *ibuf = NULL;
     struct response *resp = NULL;
     ssize_t written;
+    int worker = 0;
 
     struct poptOption long_options[] = {
         POPT_AUTOHELP
@@ -622,6 +741,8 @@ int main(int argc, const char *argv[])
          _("An open file descriptor for the debug logs"), NULL},
         {"debug-to-stderr", 0, POPT_ARG_NONE | POPT_ARGFLAG_DOC_HIDDEN, &debug_to_stderr, 0, \
          _("Send the debug output to stderr directly."), NULL }, \
+        {"worker", 0, POPT_ARG_NONE, &worker, 0,
+         _("Serve framed requests until the input is closed"), NULL},
         POPT_TABLEEND
     };
 
@@ -662,6 +783,11 @@ int main(int argc, const char *argv[])
 
     DEBUG(SSSDBG_TRACE_FUNC, "ldap_child started.\n");
 
+    if (worker) {
+        sss_child_worker("ldap_child", STDIN_FILENO, STDOUT_FILENO,
+                         ldap_child_worker_handler, NULL);
+    }
+
     main_ctx = talloc_new(NULL);
     if (main_ctx == NULL) {
         DEBUG(SSSDBG_CRIT_FAILURE, "talloc_new failed.\n");
@@ -676,12 +802,6 @@ int main(int argc, const char *argv[])
         goto fail;
     }
 
-    ibuf = talloc_zero(main_ctx, struct input_buffer);
-    if (ibuf == NULL) {
-        DEBUG(SSSDBG_CRIT_FAILURE, "talloc_size failed.\n");
-        goto fail;
-    }
-
     DEBUG(SSSDBG_TRACE_INTERNAL, "context initialized\n");
 
     errno = 0;
@@ -694,43 +814,8 @@ int main(int argc, const char *argv[])
 
     close(STDIN_FILENO);
 
-    ret = unpack_buffer(buf, len, ibuf);
-    if (ret != EOK) {
-        DEBUG(SSSDBG_CRIT_FAILURE,
-              "unpack_buffer failed.[%d][%s].\n", ret, strerror(ret));
-        goto fail;
-    }
-
-    kerr = privileged_krb5_setup(ibuf);
-    if (kerr != EOK) {
-        DEBUG(SSSDBG_CRIT_FAILURE, "Privileged Krb5 setup failed.\n");
-        goto fail;
-    }
-    DEBUG(SSSDBG_TRACE_INTERNAL, "Kerberos context initialized\n");
-
-    kerr = become_user(ibuf->uid, ibuf->gid);
-    if (kerr != 0) {
-        DEBUG(SSSDBG_CRIT_FAILURE, "become_user failed.\n");
-        goto fail;
-    }
-
-    DEBUG(SSSDBG_TRACE_INTERNAL,
-          "Running as [%"SPRIuid"][%"SPRIgid"].\n", geteuid(), getegid());
-
-    DEBUG(SSSDBG_TRACE_INTERNAL, "getting TGT sync\n");
-    kerr = ldap_child_get_tgt_sync(main_ctx, ibuf->context,
-                                   ibuf->realm_str, ibuf->princ_str,
-                                   ibuf->keytab_name, ibuf->lifetime,
-                                   &ccname, &expire_time);
-    if (kerr != EOK) {
-        DEBUG(SSSDBG_CRIT_FAILURE, "ldap_child_get_tgt_sync failed.\n");
-        /* Do not return, must report failure */
-    }
-
-    ret = prepare_response(main_ctx, ccname, expire_time, kerr, &resp);
+    ret = ldap_child_process(main_ctx, buf, len, false, &resp);
     if (ret != EOK) {
-        DEBUG(SSSDBG_CRIT_FAILURE, "prepare_response failed. [%d][%s].\n",
-                    ret, strerror(ret));
         goto fail;
     }
 
@@ -631,6 +631,11 @@ int sdap_service_init(TALLOC_CTX *memctx, struct be_ctx *ctx,
         goto done;
     }
 
+    ret = be_fo_set_service_probe(ctx, service_name, LDAP_PORT);
+    if (ret != EOK) {
+        goto done;
+    }
+
     service->name = talloc_strdup(service, service_name);
     if (!service->name) {
         ret = ENOMEM;
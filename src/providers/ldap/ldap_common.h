@@ -105,6 +105,33 @@ errno_t sdap_account_info_handler_recv(TALLOC_CTX *mem_ctx,
                                        struct tevent_req *req,
                                        struct dp_reply_std *data);
 
+struct tevent_req *
+sdap_account_batch_handler_send(TALLOC_CTX *mem_ctx,
+                                struct sdap_id_ctx *id_ctx,
+                                struct dp_id_batch_data *batch,
+                                struct dp_req_params *params);
+
+errno_t sdap_account_batch_handler_recv(TALLOC_CTX *mem_ctx,
+                                        struct tevent_req *req,
+                                        struct dp_reply_batch *data);
+
+/* Helpers of the batch handler, exported for tests. */
+bool sdap_account_batch_can_merge(struct sdap_id_ctx *id_ctx,
+                                  bool use_id_mapping,
+                                  struct dp_id_data *data);
+
+errno_t sdap_account_batch_filter(TALLOC_CTX *mem_ctx,
+                                  struct sdap_options *opts,
+                                  bool use_id_mapping,
+                                  const char **shortnames,
+                                  size_t num_names,
+                                  char **_filter);
+
+bool sdap_account_batch_user_found(struct sss_domain_info *domain,
+                                   struct sysdb_attrs **users,
+                                   size_t count,
+                                   const char *shortname);
+
 /* Set up enumeration and/or cleanup */
 int ldap_id_setup_tasks(struct sdap_id_ctx *ctx);
 int sdap_id_setup_tasks(struct be_ctx *be_ctx,
@@ -237,6 +264,15 @@ errno_t ldap_setup_cleanup(struct sdap_id_ctx *id_ctx,
 errno_t ldap_id_cleanup(struct sdap_options *opts,
                         struct sdap_domain *sdom);
 
+/* Same as ldap_id_cleanup() but expired entries are removed in small
+ * slices, each in its own transaction, yielding to the main loop in
+ * between. */
+struct tevent_req *ldap_id_cleanup_send(TALLOC_CTX *mem_ctx,
+                                        struct tevent_context *ev,
+                                        struct sdap_options *opts,
+                                        struct sdap_domain *sdom);
+errno_t ldap_id_cleanup_recv(struct tevent_req *req);
+
 struct tevent_req *groups_get_send(TALLOC_CTX *memctx,
                                    struct tevent_context *ev,
                                    struct sdap_id_ctx *ctx,
@@ -272,8 +308,10 @@ services_get_send(TALLOC_CTX *mem_ctx,
 errno_t
 services_get_recv(struct tevent_req *req, int *dp_error_out, int *sdap_ret);
 
-/* setup child logging */
-int sdap_setup_child(void);
+/* setup child logging and the pool of ldap_child workers */
+int sdap_setup_child(TALLOC_CTX *mem_ctx,
+                     struct tevent_context *ev,
+                     struct sdap_options *opts);
 
 
 errno_t string_to_shadowpw_days(const char *s, long *d);
@@ -0,0 +1,568 @@
+/*
+    SSSD
+
+    LDAP Identity Backend Module - batch account lookups
+
+    Copyright (C) 2016 Red Hat
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <errno.h>
+#include <strings.h>
+
+#include "util/util.h"
+#include "db/sysdb.h"
+#include "providers/ldap/ldap_common.h"
+#include "providers/ldap/sdap_async.h"
+#include "providers/ldap/sdap_async_private.h"
+#include "providers/ldap/sdap_idmap.h"
+
+/* Only plain lookups of users by name are merged into one search. Other
+ * lookups need per-entry processing (nested groups, UPN and certificate
+ * matching, local fallback, ...) and are run one by one. */
+bool sdap_account_batch_can_merge(struct sdap_id_ctx *id_ctx,
+                                  bool use_id_mapping,
+                                  struct dp_id_data *data)
+{
+    struct sdap_options *opts = id_ctx->opts;
+
+    if ((data->entry_type & BE_REQ_TYPE_MASK) != BE_REQ_USER
+            || data->filter_type != BE_FILTER_NAME
+            || data->extra_value != NULL) {
+        return false;
+    }
+
+    /* The local user fallback works with a single entry only. */
+    if (opts->schema_type == SDAP_SCHEMA_RFC2307
+            && dp_opt_get_bool(opts->basic,
+                               SDAP_RFC2307_FALLBACK_TO_LOCAL_USERS)) {
+        return false;
+    }
+
+    /* POSIX attributes check is run by the single lookup. */
+    if (opts->schema_type == SDAP_SCHEMA_AD && !use_id_mapping
+            && (id_ctx->srv_opts == NULL
+                || id_ctx->srv_opts->posix_checked == false)) {
+        return false;
+    }
+
+    return true;
+}
+
+/* Same filter as users_get_send() builds for a single name, with all the
+ * names in one OR. */
+errno_t sdap_account_batch_filter(TALLOC_CTX *mem_ctx,
+                                  struct sdap_options *opts,
+                                  bool use_id_mapping,
+                                  const char **shortnames,
+                                  size_t num_names,
+                                  char **_filter)
+{
+    TALLOC_CTX *tmp_ctx;
+    const char *name_attr;
+    char *clean_value;
+    char *user_filter;
+    char *filter;
+    size_t i;
+    errno_t ret;
+
+    tmp_ctx = talloc_new(NULL);
+    if (tmp_ctx == NULL) {
+        return ENOMEM;
+    }
+
+    name_attr = opts->user_map[SDAP_AT_USER_NAME].name;
+
+    user_filter = talloc_strdup(tmp_ctx, "(|");
+    if (user_filter == NULL) {
+        ret = ENOMEM;
+        goto done;
+    }
+
+    for (i = 0; i < num_names; i++) {
+        ret = sss_filter_sanitize(tmp_ctx, shortnames[i], &clean_value);
+        if (ret != EOK) {
+            goto done;
+        }
+
+        user_filter = talloc_asprintf_append_buffer(user_filter, "(%s=%s)",
+                                                    name_attr, clean_value);
+        if (user_filter == NULL) {
+            ret = ENOMEM;
+            goto done;
+        }
+    }
+
+    user_filter = talloc_strdup_append_buffer(user_filter, ")");
+    if (user_filter == NULL) {
+        ret = ENOMEM;
+        goto done;
+    }
+
+    if (use_id_mapping) {
+        filter = talloc_asprintf(tmp_ctx, "(&%s(objectclass=%s)(%s=*)(%s=*))",
+                         user_filter,
+                         opts->user_map[SDAP_OC_USER].name,
+                         name_attr,
+                         opts->user_map[SDAP_AT_USER_OBJECTSID].name);
+    } else {
+        filter = talloc_asprintf(tmp_ctx,
+                         "(&%s(objectclass=%s)(%s=*)(&(%s=*)(!(%s=0))))",
+                         user_filter,
+                         opts->user_map[SDAP_OC_USER].name,
+                         name_attr,
+                         opts->user_map[SDAP_AT_USER_UID].name,
+                         opts->user_map[SDAP_AT_USER_UID].name);
+    }
+    if (filter == NULL) {
+        ret = ENOMEM;
+        goto done;
+    }
+
+    *_filter = talloc_steal(mem_ctx, filter);
+    ret = EOK;
+
+done:
+    talloc_free(tmp_ctx);
+    return ret;
+}
+
+/* Returns true if any of the returned users has @shortname as one of its
+ * names. */
+bool sdap_account_batch_user_found(struct sss_domain_info *domain,
+                                   struct sysdb_attrs **users,
+                                   size_t count,
+                                   const char *shortname)
+{
+    struct ldb_message_element *el;
+    const char *value;
+    size_t i;
+    unsigned int j;
+    errno_t ret;
+
+    for (i = 0; i < count; i++) {
+        ret = sysdb_attrs_get_el_ext(users[i], SYSDB_NAME, false, &el);
+        if (ret != EOK) {
+            continue;
+        }
+
+        for (j = 0; j < el->num_values; j++) {
+            value = (const char *)el->values[j].data;
+            if (domain->case_sensitive) {
+                if (strcmp(value, shortname) == 0) {
+                    return true;
+                }
+            } else if (strcasecmp(value, shortname) == 0) {
+                return true;
+            }
+        }
+    }
+
+    return false;
+}
+
+struct sdap_account_batch_state {
+    struct tevent_context *ev;
+    struct sdap_id_ctx *id_ctx;
+    struct sdap_domain *sdom;
+    struct sdap_id_op *op;
+    struct dp_id_batch_data *batch;
+    struct dp_reply_batch reply;
+
+    /* Items looked up with one search. */
+    uint32_t *merged;
+    const char **shortnames;
+    size_t num_merged;
+    const char **attrs;
+    char *filter;
+
+    uint32_t num_pending;
+};
+
+struct sdap_account_batch_item {
+    struct tevent_req *req;
+    uint32_t index;
+};
+
+static errno_t sdap_account_batch_single(struct tevent_req *req,
+                                         struct be_ctx *be_ctx,
+                                         uint32_t index);
+static void sdap_account_batch_single_done(struct tevent_req *subreq);
+static errno_t sdap_account_batch_retry(struct tevent_req *req);
+static void sdap_account_batch_connect_done(struct tevent_req *subreq);
+static void sdap_account_batch_search_done(struct tevent_req *subreq);
+
+struct tevent_req *
+sdap_account_batch_handler_send(TALLOC_CTX *mem_ctx,
+                                struct sdap_id_ctx *id_ctx,
+                                struct dp_id_batch_data *batch,
+                                struct dp_req_params *params)
+{
+    struct sdap_account_batch_state *state;
+    struct dp_id_data *data;
+    struct tevent_req *req;
+    bool use_id_mapping;
+    char *shortname;
+    uint32_t i;
+    errno_t ret;
+
+    req = tevent_req_create(mem_ctx, &state, struct sdap_account_batch_state);
+    if (req == NULL) {
+        DEBUG(SSSDBG_CRIT_FAILURE, "tevent_req_create() failed\n");
+        return NULL;
+    }
+
+    state->ev = params->ev;
+    state->id_ctx = id_ctx;
+    state->sdom = id_ctx->opts->sdom;
+    state->batch = batch;
+
+    state->reply.count = batch->count;
+    state->reply.replies = talloc_zero_array(state, struct dp_reply_std,
+                                             batch->count);
+    state->merged = talloc_zero_array(state, uint32_t, batch->count);
+    state->shortnames = talloc_zero_array(state, const char *, batch->count);
+    if (state->reply.replies == NULL || state->merged == NULL
+            || state->shortnames == NULL) {
+        ret = ENOMEM;
+        goto immediately;
+    }
+
+    use_id_mapping = sdap_idmap_domain_has_algorithmic_mapping(
+                                                  id_ctx->opts->idmap_ctx,
+                                                  state->sdom->dom->name,
+                                                  state->sdom->dom->domain_id);
+
+    for (i = 0; i < batch->count; i++) {
+        data = batch->items[i];
+
+        if (sdap_is_enum_request(data)) {
+            DEBUG(SSSDBG_TRACE_LIBS, "Skipping enumeration on demand\n");
+            dp_reply_std_set(&state->reply.replies[i], DP_ERR_DECIDE,
+                             EOK, NULL);
+            continue;
+        }
+
+        if (sdap_account_batch_can_merge(id_ctx, use_id_mapping, data)) {
+            ret = sss_parse_internal_fqname(state->shortnames,
+                                            data->filter_value,
+                                            &shortname, NULL);
+            if (ret == EOK) {
+                state->shortnames[state->num_merged] = shortname;
+                state->merged[state->num_merged] = i;
+                state->num_merged++;
+                continue;
+            }
+
+            DEBUG(SSSDBG_OP_FAILURE, "Cannot parse %s\n", data->filter_value);
+        }
+
+        ret = sdap_account_batch_single(req, params->be_ctx, i);
+        if (ret != EOK) {
+            goto immediately;
+        }
+    }
+
+    /* Nothing to merge with. */
+    if (state->num_merged == 1) {
+        ret = sdap_account_batch_single(req, params->be_ctx,
+                                        state->merged[0]);
+        if (ret != EOK) {
+            goto immediately;
+        }
+        state->num_merged = 0;
+    }
+
+    if (state->num_merged > 1) {
+        DEBUG(SSSDBG_TRACE_FUNC, "Looking up %zu users with one search\n",
+              state->num_merged);
+
+        ret = sdap_account_batch_filter(state, id_ctx->opts, use_id_mapping,
+                                        state->shortnames, state->num_merged,
+                                        &state->filter);
+        if (ret != EOK) {
+            goto immediately;
+        }
+
+        ret = build_attrs_from_map(state, id_ctx->opts->user_map,
+                                   id_ctx->opts->user_map_cnt,
+                                   NULL, &state->attrs, NULL);
+        if (ret != EOK) {
+            goto immediately;
+        }
+
+        state->op = sdap_id_op_create(state, id_ctx->conn->conn_cache);
+        if (state->op == NULL) {
+            DEBUG(SSSDBG_OP_FAILURE, "sdap_id_op_create failed\n");
+            ret = ENOMEM;
+            goto immediately;
+        }
+
+        ret = sdap_account_batch_retry(req);
+        if (ret != EOK) {
+            goto immediately;
+        }
+
+        state->num_pending++;
+    }
+
+    if (state->num_pending == 0) {
+        ret = EOK;
+        goto immediately;
+    }
+
+    return req;
+
+immediately:
+    if (ret == EOK) {
+        tevent_req_done(req);
+    } else {
+        tevent_req_error(req, ret);
+    }
+    tevent_req_post(req, params->ev);
+
+    return req;
+}
+
+static void sdap_account_batch_finished(struct tevent_req *req)
+{
+    struct sdap_account_batch_state *state;
+
+    state = tevent_req_data(req, struct sdap_account_batch_state);
+
+    if (!tevent_req_is_in_progress(req)) {
+        return;
+    }
+
+    state->num_pending--;
+    if (state->num_pending == 0) {
+        tevent_req_done(req);
+    }
+}
+
+static errno_t sdap_account_batch_single(struct tevent_req *req,
+                                         struct be_ctx *be_ctx,
+                                         uint32_t index)
+{
+    struct sdap_account_batch_state *state;
+    struct sdap_account_batch_item *item;
+    struct tevent_req *subreq;
+
+    state = tevent_req_data(req, struct sdap_account_batch_state);
+
+    item = talloc_zero(state, struct sdap_account_batch_item);
+    if (item == NULL) {
+        return ENOMEM;
+    }
+
+    item->req = req;
+    item->index = index;
+
+    subreq = sdap_handle_acct_req_send(item, be_ctx,
+                                       state->batch->items[index],
+                                       state->id_ctx, state->sdom,
+                                       state->id_ctx->conn, true);
+    if (subreq == NULL) {
+        talloc_free(item);
+        return ENOMEM;
+    }
+
+    tevent_req_set_callback(subreq, sdap_account_batch_single_done, item);
+    state->num_pending++;
+
+    return EOK;
+}
+
+static void sdap_account_batch_single_done(struct tevent_req *subreq)
+{
+    struct sdap_account_batch_state *state;
+    struct sdap_account_batch_item *item;
+    struct tevent_req *req;
+    const char *error_msg;
+    int dp_error;
+    errno_t ret;
+
+    item = tevent_req_callback_data(subreq, struct sdap_account_batch_item);
+    req = item->req;
+    state = tevent_req_data(req, struct sdap_account_batch_state);
+
+    ret = sdap_handle_acct_req_recv(subreq, &dp_error, &error_msg, NULL);
+    talloc_zfree(subreq);
+
+    /* The message is a static string. */
+    dp_reply_std_set(&state->reply.replies[item->index], dp_error, ret,
+                     error_msg);
+    talloc_free(item);
+
+    sdap_account_batch_finished(req);
+}
+
+static void sdap_account_batch_merged_set(struct sdap_account_batch_state *state,
+                                          int dp_error,
+                                          errno_t ret,
+                                          const char *msg)
+{
+    size_t i;
+
+    for (i = 0; i < state->num_merged; i++) {
+        dp_reply_std_set(&state->reply.replies[state->merged[i]],
+                         dp_error, ret, msg);
+    }
+}
+
+static errno_t sdap_account_batch_retry(struct tevent_req *req)
+{
+    struct sdap_account_batch_state *state;
+    struct tevent_req *subreq;
+    int ret = EOK;
+
+    state = tevent_req_data(req, struct sdap_account_batch_state);
+
+    subreq = sdap_id_op_connect_send(state->op, state, &ret);
+    if (subreq == NULL) {
+        return ret;
+    }
+
+    tevent_req_set_callback(subreq, sdap_account_batch_connect_done, req);
+    return EOK;
+}
+
+static void sdap_account_batch_connect_done(struct tevent_req *subreq)
+{
+    struct sdap_account_batch_state *state;
+    struct tevent_req *req;
+    int dp_error = DP_ERR_FATAL;
+    errno_t ret;
+
+    req = tevent_req_callback_data(subreq, struct tevent_req);
+    state = tevent_req_data(req, struct sdap_account_batch_state);
+
+    ret = sdap_id_op_connect_recv(subreq, &dp_error);
+    talloc_zfree(subreq);
+    if (ret != EOK) {
+        sdap_account_batch_merged_set(state, dp_error, ret,
+                                      "User lookup failed");
+        sdap_account_batch_finished(req);
+        return;
+    }
+
+    /* The names may be spread over several search bases. */
+    subreq = sdap_search_user_send(state, state->ev, state->sdom->dom,
+                                   state->id_ctx->opts,
+                                   state->sdom->user_search_bases,
+                                   sdap_id_op_handle(state->op),
+                                   state->attrs, state->filter,
+                                   dp_opt_get_int(state->id_ctx->opts->basic,
+                                                  SDAP_SEARCH_TIMEOUT),
+                                   SDAP_LOOKUP_ENUMERATE);
+    if (subreq == NULL) {
+        tevent_req_error(req, ENOMEM);
+        return;
+    }
+
+    tevent_req_set_callback(subreq, sdap_account_batch_search_done, req);
+}
+
+static void sdap_account_batch_search_done(struct tevent_req *subreq)
+{
+    struct sdap_account_batch_state *state;
+    struct sss_domain_info *domain;
+    struct sysdb_attrs **users = NULL;
+    struct dp_id_data *data;
+    struct tevent_req *req;
+    size_t count = 0;
+    int dp_error = DP_ERR_FATAL;
+    size_t i;
+    errno_t ret;
+
+    req = tevent_req_callback_data(subreq, struct tevent_req);
+    state = tevent_req_data(req, struct sdap_account_batch_state);
+    domain = state->sdom->dom;
+
+    ret = sdap_search_user_recv(state, subreq, NULL, &users, &count);
+    talloc_zfree(subreq);
+
+    ret = sdap_id_op_done(state->op, ret, &dp_error);
+    if (dp_error == DP_ERR_OK && ret != EOK) {
+        /* retry */
+        ret = sdap_account_batch_retry(req);
+        if (ret != EOK) {
+            tevent_req_error(req, ret);
+        }
+        return;
+    }
+
+    if (ret != EOK && ret != ENOENT) {
+        sdap_account_batch_merged_set(state, dp_error, ret,
+                                      "User lookup failed");
+        sdap_account_batch_finished(req);
+        return;
+    }
+
+    if (count > 0) {
+        ret = sdap_save_users(state, domain->sysdb, domain,
+                              state->id_ctx->opts, users, count, NULL);
+        if (ret != EOK) {
+            DEBUG(SSSDBG_OP_FAILURE, "Failed to store users [%d]: %s\n",
+                  ret, sss_strerror(ret));
+            sdap_account_batch_merged_set(state, DP_ERR_FATAL, ret,
+                                          "User lookup failed");
+            sdap_account_batch_finished(req);
+            return;
+        }
+    }
+
+    for (i = 0; i < state->num_merged; i++) {
+        data = state->batch->items[state->merged[i]];
+
+        if (sdap_account_batch_user_found(domain, users, count,
+                                          state->shortnames[i])) {
+            dp_reply_std_set(&state->reply.replies[state->merged[i]],
+                             DP_ERR_OK, EOK, "Success");
+            continue;
+        }
+
+        /* Same as users_get_done() does for a missing user. */
+        ret = sysdb_delete_user(domain, data->filter_value, 0);
+        if (ret != EOK && ret != ENOENT) {
+            DEBUG(SSSDBG_OP_FAILURE, "Unable to delete user %s [%d]: %s\n",
+                  data->filter_value, ret, sss_strerror(ret));
+            dp_reply_std_set(&state->reply.replies[state->merged[i]],
+                             DP_ERR_FATAL, ret, "User lookup failed");
+            continue;
+        }
+
+        dp_reply_std_set(&state->reply.replies[state->merged[i]],
+                         DP_ERR_OK, EOK, "Success");
+    }
+
+    sdap_account_batch_finished(req);
+}
+
+errno_t sdap_account_batch_handler_recv(TALLOC_CTX *mem_ctx,
+                                        struct tevent_req *req,
+                                        struct dp_reply_batch *data)
+{
+    struct sdap_account_batch_state *state = NULL;
+
+    state = tevent_req_data(req, struct sdap_account_batch_state);
+
+    TEVENT_REQ_RETURN_ON_ERROR(req);
+
+    data->count = state->reply.count;
+    data->replies = talloc_steal(mem_ctx, state->reply.replies);
+
+    return EOK;
+}
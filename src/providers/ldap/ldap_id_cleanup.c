@@ -32,22 +32,67 @@
 #include "providers/ldap/ldap_common.h"
 #include "providers/ldap/sdap_async.h"
 
+/* Number of entries processed in a single transaction. The cleanup yields
+ * to the main loop after each slice so that the back end keeps serving
+ * requests even when there are many expired entries to remove. */
+#define LDAP_ID_CLEANUP_SLICE_SIZE 100
+
+/* Delay between two slices. A zero delay would not let file descriptor
+ * events run, because tevent processes expired timers first. */
+#define LDAP_ID_CLEANUP_SLICE_DELAY_USEC 1000
+
+/* Maximum number of expired entries of one type handled by a single run.
+ * The search stops at this many entries, the rest stays expired and is
+ * removed by the next run. */
+#define LDAP_ID_CLEANUP_MAX_ENTRIES 10000
+
+enum cleanup_phase {
+    CLEANUP_PHASE_USERS,
+    CLEANUP_PHASE_GROUPS
+};
+
+struct cleanup_pass {
+    enum cleanup_phase phase;
+    struct ldb_message **msgs;
+    size_t count;
+    size_t next;
+
+    /* users only */
+    hash_table_t *uid_table;
+    int account_cache_expiration;
+};
+
+static errno_t cleanup_pass_init(TALLOC_CTX *mem_ctx,
+                                 struct sdap_options *opts,
+                                 struct sss_domain_info *dom,
+                                 enum cleanup_phase phase,
+                                 struct cleanup_pass **_pass);
+static errno_t cleanup_slice(struct sss_domain_info *dom,
+                             struct cleanup_pass *pass);
+
 /* ==Cleanup-Task========================================================= */
 struct ldap_id_cleanup_ctx {
     struct sdap_id_ctx *ctx;
     struct sdap_domain *sdom;
 };
 
-static errno_t ldap_cleanup_task(TALLOC_CTX *mem_ctx,
-                                 struct tevent_context *ev,
-                                 struct be_ctx *be_ctx,
-                                 struct be_ptask *be_ptask,
-                                 void *pvt)
+static struct tevent_req *
+ldap_cleanup_task_send(TALLOC_CTX *mem_ctx,
+                       struct tevent_context *ev,
+                       struct be_ctx *be_ctx,
+                       struct be_ptask *be_ptask,
+                       void *pvt)
 {
     struct ldap_id_cleanup_ctx *cleanup_ctx = NULL;
 
     cleanup_ctx = talloc_get_type(pvt, struct ldap_id_cleanup_ctx);
-    return ldap_id_cleanup(cleanup_ctx->ctx->opts, cleanup_ctx->sdom);
+    return ldap_id_cleanup_send(mem_ctx, ev, cleanup_ctx->ctx->opts,
+                                cleanup_ctx->sdom);
+}
+
+static errno_t ldap_cleanup_task_recv(struct tevent_req *req)
+{
+    return ldap_id_cleanup_recv(req);
 }
 
 errno_t ldap_setup_cleanup(struct sdap_id_ctx *id_ctx,
@@ -85,11 +130,14 @@ errno_t ldap_setup_cleanup(struct sdap_id_ctx *id_ctx,
         return ENOMEM;
     }
 
-    ret = be_ptask_create_sync(sdom, id_ctx->be, period, first_delay,
-                               5 /* enabled delay */, 0 /* random offset */,
-                               period /* timeout */, BE_PTASK_OFFLINE_SKIP, 0,
-                               ldap_cleanup_task, cleanup_ctx, name,
-                               &sdom->cleanup_task);
+    /* If the task times out, the next run continues with the phase that
+     * was interrupted, see sdap_domain::purge_users_done. Entries that were
+     * already removed are simply not found again. */
+    ret = be_ptask_create(sdom, id_ctx->be, period, first_delay,
+                          5 /* enabled delay */, 0 /* random offset */,
+                          period /* timeout */, BE_PTASK_OFFLINE_SKIP, 0,
+                          ldap_cleanup_task_send, ldap_cleanup_task_recv,
+                          cleanup_ctx, name, &sdom->cleanup_task);
     if (ret != EOK) {
         DEBUG(SSSDBG_FATAL_FAILURE, "Unable to initialize cleanup periodic "
                                      "task for %s\n", sdom->dom->name);
@@ -108,58 +156,436 @@ done:
     return ret;
 }
 
-static int cleanup_users(struct sdap_options *opts,
-                         struct sss_domain_info *dom);
-static int cleanup_groups(TALLOC_CTX *memctx,
-                          struct sysdb_ctx *sysdb,
-                          struct sss_domain_info *domain);
+/* ==Cleanup-Request====================================================== */
+struct ldap_id_cleanup_state {
+    struct tevent_context *ev;
+    struct sdap_options *opts;
+    struct sdap_domain *sdom;
+
+    struct cleanup_pass *pass;
+};
+
+static int ldap_id_cleanup_state_destructor(struct ldap_id_cleanup_state *state)
+{
+    state->sdom->purge_in_progress = false;
+    return 0;
+}
+
+static errno_t ldap_id_cleanup_schedule(struct tevent_req *req);
+static void ldap_id_cleanup_step(struct tevent_context *ev,
+                                 struct tevent_timer *te,
+                                 struct timeval tv,
+                                 void *pvt);
+
+struct tevent_req *ldap_id_cleanup_send(TALLOC_CTX *mem_ctx,
+                                        struct tevent_context *ev,
+                                        struct sdap_options *opts,
+                                        struct sdap_domain *sdom)
+{
+    struct ldap_id_cleanup_state *state;
+    struct tevent_req *req;
+    enum cleanup_phase phase;
+    errno_t ret;
+
+    req = tevent_req_create(mem_ctx, &state, struct ldap_id_cleanup_state);
+    if (req == NULL) {
+        DEBUG(SSSDBG_CRIT_FAILURE, "tevent_req_create() failed\n");
+        return NULL;
+    }
+
+    state->ev = ev;
+    state->opts = opts;
+    state->sdom = sdom;
+
+    if (sdom->purge_in_progress) {
+        /* Enumeration and the cleanup task may both want to purge the
+         * cache, one run is enough. */
+        DEBUG(SSSDBG_TRACE_FUNC, "Cleanup of %s is already running\n",
+              sdom->dom->name);
+        ret = EOK;
+        goto immediately;
+    }
+    sdom->purge_in_progress = true;
+    talloc_set_destructor(state, ldap_id_cleanup_state_destructor);
+
+    phase = sdom->purge_users_done ? CLEANUP_PHASE_GROUPS
+                                   : CLEANUP_PHASE_USERS;
+
+    ret = cleanup_pass_init(state, opts, sdom->dom, phase, &state->pass);
+    if (ret != EOK) {
+        goto immediately;
+    }
+
+    ret = ldap_id_cleanup_schedule(req);
+    if (ret != EOK) {
+        goto immediately;
+    }
+
+    return req;
+
+immediately:
+    if (ret == EOK) {
+        tevent_req_done(req);
+    } else {
+        tevent_req_error(req, ret);
+    }
+    tevent_req_post(req, ev);
+
+    return req;
+}
+
+static errno_t ldap_id_cleanup_schedule(struct tevent_req *req)
+{
+    struct ldap_id_cleanup_state *state;
+    struct tevent_timer *te;
+
+    state = tevent_req_data(req, struct ldap_id_cleanup_state);
+
+    te = tevent_add_timer(state->ev, state,
+                          tevent_timeval_current_ofs(0,
+                                  LDAP_ID_CLEANUP_SLICE_DELAY_USEC),
+                          ldap_id_cleanup_step, req);
+    if (te == NULL) {
+        DEBUG(SSSDBG_CRIT_FAILURE, "Unable to schedule cleanup slice\n");
+        return ENOMEM;
+    }
+
+    return EOK;
+}
+
+static void ldap_id_cleanup_step(struct tevent_context *ev,
+                                 struct tevent_timer *te,
+                                 struct timeval tv,
+                                 void *pvt)
+{
+    struct ldap_id_cleanup_state *state;
+    struct tevent_req *req;
+    errno_t ret;
+
+    req = talloc_get_type(pvt, struct tevent_req);
+    state = tevent_req_data(req, struct ldap_id_cleanup_state);
+
+    ret = cleanup_slice(state->sdom->dom, state->pass);
+    if (ret != EOK) {
+        goto done;
+    }
+
+    if (state->pass->next < state->pass->count) {
+        ret = ldap_id_cleanup_schedule(req);
+        if (ret != EOK) {
+            goto done;
+        }
+        return;
+    }
+
+    if (state->pass->phase == CLEANUP_PHASE_USERS) {
+        state->sdom->purge_users_done = true;
+
+        talloc_zfree(state->pass);
+        ret = cleanup_pass_init(state, state->opts, state->sdom->dom,
+                                CLEANUP_PHASE_GROUPS, &state->pass);
+        if (ret != EOK) {
+            goto done;
+        }
+
+        ret = ldap_id_cleanup_schedule(req);
+        if (ret != EOK) {
+            goto done;
+        }
+        return;
+    }
+
+    state->sdom->purge_users_done = false;
+    state->sdom->last_purge = tevent_timeval_current();
+    ret = EOK;
+
+done:
+    if (ret != EOK) {
+        tevent_req_error(req, ret);
+        return;
+    }
+
+    tevent_req_done(req);
+}
+
+errno_t ldap_id_cleanup_recv(struct tevent_req *req)
+{
+    TEVENT_REQ_RETURN_ON_ERROR(req);
+
+    return EOK;
+}
+
+static errno_t cleanup_run_pass(struct sdap_options *opts,
+                                struct sss_domain_info *dom,
+                                enum cleanup_phase phase)
+{
+    struct cleanup_pass *pass;
+    errno_t ret;
+
+    ret = cleanup_pass_init(NULL, opts, dom, phase, &pass);
+    if (ret != EOK) {
+        return ret;
+    }
+
+    while (pass->next < pass->count) {
+        ret = cleanup_slice(dom, pass);
+        if (ret != EOK) {
+            break;
+        }
+    }
+
+    talloc_free(pass);
+    return ret;
+}
 
 errno_t ldap_id_cleanup(struct sdap_options *opts,
                         struct sdap_domain *sdom)
 {
-    int ret, tret;
-    bool in_transaction = false;
+    errno_t ret;
+
+    if (sdom->purge_in_progress) {
+        DEBUG(SSSDBG_TRACE_FUNC, "Cleanup of %s is already running\n",
+              sdom->dom->name);
+        return EOK;
+    }
+
+    if (!sdom->purge_users_done) {
+        ret = cleanup_run_pass(opts, sdom->dom, CLEANUP_PHASE_USERS);
+        if (ret != EOK) {
+            return ret;
+        }
+        sdom->purge_users_done = true;
+    }
+
+    ret = cleanup_run_pass(opts, sdom->dom, CLEANUP_PHASE_GROUPS);
+    if (ret != EOK) {
+        return ret;
+    }
+
+    sdom->purge_users_done = false;
+    sdom->last_purge = tevent_timeval_current();
+    return EOK;
+}
+
+/* ==Cleanup-Pass========================================================= */
+
+static int cleanup_users_search(TALLOC_CTX *mem_ctx,
+                                struct sdap_options *opts,
+                                struct sss_domain_info *dom,
+                                size_t limit,
+                                struct ldb_message ***_msgs,
+                                size_t *_count);
+static int cleanup_groups_search(TALLOC_CTX *mem_ctx,
+                                 struct sss_domain_info *dom,
+                                 size_t limit,
+                                 struct ldb_message ***_msgs,
+                                 size_t *_count);
+static int cleanup_user(struct sss_domain_info *dom,
+                        hash_table_t *uid_table,
+                        struct ldb_message *msg);
+static int cleanup_group(struct sss_domain_info *dom,
+                         struct ldb_message *msg);
+
+static errno_t cleanup_pass_init(TALLOC_CTX *mem_ctx,
+                                 struct sdap_options *opts,
+                                 struct sss_domain_info *dom,
+                                 enum cleanup_phase phase,
+                                 struct cleanup_pass **_pass)
+{
+    struct cleanup_pass *pass;
+    errno_t ret;
+
+    pass = talloc_zero(mem_ctx, struct cleanup_pass);
+    if (pass == NULL) {
+        return ENOMEM;
+    }
+    pass->phase = phase;
+
+    switch (phase) {
+    case CLEANUP_PHASE_USERS:
+        pass->account_cache_expiration = dp_opt_get_int(opts->basic,
+                                               SDAP_ACCOUNT_CACHE_EXPIRATION);
+        ret = cleanup_users_search(pass, opts, dom, LDAP_ID_CLEANUP_MAX_ENTRIES,
+                                   &pass->msgs, &pass->count);
+        if (ret != EOK) {
+            goto done;
+        }
+
+        if (pass->count == 0) {
+            break;
+        }
+
+        ret = get_uid_table(pass, &pass->uid_table);
+        /* get_uid_table returns ENOSYS on non-Linux platforms. We proceed
+         * with the cleanup in that case
+         */
+        if (ret != EOK && ret != ENOSYS) {
+            DEBUG(SSSDBG_CRIT_FAILURE, "get_uid_table failed: %d\n", ret);
+            goto done;
+        }
+        break;
+    case CLEANUP_PHASE_GROUPS:
+        ret = cleanup_groups_search(pass, dom, LDAP_ID_CLEANUP_MAX_ENTRIES,
+                                    &pass->msgs, &pass->count);
+        if (ret != EOK) {
+            goto done;
+        }
+        break;
+    }
+
+    if (pass->count == LDAP_ID_CLEANUP_MAX_ENTRIES) {
+        DEBUG(SSSDBG_TRACE_FUNC,
+              "More expired entries may be left for the next run\n");
+    }
+
+    *_pass = pass;
+    ret = EOK;
+
+done:
+    if (ret != EOK) {
+        talloc_free(pass);
+    }
+
+    return ret;
+}
+
+/* Returns EOK if the cached entry is still expired, ENOENT if it was
+ * refreshed or removed meanwhile. */
+static errno_t cleanup_still_expired(struct sss_domain_info *dom,
+                                     struct cleanup_pass *pass,
+                                     struct ldb_message *msg)
+{
     TALLOC_CTX *tmp_ctx;
+    const char *attrs[] = { SYSDB_CACHE_EXPIRE, SYSDB_LAST_LOGIN, NULL };
+    struct ldb_message *cur;
+    const char *name;
+    time_t now = time(NULL);
+    uint64_t expire;
+    uint64_t last_login;
+    errno_t ret;
+
+    name = ldb_msg_find_attr_as_string(msg, SYSDB_NAME, NULL);
+    if (name == NULL) {
+        DEBUG(SSSDBG_OP_FAILURE, "Entry %s has no Name Attribute ?!?\n",
+              ldb_dn_get_linearized(msg->dn));
+        return EFAULT;
+    }
 
     tmp_ctx = talloc_new(NULL);
     if (tmp_ctx == NULL) {
         return ENOMEM;
     }
 
-    ret = sysdb_transaction_start(sdom->dom->sysdb);
+    switch (pass->phase) {
+    case CLEANUP_PHASE_USERS:
+        ret = sysdb_search_user_by_name(tmp_ctx, dom, name, attrs, &cur);
+        break;
+    case CLEANUP_PHASE_GROUPS:
+        ret = sysdb_search_group_by_name(tmp_ctx, dom, name, attrs, &cur);
+        break;
+    default:
+        ret = EINVAL;
+        break;
+    }
     if (ret != EOK) {
-        DEBUG(SSSDBG_CRIT_FAILURE, "Failed to start transaction\n");
         goto done;
     }
-    in_transaction = true;
 
-    ret = cleanup_users(opts, sdom->dom);
-    if (ret && ret != ENOENT) {
+    expire = ldb_msg_find_attr_as_uint64(cur, SYSDB_CACHE_EXPIRE, 0);
+    if (expire == 0 || expire > now) {
+        DEBUG(SSSDBG_TRACE_ALL, "%s was refreshed, keeping it\n", name);
+        ret = ENOENT;
         goto done;
     }
 
-    ret = cleanup_groups(tmp_ctx, sdom->dom->sysdb, sdom->dom);
-    if (ret) {
+    if (pass->phase == CLEANUP_PHASE_USERS) {
+        last_login = ldb_msg_find_attr_as_uint64(cur, SYSDB_LAST_LOGIN, 0);
+        if (last_login != 0
+                && (pass->account_cache_expiration <= 0
+                    || last_login > now - (pass->account_cache_expiration
+                                           * 86400))) {
+            DEBUG(SSSDBG_TRACE_ALL, "%s logged in meanwhile, keeping it\n",
+                  name);
+            ret = ENOENT;
+            goto done;
+        }
+    }
+
+    ret = EOK;
+
+done:
+    talloc_free(tmp_ctx);
+    return ret;
+}
+
+/* Processes at most LDAP_ID_CLEANUP_SLICE_SIZE entries of the pass in a
+ * single transaction. Entries that were already handled are deleted from
+ * the cache, so an interrupted cleanup simply picks up the rest on the
+ * next run. The list of entries was searched before the first slice, an
+ * entry may have been refreshed since then, so the expiration is checked
+ * again inside the transaction. */
+static errno_t cleanup_slice(struct sss_domain_info *dom,
+                             struct cleanup_pass *pass)
+{
+    size_t last;
+    bool in_transaction = false;
+    errno_t ret, tret;
+
+    last = pass->next + LDAP_ID_CLEANUP_SLICE_SIZE;
+    if (last > pass->count) {
+        last = pass->count;
+    }
+
+    ret = sysdb_transaction_start(dom->sysdb);
+    if (ret != EOK) {
+        DEBUG(SSSDBG_CRIT_FAILURE, "Failed to start transaction\n");
         goto done;
     }
+    in_transaction = true;
+
+    for (; pass->next < last; pass->next++) {
+        ret = cleanup_still_expired(dom, pass, pass->msgs[pass->next]);
+        if (ret == ENOENT) {
+            continue;
+        } else if (ret != EOK) {
+            goto done;
+        }
+
+        switch (pass->phase) {
+        case CLEANUP_PHASE_USERS:
+            ret = cleanup_user(dom, pass->uid_table, pass->msgs[pass->next]);
+            break;
+        case CLEANUP_PHASE_GROUPS:
+            ret = cleanup_group(dom, pass->msgs[pass->next]);
+            break;
+        }
+
+        if (ret != EOK) {
+            goto done;
+        }
+    }
 
-    ret = sysdb_transaction_commit(sdom->dom->sysdb);
+    ret = sysdb_transaction_commit(dom->sysdb);
     if (ret != EOK) {
         DEBUG(SSSDBG_CRIT_FAILURE, "Failed to commit transaction\n");
         goto done;
     }
     in_transaction = false;
 
-    sdom->last_purge = tevent_timeval_current();
+    DEBUG(SSSDBG_TRACE_INTERNAL, "Processed %zu of %zu expired %s\n",
+          pass->next, pass->count,
+          pass->phase == CLEANUP_PHASE_USERS ? "users" : "groups");
+
     ret = EOK;
+
 done:
     if (in_transaction) {
-        tret = sysdb_transaction_cancel(sdom->dom->sysdb);
+        tret = sysdb_transaction_cancel(dom->sysdb);
         if (tret != EOK) {
             DEBUG(SSSDBG_CRIT_FAILURE, "Could not cancel transaction\n");
         }
     }
-    talloc_free(tmp_ctx);
+
     return ret;
 }
 
@@ -172,20 +598,21 @@ static int cleanup_users_logged_in(hash_table_t *table,
 static errno_t expire_memberof_target_groups(struct sss_domain_info *dom,
                                              struct ldb_message *user);
 
-static int cleanup_users(struct sdap_options *opts,
-                         struct sss_domain_info *dom)
+static int cleanup_users_search(TALLOC_CTX *mem_ctx,
+                                struct sdap_options *opts,
+                                struct sss_domain_info *dom,
+                                size_t limit,
+                                struct ldb_message ***_msgs,
+                                size_t *_count)
 {
     TALLOC_CTX *tmpctx;
     const char *attrs[] = { SYSDB_NAME, SYSDB_UIDNUM, SYSDB_MEMBEROF, NULL };
     time_t now = time(NULL);
     char *subfilter = NULL;
     int account_cache_expiration;
-    hash_table_t *uid_table;
     struct ldb_message **msgs;
     size_t count;
-    const char *name;
     int ret;
-    int i;
 
     tmpctx = talloc_new(NULL);
     if (!tmpctx) {
@@ -219,77 +646,77 @@ static int cleanup_users(struct sdap_options *opts,
         goto done;
     }
 
-    ret = sysdb_search_users(tmpctx, dom, subfilter, attrs, &count, &msgs);
+    ret = sysdb_search_users_limit(tmpctx, dom, subfilter, attrs, limit,
+                                   &count, &msgs);
     if (ret == ENOENT) {
         count = 0;
+        msgs = NULL;
     } else if (ret != EOK) {
-        DEBUG(SSSDBG_CRIT_FAILURE, "sysdb_search_users failed: %d\n", ret);
+        DEBUG(SSSDBG_CRIT_FAILURE,
+              "sysdb_search_users_limit failed: %d\n", ret);
         goto done;
     }
     DEBUG(SSSDBG_FUNC_DATA, "Found %zu expired user entries!\n", count);
 
-    if (count == 0) {
-        ret = EOK;
-        goto done;
-    }
-
-    ret = get_uid_table(tmpctx, &uid_table);
-    /* get_uid_table returns ENOSYS on non-Linux platforms. We proceed with
-     * the cleanup in that case
-     */
-    if (ret != EOK && ret != ENOSYS) {
-        DEBUG(SSSDBG_CRIT_FAILURE, "get_uid_table failed: %d\n", ret);
-        goto done;
-    }
+    *_msgs = talloc_steal(mem_ctx, msgs);
+    *_count = count;
+    ret = EOK;
 
-    for (i = 0; i < count; i++) {
-        name = ldb_msg_find_attr_as_string(msgs[i], SYSDB_NAME, NULL);
-        if (!name) {
-            DEBUG(SSSDBG_OP_FAILURE, "Entry %s has no Name Attribute ?!?\n",
-                       ldb_dn_get_linearized(msgs[i]->dn));
-            ret = EFAULT;
-            goto done;
-        }
-        DEBUG(SSSDBG_TRACE_ALL, "Processing user %s\n", name);
-
-        if (uid_table) {
-            ret = cleanup_users_logged_in(uid_table, msgs[i]);
-            if (ret == EOK) {
-                /* If the user is logged in, proceed to the next one */
-                DEBUG(SSSDBG_FUNC_DATA,
-                      "User %s is still logged in or a dummy entry, "
-                          "keeping data\n", name);
-                continue;
-            } else if (ret != ENOENT) {
-                DEBUG(SSSDBG_CRIT_FAILURE,
-                      "Cannot check if user is logged in: %d\n", ret);
-                goto done;
-            }
-        }
+done:
+    talloc_zfree(tmpctx);
+    return ret;
+}
 
-        /* If not logged in or cannot check the table, delete him */
-        DEBUG(SSSDBG_TRACE_ALL, "About to delete user %s\n", name);
-        ret = sysdb_delete_user(dom, name, 0);
-        if (ret) {
-            DEBUG(SSSDBG_CRIT_FAILURE, "sysdb_delete_user failed: %d\n", ret);
-            goto done;
-        }
+static int cleanup_user(struct sss_domain_info *dom,
+                        hash_table_t *uid_table,
+                        struct ldb_message *msg)
+{
+    const char *name;
+    int ret;
 
-        /* Mark all groups of which user was a member as expired in cache,
-         * so that its ghost/member attributes are refreshed on next
-         * request. */
-        ret = expire_memberof_target_groups(dom, msgs[i]);
-        if (ret != EOK && ret != ENOENT) {
+    name = ldb_msg_find_attr_as_string(msg, SYSDB_NAME, NULL);
+    if (!name) {
+        DEBUG(SSSDBG_OP_FAILURE, "Entry %s has no Name Attribute ?!?\n",
+                   ldb_dn_get_linearized(msg->dn));
+        return EFAULT;
+    }
+    DEBUG(SSSDBG_TRACE_ALL, "Processing user %s\n", name);
+
+    if (uid_table) {
+        ret = cleanup_users_logged_in(uid_table, msg);
+        if (ret == EOK) {
+            /* If the user is logged in, proceed to the next one */
+            DEBUG(SSSDBG_FUNC_DATA,
+                  "User %s is still logged in or a dummy entry, "
+                      "keeping data\n", name);
+            return EOK;
+        } else if (ret != ENOENT) {
             DEBUG(SSSDBG_CRIT_FAILURE,
-                  "expire_memberof_target_groups failed: [%d]:%s\n",
-                  ret, sss_strerror(ret));
-            goto done;
+                  "Cannot check if user is logged in: %d\n", ret);
+            return ret;
         }
     }
 
-done:
-    talloc_zfree(tmpctx);
-    return ret;
+    /* If not logged in or cannot check the table, delete him */
+    DEBUG(SSSDBG_TRACE_ALL, "About to delete user %s\n", name);
+    ret = sysdb_delete_user(dom, name, 0);
+    if (ret) {
+        DEBUG(SSSDBG_CRIT_FAILURE, "sysdb_delete_user failed: %d\n", ret);
+        return ret;
+    }
+
+    /* Mark all groups of which user was a member as expired in cache,
+     * so that its ghost/member attributes are refreshed on next
+     * request. */
+    ret = expire_memberof_target_groups(dom, msg);
+    if (ret != EOK && ret != ENOENT) {
+        DEBUG(SSSDBG_CRIT_FAILURE,
+              "expire_memberof_target_groups failed: [%d]:%s\n",
+              ret, sss_strerror(ret));
+        return ret;
+    }
+
+    return EOK;
 }
 
 static errno_t expire_memberof_target_groups(struct sss_domain_info *dom,
@@ -361,26 +788,21 @@ static int cleanup_users_logged_in(hash_table_t *table,
 
 /* ==Group-Cleanup-Process================================================ */
 
-static int cleanup_groups(TALLOC_CTX *memctx,
-                          struct sysdb_ctx *sysdb,
-                          struct sss_domain_info *domain)
+static int cleanup_groups_search(TALLOC_CTX *mem_ctx,
+                                 struct sss_domain_info *domain,
+                                 size_t limit,
+                                 struct ldb_message ***_msgs,
+                                 size_t *_count)
 {
     TALLOC_CTX *tmpctx;
     const char *attrs[] = { SYSDB_NAME, SYSDB_GIDNUM, NULL };
     time_t now = time(NULL);
     char *subfilter;
-    const char *dn;
-    gid_t gid;
     struct ldb_message **msgs;
     size_t count;
-    struct ldb_message **u_msgs;
-    size_t u_count;
     int ret;
-    int i;
-    const char *posix;
-    struct ldb_dn *base_dn;
 
-    tmpctx = talloc_new(memctx);
+    tmpctx = talloc_new(NULL);
     if (!tmpctx) {
         return ENOMEM;
     }
@@ -394,102 +816,125 @@ static int cleanup_groups(TALLOC_CTX *memctx,
         goto done;
     }
 
-    ret = sysdb_search_groups(tmpctx, domain, subfilter, attrs, &count, &msgs);
+    ret = sysdb_search_groups_limit(tmpctx, domain, subfilter, attrs, limit,
+                                    &count, &msgs);
     if (ret == ENOENT) {
         count = 0;
+        msgs = NULL;
     } else if (ret != EOK) {
-        DEBUG(SSSDBG_CRIT_FAILURE, "sysdb_search_groups failed: %d\n", ret);
+        DEBUG(SSSDBG_CRIT_FAILURE,
+              "sysdb_search_groups_limit failed: %d\n", ret);
         goto done;
     }
 
     DEBUG(SSSDBG_FUNC_DATA, "Found %zu expired group entries!\n", count);
 
-    if (count == 0) {
-        ret = EOK;
+    *_msgs = talloc_steal(mem_ctx, msgs);
+    *_count = count;
+    ret = EOK;
+
+done:
+    talloc_zfree(tmpctx);
+    return ret;
+}
+
+static int cleanup_group(struct sss_domain_info *domain,
+                         struct ldb_message *msg)
+{
+    TALLOC_CTX *tmpctx;
+    char *subfilter;
+    const char *dn;
+    gid_t gid;
+    struct ldb_message **u_msgs;
+    size_t u_count;
+    int ret;
+    const char *posix;
+    struct ldb_dn *base_dn;
+    char *sanitized_dn;
+
+    tmpctx = talloc_new(NULL);
+    if (!tmpctx) {
+        return ENOMEM;
+    }
+
+    dn = ldb_dn_get_linearized(msg->dn);
+    if (!dn) {
+        DEBUG(SSSDBG_CRIT_FAILURE, "Cannot linearize DN!\n");
+        ret = EFAULT;
         goto done;
     }
 
-    for (i = 0; i < count; i++) {
-        char *sanitized_dn;
+    /* sanitize dn */
+    ret = sss_filter_sanitize(tmpctx, dn, &sanitized_dn);
+    if (ret != EOK) {
+        DEBUG(SSSDBG_MINOR_FAILURE,
+              "sss_filter_sanitize failed: %s:[%d]\n",
+              sss_strerror(ret), ret);
+        goto done;
+    }
 
-        dn = ldb_dn_get_linearized(msgs[i]->dn);
-        if (!dn) {
-            DEBUG(SSSDBG_CRIT_FAILURE, "Cannot linearize DN!\n");
-            ret = EFAULT;
-            goto done;
-        }
+    posix = ldb_msg_find_attr_as_string(msg, SYSDB_POSIX, NULL);
+    if (!posix || strcmp(posix, "TRUE") == 0) {
+        /* Search for users that are members of this group, or
+         * that have this group as their primary GID.
+         * Include subdomain users as well.
+         */
+        gid = (gid_t) ldb_msg_find_attr_as_uint(msg, SYSDB_GIDNUM, 0);
+        subfilter = talloc_asprintf(tmpctx, "(&(%s=%s)(|(%s=%s)(%s=%lu)))",
+                                    SYSDB_OBJECTCLASS, SYSDB_USER_CLASS,
+                                    SYSDB_MEMBEROF, sanitized_dn,
+                                    SYSDB_GIDNUM, (long unsigned) gid);
+    } else {
+        subfilter = talloc_asprintf(tmpctx, "(%s=%s)", SYSDB_MEMBEROF,
+                                    sanitized_dn);
+    }
+    talloc_zfree(sanitized_dn);
 
-        /* sanitize dn */
-        ret = sss_filter_sanitize(tmpctx, dn, &sanitized_dn);
-        if (ret != EOK) {
-            DEBUG(SSSDBG_MINOR_FAILURE,
-                  "sss_filter_sanitize failed: %s:[%d]\n",
-                  sss_strerror(ret), ret);
-            goto done;
-        }
+    if (!subfilter) {
+        DEBUG(SSSDBG_OP_FAILURE, "Failed to build filter\n");
+        ret = ENOMEM;
+        goto done;
+    }
 
-        posix = ldb_msg_find_attr_as_string(msgs[i], SYSDB_POSIX, NULL);
-        if (!posix || strcmp(posix, "TRUE") == 0) {
-            /* Search for users that are members of this group, or
-             * that have this group as their primary GID.
-             * Include subdomain users as well.
-             */
-            gid = (gid_t) ldb_msg_find_attr_as_uint(msgs[i], SYSDB_GIDNUM, 0);
-            subfilter = talloc_asprintf(tmpctx, "(&(%s=%s)(|(%s=%s)(%s=%lu)))",
-                                        SYSDB_OBJECTCLASS, SYSDB_USER_CLASS,
-                                        SYSDB_MEMBEROF, sanitized_dn,
-                                        SYSDB_GIDNUM, (long unsigned) gid);
-        } else {
-            subfilter = talloc_asprintf(tmpctx, "(%s=%s)", SYSDB_MEMBEROF,
-                                        sanitized_dn);
-        }
-        talloc_zfree(sanitized_dn);
+    base_dn = sysdb_base_dn(domain->sysdb, tmpctx);
+    if (base_dn == NULL) {
+        DEBUG(SSSDBG_OP_FAILURE, "Failed to build base dn\n");
+        ret = ENOMEM;
+        goto done;
+    }
 
-        if (!subfilter) {
-            DEBUG(SSSDBG_OP_FAILURE, "Failed to build filter\n");
-            ret = ENOMEM;
-            goto done;
-        }
+    DEBUG(SSSDBG_TRACE_LIBS, "Searching with: %s\n", subfilter);
 
-        base_dn = sysdb_base_dn(sysdb, tmpctx);
-        if (base_dn == NULL) {
-            DEBUG(SSSDBG_OP_FAILURE, "Failed to build base dn\n");
-            ret = ENOMEM;
+    ret = sysdb_search_entry(tmpctx, domain->sysdb, base_dn,
+                             LDB_SCOPE_SUBTREE, subfilter, NULL,
+                             &u_count, &u_msgs);
+    if (ret == ENOENT) {
+        const char *name;
+
+        name = ldb_msg_find_attr_as_string(msg, SYSDB_NAME, NULL);
+        if (!name) {
+            DEBUG(SSSDBG_OP_FAILURE, "Entry %s has no Name Attribute ?!?\n",
+                      ldb_dn_get_linearized(msg->dn));
+            ret = EFAULT;
             goto done;
         }
 
-        DEBUG(SSSDBG_TRACE_LIBS, "Searching with: %s\n", subfilter);
-
-        ret = sysdb_search_entry(tmpctx, sysdb, base_dn,
-                                 LDB_SCOPE_SUBTREE, subfilter, NULL,
-                                 &u_count, &u_msgs);
-        if (ret == ENOENT) {
-            const char *name;
-
-            name = ldb_msg_find_attr_as_string(msgs[i], SYSDB_NAME, NULL);
-            if (!name) {
-                DEBUG(SSSDBG_OP_FAILURE, "Entry %s has no Name Attribute ?!?\n",
-                          ldb_dn_get_linearized(msgs[i]->dn));
-                ret = EFAULT;
-                goto done;
-            }
-
-            DEBUG(SSSDBG_TRACE_INTERNAL, "About to delete group %s\n", name);
-            ret = sysdb_delete_group(domain, name, 0);
-            if (ret) {
-                DEBUG(SSSDBG_OP_FAILURE, "Group delete returned %d (%s)\n",
-                          ret, strerror(ret));
-                goto done;
-            }
-        } else if (ret != EOK) {
-            DEBUG(SSSDBG_CRIT_FAILURE,
-                  "Failed to search sysdb using %s: [%d] %s\n",
-                  subfilter, ret, sss_strerror(ret));
+        DEBUG(SSSDBG_TRACE_INTERNAL, "About to delete group %s\n", name);
+        ret = sysdb_delete_group(domain, name, 0);
+        if (ret) {
+            DEBUG(SSSDBG_OP_FAILURE, "Group delete returned %d (%s)\n",
+                      ret, strerror(ret));
             goto done;
         }
-        talloc_zfree(u_msgs);
+    } else if (ret != EOK) {
+        DEBUG(SSSDBG_CRIT_FAILURE,
+              "Failed to search sysdb using %s: [%d] %s\n",
+              subfilter, ret, sss_strerror(ret));
+        goto done;
     }
 
+    ret = EOK;
+
 done:
     talloc_zfree(tmpctx);
     return ret;
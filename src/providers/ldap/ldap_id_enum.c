@@ -109,6 +109,7 @@ errno_t ldap_setup_enumeration(struct be_ctx *be_ctx,
         return ret;
     }
 
+    be_ptask_set_dp_target(sdom->enum_task, DPT_ID);
     talloc_steal(sdom->enum_task, ectx);
     return EOK;
 }
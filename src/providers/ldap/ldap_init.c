@@ -413,7 +413,7 @@ static errno_t ldap_init_misc(struct be_ctx *be_ctx,
         return ret;
     }
 
-    ret = sdap_setup_child();
+    ret = sdap_setup_child(be_ctx, be_ctx->ev, id_ctx->opts);
     if (ret != EOK) {
         DEBUG(SSSDBG_CRIT_FAILURE, "Unable to setup sdap child [%d]: %s\n",
               ret, sss_strerror(ret));
@@ -525,6 +525,10 @@ errno_t sssm_ldap_id_init(TALLOC_CTX *mem_ctx,
                   sdap_account_info_handler_send, sdap_account_info_handler_recv, id_ctx,
                   struct sdap_id_ctx, struct dp_id_data, struct dp_reply_std);
 
+    dp_set_method(dp_methods, DPM_ACCOUNT_BATCH_HANDLER,
+                  sdap_account_batch_handler_send, sdap_account_batch_handler_recv, id_ctx,
+                  struct sdap_id_ctx, struct dp_id_batch_data, struct dp_reply_batch);
+
     dp_set_method(dp_methods, DPM_CHECK_ONLINE,
                   sdap_online_check_handler_send, sdap_online_check_handler_recv, id_ctx,
                   struct sdap_id_ctx, void, struct dp_reply_std);
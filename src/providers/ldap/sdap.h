@@ -51,6 +51,9 @@ struct sdap_op {
     struct tevent_context *ev;
     struct sdap_msg *list;
     struct sdap_msg *last;
+
+    uint64_t trace_id;
+    struct timeval started;
 };
 
 struct fd_event_item {
@@ -233,6 +236,7 @@ enum sdap_basic_opt {
     SDAP_MAX_ID,
     SDAP_PWDLOCKOUT_DN,
     SDAP_WILDCARD_LIMIT,
+    SDAP_CHILD_POOL_SIZE,
 
     SDAP_OPTS_BASIC /* opts counter */
 };
@@ -421,6 +425,11 @@ struct sdap_domain {
     struct timeval last_enum;
     /* cleanup loop timer */
     struct timeval last_purge;
+    /* expired users were already purged by an interrupted cleanup,
+     * only groups remain. Kept in memory only, after a restart the
+     * cleanup starts with the users again. */
+    bool purge_users_done;
+    bool purge_in_progress;
 
     void *pvt;
 };
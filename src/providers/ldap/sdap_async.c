@@ -24,8 +24,23 @@
 #include "util/util.h"
 #include "util/strtonum.h"
 #include "util/probes.h"
+#include "util/sss_trace.h"
+#include "util/sss_perf.h"
 #include "providers/ldap/sdap_async_private.h"
 
+/* Runs the callback of the operation on behalf of the client request that
+ * started it. The callback may free the operation. */
+static void sdap_op_callback(struct sdap_op *op,
+                             struct sdap_msg *reply,
+                             int error)
+{
+    uint64_t prev_trace_id;
+
+    prev_trace_id = sss_trace_set_current(op->trace_id);
+    op->callback(op, reply, error, op->data);
+    sss_trace_set_current(prev_trace_id);
+}
+
 #define REPLY_REALLOC_INCREMENT 10
 
 /* ==LDAP-Memory-Handling================================================= */
@@ -100,7 +115,7 @@ static void sdap_handle_release(struct sdap_handle *sh)
 
     while (sh->ops) {
         op = sh->ops;
-        op->callback(op, NULL, EIO, op->data);
+        sdap_op_callback(op, NULL, EIO);
         /* calling the callback may result in freeing the op */
         /* check if it is still the same or avoid freeing */
         if (op == sh->ops) talloc_free(op);
@@ -315,6 +330,8 @@ static void sdap_process_message(struct tevent_context *ev,
     case LDAP_RES_INTERMEDIATE:
         /* no more results expected with this msgid */
         op->done = true;
+        sss_perf_record(SSS_PERF_HIST_LDAP_OP, msgtype,
+                        sdap_ldap_result_str(msgtype), &op->started);
         break;
 
     default:
@@ -350,7 +367,7 @@ static void sdap_process_message(struct tevent_context *ev,
 
         /* must be the last operation as it may end up freeing all memory
          * including all ops handlers */
-        op->callback(op, reply, ret, op->data);
+        sdap_op_callback(op, reply, ret);
     }
 }
 
@@ -383,7 +400,7 @@ static void sdap_unlock_next_reply(struct sdap_op *op)
         if (!te) {
             DEBUG(SSSDBG_CRIT_FAILURE,
                   "Failed to add critical timer for next reply!\n");
-            op->callback(op, NULL, EFAULT, op->data);
+            sdap_op_callback(op, NULL, EFAULT);
         }
     }
 }
@@ -394,7 +411,7 @@ static void sdap_process_next_reply(struct tevent_context *ev,
 {
     struct sdap_op *op = talloc_get_type(pvt, struct sdap_op);
 
-    op->callback(op, op->list, EOK, op->data);
+    sdap_op_callback(op, op->list, EOK);
 }
 
 /* ==LDAP-Operations-Helpers============================================== */
@@ -405,6 +422,8 @@ static int sdap_op_destructor(void *mem)
 
     DLIST_REMOVE(op->sh->ops, op);
 
+    sss_trace_span(op->trace_id, SSS_TRACE_LDAP, &op->started);
+
     if (op->done) {
         DEBUG(SSSDBG_TRACE_INTERNAL, "Operation %d finished\n", op->msgid);
         return 0;
@@ -432,7 +451,7 @@ static void sdap_op_timeout(struct tevent_req *req)
 
     /* signal the caller that we have a timeout */
     DEBUG(SSSDBG_TRACE_LIBS, "Issuing timeout for %d\n", op->msgid);
-    op->callback(op, NULL, ETIMEDOUT, op->data);
+    sdap_op_callback(op, NULL, ETIMEDOUT);
 }
 
 int sdap_op_add(TALLOC_CTX *memctx, struct tevent_context *ev,
@@ -450,6 +469,8 @@ int sdap_op_add(TALLOC_CTX *memctx, struct tevent_context *ev,
     op->callback = callback;
     op->data = data;
     op->ev = ev;
+    op->trace_id = sss_trace_current();
+    op->started = tevent_timeval_current();
 
     DEBUG(SSSDBG_TRACE_INTERNAL,
           "New operation %d timeout %d\n", op->msgid, timeout);
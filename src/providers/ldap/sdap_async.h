@@ -33,6 +33,13 @@
 
 #define AD_TOKENGROUPS_ATTR "tokenGroups"
 
+/* Keys of the SSS_PERF_HIST_SDAP_REQ histograms */
+enum sdap_perf_req {
+    SDAP_PERF_DOM_ENUM,
+    SDAP_PERF_INITGR,
+    SDAP_PERF_NESTED_GROUP,
+};
+
 struct tevent_req *sdap_connect_send(TALLOC_CTX *memctx,
                                      struct tevent_context *ev,
                                      struct sdap_options *opts,
@@ -26,6 +26,7 @@
 #include <errno.h>
 
 #include "util/util.h"
+#include "util/sss_perf.h"
 #include "db/sysdb.h"
 #include "providers/ldap/ldap_common.h"
 #include "providers/ldap/sdap_async.h"
@@ -62,6 +63,7 @@ struct sdap_dom_enum_ex_state {
     struct sdap_id_op *svc_op;
 
     bool purge;
+    struct timeval start;
 };
 
 static errno_t sdap_dom_enum_ex_retry(struct tevent_req *req,
@@ -76,6 +78,7 @@ static void sdap_dom_enum_ex_get_groups(struct tevent_req *subreq);
 static void sdap_dom_enum_ex_groups_done(struct tevent_req *subreq);
 static void sdap_dom_enum_ex_get_svcs(struct tevent_req *subreq);
 static void sdap_dom_enum_ex_svcs_done(struct tevent_req *subreq);
+static void sdap_dom_enum_ex_purge_done(struct tevent_req *subreq);
 
 struct tevent_req *
 sdap_dom_enum_ex_send(TALLOC_CTX *memctx,
@@ -101,6 +104,7 @@ sdap_dom_enum_ex_send(TALLOC_CTX *memctx,
     state->group_conn = group_conn;
     state->svc_conn = svc_conn;
     sdom->last_enum = tevent_timeval_current();
+    state->start = sdom->last_enum;
 
     t = dp_opt_get_int(ctx->opts->basic, SDAP_PURGE_CACHE_TIMEOUT);
     if ((sdom->last_purge.tv_sec + t) < sdom->last_enum.tv_sec) {
@@ -482,14 +486,33 @@ static void sdap_dom_enum_ex_svcs_done(struct tevent_req *subreq)
     }
 
     if (state->purge) {
-        ret = ldap_id_cleanup(state->ctx->opts, state->sdom);
-        if (ret != EOK) {
-            /* Not fatal, worst case we'll have stale entries that would be
-             * removed on a subsequent online lookup
-             */
-            DEBUG(SSSDBG_MINOR_FAILURE, "Cleanup failed: [%d]: %s\n",
-                  ret, sss_strerror(ret));
+        subreq = ldap_id_cleanup_send(state, state->ev, state->ctx->opts,
+                                      state->sdom);
+        if (subreq == NULL) {
+            tevent_req_error(req, ENOMEM);
+            return;
         }
+        tevent_req_set_callback(subreq, sdap_dom_enum_ex_purge_done, req);
+        return;
+    }
+
+    tevent_req_done(req);
+}
+
+static void sdap_dom_enum_ex_purge_done(struct tevent_req *subreq)
+{
+    struct tevent_req *req = tevent_req_callback_data(subreq,
+                                                      struct tevent_req);
+    errno_t ret;
+
+    ret = ldap_id_cleanup_recv(subreq);
+    talloc_zfree(subreq);
+    if (ret != EOK) {
+        /* Not fatal, worst case we'll have stale entries that would be
+         * removed on a subsequent online lookup
+         */
+        DEBUG(SSSDBG_MINOR_FAILURE, "Cleanup failed: [%d]: %s\n",
+              ret, sss_strerror(ret));
     }
 
     tevent_req_done(req);
@@ -497,6 +520,12 @@ static void sdap_dom_enum_ex_svcs_done(struct tevent_req *subreq)
 
 errno_t sdap_dom_enum_ex_recv(struct tevent_req *req)
 {
+    struct sdap_dom_enum_ex_state *state;
+
+    state = tevent_req_data(req, struct sdap_dom_enum_ex_state);
+    sss_perf_record(SSS_PERF_HIST_SDAP_REQ, SDAP_PERF_DOM_ENUM,
+                    "enumeration", &state->start);
+
     TEVENT_REQ_RETURN_ON_ERROR(req);
 
     return EOK;
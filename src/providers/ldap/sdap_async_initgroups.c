@@ -22,6 +22,7 @@
 */
 
 #include "util/util.h"
+#include "util/sss_perf.h"
 #include "db/sysdb.h"
 #include "providers/ldap/sdap_async_private.h"
 #include "providers/ldap/ldap_common.h"
@@ -2664,6 +2665,7 @@ struct sdap_get_initgr_state {
     struct sdap_search_base **user_search_bases;
 
     bool use_id_mapping;
+    struct timeval start;
 };
 
 static errno_t sdap_get_initgr_next_base(struct tevent_req *req);
@@ -2694,6 +2696,7 @@ struct tevent_req *sdap_get_initgr_send(TALLOC_CTX *memctx,
     req = tevent_req_create(memctx, &state, struct sdap_get_initgr_state);
     if (!req) return NULL;
 
+    state->start = tevent_timeval_current();
     state->ev = ev;
     state->opts = id_ctx->opts;
     state->dom = sdom->dom;
@@ -3257,6 +3260,12 @@ static void sdap_get_initgr_pgid(struct tevent_req *subreq)
 
 int sdap_get_initgr_recv(struct tevent_req *req)
 {
+    struct sdap_get_initgr_state *state;
+
+    state = tevent_req_data(req, struct sdap_get_initgr_state);
+    sss_perf_record(SSS_PERF_HIST_SDAP_REQ, SDAP_PERF_INITGR,
+                    "initgroups", &state->start);
+
     TEVENT_REQ_RETURN_ON_ERROR(req);
 
     return EOK;
@@ -31,6 +31,7 @@
 
 #include "util/util.h"
 #include "util/probes.h"
+#include "util/sss_perf.h"
 #include "db/sysdb.h"
 #include "providers/ldap/ldap_common.h"
 #include "providers/ldap/sdap_async.h"
@@ -793,6 +794,7 @@ sdap_nested_group_ext_members(struct sdap_options *opts,
 
 struct sdap_nested_group_state {
     struct sdap_nested_group_ctx *group_ctx;
+    struct timeval start;
 };
 
 static void sdap_nested_group_done(struct tevent_req *subreq);
@@ -819,6 +821,8 @@ sdap_nested_group_send(TALLOC_CTX *mem_ctx,
         return NULL;
     }
 
+    state->start = tevent_timeval_current();
+
     /* create main nested group context */
     state->group_ctx = talloc_zero(state, struct sdap_nested_group_ctx);
     if (state->group_ctx == NULL) {
@@ -954,6 +958,8 @@ errno_t sdap_nested_group_recv(TALLOC_CTX *mem_ctx,
     state = tevent_req_data(req, struct sdap_nested_group_state);
 
     PROBE(SDAP_NESTED_GROUP_RECV);
+    sss_perf_record(SSS_PERF_HIST_SDAP_REQ, SDAP_PERF_NESTED_GROUP,
+                    "nested_group", &state->start);
     TEVENT_REQ_RETURN_ON_ERROR(req);
 
     ret = sdap_nested_group_extract_hash_table(state, state->group_ctx->users,
@@ -44,6 +44,9 @@
 #define LDAP_CHILD_USER  "nobody"
 #endif
 
+/* Shared by all requests of the backend, see sdap_setup_child() */
+static struct sss_child_pool *ldap_child_pool;
+
 struct sdap_child {
     /* child info */
     pid_t pid;
@@ -278,6 +281,7 @@ static errno_t set_tgt_child_timeout(struct tevent_req *req,
                                      int timeout);
 static void sdap_get_tgt_step(struct tevent_req *subreq);
 static void sdap_get_tgt_done(struct tevent_req *subreq);
+static void sdap_get_tgt_pool_done(struct tevent_req *subreq);
 
 struct tevent_req *sdap_get_tgt_send(TALLOC_CTX *mem_ctx,
                                      struct tevent_context *ev,
@@ -323,6 +327,18 @@ struct tevent_req *sdap_get_tgt_send(TALLOC_CTX *mem_ctx,
         goto fail;
     }
 
+    if (sss_child_pool_accepts(ldap_child_pool)) {
+        subreq = sss_child_pool_send(state, ev, ldap_child_pool,
+                                     buf->data, buf->size, timeout);
+        if (subreq == NULL) {
+            ret = ENOMEM;
+            goto fail;
+        }
+        tevent_req_set_callback(subreq, sdap_get_tgt_pool_done, req);
+
+        return req;
+    }
+
     ret = sdap_fork_child(state->ev, state->child, req);
     if (ret != EOK) {
         DEBUG(SSSDBG_CRIT_FAILURE, "sdap_fork_child failed.\n");
@@ -402,6 +418,24 @@ static void sdap_get_tgt_done(struct tevent_req *subreq)
     /* wait for child callback to terminate the request */
 }
 
+static void sdap_get_tgt_pool_done(struct tevent_req *subreq)
+{
+    struct tevent_req *req = tevent_req_callback_data(subreq,
+                                                      struct tevent_req);
+    struct sdap_get_tgt_state *state = tevent_req_data(req,
+                                                  struct sdap_get_tgt_state);
+    int ret;
+
+    ret = sss_child_pool_recv(subreq, state, &state->buf, &state->len);
+    talloc_zfree(subreq);
+    if (ret != EOK) {
+        tevent_req_error(req, ret);
+        return;
+    }
+
+    tevent_req_done(req);
+}
+
 int sdap_get_tgt_recv(struct tevent_req *req,
                       TALLOC_CTX *mem_ctx,
                       int  *result,
@@ -515,7 +549,34 @@ static errno_t set_tgt_child_timeout(struct tevent_req *req,
 
 
 /* Setup child logging */
-int sdap_setup_child(void)
+int sdap_setup_child(TALLOC_CTX *mem_ctx,
+                     struct tevent_context *ev,
+                     struct sdap_options *opts)
 {
-    return child_debug_init(LDAP_CHILD_LOG_FILE, &ldap_child_debug_fd);
+    int pool_size;
+    errno_t ret;
+
+    ret = child_debug_init(LDAP_CHILD_LOG_FILE, &ldap_child_debug_fd);
+    if (ret != EOK) {
+        return ret;
+    }
+
+    pool_size = dp_opt_get_int(opts->basic, SDAP_CHILD_POOL_SIZE);
+    if (pool_size <= 0 || ldap_child_pool != NULL) {
+        return EOK;
+    }
+
+    /* Requests wait for a busy worker only as long as there are not more
+     * of them than workers, otherwise a new ldap_child is forked. */
+    ret = sss_child_pool_create(mem_ctx, ev, LDAP_CHILD, ldap_child_debug_fd,
+                                NULL, STDIN_FILENO, STDOUT_FILENO, pool_size,
+                                SSS_CHILD_POOL_MAX_JOBS, pool_size,
+                                &ldap_child_pool);
+    if (ret != EOK) {
+        DEBUG(SSSDBG_CRIT_FAILURE, "Cannot create ldap_child pool [%d]: %s\n",
+              ret, sss_strerror(ret));
+        return ret;
+    }
+
+    return EOK;
 }
@@ -22,6 +22,8 @@
     along with this program.  If not, see <http://www.gnu.org/licenses/>.
 */
 
+#include "util/sss_trace.h"
+#include "util/sss_perf.h"
 #include "providers/ldap/ldap_common.h"
 #include "providers/ldap/sdap_async.h"
 #include "providers/ldap/sdap_id_op.h"
@@ -54,6 +56,9 @@ struct sdap_id_op {
      * This member is cleared when sdap_id_op_connect_state
      * associated with request is destroyed */
     struct tevent_req *connect_req;
+    /* trace identifier of the request that created the operation,
+     * connections are shared so it is restored once connected */
+    uint64_t trace_id;
 };
 
 /* LDAP connection cache connection attempt/established connection data */
@@ -296,6 +301,7 @@ struct sdap_id_op *sdap_id_op_create(TALLOC_CTX *memctx, struct sdap_id_conn_cac
     }
 
     op->conn_cache = conn_cache;
+    op->trace_id = sss_trace_current();
 
     talloc_set_destructor((void*)op, sdap_id_op_destroy);
     return op;
@@ -481,6 +487,7 @@ static int sdap_id_op_connect_step(struct tevent_req *req)
     }
 
     DEBUG(SSSDBG_TRACE_ALL, "beginning to connect\n");
+    sss_perf_count(SSS_PERF_LDAP_CONNECT);
 
     conn_data = talloc_zero(conn_cache, struct sdap_id_conn_data);
     if (!conn_data) {
@@ -761,6 +768,7 @@ static void sdap_id_op_connect_req_complete(struct sdap_id_op *op, int dp_error,
 {
     struct tevent_req *req = op->connect_req;
     struct sdap_id_op_connect_state *state;
+    uint64_t prev_trace_id;
 
     if (!req) {
         return;
@@ -772,12 +780,14 @@ static void sdap_id_op_connect_req_complete(struct sdap_id_op *op, int dp_error,
     state->dp_error = dp_error;
     state->result = ret;
 
+    prev_trace_id = sss_trace_set_current(op->trace_id);
     if (ret == EOK) {
         tevent_req_done(req);
     } else {
         sdap_id_op_hook_conn_data(op, NULL);
         tevent_req_error(req, ret);
     }
+    sss_trace_set_current(prev_trace_id);
 }
 
 /* Get the result of an asynchronous connect operation on sdap_id_op
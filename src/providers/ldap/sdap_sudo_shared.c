@@ -41,6 +41,7 @@ sdap_sudo_ptask_setup_generic(struct be_ctx *be_ctx,
     time_t full;
     time_t delay;
     time_t last_refresh;
+    struct be_ptask *task;
     errno_t ret;
 
     smart = dp_opt_get_int(opts, SDAP_SUDO_SMART_REFRESH_INTERVAL);
@@ -92,12 +93,14 @@ sdap_sudo_ptask_setup_generic(struct be_ctx *be_ctx,
         ret = be_ptask_create(be_ctx, be_ctx, full, delay, 0, 0, full,
                               BE_PTASK_OFFLINE_DISABLE, 0,
                               full_send_fn, full_recv_fn, pvt,
-                              "SUDO Full Refresh", NULL);
+                              "SUDO Full Refresh", &task);
         if (ret != EOK) {
             DEBUG(SSSDBG_CRIT_FAILURE, "Unable to setup full refresh ptask "
                   "[%d]: %s\n", ret, sss_strerror(ret));
             return ret;
         }
+
+        be_ptask_set_dp_target(task, DPT_SUDO);
     }
 
     /* Smart refresh.
@@ -109,12 +112,14 @@ sdap_sudo_ptask_setup_generic(struct be_ctx *be_ctx,
         ret = be_ptask_create(be_ctx, be_ctx, smart, delay + smart, smart, 0,
                               smart, BE_PTASK_OFFLINE_DISABLE, 0,
                               smart_send_fn, smart_recv_fn, pvt,
-                              "SUDO Smart Refresh", NULL);
+                              "SUDO Smart Refresh", &task);
         if (ret != EOK) {
             DEBUG(SSSDBG_CRIT_FAILURE, "Unable to setup smart refresh ptask "
                   "[%d]: %s\n", ret, sss_strerror(ret));
             return ret;
         }
+
+        be_ptask_set_dp_target(task, DPT_SUDO);
     }
 
     return EOK;
@@ -37,6 +37,7 @@
 #include <security/pam_modules.h>
 
 #include "util/util.h"
+#include "util/child_common.h"
 #include "providers/backend.h"
 #include "db/sysdb.h"
 #include "sss_client/nss_compat.h"
@@ -101,6 +102,10 @@ struct proxy_id_ctx {
     bool fast_alias;
     struct proxy_nss_ops ops;
     void *handle;
+
+    /* proxy_id_child workers, NULL if the lookups run in sssd_be */
+    struct sss_child_pool *child_pool;
+    int child_debug_fd;
 };
 
 struct proxy_auth_ctx {
@@ -145,6 +150,35 @@ struct pc_init_ctx {
 #define DEFAULT_BUFSIZE 4096
 #define MAX_BUF_SIZE 1024*1024 /* max 1MiB */
 
+#define PROXY_ID_CHILD_PATH SSSD_LIBEXEC_PATH"/proxy_id_child"
+#define PROXY_ID_CHILD_LOG_FILE "proxy_id_child"
+/* Seconds a lookup may take in proxy_id_child, including the time spent
+ * waiting for a free worker */
+#define PROXY_ID_CHILD_TIMEOUT 60
+/* Lookups waiting for a worker before further ones are rejected */
+#define PROXY_ID_CHILD_MAX_QUEUED 256
+
+/* Lookups performed by proxy_id_child. A request consists of the command,
+ * a numeric ID and a name, each stored as uint32_t and the name followed by
+ * its characters. The reply starts with the nss_status and errno of the
+ * call, for a successful call the entry follows. Strings are stored as
+ * their length followed by the characters, UINT32_MAX stands for NULL.
+ *
+ *  passwd: name, passwd, uid, gid, gecos, dir, shell
+ *  group:  name, passwd, gid, number of members, members
+ *  groups: number of GIDs, GIDs
+ *
+ * If the entry does not fit into a reply the status is NSS_STATUS_TRYAGAIN
+ * and errno ERANGE. */
+enum proxy_id_child_cmd {
+    PROXY_ID_CHILD_GETPWNAM = 1,
+    PROXY_ID_CHILD_GETPWUID,
+    PROXY_ID_CHILD_GETGRNAM,
+    PROXY_ID_CHILD_GETGRGID,
+    /* name of the user and its primary GID, returns the groups */
+    PROXY_ID_CHILD_INITGROUPS,
+};
+
 /* From proxy_id.c */
 struct tevent_req *
 proxy_account_info_handler_send(TALLOC_CTX *mem_ctx,
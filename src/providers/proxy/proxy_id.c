@@ -1428,8 +1428,924 @@ static int get_initgr_groups_process(TALLOC_CTX *memctx,
     return ret;
 }
 
+/* =Proxy_Id_Child-Functions==============================================*/
+
+/* With proxy_id_child_pool_size set, the NSS calls of single user, group
+ * and initgroups lookups run in proxy_id_child and only the results are
+ * stored by sssd_be, so that a slow NSS module does not block it. */
+
+struct proxy_child_reply {
+    enum nss_status status;
+    int err;
+    struct passwd *pwd;
+    struct group *grp;
+    gid_t *gids;
+    uint32_t num_gids;
+};
+
+static errno_t proxy_child_parse_string(TALLOC_CTX *mem_ctx,
+                                        uint8_t *buf, size_t size,
+                                        size_t *p, char **_str)
+{
+    uint32_t len;
+
+    SAFEALIGN_COPY_UINT32_CHECK(&len, buf + *p, size, p);
+    if (len == UINT32_MAX) {
+        *_str = NULL;
+        return EOK;
+    }
+
+    if (len > size - *p) return EINVAL;
+    *_str = talloc_strndup(mem_ctx, (char *)(buf + *p), len);
+    if (*_str == NULL) return ENOMEM;
+    *p += len;
+
+    return EOK;
+}
+
+static errno_t proxy_child_parse_passwd(struct proxy_child_reply *reply,
+                                        uint8_t *buf, size_t size, size_t *p)
+{
+    struct passwd *pwd;
+    uint32_t value;
+    errno_t ret;
+
+    pwd = talloc_zero(reply, struct passwd);
+    if (pwd == NULL) return ENOMEM;
+
+    ret = proxy_child_parse_string(pwd, buf, size, p, &pwd->pw_name);
+    if (ret != EOK) return ret;
+    ret = proxy_child_parse_string(pwd, buf, size, p, &pwd->pw_passwd);
+    if (ret != EOK) return ret;
+    SAFEALIGN_COPY_UINT32_CHECK(&value, buf + *p, size, p);
+    pwd->pw_uid = value;
+    SAFEALIGN_COPY_UINT32_CHECK(&value, buf + *p, size, p);
+    pwd->pw_gid = value;
+    ret = proxy_child_parse_string(pwd, buf, size, p, &pwd->pw_gecos);
+    if (ret != EOK) return ret;
+    ret = proxy_child_parse_string(pwd, buf, size, p, &pwd->pw_dir);
+    if (ret != EOK) return ret;
+    ret = proxy_child_parse_string(pwd, buf, size, p, &pwd->pw_shell);
+    if (ret != EOK) return ret;
+
+    if (pwd->pw_name == NULL) return EINVAL;
+
+    reply->pwd = pwd;
+    return EOK;
+}
+
+static errno_t proxy_child_parse_group(struct proxy_child_reply *reply,
+                                       uint8_t *buf, size_t size, size_t *p)
+{
+    struct group *grp;
+    uint32_t value;
+    uint32_t num_mem;
+    uint32_t i;
+    errno_t ret;
+
+    grp = talloc_zero(reply, struct group);
+    if (grp == NULL) return ENOMEM;
+
+    ret = proxy_child_parse_string(grp, buf, size, p, &grp->gr_name);
+    if (ret != EOK) return ret;
+    ret = proxy_child_parse_string(grp, buf, size, p, &grp->gr_passwd);
+    if (ret != EOK) return ret;
+    SAFEALIGN_COPY_UINT32_CHECK(&value, buf + *p, size, p);
+    grp->gr_gid = value;
+
+    SAFEALIGN_COPY_UINT32_CHECK(&num_mem, buf + *p, size, p);
+    if (num_mem > (size - *p) / sizeof(uint32_t)) return EINVAL;
+
+    grp->gr_mem = talloc_zero_array(grp, char *, num_mem + 1);
+    if (grp->gr_mem == NULL) return ENOMEM;
+
+    for (i = 0; i < num_mem; i++) {
+        ret = proxy_child_parse_string(grp->gr_mem, buf, size, p,
+                                       &grp->gr_mem[i]);
+        if (ret != EOK) return ret;
+        if (grp->gr_mem[i] == NULL) return EINVAL;
+    }
+
+    if (grp->gr_name == NULL) return EINVAL;
+
+    reply->grp = grp;
+    return EOK;
+}
+
+static errno_t proxy_child_parse_gids(struct proxy_child_reply *reply,
+                                      uint8_t *buf, size_t size, size_t *p)
+{
+    uint32_t value;
+    uint32_t i;
+
+    SAFEALIGN_COPY_UINT32_CHECK(&reply->num_gids, buf + *p, size, p);
+    if (reply->num_gids > (size - *p) / sizeof(uint32_t)) return EINVAL;
+
+    reply->gids = talloc_array(reply, gid_t, reply->num_gids);
+    if (reply->gids == NULL) return ENOMEM;
+
+    for (i = 0; i < reply->num_gids; i++) {
+        SAFEALIGN_COPY_UINT32_CHECK(&value, buf + *p, size, p);
+        reply->gids[i] = value;
+    }
+
+    return EOK;
+}
+
+static errno_t proxy_child_parse_reply(TALLOC_CTX *mem_ctx,
+                                       enum proxy_id_child_cmd cmd,
+                                       uint8_t *buf, size_t size,
+                                       struct proxy_child_reply **_reply)
+{
+    struct proxy_child_reply *reply;
+    uint32_t value;
+    size_t p = 0;
+    errno_t ret;
+
+    reply = talloc_zero(mem_ctx, struct proxy_child_reply);
+    if (reply == NULL) return ENOMEM;
+
+    SAFEALIGN_COPY_UINT32_CHECK(&value, buf + p, size, &p);
+    reply->status = (int32_t) value;
+    SAFEALIGN_COPY_UINT32_CHECK(&value, buf + p, size, &p);
+    reply->err = value;
+
+    switch (cmd) {
+    case PROXY_ID_CHILD_GETPWNAM:
+    case PROXY_ID_CHILD_GETPWUID:
+        ret = EOK;
+        if (reply->status == NSS_STATUS_SUCCESS) {
+            ret = proxy_child_parse_passwd(reply, buf, size, &p);
+        }
+        break;
+    case PROXY_ID_CHILD_GETGRNAM:
+    case PROXY_ID_CHILD_GETGRGID:
+        ret = EOK;
+        if (reply->status == NSS_STATUS_SUCCESS) {
+            ret = proxy_child_parse_group(reply, buf, size, &p);
+        }
+        break;
+    case PROXY_ID_CHILD_INITGROUPS:
+        ret = EOK;
+        if (reply->status == NSS_STATUS_SUCCESS
+                || reply->status == NSS_STATUS_NOTFOUND) {
+            ret = proxy_child_parse_gids(reply, buf, size, &p);
+        }
+        break;
+    default:
+        ret = EINVAL;
+        break;
+    }
+
+    if (ret != EOK) {
+        talloc_free(reply);
+        return ret;
+    }
+
+    *_reply = reply;
+    return EOK;
+}
+
+struct proxy_child_lookup_state {
+    enum proxy_id_child_cmd cmd;
+    struct proxy_child_reply *reply;
+};
+
+static void proxy_child_lookup_done(struct tevent_req *subreq);
+
+/* Fails with ERANGE if the request or the entry does not fit into the
+ * messages exchanged with proxy_id_child and with EAGAIN if too many
+ * lookups are waiting for a worker already. */
+static struct tevent_req *
+proxy_child_lookup_send(TALLOC_CTX *mem_ctx,
+                        struct tevent_context *ev,
+                        struct proxy_id_ctx *ctx,
+                        enum proxy_id_child_cmd cmd,
+                        const char *name,
+                        uint32_t id)
+{
+    struct proxy_child_lookup_state *state;
+    struct tevent_req *req;
+    struct tevent_req *subreq;
+    uint8_t *buf;
+    size_t buf_len;
+    size_t name_len;
+    size_t p = 0;
+    errno_t ret;
+
+    req = tevent_req_create(mem_ctx, &state, struct proxy_child_lookup_state);
+    if (req == NULL) {
+        return NULL;
+    }
+
+    state->cmd = cmd;
+
+    if (name == NULL) {
+        name = "";
+    }
+
+    name_len = strlen(name);
+    buf_len = 3 * sizeof(uint32_t) + name_len;
+    if (buf_len > IN_BUF_SIZE) {
+        ret = ERANGE;
+        goto done;
+    }
+
+    buf = talloc_size(state, buf_len);
+    if (buf == NULL) {
+        ret = ENOMEM;
+        goto done;
+    }
+
+    SAFEALIGN_SET_UINT32(&buf[p], cmd, &p);
+    SAFEALIGN_SET_UINT32(&buf[p], id, &p);
+    SAFEALIGN_SET_UINT32(&buf[p], name_len, &p);
+    safealign_memcpy(&buf[p], name, name_len, &p);
+
+    subreq = sss_child_pool_send(state, ev, ctx->child_pool, buf, buf_len,
+                                 PROXY_ID_CHILD_TIMEOUT);
+    if (subreq == NULL) {
+        ret = ENOMEM;
+        goto done;
+    }
+    tevent_req_set_callback(subreq, proxy_child_lookup_done, req);
+
+    return req;
+
+done:
+    tevent_req_error(req, ret);
+    tevent_req_post(req, ev);
+    return req;
+}
+
+static void proxy_child_lookup_done(struct tevent_req *subreq)
+{
+    struct tevent_req *req = tevent_req_callback_data(subreq,
+                                                      struct tevent_req);
+    struct proxy_child_lookup_state *state = tevent_req_data(req,
+                                             struct proxy_child_lookup_state);
+    uint8_t *buf;
+    ssize_t len;
+    errno_t ret;
+
+    ret = sss_child_pool_recv(subreq, state, &buf, &len);
+    talloc_zfree(subreq);
+    if (ret != EOK) {
+        DEBUG(SSSDBG_OP_FAILURE, "proxy_id_child request failed [%d]: %s\n",
+              ret, sss_strerror(ret));
+        tevent_req_error(req, ret);
+        return;
+    }
+
+    if (len <= 0) {
+        DEBUG(SSSDBG_OP_FAILURE, "proxy_id_child failed.\n");
+        tevent_req_error(req, EIO);
+        return;
+    }
+
+    ret = proxy_child_parse_reply(state, state->cmd, buf, len, &state->reply);
+    if (ret != EOK) {
+        DEBUG(SSSDBG_OP_FAILURE, "Malformed reply from proxy_id_child.\n");
+        tevent_req_error(req, ret);
+        return;
+    }
+
+    if (state->reply->status == NSS_STATUS_TRYAGAIN
+            && state->reply->err == ERANGE) {
+        tevent_req_error(req, ERANGE);
+        return;
+    }
+
+    tevent_req_done(req);
+}
+
+static errno_t proxy_child_lookup_recv(TALLOC_CTX *mem_ctx,
+                                       struct tevent_req *req,
+                                       struct proxy_child_reply **_reply)
+{
+    struct proxy_child_lookup_state *state = tevent_req_data(req,
+                                             struct proxy_child_lookup_state);
+
+    TEVENT_REQ_RETURN_ON_ERROR(req);
+
+    *_reply = talloc_steal(mem_ctx, state->reply);
+
+    return EOK;
+}
+
+static int proxy_child_delete_group(struct sss_domain_info *dom,
+                                    const char *name, gid_t gid)
+{
+    int ret;
+
+    DEBUG(SSSDBG_TRACE_FUNC,
+          "Group %s (%"SPRIgid") does not exist (or is invalid) on remote "
+          "server, deleting!\n", name ? name : "-", gid);
+
+    ret = sysdb_delete_group(dom, name, gid);
+    if (ret == ENOENT) {
+        ret = EOK;
+    }
+
+    return ret;
+}
+
+static errno_t proxy_child_store_group(struct sss_domain_info *dom,
+                                       gid_t gid,
+                                       struct proxy_child_reply *reply)
+{
+    bool delete_group = false;
+    char *name;
+    errno_t ret;
+
+    ret = handle_getgr_result(reply->status, reply->grp, dom, &delete_group);
+    if (ret != EOK) {
+        DEBUG(SSSDBG_OP_FAILURE,
+              "getgrgid failed [%d]: %s\n", ret, strerror(ret));
+        return ret;
+    }
+
+    if (delete_group) {
+        return proxy_child_delete_group(dom, NULL, gid);
+    }
+
+    name = sss_create_internal_fqname(reply, reply->grp->gr_name, dom->name);
+    if (name == NULL) {
+        return ENOMEM;
+    }
+
+    return save_group(dom->sysdb, dom, reply->grp, name, NULL);
+}
+
+struct proxy_child_account_state {
+    struct tevent_context *ev;
+    struct proxy_id_ctx *ctx;
+    struct sss_domain_info *dom;
+    int entry_type;
+    /* NULL for lookups by ID */
+    const char *i_name;
+    uint32_t id;
+
+    struct passwd *pwd;
+    struct group *grp;
+    const char *real_name;
+
+    struct proxy_child_reply *initgr;
+    struct proxy_child_reply **groups;
+    uint32_t group_idx;
+};
+
+static errno_t proxy_child_account_lookup(struct tevent_req *req,
+                                          enum proxy_id_child_cmd cmd,
+                                          const char *name, uint32_t id,
+                                          tevent_req_fn fn);
+static void proxy_child_account_pw_done(struct tevent_req *subreq);
+static void proxy_child_account_pw_canon_done(struct tevent_req *subreq);
+static void proxy_child_account_pw_ready(struct tevent_req *req);
+static void proxy_child_account_initgr_done(struct tevent_req *subreq);
+static void proxy_child_account_next_group(struct tevent_req *req);
+static void proxy_child_account_group_done(struct tevent_req *subreq);
+static void proxy_child_account_gr_done(struct tevent_req *subreq);
+static void proxy_child_account_gr_canon_done(struct tevent_req *subreq);
+static void proxy_child_account_finish(struct tevent_req *req, errno_t ret);
+
+static bool proxy_child_account_supported(struct proxy_id_ctx *ctx,
+                                          struct dp_id_data *data)
+{
+    if (ctx->child_pool == NULL || data->attr_type != BE_ATTR_CORE) {
+        return false;
+    }
+
+    switch (data->entry_type & BE_REQ_TYPE_MASK) {
+    case BE_REQ_USER:
+    case BE_REQ_GROUP:
+        if (data->filter_type != BE_FILTER_NAME
+                && data->filter_type != BE_FILTER_IDNUM) {
+            return false;
+        }
+        break;
+    case BE_REQ_INITGROUPS:
+        if (data->filter_type != BE_FILTER_NAME
+                || ctx->ops.initgroups_dyn == NULL) {
+            return false;
+        }
+        break;
+    default:
+        return false;
+    }
+
+    return true;
+}
+
+static struct tevent_req *
+proxy_child_account_send(TALLOC_CTX *mem_ctx,
+                         struct tevent_context *ev,
+                         struct proxy_id_ctx *ctx,
+                         struct dp_id_data *data,
+                         struct sss_domain_info *dom)
+{
+    struct proxy_child_account_state *state;
+    struct tevent_req *req;
+    char *shortname = NULL;
+    char *endptr;
+    enum proxy_id_child_cmd cmd;
+    errno_t ret;
+
+    req = tevent_req_create(mem_ctx, &state,
+                            struct proxy_child_account_state);
+    if (req == NULL) {
+        return NULL;
+    }
+
+    state->ev = ev;
+    state->ctx = ctx;
+    state->dom = dom;
+    state->entry_type = data->entry_type & BE_REQ_TYPE_MASK;
+
+    if (data->filter_type == BE_FILTER_NAME) {
+        state->i_name = data->filter_value;
+
+        ret = sss_parse_internal_fqname(state, state->i_name, &shortname,
+                                        NULL);
+        if (ret != EOK) {
+            goto done;
+        }
+    } else {
+        errno = 0;
+        state->id = strtouint32(data->filter_value, &endptr, 10);
+        if (errno || *endptr || (data->filter_value == endptr)) {
+            ret = EINVAL;
+            goto done;
+        }
+    }
+
+    if (state->entry_type == BE_REQ_GROUP) {
+        cmd = shortname ? PROXY_ID_CHILD_GETGRNAM : PROXY_ID_CHILD_GETGRGID;
+        ret = proxy_child_account_lookup(req, cmd, shortname, state->id,
+                                         proxy_child_account_gr_done);
+    } else {
+        cmd = shortname ? PROXY_ID_CHILD_GETPWNAM : PROXY_ID_CHILD_GETPWUID;
+        ret = proxy_child_account_lookup(req, cmd, shortname, state->id,
+                                         proxy_child_account_pw_done);
+    }
+
+done:
+    if (ret != EOK) {
+        tevent_req_error(req, ret);
+        tevent_req_post(req, ev);
+    }
+
+    return req;
+}
+
+static errno_t proxy_child_account_lookup(struct tevent_req *req,
+                                          enum proxy_id_child_cmd cmd,
+                                          const char *name, uint32_t id,
+                                          tevent_req_fn fn)
+{
+    struct proxy_child_account_state *state = tevent_req_data(req,
+                                            struct proxy_child_account_state);
+    struct tevent_req *subreq;
+
+    subreq = proxy_child_lookup_send(state, state->ev, state->ctx, cmd,
+                                     name, id);
+    if (subreq == NULL) {
+        return ENOMEM;
+    }
+    tevent_req_set_callback(subreq, fn, req);
+
+    return EOK;
+}
+
+static void proxy_child_account_pw_done(struct tevent_req *subreq)
+{
+    struct tevent_req *req = tevent_req_callback_data(subreq,
+                                                      struct tevent_req);
+    struct proxy_child_account_state *state = tevent_req_data(req,
+                                            struct proxy_child_account_state);
+    struct proxy_child_reply *reply;
+    struct ldb_result *cached_pwd = NULL;
+    bool del_user;
+    errno_t ret;
+
+    ret = proxy_child_lookup_recv(state, subreq, &reply);
+    talloc_zfree(subreq);
+    if (ret != EOK) {
+        proxy_child_account_finish(req, ret);
+        return;
+    }
+
+    ret = handle_getpw_result(reply->status, reply->pwd, state->dom,
+                              &del_user);
+    if (ret != EOK) {
+        DEBUG(SSSDBG_OP_FAILURE,
+              "getpw failed [%d]: %s\n", ret, strerror(ret));
+        proxy_child_account_finish(req, ret);
+        return;
+    }
+
+    if (del_user) {
+        ret = delete_user(state->dom, state->i_name, state->id);
+        proxy_child_account_finish(req, ret);
+        return;
+    }
+
+    state->pwd = reply->pwd;
+
+    if (state->i_name == NULL) {
+        state->real_name = sss_create_internal_fqname(state,
+                                                      state->pwd->pw_name,
+                                                      state->dom->name);
+        if (state->real_name == NULL) {
+            proxy_child_account_finish(req, ENOMEM);
+            return;
+        }
+
+        proxy_child_account_pw_ready(req);
+        return;
+    }
+
+    /* Canonicalize the username in case it was actually an alias */
+    if (state->ctx->fast_alias == true) {
+        ret = sysdb_getpwuid(state, state->dom, state->pwd->pw_uid,
+                             &cached_pwd);
+        if (ret != EOK) {
+            /* Non-fatal, attempt to canonicalize online */
+            DEBUG(SSSDBG_TRACE_FUNC, "Request to cache failed [%d]: %s\n",
+                  ret, strerror(ret));
+        }
+
+        if (ret == EOK && cached_pwd->count == 1) {
+            state->real_name = ldb_msg_find_attr_as_string(cached_pwd->msgs[0],
+                                                           SYSDB_NAME, NULL);
+            if (!state->real_name) {
+                DEBUG(SSSDBG_MINOR_FAILURE, "Cached user has no name?\n");
+            }
+        }
+    }
+
+    if (state->real_name != NULL) {
+        proxy_child_account_pw_ready(req);
+        return;
+    }
+
+    ret = proxy_child_account_lookup(req, PROXY_ID_CHILD_GETPWUID, NULL,
+                                     state->pwd->pw_uid,
+                                     proxy_child_account_pw_canon_done);
+    if (ret != EOK) {
+        proxy_child_account_finish(req, ret);
+    }
+}
+
+static void proxy_child_account_pw_canon_done(struct tevent_req *subreq)
+{
+    struct tevent_req *req = tevent_req_callback_data(subreq,
+                                                      struct tevent_req);
+    struct proxy_child_account_state *state = tevent_req_data(req,
+                                            struct proxy_child_account_state);
+    struct proxy_child_reply *reply;
+    bool del_user;
+    errno_t ret;
+
+    ret = proxy_child_lookup_recv(state, subreq, &reply);
+    talloc_zfree(subreq);
+    if (ret != EOK) {
+        proxy_child_account_finish(req, ret);
+        return;
+    }
+
+    ret = handle_getpw_result(reply->status, reply->pwd, state->dom,
+                              &del_user);
+    if (ret != EOK) {
+        DEBUG(SSSDBG_OP_FAILURE,
+              "getpwuid failed [%d]: %s\n", ret, strerror(ret));
+        proxy_child_account_finish(req, ret);
+        return;
+    }
+
+    if (del_user) {
+        ret = delete_user(state->dom, state->i_name, state->pwd->pw_uid);
+        proxy_child_account_finish(req, ret);
+        return;
+    }
+
+    state->pwd = reply->pwd;
+    state->real_name = sss_create_internal_fqname(state, state->pwd->pw_name,
+                                                  state->dom->name);
+    if (state->real_name == NULL) {
+        proxy_child_account_finish(req, ENOMEM);
+        return;
+    }
+
+    proxy_child_account_pw_ready(req);
+}
+
+static void proxy_child_account_pw_ready(struct tevent_req *req)
+{
+    struct proxy_child_account_state *state = tevent_req_data(req,
+                                            struct proxy_child_account_state);
+    errno_t ret;
+
+    if (state->entry_type == BE_REQ_USER) {
+        ret = save_user(state->dom, state->pwd, state->real_name,
+                        state->i_name);
+        proxy_child_account_finish(req, ret);
+        return;
+    }
+
+    ret = proxy_child_account_lookup(req, PROXY_ID_CHILD_INITGROUPS,
+                                     state->pwd->pw_name, state->pwd->pw_gid,
+                                     proxy_child_account_initgr_done);
+    if (ret != EOK) {
+        proxy_child_account_finish(req, ret);
+    }
+}
+
+static void proxy_child_account_initgr_done(struct tevent_req *subreq)
+{
+    struct tevent_req *req = tevent_req_callback_data(subreq,
+                                                      struct tevent_req);
+    struct proxy_child_account_state *state = tevent_req_data(req,
+                                            struct proxy_child_account_state);
+    errno_t ret;
+
+    ret = proxy_child_lookup_recv(state, subreq, &state->initgr);
+    talloc_zfree(subreq);
+    if (ret != EOK) {
+        proxy_child_account_finish(req, ret);
+        return;
+    }
+
+    switch (state->initgr->status) {
+    case NSS_STATUS_NOTFOUND:
+        DEBUG(SSSDBG_FUNC_DATA, "The initgroups call returned 'NOTFOUND'. "
+                                 "Assume the user is only member of its "
+                                 "primary group (%"SPRIgid")\n",
+                                 state->pwd->pw_gid);
+        /* fall through */
+    case NSS_STATUS_SUCCESS:
+        DEBUG(SSSDBG_CONF_SETTINGS, "User [%s] appears to be member of %u "
+              "groups\n", state->pwd->pw_name, state->initgr->num_gids);
+        break;
+    default:
+        DEBUG(SSSDBG_OP_FAILURE, "proxy -> initgroups_dyn failed (%d)[%s]\n",
+              state->initgr->err, strerror(state->initgr->err));
+        proxy_child_account_finish(req, EIO);
+        return;
+    }
+
+    state->groups = talloc_zero_array(state, struct proxy_child_reply *,
+                                      state->initgr->num_gids);
+    if (state->groups == NULL) {
+        proxy_child_account_finish(req, ENOMEM);
+        return;
+    }
+
+    proxy_child_account_next_group(req);
+}
+
+/* The groups are looked up one after another and stored together with the
+ * user once all of them are known, so that the cache transaction does not
+ * span the lookups. */
+static void proxy_child_account_next_group(struct tevent_req *req)
+{
+    struct proxy_child_account_state *state = tevent_req_data(req,
+                                            struct proxy_child_account_state);
+    struct sysdb_ctx *sysdb = state->dom->sysdb;
+    bool in_transaction = false;
+    uint32_t i;
+    errno_t ret;
+    errno_t sret;
+
+    if (state->group_idx < state->initgr->num_gids) {
+        ret = proxy_child_account_lookup(req, PROXY_ID_CHILD_GETGRGID, NULL,
+                                         state->initgr->gids[state->group_idx],
+                                         proxy_child_account_group_done);
+        if (ret != EOK) {
+            proxy_child_account_finish(req, ret);
+        }
+        return;
+    }
+
+    ret = sysdb_transaction_start(sysdb);
+    if (ret != EOK) {
+        DEBUG(SSSDBG_CRIT_FAILURE, "Failed to start transaction\n");
+        goto done;
+    }
+    in_transaction = true;
+
+    ret = save_user(state->dom, state->pwd, state->real_name, state->i_name);
+    if (ret != EOK) {
+        DEBUG(SSSDBG_OP_FAILURE, "Could not save user\n");
+        goto done;
+    }
+
+    for (i = 0; i < state->initgr->num_gids; i++) {
+        ret = proxy_child_store_group(state->dom, state->initgr->gids[i],
+                                      state->groups[i]);
+        if (ret != EOK) {
+            DEBUG(SSSDBG_OP_FAILURE, "Could not process initgroups\n");
+            goto done;
+        }
+    }
+
+    ret = sysdb_transaction_commit(sysdb);
+    if (ret != EOK) {
+        DEBUG(SSSDBG_OP_FAILURE, "Failed to commit transaction\n");
+        goto done;
+    }
+    in_transaction = false;
+
+done:
+    if (in_transaction) {
+        sret = sysdb_transaction_cancel(sysdb);
+        if (sret != EOK) {
+            DEBUG(SSSDBG_CRIT_FAILURE, "Failed to cancel transaction\n");
+        }
+    }
+    proxy_child_account_finish(req, ret);
+}
+
+static void proxy_child_account_group_done(struct tevent_req *subreq)
+{
+    struct tevent_req *req = tevent_req_callback_data(subreq,
+                                                      struct tevent_req);
+    struct proxy_child_account_state *state = tevent_req_data(req,
+                                            struct proxy_child_account_state);
+    errno_t ret;
+
+    ret = proxy_child_lookup_recv(state->groups, subreq,
+                                  &state->groups[state->group_idx]);
+    talloc_zfree(subreq);
+    if (ret != EOK) {
+        proxy_child_account_finish(req, ret);
+        return;
+    }
+
+    state->group_idx++;
+    proxy_child_account_next_group(req);
+}
+
+static void proxy_child_account_gr_done(struct tevent_req *subreq)
+{
+    struct tevent_req *req = tevent_req_callback_data(subreq,
+                                                      struct tevent_req);
+    struct proxy_child_account_state *state = tevent_req_data(req,
+                                            struct proxy_child_account_state);
+    struct proxy_child_reply *reply;
+    struct ldb_result *cached_grp = NULL;
+    bool delete_group = false;
+    errno_t ret;
+
+    ret = proxy_child_lookup_recv(state, subreq, &reply);
+    talloc_zfree(subreq);
+    if (ret != EOK) {
+        proxy_child_account_finish(req, ret);
+        return;
+    }
+
+    if (state->i_name == NULL) {
+        ret = proxy_child_store_group(state->dom, state->id, reply);
+        proxy_child_account_finish(req, ret);
+        return;
+    }
+
+    ret = handle_getgr_result(reply->status, reply->grp, state->dom,
+                              &delete_group);
+    if (ret != EOK) {
+        DEBUG(SSSDBG_OP_FAILURE,
+              "getgrnam failed [%d]: %s\n", ret, strerror(ret));
+        proxy_child_account_finish(req, ret);
+        return;
+    }
+
+    if (delete_group) {
+        ret = proxy_child_delete_group(state->dom, state->i_name, 0);
+        proxy_child_account_finish(req, ret);
+        return;
+    }
+
+    state->grp = reply->grp;
+
+    /* Canonicalize the group name in case it was actually an alias */
+    if (state->ctx->fast_alias == true) {
+        ret = sysdb_getgrgid(state, state->dom, state->grp->gr_gid,
+                             &cached_grp);
+        if (ret != EOK) {
+            /* Non-fatal, attempt to canonicalize online */
+            DEBUG(SSSDBG_TRACE_FUNC, "Request to cache failed [%d]: %s\n",
+                  ret, strerror(ret));
+        }
+
+        if (ret == EOK && cached_grp->count == 1) {
+            state->real_name = ldb_msg_find_attr_as_string(cached_grp->msgs[0],
+                                                           SYSDB_NAME, NULL);
+            if (!state->real_name) {
+                DEBUG(SSSDBG_MINOR_FAILURE, "Cached group has no name?\n");
+            }
+        }
+    }
+
+    if (state->real_name != NULL) {
+        ret = save_group(state->dom->sysdb, state->dom, state->grp,
+                         state->real_name, state->i_name);
+        proxy_child_account_finish(req, ret);
+        return;
+    }
+
+    ret = proxy_child_account_lookup(req, PROXY_ID_CHILD_GETGRGID, NULL,
+                                     state->grp->gr_gid,
+                                     proxy_child_account_gr_canon_done);
+    if (ret != EOK) {
+        proxy_child_account_finish(req, ret);
+    }
+}
+
+static void proxy_child_account_gr_canon_done(struct tevent_req *subreq)
+{
+    struct tevent_req *req = tevent_req_callback_data(subreq,
+                                                      struct tevent_req);
+    struct proxy_child_account_state *state = tevent_req_data(req,
+                                            struct proxy_child_account_state);
+    struct proxy_child_reply *reply;
+    bool delete_group = false;
+    errno_t ret;
+
+    ret = proxy_child_lookup_recv(state, subreq, &reply);
+    talloc_zfree(subreq);
+    if (ret != EOK) {
+        proxy_child_account_finish(req, ret);
+        return;
+    }
+
+    ret = handle_getgr_result(reply->status, reply->grp, state->dom,
+                              &delete_group);
+    if (ret != EOK) {
+        DEBUG(SSSDBG_OP_FAILURE,
+              "getgrgid failed [%d]: %s\n", ret, strerror(ret));
+        proxy_child_account_finish(req, ret);
+        return;
+    }
+
+    if (delete_group) {
+        ret = proxy_child_delete_group(state->dom, state->i_name,
+                                       state->grp->gr_gid);
+        proxy_child_account_finish(req, ret);
+        return;
+    }
+
+    state->grp = reply->grp;
+    state->real_name = sss_create_internal_fqname(state, state->grp->gr_name,
+                                                  state->dom->name);
+    if (state->real_name == NULL) {
+        proxy_child_account_finish(req, ENOMEM);
+        return;
+    }
+
+    ret = save_group(state->dom->sysdb, state->dom, state->grp,
+                     state->real_name, state->i_name);
+    proxy_child_account_finish(req, ret);
+}
+
+static void proxy_child_account_finish(struct tevent_req *req, errno_t ret)
+{
+    if (ret != EOK) {
+        tevent_req_error(req, ret);
+        return;
+    }
+
+    tevent_req_done(req);
+}
+
+static errno_t proxy_child_account_recv(struct tevent_req *req)
+{
+    TEVENT_REQ_RETURN_ON_ERROR(req);
+
+    return EOK;
+}
+
 /* =Proxy_Id-Functions====================================================*/
 
+static struct dp_reply_std proxy_account_info_reply(struct be_ctx *be_ctx,
+                                                    errno_t ret)
+{
+    struct dp_reply_std reply;
+
+    if (ret) {
+        if (ret == ENXIO) {
+            DEBUG(SSSDBG_OP_FAILURE,
+                  "proxy returned UNAVAIL error, going offline!\n");
+            be_mark_offline(be_ctx);
+        }
+
+        dp_reply_std_set(&reply, DP_ERR_FATAL, ret, NULL);
+        return reply;
+    }
+
+    dp_reply_std_set(&reply, DP_ERR_OK, EOK, NULL);
+    return reply;
+}
+
 static struct dp_reply_std
 proxy_account_info(TALLOC_CTX *mem_ctx,
                    struct proxy_id_ctx *ctx,
@@ -1585,25 +2501,17 @@ proxy_account_info(TALLOC_CTX *mem_ctx,
         return reply;
     }
 
-    if (ret) {
-        if (ret == ENXIO) {
-            DEBUG(SSSDBG_OP_FAILURE,
-                  "proxy returned UNAVAIL error, going offline!\n");
-            be_mark_offline(be_ctx);
-        }
-
-        dp_reply_std_set(&reply, DP_ERR_FATAL, ret, NULL);
-        return reply;
-    }
-
-    dp_reply_std_set(&reply, DP_ERR_OK, EOK, NULL);
-    return reply;
+    return proxy_account_info_reply(be_ctx, ret);
 }
 
 struct proxy_account_info_handler_state {
     struct dp_reply_std reply;
+
+    struct be_ctx *be_ctx;
 };
 
+static void proxy_account_info_handler_done(struct tevent_req *subreq);
+
 struct tevent_req *
 proxy_account_info_handler_send(TALLOC_CTX *mem_ctx,
                                struct proxy_id_ctx *id_ctx,
@@ -1612,6 +2520,7 @@ proxy_account_info_handler_send(TALLOC_CTX *mem_ctx,
 {
     struct proxy_account_info_handler_state *state;
     struct tevent_req *req;
+    struct tevent_req *subreq;
 
     req = tevent_req_create(mem_ctx, &state,
                             struct proxy_account_info_handler_state);
@@ -1620,8 +2529,27 @@ proxy_account_info_handler_send(TALLOC_CTX *mem_ctx,
         return NULL;
     }
 
-    state->reply = proxy_account_info(state, id_ctx, data, params->be_ctx,
-                                      params->be_ctx->domain);
+    state->be_ctx = params->be_ctx;
+
+    /* Lookups the workers can handle never fall back to sssd_be, a slow
+     * NSS module would block it exactly when the workers are busy. */
+    if (proxy_child_account_supported(id_ctx, data)) {
+        subreq = proxy_child_account_send(state, params->ev, id_ctx, data,
+                                          params->be_ctx->domain);
+        if (subreq != NULL) {
+            tevent_req_set_callback(subreq, proxy_account_info_handler_done,
+                                    req);
+            return req;
+        }
+
+        DEBUG(SSSDBG_OP_FAILURE, "Unable to pass the lookup to "
+              "proxy_id_child.\n");
+        state->reply = proxy_account_info_reply(params->be_ctx, ENOMEM);
+    } else {
+        state->reply = proxy_account_info(state, id_ctx, data,
+                                          params->be_ctx,
+                                          params->be_ctx->domain);
+    }
 
     /* TODO For backward compatibility we always return EOK to DP now. */
     tevent_req_done(req);
@@ -1630,6 +2558,31 @@ proxy_account_info_handler_send(TALLOC_CTX *mem_ctx,
     return req;
 }
 
+static void proxy_account_info_handler_done(struct tevent_req *subreq)
+{
+    struct tevent_req *req = tevent_req_callback_data(subreq,
+                                                      struct tevent_req);
+    struct proxy_account_info_handler_state *state = tevent_req_data(req,
+                                     struct proxy_account_info_handler_state);
+    errno_t ret;
+
+    ret = proxy_child_account_recv(subreq);
+    talloc_zfree(subreq);
+    if (ret == EAGAIN) {
+        /* The responders use the cached entry, if any, like for an offline
+         * back end, but the back end stays online. */
+        DEBUG(SSSDBG_MINOR_FAILURE, "All proxy_id_child workers are busy, "
+              "the lookup is not run.\n");
+        dp_reply_std_set(&state->reply, DP_ERR_OFFLINE, ret,
+                         "All proxy_id_child workers are busy");
+    } else {
+        state->reply = proxy_account_info_reply(state->be_ctx, ret);
+    }
+
+    /* TODO For backward compatibility we always return EOK to DP now. */
+    tevent_req_done(req);
+}
+
 errno_t proxy_account_info_handler_recv(TALLOC_CTX *mem_ctx,
                                        struct tevent_req *req,
                                        struct dp_reply_std *data)
@@ -0,0 +1,612 @@
+/*
+    SSSD
+
+    Proxy provider - helper running the lookups of the wrapped NSS module
+
+    Copyright (C) 2016 Red Hat
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <sys/types.h>
+#include <unistd.h>
+#include <popt.h>
+
+#include "util/util.h"
+#include "util/child_common.h"
+#include "providers/proxy/proxy.h"
+
+struct input_buffer {
+    uint32_t cmd;
+    uint32_t id;
+    const char *name;
+};
+
+static errno_t unpack_buffer(uint8_t *buf,
+                             size_t size,
+                             struct input_buffer *ibuf)
+{
+    size_t p = 0;
+    uint32_t len;
+
+    SAFEALIGN_COPY_UINT32_CHECK(&ibuf->cmd, buf + p, size, &p);
+    SAFEALIGN_COPY_UINT32_CHECK(&ibuf->id, buf + p, size, &p);
+
+    SAFEALIGN_COPY_UINT32_CHECK(&len, buf + p, size, &p);
+    if (len > size - p) return EINVAL;
+    ibuf->name = talloc_strndup(ibuf, (char *)(buf + p), len);
+    if (ibuf->name == NULL) return ENOMEM;
+
+    DEBUG(SSSDBG_TRACE_INTERNAL, "command [%"PRIu32"] id [%"PRIu32"] "
+          "name [%s]\n", ibuf->cmd, ibuf->id, ibuf->name);
+
+    return EOK;
+}
+
+/* Reply data is appended to r->buf, r->size is the used length. The
+ * buffer grows in steps, large groups consist of many small strings. */
+static errno_t add_data(struct response *r, const void *data, size_t len)
+{
+    uint8_t *buf;
+    size_t alloc;
+
+    if (r->size + len > SSS_CHILD_POOL_MAX_REPLY) {
+        return ERANGE;
+    }
+
+    alloc = r->buf == NULL ? 0 : talloc_get_size(r->buf);
+    if (r->size + len > alloc) {
+        alloc = 2 * (r->size + len);
+        if (alloc < DEFAULT_BUFSIZE) {
+            alloc = DEFAULT_BUFSIZE;
+        }
+        if (alloc > SSS_CHILD_POOL_MAX_REPLY) {
+            alloc = SSS_CHILD_POOL_MAX_REPLY;
+        }
+
+        buf = talloc_realloc(r, r->buf, uint8_t, alloc);
+        if (buf == NULL) {
+            return ENOMEM;
+        }
+        r->buf = buf;
+    }
+
+    safealign_memcpy(&r->buf[r->size], data, len, &r->size);
+
+    return EOK;
+}
+
+static errno_t add_uint32(struct response *r, uint32_t value)
+{
+    return add_data(r, &value, sizeof(uint32_t));
+}
+
+static errno_t add_string(struct response *r, const char *str)
+{
+    errno_t ret;
+
+    if (str == NULL) {
+        return add_uint32(r, UINT32_MAX);
+    }
+
+    ret = add_uint32(r, strlen(str));
+    if (ret != EOK) {
+        return ret;
+    }
+
+    return add_data(r, str, strlen(str));
+}
+
+static errno_t pack_passwd(struct response *r, struct passwd *pwd)
+{
+    errno_t ret;
+
+    ret = add_string(r, pwd->pw_name);
+    if (ret == EOK) ret = add_string(r, pwd->pw_passwd);
+    if (ret == EOK) ret = add_uint32(r, pwd->pw_uid);
+    if (ret == EOK) ret = add_uint32(r, pwd->pw_gid);
+    if (ret == EOK) ret = add_string(r, pwd->pw_gecos);
+    if (ret == EOK) ret = add_string(r, pwd->pw_dir);
+    if (ret == EOK) ret = add_string(r, pwd->pw_shell);
+
+    return ret;
+}
+
+static errno_t pack_group(struct response *r, struct group *grp)
+{
+    uint32_t num_mem;
+    uint32_t i;
+    errno_t ret;
+
+    for (num_mem = 0;
+         grp->gr_mem != NULL && grp->gr_mem[num_mem] != NULL;
+         num_mem++);
+
+    ret = add_string(r, grp->gr_name);
+    if (ret == EOK) ret = add_string(r, grp->gr_passwd);
+    if (ret == EOK) ret = add_uint32(r, grp->gr_gid);
+    if (ret == EOK) ret = add_uint32(r, num_mem);
+    for (i = 0; ret == EOK && i < num_mem; i++) {
+        ret = add_string(r, grp->gr_mem[i]);
+    }
+
+    return ret;
+}
+
+/* Unlike sssd_be the helper can afford to retry with larger buffers until
+ * the entry fits, only the reply size limits it. */
+static bool grow_buffer(TALLOC_CTX *mem_ctx, enum nss_status status, int err,
+                        char **buffer, size_t *buflen)
+{
+    if (status != NSS_STATUS_TRYAGAIN || err != ERANGE
+            || *buflen >= MAX_BUF_SIZE) {
+        return false;
+    }
+
+    *buflen *= 2;
+    if (*buflen > MAX_BUF_SIZE) {
+        *buflen = MAX_BUF_SIZE;
+    }
+
+    talloc_free(*buffer);
+    *buffer = talloc_size(mem_ctx, *buflen);
+
+    return *buffer != NULL;
+}
+
+static errno_t do_getpw(struct response *r, struct proxy_nss_ops *ops,
+                        struct input_buffer *ibuf)
+{
+    struct passwd pwd;
+    enum nss_status status;
+    char *buffer;
+    size_t buflen = DEFAULT_BUFSIZE;
+    int err;
+    errno_t ret;
+
+    buffer = talloc_size(r, buflen);
+    if (buffer == NULL) {
+        return ENOMEM;
+    }
+
+    do {
+        memset(&pwd, 0, sizeof(struct passwd));
+        err = 0;
+        if (ibuf->cmd == PROXY_ID_CHILD_GETPWNAM) {
+            status = ops->getpwnam_r(ibuf->name, &pwd, buffer, buflen, &err);
+        } else {
+            status = ops->getpwuid_r(ibuf->id, &pwd, buffer, buflen, &err);
+        }
+    } while (grow_buffer(r, status, err, &buffer, &buflen));
+
+    if (buffer == NULL) {
+        return ENOMEM;
+    }
+
+    ret = add_uint32(r, status);
+    if (ret == EOK) ret = add_uint32(r, err);
+    if (ret == EOK && status == NSS_STATUS_SUCCESS) {
+        ret = pack_passwd(r, &pwd);
+    }
+
+    return ret;
+}
+
+static errno_t do_getgr(struct response *r, struct proxy_nss_ops *ops,
+                        struct input_buffer *ibuf)
+{
+    struct group grp;
+    enum nss_status status;
+    char *buffer;
+    size_t buflen = DEFAULT_BUFSIZE;
+    int err;
+    errno_t ret;
+
+    buffer = talloc_size(r, buflen);
+    if (buffer == NULL) {
+        return ENOMEM;
+    }
+
+    do {
+        memset(&grp, 0, sizeof(struct group));
+        err = 0;
+        if (ibuf->cmd == PROXY_ID_CHILD_GETGRNAM) {
+            status = ops->getgrnam_r(ibuf->name, &grp, buffer, buflen, &err);
+        } else {
+            status = ops->getgrgid_r(ibuf->id, &grp, buffer, buflen, &err);
+        }
+    } while (grow_buffer(r, status, err, &buffer, &buflen));
+
+    if (buffer == NULL) {
+        return ENOMEM;
+    }
+
+    ret = add_uint32(r, status);
+    if (ret == EOK) ret = add_uint32(r, err);
+    if (ret == EOK && status == NSS_STATUS_SUCCESS) {
+        ret = pack_group(r, &grp);
+    }
+
+    return ret;
+}
+
+static errno_t do_initgroups(struct response *r, struct proxy_nss_ops *ops,
+                             struct input_buffer *ibuf)
+{
+    enum nss_status status;
+    long int limit;
+    long int size;
+    long int num;
+    long int num_gids;
+    long int i;
+    gid_t *gids;
+    int err = 0;
+    errno_t ret;
+
+    if (ops->initgroups_dyn == NULL) {
+        return ENOSYS;
+    }
+
+    num_gids = 0;
+    limit = 4096;
+    num = 4096;
+    size = num*sizeof(gid_t);
+    gids = talloc_size(r, size);
+    if (!gids) {
+        return ENOMEM;
+    }
+
+    /* nss modules may skip the primary group when we pass it in so always add
+     * it in advance */
+    gids[0] = ibuf->id;
+    num_gids++;
+
+    do {
+        status = ops->initgroups_dyn(ibuf->name, ibuf->id, &num_gids,
+                                     &num, &gids, limit, &err);
+
+        if (status == NSS_STATUS_TRYAGAIN) {
+            /* buffer too small ? */
+            if (size < MAX_BUF_SIZE) {
+                num *= 2;
+                size = num*sizeof(gid_t);
+            }
+            if (size > MAX_BUF_SIZE) {
+                size = MAX_BUF_SIZE;
+                num = size/sizeof(gid_t);
+            }
+            limit = num;
+            gids = talloc_realloc_size(r, gids, size);
+            if (!gids) {
+                return ENOMEM;
+            }
+        }
+    } while(status == NSS_STATUS_TRYAGAIN);
+
+    ret = add_uint32(r, status);
+    if (ret == EOK) ret = add_uint32(r, err);
+    if (ret == EOK
+            && (status == NSS_STATUS_SUCCESS
+                || status == NSS_STATUS_NOTFOUND)) {
+        ret = add_uint32(r, num_gids);
+        for (i = 0; ret == EOK && i < num_gids; i++) {
+            ret = add_uint32(r, gids[i]);
+        }
+    }
+
+    return ret;
+}
+
+static errno_t prepare_response(TALLOC_CTX *mem_ctx,
+                                struct proxy_nss_ops *ops,
+                                struct input_buffer *ibuf,
+                                struct response **rsp)
+{
+    struct response *r;
+    errno_t ret;
+
+    r = talloc_zero(mem_ctx, struct response);
+    if (r == NULL) {
+        return ENOMEM;
+    }
+
+    switch (ibuf->cmd) {
+    case PROXY_ID_CHILD_GETPWNAM:
+    case PROXY_ID_CHILD_GETPWUID:
+        ret = do_getpw(r, ops, ibuf);
+        break;
+    case PROXY_ID_CHILD_GETGRNAM:
+    case PROXY_ID_CHILD_GETGRGID:
+        ret = do_getgr(r, ops, ibuf);
+        break;
+    case PROXY_ID_CHILD_INITGROUPS:
+        ret = do_initgroups(r, ops, ibuf);
+        break;
+    default:
+        DEBUG(SSSDBG_CRIT_FAILURE, "Unknown command [%"PRIu32"].\n",
+              ibuf->cmd);
+        ret = EINVAL;
+        break;
+    }
+
+    if (ret == ERANGE) {
+        DEBUG(SSSDBG_MINOR_FAILURE, "The entry does not fit into a reply.\n");
+        talloc_zfree(r->buf);
+        r->size = 0;
+        ret = add_uint32(r, NSS_STATUS_TRYAGAIN);
+        if (ret == EOK) ret = add_uint32(r, ERANGE);
+    }
+
+    if (ret != EOK) {
+        talloc_free(r);
+        return ret;
+    }
+
+    *rsp = r;
+    DEBUG(SSSDBG_TRACE_ALL, "r->size: %zu\n", r->size);
+    return EOK;
+}
+
+static void *load_symbol(void *handle, const char *libname, const char *name)
+{
+    char *funcname;
+    void *funcptr;
+
+    funcname = talloc_asprintf(NULL, "_nss_%s_%s", libname, name);
+    if (funcname == NULL) {
+        return NULL;
+    }
+
+    funcptr = dlsym(handle, funcname);
+    if (funcptr == NULL) {
+        DEBUG(SSSDBG_MINOR_FAILURE, "Failed to load %s, error: %s.\n",
+              funcname, dlerror());
+    }
+    talloc_free(funcname);
+
+    return funcptr;
+}
+
+static errno_t load_module(const char *libname, struct proxy_nss_ops *ops)
+{
+    char *libpath;
+    void *handle;
+
+    libpath = talloc_asprintf(NULL, "libnss_%s.so.2", libname);
+    if (libpath == NULL) {
+        return ENOMEM;
+    }
+
+    handle = dlopen(libpath, RTLD_NOW);
+    if (handle == NULL) {
+        DEBUG(SSSDBG_FATAL_FAILURE, "Unable to load %s module, "
+              "error: %s\n", libpath, dlerror());
+        talloc_free(libpath);
+        return ELIBACC;
+    }
+    talloc_free(libpath);
+
+    ops->getpwnam_r = load_symbol(handle, libname, "getpwnam_r");
+    ops->getpwuid_r = load_symbol(handle, libname, "getpwuid_r");
+    ops->getgrnam_r = load_symbol(handle, libname, "getgrnam_r");
+    ops->getgrgid_r = load_symbol(handle, libname, "getgrgid_r");
+    ops->initgroups_dyn = load_symbol(handle, libname, "initgroups_dyn");
+
+    if (ops->getpwnam_r == NULL || ops->getpwuid_r == NULL
+            || ops->getgrnam_r == NULL || ops->getgrgid_r == NULL) {
+        return ELIBBAD;
+    }
+
+    return EOK;
+}
+
+static errno_t proxy_id_child_process(TALLOC_CTX *mem_ctx,
+                                      struct proxy_nss_ops *ops,
+                                      uint8_t *buf, size_t len,
+                                      struct response **_resp)
+{
+    struct input_buffer *ibuf;
+    errno_t ret;
+
+    ibuf = talloc_zero(NULL, struct input_buffer);
+    if (ibuf == NULL) {
+        DEBUG(SSSDBG_CRIT_FAILURE, "talloc_zero failed.\n");
+        return ENOMEM;
+    }
+
+    ret = unpack_buffer(buf, len, ibuf);
+    if (ret != EOK) {
+        DEBUG(SSSDBG_CRIT_FAILURE,
+              "unpack_buffer failed.[%d][%s].\n", ret, strerror(ret));
+        goto done;
+    }
+
+    ret = prepare_response(mem_ctx, ops, ibuf, _resp);
+    if (ret != EOK) {
+        DEBUG(SSSDBG_CRIT_FAILURE, "Failed to prepare response buffer.\n");
+        goto done;
+    }
+
+done:
+    talloc_free(ibuf);
+    return ret;
+}
+
+/* The NSS module is loaded once, the worker only runs the lookups */
+static errno_t proxy_id_child_worker_handler(TALLOC_CTX *mem_ctx,
+                                             uint8_t *req_buf,
+                                             uint32_t req_len,
+                                             uint8_t **_reply,
+                                             uint32_t *_reply_len,
+                                             void *pvt)
+{
+    struct proxy_nss_ops *ops = pvt;
+    struct response *resp = NULL;
+    errno_t ret;
+
+    ret = proxy_id_child_process(mem_ctx, ops, req_buf, req_len, &resp);
+    if (ret != EOK) {
+        return ret;
+    }
+
+    *_reply = resp->buf;
+    *_reply_len = resp->size;
+    return EOK;
+}
+
+#ifndef UNIT_TESTING
+int main(int argc, const char *argv[])
+{
+    int opt;
+    poptContext pc;
+    int debug_fd = -1;
+    errno_t ret;
+    TALLOC_CTX *main_ctx = NULL;
+    uint8_t *buf = NULL;
+    ssize_t len = 0;
+    struct response *resp = NULL;
+    struct proxy_nss_ops ops = { 0 };
+    ssize_t written;
+    int worker = 0;
+    char *libname = NULL;
+
+    struct poptOption long_options[] = {
+        POPT_AUTOHELP
+        {"debug-level", 'd', POPT_ARG_INT, &debug_level, 0,
+         _("Debug level"), NULL},
+        {"debug-timestamps", 0, POPT_ARG_INT, &debug_timestamps, 0,
+         _("Add debug timestamps"), NULL},
+        {"debug-microseconds", 0, POPT_ARG_INT, &debug_microseconds, 0,
+         _("Show timestamps with microseconds"), NULL},
+        {"debug-fd", 0, POPT_ARG_INT, &debug_fd, 0,
+         _("An open file descriptor for the debug logs"), NULL},
+        {"debug-to-stderr", 0, POPT_ARG_NONE | POPT_ARGFLAG_DOC_HIDDEN,
+         &debug_to_stderr, 0,
+         _("Send the debug output to stderr directly."), NULL },
+        {"worker", 0, POPT_ARG_NONE, &worker, 0,
+         _("Serve framed requests until the input is closed"), NULL},
+        {"libname", 0, POPT_ARG_STRING, &libname, 0,
+         _("Name of the NSS module"), NULL},
+        POPT_TABLEEND
+    };
+
+    /* Set debug level to invalid value so we can decide if -d 0 was used. */
+    debug_level = SSSDBG_INVALID;
+
+    pc = poptGetContext(argv[0], argc, argv, long_options, 0);
+    while((opt = poptGetNextOpt(pc)) != -1) {
+        switch(opt) {
+        default:
+        fprintf(stderr, "\nInvalid option %s: %s\n\n",
+                  poptBadOption(pc, 0), poptStrerror(opt));
+            poptPrintUsage(pc, stderr, 0);
+            _exit(-1);
+        }
+    }
+
+    if (libname == NULL) {
+        fprintf(stderr, "\nMissing NSS module, --libname must be "
+                        "specified.\n\n");
+        poptPrintUsage(pc, stderr, 0);
+        _exit(-1);
+    }
+
+    poptFreeContext(pc);
+
+    DEBUG_INIT(debug_level);
+
+    debug_prg_name = talloc_asprintf(NULL, "[sssd[proxy_id_child[%d]]]",
+                                     getpid());
+    if (debug_prg_name == NULL) {
+        DEBUG(SSSDBG_CRIT_FAILURE, "talloc_asprintf failed.\n");
+        goto fail;
+    }
+
+    if (debug_fd != -1) {
+        ret = set_debug_file_from_fd(debug_fd);
+        if (ret != EOK) {
+            DEBUG(SSSDBG_CRIT_FAILURE, "set_debug_file_from_fd failed.\n");
+        }
+    }
+
+    DEBUG(SSSDBG_TRACE_FUNC, "proxy_id_child started.\n");
+
+    ret = load_module(libname, &ops);
+    if (ret != EOK) {
+        DEBUG(SSSDBG_FATAL_FAILURE, "Unable to load NSS module [%d]: %s\n",
+              ret, sss_strerror(ret));
+        goto fail;
+    }
+
+    if (worker) {
+        sss_child_worker("proxy_id_child", STDIN_FILENO, STDOUT_FILENO,
+                         proxy_id_child_worker_handler, &ops);
+    }
+
+    main_ctx = talloc_new(NULL);
+    if (main_ctx == NULL) {
+        DEBUG(SSSDBG_CRIT_FAILURE, "talloc_new failed.\n");
+        talloc_free(discard_const(debug_prg_name));
+        goto fail;
+    }
+    talloc_steal(main_ctx, debug_prg_name);
+
+    buf = talloc_size(main_ctx, sizeof(uint8_t)*IN_BUF_SIZE);
+    if (buf == NULL) {
+        DEBUG(SSSDBG_CRIT_FAILURE, "talloc_size failed.\n");
+        goto fail;
+    }
+
+    errno = 0;
+    len = sss_atomic_read_s(STDIN_FILENO, buf, IN_BUF_SIZE);
+    if (len == -1) {
+        ret = errno;
+        DEBUG(SSSDBG_CRIT_FAILURE, "read failed [%d][%s].\n", ret, strerror(ret));
+        goto fail;
+    }
+
+    close(STDIN_FILENO);
+
+    ret = proxy_id_child_process(main_ctx, &ops, buf, len, &resp);
+    if (ret != EOK) {
+        goto fail;
+    }
+
+    errno = 0;
+
+    written = sss_atomic_write_s(STDOUT_FILENO, resp->buf, resp->size);
+    if (written == -1) {
+        ret = errno;
+        DEBUG(SSSDBG_CRIT_FAILURE, "write failed [%d][%s].\n", ret,
+                    strerror(ret));
+        goto fail;
+    }
+
+    if (written != resp->size) {
+        DEBUG(SSSDBG_CRIT_FAILURE, "Expected to write %zu bytes, wrote %zu\n",
+              resp->size, written);
+        goto fail;
+    }
+
+    DEBUG(SSSDBG_TRACE_FUNC, "proxy_id_child completed successfully\n");
+    close(STDOUT_FILENO);
+    talloc_free(main_ctx);
+    return EXIT_SUCCESS;
+fail:
+    DEBUG(SSSDBG_CRIT_FAILURE, "proxy_id_child failed!\n");
+    close(STDOUT_FILENO);
+    talloc_free(main_ctx);
+    return EXIT_FAILURE;
+}
+#endif /* UNIT_TESTING */
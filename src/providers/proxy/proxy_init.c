@@ -310,6 +310,52 @@ errno_t sssm_proxy_init(TALLOC_CTX *mem_ctx,
     return EOK;
 }
 
+static errno_t proxy_id_child_init(struct proxy_id_ctx *ctx,
+                                   struct be_ctx *be_ctx,
+                                   const char *libname)
+{
+    const char *extra_args[3] = { NULL };
+    int pool_size;
+    errno_t ret;
+
+    ret = confdb_get_int(be_ctx->cdb, be_ctx->conf_path,
+                         CONFDB_PROXY_ID_CHILD_POOL_SIZE, 0, &pool_size);
+    if (ret != EOK) {
+        DEBUG(SSSDBG_CRIT_FAILURE, "Unable to read confdb [%d]: %s\n",
+              ret, sss_strerror(ret));
+        return ret;
+    }
+
+    if (pool_size <= 0) {
+        return EOK;
+    }
+
+    ret = child_debug_init(PROXY_ID_CHILD_LOG_FILE, &ctx->child_debug_fd);
+    if (ret != EOK) {
+        return ret;
+    }
+
+    /* extra_args are added in reverse order */
+    extra_args[0] = libname;
+    extra_args[1] = "--libname";
+
+    /* Lookups which find all workers busy and the queue full are answered
+     * as if the back end was offline, they never run in sssd_be. */
+    ret = sss_child_pool_create(ctx, be_ctx->ev, PROXY_ID_CHILD_PATH,
+                                ctx->child_debug_fd, extra_args,
+                                STDIN_FILENO, STDOUT_FILENO, pool_size,
+                                SSS_CHILD_POOL_MAX_JOBS,
+                                PROXY_ID_CHILD_MAX_QUEUED, &ctx->child_pool);
+    if (ret != EOK) {
+        DEBUG(SSSDBG_CRIT_FAILURE,
+              "Cannot create proxy_id_child pool [%d]: %s\n",
+              ret, sss_strerror(ret));
+        return ret;
+    }
+
+    return EOK;
+}
+
 errno_t sssm_proxy_id_init(TALLOC_CTX *mem_ctx,
                            struct be_ctx *be_ctx,
                            void *module_data,
@@ -326,6 +372,7 @@ errno_t sssm_proxy_id_init(TALLOC_CTX *mem_ctx,
     }
 
     ctx->be = be_ctx;
+    ctx->child_debug_fd = -1;
 
     ret = proxy_id_conf(ctx, be_ctx, &libname, &libpath, &ctx->fast_alias);
     if (ret != EOK) {
@@ -347,6 +394,11 @@ errno_t sssm_proxy_id_init(TALLOC_CTX *mem_ctx,
         goto done;
     }
 
+    ret = proxy_id_child_init(ctx, be_ctx, libname);
+    if (ret != EOK) {
+        goto done;
+    }
+
     dp_set_method(dp_methods, DPM_ACCOUNT_HANDLER,
                   proxy_account_info_handler_send, proxy_account_info_handler_recv, ctx,
                   struct proxy_id_ctx, struct dp_id_data, struct dp_reply_std);
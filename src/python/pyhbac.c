@@ -1134,6 +1134,173 @@ fail:
     return NULL;
 }
 
+/* ==================== HBAC Compiled Rules ========================*/
+static void
+free_hbac_rule_list(struct hbac_rule **rules)
+{
+    int i;
+
+    if (!rules) return;
+
+    for(i=0; rules[i]; i++) {
+        free_hbac_rule(rules[i]);
+    }
+    PyMem_Free(rules);
+}
+
+static struct hbac_rule **
+sequence_as_rule_list(PyObject *py_rules_list)
+{
+    PyObject *py_rule = NULL;
+    Py_ssize_t num_rules;
+    struct hbac_rule **rules = NULL;
+    long i;
+
+    if (!PySequence_Check(py_rules_list)) {
+        PyErr_Format(PyExc_TypeError,
+                     "The parameter rules must be a sequence\n");
+        return NULL;
+    }
+
+    num_rules = PySequence_Size(py_rules_list);
+    rules = PyMem_New(struct hbac_rule *, num_rules+1);
+    if (!rules) {
+        PyErr_NoMemory();
+        return NULL;
+    }
+
+    for (i=0; i < num_rules; i++) {
+        rules[i] = NULL;
+
+        py_rule = PySequence_GetItem(py_rules_list, i);
+        if (py_rule == NULL) {
+            goto fail;
+        }
+
+        if (!PyObject_IsInstance(py_rule,
+                                 (PyObject *) &pyhbac_hbacrule_type)) {
+            Py_DECREF(py_rule);
+            PyErr_Format(PyExc_TypeError,
+                         "A rule must be of type HbacRule\n");
+            goto fail;
+        }
+
+        rules[i] = HbacRule_to_native((HbacRuleObject *) py_rule);
+        Py_DECREF(py_rule);
+        if (!rules[i]) {
+            /* Make sure there is at least a generic exception */
+            if (!PyErr_Occurred()) {
+                PyErr_Format(PyExc_IOError,
+                             "Could not convert HbacRule to native type\n");
+            }
+            goto fail;
+        }
+    }
+    rules[num_rules] = NULL;
+
+    return rules;
+
+fail:
+    free_hbac_rule_list(rules);
+    return NULL;
+}
+
+typedef struct {
+    PyObject_HEAD
+
+    struct hbac_rule **rules;
+    struct hbac_compiled_rules *compiled;
+} HbacCompiledRules;
+
+static PyObject *
+HbacCompiledRules_new(PyTypeObject *type, PyObject *args, PyObject *kwds)
+{
+    HbacCompiledRules *self;
+
+    self = (HbacCompiledRules *) type->tp_alloc(type, 0);
+    if (self == NULL) {
+        PyErr_NoMemory();
+        return NULL;
+    }
+
+    self->rules = NULL;
+    self->compiled = NULL;
+
+    return (PyObject *) self;
+}
+
+static void
+HbacCompiledRules_clear(HbacCompiledRules *self)
+{
+    /* The compiled set references the native rules, free it first */
+    hbac_free_compiled_rules(self->compiled);
+    self->compiled = NULL;
+    free_hbac_rule_list(self->rules);
+    self->rules = NULL;
+}
+
+static void
+HbacCompiledRules_dealloc(HbacCompiledRules *self)
+{
+    HbacCompiledRules_clear(self);
+    Py_TYPE(self)->tp_free((PyObject*) self);
+}
+
+static int
+HbacCompiledRules_init(HbacCompiledRules *self,
+                       PyObject *args, PyObject *kwargs)
+{
+    const char * const kwlist[] = { "rules", NULL };
+    PyObject *py_rules_list = NULL;
+    struct hbac_rule **rules;
+    struct hbac_compiled_rules *compiled;
+    enum hbac_error_code code;
+
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs,
+                                     sss_py_const_p(char, "O"),
+                                     discard_const_p(char *, kwlist),
+                                     &py_rules_list)) {
+        return -1;
+    }
+
+    rules = sequence_as_rule_list(py_rules_list);
+    if (rules == NULL) {
+        return -1;
+    }
+
+    code = hbac_compile_rules(rules, &compiled);
+    if (code != HBAC_SUCCESS) {
+        free_hbac_rule_list(rules);
+        PyErr_NoMemory();
+        return -1;
+    }
+
+    HbacCompiledRules_clear(self);
+    self->rules = rules;
+    self->compiled = compiled;
+
+    return 0;
+}
+
+PyDoc_STRVAR(HbacCompiledRules__doc__,
+"IPA HBAC Compiled Rules\n\n"
+"HbacCompiledRules(rules) -> new set of HBAC rules prepared for evaluation\n"
+"rules is a sequence of HbacRule objects. The rules are copied when the\n"
+"object is created, later changes to the HbacRule objects are not\n"
+"reflected. Use HbacRequest.evaluate_compiled() to evaluate a request\n"
+"against the set.");
+
+static PyTypeObject pyhbac_hbaccompiledrules_type = {
+    PyVarObject_HEAD_INIT(NULL, 0)
+    .tp_name = sss_py_const_p(char, "pyhbac.HbacCompiledRules"),
+    .tp_basicsize = sizeof(HbacCompiledRules),
+    .tp_new = HbacCompiledRules_new,
+    .tp_dealloc = (destructor) HbacCompiledRules_dealloc,
+    .tp_init = (initproc) HbacCompiledRules_init,
+    .tp_flags = Py_TPFLAGS_DEFAULT | Py_TPFLAGS_BASETYPE,
+    .tp_doc   = HbacCompiledRules__doc__
+};
+
 /* ==================== HBAC Request Element ========================*/
 typedef struct {
     PyObject_HEAD
@@ -1531,115 +1698,119 @@ static struct hbac_eval_req *
 HbacRequest_to_native(HbacRequest *pyreq);
 
 static void
-free_hbac_rule_list(struct hbac_rule **rules)
-{
-    int i;
+free_hbac_eval_req(struct hbac_eval_req *req);
 
-    if (!rules) return;
+static PyObject *
+hbac_request_set_result(HbacRequest *self,
+                        enum hbac_eval_result eres,
+                        struct hbac_info *info)
+{
+    Py_XDECREF(self->rule_name);
+    self->rule_name = NULL;
 
-    for(i=0; rules[i]; i++) {
-        free_hbac_rule(rules[i]);
+    switch (eres) {
+    case HBAC_EVAL_ALLOW:
+        self->rule_name = PyUnicode_FromString(info->rule_name);
+        if (!self->rule_name) {
+            PyErr_NoMemory();
+            return NULL;
+        }
+        /* FALLTHROUGH */
+    case HBAC_EVAL_DENY:
+        return PYNUMBER_FROMLONG(eres);
+    case HBAC_EVAL_ERROR:
+        set_hbac_exception(PyExc_HbacError, info);
+        return NULL;
+    case HBAC_EVAL_OOM:
+        PyErr_NoMemory();
+        return NULL;
     }
-    PyMem_Free(rules);
-}
 
-static void
-free_hbac_eval_req(struct hbac_eval_req *req);
+    return NULL;
+}
 
 static PyObject *
 py_hbac_evaluate(HbacRequest *self, PyObject *args)
 {
     PyObject *py_rules_list = NULL;
-    PyObject *py_rule = NULL;
-    Py_ssize_t num_rules;
     struct hbac_rule **rules = NULL;
     struct hbac_eval_req *hbac_req = NULL;
     enum hbac_eval_result eres;
     struct hbac_info *info = NULL;
     PyObject *ret = NULL;
-    long i;
 
     if (!PyArg_ParseTuple(args, sss_py_const_p(char, "O"), &py_rules_list)) {
-        goto fail;
+        goto done;
     }
 
-    if (!PySequence_Check(py_rules_list)) {
-        PyErr_Format(PyExc_TypeError,
-                     "The parameter rules must be a sequence\n");
-        goto fail;
-    }
-
-    num_rules = PySequence_Size(py_rules_list);
-    rules = PyMem_New(struct hbac_rule *, num_rules+1);
+    rules = sequence_as_rule_list(py_rules_list);
     if (!rules) {
-        PyErr_NoMemory();
-        goto fail;
+        goto done;
     }
 
-    for (i=0; i < num_rules; i++) {
-        py_rule = PySequence_GetItem(py_rules_list, i);
-
-        if (!PyObject_IsInstance(py_rule,
-                                 (PyObject *) &pyhbac_hbacrule_type)) {
-            PyErr_Format(PyExc_TypeError,
-                         "A rule must be of type HbacRule\n");
-            goto fail;
-        }
-
-        rules[i] = HbacRule_to_native((HbacRuleObject *) py_rule);
-        if (!rules[i]) {
-            /* Make sure there is at least a generic exception */
-            if (!PyErr_Occurred()) {
-                PyErr_Format(PyExc_IOError,
-                             "Could not convert HbacRule to native type\n");
-            }
-            goto fail;
-        }
-    }
-    rules[num_rules] = NULL;
-
     hbac_req = HbacRequest_to_native(self);
     if (!hbac_req) {
         if (!PyErr_Occurred()) {
             PyErr_Format(PyExc_IOError,
                          "Could not convert HbacRequest to native type\n");
         }
-        goto fail;
+        goto done;
     }
 
-    Py_XDECREF(self->rule_name);
-    self->rule_name = NULL;
-
     eres = hbac_evaluate(rules, hbac_req, &info);
-    switch (eres) {
-    case HBAC_EVAL_ALLOW:
-        self->rule_name = PyUnicode_FromString(info->rule_name);
-        if (!self->rule_name) {
-            PyErr_NoMemory();
-            goto fail;
-        }
-        /* FALLTHROUGH */
-    case HBAC_EVAL_DENY:
-        ret = PYNUMBER_FROMLONG(eres);
-        break;
-    case HBAC_EVAL_ERROR:
-        set_hbac_exception(PyExc_HbacError, info);
-        goto fail;
-    case HBAC_EVAL_OOM:
-        PyErr_NoMemory();
-        goto fail;
-    }
+    ret = hbac_request_set_result(self, eres, info);
 
+done:
+    hbac_free_info(info);
     free_hbac_eval_req(hbac_req);
     free_hbac_rule_list(rules);
-    hbac_free_info(info);
     return ret;
+}
 
-fail:
+PyDoc_STRVAR(py_hbac_evaluate_compiled__doc__,
+"evaluate_compiled(compiled) -> int\n\n"
+"Evaluate a set of compiled HBAC rules.\n"
+"compiled is an HbacCompiledRules object. The result and the rule_name\n"
+"attribute are the same as with evaluate() called with the sequence of\n"
+"rules the set was compiled from. Only the rules that may match the\n"
+"request are evaluated, which is faster for large rule sets.\n");
+
+static PyObject *
+py_hbac_evaluate_compiled(HbacRequest *self, PyObject *args)
+{
+    HbacCompiledRules *py_compiled = NULL;
+    struct hbac_eval_req *hbac_req = NULL;
+    enum hbac_eval_result eres;
+    struct hbac_info *info = NULL;
+    PyObject *ret = NULL;
+
+    if (!PyArg_ParseTuple(args, sss_py_const_p(char, "O!"),
+                          &pyhbac_hbaccompiledrules_type, &py_compiled)) {
+        goto done;
+    }
+
+    if (py_compiled->compiled == NULL) {
+        PyErr_Format(PyExc_ValueError,
+                     "The compiled rules were not initialized\n");
+        goto done;
+    }
+
+    hbac_req = HbacRequest_to_native(self);
+    if (!hbac_req) {
+        if (!PyErr_Occurred()) {
+            PyErr_Format(PyExc_IOError,
+                         "Could not convert HbacRequest to native type\n");
+        }
+        goto done;
+    }
+
+    eres = hbac_evaluate_compiled(py_compiled->compiled, hbac_req, &info);
+    ret = hbac_request_set_result(self, eres, info);
+
+done:
     hbac_free_info(info);
     free_hbac_eval_req(hbac_req);
-    free_hbac_rule_list(rules);
-    return NULL;
+    return ret;
 }
 
 static PyObject *
@@ -1713,6 +1884,10 @@ static PyMethodDef py_hbac_request_methods[] = {
       (PyCFunction) py_hbac_evaluate,
       METH_VARARGS, py_hbac_evaluate__doc__
     },
+    { sss_py_const_p(char, "evaluate_compiled"),
+      (PyCFunction) py_hbac_evaluate_compiled,
+      METH_VARARGS, py_hbac_evaluate_compiled__doc__
+    },
     { NULL, NULL, 0, NULL }        /* Sentinel */
 };
 
@@ -1988,6 +2163,7 @@ initpyhbac(void)
     TYPE_READY(m, pyhbac_hbacrule_element_type, "HbacRuleElement");
     TYPE_READY(m, pyhbac_hbacrequest_element_type, "HbacRequestElement");
     TYPE_READY(m, pyhbac_hbacrequest_type, "HbacRequest");
+    TYPE_READY(m, pyhbac_hbaccompiledrules_type, "HbacCompiledRules");
 
 #ifdef IS_PY3K
     return m;
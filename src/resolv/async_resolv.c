@@ -61,6 +61,11 @@
 
 #define RESOLV_TIMEOUTMS  2000
 
+/* How long a failed lookup is remembered, in seconds */
+#define RESOLV_CACHE_NEGATIVE_TTL 15
+/* Maximum number of names kept in the cache */
+#define RESOLV_CACHE_MAX_ENTRIES 512
+
 enum host_database default_host_dbs[] = { DB_FILES, DB_DNS, DB_SENTINEL };
 
 struct fd_watch {
@@ -86,6 +91,28 @@ struct resolv_ctx {
      * if our pending requests didn't timeout. */
     int pending_requests;
     struct tevent_timer *timeout_watcher;
+
+    /* Answers of recent DNS queries, most recently used first. The cache
+     * is disabled if cache_max_ttl is 0. */
+    struct resolv_cache_entry *cache;
+    size_t cache_entries;
+    uint32_t cache_max_ttl;
+    struct resolv_cache_stats cache_stats;
+};
+
+struct resolv_cache_entry {
+    struct resolv_cache_entry *prev;
+    struct resolv_cache_entry *next;
+
+    /* ns_t_a, ns_t_aaaa or ns_t_srv */
+    int type;
+    char *name;
+    time_t expire;
+
+    /* c-ares status, the entry is negative if it is not ARES_SUCCESS */
+    int status;
+    struct resolv_hostent *rhostent;
+    struct ares_srv_reply *reply_list;
 };
 
 struct request_watch {
@@ -391,6 +418,9 @@ fd_event_close(struct resolv_ctx *ctx, int s)
     }
 }
 
+static void
+resolv_cache_flush(struct resolv_ctx *ctx);
+
 static int
 resolv_ctx_destructor(struct resolv_ctx *ctx)
 {
@@ -489,6 +519,9 @@ void
 resolv_reread_configuration(struct resolv_ctx *ctx)
 {
     recreate_ares_channel(ctx);
+
+    /* The answers might come from different servers now */
+    resolv_cache_flush(ctx);
 }
 
 static errno_t
@@ -663,6 +696,297 @@ fail:
     return NULL;
 }
 
+/*******************************************************************
+ * Cache of DNS answers                                            *
+ *******************************************************************/
+
+static struct resolv_hostent *
+resolv_cache_copy_hostent(TALLOC_CTX *mem_ctx, struct resolv_hostent *src,
+                          uint32_t ttl)
+{
+    struct resolv_hostent *ret;
+    size_t addrlen;
+    int len;
+    int i;
+
+    addrlen = src->family == AF_INET6 ? sizeof(struct in6_addr)
+                                      : sizeof(struct in_addr);
+
+    ret = talloc_zero(mem_ctx, struct resolv_hostent);
+    if (ret == NULL) {
+        return NULL;
+    }
+
+    ret->family = src->family;
+
+    ret->name = talloc_strdup(ret, src->name);
+    if (ret->name == NULL) {
+        goto fail;
+    }
+
+    if (src->aliases != NULL) {
+        for (len = 0; src->aliases[len] != NULL; len++);
+
+        ret->aliases = talloc_zero_array(ret, char *, len + 1);
+        if (ret->aliases == NULL) {
+            goto fail;
+        }
+
+        for (i = 0; i < len; i++) {
+            ret->aliases[i] = talloc_strdup(ret->aliases, src->aliases[i]);
+            if (ret->aliases[i] == NULL) {
+                goto fail;
+            }
+        }
+    }
+
+    if (src->addr_list != NULL) {
+        for (len = 0; src->addr_list[len] != NULL; len++);
+
+        ret->addr_list = talloc_zero_array(ret, struct resolv_addr *, len + 1);
+        if (ret->addr_list == NULL) {
+            goto fail;
+        }
+
+        for (i = 0; i < len; i++) {
+            ret->addr_list[i] = talloc_zero(ret->addr_list,
+                                            struct resolv_addr);
+            if (ret->addr_list[i] == NULL) {
+                goto fail;
+            }
+
+            ret->addr_list[i]->ipaddr = talloc_memdup(ret->addr_list[i],
+                                                  src->addr_list[i]->ipaddr,
+                                                  addrlen);
+            if (ret->addr_list[i]->ipaddr == NULL) {
+                goto fail;
+            }
+
+            ret->addr_list[i]->ttl = MIN(src->addr_list[i]->ttl, ttl);
+        }
+    }
+
+    return ret;
+
+fail:
+    talloc_free(ret);
+    return NULL;
+}
+
+static struct ares_srv_reply *
+resolv_cache_copy_srv_reply(TALLOC_CTX *mem_ctx, struct ares_srv_reply *src)
+{
+    struct ares_srv_reply *list = NULL;
+    struct ares_srv_reply *last = NULL;
+    struct ares_srv_reply *ptr;
+
+    for (; src != NULL; src = src->next) {
+        ptr = talloc_zero(list == NULL ? mem_ctx : (void *) list,
+                          struct ares_srv_reply);
+        if (ptr == NULL) {
+            talloc_free(list);
+            return NULL;
+        }
+
+        ptr->priority = src->priority;
+        ptr->weight = src->weight;
+        ptr->port = src->port;
+        ptr->host = talloc_strdup(ptr, src->host);
+        if (ptr->host == NULL) {
+            talloc_free(list);
+            return NULL;
+        }
+
+        if (last == NULL) {
+            list = ptr;
+        } else {
+            last->next = ptr;
+        }
+        last = ptr;
+    }
+
+    return list;
+}
+
+static void
+resolv_cache_remove(struct resolv_ctx *ctx, struct resolv_cache_entry *entry)
+{
+    DLIST_REMOVE(ctx->cache, entry);
+    ctx->cache_entries--;
+    talloc_free(entry);
+}
+
+static void
+resolv_cache_flush(struct resolv_ctx *ctx)
+{
+    while (ctx->cache != NULL) {
+        resolv_cache_remove(ctx, ctx->cache);
+    }
+}
+
+/* Returns a valid cache entry or NULL and updates the hit counters. */
+static struct resolv_cache_entry *
+resolv_cache_get(struct resolv_ctx *ctx, int type, const char *name)
+{
+    struct resolv_cache_entry *entry;
+    struct resolv_cache_entry *next;
+    time_t now;
+
+    if (ctx->cache_max_ttl == 0) {
+        return NULL;
+    }
+
+    now = time(NULL);
+    for (entry = ctx->cache; entry != NULL; entry = next) {
+        next = entry->next;
+
+        if (entry->expire <= now) {
+            resolv_cache_remove(ctx, entry);
+            continue;
+        }
+
+        if (entry->type == type && strcasecmp(entry->name, name) == 0) {
+            break;
+        }
+    }
+
+    if (entry == NULL) {
+        ctx->cache_stats.misses++;
+        return NULL;
+    }
+
+    if (entry->status == ARES_SUCCESS) {
+        ctx->cache_stats.hits++;
+    } else {
+        ctx->cache_stats.negative_hits++;
+    }
+
+    DLIST_PROMOTE(ctx->cache, entry);
+
+    DEBUG(SSSDBG_TRACE_LIBS, "Using cached %s answer for '%s'\n",
+          entry->status == ARES_SUCCESS ? "positive" : "negative", name);
+
+    return entry;
+}
+
+static uint32_t
+resolv_cache_ttl(struct resolv_cache_entry *entry)
+{
+    time_t now = time(NULL);
+
+    return entry->expire > now ? entry->expire - now : 0;
+}
+
+/* Stores either rhostent, reply_list or a negative answer if both are NULL */
+static void
+resolv_cache_add(struct resolv_ctx *ctx, int type, const char *name,
+                 int status, uint32_t ttl,
+                 struct resolv_hostent *rhostent,
+                 struct ares_srv_reply *reply_list)
+{
+    struct resolv_cache_entry *entry;
+    struct resolv_cache_entry *last;
+
+    if (ctx->cache_max_ttl == 0) {
+        return;
+    }
+
+    ttl = MIN(ttl, ctx->cache_max_ttl);
+    if (ttl == 0) {
+        return;
+    }
+
+    for (entry = ctx->cache; entry != NULL; entry = entry->next) {
+        if (entry->type == type && strcasecmp(entry->name, name) == 0) {
+            resolv_cache_remove(ctx, entry);
+            break;
+        }
+    }
+
+    entry = talloc_zero(ctx, struct resolv_cache_entry);
+    if (entry == NULL) {
+        return;
+    }
+
+    entry->type = type;
+    entry->status = status;
+    entry->expire = time(NULL) + ttl;
+
+    entry->name = talloc_strdup(entry, name);
+    if (entry->name == NULL) {
+        goto fail;
+    }
+
+    if (rhostent != NULL) {
+        entry->rhostent = resolv_cache_copy_hostent(entry, rhostent, ttl);
+        if (entry->rhostent == NULL) {
+            goto fail;
+        }
+    }
+
+    if (reply_list != NULL) {
+        entry->reply_list = resolv_cache_copy_srv_reply(entry, reply_list);
+        if (entry->reply_list == NULL) {
+            goto fail;
+        }
+    }
+
+    DLIST_ADD(ctx->cache, entry);
+    ctx->cache_entries++;
+
+    if (ctx->cache_entries > RESOLV_CACHE_MAX_ENTRIES) {
+        for (last = ctx->cache; last->next != NULL; last = last->next);
+        resolv_cache_remove(ctx, last);
+    }
+
+    return;
+
+fail:
+    DEBUG(SSSDBG_MINOR_FAILURE, "Unable to cache answer for '%s'\n", name);
+    talloc_free(entry);
+}
+
+static uint32_t
+resolv_hostent_ttl(struct resolv_hostent *rhostent)
+{
+    uint32_t ttl = RESOLV_DEFAULT_TTL;
+    int i;
+
+    if (rhostent->addr_list == NULL) {
+        return 0;
+    }
+
+    for (i = 0; rhostent->addr_list[i] != NULL; i++) {
+        if (rhostent->addr_list[i]->ttl < 0) {
+            return 0;
+        }
+
+        if (i == 0 || (uint32_t) rhostent->addr_list[i]->ttl < ttl) {
+            ttl = rhostent->addr_list[i]->ttl;
+        }
+    }
+
+    return ttl;
+}
+
+void
+resolv_set_cache_max_ttl(struct resolv_ctx *ctx, uint32_t max_ttl)
+{
+    ctx->cache_max_ttl = max_ttl;
+
+    if (max_ttl == 0) {
+        resolv_cache_flush(ctx);
+    }
+}
+
+void
+resolv_get_cache_stats(struct resolv_ctx *ctx,
+                       struct resolv_cache_stats *stats)
+{
+    *stats = ctx->cache_stats;
+    stats->entries = ctx->cache_entries;
+}
+
 /* =================== Resolve host name in files =========================*/
 struct gethostbyname_files_state {
     struct resolv_ctx *resolv_ctx;
@@ -792,6 +1116,7 @@ resolv_gethostbyname_dns_send(TALLOC_CTX *mem_ctx, struct tevent_context *ev,
 {
     struct tevent_req *req, *subreq;
     struct gethostbyname_dns_state *state;
+    struct resolv_cache_entry *entry;
     struct timeval tv = { 0, 0 };
 
     if (ctx->channel == NULL) {
@@ -814,6 +1139,28 @@ resolv_gethostbyname_dns_send(TALLOC_CTX *mem_ctx, struct tevent_context *ev,
     state->retrying = 0;
     state->family = family;
 
+    entry = resolv_cache_get(ctx, family == AF_INET ? ns_t_a : ns_t_aaaa,
+                             name);
+    if (entry != NULL) {
+        state->status = entry->status;
+        if (entry->status != ARES_SUCCESS) {
+            tevent_req_error(req, ENOENT);
+            tevent_req_post(req, ev);
+            return req;
+        }
+
+        state->rhostent = resolv_cache_copy_hostent(state, entry->rhostent,
+                                                    resolv_cache_ttl(entry));
+        if (state->rhostent == NULL) {
+            talloc_zfree(req);
+            return NULL;
+        }
+
+        tevent_req_done(req);
+        tevent_req_post(req, ev);
+        return req;
+    }
+
     /* We need to have a wrapper around ares async calls, because
      * they can in some cases call it's callback immediately.
      * This would not let our caller to set a callback for req. */
@@ -910,6 +1257,11 @@ resolv_gethostbyname_dns_query_done(void *arg, int status, int timeouts,
     }
 
     if (status == ARES_ENOTFOUND || status == ARES_ENODATA) {
+        resolv_cache_add(state->resolv_ctx,
+                         state->family == AF_INET ? ns_t_a : ns_t_aaaa,
+                         state->name, status, RESOLV_CACHE_NEGATIVE_TTL,
+                         NULL, NULL);
+
         /* Just say we didn't find anything and let the caller decide
          * about retrying */
         tevent_req_error(req, ENOENT);
@@ -930,6 +1282,14 @@ resolv_gethostbyname_dns_query_done(void *arg, int status, int timeouts,
         return;
     }
 
+    if (state->rhostent != NULL) {
+        resolv_cache_add(state->resolv_ctx,
+                         state->family == AF_INET ? ns_t_a : ns_t_aaaa,
+                         state->name, status,
+                         resolv_hostent_ttl(state->rhostent),
+                         state->rhostent, NULL);
+    }
+
     tevent_req_done(req);
 }
 
@@ -1030,6 +1390,130 @@ resolv_gethostbyname_dns_recv(struct tevent_req *req, TALLOC_CTX *mem_ctx,
     return EOK;
 }
 
+/* Queries both address families at once, the answer for the preferred
+ * family wins if there is any. */
+struct gethostbyname_dns_parallel_state {
+    struct tevent_req *subreq[2];
+    int family[2];
+    errno_t ret[2];
+    bool done[2];
+    struct resolv_hostent *rhostent[2];
+    int status[2];
+    int timeouts[2];
+
+    /* index of the answer that is returned */
+    int result;
+};
+
+static void
+resolv_gethostbyname_dns_parallel_done(struct tevent_req *subreq);
+
+static struct tevent_req *
+resolv_gethostbyname_dns_parallel_send(TALLOC_CTX *mem_ctx,
+                                       struct tevent_context *ev,
+                                       struct resolv_ctx *ctx,
+                                       const char *name,
+                                       int family,
+                                       int second_family)
+{
+    struct tevent_req *req;
+    struct gethostbyname_dns_parallel_state *state;
+    int i;
+
+    req = tevent_req_create(mem_ctx, &state,
+                            struct gethostbyname_dns_parallel_state);
+    if (req == NULL) {
+        return NULL;
+    }
+
+    state->family[0] = family;
+    state->family[1] = second_family;
+    state->result = 0;
+
+    for (i = 0; i < 2; i++) {
+        state->subreq[i] = resolv_gethostbyname_dns_send(state, ev, ctx, name,
+                                                         state->family[i]);
+        if (state->subreq[i] == NULL) {
+            talloc_zfree(req);
+            return NULL;
+        }
+
+        tevent_req_set_callback(state->subreq[i],
+                                resolv_gethostbyname_dns_parallel_done, req);
+    }
+
+    return req;
+}
+
+static void
+resolv_gethostbyname_dns_parallel_done(struct tevent_req *subreq)
+{
+    struct tevent_req *req = tevent_req_callback_data(subreq,
+                                                      struct tevent_req);
+    struct gethostbyname_dns_parallel_state *state = tevent_req_data(req,
+                                struct gethostbyname_dns_parallel_state);
+    int i;
+
+    i = subreq == state->subreq[0] ? 0 : 1;
+
+    state->ret[i] = resolv_gethostbyname_dns_recv(subreq, state,
+                                                  &state->status[i],
+                                                  &state->timeouts[i],
+                                                  &state->rhostent[i]);
+    talloc_zfree(subreq);
+    state->subreq[i] = NULL;
+    state->done[i] = true;
+
+    if (!state->done[0]) {
+        /* The preferred family did not answer yet */
+        return;
+    }
+
+    if (state->ret[0] != ENOENT) {
+        /* Either success or an error that is not worth a fallback */
+        talloc_zfree(state->subreq[1]);
+        state->result = 0;
+    } else if (state->done[1]) {
+        state->result = 1;
+    } else {
+        return;
+    }
+
+    if (state->ret[state->result] != EOK) {
+        tevent_req_error(req, state->ret[state->result]);
+        return;
+    }
+
+    tevent_req_done(req);
+}
+
+static int
+resolv_gethostbyname_dns_parallel_recv(struct tevent_req *req,
+                                       TALLOC_CTX *mem_ctx,
+                                       int *status, int *timeouts,
+                                       struct resolv_hostent **rhostent)
+{
+    struct gethostbyname_dns_parallel_state *state = tevent_req_data(req,
+                                struct gethostbyname_dns_parallel_state);
+
+    /* Fill in even in case of error as status contains the
+     * c-ares return code */
+    if (status) {
+        *status = state->status[state->result];
+    }
+    if (timeouts) {
+        *timeouts = state->timeouts[state->result];
+    }
+
+    TEVENT_REQ_RETURN_ON_ERROR(req);
+
+    if (rhostent) {
+        *rhostent = talloc_steal(mem_ctx, state->rhostent[state->result]);
+    }
+
+    return EOK;
+}
+
 /*******************************************************************
  * Get host by name.                                               *
  *******************************************************************/
@@ -1049,6 +1533,9 @@ struct gethostbyname_state {
     enum host_database *db;
     int dbi;
 
+    /* Both address families are queried at once in DNS */
+    bool dns_parallel;
+
     /* These are returned by ares. The hostent struct will be freed
      * when the user callback returns. */
     struct resolv_hostent *rhostent;
@@ -1290,6 +1777,19 @@ resolv_gethostbyname_step(struct tevent_req *req)
             break;
         case DB_DNS:
             DEBUG(SSSDBG_TRACE_INTERNAL, "Querying DNS\n");
+            state->dns_parallel = (state->family_order == IPV4_FIRST
+                                   || state->family_order == IPV6_FIRST)
+                && state->family == resolv_gethostbyname_family_init(
+                                                        state->family_order);
+            if (state->dns_parallel) {
+                subreq = resolv_gethostbyname_dns_parallel_send(state,
+                                        state->ev, state->resolv_ctx,
+                                        state->name, state->family,
+                                        state->family == AF_INET ? AF_INET6
+                                                                 : AF_INET);
+                break;
+            }
+
             subreq = resolv_gethostbyname_dns_send(state, state->ev,
                                                    state->resolv_ctx,
                                                    state->name,
@@ -1326,6 +1826,19 @@ resolv_gethostbyname_done(struct tevent_req *subreq)
             state->timeouts = 0;
             break;
         case DB_DNS:
+            if (state->dns_parallel) {
+                ret = resolv_gethostbyname_dns_parallel_recv(subreq, state,
+                                                    &state->status,
+                                                    &state->timeouts,
+                                                    &state->rhostent);
+                if (ret == ENOENT) {
+                    /* both families were tried */
+                    state->family = state->family == AF_INET ? AF_INET6
+                                                             : AF_INET;
+                }
+                break;
+            }
+
             ret = resolv_gethostbyname_dns_recv(subreq, state,
                                                 &state->status, &state->timeouts,
                                                 &state->rhostent);
@@ -1582,6 +2095,7 @@ resolv_getsrv_send(TALLOC_CTX *mem_ctx, struct tevent_context *ev,
 {
     struct tevent_req *req, *subreq;
     struct getsrv_state *state;
+    struct resolv_cache_entry *entry;
     struct timeval tv = { 0, 0 };
 
     DEBUG(SSSDBG_CONF_SETTINGS,
@@ -1606,6 +2120,28 @@ resolv_getsrv_send(TALLOC_CTX *mem_ctx, struct tevent_context *ev,
     state->retrying = 0;
     state->ev = ev;
 
+    entry = resolv_cache_get(ctx, ns_t_srv, query);
+    if (entry != NULL) {
+        state->status = entry->status;
+        if (entry->status != ARES_SUCCESS) {
+            tevent_req_error(req, return_code(entry->status));
+            tevent_req_post(req, ev);
+            return req;
+        }
+
+        state->reply_list = resolv_cache_copy_srv_reply(state,
+                                                        entry->reply_list);
+        if (state->reply_list == NULL) {
+            talloc_zfree(req);
+            return NULL;
+        }
+
+        state->ttl = resolv_cache_ttl(entry);
+        tevent_req_done(req);
+        tevent_req_post(req, ev);
+        return req;
+    }
+
     subreq = tevent_wakeup_send(req, ev, tv);
     if (subreq == NULL) {
         DEBUG(SSSDBG_CRIT_FAILURE,
@@ -1735,6 +2271,11 @@ resolv_getsrv_done(void *arg, int status, int timeouts, unsigned char *abuf, int
     state->status = status;
     state->timeouts = timeouts;
 
+    if (status == ARES_ENOTFOUND || status == ARES_ENODATA) {
+        resolv_cache_add(state->resolv_ctx, ns_t_srv, state->query, status,
+                         RESOLV_CACHE_NEGATIVE_TTL, NULL, NULL);
+    }
+
     if (status != ARES_SUCCESS) {
         ret = return_code(status);
         goto fail;
@@ -1759,6 +2300,9 @@ resolv_getsrv_done(void *arg, int status, int timeouts, unsigned char *abuf, int
     }
     DEBUG(SSSDBG_TRACE_LIBS, "Using TTL [%"PRIu32"]\n", state->ttl);
 
+    resolv_cache_add(state->resolv_ctx, ns_t_srv, state->query, status,
+                     state->ttl, NULL, state->reply_list);
+
     tevent_req_done(req);
     return;
 
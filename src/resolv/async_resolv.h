@@ -56,6 +56,23 @@ int resolv_init(TALLOC_CTX *mem_ctx, struct tevent_context *ev_ctx,
 
 void resolv_reread_configuration(struct resolv_ctx *ctx);
 
+/*
+ * Answers of A, AAAA and SRV queries, including negative ones, are cached
+ * for their TTL, but at most for max_ttl seconds. The cache is disabled
+ * by default, max_ttl of 0 disables it again.
+ */
+void resolv_set_cache_max_ttl(struct resolv_ctx *ctx, uint32_t max_ttl);
+
+struct resolv_cache_stats {
+    uint64_t hits;
+    uint64_t negative_hits;
+    uint64_t misses;
+    uint32_t entries;
+};
+
+void resolv_get_cache_stats(struct resolv_ctx *ctx,
+                            struct resolv_cache_stats *stats);
+
 const char *resolv_strerror(int ares_code);
 
 struct resolv_hostent *
@@ -42,6 +42,7 @@ struct mon_cli_iface monitor_autofs_methods = {
     .clearMemcache = NULL,
     .clearEnumCache = autofs_clean_hash_table,
     .sysbusReconnect = NULL,
+    .perfStats = monitor_common_perf_stats,
 };
 
 static errno_t
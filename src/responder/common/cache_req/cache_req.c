@@ -23,6 +23,8 @@
 #include <tevent.h>
 
 #include "util/util.h"
+#include "util/sss_trace.h"
+#include "util/probes.h"
 #include "responder/common/cache_req/cache_req_private.h"
 #include "responder/common/cache_req/cache_req_plugin.h"
 
@@ -95,6 +97,7 @@ cache_req_create(TALLOC_CTX *mem_ctx,
     cr->ncache = ncache;
     cr->midpoint = midpoint;
     cr->req_start = time(NULL);
+    cr->trace_id = sss_trace_current();
 
     /* It is perfectly fine to just overflow here. */
     cr->reqid = rctx->cache_req_num++;
@@ -303,6 +306,8 @@ struct tevent_req *cache_req_send(TALLOC_CTX *mem_ctx,
     }
 
     CACHE_REQ_DEBUG(SSSDBG_TRACE_FUNC, cr, "New request\n");
+    PROBE(CACHE_REQ_SEND, cr->reqid, cr->reqname,
+          PROBE_SAFE_STR(cr->data->name.input));
 
     ret = cache_req_process_input(state, req, cr, domain);
     if (ret != EOK) {
@@ -492,6 +497,8 @@ static void cache_req_done(struct tevent_req *subreq)
     talloc_zfree(subreq);
     if (ret == EOK) {
         CACHE_REQ_DEBUG(SSSDBG_TRACE_FUNC, state->cr, "Finished: Success\n");
+        PROBE(CACHE_REQ_DONE, state->cr->reqid, state->cr->reqname,
+              state->cr->debugobj, ret);
         tevent_req_done(req);
         return;
     }
@@ -504,6 +511,8 @@ static void cache_req_done(struct tevent_req *subreq)
         }
 
         CACHE_REQ_DEBUG(SSSDBG_TRACE_FUNC, state->cr, "Finished: Not found\n");
+        PROBE(CACHE_REQ_DONE, state->cr->reqid, state->cr->reqname,
+              state->cr->debugobj, ret);
         tevent_req_error(req, ret);
         return;
     }
@@ -512,6 +521,8 @@ static void cache_req_done(struct tevent_req *subreq)
     if (ret != EAGAIN) {
         CACHE_REQ_DEBUG(SSSDBG_TRACE_FUNC, state->cr,
                         "Finished: Error %d: %s\n", ret, sss_strerror(ret));
+        PROBE(CACHE_REQ_DONE, state->cr->reqid, state->cr->reqname,
+              state->cr->debugobj, ret);
         tevent_req_error(req, ret);
     }
 
@@ -51,6 +51,7 @@ struct cache_req {
     uint32_t reqid;
     const char *reqname;
     const char *debugobj;
+    uint64_t trace_id;
 
     /* Time when the request started. Useful for by-filter lookups */
     time_t req_start;
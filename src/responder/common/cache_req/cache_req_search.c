@@ -23,6 +23,8 @@
 #include <tevent.h>
 
 #include "util/util.h"
+#include "util/sss_trace.h"
+#include "util/probes.h"
 #include "responder/common/cache_req/cache_req_private.h"
 #include "responder/common/cache_req/cache_req_plugin.h"
 
@@ -41,6 +43,8 @@ static errno_t cache_req_search_ncache(struct cache_req *cr)
                     cr->debugobj);
 
     ret = cr->plugin->ncache_check_fn(cr->ncache, cr->domain, cr->data);
+    PROBE(CACHE_REQ_NCACHE_CHECK, cr->reqid, cr->domain->name,
+          cr->debugobj, ret == EEXIST);
     if (ret == EEXIST) {
         CACHE_REQ_DEBUG(SSSDBG_TRACE_FUNC, cr,
                         "[%s] does not exist (negative cache)\n",
@@ -89,6 +93,7 @@ static errno_t cache_req_search_cache(TALLOC_CTX *mem_ctx,
                                       struct ldb_result **_result)
 {
     struct ldb_result *result = NULL;
+    struct timeval start;
     errno_t ret;
 
     if (cr->plugin->lookup_fn == NULL) {
@@ -101,10 +106,16 @@ static errno_t cache_req_search_cache(TALLOC_CTX *mem_ctx,
                     "Looking up [%s] in cache\n",
                     cr->debugobj);
 
+    PROBE(CACHE_REQ_CACHE_LOOKUP_PRE, cr->reqid, cr->domain->name,
+          cr->debugobj);
+    start = tevent_timeval_current();
     ret = cr->plugin->lookup_fn(mem_ctx, cr, cr->data, cr->domain, &result);
+    sss_trace_span(cr->trace_id, SSS_TRACE_CACHE, &start);
     if (ret == EOK && (result == NULL || result->count == 0)) {
         ret = ENOENT;
     }
+    PROBE(CACHE_REQ_CACHE_LOOKUP_POST, cr->reqid, cr->domain->name,
+          cr->debugobj, ret);
 
     switch (ret) {
     case EOK:
@@ -227,6 +238,7 @@ struct cache_req_search_state {
     struct tevent_context *ev;
     struct resp_ctx *rctx;
     struct cache_req *cr;
+    struct timeval dp_start;
 
     /* output data */
     struct ldb_result *result;
@@ -300,6 +312,7 @@ static errno_t cache_req_search_dp(struct tevent_req *req,
     const char *extra_flag;
     const char *search_str;
     uint32_t search_id;
+    uint64_t prev_trace_id;
     errno_t ret;
 
     state = tevent_req_data(req, struct cache_req_search_state);
@@ -319,11 +332,15 @@ static errno_t cache_req_search_dp(struct tevent_req *req,
         CACHE_REQ_DEBUG(SSSDBG_TRACE_FUNC, state->cr,
                         "Performing midpoint cache update of [%s]\n",
                         state->cr->debugobj);
+        PROBE(CACHE_REQ_DP_SEND, state->cr->reqid, state->cr->domain->name,
+              state->cr->debugobj, 1);
 
+        prev_trace_id = sss_trace_set_current(state->cr->trace_id);
         subreq = sss_dp_get_account_send(state->cr->rctx, state->cr->rctx,
                                          state->cr->domain, true,
                                          state->cr->dp_type,
                                          search_str, search_id, extra_flag);
+        sss_trace_set_current(prev_trace_id);
         if (subreq == NULL) {
             DEBUG(SSSDBG_CRIT_FAILURE, "Out of memory sending out-of-band "
                                        "data provider request\n");
@@ -338,11 +355,16 @@ static errno_t cache_req_search_dp(struct tevent_req *req,
         CACHE_REQ_DEBUG(SSSDBG_TRACE_FUNC, state->cr,
                         "Looking up [%s] in data provider\n",
                         state->cr->debugobj);
+        PROBE(CACHE_REQ_DP_SEND, state->cr->reqid, state->cr->domain->name,
+              state->cr->debugobj, 0);
 
+        state->dp_start = tevent_timeval_current();
+        prev_trace_id = sss_trace_set_current(state->cr->trace_id);
         subreq = sss_dp_get_account_send(state, state->cr->rctx,
                                          state->cr->domain, true,
                                          state->cr->dp_type,
                                          search_str, search_id, extra_flag);
+        sss_trace_set_current(prev_trace_id);
         if (subreq == NULL) {
             DEBUG(SSSDBG_CRIT_FAILURE,
                   "Out of memory sending data provider request\n");
@@ -376,6 +398,9 @@ static void cache_req_search_done(struct tevent_req *subreq)
     req = tevent_req_callback_data(subreq, struct tevent_req);
     state = tevent_req_data(req, struct cache_req_search_state);
 
+    sss_trace_span(state->cr->trace_id, SSS_TRACE_DP_WAIT, &state->dp_start);
+    PROBE(CACHE_REQ_DP_RECV, state->cr->reqid, state->cr->domain->name,
+          state->cr->debugobj);
     cache_req_search_process_dp(state, subreq, state->cr);
 
     /* Get result from cache again. */
@@ -0,0 +1,540 @@
+/*
+   SSSD
+
+   Responder - cache of certificate validation results
+
+   Copyright (C) 2016 Red Hat
+
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <time.h>
+#include <talloc.h>
+#include <tevent.h>
+#include <dhash.h>
+
+#include "util/util.h"
+#include "util/cert.h"
+#include "util/crypto/sss_crypto.h"
+#include "responder/common/cert_cache.h"
+
+struct sss_cert_cache_entry {
+    struct sss_cert_cache_entry *prev;
+    struct sss_cert_cache_entry *next;
+
+    struct sss_cert_cache *cache;
+    char *digest;
+    uint8_t *der_blob;
+    size_t der_size;
+
+    errno_t result;
+    uint8_t *key;
+    size_t key_size;
+    time_t expire;
+
+    /* whether the result was used since the last validation */
+    bool used;
+    struct tevent_timer *refresh_te;
+    struct tevent_req *refresh_req;
+};
+
+struct sss_cert_cache {
+    struct tevent_context *ev;
+    const char *ca_db;
+    const char *verify_opts;
+    struct cert_verify_opts *cert_verify_opts;
+    bool want_key;
+    int child_debug_fd;
+
+    /* sss_cert_cache_entry by digest */
+    hash_table_t *table;
+    /* most recently used first */
+    struct sss_cert_cache_entry *entries;
+    size_t num_entries;
+};
+
+errno_t sss_cert_cache_init(TALLOC_CTX *mem_ctx,
+                            struct tevent_context *ev,
+                            const char *ca_db,
+                            const char *verify_opts,
+                            struct cert_verify_opts *cert_verify_opts,
+                            bool want_key,
+                            int child_debug_fd,
+                            struct sss_cert_cache **_cache)
+{
+    struct sss_cert_cache *cache;
+    errno_t ret;
+
+    cache = talloc_zero(mem_ctx, struct sss_cert_cache);
+    if (cache == NULL) {
+        return ENOMEM;
+    }
+
+    cache->ev = ev;
+    cache->want_key = want_key;
+    cache->child_debug_fd = child_debug_fd;
+    cache->cert_verify_opts = talloc_steal(cache, cert_verify_opts);
+
+    if (ca_db != NULL) {
+        cache->ca_db = talloc_strdup(cache, ca_db);
+        if (cache->ca_db == NULL) {
+            ret = ENOMEM;
+            goto done;
+        }
+    }
+
+    if (verify_opts != NULL) {
+        cache->verify_opts = talloc_strdup(cache, verify_opts);
+        if (cache->verify_opts == NULL) {
+            ret = ENOMEM;
+            goto done;
+        }
+    }
+
+    ret = sss_hash_create(cache, 0, &cache->table);
+    if (ret != EOK) {
+        goto done;
+    }
+
+    *_cache = cache;
+    ret = EOK;
+
+done:
+    if (ret != EOK) {
+        talloc_free(cache);
+    }
+    return ret;
+}
+
+static errno_t sss_cert_cache_digest(TALLOC_CTX *mem_ctx,
+                                     const uint8_t *der_blob, size_t der_size,
+                                     char **_digest)
+{
+    unsigned char digest[SSS_SHA256_LENGTH];
+    char *str;
+    size_t c;
+    errno_t ret;
+
+    ret = sss_sha256(der_blob, der_size, digest);
+    if (ret != EOK) {
+        return ret;
+    }
+
+    str = talloc_array(mem_ctx, char, SSS_SHA256_LENGTH * 2 + 1);
+    if (str == NULL) {
+        return ENOMEM;
+    }
+
+    for (c = 0; c < SSS_SHA256_LENGTH; c++) {
+        snprintf(&str[c * 2], 3, "%02x", digest[c]);
+    }
+
+    *_digest = str;
+    return EOK;
+}
+
+static int sss_cert_cache_entry_destructor(struct sss_cert_cache_entry *entry)
+{
+    hash_key_t key;
+
+    key.type = HASH_KEY_STRING;
+    key.str = entry->digest;
+    hash_delete(entry->cache->table, &key);
+
+    DLIST_REMOVE(entry->cache->entries, entry);
+    entry->cache->num_entries--;
+
+    return 0;
+}
+
+static void sss_cert_cache_refresh(struct tevent_context *ev,
+                                   struct tevent_timer *te,
+                                   struct timeval tv,
+                                   void *pvt);
+
+static void sss_cert_cache_set_result(struct sss_cert_cache_entry *entry,
+                                      errno_t result,
+                                      uint8_t *key, size_t key_size,
+                                      time_t valid_until)
+{
+    struct sss_cert_cache *cache = entry->cache;
+    time_t now = time(NULL);
+    time_t refresh;
+    uint32_t timeout;
+
+    /* A revalidation keeps the key that is already known */
+    if (key != entry->key) {
+        talloc_zfree(entry->key);
+        entry->key = talloc_steal(entry, key);
+        entry->key_size = key_size;
+    }
+    talloc_zfree(entry->refresh_te);
+    talloc_zfree(entry->refresh_req);
+
+    entry->result = result;
+    entry->used = false;
+
+    timeout = cache->cert_verify_opts->cache_timeout;
+    if (result != EOK && timeout > SSS_CERT_CACHE_NEG_TIMEOUT) {
+        timeout = SSS_CERT_CACHE_NEG_TIMEOUT;
+    }
+
+    entry->expire = now + timeout;
+    if (valid_until != 0 && valid_until < entry->expire) {
+        entry->expire = valid_until;
+    } else if (valid_until == 0 && result == EOK) {
+        /* Without the validity of the certificate and the CRL the result
+         * cannot be reused safely. */
+        DEBUG(SSSDBG_MINOR_FAILURE,
+              "Validity of certificate [%s] is not known, not caching it.\n",
+              entry->digest);
+        entry->expire = now;
+    }
+
+    /* Certificates that are still in use are validated again shortly
+     * before the result expires so that the logins never wait for it. */
+    refresh = entry->expire - (timeout < 10 ? 1 : timeout / 10);
+    if (result != EOK || refresh <= now) {
+        refresh = entry->expire;
+    }
+
+    entry->refresh_te = tevent_add_timer(cache->ev, entry,
+                                         tevent_timeval_set(refresh, 0),
+                                         sss_cert_cache_refresh, entry);
+    if (entry->refresh_te == NULL) {
+        DEBUG(SSSDBG_MINOR_FAILURE,
+              "Unable to schedule revalidation, dropping the result.\n");
+        entry->expire = 0;
+    }
+}
+
+static errno_t sss_cert_cache_run_validation(struct sss_cert_cache *cache,
+                                             struct sss_cert_cache_entry *entry)
+{
+    uint8_t *key = NULL;
+    size_t key_size = 0;
+    time_t valid_until = 0;
+    errno_t ret;
+
+    ret = cert_to_ssh_key_ex(entry, cache->ca_db,
+                             entry->der_blob, entry->der_size,
+                             cache->cert_verify_opts,
+                             cache->want_key ? &key : NULL, &key_size,
+                             &valid_until);
+
+    sss_cert_cache_set_result(entry, ret, key, key_size, valid_until);
+
+    return ret;
+}
+
+static void sss_cert_cache_refresh_done(struct tevent_req *req);
+
+static void sss_cert_cache_refresh(struct tevent_context *ev,
+                                   struct tevent_timer *te,
+                                   struct timeval tv,
+                                   void *pvt)
+{
+    struct sss_cert_cache_entry *entry;
+    struct sss_cert_cache *cache;
+    time_t now = time(NULL);
+
+    entry = talloc_get_type(pvt, struct sss_cert_cache_entry);
+    entry->refresh_te = NULL;
+    cache = entry->cache;
+
+    if (!entry->used || entry->result != EOK || entry->expire <= now) {
+        DEBUG(SSSDBG_TRACE_ALL, "Removing certificate [%s] from the cache.\n",
+              entry->digest);
+        talloc_free(entry);
+        return;
+    }
+
+    /* The validation may need OCSP or other network lookups, it runs in
+     * p11_child so that the responder is not blocked. The current result
+     * is used until it finishes. */
+    entry->refresh_req = sss_cert_child_verify_send(entry, ev,
+                                                    cache->child_debug_fd,
+                                                    cache->ca_db,
+                                                    cache->verify_opts,
+                                                    entry->der_blob,
+                                                    entry->der_size,
+                                                    entry->expire - now);
+    if (entry->refresh_req == NULL) {
+        DEBUG(SSSDBG_OP_FAILURE, "Unable to revalidate certificate [%s], "
+              "removing it from the cache.\n", entry->digest);
+        talloc_free(entry);
+        return;
+    }
+    tevent_req_set_callback(entry->refresh_req, sss_cert_cache_refresh_done,
+                            entry);
+}
+
+static void sss_cert_cache_refresh_done(struct tevent_req *req)
+{
+    struct sss_cert_cache_entry *entry;
+    time_t valid_until = 0;
+    errno_t ret;
+
+    entry = tevent_req_callback_data(req, struct sss_cert_cache_entry);
+
+    ret = sss_cert_child_verify_recv(req, &valid_until);
+    talloc_zfree(entry->refresh_req);
+    DEBUG(SSSDBG_TRACE_FUNC, "Certificate [%s] revalidated [%d]: %s\n",
+          entry->digest, ret, sss_strerror(ret));
+    if (ret != EOK) {
+        /* The next use validates it again in the foreground */
+        talloc_free(entry);
+        return;
+    }
+
+    sss_cert_cache_set_result(entry, EOK, entry->key, entry->key_size,
+                              valid_until);
+}
+
+static struct sss_cert_cache_entry *
+sss_cert_cache_lookup(struct sss_cert_cache *cache, const char *digest)
+{
+    struct sss_cert_cache_entry *entry;
+    hash_key_t key;
+    hash_value_t value;
+
+    key.type = HASH_KEY_STRING;
+    key.str = discard_const(digest);
+
+    if (hash_lookup(cache->table, &key, &value) != HASH_SUCCESS) {
+        return NULL;
+    }
+
+    entry = talloc_get_type(value.ptr, struct sss_cert_cache_entry);
+    if (entry->expire <= time(NULL)) {
+        talloc_free(entry);
+        return NULL;
+    }
+
+    DLIST_PROMOTE(cache->entries, entry);
+    entry->used = true;
+
+    return entry;
+}
+
+static errno_t sss_cert_cache_entry_new(struct sss_cert_cache *cache,
+                                        const uint8_t *der_blob,
+                                        size_t der_size,
+                                        char *digest,
+                                        struct sss_cert_cache_entry **_entry)
+{
+    struct sss_cert_cache_entry *entry;
+    struct sss_cert_cache_entry *last;
+    hash_key_t key;
+    hash_value_t value;
+    int hret;
+
+    if (cache->num_entries >= SSS_CERT_CACHE_MAX_ENTRIES) {
+        for (last = cache->entries; last->next != NULL; last = last->next);
+        talloc_free(last);
+    }
+
+    entry = talloc_zero(cache, struct sss_cert_cache_entry);
+    if (entry == NULL) {
+        return ENOMEM;
+    }
+
+    entry->cache = cache;
+    entry->digest = talloc_steal(entry, digest);
+    entry->der_blob = talloc_memdup(entry, der_blob, der_size);
+    if (entry->der_blob == NULL) {
+        talloc_free(entry);
+        return ENOMEM;
+    }
+    entry->der_size = der_size;
+
+    key.type = HASH_KEY_STRING;
+    key.str = entry->digest;
+    value.type = HASH_VALUE_PTR;
+    value.ptr = entry;
+
+    hret = hash_enter(cache->table, &key, &value);
+    if (hret != HASH_SUCCESS) {
+        DEBUG(SSSDBG_OP_FAILURE, "Unable to add certificate to the cache: "
+              "%s\n", hash_error_string(hret));
+        talloc_free(entry);
+        return EIO;
+    }
+
+    DLIST_ADD(cache->entries, entry);
+    cache->num_entries++;
+    talloc_set_destructor(entry, sss_cert_cache_entry_destructor);
+
+    *_entry = entry;
+    return EOK;
+}
+
+errno_t sss_cert_cache_validate(TALLOC_CTX *mem_ctx,
+                                struct sss_cert_cache *cache,
+                                const uint8_t *der_blob, size_t der_size,
+                                uint8_t **_key, size_t *_key_size)
+{
+    struct sss_cert_cache_entry *entry;
+    char *digest = NULL;
+    errno_t ret;
+
+    if (der_blob == NULL || der_size == 0) {
+        return EINVAL;
+    }
+
+    if (cache->cert_verify_opts->cache_timeout == 0) {
+        return cert_to_ssh_key(mem_ctx, cache->ca_db, der_blob, der_size,
+                               cache->cert_verify_opts, _key, _key_size);
+    }
+
+    ret = sss_cert_cache_digest(cache, der_blob, der_size, &digest);
+    if (ret != EOK) {
+        return ret;
+    }
+
+    entry = sss_cert_cache_lookup(cache, digest);
+    if (entry != NULL && (!cache->want_key || entry->result != EOK
+                          || entry->key != NULL || _key == NULL)) {
+        DEBUG(SSSDBG_TRACE_ALL, "Using cached validation result of [%s].\n",
+              digest);
+        talloc_free(digest);
+    } else {
+        if (entry == NULL) {
+            ret = sss_cert_cache_entry_new(cache, der_blob, der_size, digest,
+                                           &entry);
+            if (ret != EOK) {
+                talloc_free(digest);
+                return ret;
+            }
+        } else {
+            talloc_free(digest);
+        }
+
+        sss_cert_cache_run_validation(cache, entry);
+    }
+
+    if (entry->result != EOK) {
+        return entry->result;
+    }
+
+    if (_key != NULL) {
+        if (entry->key == NULL) {
+            return EINVAL;
+        }
+
+        *_key = talloc_memdup(mem_ctx, entry->key, entry->key_size);
+        if (*_key == NULL) {
+            return ENOMEM;
+        }
+        *_key_size = entry->key_size;
+    }
+
+    return EOK;
+}
+
+errno_t sss_cert_cache_add_valid(struct sss_cert_cache *cache,
+                                 const uint8_t *der_blob, size_t der_size,
+                                 const char *verified)
+{
+    struct sss_cert_cache_entry *entry;
+    char *digest = NULL;
+    char **verified_list = NULL;
+    time_t valid_until;
+    errno_t ret;
+
+    if (cache->cert_verify_opts->cache_timeout == 0) {
+        return EOK;
+    }
+
+    ret = sss_cert_cache_digest(cache, der_blob, der_size, &digest);
+    if (ret != EOK) {
+        return ret;
+    }
+
+    entry = sss_cert_cache_lookup(cache, digest);
+    if (entry != NULL && entry->result == EOK) {
+        talloc_free(digest);
+        return EOK;
+    }
+
+    /* p11_child skipped the validation of the certificates it was told about,
+     * their result might have expired in the meantime and must not be
+     * renewed without validating them again. */
+    if (verified != NULL) {
+        ret = split_on_separator(cache, verified, ',', true, true,
+                                 &verified_list, NULL);
+        if (ret != EOK) {
+            talloc_free(digest);
+            return ret;
+        }
+
+        if (string_in_list(digest, verified_list, false)) {
+            DEBUG(SSSDBG_TRACE_ALL, "Certificate [%s] was not validated, "
+                  "not adding it to the cache.\n", digest);
+            talloc_free(verified_list);
+            talloc_free(digest);
+            return EOK;
+        }
+        talloc_free(verified_list);
+    }
+
+    ret = cert_der_valid_until(cache->ca_db, der_blob, der_size, &valid_until);
+    if (ret != EOK) {
+        DEBUG(SSSDBG_MINOR_FAILURE, "Validity of certificate [%s] is not "
+              "known, not adding it to the cache.\n", digest);
+        talloc_free(digest);
+        return EOK;
+    }
+
+    if (entry == NULL) {
+        ret = sss_cert_cache_entry_new(cache, der_blob, der_size, digest,
+                                       &entry);
+        if (ret != EOK) {
+            talloc_free(digest);
+            return ret;
+        }
+    } else {
+        talloc_free(digest);
+    }
+
+    sss_cert_cache_set_result(entry, EOK, NULL, 0, valid_until);
+    entry->used = true;
+
+    return EOK;
+}
+
+char *sss_cert_cache_valid_digests(TALLOC_CTX *mem_ctx,
+                                   struct sss_cert_cache *cache)
+{
+    struct sss_cert_cache_entry *entry;
+    time_t now = time(NULL);
+    char *digests = NULL;
+
+    DLIST_FOR_EACH(entry, cache->entries) {
+        if (entry->result != EOK || entry->expire <= now) {
+            continue;
+        }
+
+        if (digests == NULL) {
+            digests = talloc_strdup(mem_ctx, entry->digest);
+        } else {
+            digests = talloc_asprintf_append(digests, ",%s", entry->digest);
+        }
+        if (digests == NULL) {
+            return NULL;
+        }
+    }
+
+    return digests;
+}
@@ -0,0 +1,91 @@
+/*
+   SSSD
+
+   Responder - cache of certificate validation results
+
+   Copyright (C) 2016 Red Hat
+
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef _CERT_CACHE_H_
+#define _CERT_CACHE_H_
+
+#include <talloc.h>
+#include <tevent.h>
+
+#include "util/util.h"
+
+#ifndef SSSD_LIBEXEC_PATH
+#error "SSSD_LIBEXEC_PATH not defined"
+#endif  /* SSSD_LIBEXEC_PATH */
+
+#define P11_CHILD_PATH SSSD_LIBEXEC_PATH"/p11_child"
+
+#define SSS_CERT_CACHE_MAX_ENTRIES 1024
+
+/* Failed validations are retried sooner than the successful ones */
+#define SSS_CERT_CACHE_NEG_TIMEOUT 60
+
+struct sss_cert_cache;
+
+/* Results are kept for cert_verify_opts->cache_timeout seconds, capped by
+ * the validity of the certificate and the next update of the CRL, nothing
+ * is cached if the timeout is 0. If want_key is set, the SSH public key of
+ * the certificate is cached together with the result. Certificates that are
+ * still in use are validated again in p11_child, verify_opts is the
+ * unparsed certificate_verification option passed to it. */
+errno_t sss_cert_cache_init(TALLOC_CTX *mem_ctx,
+                            struct tevent_context *ev,
+                            const char *ca_db,
+                            const char *verify_opts,
+                            struct cert_verify_opts *cert_verify_opts,
+                            bool want_key,
+                            int child_debug_fd,
+                            struct sss_cert_cache **_cache);
+
+/* Validates the DER encoded certificate unless it was validated recently.
+ * _key and _key_size may be NULL. */
+errno_t sss_cert_cache_validate(TALLOC_CTX *mem_ctx,
+                                struct sss_cert_cache *cache,
+                                const uint8_t *der_blob, size_t der_size,
+                                uint8_t **_key, size_t *_key_size);
+
+/* Records a certificate that was validated elsewhere, e.g. by p11_child.
+ * Certificates whose digest is in the comma separated list verified were
+ * not validated again and are not added. */
+errno_t sss_cert_cache_add_valid(struct sss_cert_cache *cache,
+                                 const uint8_t *der_blob, size_t der_size,
+                                 const char *verified);
+
+/* Comma separated hex encoded SHA-256 digests of the certificates that are
+ * currently known to be valid, NULL if there are none. */
+char *sss_cert_cache_valid_digests(TALLOC_CTX *mem_ctx,
+                                   struct sss_cert_cache *cache);
+
+/* Validates the DER encoded certificate in p11_child without blocking the
+ * responder, _valid_until is set as by cert_der_valid_until(). */
+struct tevent_req *sss_cert_child_verify_send(TALLOC_CTX *mem_ctx,
+                                              struct tevent_context *ev,
+                                              int child_debug_fd,
+                                              const char *ca_db,
+                                              const char *verify_opts,
+                                              const uint8_t *der_blob,
+                                              size_t der_size,
+                                              time_t timeout);
+
+errno_t sss_cert_child_verify_recv(struct tevent_req *req,
+                                   time_t *_valid_until);
+
+#endif /* _CERT_CACHE_H_ */
@@ -0,0 +1,263 @@
+/*
+   SSSD
+
+   Responder - certificate validation in p11_child
+
+   Copyright (C) 2016 Red Hat
+
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <time.h>
+#include <talloc.h>
+#include <tevent.h>
+
+#include "util/util.h"
+#include "util/child_common.h"
+#include "util/crypto/sss_crypto.h"
+#include "responder/common/cert_cache.h"
+
+struct sss_cert_child_verify_state {
+    struct tevent_context *ev;
+    struct child_io_fds *io;
+    struct sss_child_ctx_old *child_ctx;
+    struct tevent_timer *timeout_handler;
+    time_t valid_until;
+};
+
+static void sss_cert_child_verify_done(struct tevent_req *subreq);
+static void sss_cert_child_verify_timeout(struct tevent_context *ev,
+                                          struct tevent_timer *te,
+                                          struct timeval tv, void *pvt);
+
+struct tevent_req *sss_cert_child_verify_send(TALLOC_CTX *mem_ctx,
+                                              struct tevent_context *ev,
+                                              int child_debug_fd,
+                                              const char *ca_db,
+                                              const char *verify_opts,
+                                              const uint8_t *der_blob,
+                                              size_t der_size,
+                                              time_t timeout)
+{
+    struct sss_cert_child_verify_state *state;
+    struct tevent_req *req;
+    struct tevent_req *subreq;
+    pid_t child_pid;
+    struct timeval tv;
+    int pipefd_to_child[2] = PIPE_INIT;
+    int pipefd_from_child[2] = PIPE_INIT;
+    const char *extra_args[8] = { NULL };
+    char *cert_b64;
+    size_t arg_c;
+    errno_t ret;
+
+    req = tevent_req_create(mem_ctx, &state,
+                            struct sss_cert_child_verify_state);
+    if (req == NULL) {
+        return NULL;
+    }
+
+    if (ca_db == NULL) {
+        DEBUG(SSSDBG_CRIT_FAILURE, "Missing CA DB.\n");
+        ret = EINVAL;
+        goto done;
+    }
+
+    cert_b64 = sss_base64_encode(state, der_blob, der_size);
+    if (cert_b64 == NULL) {
+        DEBUG(SSSDBG_OP_FAILURE, "sss_base64_encode failed.\n");
+        ret = ENOMEM;
+        goto done;
+    }
+
+    /* extra_args are added in revers order */
+    arg_c = 0;
+    extra_args[arg_c++] = ca_db;
+    extra_args[arg_c++] = "--nssdb";
+    if (verify_opts != NULL) {
+        extra_args[arg_c++] = verify_opts;
+        extra_args[arg_c++] = "--verify";
+    }
+    extra_args[arg_c++] = cert_b64;
+    extra_args[arg_c++] = "--certificate";
+    extra_args[arg_c++] = "--verification";
+
+    state->ev = ev;
+    state->valid_until = 0;
+    state->io = talloc(state, struct child_io_fds);
+    if (state->io == NULL) {
+        DEBUG(SSSDBG_CRIT_FAILURE, "talloc failed.\n");
+        ret = ENOMEM;
+        goto done;
+    }
+    state->io->write_to_child_fd = -1;
+    state->io->read_from_child_fd = -1;
+    talloc_set_destructor((void *) state->io, child_io_destructor);
+
+    ret = pipe(pipefd_from_child);
+    if (ret == -1) {
+        ret = errno;
+        DEBUG(SSSDBG_CRIT_FAILURE,
+              "pipe failed [%d][%s].\n", ret, strerror(ret));
+        goto done;
+    }
+    ret = pipe(pipefd_to_child);
+    if (ret == -1) {
+        ret = errno;
+        DEBUG(SSSDBG_CRIT_FAILURE,
+              "pipe failed [%d][%s].\n", ret, strerror(ret));
+        goto done;
+    }
+
+    if (child_debug_fd == -1) {
+        child_debug_fd = STDERR_FILENO;
+    }
+
+    child_pid = fork();
+    if (child_pid == 0) { /* child */
+        exec_child_ex(state, pipefd_to_child, pipefd_from_child,
+                      P11_CHILD_PATH, child_debug_fd, extra_args, false,
+                      STDIN_FILENO, STDOUT_FILENO);
+
+        /* We should never get here */
+        DEBUG(SSSDBG_CRIT_FAILURE, "BUG: Could not exec p11 child\n");
+    } else if (child_pid > 0) { /* parent */
+
+        state->io->read_from_child_fd = pipefd_from_child[0];
+        PIPE_FD_CLOSE(pipefd_from_child[1]);
+        sss_fd_nonblocking(state->io->read_from_child_fd);
+
+        /* Nothing is sent to the child in verification mode */
+        PIPE_CLOSE(pipefd_to_child);
+
+        ret = child_handler_setup(ev, child_pid, NULL, NULL,
+                                  &state->child_ctx);
+        if (ret != EOK) {
+            DEBUG(SSSDBG_OP_FAILURE,
+                  "Could not set up child handlers [%d]: %s\n",
+                  ret, sss_strerror(ret));
+            ret = ERR_P11_CHILD;
+            goto done;
+        }
+
+        tv = tevent_timeval_current_ofs(timeout, 0);
+        state->timeout_handler = tevent_add_timer(ev, req, tv,
+                                                  sss_cert_child_verify_timeout,
+                                                  req);
+        if (state->timeout_handler == NULL) {
+            ret = ERR_P11_CHILD;
+            goto done;
+        }
+
+        subreq = read_pipe_send(state, ev, state->io->read_from_child_fd);
+        if (subreq == NULL) {
+            DEBUG(SSSDBG_OP_FAILURE, "read_pipe_send failed.\n");
+            ret = ERR_P11_CHILD;
+            goto done;
+        }
+        tevent_req_set_callback(subreq, sss_cert_child_verify_done, req);
+    } else { /* error */
+        ret = errno;
+        DEBUG(SSSDBG_CRIT_FAILURE, "fork failed [%d][%s].\n",
+                                   ret, sss_strerror(ret));
+        goto done;
+    }
+
+    ret = EOK;
+
+done:
+    if (ret != EOK) {
+        PIPE_CLOSE(pipefd_from_child);
+        PIPE_CLOSE(pipefd_to_child);
+        tevent_req_error(req, ret);
+        tevent_req_post(req, ev);
+    }
+    return req;
+}
+
+static void sss_cert_child_verify_done(struct tevent_req *subreq)
+{
+    struct tevent_req *req = tevent_req_callback_data(subreq,
+                                                      struct tevent_req);
+    struct sss_cert_child_verify_state *state =
+                    tevent_req_data(req, struct sss_cert_child_verify_state);
+    uint8_t *buf;
+    ssize_t buf_len;
+    char *str;
+    char *endptr;
+    long long valid_until;
+    errno_t ret;
+
+    talloc_zfree(state->timeout_handler);
+
+    ret = read_pipe_recv(subreq, state, &buf, &buf_len);
+    talloc_zfree(subreq);
+    if (ret != EOK) {
+        tevent_req_error(req, ret);
+        return;
+    }
+
+    PIPE_FD_CLOSE(state->io->read_from_child_fd);
+
+    /* p11_child prints nothing if the certificate is not valid */
+    if (buf_len == 0) {
+        tevent_req_error(req, ERR_P11_CHILD);
+        return;
+    }
+
+    str = talloc_strndup(state, (char *) buf, buf_len);
+    if (str == NULL) {
+        tevent_req_error(req, ENOMEM);
+        return;
+    }
+
+    errno = 0;
+    valid_until = strtoll(str, &endptr, 10);
+    if (errno != 0 || endptr == str || (*endptr != '\0' && *endptr != '\n')
+            || valid_until <= 0) {
+        DEBUG(SSSDBG_OP_FAILURE,
+              "Unexpected p11_child response [%s].\n", str);
+        tevent_req_error(req, EINVAL);
+        return;
+    }
+
+    state->valid_until = (time_t) valid_until;
+    tevent_req_done(req);
+}
+
+static void sss_cert_child_verify_timeout(struct tevent_context *ev,
+                                          struct tevent_timer *te,
+                                          struct timeval tv, void *pvt)
+{
+    struct tevent_req *req = talloc_get_type(pvt, struct tevent_req);
+    struct sss_cert_child_verify_state *state =
+                    tevent_req_data(req, struct sss_cert_child_verify_state);
+
+    DEBUG(SSSDBG_CRIT_FAILURE, "Timeout reached for p11_child.\n");
+    child_handler_destroy(state->child_ctx);
+    state->child_ctx = NULL;
+    tevent_req_error(req, ETIMEDOUT);
+}
+
+errno_t sss_cert_child_verify_recv(struct tevent_req *req,
+                                   time_t *_valid_until)
+{
+    struct sss_cert_child_verify_state *state =
+                    tevent_req_data(req, struct sss_cert_child_verify_state);
+
+    TEVENT_REQ_RETURN_ON_ERROR(req);
+
+    *_valid_until = state->valid_until;
+    return EOK;
+}
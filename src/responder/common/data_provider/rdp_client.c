@@ -22,6 +22,7 @@
 #include "util/util.h"
 
 static void rdp_register_client_done(struct tevent_req *req);
+static void rdp_register_packed_done(struct tevent_req *req);
 
 errno_t rdp_register_client(struct be_conn *be_conn,
                             const char *client_name)
@@ -35,21 +36,129 @@ errno_t rdp_register_client(struct be_conn *be_conn,
         return ENOMEM;
     }
 
-    tevent_req_set_callback(req, rdp_register_client_done, NULL);
+    tevent_req_set_callback(req, rdp_register_client_done, be_conn);
 
     return EOK;
 }
 
+static void rdp_packed_disconnected(struct sbus_packed_conn *conn, void *pvt)
+{
+    struct be_conn *be_conn;
+
+    be_conn = talloc_get_type(pvt, struct be_conn);
+
+    DEBUG(SSSDBG_MINOR_FAILURE, "Packed connection to [%s] was lost, "
+          "falling back to D-Bus\n", be_conn->domain->name);
+
+    if (be_conn->packed == conn) {
+        be_conn->packed = NULL;
+    }
+
+    talloc_free(conn);
+}
+
+static errno_t rdp_register_packed(struct be_conn *be_conn,
+                                   const char *address)
+{
+    struct sbus_packed_conn *conn;
+    struct sbus_packed_buf *body;
+    struct tevent_req *req;
+    errno_t ret;
+
+    ret = sbus_packed_connect(be_conn, be_conn->rctx->ev, address, &conn);
+    if (ret != EOK) {
+        return ret;
+    }
+
+    sbus_packed_conn_set_data(conn, be_conn);
+    sbus_packed_conn_set_disconnect_fn(conn, rdp_packed_disconnected,
+                                       be_conn);
+
+    body = sbus_packed_buf_new(conn);
+    if (body == NULL) {
+        ret = ENOMEM;
+        goto done;
+    }
+
+    ret = iface_dp_client_Register_pack(body, be_conn->cli_name);
+    if (ret != EOK) {
+        goto done;
+    }
+
+    /* The connection is not used for requests until it is registered. */
+    req = sbus_packed_call_send(conn, conn, IFACE_DP_CLIENT_REGISTER_OPCODE,
+                                body, SSS_CLI_SOCKET_TIMEOUT / 2);
+    if (req == NULL) {
+        ret = ENOMEM;
+        goto done;
+    }
+
+    tevent_req_set_callback(req, rdp_register_packed_done, conn);
+
+    ret = EOK;
+
+done:
+    if (ret != EOK) {
+        talloc_free(conn);
+    }
+
+    return ret;
+}
+
 static void rdp_register_client_done(struct tevent_req *req)
 {
+    struct be_conn *be_conn;
+    const char *packed_address;
     errno_t ret;
 
-    ret = rdp_message_recv(req);
-    talloc_zfree(req);
+    be_conn = tevent_req_callback_data(req, struct be_conn);
+
+    ret = rdp_message_recv(req, DBUS_TYPE_STRING, &packed_address);
     if (ret != EOK) {
         DEBUG(SSSDBG_CRIT_FAILURE, "Unable to register client with DP\n");
+        talloc_zfree(req);
         return;
     }
 
     DEBUG(SSSDBG_TRACE_FUNC, "Client is registered with DP\n");
+
+    /* Drop connection from before reconnect, if any. */
+    talloc_zfree(be_conn->packed);
+
+    if (packed_address[0] != '\0') {
+        ret = rdp_register_packed(be_conn, packed_address);
+        if (ret != EOK) {
+            DEBUG(SSSDBG_MINOR_FAILURE, "Unable to connect to packed "
+                  "transport, using D-Bus only [%d]: %s\n",
+                  ret, sss_strerror(ret));
+        }
+    }
+
+    talloc_zfree(req);
+}
+
+static void rdp_register_packed_done(struct tevent_req *req)
+{
+    struct sbus_packed_conn *conn;
+    struct sbus_packed_buf *reply;
+    struct be_conn *be_conn;
+    errno_t ret;
+
+    conn = tevent_req_callback_data(req, struct sbus_packed_conn);
+    be_conn = talloc_get_type(sbus_packed_conn_get_data(conn),
+                              struct be_conn);
+
+    ret = sbus_packed_call_recv(req, req, &reply);
+    talloc_zfree(req);
+    if (ret != EOK) {
+        DEBUG(SSSDBG_MINOR_FAILURE, "Unable to register packed client, "
+              "using D-Bus only [%d]: %s\n", ret, sss_strerror(ret));
+        talloc_free(conn);
+        return;
+    }
+
+    talloc_free(be_conn->packed);
+    be_conn->packed = conn;
+
+    DEBUG(SSSDBG_TRACE_FUNC, "Client is registered with DP packed transport\n");
 }
@@ -20,6 +20,8 @@
 */
 
 #include "util/util.h"
+#include "util/sss_perf.h"
+#include "util/probes.h"
 #include "confdb/confdb.h"
 #include "responder/common/negcache_files.h"
 #include "responder/common/responder.h"
@@ -138,6 +140,11 @@ done:
         ret = ENOENT;
     }
 
+    if (ret == EEXIST) {
+        sss_perf_count(SSS_PERF_NCACHE_HIT);
+    }
+    PROBE(NCACHE_CHECK, str, ret == EEXIST);
+
     free(data.dptr);
     return ret;
 }
@@ -176,6 +183,7 @@ static int sss_ncache_set_str(struct sss_nc_ctx *ctx, char *str,
 
     DEBUG(SSSDBG_TRACE_FUNC, "Adding [%s] to negative cache%s\n",
               str, permanent?" permanently":"");
+    PROBE(NCACHE_SET, str, permanent);
 
     ret = tdb_store(ctx->tdb, key, data, TDB_REPLACE);
     if (ret != 0) {
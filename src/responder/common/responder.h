@@ -35,6 +35,7 @@
 
 #include "data_provider/rdp.h"
 #include "sbus/sssd_dbus.h"
+#include "sbus/sbus_packed.h"
 #include "responder/common/negcache.h"
 #include "sss_client/sss_cli.h"
 
@@ -60,6 +61,10 @@ struct cli_request {
 
     /* reply data */
     struct sss_packet *out;
+
+    /* request trace identifier and the time the request arrived */
+    uint64_t trace_id;
+    struct timeval start;
 };
 
 struct cli_protocol_version {
@@ -86,6 +91,9 @@ struct be_conn {
 
     char *sbus_address;
     struct sbus_connection *conn;
+
+    /* Optional packed transport connection, see dp_packed_transport. */
+    struct sbus_packed_conn *packed;
 };
 
 struct resp_ctx {
@@ -113,6 +121,11 @@ struct resp_ctx {
 
     hash_table_t *dp_request_table;
 
+    /* Account requests issued within this many milliseconds are sent to
+     * the data provider in a single getAccountInfoBatch call. */
+    int dp_batch_window;
+    struct sss_dp_batch *dp_batches;
+
     struct timeval get_domains_last_call;
 
     size_t allowed_uids_count;
@@ -255,6 +268,23 @@ sss_dp_issue_request(TALLOC_CTX *mem_ctx, struct resp_ctx *rctx,
                      dbus_msg_constructor msg_create, void *pvt,
                      struct tevent_req *nreq);
 
+/* Constructor of the same request for the packed transport. The reply
+ * must consist of (uint16 dp_error, uint32 error, string message). */
+typedef errno_t (packed_msg_constructor)(TALLOC_CTX *mem_ctx,
+                                         void *pvt,
+                                         uint16_t *_opcode,
+                                         struct sbus_packed_buf **_body);
+
+/* The same as sss_dp_issue_request() but the request is sent over the
+ * packed transport if it was negotiated with the back end. */
+errno_t
+sss_dp_issue_packed_request(TALLOC_CTX *mem_ctx, struct resp_ctx *rctx,
+                            const char *strkey, struct sss_domain_info *dom,
+                            dbus_msg_constructor msg_create,
+                            packed_msg_constructor packed_create,
+                            void *pvt,
+                            struct tevent_req *nreq);
+
 /* Every provider specific request uses this structure as the tevent_req
  * "state" structure.
  */
@@ -43,6 +43,10 @@
 #include "monitor/monitor_interfaces.h"
 #include "sbus/sbus_client.h"
 #include "util/util_creds.h"
+#include "util/sss_trace.h"
+#include "util/sss_perf.h"
+#include "util/sss_cli_cmd.h"
+#include "util/probes.h"
 
 #ifdef HAVE_SYSTEMD
 #include <systemd/sd-daemon.h>
@@ -251,6 +255,7 @@ done:
 static void client_send(struct cli_ctx *cctx)
 {
     struct cli_protocol *pctx;
+    enum sss_cli_command cmd;
     int ret;
 
     pctx = talloc_get_type(cctx->protocol_ctx, struct cli_protocol);
@@ -269,6 +274,13 @@ static void client_send(struct cli_ctx *cctx)
     /* ok all sent */
     TEVENT_FD_NOT_WRITEABLE(cctx->cfde);
     TEVENT_FD_READABLE(cctx->cfde);
+    sss_trace_span(pctx->creq->trace_id, SSS_TRACE_REQUEST,
+                   &pctx->creq->start);
+    cmd = sss_packet_get_cmd(pctx->creq->in);
+    PROBE(RESPONDER_CLIENT_SEND, cctx->cfd, cmd, sss_cmd2str(cmd),
+          pctx->creq->trace_id);
+    sss_perf_record(SSS_PERF_HIST_COMMAND, cmd, sss_cmd2str(cmd),
+                    &pctx->creq->start);
     talloc_zfree(pctx->creq);
     return;
 }
@@ -286,6 +298,7 @@ static int client_cmd_execute(struct cli_ctx *cctx, struct sss_cmd_table *sss_cm
 static void client_recv(struct cli_ctx *cctx)
 {
     struct cli_protocol *pctx;
+    uint64_t prev_trace_id;
     int ret;
 
     pctx = talloc_get_type(cctx->protocol_ctx, struct cli_protocol);
@@ -298,6 +311,7 @@ static void client_recv(struct cli_ctx *cctx)
             talloc_free(cctx);
             return;
         }
+        pctx->creq->start = tevent_timeval_current();
     }
 
     if (!pctx->creq->in) {
@@ -316,8 +330,16 @@ static void client_recv(struct cli_ctx *cctx)
     case EOK:
         /* do not read anymore */
         TEVENT_FD_NOT_READABLE(cctx->cfde);
-        /* execute command */
+        /* execute command, everything that is started on behalf of the
+         * client from now on is tagged with the request identifier */
+        pctx->creq->trace_id = sss_trace_new_id();
+        PROBE(RESPONDER_CLIENT_RECV, cctx->cfd,
+              sss_packet_get_cmd(pctx->creq->in),
+              sss_cmd2str(sss_packet_get_cmd(pctx->creq->in)),
+              pctx->creq->trace_id);
+        prev_trace_id = sss_trace_set_current(pctx->creq->trace_id);
         ret = client_cmd_execute(cctx, cctx->rctx->sss_cmds);
+        sss_trace_set_current(prev_trace_id);
         if (ret != EOK) {
             DEBUG(SSSDBG_FATAL_FAILURE,
                   "Failed to execute request, aborting client!\n");
@@ -513,6 +535,8 @@ static void accept_fd_handler(struct tevent_context *ev,
     DEBUG(SSSDBG_TRACE_FUNC,
           "Client connected%s!\n",
            accept_ctx->is_private ? " to privileged pipe" : "");
+    PROBE(RESPONDER_CLIENT_ACCEPT, cctx->cfd, client_euid(cctx->creds),
+          accept_ctx->is_private);
 
     return;
 }
@@ -987,6 +1011,16 @@ int sss_process_init(TALLOC_CTX *mem_ctx,
         rctx->domains_timeout = GET_DOMAINS_DEFAULT_TIMEOUT;
     }
 
+    ret = confdb_get_int(rctx->cdb, rctx->confdb_service_path,
+                         CONFDB_RESPONDER_DP_BATCH_WINDOW,
+                         0, &rctx->dp_batch_window);
+    if (ret != EOK) {
+        DEBUG(SSSDBG_OP_FAILURE,
+              "Cannot get the data provider batch window [%d]: %s\n",
+               ret, strerror(ret));
+        goto fail;
+    }
+
     ret = confdb_get_domains(rctx->cdb, &rctx->domains);
     if (ret != EOK) {
         DEBUG(SSSDBG_FATAL_FAILURE, "fatal error setting up domain map\n");
@@ -23,10 +23,13 @@
 #include <sys/time.h>
 #include <time.h>
 #include "util/util.h"
+#include "util/sss_trace.h"
+#include "util/sss_perf.h"
 #include "responder/common/responder_packet.h"
 #include "responder/common/responder.h"
 #include "providers/data_provider.h"
 #include "providers/data_provider/dp_responder_iface.h"
+#include "providers/data_provider/dp_iface_generated.h"
 #include "sbus/sbus_client.h"
 
 struct sss_dp_req;
@@ -126,6 +129,45 @@ static int sss_dp_req_destructor(void *ptr)
     return 0;
 }
 
+static void sss_dp_req_notify(struct sss_dp_req *sdp_req, errno_t ret)
+{
+    struct sss_dp_callback *cb;
+    struct sss_dp_req_state *cb_state;
+
+    /* Check whether we need to issue any callbacks */
+    while ((cb = sdp_req->cb_list) != NULL) {
+        cb_state = tevent_req_data(cb->req, struct sss_dp_req_state);
+        cb_state->dp_err = sdp_req->dp_err;
+        cb_state->dp_ret = sdp_req->dp_ret;
+        cb_state->err_msg = talloc_strdup(cb_state, sdp_req->err_msg);
+        /* Don't bother checking for NULL. If it fails due to ENOMEM,
+         * we can't really handle it anyway.
+         */
+
+        /* tevent_req_done/error will free cb */
+        if (ret == EOK) {
+            tevent_req_done(cb->req);
+        } else {
+            tevent_req_error(cb->req, ret);
+        }
+
+        /* Freeing the cb removes it from the cb_list.
+         * Therefore, the cb_list should now be pointing
+         * at a new callback. If it's not, it means the
+         * callback handler didn't free cb and may leak
+         * memory. Be paranoid and protect against this
+         * situation.
+         */
+        if (cb == sdp_req->cb_list) {
+            DEBUG(SSSDBG_FATAL_FAILURE,
+                  "BUG: a callback did not free its request. "
+                   "May leak memory\n");
+            /* Skip to the next since a memory leak is non-fatal */
+            sdp_req->cb_list = sdp_req->cb_list->next;
+        }
+    }
+}
+
 static void sss_dp_req_timeout(struct tevent_context *ev,
                                struct tevent_timer *te,
                                struct timeval t, void *ptr)
@@ -247,14 +289,129 @@ sss_dp_internal_get_send(struct resp_ctx *rctx,
                          struct sss_domain_info *dom,
                          DBusMessage *msg);
 
+static struct tevent_req *
+sss_dp_internal_packed_send(struct resp_ctx *rctx,
+                            hash_key_t *key,
+                            struct sss_domain_info *dom,
+                            struct sbus_packed_conn *conn,
+                            uint16_t opcode,
+                            struct sbus_packed_buf *body);
+
+struct sss_dp_account_info;
+
+static struct tevent_req *
+sss_dp_internal_batch_send(struct resp_ctx *rctx,
+                           hash_key_t *key,
+                           struct sss_domain_info *dom,
+                           struct sss_dp_account_info *info);
+
 static void
 sss_dp_req_done(struct tevent_req *sidereq);
 
+static errno_t
+sss_dp_issue_request_internal(TALLOC_CTX *mem_ctx, struct resp_ctx *rctx,
+                              const char *strkey, struct sss_domain_info *dom,
+                              dbus_msg_constructor msg_create,
+                              packed_msg_constructor packed_create,
+                              bool batchable,
+                              void *pvt,
+                              struct tevent_req *nreq);
+
 errno_t
 sss_dp_issue_request(TALLOC_CTX *mem_ctx, struct resp_ctx *rctx,
                      const char *strkey, struct sss_domain_info *dom,
                      dbus_msg_constructor msg_create, void *pvt,
                      struct tevent_req *nreq)
+{
+    return sss_dp_issue_request_internal(mem_ctx, rctx, strkey, dom,
+                                         msg_create, NULL, false, pvt, nreq);
+}
+
+errno_t
+sss_dp_issue_packed_request(TALLOC_CTX *mem_ctx, struct resp_ctx *rctx,
+                            const char *strkey, struct sss_domain_info *dom,
+                            dbus_msg_constructor msg_create,
+                            packed_msg_constructor packed_create,
+                            void *pvt,
+                            struct tevent_req *nreq)
+{
+    return sss_dp_issue_request_internal(mem_ctx, rctx, strkey, dom,
+                                         msg_create, packed_create, false,
+                                         pvt, nreq);
+}
+
+/* If @batchable is true, @pvt must be struct sss_dp_account_info. */
+static struct tevent_req *
+sss_dp_issue_new_request(struct resp_ctx *rctx,
+                         hash_key_t *key,
+                         struct sss_domain_info *dom,
+                         dbus_msg_constructor msg_create,
+                         packed_msg_constructor packed_create,
+                         bool batchable,
+                         void *pvt)
+{
+    struct sbus_packed_buf *body;
+    struct tevent_req *sidereq;
+    struct be_conn *be_conn;
+    DBusMessage *msg;
+    uint16_t opcode;
+    errno_t ret;
+
+    sss_perf_count(SSS_PERF_DP_REQUEST);
+
+    if (packed_create != NULL) {
+        ret = sss_dp_get_domain_conn(rctx, dom->conn_name, &be_conn);
+        if (ret == EOK && be_conn->packed != NULL) {
+            ret = packed_create(NULL, pvt, &opcode, &body);
+            if (ret != EOK) {
+                DEBUG(SSSDBG_CRIT_FAILURE, "Cannot create packed message\n");
+                return NULL;
+            }
+
+            /* The body is kept by the request to be able to resend it
+             * over D-Bus if the packed connection is lost. */
+            sidereq = sss_dp_internal_packed_send(rctx, key, dom,
+                                                  be_conn->packed,
+                                                  opcode, body);
+            if (sidereq == NULL) {
+                talloc_free(body);
+            }
+            return sidereq;
+        }
+    }
+
+    if (batchable && rctx->dp_batch_window > 0) {
+        return sss_dp_internal_batch_send(rctx, key, dom, pvt);
+    }
+
+    msg = msg_create(pvt);
+    if (!msg) {
+        DEBUG(SSSDBG_CRIT_FAILURE, "Cannot create D-Bus message\n");
+        return NULL;
+    }
+
+    /* All data provider methods issued here are traced. */
+    ret = sbus_message_append_trace_id(msg, sss_trace_current());
+    if (ret != EOK) {
+        DEBUG(SSSDBG_CRIT_FAILURE, "Cannot append trace ID\n");
+        dbus_message_unref(msg);
+        return NULL;
+    }
+
+    sidereq = sss_dp_internal_get_send(rctx, key, dom, msg);
+    dbus_message_unref(msg);
+
+    return sidereq;
+}
+
+static errno_t
+sss_dp_issue_request_internal(TALLOC_CTX *mem_ctx, struct resp_ctx *rctx,
+                              const char *strkey, struct sss_domain_info *dom,
+                              dbus_msg_constructor msg_create,
+                              packed_msg_constructor packed_create,
+                              bool batchable,
+                              void *pvt,
+                              struct tevent_req *nreq)
 {
     int hret;
     hash_value_t value;
@@ -264,7 +421,6 @@ sss_dp_issue_request(TALLOC_CTX *mem_ctx, struct resp_ctx *rctx,
     struct sss_dp_callback *cb;
     struct tevent_timer *te;
     struct timeval tv;
-    DBusMessage *msg;
     TALLOC_CTX *tmp_ctx = NULL;
     errno_t ret;
 
@@ -301,18 +457,11 @@ sss_dp_issue_request(TALLOC_CTX *mem_ctx, struct resp_ctx *rctx,
         /* No such request in progress
          * Create a new request
          */
-        msg = msg_create(pvt);
-        if (!msg) {
-            DEBUG(SSSDBG_CRIT_FAILURE, "Cannot create D-Bus message\n");
-            ret = EIO;
-            goto fail;
-        }
-
         value.type = HASH_VALUE_PTR;
-        sidereq = sss_dp_internal_get_send(rctx, key, dom, msg);
-        dbus_message_unref(msg);
+        sidereq = sss_dp_issue_new_request(rctx, key, dom, msg_create,
+                                           packed_create, batchable, pvt);
         if (!sidereq) {
-            DEBUG(SSSDBG_CRIT_FAILURE, "Cannot send D-Bus message\n");
+            DEBUG(SSSDBG_CRIT_FAILURE, "Cannot send DP message\n");
             ret = EIO;
             goto fail;
         }
@@ -429,6 +578,10 @@ sss_dp_req_recv(TALLOC_CTX *mem_ctx,
  * the data provider action.
  */
 static DBusMessage *sss_dp_get_account_msg(void *pvt);
+static errno_t sss_dp_get_account_packed(TALLOC_CTX *mem_ctx,
+                                         void *pvt,
+                                         uint16_t *_opcode,
+                                         struct sbus_packed_buf **_body);
 
 struct sss_dp_account_info {
     struct sss_domain_info *dom;
@@ -503,8 +656,13 @@ sss_dp_get_account_send(TALLOC_CTX *mem_ctx,
         goto error;
     }
 
-    ret = sss_dp_issue_request(state, rctx, key, dom, sss_dp_get_account_msg,
-                               info, req);
+    /* Initgroups requests are post-processed by the back end as a whole
+     * so they are always sent separately. */
+    ret = sss_dp_issue_request_internal(state, rctx, key, dom,
+                                        sss_dp_get_account_msg,
+                                        sss_dp_get_account_packed,
+                                        type != SSS_DP_INITGROUPS,
+                                        info, req);
     talloc_free(key);
     if (ret != EOK) {
         DEBUG(SSSDBG_OP_FAILURE,
@@ -521,19 +679,17 @@ error:
     return req;
 }
 
-static DBusMessage *
-sss_dp_get_account_msg(void *pvt)
+static errno_t
+sss_dp_get_account_args(struct sss_dp_account_info *info,
+                        uint32_t *_dp_flags,
+                        uint32_t *_entry_type,
+                        uint32_t *_attrs_type,
+                        char **_filter)
 {
-    DBusMessage *msg;
-    dbus_bool_t dbret;
-    struct sss_dp_account_info *info;
-    uint32_t dp_flags;
     uint32_t entry_type;
     uint32_t attrs_type = BE_ATTR_CORE;
     char *filter;
 
-    info = talloc_get_type(pvt, struct sss_dp_account_info);
-
     switch (info->type) {
         case SSS_DP_USER:
         case SSS_DP_WILDCARD_USER:
@@ -563,8 +719,6 @@ sss_dp_get_account_msg(void *pvt)
             break;
     }
 
-    dp_flags = info->fast_reply ? DP_FAST_REPLY : 0;
-
     if (info->opt_name) {
         if (info->type == SSS_DP_SECID) {
             filter = talloc_asprintf(info, "%s=%s", DP_SEC_ID,
@@ -586,6 +740,44 @@ sss_dp_get_account_msg(void *pvt)
     }
     if (!filter) {
         DEBUG(SSSDBG_CRIT_FAILURE, "Out of memory?!\n");
+        return ENOMEM;
+    }
+
+    DEBUG(SSSDBG_TRACE_FUNC,
+          "Creating request for [%s][%#x][%s][%d][%s:%s]\n",
+          info->dom->name, entry_type, be_req2str(entry_type), attrs_type,
+          filter, info->extra == NULL ? "-" : info->extra);
+
+    if (info->extra == NULL) {
+        /* D-Bus can't deal with NULL. */
+        info->extra = "";
+    }
+
+    *_dp_flags = info->fast_reply ? DP_FAST_REPLY : 0;
+    *_entry_type = entry_type;
+    *_attrs_type = attrs_type;
+    *_filter = filter;
+
+    return EOK;
+}
+
+static DBusMessage *
+sss_dp_get_account_msg(void *pvt)
+{
+    DBusMessage *msg;
+    dbus_bool_t dbret;
+    struct sss_dp_account_info *info;
+    uint32_t dp_flags;
+    uint32_t entry_type;
+    uint32_t attrs_type;
+    char *filter;
+    errno_t ret;
+
+    info = talloc_get_type(pvt, struct sss_dp_account_info);
+
+    ret = sss_dp_get_account_args(info, &dp_flags, &entry_type,
+                                  &attrs_type, &filter);
+    if (ret != EOK) {
         return NULL;
     }
 
@@ -600,16 +792,6 @@ sss_dp_get_account_msg(void *pvt)
     }
 
     /* create the message */
-    DEBUG(SSSDBG_TRACE_FUNC,
-          "Creating request for [%s][%#x][%s][%d][%s:%s]\n",
-          info->dom->name, entry_type, be_req2str(entry_type), attrs_type,
-          filter, info->extra == NULL ? "-" : info->extra);
-
-    if (info->extra == NULL) {
-        /* D-Bus can't deal with NULL. */
-        info->extra = "";
-    }
-
     dbret = dbus_message_append_args(msg,
                                      DBUS_TYPE_UINT32, &dp_flags,
                                      DBUS_TYPE_UINT32, &entry_type,
@@ -628,6 +810,50 @@ sss_dp_get_account_msg(void *pvt)
     return msg;
 }
 
+static errno_t
+sss_dp_get_account_packed(TALLOC_CTX *mem_ctx,
+                          void *pvt,
+                          uint16_t *_opcode,
+                          struct sbus_packed_buf **_body)
+{
+    struct sbus_packed_buf *body;
+    struct sss_dp_account_info *info;
+    uint32_t dp_flags;
+    uint32_t entry_type;
+    uint32_t attrs_type;
+    char *filter;
+    errno_t ret;
+
+    info = talloc_get_type(pvt, struct sss_dp_account_info);
+
+    ret = sss_dp_get_account_args(info, &dp_flags, &entry_type,
+                                  &attrs_type, &filter);
+    if (ret != EOK) {
+        return ret;
+    }
+
+    body = sbus_packed_buf_new(mem_ctx);
+    if (body == NULL) {
+        ret = ENOMEM;
+        goto done;
+    }
+
+    ret = iface_dp_getAccountInfo_pack(body, dp_flags, entry_type, attrs_type,
+                                       filter, info->dom->name, info->extra);
+    if (ret != EOK) {
+        DEBUG(SSSDBG_CRIT_FAILURE, "Failed to build message\n");
+        talloc_free(body);
+        goto done;
+    }
+
+    *_opcode = IFACE_DP_GETACCOUNTINFO_OPCODE;
+    *_body = body;
+
+done:
+    talloc_free(filter);
+    return ret;
+}
+
 errno_t
 sss_dp_get_account_recv(TALLOC_CTX *mem_ctx,
                         struct tevent_req *req,
@@ -644,6 +870,11 @@ struct dp_internal_get_state {
 
     struct sss_dp_req *sdp_req;
     DBusPendingCall *pending_reply;
+
+    /* Packed requests only. */
+    uint16_t opcode;
+    struct sbus_packed_buf *body;
+    uint64_t trace_id;
 };
 
 static void sss_dp_internal_get_done(DBusPendingCall *pending, void *ptr);
@@ -746,9 +977,7 @@ static void sss_dp_internal_get_done(DBusPendingCall *pending, void *ptr)
     int ret;
     struct tevent_req *req;
     struct sss_dp_req *sdp_req;
-    struct sss_dp_callback *cb;
     struct dp_internal_get_state *state;
-    struct sss_dp_req_state *cb_state;
 
     req = talloc_get_type(ptr, struct tevent_req);
     state = tevent_req_data(req, struct dp_internal_get_state);
@@ -776,38 +1005,7 @@ static void sss_dp_internal_get_done(DBusPendingCall *pending, void *ptr)
         }
     }
 
-    /* Check whether we need to issue any callbacks */
-    while ((cb = sdp_req->cb_list) != NULL) {
-        cb_state = tevent_req_data(cb->req, struct sss_dp_req_state);
-        cb_state->dp_err = sdp_req->dp_err;
-        cb_state->dp_ret = sdp_req->dp_ret;
-        cb_state->err_msg = talloc_strdup(cb_state, sdp_req->err_msg);
-        /* Don't bother checking for NULL. If it fails due to ENOMEM,
-         * we can't really handle it anyway.
-         */
-
-        /* tevent_req_done/error will free cb */
-        if (ret == EOK) {
-            tevent_req_done(cb->req);
-        } else {
-            tevent_req_error(cb->req, ret);
-        }
-
-        /* Freeing the cb removes it from the cb_list.
-         * Therefore, the cb_list should now be pointing
-         * at a new callback. If it's not, it means the
-         * callback handler didn't free cb and may leak
-         * memory. Be paranoid and protect against this
-         * situation.
-         */
-        if (cb == sdp_req->cb_list) {
-            DEBUG(SSSDBG_FATAL_FAILURE,
-                  "BUG: a callback did not free its request. "
-                   "May leak memory\n");
-            /* Skip to the next since a memory leak is non-fatal */
-            sdp_req->cb_list = sdp_req->cb_list->next;
-        }
-    }
+    sss_dp_req_notify(sdp_req, ret);
 
     /* We're done with this request. Free the sdp_req
      * This will clean up the hash table entry as well
@@ -822,3 +1020,821 @@ static void sss_dp_internal_get_done(DBusPendingCall *pending, void *ptr)
         tevent_req_error(req, ret);
     }
 }
+
+static void sss_dp_internal_packed_done(struct tevent_req *subreq);
+
+static struct tevent_req *
+sss_dp_internal_packed_send(struct resp_ctx *rctx,
+                            hash_key_t *key,
+                            struct sss_domain_info *dom,
+                            struct sbus_packed_conn *conn,
+                            uint16_t opcode,
+                            struct sbus_packed_buf *body)
+{
+    errno_t ret;
+    int hret;
+    struct tevent_req *req;
+    struct tevent_req *subreq;
+    struct dp_internal_get_state *state;
+    hash_value_t value;
+
+    /* See sss_dp_internal_get_send() for why this is allocated on rctx. */
+    req = tevent_req_create(rctx,
+                            &state,
+                            struct dp_internal_get_state);
+    if (!req)  return NULL;
+
+    state->rctx = rctx;
+    state->dom = dom;
+    state->opcode = opcode;
+    state->body = talloc_steal(state, body);
+    state->trace_id = sss_trace_current();
+
+    state->sdp_req = talloc_zero(state, struct sss_dp_req);
+    if (!state->sdp_req) {
+        ret = ENOMEM;
+        goto error;
+    }
+    state->sdp_req->rctx = rctx;
+    state->sdp_req->ev = rctx->ev;
+    state->sdp_req->key = talloc_steal(state->sdp_req, key);
+
+    subreq = sbus_packed_call_send(state, conn, opcode, body,
+                                   SSS_CLI_SOCKET_TIMEOUT / 2);
+    if (subreq == NULL) {
+        DEBUG(SSSDBG_CRIT_FAILURE, "Packed send failed.\n");
+        ret = EIO;
+        goto error;
+    }
+
+    tevent_req_set_callback(subreq, sss_dp_internal_packed_done, req);
+
+    /* Add this sdp_req to the hash table */
+    value.type = HASH_VALUE_PTR;
+    value.ptr = state->sdp_req;
+
+    DEBUG(SSSDBG_TRACE_FUNC, "Entering packed request [%s]\n", key->str);
+    hret = hash_enter(rctx->dp_request_table, key, &value);
+    if (hret != HASH_SUCCESS) {
+        DEBUG(SSSDBG_CRIT_FAILURE,
+              "Could not store request query (%s)\n",
+               hash_error_string(hret));
+        ret = EIO;
+        goto error;
+    }
+    talloc_set_destructor((TALLOC_CTX *)state->sdp_req,
+                          sss_dp_req_destructor);
+
+    return req;
+
+error:
+    tevent_req_error(req, ret);
+    tevent_req_post(req, rctx->ev);
+    return req;
+}
+
+/* The packed connection was lost before the reply arrived. The back end
+ * may still be running, so the same request is sent again over D-Bus and
+ * completes through sss_dp_internal_get_done(). */
+static errno_t sss_dp_internal_packed_fallback(struct tevent_req *req)
+{
+    struct dp_internal_get_state *state;
+    struct be_conn *be_conn;
+    DBusMessage *msg = NULL;
+    dbus_bool_t dbret;
+    uint32_t dp_flags;
+    uint32_t entry_type;
+    uint32_t attrs_type;
+    const char *filter;
+    const char *domain;
+    const char *extra;
+    errno_t ret;
+
+    state = tevent_req_data(req, struct dp_internal_get_state);
+
+    if (state->opcode != IFACE_DP_GETACCOUNTINFO_OPCODE
+            || state->body == NULL) {
+        return ERR_OFFLINE;
+    }
+
+    ret = iface_dp_getAccountInfo_unpack(state->body, &dp_flags, &entry_type,
+                                         &attrs_type, &filter, &domain,
+                                         &extra);
+    if (ret != EOK) {
+        goto done;
+    }
+
+    ret = sss_dp_get_domain_conn(state->rctx, state->dom->conn_name,
+                                 &be_conn);
+    if (ret != EOK) {
+        goto done;
+    }
+
+    msg = dbus_message_new_method_call(NULL,
+                                       DP_PATH,
+                                       IFACE_DP,
+                                       IFACE_DP_GETACCOUNTINFO);
+    if (msg == NULL) {
+        ret = ENOMEM;
+        goto done;
+    }
+
+    dbret = dbus_message_append_args(msg,
+                                     DBUS_TYPE_UINT32, &dp_flags,
+                                     DBUS_TYPE_UINT32, &entry_type,
+                                     DBUS_TYPE_UINT32, &attrs_type,
+                                     DBUS_TYPE_STRING, &filter,
+                                     DBUS_TYPE_STRING, &domain,
+                                     DBUS_TYPE_STRING, &extra,
+                                     DBUS_TYPE_INVALID);
+    if (!dbret) {
+        ret = ENOMEM;
+        goto done;
+    }
+
+    ret = sbus_message_append_trace_id(msg, state->trace_id);
+    if (ret != EOK) {
+        goto done;
+    }
+
+    ret = sbus_conn_send(be_conn->conn, msg,
+                         SSS_CLI_SOCKET_TIMEOUT / 2,
+                         sss_dp_internal_get_done,
+                         req,
+                         &state->sdp_req->pending_reply);
+    if (ret != EOK) {
+        goto done;
+    }
+
+    DEBUG(SSSDBG_TRACE_FUNC, "Packed connection was lost, request [%s] "
+          "was resent over D-Bus\n", state->sdp_req->key->str);
+
+done:
+    if (msg != NULL) {
+        dbus_message_unref(msg);
+    }
+    talloc_zfree(state->body);
+
+    return ret;
+}
+
+static void sss_dp_internal_packed_done(struct tevent_req *subreq)
+{
+    struct dp_internal_get_state *state;
+    struct sbus_packed_buf *reply;
+    struct sss_dp_req *sdp_req;
+    struct tevent_req *req;
+    const char *err_msg;
+    errno_t ret;
+
+    req = tevent_req_callback_data(subreq, struct tevent_req);
+    state = tevent_req_data(req, struct dp_internal_get_state);
+    sdp_req = state->sdp_req;
+
+    ret = sbus_packed_call_recv(state, subreq, &reply);
+    talloc_zfree(subreq);
+    if (ret == ERR_OFFLINE) {
+        ret = sss_dp_internal_packed_fallback(req);
+        if (ret == EOK) {
+            return;
+        }
+        DEBUG(SSSDBG_OP_FAILURE, "Unable to resend request over D-Bus "
+              "[%d]: %s\n", ret, sss_strerror(ret));
+    }
+
+    if (ret == EOK) {
+        /* All requests issued through this path reply with the standard
+         * (dp_error, error, message) triple. */
+        ret = iface_dp_getAccountInfo_unpack_reply(reply,
+                                                   &sdp_req->dp_err,
+                                                   &sdp_req->dp_ret,
+                                                   &err_msg);
+        if (ret == EOK) {
+            sdp_req->err_msg = talloc_strdup(sdp_req, err_msg);
+        }
+        talloc_free(reply);
+    }
+
+    if (ret == ETIMEDOUT) {
+        ret = ETIME;
+        sdp_req->dp_err = DP_ERR_TIMEOUT;
+        sdp_req->dp_ret = ret;
+        sdp_req->err_msg = talloc_strdup(sdp_req, "Request timed out");
+    } else if (ret != EOK) {
+        sdp_req->dp_err = DP_ERR_FATAL;
+        sdp_req->dp_ret = ret;
+        sdp_req->err_msg =
+            talloc_strdup(sdp_req,
+                          "Failed to get reply from Data Provider");
+    }
+
+    sss_dp_req_notify(sdp_req, ret);
+
+    /* We're done with this request. Free the sdp_req
+     * This will clean up the hash table entry as well
+     */
+    talloc_zfree(sdp_req);
+
+    if (ret == EOK) {
+        tevent_req_done(req);
+    } else {
+        tevent_req_error(req, ret);
+    }
+}
+
+/* Account requests that are issued within rctx->dp_batch_window
+ * milliseconds for the same domain are collected into a batch and sent
+ * to the data provider as a single getAccountInfoBatch call. Each item
+ * still has its own sss_dp_req so deduplication and timeouts work the
+ * same way as for single requests. */
+struct sss_dp_batch_item;
+
+struct sss_dp_batch {
+    struct sss_dp_batch *prev;
+    struct sss_dp_batch *next;
+
+    struct resp_ctx *rctx;
+    struct sss_domain_info *dom;
+    uint32_t dp_flags;
+
+    bool open;
+    struct tevent_timer *timer;
+    DBusPendingCall *pending_reply;
+
+    struct sss_dp_batch_item **items;
+    uint32_t count;
+};
+
+struct sss_dp_batch_item {
+    struct sss_dp_batch *batch;
+    uint32_t index;
+
+    struct tevent_req *req;
+    struct sss_dp_req *sdp_req;
+    uint64_t trace_id;
+
+    uint32_t entry_type;
+    uint32_t attrs_type;
+    char *filter;
+    const char *extra;
+};
+
+static int sss_dp_batch_destructor(struct sss_dp_batch *batch)
+{
+    uint32_t i;
+
+    if (batch->pending_reply != NULL) {
+        dbus_pending_call_cancel(batch->pending_reply);
+        batch->pending_reply = NULL;
+    }
+
+    if (batch->open) {
+        DLIST_REMOVE(batch->rctx->dp_batches, batch);
+    }
+
+    /* Remaining items are owned by their requests. */
+    for (i = 0; i < batch->count; i++) {
+        if (batch->items[i] != NULL) {
+            batch->items[i]->batch = NULL;
+        }
+    }
+
+    return 0;
+}
+
+static int sss_dp_batch_item_destructor(struct sss_dp_batch_item *item)
+{
+    if (item->batch != NULL) {
+        item->batch->items[item->index] = NULL;
+    }
+
+    return 0;
+}
+
+static void sss_dp_batch_close(struct sss_dp_batch *batch)
+{
+    if (batch->open) {
+        DLIST_REMOVE(batch->rctx->dp_batches, batch);
+        batch->open = false;
+    }
+}
+
+static void sss_dp_batch_flush(struct tevent_context *ev,
+                               struct tevent_timer *te,
+                               struct timeval tv,
+                               void *pvt);
+
+static struct sss_dp_batch *
+sss_dp_batch_get(struct resp_ctx *rctx,
+                 struct sss_domain_info *dom,
+                 uint32_t dp_flags)
+{
+    struct sss_dp_batch *batch;
+    struct timeval tv;
+
+    DLIST_FOR_EACH(batch, rctx->dp_batches) {
+        if (batch->dom == dom && batch->dp_flags == dp_flags) {
+            return batch;
+        }
+    }
+
+    batch = talloc_zero(rctx, struct sss_dp_batch);
+    if (batch == NULL) {
+        return NULL;
+    }
+
+    batch->rctx = rctx;
+    batch->dom = dom;
+    batch->dp_flags = dp_flags;
+
+    batch->items = talloc_zero_array(batch, struct sss_dp_batch_item *,
+                                     DP_ACCOUNT_BATCH_MAX);
+    if (batch->items == NULL) {
+        talloc_free(batch);
+        return NULL;
+    }
+
+    tv = tevent_timeval_current_ofs(0, rctx->dp_batch_window * 1000);
+    batch->timer = tevent_add_timer(rctx->ev, batch, tv,
+                                    sss_dp_batch_flush, batch);
+    if (batch->timer == NULL) {
+        talloc_free(batch);
+        return NULL;
+    }
+
+    batch->open = true;
+    DLIST_ADD(rctx->dp_batches, batch);
+    talloc_set_destructor(batch, sss_dp_batch_destructor);
+
+    return batch;
+}
+
+static struct tevent_req *
+sss_dp_internal_batch_send(struct resp_ctx *rctx,
+                           hash_key_t *key,
+                           struct sss_domain_info *dom,
+                           struct sss_dp_account_info *info)
+{
+    errno_t ret;
+    int hret;
+    struct tevent_req *req;
+    struct dp_internal_get_state *state;
+    struct sss_dp_batch *batch;
+    struct sss_dp_batch_item *item;
+    uint32_t dp_flags;
+    hash_value_t value;
+
+    /* See sss_dp_internal_get_send() for why this is allocated on rctx. */
+    req = tevent_req_create(rctx,
+                            &state,
+                            struct dp_internal_get_state);
+    if (!req)  return NULL;
+
+    state->rctx = rctx;
+    state->dom = dom;
+
+    state->sdp_req = talloc_zero(state, struct sss_dp_req);
+    if (!state->sdp_req) {
+        ret = ENOMEM;
+        goto error;
+    }
+    state->sdp_req->rctx = rctx;
+    state->sdp_req->ev = rctx->ev;
+    state->sdp_req->key = talloc_steal(state->sdp_req, key);
+
+    item = talloc_zero(state->sdp_req, struct sss_dp_batch_item);
+    if (item == NULL) {
+        ret = ENOMEM;
+        goto error;
+    }
+    item->req = req;
+    item->sdp_req = state->sdp_req;
+    item->trace_id = sss_trace_current();
+
+    ret = sss_dp_get_account_args(info, &dp_flags, &item->entry_type,
+                                  &item->attrs_type, &item->filter);
+    if (ret != EOK) {
+        goto error;
+    }
+    talloc_steal(item, item->filter);
+
+    item->extra = talloc_strdup(item, info->extra);
+    if (item->extra == NULL) {
+        ret = ENOMEM;
+        goto error;
+    }
+
+    batch = sss_dp_batch_get(rctx, dom, dp_flags);
+    if (batch == NULL) {
+        ret = ENOMEM;
+        goto error;
+    }
+
+    /* Add this sdp_req to the hash table */
+    value.type = HASH_VALUE_PTR;
+    value.ptr = state->sdp_req;
+
+    DEBUG(SSSDBG_TRACE_FUNC, "Entering batched request [%s]\n", key->str);
+    hret = hash_enter(rctx->dp_request_table, key, &value);
+    if (hret != HASH_SUCCESS) {
+        DEBUG(SSSDBG_CRIT_FAILURE,
+              "Could not store request query (%s)\n",
+               hash_error_string(hret));
+        ret = EIO;
+        goto error;
+    }
+    talloc_set_destructor((TALLOC_CTX *)state->sdp_req,
+                          sss_dp_req_destructor);
+
+    item->batch = batch;
+    item->index = batch->count;
+    batch->items[batch->count] = item;
+    batch->count++;
+    talloc_set_destructor(item, sss_dp_batch_item_destructor);
+
+    if (batch->count == DP_ACCOUNT_BATCH_MAX) {
+        /* The batch is full, send it right away. */
+        sss_dp_batch_close(batch);
+        talloc_zfree(batch->timer);
+        batch->timer = tevent_add_timer(rctx->ev, batch,
+                                        tevent_timeval_current(),
+                                        sss_dp_batch_flush, batch);
+        if (batch->timer == NULL) {
+            /* The sdp_req is in the hash table now, it will be failed
+             * by the standard request timeout. */
+            DEBUG(SSSDBG_CRIT_FAILURE, "Out of memory?!\n");
+        }
+    }
+
+    return req;
+
+error:
+    tevent_req_error(req, ret);
+    tevent_req_post(req, rctx->ev);
+    return req;
+}
+
+static DBusMessage *
+sss_dp_batch_msg(struct sss_dp_batch *batch, uint64_t trace_id)
+{
+    TALLOC_CTX *tmp_ctx;
+    DBusMessage *msg = NULL;
+    DBusMessageIter iter;
+    DBusMessageIter array_iter;
+    uint32_t *entry_types;
+    const char **filters;
+    const char **extras;
+    uint32_t attrs_type;
+    dbus_bool_t dbret;
+    uint32_t i;
+
+    tmp_ctx = talloc_new(NULL);
+    if (tmp_ctx == NULL) {
+        return NULL;
+    }
+
+    entry_types = talloc_array(tmp_ctx, uint32_t, batch->count);
+    filters = talloc_array(tmp_ctx, const char *, batch->count);
+    extras = talloc_array(tmp_ctx, const char *, batch->count);
+    if (entry_types == NULL || filters == NULL || extras == NULL) {
+        goto fail;
+    }
+
+    /* The attribute type is the same for all account requests. */
+    attrs_type = batch->items[0]->attrs_type;
+    for (i = 0; i < batch->count; i++) {
+        entry_types[i] = batch->items[i]->entry_type;
+        filters[i] = batch->items[i]->filter;
+        extras[i] = batch->items[i]->extra;
+    }
+
+    msg = dbus_message_new_method_call(NULL,
+                                       DP_PATH,
+                                       IFACE_DP,
+                                       IFACE_DP_GETACCOUNTINFOBATCH);
+    if (msg == NULL) {
+        goto fail;
+    }
+
+    dbus_message_iter_init_append(msg, &iter);
+
+    dbret = dbus_message_iter_append_basic(&iter, DBUS_TYPE_UINT32,
+                                           &batch->dp_flags);
+    if (!dbret) goto fail;
+
+    dbret = dbus_message_iter_open_container(&iter, DBUS_TYPE_ARRAY,
+                                             DBUS_TYPE_UINT32_AS_STRING,
+                                             &array_iter);
+    if (!dbret) goto fail;
+    dbret = dbus_message_iter_append_fixed_array(&array_iter,
+                                                 DBUS_TYPE_UINT32,
+                                                 &entry_types, batch->count);
+    if (!dbret) goto fail;
+    dbret = dbus_message_iter_close_container(&iter, &array_iter);
+    if (!dbret) goto fail;
+
+    dbret = dbus_message_iter_append_basic(&iter, DBUS_TYPE_UINT32,
+                                           &attrs_type);
+    if (!dbret) goto fail;
+
+    dbret = dbus_message_iter_open_container(&iter, DBUS_TYPE_ARRAY,
+                                             DBUS_TYPE_STRING_AS_STRING,
+                                             &array_iter);
+    if (!dbret) goto fail;
+    for (i = 0; i < batch->count; i++) {
+        dbret = dbus_message_iter_append_basic(&array_iter, DBUS_TYPE_STRING,
+                                               &filters[i]);
+        if (!dbret) goto fail;
+    }
+    dbret = dbus_message_iter_close_container(&iter, &array_iter);
+    if (!dbret) goto fail;
+
+    dbret = dbus_message_iter_append_basic(&iter, DBUS_TYPE_STRING,
+                                           &batch->dom->name);
+    if (!dbret) goto fail;
+
+    dbret = dbus_message_iter_open_container(&iter, DBUS_TYPE_ARRAY,
+                                             DBUS_TYPE_STRING_AS_STRING,
+                                             &array_iter);
+    if (!dbret) goto fail;
+    for (i = 0; i < batch->count; i++) {
+        dbret = dbus_message_iter_append_basic(&array_iter, DBUS_TYPE_STRING,
+                                               &extras[i]);
+        if (!dbret) goto fail;
+    }
+    dbret = dbus_message_iter_close_container(&iter, &array_iter);
+    if (!dbret) goto fail;
+
+    dbret = dbus_message_iter_append_basic(&iter, DBUS_TYPE_UINT64,
+                                           &trace_id);
+    if (!dbret) goto fail;
+
+    talloc_free(tmp_ctx);
+    return msg;
+
+fail:
+    DEBUG(SSSDBG_CRIT_FAILURE, "Failed to build message\n");
+    if (msg != NULL) {
+        dbus_message_unref(msg);
+    }
+    talloc_free(tmp_ctx);
+    return NULL;
+}
+
+static void sss_dp_batch_done(DBusPendingCall *pending, void *ptr);
+static void sss_dp_batch_finish(struct sss_dp_batch *batch,
+                                errno_t error,
+                                uint16_t *dp_errors,
+                                uint32_t *errors,
+                                char **messages);
+
+static void sss_dp_batch_flush(struct tevent_context *ev,
+                               struct tevent_timer *te,
+                               struct timeval tv,
+                               void *pvt)
+{
+    struct sss_dp_batch *batch;
+    struct be_conn *be_conn;
+    DBusMessage *msg;
+    uint64_t trace_id = 0;
+    uint32_t count;
+    uint32_t i;
+    errno_t ret;
+
+    batch = talloc_get_type(pvt, struct sss_dp_batch);
+    batch->timer = NULL;
+    sss_dp_batch_close(batch);
+
+    /* Drop items whose requests went away while the batch was open. */
+    for (i = 0, count = 0; i < batch->count; i++) {
+        if (batch->items[i] == NULL) {
+            continue;
+        }
+
+        batch->items[count] = batch->items[i];
+        batch->items[count]->index = count;
+        if (trace_id == 0) {
+            trace_id = batch->items[count]->trace_id;
+        }
+        count++;
+    }
+    batch->count = count;
+
+    if (batch->count == 0) {
+        talloc_free(batch);
+        return;
+    }
+
+    DEBUG(SSSDBG_TRACE_FUNC, "Sending batch of %u requests for [%s]\n",
+          batch->count, batch->dom->name);
+
+    ret = sss_dp_get_domain_conn(batch->rctx, batch->dom->conn_name,
+                                 &be_conn);
+    if (ret != EOK) {
+        DEBUG(SSSDBG_CRIT_FAILURE,
+              "BUG: The Data Provider connection for %s is not available!\n",
+              batch->dom->name);
+        sss_dp_batch_finish(batch, EIO, NULL, NULL, NULL);
+        return;
+    }
+
+    /* The whole batch is traced as the first request that joined it. */
+    msg = sss_dp_batch_msg(batch, trace_id);
+    if (msg == NULL) {
+        sss_dp_batch_finish(batch, ENOMEM, NULL, NULL, NULL);
+        return;
+    }
+
+    ret = sbus_conn_send(be_conn->conn, msg,
+                         SSS_CLI_SOCKET_TIMEOUT / 2,
+                         sss_dp_batch_done,
+                         batch,
+                         &batch->pending_reply);
+    dbus_message_unref(msg);
+    if (ret != EOK) {
+        DEBUG(SSSDBG_CRIT_FAILURE, "D-BUS send failed.\n");
+        sss_dp_batch_finish(batch, EIO, NULL, NULL, NULL);
+        return;
+    }
+}
+
+static errno_t sss_dp_batch_get_reply(DBusPendingCall *pending,
+                                      uint32_t count,
+                                      uint16_t **_dp_errors,
+                                      uint32_t **_errors,
+                                      char ***_messages)
+{
+    DBusMessage *reply;
+    DBusError dbus_error;
+    uint16_t *dp_errors;
+    uint32_t *errors;
+    char **messages;
+    int num_dp_errors;
+    int num_errors;
+    int num_messages;
+    dbus_bool_t dbret;
+    errno_t ret;
+
+    dbus_error_init(&dbus_error);
+
+    reply = dbus_pending_call_steal_reply(pending);
+    if (reply == NULL) {
+        DEBUG(SSSDBG_CRIT_FAILURE,
+              "Severe error. A reply callback was called but no reply "
+               "was received and no timeout occurred\n");
+        ret = EIO;
+        goto done;
+    }
+
+    switch (dbus_message_get_type(reply)) {
+    case DBUS_MESSAGE_TYPE_METHOD_RETURN:
+        dbret = dbus_message_get_args(reply, &dbus_error,
+                                      DBUS_TYPE_ARRAY, DBUS_TYPE_UINT16,
+                                      &dp_errors, &num_dp_errors,
+                                      DBUS_TYPE_ARRAY, DBUS_TYPE_UINT32,
+                                      &errors, &num_errors,
+                                      DBUS_TYPE_ARRAY, DBUS_TYPE_STRING,
+                                      &messages, &num_messages,
+                                      DBUS_TYPE_INVALID);
+        if (!dbret) {
+            DEBUG(SSSDBG_CRIT_FAILURE, "Failed to parse message\n");
+            if (dbus_error_is_set(&dbus_error)) dbus_error_free(&dbus_error);
+            ret = EIO;
+            goto done;
+        }
+
+        if (num_dp_errors != (int)count || num_errors != (int)count
+                || num_messages != (int)count) {
+            DEBUG(SSSDBG_CRIT_FAILURE, "Batch reply has wrong size: "
+                  "expected %u, got %d/%d/%d\n", count,
+                  num_dp_errors, num_errors, num_messages);
+            dbus_free_string_array(messages);
+            ret = EIO;
+            goto done;
+        }
+        break;
+
+    case DBUS_MESSAGE_TYPE_ERROR:
+        if (strcmp(dbus_message_get_error_name(reply),
+                   DBUS_ERROR_NO_REPLY) == 0) {
+            ret = ETIME;
+            goto done;
+        }
+        DEBUG(SSSDBG_FATAL_FAILURE,"The Data Provider returned an error [%s]\n",
+                 dbus_message_get_error_name(reply));
+        ret = EIO;
+        goto done;
+
+    default:
+        ret = EIO;
+        goto done;
+    }
+
+    /* The fixed arrays point inside the reply, copy them. */
+    *_dp_errors = talloc_memdup(NULL, dp_errors, count * sizeof(uint16_t));
+    *_errors = talloc_memdup(NULL, errors, count * sizeof(uint32_t));
+    *_messages = messages;
+    if (*_dp_errors == NULL || *_errors == NULL) {
+        talloc_zfree(*_dp_errors);
+        talloc_zfree(*_errors);
+        dbus_free_string_array(messages);
+        ret = ENOMEM;
+        goto done;
+    }
+
+    ret = EOK;
+
+done:
+    dbus_pending_call_unref(pending);
+    if (reply != NULL) {
+        dbus_message_unref(reply);
+    }
+
+    return ret;
+}
+
+static void sss_dp_batch_finish(struct sss_dp_batch *batch,
+                                errno_t error,
+                                uint16_t *dp_errors,
+                                uint32_t *errors,
+                                char **messages)
+{
+    struct sss_dp_batch_item *item;
+    struct sss_dp_req *sdp_req;
+    struct tevent_req *req;
+    uint32_t i;
+
+    for (i = 0; i < batch->count; i++) {
+        item = batch->items[i];
+        if (item == NULL) {
+            /* The request was freed while waiting for the reply. */
+            continue;
+        }
+
+        /* Detach the item so its destructor does not touch the batch. */
+        item->batch = NULL;
+        batch->items[i] = NULL;
+
+        req = item->req;
+        sdp_req = item->sdp_req;
+
+        if (error == EOK) {
+            sdp_req->dp_err = dp_errors[i];
+            sdp_req->dp_ret = errors[i];
+            sdp_req->err_msg = talloc_strdup(sdp_req, messages[i]);
+        } else if (error == ETIME) {
+            sdp_req->dp_err = DP_ERR_TIMEOUT;
+            sdp_req->dp_ret = error;
+            sdp_req->err_msg = talloc_strdup(sdp_req, "Request timed out");
+        } else {
+            sdp_req->dp_err = DP_ERR_FATAL;
+            sdp_req->dp_ret = error;
+            sdp_req->err_msg =
+                talloc_strdup(sdp_req,
+                              "Failed to get reply from Data Provider");
+        }
+
+        sss_dp_req_notify(sdp_req, error);
+
+        /* We're done with this request. Free the sdp_req
+         * This will clean up the hash table entry as well
+         */
+        talloc_free(sdp_req);
+
+        if (error == EOK) {
+            tevent_req_done(req);
+        } else {
+            tevent_req_error(req, error);
+        }
+    }
+
+    talloc_free(batch);
+}
+
+static void sss_dp_batch_done(DBusPendingCall *pending, void *ptr)
+{
+    struct sss_dp_batch *batch;
+    uint16_t *dp_errors = NULL;
+    uint32_t *errors = NULL;
+    char **messages = NULL;
+    errno_t ret;
+
+    batch = talloc_get_type(ptr, struct sss_dp_batch);
+
+    /* prevent trying to cancel a reply that we already received */
+    batch->pending_reply = NULL;
+
+    ret = sss_dp_batch_get_reply(pending, batch->count,
+                                 &dp_errors, &errors, &messages);
+
+    DEBUG(SSSDBG_TRACE_LIBS, "Got batch reply from Data Provider for [%s] "
+          "[%d]: %s\n", batch->dom->name, ret, sss_strerror(ret));
+
+    sss_dp_batch_finish(batch, ret, dp_errors, errors, messages);
+
+    talloc_free(dp_errors);
+    talloc_free(errors);
+    if (messages != NULL) {
+        dbus_free_string_array(messages);
+    }
+}
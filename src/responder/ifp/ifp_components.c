@@ -29,6 +29,7 @@
 #include "util/util.h"
 #include "responder/common/responder.h"
 #include "responder/ifp/ifp_components.h"
+#include "monitor/monitor_interfaces.h"
 
 #ifdef HAVE_CONFIG_LIB
 #include "util/sss_config.h"
@@ -731,6 +732,78 @@ done:
     return iface_ifp_components_ChangeDebugLevelTemporarily_finish(dbus_req);
 }
 
+static void ifp_component_get_perf_stats_done(DBusPendingCall *pending,
+                                              void *ptr)
+{
+    struct sbus_request *dbus_req;
+
+    dbus_req = talloc_get_type(ptr, struct sbus_request);
+
+    sbus_request_forward_reply(dbus_req, pending);
+}
+
+int ifp_component_get_perf_stats(struct sbus_request *dbus_req, void *data)
+{
+    struct ifp_ctx *ctx = NULL;
+    DBusError *error = NULL;
+    DBusMessage *msg = NULL;
+    char *name = NULL;
+    const char *svc_name;
+    enum component_type type;
+    dbus_bool_t dbret;
+    errno_t ret;
+
+    ctx = talloc_get_type(data, struct ifp_ctx);
+    if (ctx == NULL) {
+        DEBUG(SSSDBG_CRIT_FAILURE, "Invalid ifp context!\n");
+        ret = EINVAL;
+        goto done;
+    }
+
+    ret = check_and_get_component_from_path(dbus_req, ctx->rctx->cdb,
+                                            dbus_req->path, &type, &name);
+    if (ret != EOK) {
+        goto done;
+    }
+
+    if (ctx->rctx->mon_conn == NULL) {
+        ret = ENOTCONN;
+        goto done;
+    }
+
+    /* The monitor reports its own statistics for an empty name. */
+    svc_name = type == COMPONENT_MONITOR ? "" : name;
+
+    msg = dbus_message_new_method_call(NULL, MON_SRV_PATH, MON_SRV_IFACE,
+                                       MON_SRV_IFACE_GETPERFSTATS);
+    if (msg == NULL) {
+        ret = ENOMEM;
+        goto done;
+    }
+
+    dbret = dbus_message_append_args(msg, DBUS_TYPE_STRING, &svc_name,
+                                     DBUS_TYPE_INVALID);
+    if (!dbret) {
+        ret = ENOMEM;
+        goto done;
+    }
+
+    ret = sbus_conn_send(ctx->rctx->mon_conn, msg, 30000,
+                         ifp_component_get_perf_stats_done, dbus_req, NULL);
+
+done:
+    if (msg != NULL) {
+        dbus_message_unref(msg);
+    }
+
+    if (ret != EOK) {
+        error = sbus_error_new(dbus_req, DBUS_ERROR_FAILED, "%s", strerror(ret));
+        return sbus_request_fail_and_finish(dbus_req, error);
+    }
+
+    return EOK;
+}
+
 void ifp_component_get_name(struct sbus_request *dbus_req,
                             void *data,
                             const char **_out)
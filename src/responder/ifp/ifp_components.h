@@ -56,6 +56,8 @@ int ifp_component_change_debug_level_tmp(struct sbus_request *dbus_req,
                                          void *data,
                                          uint32_t arg_new_level);
 
+int ifp_component_get_perf_stats(struct sbus_request *dbus_req, void *data);
+
 void ifp_component_get_name(struct sbus_request *dbus_req,
                             void *data,
                             const char **_out);
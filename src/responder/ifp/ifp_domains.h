@@ -108,4 +108,10 @@ int ifp_domains_domain_list_servers(struct sbus_request *sbus_req,
                                     void *data,
                                     const char *service);
 
+int ifp_domains_domain_scheduler_stats(struct sbus_request *sbus_req,
+                                       void *data);
+
+int ifp_domains_domain_dns_cache_stats(struct sbus_request *sbus_req,
+                                       void *data);
+
 #endif /* IFP_DOMAINS_H_ */
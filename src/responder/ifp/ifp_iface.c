@@ -51,6 +51,7 @@ struct iface_ifp_components iface_ifp_components = {
     .Disable = ifp_component_disable,
     .ChangeDebugLevel = ifp_component_change_debug_level,
     .ChangeDebugLevelTemporarily = ifp_component_change_debug_level_tmp,
+    .GetPerfStats = ifp_component_get_perf_stats,
     .get_name = ifp_component_get_name,
     .get_debug_level = ifp_component_get_debug_level,
     .get_enabled = ifp_component_get_enabled,
@@ -83,7 +84,9 @@ struct iface_ifp_domains_domain iface_ifp_domains_domain = {
     .IsOnline = ifp_domains_domain_is_online,
     .ListServices = ifp_domains_domain_list_services,
     .ActiveServer = ifp_domains_domain_active_server,
-    .ListServers = ifp_domains_domain_list_servers
+    .ListServers = ifp_domains_domain_list_servers,
+    .SchedulerStats = ifp_domains_domain_scheduler_stats,
+    .DNSCacheStats = ifp_domains_domain_dns_cache_stats
 };
 
 struct iface_ifp_users iface_ifp_users = {
@@ -299,6 +299,19 @@ int iface_ifp_components_ChangeDebugLevelTemporarily_finish(struct sbus_request
                                          DBUS_TYPE_INVALID);
 }
 
+/* arguments for org.freedesktop.sssd.infopipe.Components.GetPerfStats */
+const struct sbus_arg_meta iface_ifp_components_GetPerfStats__out[] = {
+    { "stats", "s" },
+    { NULL, }
+};
+
+int iface_ifp_components_GetPerfStats_finish(struct sbus_request *req, const char *arg_stats)
+{
+   return sbus_request_return_and_finish(req,
+                                         DBUS_TYPE_STRING, &arg_stats,
+                                         DBUS_TYPE_INVALID);
+}
+
 /* methods for org.freedesktop.sssd.infopipe.Components */
 const struct sbus_method_meta iface_ifp_components__methods[] = {
     {
@@ -329,6 +342,13 @@ const struct sbus_method_meta iface_ifp_components__methods[] = {
         offsetof(struct iface_ifp_components, ChangeDebugLevelTemporarily),
         invoke_u_method,
     },
+    {
+        "GetPerfStats", /* name */
+        NULL, /* no in_args */
+        iface_ifp_components_GetPerfStats__out,
+        offsetof(struct iface_ifp_components, GetPerfStats),
+        NULL, /* no invoker */
+    },
     { NULL, }
 };
 
@@ -596,6 +616,54 @@ int iface_ifp_domains_domain_ListServers_finish(struct sbus_request *req, const
                                          DBUS_TYPE_INVALID);
 }
 
+/* arguments for org.freedesktop.sssd.infopipe.Domains.Domain.SchedulerStats */
+const struct sbus_arg_meta iface_ifp_domains_domain_SchedulerStats__out[] = {
+    { "targets", "as" },
+    { "limits", "au" },
+    { "active", "au" },
+    { "queued", "au" },
+    { "max_queued", "au" },
+    { "started", "at" },
+    { "delayed", "at" },
+    { "wait_total", "at" },
+    { "wait_max", "at" },
+    { NULL, }
+};
+
+int iface_ifp_domains_domain_SchedulerStats_finish(struct sbus_request *req, const char *arg_targets[], int len_targets, uint32_t arg_limits[], int len_limits, uint32_t arg_active[], int len_active, uint32_t arg_queued[], int len_queued, uint32_t arg_max_queued[], int len_max_queued, uint64_t arg_started[], int len_started, uint64_t arg_delayed[], int len_delayed, uint64_t arg_wait_total[], int len_wait_total, uint64_t arg_wait_max[], int len_wait_max)
+{
+   return sbus_request_return_and_finish(req,
+                                         DBUS_TYPE_ARRAY, DBUS_TYPE_STRING, &arg_targets, len_targets,
+                                         DBUS_TYPE_ARRAY, DBUS_TYPE_UINT32, &arg_limits, len_limits,
+                                         DBUS_TYPE_ARRAY, DBUS_TYPE_UINT32, &arg_active, len_active,
+                                         DBUS_TYPE_ARRAY, DBUS_TYPE_UINT32, &arg_queued, len_queued,
+                                         DBUS_TYPE_ARRAY, DBUS_TYPE_UINT32, &arg_max_queued, len_max_queued,
+                                         DBUS_TYPE_ARRAY, DBUS_TYPE_UINT64, &arg_started, len_started,
+                                         DBUS_TYPE_ARRAY, DBUS_TYPE_UINT64, &arg_delayed, len_delayed,
+                                         DBUS_TYPE_ARRAY, DBUS_TYPE_UINT64, &arg_wait_total, len_wait_total,
+                                         DBUS_TYPE_ARRAY, DBUS_TYPE_UINT64, &arg_wait_max, len_wait_max,
+                                         DBUS_TYPE_INVALID);
+}
+
+/* arguments for org.freedesktop.sssd.infopipe.Domains.Domain.DNSCacheStats */
+const struct sbus_arg_meta iface_ifp_domains_domain_DNSCacheStats__out[] = {
+    { "hits", "t" },
+    { "negative_hits", "t" },
+    { "misses", "t" },
+    { "entries", "u" },
+    { NULL, }
+};
+
+int iface_ifp_domains_domain_DNSCacheStats_finish(struct sbus_request *req, uint64_t arg_hits, uint64_t arg_negative_hits, uint64_t arg_misses, uint32_t arg_entries)
+{
+   return sbus_request_return_and_finish(req,
+                                         DBUS_TYPE_UINT64, &arg_hits,
+                                         DBUS_TYPE_UINT64, &arg_negative_hits,
+                                         DBUS_TYPE_UINT64, &arg_misses,
+                                         DBUS_TYPE_UINT32, &arg_entries,
+                                         DBUS_TYPE_INVALID);
+}
+
 /* methods for org.freedesktop.sssd.infopipe.Domains.Domain */
 const struct sbus_method_meta iface_ifp_domains_domain__methods[] = {
     {
@@ -626,6 +694,20 @@ const struct sbus_method_meta iface_ifp_domains_domain__methods[] = {
         offsetof(struct iface_ifp_domains_domain, ListServers),
         invoke_s_method,
     },
+    {
+        "SchedulerStats", /* name */
+        NULL, /* no in_args */
+        iface_ifp_domains_domain_SchedulerStats__out,
+        offsetof(struct iface_ifp_domains_domain, SchedulerStats),
+        NULL, /* no invoker */
+    },
+    {
+        "DNSCacheStats", /* name */
+        NULL, /* no in_args */
+        iface_ifp_domains_domain_DNSCacheStats__out,
+        offsetof(struct iface_ifp_domains_domain, DNSCacheStats),
+        NULL, /* no invoker */
+    },
     { NULL, }
 };
 
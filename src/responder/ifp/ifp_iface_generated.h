@@ -31,6 +31,7 @@
 #define IFACE_IFP_COMPONENTS_DISABLE "Disable"
 #define IFACE_IFP_COMPONENTS_CHANGEDEBUGLEVEL "ChangeDebugLevel"
 #define IFACE_IFP_COMPONENTS_CHANGEDEBUGLEVELTEMPORARILY "ChangeDebugLevelTemporarily"
+#define IFACE_IFP_COMPONENTS_GETPERFSTATS "GetPerfStats"
 #define IFACE_IFP_COMPONENTS_NAME "name"
 #define IFACE_IFP_COMPONENTS_DEBUG_LEVEL "debug_level"
 #define IFACE_IFP_COMPONENTS_ENABLED "enabled"
@@ -60,6 +61,8 @@
 #define IFACE_IFP_DOMAINS_DOMAIN_LISTSERVICES "ListServices"
 #define IFACE_IFP_DOMAINS_DOMAIN_ACTIVESERVER "ActiveServer"
 #define IFACE_IFP_DOMAINS_DOMAIN_LISTSERVERS "ListServers"
+#define IFACE_IFP_DOMAINS_DOMAIN_SCHEDULERSTATS "SchedulerStats"
+#define IFACE_IFP_DOMAINS_DOMAIN_DNSCACHESTATS "DNSCacheStats"
 
 /* constants for org.freedesktop.sssd.infopipe.Cache */
 #define IFACE_IFP_CACHE "org.freedesktop.sssd.infopipe.Cache"
@@ -176,6 +179,7 @@ struct iface_ifp_components {
     int (*Disable)(struct sbus_request *req, void *data);
     int (*ChangeDebugLevel)(struct sbus_request *req, void *data, uint32_t arg_new_level);
     int (*ChangeDebugLevelTemporarily)(struct sbus_request *req, void *data, uint32_t arg_new_level);
+    int (*GetPerfStats)(struct sbus_request *req, void *data);
     void (*get_name)(struct sbus_request *, void *data, const char **);
     void (*get_debug_level)(struct sbus_request *, void *data, uint32_t*);
     void (*get_enabled)(struct sbus_request *, void *data, bool*);
@@ -195,6 +199,9 @@ int iface_ifp_components_ChangeDebugLevel_finish(struct sbus_request *req);
 /* finish function for ChangeDebugLevelTemporarily */
 int iface_ifp_components_ChangeDebugLevelTemporarily_finish(struct sbus_request *req);
 
+/* finish function for GetPerfStats */
+int iface_ifp_components_GetPerfStats_finish(struct sbus_request *req, const char *arg_stats);
+
 /* vtable for org.freedesktop.sssd.infopipe.Domains */
 struct iface_ifp_domains {
     struct sbus_vtable vtable; /* derive from sbus_vtable */
@@ -221,6 +228,8 @@ struct iface_ifp_domains_domain {
     int (*ListServices)(struct sbus_request *req, void *data);
     int (*ActiveServer)(struct sbus_request *req, void *data, const char *arg_service);
     int (*ListServers)(struct sbus_request *req, void *data, const char *arg_service_name);
+    int (*SchedulerStats)(struct sbus_request *req, void *data);
+    int (*DNSCacheStats)(struct sbus_request *req, void *data);
 };
 
 /* finish function for IsOnline */
@@ -235,6 +244,12 @@ int iface_ifp_domains_domain_ActiveServer_finish(struct sbus_request *req, const
 /* finish function for ListServers */
 int iface_ifp_domains_domain_ListServers_finish(struct sbus_request *req, const char *arg_servers[], int len_servers);
 
+/* finish function for SchedulerStats */
+int iface_ifp_domains_domain_SchedulerStats_finish(struct sbus_request *req, const char *arg_targets[], int len_targets, uint32_t arg_limits[], int len_limits, uint32_t arg_active[], int len_active, uint32_t arg_queued[], int len_queued, uint32_t arg_max_queued[], int len_max_queued, uint64_t arg_started[], int len_started, uint64_t arg_delayed[], int len_delayed, uint64_t arg_wait_total[], int len_wait_total, uint64_t arg_wait_max[], int len_wait_max);
+
+/* finish function for DNSCacheStats */
+int iface_ifp_domains_domain_DNSCacheStats_finish(struct sbus_request *req, uint64_t arg_hits, uint64_t arg_negative_hits, uint64_t arg_misses, uint32_t arg_entries);
+
 /* vtable for org.freedesktop.sssd.infopipe.Cache */
 struct iface_ifp_cache {
     struct sbus_vtable vtable; /* derive from sbus_vtable */
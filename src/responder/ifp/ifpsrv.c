@@ -56,6 +56,7 @@ struct mon_cli_iface monitor_ifp_methods = {
     .resetOffline = NULL,
     .rotateLogs = responder_logrotate,
     .sysbusReconnect = ifp_sysbus_reconnect,
+    .perfStats = monitor_common_perf_stats,
 };
 
 struct sss_cmd_table *get_ifp_cmds(void)
@@ -70,6 +70,7 @@ struct mon_cli_iface monitor_nss_methods = {
     .clearMemcache = nss_clear_memcache,
     .clearEnumCache = nss_clear_netgroup_hash_table,
     .sysbusReconnect = NULL,
+    .perfStats = monitor_common_perf_stats,
 };
 
 static int nss_clear_memcache(struct sbus_request *dbus_req, void *data)
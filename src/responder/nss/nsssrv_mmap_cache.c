@@ -24,6 +24,8 @@
 #include <sys/mman.h>
 #include <fcntl.h>
 #include "util/mmap_cache.h"
+#include "util/sss_perf.h"
+#include "util/probes.h"
 #include "responder/nss/nsssrv.h"
 #include "responder/nss/nsssrv_mmap_cache.h"
 
@@ -652,6 +654,8 @@ static inline void sss_mmap_chain_in_rec(struct sss_mc_ctx *mcc,
     sss_mc_add_rec_to_chain(mcc, rec, rec->hash1);
     /* then uid/gid */
     sss_mc_add_rec_to_chain(mcc, rec, rec->hash2);
+
+    sss_perf_count(SSS_PERF_MC_STORE);
 }
 
 /***************************************************************************
@@ -669,6 +673,7 @@ static errno_t sss_mmap_cache_invalidate(struct sss_mc_ctx *mcc,
     }
 
     rec = sss_mc_find_record(mcc, key);
+    PROBE(MC_INVALIDATE, mcc->name, key->str, rec != NULL);
     if (rec == NULL) {
         /* nothing to invalidate */
         return ENOENT;
@@ -754,6 +759,7 @@ errno_t sss_mmap_cache_pw_store(struct sss_mc_ctx **_mcc,
 
     /* finally chain the rec in the hash table */
     sss_mmap_chain_in_rec(mcc, rec);
+    PROBE(MC_STORE, mcc->name, name->str, rec->len);
 
     return EOK;
 }
@@ -820,6 +826,7 @@ errno_t sss_mmap_cache_pw_invalidate_uid(struct sss_mc_ctx *mcc, uid_t uid)
     ret = EOK;
 
 done:
+    PROBE(MC_INVALIDATE, mcc->name, uidstr, ret == EOK);
     talloc_zfree(uidstr);
     return ret;
 }
@@ -893,6 +900,7 @@ int sss_mmap_cache_gr_store(struct sss_mc_ctx **_mcc,
 
     /* finally chain the rec in the hash table */
     sss_mmap_chain_in_rec(mcc, rec);
+    PROBE(MC_STORE, mcc->name, name->str, rec->len);
 
     return EOK;
 }
@@ -959,6 +967,7 @@ errno_t sss_mmap_cache_gr_invalidate_gid(struct sss_mc_ctx *mcc, gid_t gid)
     ret = EOK;
 
 done:
+    PROBE(MC_INVALIDATE, mcc->name, gidstr, ret == EOK);
     talloc_zfree(gidstr);
     return ret;
 }
@@ -1026,6 +1035,7 @@ errno_t sss_mmap_cache_initgr_store(struct sss_mc_ctx **_mcc,
 
     /* finally chain the rec in the hash table */
     sss_mmap_chain_in_rec(mcc, rec);
+    PROBE(MC_STORE, mcc->name, name->str, rec->len);
 
     return EOK;
 }
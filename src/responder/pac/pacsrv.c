@@ -59,6 +59,7 @@ struct mon_cli_iface monitor_pac_methods = {
     .clearMemcache = NULL,
     .clearEnumCache = NULL,
     .sysbusReconnect = NULL,
+    .perfStats = monitor_common_perf_stats,
 };
 
 /* TODO: check if this can be made generic for all responders */
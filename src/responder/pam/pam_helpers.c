@@ -154,3 +154,204 @@ errno_t pam_initgr_check_timeout(hash_table_t *id_table,
     return EOK;
 }
 
+
+struct pam_acct_cache_entry {
+    hash_table_t *table;
+    char *key;
+    char *domain;
+    char *user;
+};
+
+static char *pam_acct_cache_key(TALLOC_CTX *mem_ctx,
+                                const char *domain,
+                                const char *user,
+                                const char *service,
+                                const char *rhost)
+{
+    /* The unit separator can appear in none of the items. */
+    return talloc_asprintf(mem_ctx, "%s\x1f%s\x1f%s\x1f%s", domain, user,
+                           service == NULL ? "" : service,
+                           rhost == NULL ? "" : rhost);
+}
+
+static void pam_acct_cache_entry_remove(struct pam_acct_cache_entry *entry)
+{
+    hash_key_t key;
+    int hret;
+
+    key.type = HASH_KEY_STRING;
+    key.str = entry->key;
+
+    hret = hash_delete(entry->table, &key);
+    if (hret != HASH_SUCCESS && hret != HASH_ERROR_KEY_NOT_FOUND) {
+        DEBUG(SSSDBG_MINOR_FAILURE,
+              "Could not remove [%s@%s] from account cache: [%s]\n",
+              entry->user, entry->domain, hash_error_string(hret));
+    }
+
+    talloc_free(entry);
+}
+
+static void pam_acct_cache_expire(struct tevent_context *ev,
+                                  struct tevent_timer *te,
+                                  struct timeval tv,
+                                  void *pvt)
+{
+    struct pam_acct_cache_entry *entry;
+
+    entry = talloc_get_type(pvt, struct pam_acct_cache_entry);
+
+    DEBUG(SSSDBG_TRACE_INTERNAL,
+          "Account decision for [%s@%s] expired\n", entry->user, entry->domain);
+
+    pam_acct_cache_entry_remove(entry);
+}
+
+errno_t pam_acct_cache_set(struct tevent_context *ev,
+                           hash_table_t *acct_table,
+                           const char *domain,
+                           const char *user,
+                           const char *service,
+                           const char *rhost,
+                           long timeout)
+{
+    struct pam_acct_cache_entry *entry;
+    struct tevent_timer *te;
+    struct timeval tv;
+    hash_key_t key;
+    hash_value_t val;
+    int hret;
+    errno_t ret;
+
+    entry = talloc_zero(acct_table, struct pam_acct_cache_entry);
+    if (entry == NULL) {
+        return ENOMEM;
+    }
+
+    entry->table = acct_table;
+    entry->key = pam_acct_cache_key(entry, domain, user, service, rhost);
+    entry->domain = talloc_strdup(entry, domain);
+    entry->user = talloc_strdup(entry, user);
+    if (entry->key == NULL || entry->domain == NULL || entry->user == NULL) {
+        ret = ENOMEM;
+        goto done;
+    }
+
+    key.type = HASH_KEY_STRING;
+    key.str = entry->key;
+
+    /* Replace an older decision together with its timer. */
+    hret = hash_lookup(acct_table, &key, &val);
+    if (hret == HASH_SUCCESS) {
+        pam_acct_cache_entry_remove(talloc_get_type(val.ptr,
+                                                struct pam_acct_cache_entry));
+    }
+
+    val.type = HASH_VALUE_PTR;
+    val.ptr = entry;
+
+    hret = hash_enter(acct_table, &key, &val);
+    if (hret != HASH_SUCCESS) {
+        DEBUG(SSSDBG_MINOR_FAILURE,
+              "Could not update account cache for [%s@%s]: [%s]\n",
+              user, domain, hash_error_string(hret));
+        ret = EIO;
+        goto done;
+    }
+
+    tv = tevent_timeval_current_ofs(timeout, 0);
+    te = tevent_add_timer(ev, entry, tv, pam_acct_cache_expire, entry);
+    if (te == NULL) {
+        hash_delete(acct_table, &key);
+        ret = ENOMEM;
+        goto done;
+    }
+
+    DEBUG(SSSDBG_TRACE_INTERNAL,
+          "Account decision for [%s@%s] cached for %ld seconds\n",
+          user, domain, timeout);
+
+    ret = EOK;
+
+done:
+    if (ret != EOK) {
+        talloc_free(entry);
+    }
+    return ret;
+}
+
+errno_t pam_acct_cache_check(hash_table_t *acct_table,
+                             const char *domain,
+                             const char *user,
+                             const char *service,
+                             const char *rhost)
+{
+    hash_key_t key;
+    hash_value_t val;
+    char *str;
+    int hret;
+
+    str = pam_acct_cache_key(NULL, domain, user, service, rhost);
+    if (str == NULL) {
+        return ENOMEM;
+    }
+
+    key.type = HASH_KEY_STRING;
+    key.str = str;
+
+    hret = hash_lookup(acct_table, &key, &val);
+    talloc_free(str);
+    if (hret == HASH_ERROR_KEY_NOT_FOUND) {
+        return ENOENT;
+    } else if (hret != HASH_SUCCESS) {
+        DEBUG(SSSDBG_TRACE_ALL,
+              "Error searching [%s@%s] in account cache.\n", user, domain);
+        return EIO;
+    }
+
+    DEBUG(SSSDBG_TRACE_INTERNAL,
+          "Account decision for [%s@%s] found in cache.\n", user, domain);
+    return EOK;
+}
+
+errno_t pam_acct_cache_invalidate(hash_table_t *acct_table,
+                                  const char *domain,
+                                  const char *user)
+{
+    struct pam_acct_cache_entry *entry;
+    hash_value_t *values;
+    unsigned long count;
+    unsigned long i;
+    unsigned int removed = 0;
+    int hret;
+
+    hret = hash_values(acct_table, &count, &values);
+    if (hret != HASH_SUCCESS) {
+        return EIO;
+    }
+
+    for (i = 0; i < count; i++) {
+        entry = talloc_get_type(values[i].ptr, struct pam_acct_cache_entry);
+        if (entry == NULL) {
+            continue;
+        }
+
+        if (domain != NULL && *domain != '\0'
+                && strcasecmp(entry->domain, domain) != 0) {
+            continue;
+        }
+
+        if (user != NULL && *user != '\0' && strcmp(entry->user, user) != 0) {
+            continue;
+        }
+
+        pam_acct_cache_entry_remove(entry);
+        removed++;
+    }
+
+    talloc_free(values);
+
+    DEBUG(SSSDBG_TRACE_FUNC, "Removed %u cached account decisions\n", removed);
+
+    return EOK;
+}
@@ -37,4 +37,29 @@ errno_t pam_initgr_cache_set(struct tevent_context *ev,
 errno_t pam_initgr_check_timeout(hash_table_t *id_table,
                                  char *name);
 
+errno_t pam_acct_cache_set(struct tevent_context *ev,
+                           hash_table_t *acct_table,
+                           const char *domain,
+                           const char *user,
+                           const char *service,
+                           const char *rhost,
+                           long timeout);
+
+/* Returns EOK if a successful account decision is cached for the
+ * user, service and remote host.
+ * Returns ENOENT if there is none or it has expired.
+ */
+errno_t pam_acct_cache_check(hash_table_t *acct_table,
+                             const char *domain,
+                             const char *user,
+                             const char *service,
+                             const char *rhost);
+
+/* Drops cached decisions of the user in the domain. An empty or NULL user
+ * drops all decisions of the domain, an empty or NULL domain all of them.
+ */
+errno_t pam_acct_cache_invalidate(hash_table_t *acct_table,
+                                  const char *domain,
+                                  const char *user);
+
 #endif /* PAM_HELPERS_H_ */
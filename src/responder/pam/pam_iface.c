@@ -0,0 +1,39 @@
+/*
+    SSSD
+
+    PAM responder D-Bus interface
+
+    Copyright (C) 2016 Red Hat
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "sbus/sssd_dbus.h"
+#include "responder/pam/pam_iface.h"
+#include "responder/pam/pamsrv.h"
+
+struct iface_pam_accesscache iface_pam_accesscache = {
+    { &iface_pam_accesscache_meta, 0 },
+    .Invalidate = pam_accesscache_invalidate
+};
+
+static struct sbus_iface_map iface_map[] = {
+    { PAM_ACCESSCACHE_PATH, &iface_pam_accesscache.vtable },
+    { NULL, NULL }
+};
+
+struct sbus_iface_map *pam_get_sbus_interface()
+{
+    return iface_map;
+}
@@ -0,0 +1,31 @@
+/*
+    SSSD
+
+    PAM responder D-Bus interface
+
+    Copyright (C) 2016 Red Hat
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef _PAM_IFACE_H_
+#define _PAM_IFACE_H_
+
+#include "responder/pam/pam_iface_generated.h"
+
+#define PAM_ACCESSCACHE_PATH "/org/freedesktop/sssd/pam/accesscache"
+
+struct sbus_iface_map *pam_get_sbus_interface(void);
+
+#endif /* _PAM_IFACE_H_ */
@@ -0,0 +1,63 @@
+/* The following definitions are auto-generated from pam_iface.xml */
+
+#include "util/util.h"
+#include "sbus/sssd_dbus.h"
+#include "sbus/sssd_dbus_meta.h"
+#include "sbus/sssd_dbus_invokers.h"
+#include "pam_iface_generated.h"
+
+/* invokes a handler with a 'ss' DBus signature */
+static int invoke_ss_method(struct sbus_request *dbus_req, void *function_ptr);
+
+/* arguments for org.freedesktop.sssd.pam.AccessCache.Invalidate */
+const struct sbus_arg_meta iface_pam_accesscache_Invalidate__in[] = {
+    { "user", "s" },
+    { "domain", "s" },
+    { NULL, }
+};
+
+int iface_pam_accesscache_Invalidate_finish(struct sbus_request *req)
+{
+   return sbus_request_return_and_finish(req,
+                                         DBUS_TYPE_INVALID);
+}
+
+/* methods for org.freedesktop.sssd.pam.AccessCache */
+const struct sbus_method_meta iface_pam_accesscache__methods[] = {
+    {
+        "Invalidate", /* name */
+        iface_pam_accesscache_Invalidate__in,
+        NULL, /* no out_args */
+        offsetof(struct iface_pam_accesscache, Invalidate),
+        invoke_ss_method,
+    },
+    { NULL, }
+};
+
+/* interface info for org.freedesktop.sssd.pam.AccessCache */
+const struct sbus_interface_meta iface_pam_accesscache_meta = {
+    "org.freedesktop.sssd.pam.AccessCache", /* name */
+    iface_pam_accesscache__methods,
+    NULL, /* no signals */
+    NULL, /* no properties */
+    sbus_invoke_get_all, /* GetAll invoker */
+};
+
+/* invokes a handler with a 'ss' DBus signature */
+static int invoke_ss_method(struct sbus_request *dbus_req, void *function_ptr)
+{
+    const char * arg_0;
+    const char * arg_1;
+    int (*handler)(struct sbus_request *, void *, const char *, const char *) = function_ptr;
+
+    if (!sbus_request_parse_or_finish(dbus_req,
+                               DBUS_TYPE_STRING, &arg_0,
+                               DBUS_TYPE_STRING, &arg_1,
+                               DBUS_TYPE_INVALID)) {
+         return EOK; /* request handled */
+    }
+
+    return (handler)(dbus_req, dbus_req->intf->handler_data,
+                     arg_0,
+                     arg_1);
+}
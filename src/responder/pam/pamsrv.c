@@ -42,6 +42,8 @@
 #include "monitor/monitor_interfaces.h"
 #include "sbus/sbus_client.h"
 #include "responder/pam/pamsrv.h"
+#include "responder/pam/pam_iface.h"
+#include "responder/pam/pam_helpers.h"
 #include "responder/common/negcache.h"
 #include "responder/common/responder_sbus.h"
 
@@ -64,8 +66,32 @@ struct mon_cli_iface monitor_pam_methods = {
     .clearMemcache = NULL,
     .clearEnumCache = NULL,
     .sysbusReconnect = NULL,
+    .perfStats = monitor_common_perf_stats,
 };
 
+int pam_accesscache_invalidate(struct sbus_request *sbus_req,
+                               void *data,
+                               const char *user,
+                               const char *domain)
+{
+    struct resp_ctx *rctx = talloc_get_type(data, struct resp_ctx);
+    struct pam_ctx *pctx = talloc_get_type(rctx->pvt_ctx, struct pam_ctx);
+    errno_t ret;
+
+    DEBUG(SSSDBG_TRACE_LIBS,
+          "Invalidating cached account decisions of [%s@%s]\n",
+          user, domain);
+
+    ret = pam_acct_cache_invalidate(pctx->acct_table, domain, user);
+    if (ret != EOK) {
+        DEBUG(SSSDBG_MINOR_FAILURE,
+              "Unable to invalidate account cache [%d]: %s\n",
+              ret, sss_strerror(ret));
+    }
+
+    return iface_pam_accesscache_Invalidate_finish(sbus_req);
+}
+
 static void pam_dp_reconnect_init(struct sbus_connection *conn, int status, void *pvt)
 {
     struct be_conn *be_conn = talloc_get_type(pvt, struct be_conn);
@@ -180,6 +206,8 @@ static int pam_process_init(TALLOC_CTX *mem_ctx,
     int ret, max_retries;
     int id_timeout;
     int fd_limit;
+    char *cert_verification_opts;
+    struct cert_verify_opts *cert_verify_opts;
 
     pam_cmds = get_pam_cmds();
     ret = sss_process_init(mem_ctx, ev, cdb,
@@ -190,7 +218,7 @@ static int pam_process_init(TALLOC_CTX *mem_ctx,
                            SSS_PAM_SBUS_SERVICE_NAME,
                            SSS_PAM_SBUS_SERVICE_VERSION,
                            &monitor_pam_methods,
-                           "PAM", NULL,
+                           "PAM", pam_get_sbus_interface(),
                            sss_connection_setup,
                            &rctx);
     if (ret != EOK) {
@@ -260,6 +288,15 @@ static int pam_process_init(TALLOC_CTX *mem_ctx,
         goto done;
     }
 
+    /* Create table for account management decisions */
+    ret = sss_hash_create(pctx, 10, &pctx->acct_table);
+    if (ret != EOK) {
+        DEBUG(SSSDBG_FATAL_FAILURE,
+              "Could not create account decision hash table: [%s]\n",
+              strerror(ret));
+        goto done;
+    }
+
     /* Set up file descriptor limits */
     ret = confdb_get_int(pctx->rctx->cdb,
                          CONFDB_PAM_CONF_ENTRY,
@@ -309,6 +346,40 @@ static int pam_process_init(TALLOC_CTX *mem_ctx,
                   "enabled or not.\n");
             goto done;
         }
+
+        ret = p11_child_pool_init(pctx);
+        if (ret != EOK) {
+            DEBUG(SSSDBG_FATAL_FAILURE, "p11_child_pool_init failed.\n");
+            goto done;
+        }
+
+        ret = confdb_get_string(pctx->rctx->cdb, pctx,
+                                CONFDB_MONITOR_CONF_ENTRY,
+                                CONFDB_MONITOR_CERT_VERIFICATION, NULL,
+                                &cert_verification_opts);
+        if (ret != EOK) {
+            DEBUG(SSSDBG_FATAL_FAILURE,
+                  "Failed to read certificate_verification from confdb.\n");
+            goto done;
+        }
+
+        ret = parse_cert_verify_opts(pctx, cert_verification_opts,
+                                     &cert_verify_opts);
+        if (ret != EOK) {
+            DEBUG(SSSDBG_FATAL_FAILURE,
+                  "Failed to parse verification options.\n");
+            goto done;
+        }
+
+        ret = sss_cert_cache_init(pctx, rctx->ev, pctx->nss_db,
+                                  cert_verification_opts, cert_verify_opts,
+                                  false, pctx->p11_child_debug_fd,
+                                  &pctx->cert_cache);
+        if (ret != EOK) {
+            DEBUG(SSSDBG_FATAL_FAILURE,
+                  "Failed to set up certificate cache.\n");
+            goto done;
+        }
     }
 
     ret = EOK;
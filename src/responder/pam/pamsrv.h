@@ -26,8 +26,10 @@
 #include "util/util.h"
 #include "sbus/sssd_dbus.h"
 #include "responder/common/responder.h"
+#include "responder/common/cert_cache.h"
 
 struct pam_auth_req;
+struct sss_child_pool;
 
 typedef void (pam_dp_callback_t)(struct pam_auth_req *preq);
 
@@ -35,6 +37,8 @@ struct pam_ctx {
     struct resp_ctx *rctx;
     time_t id_timeout;
     hash_table_t *id_table;
+    /* successful account management decisions, see cached_acct_timeout */
+    hash_table_t *acct_table;
     size_t trusted_uids_count;
     uid_t *trusted_uids;
 
@@ -45,15 +49,20 @@ struct pam_ctx {
     bool cert_auth;
     int p11_child_debug_fd;
     char *nss_db;
+    struct sss_child_pool *p11_child_pool;
+    /* certificates recently validated by p11_child */
+    struct sss_cert_cache *cert_cache;
 };
 
 struct pam_auth_dp_req {
     struct pam_auth_req *preq;
+    int timeout;
 };
 
 struct pam_auth_req {
     struct cli_ctx *cctx;
     struct sss_domain_info *domain;
+    uint64_t trace_id;
 
     struct pam_data *pd;
 
@@ -65,6 +74,8 @@ struct pam_auth_req {
     bool use_cached_auth;
     /* whether cached authentication was tried and failed */
     bool cached_auth_failed;
+    /* whether the account decision was taken from the cache */
+    bool use_cached_acct;
 
     struct pam_auth_dp_req *dpreq_spy;
 
@@ -78,7 +89,13 @@ int pam_dp_send_req(struct pam_auth_req *preq, int timeout);
 
 int LOCAL_pam_handler(struct pam_auth_req *preq);
 
+int pam_accesscache_invalidate(struct sbus_request *sbus_req,
+                               void *data,
+                               const char *user,
+                               const char *domain);
+
 errno_t p11_child_init(struct pam_ctx *pctx);
+errno_t p11_child_pool_init(struct pam_ctx *pctx);
 
 struct tevent_req *pam_check_cert_send(TALLOC_CTX *mem_ctx,
                                        struct tevent_context *ev,
@@ -86,6 +103,8 @@ struct tevent_req *pam_check_cert_send(TALLOC_CTX *mem_ctx,
                                        const char *nss_db,
                                        time_t timeout,
                                        const char *verify_opts,
+                                       struct sss_child_pool *preauth_pool,
+                                       struct sss_cert_cache *cert_cache,
                                        struct pam_data *pd);
 errno_t pam_check_cert_recv(struct tevent_req *req, TALLOC_CTX *mem_ctx,
                             char **cert, char **token_name);
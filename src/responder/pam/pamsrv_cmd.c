@@ -23,6 +23,7 @@
 #include <time.h>
 #include "util/util.h"
 #include "util/auth_utils.h"
+#include "util/sss_trace.h"
 #include "db/sysdb.h"
 #include "confdb/confdb.h"
 #include "responder/common/responder_packet.h"
@@ -579,6 +580,8 @@ static errno_t get_password_for_cache_auth(struct sss_auth_token *authtok,
 }
 
 static int pam_forwarder(struct cli_ctx *cctx, int pam_cmd);
+static void pam_cache_acct_decision(struct pam_ctx *pctx,
+                                    struct pam_auth_req *preq);
 static void pam_handle_cached_login(struct pam_auth_req *preq, int ret,
                                     time_t expire_date, time_t delayed_until, bool cached_auth);
 
@@ -621,6 +624,10 @@ static void pam_reply(struct pam_auth_req *preq)
     DEBUG(SSSDBG_FUNC_DATA,
           "pam_reply called with result [%d]: %s.\n",
           pd->pam_status, pam_strerror(NULL, pd->pam_status));
+
+    /* Must be done before an offline result is turned into PAM_SUCCESS. */
+    pam_cache_acct_decision(pctx, preq);
+
     if (pd->pam_status == PAM_AUTHINFO_UNAVAIL || preq->use_cached_auth) {
 
         switch(pd->cmd) {
@@ -1109,7 +1116,8 @@ static errno_t check_cert(TALLOC_CTX *mctx,
 
     req = pam_check_cert_send(mctx, ev, pctx->p11_child_debug_fd,
                               pctx->nss_db, p11_child_timeout,
-                              cert_verification_opts, pd);
+                              cert_verification_opts, pctx->p11_child_pool,
+                              pctx->cert_cache, pd);
     if (req == NULL) {
         DEBUG(SSSDBG_OP_FAILURE, "pam_check_cert_send failed.\n");
         return ENOMEM;
@@ -1137,6 +1145,7 @@ static int pam_forwarder(struct cli_ctx *cctx, int pam_cmd)
     }
     talloc_set_destructor(preq, pam_auth_req_destructor);
     preq->cctx = cctx;
+    preq->trace_id = sss_trace_current();
 
     preq->pd = create_pam_data(preq);
     if (!preq->pd) {
@@ -1849,6 +1858,59 @@ static bool pam_can_user_cache_auth(struct sss_domain_info *domain,
     return result;
 }
 
+static bool pam_can_use_cached_acct(struct pam_ctx *pctx,
+                                    struct pam_auth_req *preq)
+{
+    struct pam_data *pd = preq->pd;
+    errno_t ret;
+
+    if (pd->cmd != SSS_PAM_ACCT_MGMT
+            || preq->domain->cached_acct_timeout == 0
+            || !NEED_CHECK_PROVIDER(preq->domain->provider)) {
+        return false;
+    }
+
+    ret = pam_acct_cache_check(pctx->acct_table, preq->domain->name,
+                               pd->user, pd->service, pd->rhost);
+    if (ret != EOK && ret != ENOENT) {
+        /* non-critical, ask the back end */
+        DEBUG(SSSDBG_MINOR_FAILURE,
+              "pam_acct_cache_check failed: %s:[%d]\n",
+              sss_strerror(ret), ret);
+    }
+
+    return ret == EOK;
+}
+
+/* Only plain successful decisions are cached. Denials must reach the back
+ * end so that a fixed rule takes effect immediately and replies carrying
+ * messages, e.g. password expiration warnings, must not be repeated. */
+static void pam_cache_acct_decision(struct pam_ctx *pctx,
+                                    struct pam_auth_req *preq)
+{
+    struct pam_data *pd = preq->pd;
+    errno_t ret;
+
+    if (pd->cmd != SSS_PAM_ACCT_MGMT
+            || pd->pam_status != PAM_SUCCESS
+            || pd->resp_list != NULL
+            || preq->use_cached_acct
+            || preq->domain == NULL
+            || preq->domain->cached_acct_timeout == 0
+            || !NEED_CHECK_PROVIDER(preq->domain->provider)) {
+        return;
+    }
+
+    ret = pam_acct_cache_set(pctx->rctx->ev, pctx->acct_table,
+                             preq->domain->name, pd->user, pd->service,
+                             pd->rhost, preq->domain->cached_acct_timeout);
+    if (ret != EOK) {
+        DEBUG(SSSDBG_MINOR_FAILURE,
+              "pam_acct_cache_set failed: %s:[%d]\n",
+              sss_strerror(ret), ret);
+    }
+}
+
 static void pam_dom_forwarder(struct pam_auth_req *preq)
 {
     int ret;
@@ -1891,6 +1953,16 @@ static void pam_dom_forwarder(struct pam_auth_req *preq)
         return;
     }
 
+    if (pam_can_use_cached_acct(pctx, preq)) {
+        DEBUG(SSSDBG_TRACE_FUNC,
+              "Using cached account decision for [%s]\n", preq->pd->user);
+        preq->use_cached_acct = true;
+        preq->pd->pam_status = PAM_SUCCESS;
+        preq->callback = pam_reply;
+        pam_reply(preq);
+        return;
+    }
+
     if (may_do_cert_auth(pctx, preq->pd) && preq->cert_user_obj != NULL) {
         /* Check if user matches certificate user */
         cert_user = ldb_msg_find_attr_as_string(preq->cert_user_obj, SYSDB_NAME,
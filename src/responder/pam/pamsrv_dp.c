@@ -26,6 +26,7 @@
 #include <security/pam_modules.h>
 
 #include "util/util.h"
+#include "util/sss_trace.h"
 #include "responder/common/responder_packet.h"
 #include "providers/data_provider.h"
 #include "sbus/sbus_client.h"
@@ -105,7 +106,126 @@ static int pdp_req_destructor(struct pam_auth_dp_req *pdp_req)
     return 0;
 }
 
-int pam_dp_send_req(struct pam_auth_req *preq, int timeout)
+static void pam_dp_process_packed_reply(struct tevent_req *req)
+{
+    struct pam_auth_req *preq = NULL;
+    struct pam_auth_dp_req *pdp_req;
+    struct sbus_packed_buf *reply;
+    int timeout;
+    errno_t ret;
+    bool bret;
+
+    pdp_req = tevent_req_callback_data(req, struct pam_auth_dp_req);
+    preq = pdp_req->preq;
+    timeout = pdp_req->timeout;
+
+    ret = sbus_packed_call_recv(pdp_req, req, &reply);
+    talloc_zfree(req);
+
+    /* Check if the client still exists. If not, simply free all the resources
+     * and quit */
+    if (preq == NULL) {
+        DEBUG(SSSDBG_MINOR_FAILURE, "Client already disconnected\n");
+        talloc_free(pdp_req);
+        return;
+    }
+
+    /* The packed connection was lost, the disconnect handler has already
+     * switched the back end connection to D-Bus. A password change is not
+     * repeated since it may have been already processed. */
+    if (ret == ERR_OFFLINE && preq->pd->cmd != SSS_PAM_CHAUTHTOK) {
+        talloc_zfree(pdp_req);
+        ret = pam_dp_send_req(preq, timeout);
+        if (ret == EOK) {
+            DEBUG(SSSDBG_TRACE_FUNC, "Packed connection was lost, request "
+                  "was resent over D-Bus\n");
+            return;
+        }
+
+        DEBUG(SSSDBG_OP_FAILURE, "Unable to resend request over D-Bus "
+              "[%d]: %s\n", ret, sss_strerror(ret));
+        preq->pd->pam_status = PAM_SYSTEM_ERR;
+        preq->callback(preq);
+        return;
+    }
+
+    if (ret != EOK) {
+        DEBUG(SSSDBG_FATAL_FAILURE, "Reply error [%d]: %s\n",
+              ret, sss_strerror(ret));
+        preq->pd->pam_status = PAM_SYSTEM_ERR;
+        goto done;
+    }
+
+    bret = dp_unpack_pam_response_packed(reply, preq->pd);
+    if (!bret) {
+        DEBUG(SSSDBG_FATAL_FAILURE, "Failed to parse reply.\n");
+        preq->pd->pam_status = PAM_SYSTEM_ERR;
+        goto done;
+    }
+
+    DEBUG(SSSDBG_FUNC_DATA,
+          "received: [%d (%s)][%s]\n", preq->pd->pam_status,
+          pam_strerror(NULL, preq->pd->pam_status),
+          preq->pd->domain);
+
+done:
+    talloc_free(pdp_req);
+    preq->callback(preq);
+}
+
+static int pam_dp_send_packed_req(struct pam_auth_req *preq,
+                                  struct be_conn *be_conn,
+                                  int timeout)
+{
+    struct pam_auth_dp_req *pdp_req;
+    struct sbus_packed_buf *body;
+    struct tevent_req *req;
+    errno_t ret;
+
+    pdp_req = talloc(preq->cctx->rctx, struct pam_auth_dp_req);
+    if (pdp_req == NULL) {
+        return ENOMEM;
+    }
+    pdp_req->preq = NULL;
+    pdp_req->timeout = timeout;
+    talloc_set_destructor(pdp_req, pdp_req_destructor);
+
+    body = sbus_packed_buf_new(pdp_req);
+    if (body == NULL) {
+        ret = ENOMEM;
+        goto done;
+    }
+
+    if (!dp_pack_pam_request_packed(body, preq->pd)) {
+        DEBUG(SSSDBG_CRIT_FAILURE,"Failed to build message\n");
+        ret = EIO;
+        goto done;
+    }
+
+    req = sbus_packed_call_send(pdp_req, be_conn->packed,
+                                IFACE_DP_PAMHANDLER_OPCODE, body, timeout);
+    if (req == NULL) {
+        ret = ENOMEM;
+        goto done;
+    }
+    talloc_free(body);
+
+    tevent_req_set_callback(req, pam_dp_process_packed_reply, pdp_req);
+
+    pdp_req->preq = preq;
+    preq->dpreq_spy = pdp_req;
+
+    ret = EOK;
+
+done:
+    if (ret != EOK) {
+        talloc_free(pdp_req);
+    }
+
+    return ret;
+}
+
+static int pam_dp_send(struct pam_auth_req *preq, int timeout)
 {
     struct pam_data *pd = preq->pd;
     struct be_conn *be_conn;
@@ -128,6 +248,13 @@ int pam_dp_send_req(struct pam_auth_req *preq, int timeout)
         return EIO;
     }
 
+    DEBUG(SSSDBG_CONF_SETTINGS, "Sending request with the following data:\n");
+    DEBUG_PAM_DATA(SSSDBG_CONF_SETTINGS, pd);
+
+    if (be_conn->packed != NULL) {
+        return pam_dp_send_packed_req(preq, be_conn, timeout);
+    }
+
     msg = dbus_message_new_method_call(NULL,
                                        DP_PATH,
                                        IFACE_DP,
@@ -137,21 +264,24 @@ int pam_dp_send_req(struct pam_auth_req *preq, int timeout)
         return ENOMEM;
     }
 
-
-    DEBUG(SSSDBG_CONF_SETTINGS, "Sending request with the following data:\n");
-    DEBUG_PAM_DATA(SSSDBG_CONF_SETTINGS, pd);
-
     ret = dp_pack_pam_request(msg, pd);
     if (!ret) {
         DEBUG(SSSDBG_CRIT_FAILURE,"Failed to build message\n");
         return EIO;
     }
 
+    res = sbus_message_append_trace_id(msg, preq->trace_id);
+    if (res != EOK) {
+        DEBUG(SSSDBG_CRIT_FAILURE,"Failed to build message\n");
+        return res;
+    }
+
     pdp_req = talloc(preq->cctx->rctx, struct pam_auth_dp_req);
     if (pdp_req == NULL) {
         return ENOMEM;
     }
     pdp_req->preq = preq;
+    pdp_req->timeout = timeout;
     preq->dpreq_spy = pdp_req;
     talloc_set_destructor(pdp_req, pdp_req_destructor);
 
@@ -162,3 +292,16 @@ int pam_dp_send_req(struct pam_auth_req *preq, int timeout)
     return res;
 }
 
+int pam_dp_send_req(struct pam_auth_req *preq, int timeout)
+{
+    uint64_t prev_trace_id;
+    int ret;
+
+    /* The request may be sent from a callback of a cache lookup. */
+    prev_trace_id = sss_trace_set_current(preq->trace_id);
+    ret = pam_dp_send(preq, timeout);
+    sss_trace_set_current(prev_trace_id);
+
+    return ret;
+}
+
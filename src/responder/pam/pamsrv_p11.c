@@ -25,21 +25,84 @@
 #include "providers/data_provider.h"
 #include "util/child_common.h"
 #include "util/strtonum.h"
+#include "util/crypto/sss_crypto.h"
 #include "responder/pam/pamsrv.h"
 
 
-#ifndef SSSD_LIBEXEC_PATH
-#error "SSSD_LIBEXEC_PATH not defined"
-#endif  /* SSSD_LIBEXEC_PATH */
-
 #define P11_CHILD_LOG_FILE "p11_child"
-#define P11_CHILD_PATH SSSD_LIBEXEC_PATH"/p11_child"
 
 errno_t p11_child_init(struct pam_ctx *pctx)
 {
     return child_debug_init(P11_CHILD_LOG_FILE, &pctx->p11_child_debug_fd);
 }
 
+/* Only the pre-authentication lookups run in the pool, they are the most
+ * frequent ones and all of them use the same command line. */
+errno_t p11_child_pool_init(struct pam_ctx *pctx)
+{
+    TALLOC_CTX *tmp_ctx;
+    char *verify_opts;
+    const char *extra_args[6] = { NULL };
+    size_t arg_c;
+    int pool_size;
+    errno_t ret;
+
+    ret = confdb_get_int(pctx->rctx->cdb, CONFDB_PAM_CONF_ENTRY,
+                         CONFDB_PAM_P11_CHILD_POOL_SIZE, 0, &pool_size);
+    if (ret != EOK) {
+        DEBUG(SSSDBG_CRIT_FAILURE,
+              "Failed to read p11_child_pool_size from confdb: [%d]: %s\n",
+              ret, sss_strerror(ret));
+        return ret;
+    }
+
+    if (pool_size <= 0 || pctx->nss_db == NULL) {
+        return EOK;
+    }
+
+    tmp_ctx = talloc_new(NULL);
+    if (tmp_ctx == NULL) {
+        return ENOMEM;
+    }
+
+    ret = confdb_get_string(pctx->rctx->cdb, tmp_ctx, CONFDB_MONITOR_CONF_ENTRY,
+                            CONFDB_MONITOR_CERT_VERIFICATION, NULL,
+                            &verify_opts);
+    if (ret != EOK) {
+        DEBUG(SSSDBG_CRIT_FAILURE,
+              "Failed to read certificate_verification from confdb: [%d]: %s\n",
+              ret, sss_strerror(ret));
+        goto done;
+    }
+
+    /* extra_args are added in revers order */
+    arg_c = 0;
+    extra_args[arg_c++] = pctx->nss_db;
+    extra_args[arg_c++] = "--nssdb";
+    if (verify_opts != NULL) {
+        extra_args[arg_c++] = verify_opts;
+        extra_args[arg_c++] = "--verify";
+    }
+    extra_args[arg_c++] = "--pre";
+
+    ret = sss_child_pool_create(pctx, pctx->rctx->ev, P11_CHILD_PATH,
+                                pctx->p11_child_debug_fd, extra_args,
+                                STDIN_FILENO, STDOUT_FILENO, pool_size,
+                                SSS_CHILD_POOL_MAX_JOBS, pool_size,
+                                &pctx->p11_child_pool);
+    if (ret != EOK) {
+        DEBUG(SSSDBG_CRIT_FAILURE, "Cannot create p11_child pool [%d]: %s\n",
+              ret, sss_strerror(ret));
+        goto done;
+    }
+
+    ret = EOK;
+
+done:
+    talloc_free(tmp_ctx);
+    return ret;
+}
+
 bool may_do_cert_auth(struct pam_ctx *pctx, struct pam_data *pd)
 {
     size_t c;
@@ -220,12 +283,16 @@ struct pam_check_cert_state {
     struct tevent_context *ev;
 
     struct child_io_fds *io;
+    struct sss_cert_cache *cert_cache;
+    /* digests passed with --verified, NULL for the pooled children */
+    char *verified;
     char *cert;
     char *token_name;
 };
 
 static void p11_child_write_done(struct tevent_req *subreq);
 static void p11_child_done(struct tevent_req *subreq);
+static void p11_child_pool_done(struct tevent_req *subreq);
 static void p11_child_timeout(struct tevent_context *ev,
                               struct tevent_timer *te,
                               struct timeval tv, void *pvt);
@@ -236,6 +303,8 @@ struct tevent_req *pam_check_cert_send(TALLOC_CTX *mem_ctx,
                                        const char *nss_db,
                                        time_t timeout,
                                        const char *verify_opts,
+                                       struct sss_child_pool *preauth_pool,
+                                       struct sss_cert_cache *cert_cache,
                                        struct pam_data *pd)
 {
     errno_t ret;
@@ -246,7 +315,7 @@ struct tevent_req *pam_check_cert_send(TALLOC_CTX *mem_ctx,
     struct timeval tv;
     int pipefd_to_child[2] = PIPE_INIT;
     int pipefd_from_child[2] = PIPE_INIT;
-    const char *extra_args[7] = { NULL };
+    const char *extra_args[9] = { NULL };
     uint8_t *write_buf = NULL;
     size_t write_buf_len = 0;
     size_t arg_c;
@@ -293,7 +362,9 @@ struct tevent_req *pam_check_cert_send(TALLOC_CTX *mem_ctx,
     }
 
     state->ev = ev;
+    state->cert_cache = cert_cache;
     state->child_status = EFAULT;
+    state->verified = NULL;
     state->cert = NULL;
     state->token_name = NULL;
     state->io = talloc(state, struct child_io_fds);
@@ -306,6 +377,28 @@ struct tevent_req *pam_check_cert_send(TALLOC_CTX *mem_ctx,
     state->io->read_from_child_fd = -1;
     talloc_set_destructor((void *) state->io, child_io_destructor);
 
+    if (pd->cmd == SSS_PAM_PREAUTH && sss_child_pool_accepts(preauth_pool)) {
+        subreq = sss_child_pool_send(state, ev, preauth_pool, NULL, 0,
+                                     timeout);
+        if (subreq == NULL) {
+            DEBUG(SSSDBG_OP_FAILURE, "sss_child_pool_send failed.\n");
+            ret = ERR_P11_CHILD;
+            goto done;
+        }
+        tevent_req_set_callback(subreq, p11_child_pool_done, req);
+        return req;
+    }
+
+    /* The pooled children share one command line, only the children
+     * started on demand can skip the validation of known certificates. */
+    if (cert_cache != NULL) {
+        state->verified = sss_cert_cache_valid_digests(state, cert_cache);
+        if (state->verified != NULL) {
+            extra_args[arg_c++] = state->verified;
+            extra_args[arg_c++] = "--verified";
+        }
+    }
+
     ret = pipe(pipefd_from_child);
     if (ret == -1) {
         ret = errno;
@@ -412,6 +505,31 @@ done:
     return req;
 }
 
+static void p11_child_cache_cert(struct pam_check_cert_state *state)
+{
+    unsigned char *der;
+    size_t der_size;
+    errno_t ret;
+
+    if (state->cert_cache == NULL || state->cert == NULL) {
+        return;
+    }
+
+    der = sss_base64_decode(state, state->cert, &der_size);
+    if (der == NULL) {
+        DEBUG(SSSDBG_OP_FAILURE, "sss_base64_decode failed.\n");
+        return;
+    }
+
+    ret = sss_cert_cache_add_valid(state->cert_cache, der, der_size,
+                                   state->verified);
+    talloc_free(der);
+    if (ret != EOK) {
+        DEBUG(SSSDBG_MINOR_FAILURE,
+              "Failed to cache certificate validation result.\n");
+    }
+}
+
 static void p11_child_write_done(struct tevent_req *subreq)
 {
     struct tevent_req *req = tevent_req_callback_data(subreq,
@@ -466,6 +584,44 @@ static void p11_child_done(struct tevent_req *subreq)
         return;
     }
 
+    p11_child_cache_cert(state);
+
+    tevent_req_done(req);
+    return;
+}
+
+static void p11_child_pool_done(struct tevent_req *subreq)
+{
+    uint8_t *buf;
+    ssize_t buf_len;
+    struct tevent_req *req = tevent_req_callback_data(subreq,
+                                                      struct tevent_req);
+    struct pam_check_cert_state *state = tevent_req_data(req,
+                                                   struct pam_check_cert_state);
+    int ret;
+
+    ret = sss_child_pool_recv(subreq, state, &buf, &buf_len);
+    talloc_zfree(subreq);
+    if (ret == ETIMEDOUT) {
+        DEBUG(SSSDBG_CRIT_FAILURE, "Timeout reached for p11_child.\n");
+        state->child_status = ETIMEDOUT;
+        tevent_req_error(req, ERR_P11_CHILD);
+        return;
+    } else if (ret != EOK) {
+        tevent_req_error(req, ret);
+        return;
+    }
+
+    ret = parse_p11_child_response(state, buf, buf_len, &state->cert,
+                                   &state->token_name);
+    if (ret != EOK) {
+        DEBUG(SSSDBG_OP_FAILURE, "parse_p11_child_respose failed.\n");
+        tevent_req_error(req, ret);
+        return;
+    }
+
+    p11_child_cache_cert(state);
+
     tevent_req_done(req);
     return;
 }
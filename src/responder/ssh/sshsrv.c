@@ -39,6 +39,7 @@ struct mon_cli_iface monitor_ssh_methods = {
     .clearMemcache = NULL,
     .clearEnumCache = NULL,
     .sysbusReconnect = NULL,
+    .perfStats = monitor_common_perf_stats,
 };
 
 static void ssh_dp_reconnect_init(struct sbus_connection *conn,
@@ -72,6 +73,8 @@ int ssh_process_init(TALLOC_CTX *mem_ctx,
     struct resp_ctx *rctx;
     struct sss_cmd_table *ssh_cmds;
     struct ssh_ctx *ssh_ctx;
+    char *cert_verification_opts;
+    struct cert_verify_opts *cert_verify_opts;
     struct be_conn *iter;
     int ret;
     int max_retries;
@@ -160,6 +163,32 @@ int ssh_process_init(TALLOC_CTX *mem_ctx,
         goto fail;
     }
 
+    ret = confdb_get_string(ssh_ctx->rctx->cdb, ssh_ctx,
+                            CONFDB_MONITOR_CONF_ENTRY,
+                            CONFDB_MONITOR_CERT_VERIFICATION, NULL,
+                            &cert_verification_opts);
+    if (ret != EOK) {
+        DEBUG(SSSDBG_FATAL_FAILURE,
+              "Failed to read certificate_verification from confdb (%d) [%s]\n",
+              ret, sss_strerror(ret));
+        goto fail;
+    }
+
+    ret = parse_cert_verify_opts(ssh_ctx, cert_verification_opts,
+                                 &cert_verify_opts);
+    if (ret != EOK) {
+        DEBUG(SSSDBG_FATAL_FAILURE, "Failed to parse verification options.\n");
+        goto fail;
+    }
+
+    ret = sss_cert_cache_init(ssh_ctx, rctx->ev, ssh_ctx->ca_db,
+                              cert_verification_opts, cert_verify_opts, true,
+                              -1, &ssh_ctx->cert_cache);
+    if (ret != EOK) {
+        DEBUG(SSSDBG_FATAL_FAILURE, "Failed to set up certificate cache.\n");
+        goto fail;
+    }
+
     ret = schedule_get_domains_task(rctx, rctx->ev, rctx, NULL);
     if (ret != EOK) {
         DEBUG(SSSDBG_FATAL_FAILURE, "schedule_get_domains_tasks failed.\n");
@@ -23,6 +23,7 @@
 #include <talloc.h>
 #include <string.h>
 #include <netdb.h>
+#include <fcntl.h>
 
 #include "util/util.h"
 #include "util/crypto/sss_crypto.h"
@@ -422,70 +423,194 @@ ssh_host_pubkeys_search_dp_callback(uint16_t err_maj,
     ssh_cmd_get_host_pubkeys_done(cmd_ctx, ret);
 }
 
-static char *
-ssh_host_pubkeys_format_known_host_plain(TALLOC_CTX *mem_ctx,
-                                         struct sss_ssh_ent *ent)
+/* A host as it is currently written in the known_hosts file */
+struct ssh_known_hosts_entry {
+    char *names;
+    char **pubkeys;
+    size_t num_pubkeys;
+    time_t expire;
+};
+
+struct ssh_known_hosts {
+    struct ssh_ctx *ssh_ctx;
+
+    /* ssh_known_hosts_entry by "domain/name" */
+    hash_table_t *entries;
+    /* "|1|salt|hash" by host name, reused between rewrites */
+    hash_table_t *hashed_names;
+
+    time_t next_expire;
+    struct tevent_timer *compact_te;
+};
+
+static errno_t
+ssh_known_hosts_entry_new(TALLOC_CTX *mem_ctx,
+                          struct ldb_message *host,
+                          struct ssh_known_hosts_entry **_entry)
 {
-    TALLOC_CTX *tmp_ctx;
-    errno_t ret;
-    char *name, *pubkey;
-    char *result = NULL;
+    struct ssh_known_hosts_entry *entry;
+    struct sss_ssh_ent *ent;
+    time_t cache_expire;
     size_t i;
+    errno_t ret;
 
-    tmp_ctx = talloc_new(NULL);
-    if (!tmp_ctx) {
-        return NULL;
+    entry = talloc_zero(mem_ctx, struct ssh_known_hosts_entry);
+    if (entry == NULL) {
+        return ENOMEM;
     }
 
-    name = talloc_strdup(tmp_ctx, ent->name);
-    if (!name) {
+    ret = sss_ssh_make_ent(entry, host, &ent);
+    if (ret != EOK) {
+        DEBUG(SSSDBG_OP_FAILURE, "Failed to get SSH host public keys\n");
+        goto done;
+    }
+
+    entry->names = talloc_strdup(entry, ent->name);
+    if (entry->names == NULL) {
+        ret = ENOMEM;
         goto done;
     }
 
     for (i = 0; i < ent->num_aliases; i++) {
-        name = talloc_asprintf_append(name, ",%s", ent->aliases[i]);
-        if (!name) {
+        entry->names = talloc_asprintf_append(entry->names, ",%s",
+                                              ent->aliases[i]);
+        if (entry->names == NULL) {
+            ret = ENOMEM;
             goto done;
         }
     }
 
-    result = talloc_strdup(tmp_ctx, "");
-    if (!result) {
+    entry->pubkeys = talloc_zero_array(entry, char *, ent->num_pubkeys + 1);
+    if (entry->pubkeys == NULL) {
+        ret = ENOMEM;
         goto done;
     }
 
     for (i = 0; i < ent->num_pubkeys; i++) {
-        ret = sss_ssh_format_pubkey(tmp_ctx, &ent->pubkeys[i], &pubkey);
+        ret = sss_ssh_format_pubkey(entry->pubkeys, &ent->pubkeys[i],
+                                    &entry->pubkeys[i]);
         if (ret != EOK) {
-            result = NULL;
             goto done;
         }
+    }
+    entry->num_pubkeys = ent->num_pubkeys;
+
+    /* The host leaves the file when either of the timeouts passes */
+    entry->expire = ldb_msg_find_attr_as_uint64(host,
+                                                SYSDB_SSH_KNOWN_HOSTS_EXPIRE, 0);
+    cache_expire = ldb_msg_find_attr_as_uint64(host, SYSDB_CACHE_EXPIRE, 0);
+    if (cache_expire != 0 && cache_expire < entry->expire) {
+        entry->expire = cache_expire;
+    }
 
-        result = talloc_asprintf_append(result, "%s %s\n", name, pubkey);
-        if (!result) {
+    talloc_free(ent);
+    *_entry = entry;
+    ret = EOK;
+
+done:
+    if (ret != EOK) {
+        talloc_free(entry);
+    }
+    return ret;
+}
+
+static const char *
+ssh_known_hosts_hashed_name(struct ssh_known_hosts *kh,
+                            struct ssh_known_hosts *old_kh,
+                            const char *name)
+{
+    TALLOC_CTX *tmp_ctx;
+    hash_key_t key;
+    hash_value_t value;
+    unsigned char salt[SSS_SHA1_LENGTH], hash[SSS_SHA1_LENGTH];
+    char *saltstr, *hashstr;
+    char *hashed = NULL;
+    size_t k;
+    errno_t ret;
+    int hret;
+
+    key.type = HASH_KEY_STRING;
+    key.str = discard_const(name);
+
+    if (hash_lookup(kh->hashed_names, &key, &value) == HASH_SUCCESS) {
+        return value.ptr;
+    }
+
+    tmp_ctx = talloc_new(NULL);
+    if (tmp_ctx == NULL) {
+        return NULL;
+    }
+
+    if (old_kh != NULL
+            && hash_lookup(old_kh->hashed_names, &key, &value) == HASH_SUCCESS) {
+        hashed = talloc_strdup(tmp_ctx, value.ptr);
+        if (hashed == NULL) {
+            goto done;
+        }
+    } else {
+        for (k = 0; k < SSS_SHA1_LENGTH; k++) {
+            salt[k] = rand();
+        }
+
+        ret = sss_hmac_sha1(salt, SSS_SHA1_LENGTH,
+                            (const unsigned char *)name, strlen(name),
+                            hash);
+        if (ret != EOK) {
+            DEBUG(SSSDBG_OP_FAILURE,
+                  "sss_hmac_sha1() failed (%d): %s\n",
+                   ret, strerror(ret));
             goto done;
         }
 
-        talloc_free(pubkey);
+        saltstr = sss_base64_encode(tmp_ctx, salt, SSS_SHA1_LENGTH);
+        if (!saltstr) {
+            goto done;
+        }
+
+        hashstr = sss_base64_encode(tmp_ctx, hash, SSS_SHA1_LENGTH);
+        if (!hashstr) {
+            goto done;
+        }
+
+        hashed = talloc_asprintf(tmp_ctx, "|1|%s|%s", saltstr, hashstr);
+        if (hashed == NULL) {
+            goto done;
+        }
     }
 
-    talloc_steal(mem_ctx, result);
+    value.type = HASH_VALUE_PTR;
+    value.ptr = hashed;
+    hret = hash_enter(kh->hashed_names, &key, &value);
+    if (hret != HASH_SUCCESS) {
+        DEBUG(SSSDBG_OP_FAILURE, "Unable to memoize hashed host name: %s\n",
+              hash_error_string(hret));
+        hashed = NULL;
+        goto done;
+    }
+    talloc_steal(kh->hashed_names, hashed);
 
 done:
     talloc_free(tmp_ctx);
-
-    return result;
+    return hashed;
 }
 
+/* Formats the known_hosts lines of the entry's public keys starting with
+ * the first_pubkey-th one. */
 static char *
-ssh_host_pubkeys_format_known_host_hashed(TALLOC_CTX *mem_ctx,
-                                          struct sss_ssh_ent *ent)
+ssh_known_hosts_format_entry(TALLOC_CTX *mem_ctx,
+                             struct ssh_known_hosts *kh,
+                             struct ssh_known_hosts *old_kh,
+                             struct ssh_known_hosts_entry *entry,
+                             size_t first_pubkey)
 {
     TALLOC_CTX *tmp_ctx;
+    char **names;
+    const char *name;
+    char *result = NULL;
+    int num_names;
+    size_t i;
+    int j;
     errno_t ret;
-    char *name, *pubkey, *saltstr, *hashstr, *result;
-    unsigned char salt[SSS_SHA1_LENGTH], hash[SSS_SHA1_LENGTH];
-    size_t i, j, k;
 
     tmp_ctx = talloc_new(NULL);
     if (!tmp_ctx) {
@@ -497,54 +622,40 @@ ssh_host_pubkeys_format_known_host_hashed(TALLOC_CTX *mem_ctx,
         goto done;
     }
 
-    for (i = 0; i < ent->num_pubkeys; i++) {
-        ret = sss_ssh_format_pubkey(tmp_ctx, &ent->pubkeys[i], &pubkey);
-        if (ret != EOK) {
-            result = NULL;
-            goto done;
-        }
-
-        for (j = 0; j <= ent->num_aliases; j++) {
-            name = (j == 0 ? ent->name : ent->aliases[j-1]);
-
-            for (k = 0; k < SSS_SHA1_LENGTH; k++) {
-                salt[k] = rand();
-            }
-
-            ret = sss_hmac_sha1(salt, SSS_SHA1_LENGTH,
-                                (unsigned char *)name, strlen(name),
-                                hash);
-            if (ret != EOK) {
-                DEBUG(SSSDBG_OP_FAILURE,
-                      "sss_hmac_sha1() failed (%d): %s\n",
-                       ret, strerror(ret));
-                result = NULL;
+    if (!kh->ssh_ctx->hash_known_hosts) {
+        for (i = first_pubkey; i < entry->num_pubkeys; i++) {
+            result = talloc_asprintf_append(result, "%s %s\n", entry->names,
+                                            entry->pubkeys[i]);
+            if (!result) {
                 goto done;
             }
+        }
 
-            saltstr = sss_base64_encode(tmp_ctx, salt, SSS_SHA1_LENGTH);
-            if (!saltstr) {
-                result = NULL;
-                goto done;
-            }
+        talloc_steal(mem_ctx, result);
+        goto done;
+    }
 
-            hashstr = sss_base64_encode(tmp_ctx, hash, SSS_SHA1_LENGTH);
-            if (!hashstr) {
+    ret = split_on_separator(tmp_ctx, entry->names, ',', false, false,
+                             &names, &num_names);
+    if (ret != EOK) {
+        result = NULL;
+        goto done;
+    }
+
+    for (i = first_pubkey; i < entry->num_pubkeys; i++) {
+        for (j = 0; j < num_names; j++) {
+            name = ssh_known_hosts_hashed_name(kh, old_kh, names[j]);
+            if (name == NULL) {
                 result = NULL;
                 goto done;
             }
 
-            result = talloc_asprintf_append(result, "|1|%s|%s %s\n",
-                                            saltstr, hashstr, pubkey);
+            result = talloc_asprintf_append(result, "%s %s\n",
+                                            name, entry->pubkeys[i]);
             if (!result) {
                 goto done;
             }
-
-            talloc_free(saltstr);
-            talloc_free(hashstr);
         }
-
-        talloc_free(pubkey);
     }
 
     talloc_steal(mem_ctx, result);
@@ -555,8 +666,20 @@ done:
     return result;
 }
 
+static char *
+ssh_known_hosts_key(TALLOC_CTX *mem_ctx,
+                    struct sss_domain_info *dom,
+                    const char *name)
+{
+    return talloc_asprintf(mem_ctx, "%s/%s", dom->name, name);
+}
+
+static void
+ssh_known_hosts_schedule_compaction(struct ssh_known_hosts *kh,
+                                    time_t expire);
+
 static errno_t
-ssh_host_pubkeys_update_known_hosts(struct ssh_cmd_ctx *cmd_ctx)
+ssh_known_hosts_write_all(struct ssh_ctx *ssh_ctx, time_t now)
 {
     TALLOC_CTX *tmp_ctx;
     errno_t ret;
@@ -564,33 +687,44 @@ ssh_host_pubkeys_update_known_hosts(struct ssh_cmd_ctx *cmd_ctx)
         SYSDB_NAME,
         SYSDB_NAME_ALIAS,
         SYSDB_SSH_PUBKEY,
+        SYSDB_CACHE_EXPIRE,
+        SYSDB_SSH_KNOWN_HOSTS_EXPIRE,
         NULL
     };
-    struct cli_ctx *cctx = cmd_ctx->cctx;
-    struct sss_domain_info *dom = cctx->rctx->domains;
-    struct ssh_ctx *ssh_ctx = (struct ssh_ctx *)cctx->rctx->pvt_ctx;
+    struct sss_domain_info *dom = ssh_ctx->rctx->domains;
     struct sysdb_ctx *sysdb;
-    time_t now = time(NULL);
     struct ldb_message **hosts;
     size_t num_hosts, i;
-    struct sss_ssh_ent *ent;
+    struct ssh_known_hosts *kh;
+    struct ssh_known_hosts_entry *entry;
+    hash_key_t key;
+    hash_value_t value;
     int fd = -1;
     char *filename = NULL;
     char *entstr;
     ssize_t wret;
+    int hret;
 
     tmp_ctx = talloc_new(NULL);
     if (!tmp_ctx) {
         return ENOMEM;
     }
 
-    if (cmd_ctx->domain) {
-        ret = sysdb_update_ssh_known_host_expire(cmd_ctx->domain,
-                                                 cmd_ctx->name, now,
-                                                 ssh_ctx->known_hosts_timeout);
-        if (ret != EOK && ret != ENOENT) {
-            goto done;
-        }
+    kh = talloc_zero(tmp_ctx, struct ssh_known_hosts);
+    if (kh == NULL) {
+        ret = ENOMEM;
+        goto done;
+    }
+    kh->ssh_ctx = ssh_ctx;
+
+    ret = sss_hash_create(kh, 0, &kh->entries);
+    if (ret != EOK) {
+        goto done;
+    }
+
+    ret = sss_hash_create(kh, 0, &kh->hashed_names);
+    if (ret != EOK) {
+        goto done;
     }
 
     /* write known_hosts file */
@@ -626,22 +760,19 @@ ssh_host_pubkeys_update_known_hosts(struct ssh_cmd_ctx *cmd_ctx)
         }
 
         for (i = 0; i < num_hosts; i++) {
-            ret = sss_ssh_make_ent(tmp_ctx, hosts[i], &ent);
+            ret = ssh_known_hosts_entry_new(kh->entries, hosts[i], &entry);
             if (ret != EOK) {
-                DEBUG(SSSDBG_OP_FAILURE,
-                      "Failed to get SSH host public keys\n");
                 continue;
             }
 
-            if (ssh_ctx->hash_known_hosts) {
-                entstr = ssh_host_pubkeys_format_known_host_hashed(ent, ent);
-            } else {
-                entstr = ssh_host_pubkeys_format_known_host_plain(ent, ent);
-            }
+            entstr = ssh_known_hosts_format_entry(entry, kh,
+                                                  ssh_ctx->known_hosts,
+                                                  entry, 0);
             if (!entstr) {
                 DEBUG(SSSDBG_OP_FAILURE,
                       "Failed to format known_hosts data for [%s]\n",
-                       ent->name);
+                       entry->names);
+                talloc_free(entry);
                 continue;
             }
 
@@ -650,8 +781,30 @@ ssh_host_pubkeys_update_known_hosts(struct ssh_cmd_ctx *cmd_ctx)
                 ret = errno;
                 goto done;
             }
+            talloc_free(entstr);
+
+            key.type = HASH_KEY_STRING;
+            key.str = ssh_known_hosts_key(entry, dom,
+                            ldb_msg_find_attr_as_string(hosts[i], SYSDB_NAME,
+                                                        ""));
+            if (key.str == NULL) {
+                ret = ENOMEM;
+                goto done;
+            }
 
-            talloc_free(ent);
+            value.type = HASH_VALUE_PTR;
+            value.ptr = entry;
+            hret = hash_enter(kh->entries, &key, &value);
+            if (hret != HASH_SUCCESS) {
+                ret = EIO;
+                goto done;
+            }
+
+            if (entry->expire != 0
+                    && (kh->next_expire == 0
+                        || entry->expire < kh->next_expire)) {
+                kh->next_expire = entry->expire;
+            }
         }
 
         talloc_free(hosts);
@@ -668,6 +821,15 @@ ssh_host_pubkeys_update_known_hosts(struct ssh_cmd_ctx *cmd_ctx)
         ret = errno;
         goto done;
     }
+    filename = NULL;
+
+    DEBUG(SSSDBG_TRACE_FUNC, "Rewrote %s with %lu hosts\n",
+          SSS_SSH_KNOWN_HOSTS_PATH, hash_count(kh->entries));
+
+    /* the pending compaction of the old file is not needed anymore */
+    talloc_free(ssh_ctx->known_hosts);
+    ssh_ctx->known_hosts = talloc_steal(ssh_ctx, kh);
+    ssh_known_hosts_schedule_compaction(kh, kh->next_expire);
 
     ret = EOK;
 
@@ -675,11 +837,306 @@ done:
     if (fd != -1) {
         close(fd);
     }
+    if (filename != NULL) {
+        unlink(filename);
+    }
     talloc_free(tmp_ctx);
 
     return ret;
 }
 
+static void
+ssh_known_hosts_compact(struct tevent_context *ev,
+                        struct tevent_timer *te,
+                        struct timeval tv,
+                        void *pvt)
+{
+    struct ssh_known_hosts *kh;
+    struct ssh_known_hosts_entry *entry;
+    hash_value_t *values;
+    unsigned long count;
+    unsigned long i;
+    time_t now = time(NULL);
+    bool expired = false;
+    errno_t ret;
+
+    kh = talloc_get_type(pvt, struct ssh_known_hosts);
+    kh->compact_te = NULL;
+
+    /* The hosts may have been looked up again in the meantime */
+    if (hash_values(kh->entries, &count, &values) != HASH_SUCCESS) {
+        count = 0;
+        values = NULL;
+        expired = true;
+    }
+
+    kh->next_expire = 0;
+    for (i = 0; i < count; i++) {
+        entry = talloc_get_type(values[i].ptr, struct ssh_known_hosts_entry);
+        if (entry->expire == 0) {
+            continue;
+        }
+
+        if (entry->expire <= now) {
+            expired = true;
+            break;
+        }
+
+        if (kh->next_expire == 0 || entry->expire < kh->next_expire) {
+            kh->next_expire = entry->expire;
+        }
+    }
+    talloc_free(values);
+
+    if (!expired) {
+        ssh_known_hosts_schedule_compaction(kh, kh->next_expire);
+        return;
+    }
+
+    DEBUG(SSSDBG_TRACE_FUNC, "Removing expired hosts from %s\n",
+          SSS_SSH_KNOWN_HOSTS_PATH);
+
+    /* frees kh on success */
+    ret = ssh_known_hosts_write_all(kh->ssh_ctx, now);
+    if (ret != EOK) {
+        DEBUG(SSSDBG_OP_FAILURE, "Failed to rewrite %s [%d]: %s\n",
+              SSS_SSH_KNOWN_HOSTS_PATH, ret, sss_strerror(ret));
+        /* start over with the next lookup */
+        talloc_zfree(kh->ssh_ctx->known_hosts);
+    }
+}
+
+static void
+ssh_known_hosts_schedule_compaction(struct ssh_known_hosts *kh,
+                                    time_t expire)
+{
+    struct timeval tv;
+
+    if (expire == 0 || kh->compact_te != NULL) {
+        return;
+    }
+
+    /* Let the expired hosts pile up a bit before the file is rewritten */
+    tv = tevent_timeval_set(expire + SSS_SSH_KNOWN_HOSTS_COMPACT_DELAY, 0);
+    kh->compact_te = tevent_add_timer(kh->ssh_ctx->rctx->ev, kh, tv,
+                                      ssh_known_hosts_compact, kh);
+    if (kh->compact_te == NULL) {
+        DEBUG(SSSDBG_MINOR_FAILURE,
+              "Unable to schedule compaction of known_hosts\n");
+    }
+}
+
+/* Hosts whose public keys were only extended are appended to the file.
+ * Any other change would leave a stale key trusted until the next
+ * compaction, so the whole file is rewritten instead. */
+static errno_t
+ssh_known_hosts_update_host(struct ssh_ctx *ssh_ctx,
+                            struct sss_domain_info *dom,
+                            const char *name,
+                            time_t now)
+{
+    TALLOC_CTX *tmp_ctx;
+    const char *attrs[] = {
+        SYSDB_NAME,
+        SYSDB_NAME_ALIAS,
+        SYSDB_SSH_PUBKEY,
+        SYSDB_CACHE_EXPIRE,
+        SYSDB_SSH_KNOWN_HOSTS_EXPIRE,
+        NULL
+    };
+    struct ssh_known_hosts *kh = ssh_ctx->known_hosts;
+    struct ssh_known_hosts_entry *old_entry = NULL;
+    struct ssh_known_hosts_entry *entry = NULL;
+    struct ldb_message *host;
+    hash_key_t key;
+    hash_value_t value;
+    char **pubkeys;
+    size_t i;
+    size_t n;
+    char *entstr;
+    ssize_t wret;
+    int fd = -1;
+    int hret;
+    errno_t ret;
+
+    tmp_ctx = talloc_new(NULL);
+    if (tmp_ctx == NULL) {
+        return ENOMEM;
+    }
+
+    key.type = HASH_KEY_STRING;
+    key.str = ssh_known_hosts_key(tmp_ctx, dom, name);
+    if (key.str == NULL) {
+        ret = ENOMEM;
+        goto done;
+    }
+
+    if (hash_lookup(kh->entries, &key, &value) == HASH_SUCCESS) {
+        old_entry = talloc_get_type(value.ptr, struct ssh_known_hosts_entry);
+    }
+
+    ret = sysdb_get_ssh_host(tmp_ctx, dom, name, attrs, &host);
+    if (ret == EOK) {
+        ret = ssh_known_hosts_entry_new(tmp_ctx, host, &entry);
+    }
+    if (ret == ENOENT || (entry != NULL && entry->expire <= now)) {
+        /* the host is not supposed to be in the file */
+        ret = old_entry == NULL ? EOK : ssh_known_hosts_write_all(ssh_ctx,
+                                                                   now);
+        goto done;
+    } else if (ret != EOK) {
+        goto done;
+    }
+
+    i = 0;
+    if (old_entry != NULL) {
+        if (strcmp(old_entry->names, entry->names) != 0) {
+            ret = ssh_known_hosts_write_all(ssh_ctx, now);
+            goto done;
+        }
+
+        for (i = 0; i < old_entry->num_pubkeys; i++) {
+            if (!string_in_list(old_entry->pubkeys[i], entry->pubkeys, true)) {
+                ret = ssh_known_hosts_write_all(ssh_ctx, now);
+                goto done;
+            }
+        }
+
+        /* Keep the keys already in the file first so that only the new
+         * ones need to be appended. */
+        pubkeys = talloc_zero_array(entry, char *, entry->num_pubkeys + 1);
+        if (pubkeys == NULL) {
+            ret = ENOMEM;
+            goto done;
+        }
+
+        n = 0;
+        for (i = 0; i < old_entry->num_pubkeys; i++) {
+            pubkeys[n] = talloc_strdup(pubkeys, old_entry->pubkeys[i]);
+            if (pubkeys[n] == NULL) {
+                ret = ENOMEM;
+                goto done;
+            }
+            n++;
+        }
+
+        for (i = 0; i < entry->num_pubkeys; i++) {
+            if (!string_in_list(entry->pubkeys[i], old_entry->pubkeys, true)) {
+                pubkeys[n++] = talloc_steal(pubkeys, entry->pubkeys[i]);
+            }
+        }
+
+        talloc_free(entry->pubkeys);
+        entry->pubkeys = pubkeys;
+        entry->num_pubkeys = n;
+
+        i = old_entry->num_pubkeys;
+    }
+
+    if (i < entry->num_pubkeys) {
+        entstr = ssh_known_hosts_format_entry(tmp_ctx, kh, NULL, entry, i);
+        if (entstr == NULL) {
+            ret = ENOMEM;
+            goto done;
+        }
+
+        fd = open(SSS_SSH_KNOWN_HOSTS_PATH, O_WRONLY | O_APPEND);
+        if (fd == -1) {
+            ret = errno;
+            DEBUG(SSSDBG_MINOR_FAILURE, "Unable to open %s [%d]: %s\n",
+                  SSS_SSH_KNOWN_HOSTS_PATH, ret, sss_strerror(ret));
+            ret = ssh_known_hosts_write_all(ssh_ctx, now);
+            goto done;
+        }
+
+        wret = sss_atomic_write_s(fd, entstr, strlen(entstr));
+        if (wret == -1) {
+            ret = errno;
+            goto done;
+        }
+
+        DEBUG(SSSDBG_TRACE_FUNC, "Appended %zu keys of [%s] to %s\n",
+              entry->num_pubkeys - i, name, SSS_SSH_KNOWN_HOSTS_PATH);
+    }
+
+    value.type = HASH_VALUE_PTR;
+    value.ptr = entry;
+    hret = hash_enter(kh->entries, &key, &value);
+    if (hret != HASH_SUCCESS) {
+        ret = EIO;
+        goto done;
+    }
+    talloc_steal(kh->entries, entry);
+    talloc_free(old_entry);
+
+    ssh_known_hosts_schedule_compaction(kh, entry->expire);
+
+    ret = EOK;
+
+done:
+    if (fd != -1) {
+        close(fd);
+    }
+    talloc_free(tmp_ctx);
+    return ret;
+}
+
+static errno_t
+ssh_host_pubkeys_update_known_hosts(struct ssh_cmd_ctx *cmd_ctx)
+{
+    struct cli_ctx *cctx = cmd_ctx->cctx;
+    struct ssh_ctx *ssh_ctx = (struct ssh_ctx *)cctx->rctx->pvt_ctx;
+    struct sss_domain_info *dom;
+    time_t now = time(NULL);
+    char *key;
+    hash_key_t hkey;
+    hash_value_t value;
+    bool found = false;
+    errno_t ret;
+
+    if (cmd_ctx->domain) {
+        ret = sysdb_update_ssh_known_host_expire(cmd_ctx->domain,
+                                                 cmd_ctx->name, now,
+                                                 ssh_ctx->known_hosts_timeout);
+        if (ret != EOK && ret != ENOENT) {
+            return ret;
+        }
+    }
+
+    if (ssh_ctx->known_hosts == NULL) {
+        ret = ssh_known_hosts_write_all(ssh_ctx, now);
+    } else if (cmd_ctx->result != NULL) {
+        ret = ssh_known_hosts_update_host(ssh_ctx, cmd_ctx->domain,
+                                          cmd_ctx->name, now);
+    } else {
+        /* The host might have been removed from the cache */
+        for (dom = cctx->rctx->domains; dom; dom = get_next_domain(dom, false)) {
+            key = ssh_known_hosts_key(NULL, dom, cmd_ctx->name);
+            if (key == NULL) {
+                return ENOMEM;
+            }
+
+            hkey.type = HASH_KEY_STRING;
+            hkey.str = key;
+            found = hash_lookup(ssh_ctx->known_hosts->entries,
+                                &hkey, &value) == HASH_SUCCESS;
+            talloc_free(key);
+            if (found) {
+                break;
+            }
+        }
+
+        ret = found ? ssh_known_hosts_write_all(ssh_ctx, now) : EOK;
+    }
+
+    if (ret != EOK) {
+        DEBUG(SSSDBG_OP_FAILURE, "Failed to update %s [%d]: %s\n",
+              SSS_SSH_KNOWN_HOSTS_PATH, ret, sss_strerror(ret));
+    }
+
+    return ret;
+}
+
 static errno_t
 ssh_cmd_parse_request(struct ssh_cmd_ctx *cmd_ctx)
 {
@@ -814,11 +1271,8 @@ static errno_t get_valid_certs_keys(TALLOC_CTX *mem_ctx,
     TALLOC_CTX *tmp_ctx;
     uint8_t *key;
     size_t key_len;
-    char *cert_verification_opts;
-    struct cert_verify_opts *cert_verify_opts;
     int ret;
     struct ldb_message_element *el_res;
-    struct cli_ctx *cctx = cmd_ctx->cctx;
     size_t d;
 
     if (el_cert == NULL) {
@@ -832,25 +1286,6 @@ static errno_t get_valid_certs_keys(TALLOC_CTX *mem_ctx,
         return ENOMEM;
     }
 
-    ret = confdb_get_string(cctx->rctx->cdb, tmp_ctx,
-                            CONFDB_MONITOR_CONF_ENTRY,
-                            CONFDB_MONITOR_CERT_VERIFICATION, NULL,
-                            &cert_verification_opts);
-    if (ret != EOK) {
-        DEBUG(SSSDBG_CRIT_FAILURE,
-              "Failed to read p11_child_timeout from confdb: [%d] %s\n",
-              ret, sss_strerror(ret));
-        goto done;
-    }
-
-    ret = parse_cert_verify_opts(tmp_ctx, cert_verification_opts,
-                                 &cert_verify_opts);
-    if (ret != EOK) {
-        DEBUG(SSSDBG_FATAL_FAILURE,
-              "Failed to parse verifiy option.\n");
-        goto done;
-    }
-
     el_res = talloc_zero(tmp_ctx, struct ldb_message_element);
     if (el_res == NULL) {
         DEBUG(SSSDBG_OP_FAILURE, "talloc_zero failed.\n");
@@ -866,10 +1301,10 @@ static errno_t get_valid_certs_keys(TALLOC_CTX *mem_ctx,
     }
 
     for (d = 0; d < el_cert->num_values; d++) {
-            ret = cert_to_ssh_key(tmp_ctx, ssh_ctx->ca_db,
-                                  el_cert->values[d].data,
-                                  el_cert->values[d].length,
-                                  cert_verify_opts, &key, &key_len);
+            ret = sss_cert_cache_validate(tmp_ctx, ssh_ctx->cert_cache,
+                                          el_cert->values[d].data,
+                                          el_cert->values[d].length,
+                                          &key, &key_len);
             if (ret != EOK) {
                 DEBUG(SSSDBG_OP_FAILURE, "cert_to_ssh_key failed, ignoring.\n");
                 continue;
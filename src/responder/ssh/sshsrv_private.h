@@ -22,9 +22,18 @@
 #define _SSHSRV_PRIVATE_H_
 
 #include "responder/common/responder.h"
+#include "responder/common/cert_cache.h"
 
+/* The unit tests write the file elsewhere */
+#ifndef SSS_SSH_KNOWN_HOSTS_PATH
 #define SSS_SSH_KNOWN_HOSTS_PATH PUBCONF_PATH"/known_hosts"
 #define SSS_SSH_KNOWN_HOSTS_TEMP_TMPL PUBCONF_PATH"/.known_hosts.XXXXXX"
+#endif
+
+/* Seconds to wait after a host expires before known_hosts is rewritten */
+#define SSS_SSH_KNOWN_HOSTS_COMPACT_DELAY 30
+
+struct ssh_known_hosts;
 
 struct ssh_ctx {
     struct resp_ctx *rctx;
@@ -33,6 +42,10 @@ struct ssh_ctx {
     bool hash_known_hosts;
     int known_hosts_timeout;
     char *ca_db;
+    struct sss_cert_cache *cert_cache;
+
+    /* contents of the known_hosts file, NULL until it is first written */
+    struct ssh_known_hosts *known_hosts;
 };
 
 struct ssh_cmd_ctx {
@@ -40,6 +40,7 @@ struct mon_cli_iface monitor_sudo_methods = {
     .clearMemcache = NULL,
     .clearEnumCache = NULL,
     .sysbusReconnect = NULL,
+    .perfStats = monitor_common_perf_stats,
 };
 
 static void sudo_dp_reconnect_init(struct sbus_connection *conn,
@@ -168,6 +168,7 @@ done:
 }
 
 static errno_t sudosrv_expired_rules(TALLOC_CTX *mem_ctx,
+                                     struct sudo_ctx *sudo_ctx,
                                      struct sss_domain_info *domain,
                                      uid_t uid,
                                      const char *username,
@@ -176,9 +177,19 @@ static errno_t sudosrv_expired_rules(TALLOC_CTX *mem_ctx,
                                      uint32_t *_num_rules)
 {
     const char *attrs[] = { SYSDB_NAME, NULL };
+    struct sudosrv_index *index;
     char *filter;
     errno_t ret;
 
+    ret = sudosrv_index_update(sudo_ctx, domain, &index);
+    if (ret == EOK) {
+        return sudosrv_index_expired(mem_ctx, index, uid, username, groups,
+                                     time(NULL), _rules, _num_rules);
+    }
+
+    DEBUG(SSSDBG_MINOR_FAILURE,
+          "Sudo rule index is not available, searching the cache\n");
+
     filter = sysdb_sudo_filter_expired(NULL, username, groups, uid);
     if (filter == NULL) {
         return ENOMEM;
@@ -300,6 +311,7 @@ static errno_t sudosrv_cached_rules_by_ng(TALLOC_CTX *mem_ctx,
 }
 
 static errno_t sudosrv_cached_rules(TALLOC_CTX *mem_ctx,
+                                    struct sudo_ctx *sudo_ctx,
                                     struct sss_domain_info *domain,
                                     uid_t uid,
                                     const char *username,
@@ -309,6 +321,7 @@ static errno_t sudosrv_cached_rules(TALLOC_CTX *mem_ctx,
                                     uint32_t *_num_rules)
 {
     TALLOC_CTX *tmp_ctx;
+    struct sudosrv_index *index;
     struct sysdb_attrs **user_rules;
     struct sysdb_attrs **ng_rules;
     struct sysdb_attrs **rules;
@@ -318,6 +331,16 @@ static errno_t sudosrv_cached_rules(TALLOC_CTX *mem_ctx,
     uint32_t rule_iter, i;
     errno_t ret;
 
+    /* The index already keeps the rules sorted by sudoOrder */
+    ret = sudosrv_index_update(sudo_ctx, domain, &index);
+    if (ret == EOK) {
+        return sudosrv_index_lookup(mem_ctx, index, uid, username, groups,
+                                    _rules, _num_rules);
+    }
+
+    DEBUG(SSSDBG_MINOR_FAILURE,
+          "Sudo rule index is not available, searching the cache\n");
+
     tmp_ctx = talloc_new(NULL);
     if (tmp_ctx == NULL) {
         return ENOMEM;
@@ -408,6 +431,7 @@ static errno_t sudosrv_cached_defaults(TALLOC_CTX *mem_ctx,
 }
 
 static errno_t sudosrv_fetch_rules(TALLOC_CTX *mem_ctx,
+                                   struct sudo_ctx *sudo_ctx,
                                    enum sss_sudo_type type,
                                    struct sss_domain_info *domain,
                                    uid_t uid,
@@ -428,8 +452,8 @@ static errno_t sudosrv_fetch_rules(TALLOC_CTX *mem_ctx,
               username, domain->name);
         debug_name = "rules";
 
-        ret = sudosrv_cached_rules(mem_ctx, domain, uid, username, groups,
-                                   inverse_order, &rules, &num_rules);
+        ret = sudosrv_cached_rules(mem_ctx, sudo_ctx, domain, uid, username,
+                                   groups, inverse_order, &rules, &num_rules);
 
         break;
     case SSS_SUDO_DEFAULTS:
@@ -477,7 +501,7 @@ static void sudosrv_refresh_rules_done(struct tevent_req *subreq);
 static struct tevent_req *
 sudosrv_refresh_rules_send(TALLOC_CTX *mem_ctx,
                            struct tevent_context *ev,
-                           struct resp_ctx *rctx,
+                           struct sudo_ctx *sudo_ctx,
                            struct sss_domain_info *domain,
                            uid_t uid,
                            const char *username,
@@ -497,11 +521,11 @@ sudosrv_refresh_rules_send(TALLOC_CTX *mem_ctx,
         return NULL;
     }
 
-    state->rctx = rctx;
+    state->rctx = sudo_ctx->rctx;
     state->domain = domain;
     state->username = username;
 
-    ret = sudosrv_expired_rules(state, domain, uid, username, groups,
+    ret = sudosrv_expired_rules(state, sudo_ctx, domain, uid, username, groups,
                                 &rules, &num_rules);
     if (ret != EOK) {
         DEBUG(SSSDBG_CRIT_FAILURE,
@@ -520,7 +544,7 @@ sudosrv_refresh_rules_send(TALLOC_CTX *mem_ctx,
     DEBUG(SSSDBG_TRACE_INTERNAL, "Refreshing %d expired rules of [%s@%s]\n",
           num_rules, username, domain->name);
 
-    subreq = sss_dp_get_sudoers_send(state, rctx, domain, false,
+    subreq = sss_dp_get_sudoers_send(state, state->rctx, domain, false,
                                      SSS_DP_SUDO_REFRESH_RULES,
                                      username, num_rules, rules);
     if (subreq == NULL) {
@@ -602,7 +626,7 @@ static errno_t sudosrv_refresh_rules_recv(struct tevent_req *req)
 
 struct sudosrv_get_rules_state {
     struct tevent_context *ev;
-    struct resp_ctx *rctx;
+    struct sudo_ctx *sudo_ctx;
     enum sss_sudo_type type;
     uid_t uid;
     char *username;
@@ -636,7 +660,7 @@ struct tevent_req *sudosrv_get_rules_send(TALLOC_CTX *mem_ctx,
     }
 
     state->ev = ev;
-    state->rctx = sudo_ctx->rctx;
+    state->sudo_ctx = sudo_ctx;
     state->type = type;
     state->uid = uid;
     state->inverse_order = sudo_ctx->inverse_order;
@@ -690,7 +714,7 @@ static void sudosrv_get_rules_initgr_done(struct tevent_req *subreq)
         goto done;
     }
 
-    subreq = sudosrv_refresh_rules_send(state, state->ev, state->rctx,
+    subreq = sudosrv_refresh_rules_send(state, state->ev, state->sudo_ctx,
                                         state->domain, state->uid,
                                         state->username, state->groups);
     if (subreq == NULL) {
@@ -728,7 +752,8 @@ static void sudosrv_get_rules_done(struct tevent_req *subreq)
               "in cache.\n");
     }
 
-    ret = sudosrv_fetch_rules(state, state->type, state->domain, state->uid,
+    ret = sudosrv_fetch_rules(state, state->sudo_ctx, state->type,
+                              state->domain, state->uid,
                               state->username, state->groups,
                               state->inverse_order,
                               &state->rules, &state->num_rules);
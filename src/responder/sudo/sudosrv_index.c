@@ -0,0 +1,932 @@
+/*
+    SSSD
+
+    In-memory index of cached sudo rules
+
+    Copyright (C) 2016 Red Hat
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <stdint.h>
+#include <string.h>
+#include <talloc.h>
+#include <dhash.h>
+
+#include "util/util.h"
+#include "db/sysdb_sudo.h"
+#include "responder/sudo/sudosrv_private.h"
+
+/* If more generations than this were missed, a full rebuild is cheaper
+ * than a filter with that many alternatives. */
+#define SUDOSRV_INDEX_MAX_GENERATIONS 16
+
+#define SUDOSRV_INDEX_RULE_ATTRS \
+    SYSDB_OBJECTCLASS,                  \
+    SYSDB_SUDO_CACHE_AT_CN,             \
+    SYSDB_SUDO_CACHE_AT_USER,           \
+    SYSDB_SUDO_CACHE_AT_HOST,           \
+    SYSDB_SUDO_CACHE_AT_COMMAND,        \
+    SYSDB_SUDO_CACHE_AT_OPTION,         \
+    SYSDB_SUDO_CACHE_AT_RUNAS,          \
+    SYSDB_SUDO_CACHE_AT_RUNASUSER,      \
+    SYSDB_SUDO_CACHE_AT_RUNASGROUP,     \
+    SYSDB_SUDO_CACHE_AT_NOTBEFORE,      \
+    SYSDB_SUDO_CACHE_AT_NOTAFTER,       \
+    SYSDB_SUDO_CACHE_AT_ORDER
+
+struct sudosrv_index_rule {
+    const char *name;
+    time_t expire;
+    uint32_t order;
+    bool netgroup;
+
+    /* attributes that are sent to sudo */
+    struct sysdb_attrs *attrs;
+    const char **users;
+
+    /* position in the sudoOrder sorted list of all rules */
+    size_t pos;
+};
+
+struct sudosrv_index_list {
+    struct sudosrv_index_rule **rules;
+    size_t count;
+};
+
+struct sudosrv_index_data {
+    /* rule name -> struct sudosrv_index_rule */
+    hash_table_t *rules;
+    /* sudoUser value -> struct sudosrv_index_list */
+    hash_table_t *users;
+    /* rules with at least one +netgroup sudoUser value */
+    struct sudosrv_index_list netgroups;
+};
+
+struct sudosrv_index {
+    struct sudosrv_index *prev;
+    struct sudosrv_index *next;
+
+    const char *domain;
+    bool inverse_order;
+    uint32_t generation;
+    struct sudosrv_index_data *data;
+};
+
+struct sudosrv_index_match {
+    struct sudosrv_index_rule *rule;
+    bool by_user;
+};
+
+static errno_t sudosrv_index_list_add(TALLOC_CTX *mem_ctx,
+                                      struct sudosrv_index_list *list,
+                                      struct sudosrv_index_rule *rule)
+{
+    struct sudosrv_index_rule **rules;
+
+    rules = talloc_realloc(mem_ctx, list->rules, struct sudosrv_index_rule *,
+                           list->count + 1);
+    if (rules == NULL) {
+        return ENOMEM;
+    }
+
+    rules[list->count] = rule;
+    list->rules = rules;
+    list->count++;
+
+    return EOK;
+}
+
+static void sudosrv_index_list_del(struct sudosrv_index_list *list,
+                                   struct sudosrv_index_rule *rule)
+{
+    size_t i;
+
+    for (i = 0; i < list->count; i++) {
+        if (list->rules[i] == rule) {
+            memmove(&list->rules[i], &list->rules[i + 1],
+                    (list->count - i - 1) * sizeof(*list->rules));
+            list->count--;
+            i--;
+        }
+    }
+}
+
+static struct sudosrv_index_list *
+sudosrv_index_users_list(hash_table_t *table, const char *value)
+{
+    hash_key_t key;
+    hash_value_t hvalue;
+    int hret;
+
+    key.type = HASH_KEY_STRING;
+    key.str = discard_const(value);
+
+    hret = hash_lookup(table, &key, &hvalue);
+    if (hret != HASH_SUCCESS) {
+        return NULL;
+    }
+
+    return talloc_get_type(hvalue.ptr, struct sudosrv_index_list);
+}
+
+static errno_t sudosrv_index_rule_new(TALLOC_CTX *mem_ctx,
+                                      struct ldb_message *msg,
+                                      struct sudosrv_index_rule **_rule)
+{
+    static const char *attrs[] = { SUDOSRV_INDEX_RULE_ATTRS, NULL };
+    struct sudosrv_index_rule *rule;
+    struct ldb_message_element *el;
+    const char *name;
+    errno_t ret;
+    int i;
+    int j;
+
+    name = ldb_msg_find_attr_as_string(msg, SYSDB_NAME, NULL);
+    if (name == NULL) {
+        DEBUG(SSSDBG_MINOR_FAILURE, "Rule without a name, skipping\n");
+        return EINVAL;
+    }
+
+    rule = talloc_zero(mem_ctx, struct sudosrv_index_rule);
+    if (rule == NULL) {
+        return ENOMEM;
+    }
+
+    rule->name = talloc_strdup(rule, name);
+    rule->attrs = sysdb_new_attrs(rule);
+    if (rule->name == NULL || rule->attrs == NULL) {
+        ret = ENOMEM;
+        goto done;
+    }
+
+    /* man sudoers-ldap: If the sudoOrder attribute is not present,
+     * a value of 0 is assumed */
+    rule->order = ldb_msg_find_attr_as_uint(msg, SYSDB_SUDO_CACHE_AT_ORDER, 0);
+    rule->expire = ldb_msg_find_attr_as_uint64(msg, SYSDB_CACHE_EXPIRE, 0);
+
+    for (i = 0; attrs[i] != NULL; i++) {
+        el = ldb_msg_find_element(msg, attrs[i]);
+        if (el == NULL) {
+            continue;
+        }
+
+        for (j = 0; j < el->num_values; j++) {
+            ret = sysdb_attrs_add_val(rule->attrs, el->name, &el->values[j]);
+            if (ret != EOK) {
+                goto done;
+            }
+        }
+    }
+
+    el = ldb_msg_find_element(msg, SYSDB_SUDO_CACHE_AT_USER);
+    if (el != NULL) {
+        rule->users = sss_ldb_el_to_string_list(rule, el);
+    } else {
+        rule->users = talloc_zero_array(rule, const char *, 1);
+    }
+    if (rule->users == NULL) {
+        ret = ENOMEM;
+        goto done;
+    }
+
+    for (i = 0; rule->users[i] != NULL; i++) {
+        if (rule->users[i][0] == '+') {
+            rule->netgroup = true;
+        }
+    }
+
+    *_rule = rule;
+    ret = EOK;
+
+done:
+    if (ret != EOK) {
+        talloc_free(rule);
+    }
+    return ret;
+}
+
+static void sudosrv_index_del_rule(struct sudosrv_index_data *data,
+                                   const char *name)
+{
+    struct sudosrv_index_rule *rule;
+    struct sudosrv_index_list *list;
+    hash_key_t key;
+    hash_value_t value;
+    int hret;
+    int i;
+
+    key.type = HASH_KEY_STRING;
+    key.str = discard_const(name);
+
+    hret = hash_lookup(data->rules, &key, &value);
+    if (hret != HASH_SUCCESS) {
+        return;
+    }
+    rule = talloc_get_type(value.ptr, struct sudosrv_index_rule);
+
+    for (i = 0; rule->users[i] != NULL; i++) {
+        list = sudosrv_index_users_list(data->users, rule->users[i]);
+        if (list != NULL) {
+            sudosrv_index_list_del(list, rule);
+        }
+    }
+
+    if (rule->netgroup) {
+        sudosrv_index_list_del(&data->netgroups, rule);
+    }
+
+    hash_delete(data->rules, &key);
+    talloc_free(rule);
+}
+
+static errno_t sudosrv_index_add_rule(struct sudosrv_index_data *data,
+                                      struct ldb_message *msg)
+{
+    struct sudosrv_index_rule *rule;
+    struct sudosrv_index_list *list;
+    hash_key_t key;
+    hash_value_t value;
+    errno_t ret;
+    int hret;
+    int i;
+
+    ret = sudosrv_index_rule_new(data, msg, &rule);
+    if (ret == EINVAL) {
+        return EOK;
+    } else if (ret != EOK) {
+        return ret;
+    }
+
+    /* Updated rules replace the previous version */
+    sudosrv_index_del_rule(data, rule->name);
+
+    key.type = HASH_KEY_STRING;
+    key.str = discard_const(rule->name);
+    value.type = HASH_VALUE_PTR;
+    value.ptr = rule;
+
+    hret = hash_enter(data->rules, &key, &value);
+    if (hret != HASH_SUCCESS) {
+        talloc_free(rule);
+        return EIO;
+    }
+
+    for (i = 0; rule->users[i] != NULL; i++) {
+        list = sudosrv_index_users_list(data->users, rule->users[i]);
+        if (list == NULL) {
+            list = talloc_zero(data, struct sudosrv_index_list);
+            if (list == NULL) {
+                return ENOMEM;
+            }
+
+            key.str = discard_const(rule->users[i]);
+            value.ptr = list;
+            hret = hash_enter(data->users, &key, &value);
+            if (hret != HASH_SUCCESS) {
+                return EIO;
+            }
+        }
+
+        ret = sudosrv_index_list_add(list, list, rule);
+        if (ret != EOK) {
+            return ret;
+        }
+    }
+
+    if (rule->netgroup) {
+        ret = sudosrv_index_list_add(data, &data->netgroups, rule);
+        if (ret != EOK) {
+            return ret;
+        }
+    }
+
+    return EOK;
+}
+
+static int sudosrv_index_order_cmp(const void *a, const void *b, bool lower_wins)
+{
+    struct sudosrv_index_rule *r1;
+    struct sudosrv_index_rule *r2;
+
+    r1 = * (struct sudosrv_index_rule * const *) a;
+    r2 = * (struct sudosrv_index_rule * const *) b;
+
+    if (r1->order != r2->order) {
+        if (lower_wins) {
+            /* The lowest value takes priority. Original wrong SSSD
+             * behaviour. */
+            return r1->order < r2->order ? -1 : 1;
+        }
+
+        /* The higher value takes priority. Standard LDAP behaviour. */
+        return r1->order > r2->order ? -1 : 1;
+    }
+
+    /* Keep the order of rules with the same sudoOrder stable */
+    return strcmp(r1->name, r2->name);
+}
+
+static int sudosrv_index_order_low_cmp_fn(const void *a, const void *b)
+{
+    return sudosrv_index_order_cmp(a, b, true);
+}
+
+static int sudosrv_index_order_high_cmp_fn(const void *a, const void *b)
+{
+    return sudosrv_index_order_cmp(a, b, false);
+}
+
+/* Assign each rule its position in the sudoOrder sorted list so that the
+ * lookups only need to sort the positions of the matching rules. */
+static errno_t sudosrv_index_sort(struct sudosrv_index *index)
+{
+    struct sudosrv_index_rule **rules;
+    hash_value_t *values;
+    unsigned long count;
+    unsigned long i;
+    int hret;
+
+    hret = hash_values(index->data->rules, &count, &values);
+    if (hret != HASH_SUCCESS) {
+        return EIO;
+    }
+
+    rules = talloc_array(NULL, struct sudosrv_index_rule *, count);
+    if (rules == NULL) {
+        talloc_free(values);
+        return ENOMEM;
+    }
+
+    for (i = 0; i < count; i++) {
+        rules[i] = talloc_get_type(values[i].ptr, struct sudosrv_index_rule);
+    }
+    talloc_free(values);
+
+    qsort(rules, count, sizeof(struct sudosrv_index_rule *),
+          index->inverse_order ? sudosrv_index_order_low_cmp_fn
+                               : sudosrv_index_order_high_cmp_fn);
+
+    for (i = 0; i < count; i++) {
+        rules[i]->pos = i;
+    }
+
+    talloc_free(rules);
+    return EOK;
+}
+
+static errno_t sudosrv_index_load(struct sss_domain_info *domain,
+                                  struct sudosrv_index_data *data,
+                                  const char *filter)
+{
+    static const char *attrs[] = { SUDOSRV_INDEX_RULE_ATTRS,
+                                   SYSDB_NAME,
+                                   SYSDB_CACHE_EXPIRE,
+                                   NULL };
+    TALLOC_CTX *tmp_ctx;
+    struct ldb_message **msgs;
+    size_t count;
+    size_t i;
+    errno_t ret;
+
+    tmp_ctx = talloc_new(NULL);
+    if (tmp_ctx == NULL) {
+        return ENOMEM;
+    }
+
+    DEBUG(SSSDBG_FUNC_DATA, "Searching sysdb with [%s]\n", filter);
+
+    ret = sysdb_search_custom(tmp_ctx, domain, filter, SUDORULE_SUBDIR,
+                              attrs, &count, &msgs);
+    if (ret == ENOENT) {
+        ret = EOK;
+        goto done;
+    } else if (ret != EOK) {
+        DEBUG(SSSDBG_CRIT_FAILURE, "Error looking up SUDO rules\n");
+        goto done;
+    }
+
+    for (i = 0; i < count; i++) {
+        ret = sudosrv_index_add_rule(data, msgs[i]);
+        if (ret != EOK) {
+            goto done;
+        }
+    }
+
+    DEBUG(SSSDBG_TRACE_FUNC, "Indexed %zu sudo rules\n", count);
+
+    ret = EOK;
+
+done:
+    talloc_free(tmp_ctx);
+    return ret;
+}
+
+static errno_t sudosrv_index_rebuild(struct sudosrv_index *index,
+                                     struct sss_domain_info *domain)
+{
+    struct sudosrv_index_data *data;
+    errno_t ret;
+
+    data = talloc_zero(index, struct sudosrv_index_data);
+    if (data == NULL) {
+        return ENOMEM;
+    }
+
+    ret = sss_hash_create(data, 0, &data->rules);
+    if (ret != EOK) {
+        goto done;
+    }
+
+    ret = sss_hash_create(data, 0, &data->users);
+    if (ret != EOK) {
+        goto done;
+    }
+
+    ret = sudosrv_index_load(domain, data,
+                             "(" SYSDB_OBJECTCLASS "=" SYSDB_SUDO_CACHE_OC ")");
+    if (ret != EOK) {
+        goto done;
+    }
+
+    talloc_free(index->data);
+    index->data = data;
+
+    ret = EOK;
+
+done:
+    if (ret != EOK) {
+        talloc_free(data);
+    }
+    return ret;
+}
+
+static errno_t sudosrv_index_refresh(struct sudosrv_index *index,
+                                     struct sss_domain_info *domain,
+                                     uint32_t generation)
+{
+    char *filter;
+    uint32_t gen;
+    errno_t ret;
+
+    filter = talloc_asprintf(NULL, "(&(%s=%s)(|", SYSDB_OBJECTCLASS,
+                             SYSDB_SUDO_CACHE_OC);
+    for (gen = index->generation + 1;
+         filter != NULL && gen <= generation;
+         gen++) {
+        filter = talloc_asprintf_append(filter, "(%s=%"PRIu32")",
+                                        SYSDB_SUDO_CACHE_AT_GENERATION, gen);
+    }
+    if (filter != NULL) {
+        filter = talloc_asprintf_append(filter, "))");
+    }
+    if (filter == NULL) {
+        return ENOMEM;
+    }
+
+    ret = sudosrv_index_load(domain, index->data, filter);
+    talloc_free(filter);
+
+    return ret;
+}
+
+errno_t sudosrv_index_update(struct sudo_ctx *sudo_ctx,
+                             struct sss_domain_info *domain,
+                             struct sudosrv_index **_index)
+{
+    struct sudosrv_index *index;
+    uint32_t generation;
+    uint32_t purge_generation;
+    bool full;
+    errno_t ret;
+
+    if (IS_SUBDOMAIN(domain)) {
+        /* rules are stored inside parent domain tree */
+        domain = domain->parent;
+    }
+
+    for (index = sudo_ctx->indexes; index != NULL; index = index->next) {
+        if (strcmp(index->domain, domain->name) == 0) {
+            break;
+        }
+    }
+
+    if (index == NULL) {
+        index = talloc_zero(sudo_ctx, struct sudosrv_index);
+        if (index == NULL) {
+            return ENOMEM;
+        }
+
+        index->domain = talloc_strdup(index, domain->name);
+        if (index->domain == NULL) {
+            talloc_free(index);
+            return ENOMEM;
+        }
+
+        index->inverse_order = sudo_ctx->inverse_order;
+        DLIST_ADD(sudo_ctx->indexes, index);
+    }
+
+    /* The generation is read first so that rules changed during the
+     * update are fetched again the next time. */
+    ret = sysdb_sudo_get_generation(domain, &generation, &purge_generation);
+    if (ret != EOK) {
+        DEBUG(SSSDBG_OP_FAILURE, "Unable to read sudo cache generation "
+              "[%d]: %s\n", ret, sss_strerror(ret));
+        return ret;
+    }
+
+    if (index->data != NULL && generation == index->generation) {
+        *_index = index;
+        return EOK;
+    }
+
+    /* Purged rules can only be noticed by reading all of them again */
+    full = index->data == NULL
+            || generation < index->generation
+            || purge_generation > index->generation
+            || generation - index->generation > SUDOSRV_INDEX_MAX_GENERATIONS;
+
+    DEBUG(SSSDBG_TRACE_FUNC, "%s sudo rule index of [%s] from generation "
+          "%"PRIu32" to %"PRIu32"\n", full ? "Rebuilding" : "Updating",
+          domain->name, index->generation, generation);
+
+    if (full) {
+        ret = sudosrv_index_rebuild(index, domain);
+    } else {
+        ret = sudosrv_index_refresh(index, domain, generation);
+    }
+    if (ret != EOK) {
+        goto done;
+    }
+
+    ret = sudosrv_index_sort(index);
+    if (ret != EOK) {
+        goto done;
+    }
+
+    index->generation = generation;
+    *_index = index;
+
+    ret = EOK;
+
+done:
+    if (ret != EOK) {
+        DEBUG(SSSDBG_OP_FAILURE, "Unable to update sudo rule index "
+              "[%d]: %s\n", ret, sss_strerror(ret));
+        /* The index may be incomplete, start again next time */
+        talloc_zfree(index->data);
+    }
+    return ret;
+}
+
+static int sudosrv_index_match_cmp_fn(const void *a, const void *b)
+{
+    const struct sudosrv_index_match *m1 = a;
+    const struct sudosrv_index_match *m2 = b;
+
+    if (m1->rule->pos != m2->rule->pos) {
+        return m1->rule->pos < m2->rule->pos ? -1 : 1;
+    }
+
+    /* Prefer the match by user, the rule is then returned as such */
+    return (int)m2->by_user - (int)m1->by_user;
+}
+
+static errno_t sudosrv_index_append(TALLOC_CTX *mem_ctx,
+                                    struct sudosrv_index_list *list,
+                                    bool by_user,
+                                    struct sudosrv_index_match **_matches,
+                                    size_t *_count)
+{
+    struct sudosrv_index_match *matches;
+    size_t i;
+
+    if (list == NULL || list->count == 0) {
+        return EOK;
+    }
+
+    matches = talloc_realloc(mem_ctx, *_matches, struct sudosrv_index_match,
+                             *_count + list->count);
+    if (matches == NULL) {
+        return ENOMEM;
+    }
+
+    for (i = 0; i < list->count; i++) {
+        matches[*_count + i].rule = list->rules[i];
+        matches[*_count + i].by_user = by_user;
+    }
+
+    *_matches = matches;
+    *_count += list->count;
+
+    return EOK;
+}
+
+/* Collects the rules that match the user by name, uid, group or ALL and
+ * the rules that contain a netgroup, sorted by sudoOrder. */
+static errno_t sudosrv_index_matches(TALLOC_CTX *mem_ctx,
+                                     struct sudosrv_index *index,
+                                     uid_t uid,
+                                     const char *username,
+                                     char **groups,
+                                     struct sudosrv_index_match **_matches,
+                                     size_t *_count)
+{
+    TALLOC_CTX *tmp_ctx;
+    struct sudosrv_index_match *matches = NULL;
+    hash_table_t *users = index->data->users;
+    size_t count = 0;
+    size_t num;
+    size_t i;
+    char *key;
+    errno_t ret;
+
+    tmp_ctx = talloc_new(NULL);
+    if (tmp_ctx == NULL) {
+        return ENOMEM;
+    }
+
+    ret = sudosrv_index_append(tmp_ctx, sudosrv_index_users_list(users, "ALL"),
+                               true, &matches, &count);
+    if (ret != EOK) {
+        goto done;
+    }
+
+    ret = sudosrv_index_append(tmp_ctx,
+                               sudosrv_index_users_list(users, username),
+                               true, &matches, &count);
+    if (ret != EOK) {
+        goto done;
+    }
+
+    if (uid != 0) {
+        key = talloc_asprintf(tmp_ctx, "#%"SPRIuid, uid);
+        if (key == NULL) {
+            ret = ENOMEM;
+            goto done;
+        }
+
+        ret = sudosrv_index_append(tmp_ctx,
+                                   sudosrv_index_users_list(users, key),
+                                   true, &matches, &count);
+        if (ret != EOK) {
+            goto done;
+        }
+    }
+
+    for (i = 0; groups != NULL && groups[i] != NULL; i++) {
+        key = talloc_asprintf(tmp_ctx, "%%%s", groups[i]);
+        if (key == NULL) {
+            ret = ENOMEM;
+            goto done;
+        }
+
+        ret = sudosrv_index_append(tmp_ctx,
+                                   sudosrv_index_users_list(users, key),
+                                   true, &matches, &count);
+        if (ret != EOK) {
+            goto done;
+        }
+    }
+
+    ret = sudosrv_index_append(tmp_ctx, &index->data->netgroups, false,
+                               &matches, &count);
+    if (ret != EOK) {
+        goto done;
+    }
+
+    if (count > 0) {
+        qsort(matches, count, sizeof(struct sudosrv_index_match),
+              sudosrv_index_match_cmp_fn);
+    }
+
+    /* Remove the rules that matched more than once */
+    for (i = 0, num = 0; i < count; i++) {
+        if (num > 0 && matches[num - 1].rule == matches[i].rule) {
+            continue;
+        }
+        matches[num] = matches[i];
+        num++;
+    }
+
+    *_matches = talloc_steal(mem_ctx, matches);
+    *_count = num;
+
+    ret = EOK;
+
+done:
+    talloc_free(tmp_ctx);
+    return ret;
+}
+
+static struct sysdb_attrs *
+sudosrv_index_rule_copy(TALLOC_CTX *mem_ctx,
+                        struct sudosrv_index_rule *rule,
+                        const char *sudo_user)
+{
+    struct sysdb_attrs *attrs;
+    struct ldb_message_element *el;
+    errno_t ret;
+    size_t i;
+    int j;
+
+    attrs = sysdb_new_attrs(mem_ctx);
+    if (attrs == NULL) {
+        return NULL;
+    }
+
+    for (i = 0; i < rule->attrs->num; i++) {
+        el = &rule->attrs->a[i];
+        if (sudo_user != NULL
+                && strcasecmp(el->name, SYSDB_SUDO_CACHE_AT_USER) == 0) {
+            continue;
+        }
+
+        for (j = 0; j < el->num_values; j++) {
+            ret = sysdb_attrs_add_val(attrs, el->name, &el->values[j]);
+            if (ret != EOK) {
+                goto fail;
+            }
+        }
+    }
+
+    if (sudo_user != NULL) {
+        ret = sysdb_attrs_add_string(attrs, SYSDB_SUDO_CACHE_AT_USER,
+                                     sudo_user);
+        if (ret != EOK) {
+            goto fail;
+        }
+    }
+
+    return attrs;
+
+fail:
+    talloc_free(attrs);
+    return NULL;
+}
+
+errno_t sudosrv_index_lookup(TALLOC_CTX *mem_ctx,
+                             struct sudosrv_index *index,
+                             uid_t uid,
+                             const char *username,
+                             char **groups,
+                             struct sysdb_attrs ***_rules,
+                             uint32_t *_num_rules)
+{
+    TALLOC_CTX *tmp_ctx;
+    struct sudosrv_index_match *matches;
+    struct sysdb_attrs **rules;
+    const char *sudo_user;
+    size_t count;
+    size_t i;
+    errno_t ret;
+
+    tmp_ctx = talloc_new(NULL);
+    if (tmp_ctx == NULL) {
+        return ENOMEM;
+    }
+
+    ret = sudosrv_index_matches(tmp_ctx, index, uid, username, groups,
+                                &matches, &count);
+    if (ret != EOK) {
+        goto done;
+    }
+
+    if (count == 0) {
+        *_rules = NULL;
+        *_num_rules = 0;
+        ret = EOK;
+        goto done;
+    }
+
+    /* Add sudoUser: #uid to prevent conflicts with fqnames. */
+    sudo_user = talloc_asprintf(tmp_ctx, "#%"SPRIuid, uid);
+    if (sudo_user == NULL) {
+        ret = ENOMEM;
+        goto done;
+    }
+
+    rules = talloc_array(tmp_ctx, struct sysdb_attrs *, count);
+    if (rules == NULL) {
+        ret = ENOMEM;
+        goto done;
+    }
+
+    for (i = 0; i < count; i++) {
+        rules[i] = sudosrv_index_rule_copy(rules, matches[i].rule,
+                                           matches[i].by_user ? sudo_user
+                                                              : NULL);
+        if (rules[i] == NULL) {
+            ret = ENOMEM;
+            goto done;
+        }
+    }
+
+    *_rules = talloc_steal(mem_ctx, rules);
+    *_num_rules = count;
+
+    ret = EOK;
+
+done:
+    talloc_free(tmp_ctx);
+    return ret;
+}
+
+errno_t sudosrv_index_expired(TALLOC_CTX *mem_ctx,
+                              struct sudosrv_index *index,
+                              uid_t uid,
+                              const char *username,
+                              char **groups,
+                              time_t now,
+                              struct sysdb_attrs ***_rules,
+                              uint32_t *_num_rules)
+{
+    TALLOC_CTX *tmp_ctx;
+    struct sudosrv_index_match *matches;
+    struct sudosrv_index_rule *rule;
+    struct sysdb_attrs **rules;
+    hash_key_t key;
+    hash_value_t value;
+    uint32_t num_rules = 0;
+    size_t count;
+    size_t i;
+    errno_t ret;
+
+    tmp_ctx = talloc_new(NULL);
+    if (tmp_ctx == NULL) {
+        return ENOMEM;
+    }
+
+    ret = sudosrv_index_matches(tmp_ctx, index, uid, username, groups,
+                                &matches, &count);
+    if (ret != EOK) {
+        goto done;
+    }
+
+    rules = talloc_zero_array(tmp_ctx, struct sysdb_attrs *, count + 1);
+    if (rules == NULL) {
+        ret = ENOMEM;
+        goto done;
+    }
+
+    /* The defaults are refreshed together with the user's rules */
+    key.type = HASH_KEY_STRING;
+    key.str = discard_const("defaults");
+    if (hash_lookup(index->data->rules, &key, &value) == HASH_SUCCESS) {
+        rule = talloc_get_type(value.ptr, struct sudosrv_index_rule);
+        if (rule->expire <= now) {
+            rules[num_rules] = sysdb_new_attrs(rules);
+            if (rules[num_rules] == NULL) {
+                ret = ENOMEM;
+                goto done;
+            }
+
+            ret = sysdb_attrs_add_string(rules[num_rules], SYSDB_NAME,
+                                         rule->name);
+            if (ret != EOK) {
+                goto done;
+            }
+            num_rules++;
+        }
+    }
+
+    for (i = 0; i < count; i++) {
+        rule = matches[i].rule;
+        if (rule->expire > now || strcmp(rule->name, "defaults") == 0) {
+            continue;
+        }
+
+        rules[num_rules] = sysdb_new_attrs(rules);
+        if (rules[num_rules] == NULL) {
+            ret = ENOMEM;
+            goto done;
+        }
+
+        ret = sysdb_attrs_add_string(rules[num_rules], SYSDB_NAME, rule->name);
+        if (ret != EOK) {
+            goto done;
+        }
+        num_rules++;
+    }
+
+    *_rules = num_rules > 0 ? talloc_steal(mem_ctx, rules) : NULL;
+    *_num_rules = num_rules;
+
+    ret = EOK;
+
+done:
+    talloc_free(tmp_ctx);
+    return ret;
+}
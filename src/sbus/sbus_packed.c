@@ -0,0 +1,1175 @@
+/*
+    SSSD
+
+    Packed binary transport between responders and data provider
+
+    Copyright (C) 2016 Red Hat
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "config.h"
+
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <string.h>
+#include <talloc.h>
+#include <tevent.h>
+
+#include "util/util.h"
+#include "util/dlinklist.h"
+#include "util/sss_trace.h"
+#include "sbus/sbus_packed.h"
+
+#define SBUS_PACKED_BUF_MIN_SIZE 128
+
+/* ==Body=buffer========================================================== */
+
+struct sbus_packed_buf {
+    uint8_t *data;
+    size_t size;
+    size_t capacity;
+    size_t pos;
+};
+
+struct sbus_packed_buf *sbus_packed_buf_new(TALLOC_CTX *mem_ctx)
+{
+    return talloc_zero(mem_ctx, struct sbus_packed_buf);
+}
+
+struct sbus_packed_buf *sbus_packed_buf_wrap(TALLOC_CTX *mem_ctx,
+                                             uint8_t *data,
+                                             size_t size)
+{
+    struct sbus_packed_buf *buf;
+
+    buf = talloc_zero(mem_ctx, struct sbus_packed_buf);
+    if (buf == NULL) {
+        return NULL;
+    }
+
+    buf->data = talloc_steal(buf, data);
+    buf->size = size;
+    buf->capacity = size;
+
+    return buf;
+}
+
+uint8_t *sbus_packed_buf_data(struct sbus_packed_buf *buf)
+{
+    return buf->data;
+}
+
+size_t sbus_packed_buf_size(struct sbus_packed_buf *buf)
+{
+    return buf->size;
+}
+
+static errno_t sbus_packed_buf_ensure(struct sbus_packed_buf *buf,
+                                      size_t len)
+{
+    uint8_t *data;
+    size_t capacity;
+
+    if (SIZE_T_OVERFLOW(buf->size, len)) {
+        return EOVERFLOW;
+    }
+
+    if (buf->size + len <= buf->capacity) {
+        return EOK;
+    }
+
+    if (buf->size + len > SBUS_PACKED_MAX_BODY) {
+        DEBUG(SSSDBG_CRIT_FAILURE, "Message body is too large\n");
+        return EMSGSIZE;
+    }
+
+    capacity = buf->capacity == 0 ? SBUS_PACKED_BUF_MIN_SIZE
+                                  : buf->capacity * 2;
+    while (capacity < buf->size + len) {
+        capacity *= 2;
+    }
+
+    data = talloc_realloc(buf, buf->data, uint8_t, capacity);
+    if (data == NULL) {
+        return ENOMEM;
+    }
+
+    buf->data = data;
+    buf->capacity = capacity;
+
+    return EOK;
+}
+
+static errno_t sbus_packed_put(struct sbus_packed_buf *buf,
+                               const void *value,
+                               size_t len)
+{
+    errno_t ret;
+
+    ret = sbus_packed_buf_ensure(buf, len);
+    if (ret != EOK) {
+        return ret;
+    }
+
+    if (len > 0) {
+        safealign_memcpy(buf->data + buf->size, value, len, &buf->size);
+    }
+
+    return EOK;
+}
+
+static errno_t sbus_packed_get(struct sbus_packed_buf *buf,
+                               void *_value,
+                               size_t len)
+{
+    if (SIZE_T_OVERFLOW(buf->pos, len) || buf->pos + len > buf->size) {
+        return EBADMSG;
+    }
+
+    safealign_memcpy(_value, buf->data + buf->pos, len, &buf->pos);
+
+    return EOK;
+}
+
+#define SBUS_PACKED_BASIC_TYPE(name, type)                                   \
+errno_t sbus_packed_put_##name(struct sbus_packed_buf *buf, type value)      \
+{                                                                            \
+    return sbus_packed_put(buf, &value, sizeof(type));                       \
+}                                                                            \
+                                                                             \
+errno_t sbus_packed_get_##name(struct sbus_packed_buf *buf, type *_value)    \
+{                                                                            \
+    return sbus_packed_get(buf, _value, sizeof(type));                       \
+}
+
+SBUS_PACKED_BASIC_TYPE(uint8, uint8_t)
+SBUS_PACKED_BASIC_TYPE(int16, int16_t)
+SBUS_PACKED_BASIC_TYPE(uint16, uint16_t)
+SBUS_PACKED_BASIC_TYPE(int32, int32_t)
+SBUS_PACKED_BASIC_TYPE(uint32, uint32_t)
+SBUS_PACKED_BASIC_TYPE(int64, int64_t)
+SBUS_PACKED_BASIC_TYPE(uint64, uint64_t)
+SBUS_PACKED_BASIC_TYPE(double, double)
+
+errno_t sbus_packed_put_bool(struct sbus_packed_buf *buf, bool value)
+{
+    return sbus_packed_put_uint8(buf, value ? 1 : 0);
+}
+
+errno_t sbus_packed_get_bool(struct sbus_packed_buf *buf, bool *_value)
+{
+    uint8_t value;
+    errno_t ret;
+
+    ret = sbus_packed_get_uint8(buf, &value);
+    if (ret != EOK) {
+        return ret;
+    }
+
+    *_value = value != 0;
+    return EOK;
+}
+
+errno_t sbus_packed_put_blob(struct sbus_packed_buf *buf,
+                             const uint8_t *value,
+                             uint32_t len)
+{
+    errno_t ret;
+
+    ret = sbus_packed_put_uint32(buf, len);
+    if (ret != EOK) {
+        return ret;
+    }
+
+    return sbus_packed_put(buf, value, len);
+}
+
+errno_t sbus_packed_get_blob(struct sbus_packed_buf *buf,
+                             const uint8_t **_value,
+                             uint32_t *_len)
+{
+    uint32_t len;
+    errno_t ret;
+
+    ret = sbus_packed_get_uint32(buf, &len);
+    if (ret != EOK) {
+        return ret;
+    }
+
+    if (SIZE_T_OVERFLOW(buf->pos, len) || buf->pos + len > buf->size) {
+        return EBADMSG;
+    }
+
+    *_value = len == 0 ? NULL : buf->data + buf->pos;
+    *_len = len;
+    buf->pos += len;
+
+    return EOK;
+}
+
+errno_t sbus_packed_put_string(struct sbus_packed_buf *buf, const char *value)
+{
+    if (value == NULL) {
+        return sbus_packed_put_uint32(buf, 0);
+    }
+
+    return sbus_packed_put_blob(buf, (const uint8_t *)value,
+                                strlen(value) + 1);
+}
+
+errno_t sbus_packed_get_string(struct sbus_packed_buf *buf,
+                               const char **_value)
+{
+    const uint8_t *value;
+    uint32_t len;
+    errno_t ret;
+
+    ret = sbus_packed_get_blob(buf, &value, &len);
+    if (ret != EOK) {
+        return ret;
+    }
+
+    /* The string must be terminated and must not contain zero bytes. */
+    if (len > 0 && (value[len - 1] != '\0' || strlen((const char *)value)
+                                              != len - 1)) {
+        return EBADMSG;
+    }
+
+    *_value = (const char *)value;
+    return EOK;
+}
+
+/* ==Connection=========================================================== */
+
+struct sbus_packed_outgoing {
+    struct sbus_packed_outgoing *prev;
+    struct sbus_packed_outgoing *next;
+
+    uint8_t *data;
+    size_t size;
+    size_t written;
+};
+
+struct sbus_packed_call_state;
+
+struct sbus_packed_conn {
+    struct tevent_context *ev;
+    struct tevent_fd *fde;
+    int fd;
+
+    /* Set on the server side only. */
+    struct sbus_packed_server *server;
+    void *data;
+
+    uint32_t next_serial;
+    struct sbus_packed_outgoing *outgoing;
+    struct sbus_packed_call_state *calls;
+
+    /* Frame that is being read. */
+    uint8_t header[SBUS_PACKED_HEADER_SIZE];
+    size_t header_read;
+    uint8_t *body;
+    uint32_t body_len;
+    size_t body_read;
+
+    sbus_packed_disconnect_fn disconnect_fn;
+    void *disconnect_pvt;
+};
+
+struct sbus_packed_server {
+    struct tevent_context *ev;
+    struct tevent_fd *fde;
+    int fd;
+    char *address;
+    uid_t uid;
+    gid_t gid;
+
+    const struct sbus_packed_method *methods;
+    sbus_packed_conn_init_fn init_fn;
+    void *init_pvt;
+};
+
+struct sbus_packed_call_state {
+    struct sbus_packed_call_state *prev;
+    struct sbus_packed_call_state *next;
+
+    struct tevent_req *req;
+    struct sbus_packed_conn *conn;
+    struct tevent_timer *timeout;
+    uint32_t serial;
+
+    struct sbus_packed_buf *reply;
+};
+
+static void sbus_packed_fd_handler(struct tevent_context *ev,
+                                   struct tevent_fd *fde,
+                                   uint16_t flags,
+                                   void *pvt);
+
+static void sbus_packed_server_dispatch(struct sbus_packed_conn *conn,
+                                        uint32_t serial,
+                                        uint16_t opcode,
+                                        uint64_t trace_id,
+                                        uint8_t *body,
+                                        uint32_t body_len);
+
+static void sbus_packed_client_dispatch(struct sbus_packed_conn *conn,
+                                        uint32_t serial,
+                                        uint16_t status,
+                                        uint8_t *body,
+                                        uint32_t body_len);
+
+static void sbus_packed_terminate_calls(struct sbus_packed_conn *conn)
+{
+    struct sbus_packed_call_state *call;
+
+    while ((call = conn->calls) != NULL) {
+        DLIST_REMOVE(conn->calls, call);
+        call->conn = NULL;
+        talloc_zfree(call->timeout);
+
+        /* The connection may be in the middle of being freed. */
+        tevent_req_defer_callback(call->req, conn->ev);
+        tevent_req_error(call->req, ERR_OFFLINE);
+    }
+}
+
+static int sbus_packed_conn_destructor(struct sbus_packed_conn *conn)
+{
+    sbus_packed_terminate_calls(conn);
+
+    /* The file descriptor is closed together with fde. */
+    talloc_zfree(conn->fde);
+
+    return 0;
+}
+
+static struct sbus_packed_conn *
+sbus_packed_conn_create(TALLOC_CTX *mem_ctx,
+                        struct tevent_context *ev,
+                        int fd)
+{
+    struct sbus_packed_conn *conn;
+
+    conn = talloc_zero(mem_ctx, struct sbus_packed_conn);
+    if (conn == NULL) {
+        return NULL;
+    }
+
+    conn->ev = ev;
+    conn->fd = fd;
+    conn->next_serial = 1;
+
+    conn->fde = tevent_add_fd(ev, conn, fd, TEVENT_FD_READ,
+                              sbus_packed_fd_handler, conn);
+    if (conn->fde == NULL) {
+        talloc_free(conn);
+        return NULL;
+    }
+    tevent_fd_set_auto_close(conn->fde);
+
+    talloc_set_destructor(conn, sbus_packed_conn_destructor);
+
+    return conn;
+}
+
+void sbus_packed_conn_set_disconnect_fn(struct sbus_packed_conn *conn,
+                                        sbus_packed_disconnect_fn fn,
+                                        void *pvt)
+{
+    conn->disconnect_fn = fn;
+    conn->disconnect_pvt = pvt;
+}
+
+void sbus_packed_conn_set_data(struct sbus_packed_conn *conn, void *data)
+{
+    conn->data = data;
+}
+
+void *sbus_packed_conn_get_data(struct sbus_packed_conn *conn)
+{
+    return conn->data;
+}
+
+static void sbus_packed_disconnect(struct sbus_packed_conn *conn)
+{
+    DEBUG(SSSDBG_TRACE_FUNC, "Packed connection [%p] was closed\n", conn);
+
+    talloc_zfree(conn->fde);
+    sbus_packed_terminate_calls(conn);
+
+    /* This may free the connection. */
+    if (conn->disconnect_fn != NULL) {
+        conn->disconnect_fn(conn, conn->disconnect_pvt);
+    }
+}
+
+static errno_t sbus_packed_write(struct sbus_packed_conn *conn)
+{
+    struct sbus_packed_outgoing *out;
+    ssize_t len;
+    errno_t ret;
+
+    while ((out = conn->outgoing) != NULL) {
+        errno = 0;
+        len = send(conn->fd, out->data + out->written,
+                   out->size - out->written, MSG_NOSIGNAL);
+        if (len == -1) {
+            ret = errno;
+            if (ret == EAGAIN || ret == EWOULDBLOCK || ret == EINTR) {
+                TEVENT_FD_WRITEABLE(conn->fde);
+                return EOK;
+            }
+
+            DEBUG(SSSDBG_OP_FAILURE, "send() failed [%d]: %s\n",
+                  ret, sss_strerror(ret));
+            return ret;
+        }
+
+        out->written += len;
+        if (out->written < out->size) {
+            continue;
+        }
+
+        DLIST_REMOVE(conn->outgoing, out);
+        talloc_free(out);
+    }
+
+    TEVENT_FD_NOT_WRITEABLE(conn->fde);
+    return EOK;
+}
+
+static errno_t sbus_packed_queue_frame(struct sbus_packed_conn *conn,
+                                       uint32_t serial,
+                                       uint16_t opcode,
+                                       uint16_t status,
+                                       uint64_t trace_id,
+                                       struct sbus_packed_buf *body)
+{
+    struct sbus_packed_outgoing *out;
+    uint32_t body_len;
+    size_t c = 0;
+    bool was_empty;
+    errno_t ret;
+
+    if (conn->fde == NULL) {
+        return ERR_OFFLINE;
+    }
+
+    body_len = body == NULL ? 0 : body->size;
+    if (body_len > SBUS_PACKED_MAX_BODY) {
+        return EMSGSIZE;
+    }
+
+    out = talloc_zero(conn, struct sbus_packed_outgoing);
+    if (out == NULL) {
+        return ENOMEM;
+    }
+
+    out->size = SBUS_PACKED_HEADER_SIZE + body_len;
+    out->data = talloc_size(out, out->size);
+    if (out->data == NULL) {
+        talloc_free(out);
+        return ENOMEM;
+    }
+
+    SAFEALIGN_SETMEM_UINT32(out->data, body_len, &c);
+    SAFEALIGN_SETMEM_UINT32(out->data + c, serial, &c);
+    SAFEALIGN_SETMEM_UINT16(out->data + c, opcode, &c);
+    SAFEALIGN_SETMEM_UINT16(out->data + c, status, &c);
+    SAFEALIGN_SETMEM_VALUE(out->data + c, trace_id, uint64_t, &c);
+    if (body_len > 0) {
+        safealign_memcpy(out->data + c, body->data, body_len, &c);
+    }
+
+    was_empty = conn->outgoing == NULL;
+    DLIST_ADD_END(conn->outgoing, out, struct sbus_packed_outgoing *);
+
+    if (!was_empty) {
+        /* Someone else is already waiting for the socket. */
+        return EOK;
+    }
+
+    /* Try to send it right away, we will be woken up if the socket
+     * is full. Errors are handled in the fd handler so the caller does
+     * not get disconnected in the middle of its own processing. */
+    ret = sbus_packed_write(conn);
+    if (ret != EOK) {
+        TEVENT_FD_WRITEABLE(conn->fde);
+    }
+
+    return EOK;
+}
+
+/* Read exactly one frame, return EAGAIN if it is not complete yet. */
+static errno_t sbus_packed_read(struct sbus_packed_conn *conn)
+{
+    ssize_t len;
+    size_t c = 0;
+    errno_t ret;
+
+    if (conn->header_read < SBUS_PACKED_HEADER_SIZE) {
+        errno = 0;
+        len = read(conn->fd, conn->header + conn->header_read,
+                   SBUS_PACKED_HEADER_SIZE - conn->header_read);
+        if (len == -1) {
+            ret = errno;
+            if (ret == EAGAIN || ret == EWOULDBLOCK || ret == EINTR) {
+                return EAGAIN;
+            }
+            return ret;
+        } else if (len == 0) {
+            return ENOTCONN;
+        }
+
+        conn->header_read += len;
+        if (conn->header_read < SBUS_PACKED_HEADER_SIZE) {
+            return EAGAIN;
+        }
+
+        SAFEALIGN_COPY_UINT32(&conn->body_len, conn->header, &c);
+        if (conn->body_len > SBUS_PACKED_MAX_BODY) {
+            DEBUG(SSSDBG_CRIT_FAILURE, "Frame is too large [%"PRIu32"]\n",
+                  conn->body_len);
+            return EBADMSG;
+        }
+
+        conn->body_read = 0;
+        conn->body = talloc_size(conn, conn->body_len == 0 ? 1
+                                                           : conn->body_len);
+        if (conn->body == NULL) {
+            return ENOMEM;
+        }
+    }
+
+    if (conn->body_read < conn->body_len) {
+        errno = 0;
+        len = read(conn->fd, conn->body + conn->body_read,
+                   conn->body_len - conn->body_read);
+        if (len == -1) {
+            ret = errno;
+            if (ret == EAGAIN || ret == EWOULDBLOCK || ret == EINTR) {
+                return EAGAIN;
+            }
+            return ret;
+        } else if (len == 0) {
+            return ENOTCONN;
+        }
+
+        conn->body_read += len;
+        if (conn->body_read < conn->body_len) {
+            return EAGAIN;
+        }
+    }
+
+    return EOK;
+}
+
+static void sbus_packed_fd_handler(struct tevent_context *ev,
+                                   struct tevent_fd *fde,
+                                   uint16_t flags,
+                                   void *pvt)
+{
+    struct sbus_packed_conn *conn;
+    uint32_t serial;
+    uint16_t opcode;
+    uint16_t status;
+    uint64_t trace_id;
+    uint8_t *body;
+    uint32_t body_len;
+    size_t c = sizeof(uint32_t);
+    errno_t ret;
+
+    conn = talloc_get_type(pvt, struct sbus_packed_conn);
+
+    if (flags & TEVENT_FD_WRITE) {
+        ret = sbus_packed_write(conn);
+        if (ret != EOK) {
+            sbus_packed_disconnect(conn);
+            return;
+        }
+    }
+
+    if (!(flags & TEVENT_FD_READ)) {
+        return;
+    }
+
+    ret = sbus_packed_read(conn);
+    if (ret == EAGAIN) {
+        return;
+    } else if (ret != EOK) {
+        if (ret != ENOTCONN) {
+            DEBUG(SSSDBG_OP_FAILURE, "Unable to read frame [%d]: %s\n",
+                  ret, sss_strerror(ret));
+        }
+        sbus_packed_disconnect(conn);
+        return;
+    }
+
+    SAFEALIGN_COPY_UINT32(&serial, conn->header + c, &c);
+    SAFEALIGN_COPY_UINT16(&opcode, conn->header + c, &c);
+    SAFEALIGN_COPY_UINT16(&status, conn->header + c, &c);
+    safealign_memcpy(&trace_id, conn->header + c, sizeof(uint64_t), &c);
+
+    body = conn->body;
+    body_len = conn->body_len;
+    conn->body = NULL;
+    conn->body_len = 0;
+    conn->body_read = 0;
+    conn->header_read = 0;
+
+    /* Only one frame is processed per wake up. The dispatch functions may
+     * free the connection so it must not be touched afterwards. If there
+     * is more data in the socket we will be called again. */
+    if (conn->server != NULL) {
+        sbus_packed_server_dispatch(conn, serial, opcode, trace_id,
+                                    body, body_len);
+    } else {
+        sbus_packed_client_dispatch(conn, serial, status, body, body_len);
+    }
+}
+
+errno_t sbus_packed_connect(TALLOC_CTX *mem_ctx,
+                            struct tevent_context *ev,
+                            const char *address,
+                            struct sbus_packed_conn **_conn)
+{
+    struct sbus_packed_conn *conn;
+    struct sockaddr_un addr;
+    int fd;
+    errno_t ret;
+
+    if (strlen(address) >= sizeof(addr.sun_path)) {
+        DEBUG(SSSDBG_CRIT_FAILURE, "Address is too long [%s]\n", address);
+        return EINVAL;
+    }
+
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strncpy(addr.sun_path, address, sizeof(addr.sun_path) - 1);
+
+    fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd == -1) {
+        ret = errno;
+        DEBUG(SSSDBG_CRIT_FAILURE, "socket() failed [%d]: %s\n",
+              ret, sss_strerror(ret));
+        return ret;
+    }
+
+    /* Connecting to a local socket does not block for a long time. */
+    ret = connect(fd, (struct sockaddr *)&addr, sizeof(addr));
+    if (ret == -1) {
+        ret = errno;
+        DEBUG(SSSDBG_OP_FAILURE, "Unable to connect to [%s] [%d]: %s\n",
+              address, ret, sss_strerror(ret));
+        goto done;
+    }
+
+    ret = sss_fd_nonblocking(fd);
+    if (ret != EOK) {
+        goto done;
+    }
+
+    conn = sbus_packed_conn_create(mem_ctx, ev, fd);
+    if (conn == NULL) {
+        ret = ENOMEM;
+        goto done;
+    }
+
+    DEBUG(SSSDBG_TRACE_FUNC, "Connected to packed server [%s]\n", address);
+
+    *_conn = conn;
+    ret = EOK;
+
+done:
+    if (ret != EOK) {
+        close(fd);
+    }
+
+    return ret;
+}
+
+/* ==Client=calls========================================================= */
+
+static int sbus_packed_call_destructor(struct sbus_packed_call_state *state)
+{
+    if (state->conn != NULL) {
+        DLIST_REMOVE(state->conn->calls, state);
+        state->conn = NULL;
+    }
+
+    return 0;
+}
+
+static void sbus_packed_call_timeout(struct tevent_context *ev,
+                                     struct tevent_timer *te,
+                                     struct timeval tv,
+                                     void *pvt)
+{
+    struct sbus_packed_call_state *state;
+
+    state = talloc_get_type(pvt, struct sbus_packed_call_state);
+
+    DEBUG(SSSDBG_MINOR_FAILURE, "Packed call [%"PRIu32"] timed out\n",
+          state->serial);
+
+    state->timeout = NULL;
+    if (state->conn != NULL) {
+        DLIST_REMOVE(state->conn->calls, state);
+        state->conn = NULL;
+    }
+
+    tevent_req_error(state->req, ETIMEDOUT);
+}
+
+struct tevent_req *sbus_packed_call_send(TALLOC_CTX *mem_ctx,
+                                         struct sbus_packed_conn *conn,
+                                         uint16_t opcode,
+                                         struct sbus_packed_buf *body,
+                                         int timeout)
+{
+    struct sbus_packed_call_state *state;
+    struct tevent_req *req;
+    struct timeval tv;
+    errno_t ret;
+
+    req = tevent_req_create(mem_ctx, &state, struct sbus_packed_call_state);
+    if (req == NULL) {
+        DEBUG(SSSDBG_CRIT_FAILURE, "tevent_req_create() failed\n");
+        return NULL;
+    }
+
+    state->req = req;
+    state->serial = conn->next_serial++;
+    if (conn->next_serial == 0) {
+        conn->next_serial = 1;
+    }
+
+    ret = sbus_packed_queue_frame(conn, state->serial, opcode,
+                                  SBUS_PACKED_STATUS_OK,
+                                  sss_trace_current(), body);
+    if (ret != EOK) {
+        goto immediately;
+    }
+
+    tv = tevent_timeval_current_ofs(timeout / 1000, (timeout % 1000) * 1000);
+    state->timeout = tevent_add_timer(conn->ev, state, tv,
+                                      sbus_packed_call_timeout, state);
+    if (state->timeout == NULL) {
+        ret = ENOMEM;
+        goto immediately;
+    }
+
+    state->conn = conn;
+    DLIST_ADD(conn->calls, state);
+    talloc_set_destructor(state, sbus_packed_call_destructor);
+
+    return req;
+
+immediately:
+    tevent_req_error(req, ret);
+    tevent_req_post(req, conn->ev);
+
+    return req;
+}
+
+static void sbus_packed_client_dispatch(struct sbus_packed_conn *conn,
+                                        uint32_t serial,
+                                        uint16_t status,
+                                        uint8_t *body,
+                                        uint32_t body_len)
+{
+    struct sbus_packed_call_state *state;
+    struct sbus_packed_buf *buf;
+    uint32_t error;
+    errno_t ret;
+
+    for (state = conn->calls; state != NULL; state = state->next) {
+        if (state->serial == serial) {
+            break;
+        }
+    }
+
+    if (state == NULL) {
+        /* The call has timed out or was cancelled. */
+        DEBUG(SSSDBG_TRACE_ALL, "No call waits for reply [%"PRIu32"]\n",
+              serial);
+        talloc_free(body);
+        return;
+    }
+
+    DLIST_REMOVE(conn->calls, state);
+    state->conn = NULL;
+    talloc_zfree(state->timeout);
+
+    buf = sbus_packed_buf_wrap(state, body, body_len);
+    if (buf == NULL) {
+        talloc_free(body);
+        tevent_req_error(state->req, ENOMEM);
+        return;
+    }
+
+    switch (status) {
+    case SBUS_PACKED_STATUS_OK:
+        state->reply = buf;
+        tevent_req_done(state->req);
+        return;
+    case SBUS_PACKED_STATUS_ERROR:
+        ret = sbus_packed_get_uint32(buf, &error);
+        if (ret != EOK || error == EOK) {
+            error = EIO;
+        }
+        break;
+    case SBUS_PACKED_STATUS_NOTSUP:
+        error = ENOTSUP;
+        break;
+    default:
+        DEBUG(SSSDBG_CRIT_FAILURE, "Unknown status [%"PRIu16"]\n", status);
+        error = EIO;
+        break;
+    }
+
+    talloc_free(buf);
+    tevent_req_error(state->req, error);
+}
+
+errno_t sbus_packed_call_recv(TALLOC_CTX *mem_ctx,
+                              struct tevent_req *req,
+                              struct sbus_packed_buf **_reply)
+{
+    struct sbus_packed_call_state *state;
+    state = tevent_req_data(req, struct sbus_packed_call_state);
+
+    TEVENT_REQ_RETURN_ON_ERROR(req);
+
+    *_reply = talloc_steal(mem_ctx, state->reply);
+
+    return EOK;
+}
+
+/* ==Server=============================================================== */
+
+static errno_t sbus_packed_reply(struct sbus_packed_request *req,
+                                 uint16_t status,
+                                 struct sbus_packed_buf *body)
+{
+    errno_t ret;
+
+    ret = sbus_packed_queue_frame(req->conn, req->serial, req->opcode,
+                                  status, req->trace_id, body);
+    if (ret != EOK) {
+        DEBUG(SSSDBG_OP_FAILURE, "Unable to send reply [%d]: %s\n",
+              ret, sss_strerror(ret));
+    }
+
+    talloc_free(req);
+    return ret;
+}
+
+errno_t sbus_packed_request_finish(struct sbus_packed_request *req,
+                                   struct sbus_packed_buf *reply)
+{
+    return sbus_packed_reply(req, SBUS_PACKED_STATUS_OK, reply);
+}
+
+errno_t sbus_packed_request_fail(struct sbus_packed_request *req,
+                                 errno_t error)
+{
+    struct sbus_packed_buf *body;
+    errno_t ret;
+
+    body = sbus_packed_buf_new(req);
+    if (body == NULL) {
+        talloc_free(req);
+        return ENOMEM;
+    }
+
+    ret = sbus_packed_put_uint32(body, error);
+    if (ret != EOK) {
+        talloc_free(req);
+        return ret;
+    }
+
+    return sbus_packed_reply(req, SBUS_PACKED_STATUS_ERROR, body);
+}
+
+static void sbus_packed_server_dispatch(struct sbus_packed_conn *conn,
+                                        uint32_t serial,
+                                        uint16_t opcode,
+                                        uint64_t trace_id,
+                                        uint8_t *body,
+                                        uint32_t body_len)
+{
+    const struct sbus_packed_method *method;
+    struct sbus_packed_request *req;
+    uint64_t prev_trace_id;
+    errno_t ret;
+
+    req = talloc_zero(conn, struct sbus_packed_request);
+    if (req == NULL) {
+        talloc_free(body);
+        return;
+    }
+
+    req->conn = conn;
+    req->serial = serial;
+    req->opcode = opcode;
+    req->trace_id = trace_id;
+    req->body = sbus_packed_buf_wrap(req, body, body_len);
+    if (req->body == NULL) {
+        talloc_free(body);
+        sbus_packed_request_fail(req, ENOMEM);
+        return;
+    }
+
+    for (method = conn->server->methods; method->handler != NULL; method++) {
+        if (method->opcode == opcode) {
+            break;
+        }
+    }
+
+    if (method->handler == NULL) {
+        DEBUG(SSSDBG_MINOR_FAILURE, "Unknown opcode [%"PRIu16"]\n", opcode);
+        sbus_packed_reply(req, SBUS_PACKED_STATUS_NOTSUP, NULL);
+        return;
+    }
+
+    prev_trace_id = sss_trace_set_current(trace_id);
+    ret = method->handler(req, conn->data);
+    sss_trace_set_current(prev_trace_id);
+    if (ret != EOK) {
+        sbus_packed_request_fail(req, ret);
+        return;
+    }
+}
+
+static void sbus_packed_server_disconnect(struct sbus_packed_conn *conn,
+                                          void *pvt)
+{
+    talloc_free(conn);
+}
+
+static bool sbus_packed_check_peer(struct sbus_packed_server *server, int fd)
+{
+#ifdef HAVE_UCRED
+    struct ucred cred;
+    socklen_t len = sizeof(cred);
+    errno_t ret;
+
+    ret = getsockopt(fd, SOL_SOCKET, SO_PEERCRED, &cred, &len);
+    if (ret != 0) {
+        ret = errno;
+        DEBUG(SSSDBG_CRIT_FAILURE, "getsockopt() failed [%d]: %s\n",
+              ret, sss_strerror(ret));
+        return false;
+    }
+
+    if (cred.uid != 0 && cred.uid != server->uid) {
+        DEBUG(SSSDBG_CRIT_FAILURE, "Rejecting connection from uid "
+              "[%"SPRIuid"]\n", cred.uid);
+        return false;
+    }
+#endif
+
+    return true;
+}
+
+static void sbus_packed_accept(struct tevent_context *ev,
+                               struct tevent_fd *fde,
+                               uint16_t flags,
+                               void *pvt)
+{
+    struct sbus_packed_server *server;
+    struct sbus_packed_conn *conn;
+    int fd;
+    errno_t ret;
+
+    server = talloc_get_type(pvt, struct sbus_packed_server);
+
+    fd = accept(server->fd, NULL, NULL);
+    if (fd == -1) {
+        ret = errno;
+        DEBUG(SSSDBG_OP_FAILURE, "accept() failed [%d]: %s\n",
+              ret, sss_strerror(ret));
+        return;
+    }
+
+    if (!sbus_packed_check_peer(server, fd)) {
+        close(fd);
+        return;
+    }
+
+    ret = sss_fd_nonblocking(fd);
+    if (ret != EOK) {
+        close(fd);
+        return;
+    }
+
+    conn = sbus_packed_conn_create(server, server->ev, fd);
+    if (conn == NULL) {
+        close(fd);
+        return;
+    }
+
+    conn->server = server;
+    sbus_packed_conn_set_disconnect_fn(conn, sbus_packed_server_disconnect,
+                                       NULL);
+
+    if (server->init_fn != NULL) {
+        ret = server->init_fn(conn, server->init_pvt);
+        if (ret != EOK) {
+            DEBUG(SSSDBG_OP_FAILURE, "Unable to initialize connection "
+                  "[%d]: %s\n", ret, sss_strerror(ret));
+            talloc_free(conn);
+            return;
+        }
+    }
+
+    DEBUG(SSSDBG_TRACE_FUNC, "New packed connection [%p]\n", conn);
+}
+
+static int sbus_packed_server_destructor(struct sbus_packed_server *server)
+{
+    unlink(server->address);
+    return 0;
+}
+
+errno_t sbus_packed_server_create(TALLOC_CTX *mem_ctx,
+                                  struct tevent_context *ev,
+                                  const char *address,
+                                  uid_t uid,
+                                  gid_t gid,
+                                  const struct sbus_packed_method *methods,
+                                  sbus_packed_conn_init_fn init_fn,
+                                  void *init_pvt,
+                                  struct sbus_packed_server **_server)
+{
+    struct sbus_packed_server *server;
+    struct sockaddr_un addr;
+    int fd = -1;
+    errno_t ret;
+
+    if (strlen(address) >= sizeof(addr.sun_path)) {
+        DEBUG(SSSDBG_CRIT_FAILURE, "Address is too long [%s]\n", address);
+        return EINVAL;
+    }
+
+    server = talloc_zero(mem_ctx, struct sbus_packed_server);
+    if (server == NULL) {
+        return ENOMEM;
+    }
+
+    server->ev = ev;
+    server->uid = uid;
+    server->gid = gid;
+    server->methods = methods;
+    server->init_fn = init_fn;
+    server->init_pvt = init_pvt;
+    server->address = talloc_strdup(server, address);
+    if (server->address == NULL) {
+        ret = ENOMEM;
+        goto done;
+    }
+
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strncpy(addr.sun_path, address, sizeof(addr.sun_path) - 1);
+
+    fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd == -1) {
+        ret = errno;
+        DEBUG(SSSDBG_CRIT_FAILURE, "socket() failed [%d]: %s\n",
+              ret, sss_strerror(ret));
+        goto done;
+    }
+
+    ret = sss_fd_nonblocking(fd);
+    if (ret != EOK) {
+        goto done;
+    }
+
+    /* Remove stale socket left by a previous instance. */
+    errno = 0;
+    ret = unlink(address);
+    if (ret == -1 && errno != ENOENT) {
+        ret = errno;
+        DEBUG(SSSDBG_MINOR_FAILURE, "Unable to remove [%s] [%d]: %s\n",
+              address, ret, sss_strerror(ret));
+    }
+
+    ret = bind(fd, (struct sockaddr *)&addr, sizeof(addr));
+    if (ret == -1) {
+        ret = errno;
+        DEBUG(SSSDBG_CRIT_FAILURE, "Unable to bind [%s] [%d]: %s\n",
+              address, ret, sss_strerror(ret));
+        goto done;
+    }
+
+    talloc_set_destructor(server, sbus_packed_server_destructor);
+
+    ret = chmod(address, 0600);
+    if (ret == -1) {
+        ret = errno;
+        DEBUG(SSSDBG_CRIT_FAILURE, "chmod() failed [%d]: %s\n",
+              ret, sss_strerror(ret));
+        goto done;
+    }
+
+    if (getuid() == 0 && uid != 0) {
+        ret = chown(address, uid, gid);
+        if (ret == -1) {
+            ret = errno;
+            DEBUG(SSSDBG_CRIT_FAILURE, "chown() failed [%d]: %s\n",
+                  ret, sss_strerror(ret));
+            goto done;
+        }
+    }
+
+    ret = listen(fd, SOMAXCONN);
+    if (ret == -1) {
+        ret = errno;
+        DEBUG(SSSDBG_CRIT_FAILURE, "listen() failed [%d]: %s\n",
+              ret, sss_strerror(ret));
+        goto done;
+    }
+
+    server->fde = tevent_add_fd(ev, server, fd, TEVENT_FD_READ,
+                                sbus_packed_accept, server);
+    if (server->fde == NULL) {
+        ret = ENOMEM;
+        goto done;
+    }
+    tevent_fd_set_auto_close(server->fde);
+    server->fd = fd;
+
+    DEBUG(SSSDBG_TRACE_FUNC, "Packed server listening on [%s]\n", address);
+
+    *_server = server;
+    ret = EOK;
+
+done:
+    if (ret != EOK) {
+        if (fd != -1) {
+            close(fd);
+        }
+        talloc_free(server);
+    }
+
+    return ret;
+}
@@ -0,0 +1,192 @@
+/*
+    SSSD
+
+    Packed binary transport between responders and data provider
+
+    Copyright (C) 2016 Red Hat
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef _SBUS_PACKED_H_
+#define _SBUS_PACKED_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <talloc.h>
+#include <tevent.h>
+
+#include "util/util.h"
+
+/*
+ * The packed transport is a lightweight alternative to D-Bus for the hot
+ * methods of the data provider interface. Every message is a frame that
+ * consists of a fixed header followed by the body:
+ *
+ *   uint32_t length   length of the body in bytes
+ *   uint32_t serial   serial number used to match replies with calls
+ *   uint16_t opcode   method identifier, see org.freedesktop.sssd.Packed
+ *   uint16_t status   SBUS_PACKED_STATUS_* of a reply, 0 in a call
+ *   uint64_t trace    request trace identifier, 0 if not traced
+ *
+ * All integers are stored in host byte order since both peers always
+ * run on the same machine. Strings are stored as uint32_t length
+ * (including the terminating zero) followed by the bytes, NULL string
+ * has length 0.
+ */
+
+#define SBUS_PACKED_HEADER_SIZE (2 * sizeof(uint32_t) + 2 * sizeof(uint16_t) \
+                                 + sizeof(uint64_t))
+#define SBUS_PACKED_MAX_BODY (1024 * 1024)
+
+enum sbus_packed_status {
+    SBUS_PACKED_STATUS_OK = 0,
+    /* The body contains uint32_t error code. */
+    SBUS_PACKED_STATUS_ERROR = 1,
+    /* The opcode is not known to the server. */
+    SBUS_PACKED_STATUS_NOTSUP = 2
+};
+
+/* ==Body=buffer========================================================== */
+
+struct sbus_packed_buf;
+
+struct sbus_packed_buf *sbus_packed_buf_new(TALLOC_CTX *mem_ctx);
+
+/* Wrap existing data for reading. The data are stolen onto the buffer. */
+struct sbus_packed_buf *sbus_packed_buf_wrap(TALLOC_CTX *mem_ctx,
+                                             uint8_t *data,
+                                             size_t size);
+
+uint8_t *sbus_packed_buf_data(struct sbus_packed_buf *buf);
+size_t sbus_packed_buf_size(struct sbus_packed_buf *buf);
+
+errno_t sbus_packed_put_uint8(struct sbus_packed_buf *buf, uint8_t value);
+errno_t sbus_packed_put_bool(struct sbus_packed_buf *buf, bool value);
+errno_t sbus_packed_put_int16(struct sbus_packed_buf *buf, int16_t value);
+errno_t sbus_packed_put_uint16(struct sbus_packed_buf *buf, uint16_t value);
+errno_t sbus_packed_put_int32(struct sbus_packed_buf *buf, int32_t value);
+errno_t sbus_packed_put_uint32(struct sbus_packed_buf *buf, uint32_t value);
+errno_t sbus_packed_put_int64(struct sbus_packed_buf *buf, int64_t value);
+errno_t sbus_packed_put_uint64(struct sbus_packed_buf *buf, uint64_t value);
+errno_t sbus_packed_put_double(struct sbus_packed_buf *buf, double value);
+errno_t sbus_packed_put_string(struct sbus_packed_buf *buf, const char *value);
+errno_t sbus_packed_put_blob(struct sbus_packed_buf *buf,
+                             const uint8_t *value,
+                             uint32_t len);
+
+/* Strings and blobs returned by the getters point inside the buffer
+ * and are valid as long as the buffer is. */
+errno_t sbus_packed_get_uint8(struct sbus_packed_buf *buf, uint8_t *_value);
+errno_t sbus_packed_get_bool(struct sbus_packed_buf *buf, bool *_value);
+errno_t sbus_packed_get_int16(struct sbus_packed_buf *buf, int16_t *_value);
+errno_t sbus_packed_get_uint16(struct sbus_packed_buf *buf, uint16_t *_value);
+errno_t sbus_packed_get_int32(struct sbus_packed_buf *buf, int32_t *_value);
+errno_t sbus_packed_get_uint32(struct sbus_packed_buf *buf, uint32_t *_value);
+errno_t sbus_packed_get_int64(struct sbus_packed_buf *buf, int64_t *_value);
+errno_t sbus_packed_get_uint64(struct sbus_packed_buf *buf, uint64_t *_value);
+errno_t sbus_packed_get_double(struct sbus_packed_buf *buf, double *_value);
+errno_t sbus_packed_get_string(struct sbus_packed_buf *buf,
+                               const char **_value);
+errno_t sbus_packed_get_blob(struct sbus_packed_buf *buf,
+                             const uint8_t **_value,
+                             uint32_t *_len);
+
+/* ==Connection=========================================================== */
+
+struct sbus_packed_conn;
+struct sbus_packed_server;
+
+typedef void (*sbus_packed_disconnect_fn)(struct sbus_packed_conn *conn,
+                                          void *pvt);
+
+/* Connect to a packed server listening on @address (a socket path).
+ * The connection is freed when @mem_ctx is freed. */
+errno_t sbus_packed_connect(TALLOC_CTX *mem_ctx,
+                            struct tevent_context *ev,
+                            const char *address,
+                            struct sbus_packed_conn **_conn);
+
+/* Called once when the peer closes the connection or an I/O error occurs.
+ * All pending calls are already terminated with ERR_OFFLINE at this point.
+ * The callback may free the connection. */
+void sbus_packed_conn_set_disconnect_fn(struct sbus_packed_conn *conn,
+                                        sbus_packed_disconnect_fn fn,
+                                        void *pvt);
+
+void sbus_packed_conn_set_data(struct sbus_packed_conn *conn, void *data);
+void *sbus_packed_conn_get_data(struct sbus_packed_conn *conn);
+
+/* Send @body with @opcode and wait for the reply at most @timeout ms. */
+struct tevent_req *sbus_packed_call_send(TALLOC_CTX *mem_ctx,
+                                         struct sbus_packed_conn *conn,
+                                         uint16_t opcode,
+                                         struct sbus_packed_buf *body,
+                                         int timeout);
+
+/* Returns ETIMEDOUT if no reply arrived in time, ERR_OFFLINE if the
+ * connection was lost and the error code sent by the server if the call
+ * failed on the server side. */
+errno_t sbus_packed_call_recv(TALLOC_CTX *mem_ctx,
+                              struct tevent_req *req,
+                              struct sbus_packed_buf **_reply);
+
+/* ==Server=============================================================== */
+
+struct sbus_packed_request {
+    struct sbus_packed_conn *conn;
+    uint32_t serial;
+    uint16_t opcode;
+    uint64_t trace_id;
+    struct sbus_packed_buf *body;
+};
+
+/* A handler must eventually call sbus_packed_request_finish() or
+ * sbus_packed_request_fail() unless it returns an error, in which case
+ * the error is sent to the caller automatically. The request is
+ * allocated on the connection so it is freed if the client disconnects
+ * in the middle of processing. */
+typedef errno_t (*sbus_packed_handler_fn)(struct sbus_packed_request *req,
+                                          void *data);
+
+struct sbus_packed_method {
+    uint16_t opcode;
+    sbus_packed_handler_fn handler;
+};
+
+/* Called for each new connection, may set connection data that is later
+ * passed to the handlers. Returning an error closes the connection. */
+typedef errno_t (*sbus_packed_conn_init_fn)(struct sbus_packed_conn *conn,
+                                            void *pvt);
+
+/* Create a server listening on @address. Only clients running as root
+ * or as @uid are allowed to connect. @methods is terminated by an item
+ * with handler set to NULL and must be valid as long as the server. */
+errno_t sbus_packed_server_create(TALLOC_CTX *mem_ctx,
+                                  struct tevent_context *ev,
+                                  const char *address,
+                                  uid_t uid,
+                                  gid_t gid,
+                                  const struct sbus_packed_method *methods,
+                                  sbus_packed_conn_init_fn init_fn,
+                                  void *init_pvt,
+                                  struct sbus_packed_server **_server);
+
+errno_t sbus_packed_request_finish(struct sbus_packed_request *req,
+                                   struct sbus_packed_buf *reply);
+
+errno_t sbus_packed_request_fail(struct sbus_packed_request *req,
+                                 errno_t error);
+
+#endif /* _SBUS_PACKED_H_ */
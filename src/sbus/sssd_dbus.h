@@ -295,6 +295,9 @@ struct sbus_request {
     struct sbus_interface *intf;
     const struct sbus_method_meta *method;
     const char *path;
+
+    /* ID of the traced request this call belongs to, see util/sss_trace.h */
+    uint64_t trace_id;
 };
 
 /*
@@ -364,6 +367,18 @@ void sbus_request_reply_error(struct sbus_request *sbus_req,
                               const char *fmt,
                               ...) SSS_ATTRIBUTE_PRINTF(3, 4);
 
+/*
+ * Finish @sbus_req with the reply of a method call that was sent with
+ * sbus_conn_send(), i.e. pass the result of a method implemented by
+ * another process to the caller. The reply must have the signature the
+ * caller expects. To be called from the reply handler.
+ *
+ * The @sbus_req and the @pending call are no longer valid after this
+ * function returns.
+ */
+void sbus_request_forward_reply(struct sbus_request *sbus_req,
+                                DBusPendingCall *pending);
+
 /*
  * Construct a new DBusError instance which can be consumed by functions such
  * as @sbus_request_fail_and_finish().
@@ -26,6 +26,7 @@
 #include "sbus/sssd_dbus.h"
 #include "sbus/sssd_dbus_meta.h"
 #include "sbus/sssd_dbus_private.h"
+#include "util/sss_trace.h"
 
 static struct sbus_interface *
 sbus_iface_list_lookup(struct sbus_interface_list *list,
@@ -1080,6 +1081,9 @@ sbus_message_handler(DBusConnection *dbus_conn,
     }
 
     sbus_req->method = method;
+    if (method->traced) {
+        sbus_req->trace_id = sbus_message_get_trace_id(message);
+    }
 
     /* now get the sender ID */
     req = sbus_get_sender_id_send(sbus_req, conn->ev, conn, sender);
@@ -1110,6 +1114,7 @@ sbus_message_handler_got_caller_id(struct tevent_req *req)
     const struct sbus_method_meta *method;
     sbus_msg_handler_fn handler;
     sbus_method_invoker_fn invoker;
+    uint64_t prev_trace_id;
     void *pvt;
     DBusError *error;
     errno_t ret;
@@ -1129,6 +1134,9 @@ sbus_message_handler_got_caller_id(struct tevent_req *req)
     invoker = method->invoker;
     pvt = sbus_req->intf->handler_data;
 
+    /* Requests started by the handler belong to the traced request. */
+    prev_trace_id = sss_trace_set_current(sbus_req->trace_id);
     sbus_request_invoke_or_finish(sbus_req, handler, pvt, invoker);
+    sss_trace_set_current(prev_trace_id);
     return;
 }
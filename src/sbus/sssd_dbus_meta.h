@@ -21,6 +21,7 @@
 #ifndef _SSSD_DBUS_META_H_
 #define _SSSD_DBUS_META_H_
 
+#include <stdbool.h>
 #include <dbus/dbus.h>
 
 /*
@@ -62,6 +63,10 @@ struct sbus_method_meta {
     const struct sbus_arg_meta *out_args;
     size_t vtable_offset;
     sbus_method_invoker_fn invoker;
+
+    /* The caller appends the trace ID of the request (see util/sss_trace.h)
+     * as a trailing uint64 argument after the declared ones. */
+    bool traced;
 };
 
 enum {
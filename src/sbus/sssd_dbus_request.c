@@ -265,6 +265,40 @@ void sbus_request_reply_error(struct sbus_request *sbus_req,
     sbus_request_fail_and_finish(sbus_req, error);
 }
 
+void sbus_request_forward_reply(struct sbus_request *sbus_req,
+                                DBusPendingCall *pending)
+{
+    DBusMessage *reply;
+    dbus_bool_t dbret;
+
+    reply = dbus_pending_call_steal_reply(pending);
+    dbus_pending_call_unref(pending);
+    if (reply == NULL) {
+        DEBUG(SSSDBG_FATAL_FAILURE, "Severe error. A reply callback was "
+              "called but no reply was received and no timeout occurred\n");
+        talloc_free(sbus_req);
+        return;
+    }
+
+    /* Point the reply to the original request. Errors are forwarded
+     * as they are. */
+    dbret = dbus_message_set_destination(reply,
+                               dbus_message_get_sender(sbus_req->message));
+    if (dbret) {
+        dbret = dbus_message_set_reply_serial(reply,
+                               dbus_message_get_serial(sbus_req->message));
+    }
+
+    if (!dbret) {
+        DEBUG(SSSDBG_CRIT_FAILURE, "Unable to forward reply!\n");
+        talloc_free(sbus_req);
+    } else {
+        sbus_request_finish(sbus_req, reply);
+    }
+
+    dbus_message_unref(reply);
+}
+
 struct array_arg {
     char **dbus_array;
 };
@@ -275,3 +275,39 @@ errno_t _sbus_parse_message(DBusMessage *msg,
 
     return ret;
 }
+
+errno_t sbus_message_append_trace_id(DBusMessage *msg, uint64_t trace_id)
+{
+    dbus_bool_t dbret;
+
+    dbret = dbus_message_append_args(msg,
+                                     DBUS_TYPE_UINT64, &trace_id,
+                                     DBUS_TYPE_INVALID);
+    if (!dbret) {
+        return ENOMEM;
+    }
+
+    return EOK;
+}
+
+uint64_t sbus_message_get_trace_id(DBusMessage *msg)
+{
+    DBusMessageIter iter;
+    dbus_uint64_t trace_id;
+
+    if (!dbus_message_iter_init(msg, &iter)) {
+        return 0;
+    }
+
+    while (dbus_message_iter_has_next(&iter)) {
+        dbus_message_iter_next(&iter);
+    }
+
+    if (dbus_message_iter_get_arg_type(&iter) != DBUS_TYPE_UINT64) {
+        return 0;
+    }
+
+    dbus_message_iter_get_basic(&iter, &trace_id);
+
+    return trace_id;
+}
@@ -61,4 +61,12 @@ errno_t _sbus_parse_message(DBusMessage *msg,
 #define sbus_parse_reply(msg, ...) \
     _sbus_parse_message(msg, true, ##__VA_ARGS__, DBUS_TYPE_INVALID)
 
+/* Methods marked as traced in their interface description carry the trace
+ * ID of the request (see util/sss_trace.h) as a trailing uint64 argument.
+ * It must be appended after all declared arguments of the call. */
+errno_t sbus_message_append_trace_id(DBusMessage *msg, uint64_t trace_id);
+
+/* Returns 0 if the last argument of the message is not a trace ID. */
+uint64_t sbus_message_get_trace_id(DBusMessage *msg);
+
 #endif /* SSSD_DBUS_UTILS_H_ */
@@ -163,6 +163,44 @@ static void get_name_by_uid_done(struct tevent_context *ev,
     tevent_req_done(req);
 }
 
+#define MAX_STARTED 3
+
+static uid_t started_uids[MAX_STARTED];
+static int num_started;
+
+static struct tevent_req *
+record_start_send(TALLOC_CTX *mem_ctx,
+                  struct method_data *md,
+                  struct req_data *req_data,
+                  struct dp_req_params *params)
+{
+    struct tevent_req *req;
+    struct test_state *state;
+    struct tevent_timer *tt;
+    struct timeval tv;
+
+    req = tevent_req_create(mem_ctx, &state, struct test_state);
+    if (req == NULL) {
+        DEBUG(SSSDBG_CRIT_FAILURE, "tevent_req_create failed.\n");
+        return NULL;
+    }
+
+    state->uid = req_data->uid;
+
+    if (num_started < MAX_STARTED) {
+        started_uids[num_started] = req_data->uid;
+    }
+    num_started++;
+
+    tv = tevent_timeval_current_ofs(0, 10000);
+    tt = tevent_add_timer(params->ev, req, tv, get_name_by_uid_done, req);
+    if (tt == NULL) {
+        return NULL;
+    }
+
+    return req;
+}
+
 struct recv_data
 {
     const char *name;
@@ -408,6 +446,279 @@ static void test_fast_reply(void **state)
     talloc_free(md);
 }
 
+static void test_scheduler_priority(void **state)
+{
+    errno_t ret;
+    struct test_ctx *test_ctx;
+    struct dp_sched_target *stats;
+    struct tevent_req *req;
+    struct tevent_req *req2;
+    struct tevent_req *req3;
+    struct method_data *md;
+    struct req_data *req_data;
+    struct req_data *req_data2;
+    struct req_data *req_data3;
+    struct recv_data *recv_data;
+
+    test_ctx = talloc_get_type(*state, struct test_ctx);
+
+    md = talloc(test_ctx, struct method_data);
+    assert_non_null(md);
+
+    dp_set_method(test_ctx->dp_methods,
+                  DPM_ACCOUNT_HANDLER,
+                  record_start_send, get_name_by_uid_recv,
+                  md,
+                  struct method_data, struct req_data, struct recv_data);
+
+    stats = &test_ctx->provider->sched.targets[DPT_ID];
+    stats->max_active = 1;
+    num_started = 0;
+
+    req_data = talloc_zero(test_ctx, struct req_data);
+    assert_non_null(req_data);
+    req_data->uid = UID;
+
+    req_data2 = talloc_zero(test_ctx, struct req_data);
+    assert_non_null(req_data2);
+    req_data2->uid = UID_FAIL;
+
+    req_data3 = talloc_zero(test_ctx, struct req_data);
+    assert_non_null(req_data3);
+    req_data3->uid = UID2;
+
+    /* The first request takes the only slot. */
+    req = dp_req_send(test_ctx, test_ctx->provider, NULL, NULL, REQ_NAME,
+                      DPT_ID, DPM_ACCOUNT_HANDLER, DP_BACKGROUND,
+                      req_data, NULL);
+    assert_non_null(req);
+    assert_int_equal(num_started, 1);
+
+    /* Background request is queued first... */
+    req2 = dp_req_send(test_ctx, test_ctx->provider, NULL, NULL, REQ_NAME,
+                       DPT_ID, DPM_ACCOUNT_HANDLER, DP_BACKGROUND,
+                       req_data2, NULL);
+    assert_non_null(req2);
+
+    /* ...but the lookup overtakes it. */
+    req3 = dp_req_send(test_ctx, test_ctx->provider, NULL, NULL, REQ_NAME,
+                       DPT_ID, DPM_ACCOUNT_HANDLER, 0, req_data3, NULL);
+    assert_non_null(req3);
+
+    assert_int_equal(num_started, 1);
+    assert_int_equal(stats->num_active, 1);
+    assert_int_equal(stats->num_queued, 2);
+
+    tevent_loop_wait(test_ctx->tctx->ev);
+
+    assert_int_equal(num_started, 3);
+    assert_int_equal(started_uids[0], UID);
+    assert_int_equal(started_uids[1], UID2);
+    assert_int_equal(started_uids[2], UID_FAIL);
+
+    assert_int_equal(stats->num_active, 0);
+    assert_int_equal(stats->num_queued, 0);
+    assert_int_equal(stats->max_queued, 2);
+    assert_int_equal(stats->num_started, 3);
+    assert_int_equal(stats->num_delayed, 2);
+    assert_true(stats->wait_max > 0);
+
+    ret = dp_req_recv_ptr(test_ctx, req, struct recv_data, &recv_data);
+    assert_int_equal(ret, EOK);
+    assert_string_equal(recv_data->name, NAME);
+    talloc_free(recv_data);
+
+    ret = dp_req_recv_ptr(test_ctx, req2, struct recv_data, &recv_data);
+    assert_int_equal(ret, ENOENT);
+
+    ret = dp_req_recv_ptr(test_ctx, req3, struct recv_data, &recv_data);
+    assert_int_equal(ret, EOK);
+    assert_string_equal(recv_data->name, NAME2);
+    talloc_free(recv_data);
+
+    talloc_free(req_data);
+    talloc_free(req_data2);
+    talloc_free(req_data3);
+    talloc_free(req);
+    talloc_free(req2);
+    talloc_free(req3);
+    talloc_free(md);
+}
+
+static void test_scheduler_terminate_queued(void **state)
+{
+    errno_t ret;
+    struct test_ctx *test_ctx;
+    struct dp_sched_target *stats;
+    struct tevent_req *req;
+    struct tevent_req *req2;
+    struct method_data *md;
+    struct req_data *req_data;
+    struct req_data *req_data2;
+    struct recv_data *recv_data;
+
+    test_ctx = talloc_get_type(*state, struct test_ctx);
+
+    md = talloc(test_ctx, struct method_data);
+    assert_non_null(md);
+
+    dp_set_method(test_ctx->dp_methods,
+                  DPM_ACCOUNT_HANDLER,
+                  record_start_send, get_name_by_uid_recv,
+                  md,
+                  struct method_data, struct req_data, struct recv_data);
+
+    stats = &test_ctx->provider->sched.targets[DPT_ID];
+    stats->max_active = 1;
+    num_started = 0;
+
+    req_data = talloc_zero(test_ctx, struct req_data);
+    assert_non_null(req_data);
+    req_data->uid = UID;
+
+    req_data2 = talloc_zero(test_ctx, struct req_data);
+    assert_non_null(req_data2);
+    req_data2->uid = UID2;
+
+    req = dp_req_send(test_ctx, test_ctx->provider, NULL, NULL, REQ_NAME,
+                      DPT_ID, DPM_ACCOUNT_HANDLER, 0, req_data, NULL);
+    assert_non_null(req);
+
+    req2 = dp_req_send(test_ctx, test_ctx->provider, NULL, NULL, REQ_NAME,
+                       DPT_ID, DPM_ACCOUNT_HANDLER, 0, req_data2, NULL);
+    assert_non_null(req2);
+    assert_int_equal(stats->num_queued, 1);
+
+    dp_terminate_active_requests(test_ctx->provider);
+
+    assert_int_equal(stats->num_active, 0);
+    assert_int_equal(stats->num_queued, 0);
+
+    tevent_loop_wait(test_ctx->tctx->ev);
+
+    /* The queued request was never started. */
+    assert_int_equal(num_started, 1);
+
+    ret = dp_req_recv_ptr(test_ctx, req, struct recv_data, &recv_data);
+    assert_int_equal(ret, ERR_TERMINATED);
+
+    ret = dp_req_recv_ptr(test_ctx, req2, struct recv_data, &recv_data);
+    assert_int_equal(ret, ERR_TERMINATED);
+
+    talloc_free(req_data);
+    talloc_free(req_data2);
+    talloc_free(req);
+    talloc_free(req2);
+    talloc_free(md);
+}
+
+struct background_data {
+    struct dp_sched_item *slot;
+    int started_before;
+    errno_t ret;
+    bool done;
+};
+
+static void background_slot_done(struct tevent_req *req)
+{
+    struct background_data *data;
+
+    data = tevent_req_callback_data(req, struct background_data);
+
+    data->ret = dp_sched_background_recv(data, req, &data->slot);
+    data->started_before = num_started;
+    data->done = true;
+    talloc_free(req);
+}
+
+/* Periodic tasks wait for a slot with background priority. */
+static void test_scheduler_background_task(void **state)
+{
+    errno_t ret;
+    struct test_ctx *test_ctx;
+    struct dp_sched_target *stats;
+    struct background_data *data;
+    struct tevent_req *req;
+    struct tevent_req *req2;
+    struct tevent_req *slot_req;
+    struct method_data *md;
+    struct req_data *req_data;
+    struct req_data *req_data2;
+    struct recv_data *recv_data;
+
+    test_ctx = talloc_get_type(*state, struct test_ctx);
+
+    md = talloc(test_ctx, struct method_data);
+    assert_non_null(md);
+
+    dp_set_method(test_ctx->dp_methods,
+                  DPM_ACCOUNT_HANDLER,
+                  record_start_send, get_name_by_uid_recv,
+                  md,
+                  struct method_data, struct req_data, struct recv_data);
+
+    stats = &test_ctx->provider->sched.targets[DPT_ID];
+    stats->max_active = 1;
+    num_started = 0;
+
+    data = talloc_zero(test_ctx, struct background_data);
+    assert_non_null(data);
+
+    req_data = talloc_zero(test_ctx, struct req_data);
+    assert_non_null(req_data);
+    req_data->uid = UID;
+
+    req_data2 = talloc_zero(test_ctx, struct req_data);
+    assert_non_null(req_data2);
+    req_data2->uid = UID2;
+
+    /* The first request takes the only slot. */
+    req = dp_req_send(test_ctx, test_ctx->provider, NULL, NULL, REQ_NAME,
+                      DPT_ID, DPM_ACCOUNT_HANDLER, 0, req_data, NULL);
+    assert_non_null(req);
+
+    /* The periodic task has to wait... */
+    slot_req = dp_sched_background_send(test_ctx, test_ctx->provider, DPT_ID);
+    assert_non_null(slot_req);
+    tevent_req_set_callback(slot_req, background_slot_done, data);
+
+    /* ...and a lookup sent later overtakes it. */
+    req2 = dp_req_send(test_ctx, test_ctx->provider, NULL, NULL, REQ_NAME,
+                       DPT_ID, DPM_ACCOUNT_HANDLER, 0, req_data2, NULL);
+    assert_non_null(req2);
+
+    assert_int_equal(stats->num_active, 1);
+    assert_int_equal(stats->num_queued, 2);
+
+    tevent_loop_wait(test_ctx->tctx->ev);
+
+    assert_true(data->done);
+    assert_int_equal(data->ret, EOK);
+    assert_non_null(data->slot);
+    assert_int_equal(data->started_before, 2);
+
+    /* The task holds the slot until it frees it. */
+    assert_int_equal(stats->num_active, 1);
+    assert_int_equal(stats->num_started, 3);
+    talloc_zfree(data->slot);
+    assert_int_equal(stats->num_active, 0);
+
+    ret = dp_req_recv_ptr(test_ctx, req, struct recv_data, &recv_data);
+    assert_int_equal(ret, EOK);
+    talloc_free(recv_data);
+
+    ret = dp_req_recv_ptr(test_ctx, req2, struct recv_data, &recv_data);
+    assert_int_equal(ret, EOK);
+    talloc_free(recv_data);
+
+    talloc_free(data);
+    talloc_free(req_data);
+    talloc_free(req_data2);
+    talloc_free(req);
+    talloc_free(req2);
+    talloc_free(md);
+}
+
 int main(int argc, const char *argv[])
 {
     poptContext pc;
@@ -435,6 +746,15 @@ int main(int argc, const char *argv[])
         cmocka_unit_test_setup_teardown(test_nonexist_dom,
                                         test_setup,
                                         test_teardown),
+        cmocka_unit_test_setup_teardown(test_scheduler_priority,
+                                        test_setup,
+                                        test_teardown),
+        cmocka_unit_test_setup_teardown(test_scheduler_terminate_queued,
+                                        test_setup,
+                                        test_teardown),
+        cmocka_unit_test_setup_teardown(test_scheduler_background_task,
+                                        test_setup,
+                                        test_teardown),
     };
 
     /* Set debug level to invalid value so we can deside if -d 0 was used. */
@@ -305,6 +305,131 @@ static void test_destructor_req(void **state)
                      talloc_free(req);
 }
 
+/* D-Bus and packed requests with the same key wait for one request. */
+static void test_mixed_transport_req(void **state)
+{
+    errno_t ret;
+    hash_table_t *table;
+    const char *key;
+    struct sbus_request *sbus_req;
+    struct sbus_packed_request *packed_req;
+    struct dp_table_value *tv;
+    struct test_ctx *test_ctx = talloc_get_type(*state, struct test_ctx);
+    struct tevent_req *req;
+
+    req = tevent_req_create(test_ctx, &state, struct test_ctx);
+    assert_non_null(req);
+
+    table = test_ctx->table;
+
+    key = get_req_key(test_ctx);
+
+    sbus_req = talloc(test_ctx, struct sbus_request);
+    assert_non_null(sbus_req);
+
+    packed_req = talloc_zero(test_ctx, struct sbus_packed_request);
+    assert_non_null(packed_req);
+
+    ret = dp_req_table_add(table, key, req, sbus_req);
+    assert_int_equal(ret, EOK);
+
+    ret = dp_req_table_add_packed(table, key, NULL, packed_req);
+    assert_int_equal(ret, EOK);
+
+    tv = dp_req_table_lookup(table, key);
+    assert_non_null(tv);
+    assert_ptr_equal(tv->req, req);
+    assert_ptr_equal(tv->list->packed_req, packed_req);
+    assert_null(tv->list->sbus_req);
+    assert_non_null(tv->list->next);
+    assert_ptr_equal(tv->list->next->sbus_req, sbus_req);
+    assert_null(tv->list->next->packed_req);
+    assert_null(tv->list->next->next);
+
+    /* The item goes away together with the packed request. */
+    talloc_free(packed_req);
+
+    tv = dp_req_table_lookup(table, key);
+    assert_non_null(tv);
+    assert_ptr_equal(tv->list->sbus_req, sbus_req);
+    assert_null(tv->list->next);
+
+    ret = dp_req_table_add_packed(table, key, NULL, NULL);
+    assert_int_equal(ret, EINVAL);
+
+    /* Free memory */
+    dp_req_table_del(table, key);
+    assert_false(dp_req_table_has_key(table, key));
+
+    talloc_free(discard_const(key));
+    talloc_free(tv);
+    talloc_free(sbus_req);
+    talloc_free(req);
+}
+
+/* Internal waiters join a request in flight like D-Bus requests do. */
+static void test_internal_req(void **state)
+{
+    errno_t ret;
+    hash_table_t *table;
+    const char *key;
+    struct sbus_request *sbus_req;
+    struct dp_table_value *tv;
+    struct test_ctx *test_ctx = talloc_get_type(*state, struct test_ctx);
+    struct tevent_req *req;
+    struct tevent_req *internal_req;
+
+    req = tevent_req_create(test_ctx, &state, struct test_ctx);
+    assert_non_null(req);
+
+    internal_req = tevent_req_create(test_ctx, &state, struct test_ctx);
+    assert_non_null(internal_req);
+
+    table = test_ctx->table;
+
+    key = get_req_key(test_ctx);
+
+    sbus_req = talloc(test_ctx, struct sbus_request);
+    assert_non_null(sbus_req);
+
+    ret = dp_req_table_add(table, key, req, sbus_req);
+    assert_int_equal(ret, EOK);
+
+    ret = dp_req_table_add_internal(table, key, NULL, internal_req);
+    assert_int_equal(ret, EOK);
+
+    tv = dp_req_table_lookup(table, key);
+    assert_non_null(tv);
+    assert_ptr_equal(tv->req, req);
+    assert_ptr_equal(tv->list->internal_req, internal_req);
+    assert_null(tv->list->sbus_req);
+    assert_null(tv->list->packed_req);
+    assert_non_null(tv->list->next);
+    assert_ptr_equal(tv->list->next->sbus_req, sbus_req);
+    assert_null(tv->list->next->internal_req);
+    assert_null(tv->list->next->next);
+
+    /* The item goes away together with the internal request. */
+    talloc_free(internal_req);
+
+    tv = dp_req_table_lookup(table, key);
+    assert_non_null(tv);
+    assert_ptr_equal(tv->list->sbus_req, sbus_req);
+    assert_null(tv->list->next);
+
+    ret = dp_req_table_add_internal(table, key, NULL, NULL);
+    assert_int_equal(ret, EINVAL);
+
+    /* Free memory */
+    dp_req_table_del(table, key);
+    assert_false(dp_req_table_has_key(table, key));
+
+    talloc_free(discard_const(key));
+    talloc_free(tv);
+    talloc_free(sbus_req);
+    talloc_free(req);
+}
+
 int main(int argc, const char *argv[])
 {
     poptContext pc;
@@ -331,6 +456,12 @@ int main(int argc, const char *argv[])
         cmocka_unit_test_setup_teardown(test_destructor_req,
                                         test_setup,
                                         test_teardown),
+        cmocka_unit_test_setup_teardown(test_mixed_transport_req,
+                                        test_setup,
+                                        test_teardown),
+        cmocka_unit_test_setup_teardown(test_internal_req,
+                                        test_setup,
+                                        test_teardown),
     };
 
     /* Set debug level to invalid value so we can deside if -d 0 was used. */
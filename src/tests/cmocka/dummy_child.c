@@ -30,6 +30,60 @@
 #include "util/util.h"
 #include "util/child_common.h"
 
+#define DUMMY_CHILD_LARGE_REPLY (2 * SSS_CHILD_POOL_MAX_FRAME + 1)
+
+/* Workers echo the requests or, with TEST_CHILD_ACTION=pid, reply with the
+ * PID of the process that handled them. With TEST_CHILD_ACTION=large the
+ * reply does not fit into a single frame. */
+static errno_t dummy_child_handler(TALLOC_CTX *mem_ctx,
+                                   uint8_t *req_buf, uint32_t req_len,
+                                   uint8_t **_reply, uint32_t *_reply_len,
+                                   void *pvt)
+{
+    const char *action = pvt;
+    uint8_t *large;
+    uint32_t i;
+    char *pid;
+
+    if (action != NULL && strcasecmp(action, "fail") == 0) {
+        return EIO;
+    }
+
+    if (action != NULL && strcasecmp(action, "pid") == 0) {
+        pid = talloc_asprintf(mem_ctx, "%d", getpid());
+        if (pid == NULL) {
+            return ENOMEM;
+        }
+
+        *_reply = (uint8_t *) pid;
+        *_reply_len = strlen(pid) + 1;
+        return EOK;
+    }
+
+    if (action != NULL && strcasecmp(action, "large") == 0) {
+        large = talloc_size(mem_ctx, DUMMY_CHILD_LARGE_REPLY);
+        if (large == NULL) {
+            return ENOMEM;
+        }
+
+        for (i = 0; i < DUMMY_CHILD_LARGE_REPLY; i++) {
+            large[i] = i % 251;
+        }
+
+        *_reply = large;
+        *_reply_len = DUMMY_CHILD_LARGE_REPLY;
+        return EOK;
+    }
+
+    *_reply = talloc_memdup(mem_ctx, req_buf, req_len);
+    if (*_reply == NULL) {
+        return ENOMEM;
+    }
+
+    *_reply_len = req_len;
+    return EOK;
+}
+
 int main(int argc, const char *argv[])
 {
     int opt;
@@ -42,6 +96,7 @@ int main(int argc, const char *argv[])
     const char *action = NULL;
     const char *guitar;
     const char *drums;
+    int worker = 0;
 
     struct poptOption long_options[] = {
         POPT_AUTOHELP
@@ -57,6 +112,8 @@ int main(int argc, const char *argv[])
          _("Send the debug output to stderr directly."), NULL },
         {"guitar", 0, POPT_ARG_STRING, &guitar, 0, _("Who plays guitar"), NULL },
         {"drums", 0, POPT_ARG_STRING, &drums, 0, _("Who plays drums"), NULL },
+        {"worker", 0, POPT_ARG_NONE, &worker, 0,
+         _("Serve framed requests until the input is closed"), NULL },
         POPT_TABLEEND
     };
 
@@ -77,6 +134,12 @@ int main(int argc, const char *argv[])
     poptFreeContext(pc);
 
     action = getenv("TEST_CHILD_ACTION");
+
+    if (worker) {
+        sss_child_worker("dummy_child", STDIN_FILENO, 3, dummy_child_handler,
+                         discard_const(action));
+    }
+
     if (action) {
         if (strcasecmp(action, "check_extra_args") == 0) {
             if (!(strcmp(guitar, "george") == 0 \
@@ -34,6 +34,25 @@
 
 #include "tests/cmocka/common_mock.h"
 
+/* The periodic task is provided by the backend, it is not used here. */
+errno_t be_ptask_create(TALLOC_CTX *mem_ctx,
+                        struct be_ctx *be_ctx,
+                        time_t period,
+                        time_t first_delay,
+                        time_t enabled_delay,
+                        time_t random_offset,
+                        time_t timeout,
+                        enum be_ptask_offline offline,
+                        time_t max_backoff,
+                        be_ptask_send_t send_fn,
+                        be_ptask_recv_t recv_fn,
+                        void *pvt,
+                        const char *name,
+                        struct be_ptask **_task)
+{
+    return EOK;
+}
+
 struct ad_gpo_test_ctx {
     struct ldb_context *ldb_ctx;
 };
@@ -329,6 +348,60 @@ void test_ad_gpo_ace_includes_client_sid_false(void **state)
                                         ace_dom_sid, false);
 }
 
+/*
+ * Test that a change of the applicable GPOs flushes the result cache
+ */
+void test_ad_gpo_result_cache_digest(void **state)
+{
+    errno_t ret;
+    struct ad_gpo_result_cache *cache;
+    struct gp_gpo gpo = { 0 };
+    struct gp_gpo *candidate_gpos[] = { &gpo, NULL };
+    hash_key_t key;
+    hash_value_t val;
+
+    cache = talloc_zero(test_ctx, struct ad_gpo_result_cache);
+    assert_non_null(cache);
+    ret = sss_hash_create(cache, 0, &cache->table);
+    assert_int_equal(ret, EOK);
+
+    gpo.gpo_dn = "cn={31B2F340-016D-11D2-945F-00C04FB984F9},"
+                 "cn=policies,cn=system,DC=sssd,DC=com";
+    gpo.gpo_guid = "{31B2F340-016D-11D2-945F-00C04FB984F9}";
+    gpo.gpo_version = 1;
+    gpo.gpo_sd_digest = 0xdeadbeef;
+
+    ret = ad_gpo_result_cache_check_digest(cache, candidate_gpos, 1);
+    assert_int_equal(ret, EOK);
+    assert_true(cache->digest_valid);
+
+    key.type = HASH_KEY_STRING;
+    key.str = discard_const("host\x1fS-1-5-21-2-3-4-1103");
+    val.type = HASH_VALUE_PTR;
+    val.ptr = NULL;
+    assert_int_equal(hash_enter(cache->table, &key, &val), HASH_SUCCESS);
+
+    /* the same GPOs keep the cached results */
+    ret = ad_gpo_result_cache_check_digest(cache, candidate_gpos, 1);
+    assert_int_equal(ret, EOK);
+    assert_int_equal(hash_count(cache->table), 1);
+
+    /* a new GPO version flushes them */
+    gpo.gpo_version = 2;
+    ret = ad_gpo_result_cache_check_digest(cache, candidate_gpos, 1);
+    assert_int_equal(ret, EOK);
+    assert_int_equal(hash_count(cache->table), 0);
+
+    /* and so does a changed security descriptor */
+    assert_int_equal(hash_enter(cache->table, &key, &val), HASH_SUCCESS);
+    gpo.gpo_sd_digest = 0xcafe;
+    ret = ad_gpo_result_cache_check_digest(cache, candidate_gpos, 1);
+    assert_int_equal(ret, EOK);
+    assert_int_equal(hash_count(cache->table), 0);
+
+    talloc_free(cache);
+}
+
 int main(int argc, const char *argv[])
 {
     poptContext pc;
@@ -364,6 +437,9 @@ int main(int argc, const char *argv[])
         cmocka_unit_test_setup_teardown(test_ad_gpo_ace_includes_client_sid_false,
                                         ad_gpo_test_setup,
                                         ad_gpo_test_teardown),
+        cmocka_unit_test_setup_teardown(test_ad_gpo_result_cache_digest,
+                                        ad_gpo_test_setup,
+                                        ad_gpo_test_teardown),
     };
 
     /* Set debug level to invalid value so we can deside if -d 0 was used. */
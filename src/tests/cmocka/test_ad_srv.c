@@ -0,0 +1,343 @@
+/*
+    Copyright (C) 2016 Red Hat
+
+    SSSD tests - round trip times of AD domain controllers
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <talloc.h>
+#include <tevent.h>
+#include <errno.h>
+#include <popt.h>
+
+/* In order to access the static functions */
+#include "providers/ad/ad_srv.c"
+
+#include "tests/cmocka/common_mock.h"
+
+#define TEST_DOMAIN "ad.test"
+#define TEST_MAX_CONNECTS 10
+
+/* Connections to domain controllers never finish on their own, the test
+ * fails them one by one. */
+struct test_connect_state {
+    int dummy;
+};
+
+static struct tevent_req *test_connects[TEST_MAX_CONNECTS];
+static const char *test_connect_hosts[TEST_MAX_CONNECTS];
+static int test_connect_ports[TEST_MAX_CONNECTS];
+static size_t num_connects;
+
+struct tevent_req *
+__wrap_sdap_connect_host_send(TALLOC_CTX *mem_ctx,
+                              struct tevent_context *ev,
+                              struct sdap_options *opts,
+                              struct resolv_ctx *resolv_ctx,
+                              enum restrict_family family_order,
+                              enum host_database *host_db,
+                              const char *protocol,
+                              const char *host,
+                              int port,
+                              bool use_start_tls)
+{
+    struct test_connect_state *state;
+    struct tevent_req *req;
+
+    assert_true(num_connects < TEST_MAX_CONNECTS);
+
+    req = tevent_req_create(mem_ctx, &state, struct test_connect_state);
+    assert_non_null(req);
+
+    test_connects[num_connects] = req;
+    test_connect_hosts[num_connects] = talloc_strdup(req, host);
+    test_connect_ports[num_connects] = port;
+    num_connects++;
+
+    return req;
+}
+
+errno_t __wrap_sdap_connect_host_recv(TALLOC_CTX *mem_ctx,
+                                      struct tevent_req *req,
+                                      struct sdap_handle **_sh)
+{
+    TEVENT_REQ_RETURN_ON_ERROR(req);
+
+    return EOK;
+}
+
+struct ad_srv_test_ctx {
+    struct tevent_context *ev;
+    struct ad_srv_plugin_ctx *ctx;
+};
+
+static int test_ad_srv_setup(void **state)
+{
+    struct ad_srv_test_ctx *test_ctx;
+
+    assert_true(leak_check_setup());
+
+    test_ctx = talloc_zero(global_talloc_context, struct ad_srv_test_ctx);
+    assert_non_null(test_ctx);
+
+    test_ctx->ev = tevent_context_init(test_ctx);
+    assert_non_null(test_ctx->ev);
+
+    test_ctx->ctx = talloc_zero(test_ctx, struct ad_srv_plugin_ctx);
+    assert_non_null(test_ctx->ctx);
+
+    test_ctx->ctx->be_res = talloc_zero(test_ctx->ctx, struct be_resolv_ctx);
+    assert_non_null(test_ctx->ctx->be_res);
+
+    test_ctx->ctx->ping_count = 2;
+
+    num_connects = 0;
+
+    *state = test_ctx;
+    return 0;
+}
+
+static int test_ad_srv_teardown(void **state)
+{
+    struct ad_srv_test_ctx *test_ctx =
+        talloc_get_type_abort(*state, struct ad_srv_test_ctx);
+
+    talloc_free(test_ctx);
+    assert_true(leak_check_teardown());
+    return 0;
+}
+
+static void test_ad_srv_rtt_update_hosts(void **state)
+{
+    struct ad_srv_test_ctx *test_ctx =
+        talloc_get_type_abort(*state, struct ad_srv_test_ctx);
+    struct ad_srv_plugin_ctx *ctx = test_ctx->ctx;
+    struct fo_server_info first[] = {
+        { discard_const("dc1." TEST_DOMAIN), 389, 0 },
+        { discard_const("dc2." TEST_DOMAIN), 389, 0 },
+    };
+    struct fo_server_info second[] = {
+        { discard_const("dc1." TEST_DOMAIN), 389, 0 },
+        { discard_const("dc3." TEST_DOMAIN), 3268, 0 },
+        { discard_const("DC1." TEST_DOMAIN), 389, 0 },
+    };
+    errno_t ret;
+
+    ret = ad_srv_rtt_update_hosts(ctx, TEST_DOMAIN, first, 2);
+    assert_int_equal(ret, EOK);
+    assert_int_equal(ctx->num_rtts, 2);
+    assert_string_equal(ctx->ping_domain, TEST_DOMAIN);
+
+    /* Unknown hosts are ignored. */
+    ad_srv_rtt_set(ctx, "dc1." TEST_DOMAIN, 100);
+    ad_srv_rtt_set(ctx, "dc2." TEST_DOMAIN, 200);
+    ad_srv_rtt_set(ctx, "dc9." TEST_DOMAIN, 900);
+    assert_int_equal(ad_srv_rtt_get(ctx, "DC1." TEST_DOMAIN), 100);
+    assert_int_equal(ad_srv_rtt_get(ctx, "dc9." TEST_DOMAIN), 0);
+
+    /* Known round trip times are kept, unlisted hosts and duplicates are
+     * dropped. */
+    ret = ad_srv_rtt_update_hosts(ctx, TEST_DOMAIN, second, 3);
+    assert_int_equal(ret, EOK);
+    assert_int_equal(ctx->num_rtts, 2);
+    assert_string_equal(ctx->rtts[0].host, "dc1." TEST_DOMAIN);
+    assert_int_equal(ctx->rtts[0].port, 389);
+    assert_int_equal(ctx->rtts[0].rtt, 100);
+    assert_string_equal(ctx->rtts[1].host, "dc3." TEST_DOMAIN);
+    assert_int_equal(ctx->rtts[1].port, 3268);
+    assert_int_equal(ctx->rtts[1].rtt, 0);
+    assert_int_equal(ad_srv_rtt_get(ctx, "dc2." TEST_DOMAIN), 0);
+}
+
+static void test_ad_srv_rtt_is_slower(void **state)
+{
+    assert_true(ad_srv_rtt_is_slower(200, 100));
+    assert_false(ad_srv_rtt_is_slower(100, 200));
+    assert_false(ad_srv_rtt_is_slower(100, 100));
+
+    /* Unknown round trip times come last. */
+    assert_true(ad_srv_rtt_is_slower(100, 0));
+    assert_false(ad_srv_rtt_is_slower(0, 100));
+    assert_false(ad_srv_rtt_is_slower(0, 0));
+}
+
+static void test_ad_sort_servers_by_rtt(void **state)
+{
+    struct ad_srv_test_ctx *test_ctx =
+        talloc_get_type_abort(*state, struct ad_srv_test_ctx);
+    struct ad_srv_plugin_ctx *ctx = test_ctx->ctx;
+    struct fo_server_info srv[] = {
+        { discard_const("a"), 389, 0 },
+        { discard_const("b"), 389, 0 },
+        { discard_const("c"), 389, 0 },
+        { discard_const("d"), 389, 0 },
+        { discard_const("e"), 389, 0 },
+        { discard_const("f"), 389, 10 },
+        { discard_const("g"), 389, 10 },
+    };
+    const char *expected[] = { "c", "e", "b", "a", "d", "g", "f" };
+    size_t num = sizeof(srv) / sizeof(srv[0]);
+    size_t i;
+    errno_t ret;
+
+    ret = ad_srv_rtt_update_hosts(ctx, TEST_DOMAIN, srv, num);
+    assert_int_equal(ret, EOK);
+
+    ad_srv_rtt_set(ctx, "b", 300);
+    ad_srv_rtt_set(ctx, "c", 100);
+    ad_srv_rtt_set(ctx, "e", 100);
+    ad_srv_rtt_set(ctx, "g", 50);
+
+    /* Servers do not move between priorities, equal and unknown round trip
+     * times keep their order. */
+    ret = ad_sort_servers_by_rtt(ctx, srv, num);
+    assert_int_equal(ret, EOK);
+
+    for (i = 0; i < num; i++) {
+        assert_string_equal(srv[i].host, expected[i]);
+    }
+    assert_int_equal(srv[0].priority, 0);
+    assert_int_equal(srv[4].priority, 0);
+    assert_int_equal(srv[5].priority, 10);
+
+    /* Nothing to sort. */
+    ret = ad_sort_servers_by_rtt(ctx, srv, 1);
+    assert_int_equal(ret, EOK);
+    assert_string_equal(srv[0].host, "c");
+}
+
+/* The refresh pings at most ping_count servers at once and uses the port of
+ * the SRV record. */
+static void test_ad_srv_ping_refresh(void **state)
+{
+    struct ad_srv_test_ctx *test_ctx =
+        talloc_get_type_abort(*state, struct ad_srv_test_ctx);
+    struct ad_srv_plugin_ctx *ctx = test_ctx->ctx;
+    struct fo_server_info srv[] = {
+        { discard_const("dc1." TEST_DOMAIN), 3268, 0 },
+        { discard_const("dc2." TEST_DOMAIN), 389, 0 },
+        { discard_const("dc3." TEST_DOMAIN), 3269, 0 },
+        { discard_const("dc4." TEST_DOMAIN), 636, 0 },
+    };
+    struct tevent_req *req;
+    errno_t ret;
+
+    ret = ad_srv_rtt_update_hosts(ctx, TEST_DOMAIN, srv, 4);
+    assert_int_equal(ret, EOK);
+    ad_srv_rtt_set(ctx, "dc1." TEST_DOMAIN, 500);
+
+    req = ad_srv_ping_refresh_send(test_ctx, test_ctx->ev, NULL, NULL, ctx);
+    assert_non_null(req);
+
+    assert_int_equal(num_connects, 2);
+    assert_string_equal(test_connect_hosts[0], "dc1." TEST_DOMAIN);
+    assert_int_equal(test_connect_ports[0], 3268);
+    assert_string_equal(test_connect_hosts[1], "dc2." TEST_DOMAIN);
+    assert_int_equal(test_connect_ports[1], 389);
+
+    /* The list may change while the refresh is running. */
+    ret = ad_srv_rtt_update_hosts(ctx, TEST_DOMAIN, srv, 2);
+    assert_int_equal(ret, EOK);
+
+    /* A failed ping makes the next server pinged, unreachable servers are
+     * tried last. */
+    tevent_req_error(test_connects[0], ECONNREFUSED);
+    assert_int_equal(num_connects, 3);
+    assert_string_equal(test_connect_hosts[2], "dc3." TEST_DOMAIN);
+    assert_int_equal(test_connect_ports[2], 3269);
+    assert_int_equal(ad_srv_rtt_get(ctx, "dc1." TEST_DOMAIN), 0);
+
+    tevent_req_error(test_connects[1], ECONNREFUSED);
+    assert_int_equal(num_connects, 4);
+    assert_string_equal(test_connect_hosts[3], "dc4." TEST_DOMAIN);
+    assert_int_equal(test_connect_ports[3], 636);
+
+    tevent_req_error(test_connects[2], ECONNREFUSED);
+    assert_true(tevent_req_is_in_progress(req));
+
+    tevent_req_error(test_connects[3], ECONNREFUSED);
+    assert_int_equal(num_connects, 4);
+    assert_false(tevent_req_is_in_progress(req));
+
+    ret = ad_srv_ping_refresh_recv(req);
+    assert_int_equal(ret, EOK);
+    talloc_free(req);
+}
+
+static void test_ad_srv_ping_refresh_empty(void **state)
+{
+    struct ad_srv_test_ctx *test_ctx =
+        talloc_get_type_abort(*state, struct ad_srv_test_ctx);
+    struct tevent_req *req;
+    errno_t ret;
+
+    req = ad_srv_ping_refresh_send(test_ctx, test_ctx->ev, NULL, NULL,
+                                   test_ctx->ctx);
+    assert_non_null(req);
+    assert_int_equal(num_connects, 0);
+
+    assert_true(tevent_req_poll(req, test_ctx->ev));
+    ret = ad_srv_ping_refresh_recv(req);
+    assert_int_equal(ret, EOK);
+    talloc_free(req);
+}
+
+int main(int argc, const char *argv[])
+{
+    int rv;
+    poptContext pc;
+    int opt;
+    struct poptOption long_options[] = {
+        POPT_AUTOHELP
+        SSSD_DEBUG_OPTS
+        POPT_TABLEEND
+    };
+
+    const struct CMUnitTest tests[] = {
+        cmocka_unit_test_setup_teardown(test_ad_srv_rtt_update_hosts,
+                                        test_ad_srv_setup,
+                                        test_ad_srv_teardown),
+        cmocka_unit_test(test_ad_srv_rtt_is_slower),
+        cmocka_unit_test_setup_teardown(test_ad_sort_servers_by_rtt,
+                                        test_ad_srv_setup,
+                                        test_ad_srv_teardown),
+        cmocka_unit_test_setup_teardown(test_ad_srv_ping_refresh,
+                                        test_ad_srv_setup,
+                                        test_ad_srv_teardown),
+        cmocka_unit_test_setup_teardown(test_ad_srv_ping_refresh_empty,
+                                        test_ad_srv_setup,
+                                        test_ad_srv_teardown),
+    };
+
+    /* Set debug level to invalid value so we can deside if -d 0 was used. */
+    debug_level = SSSDBG_INVALID;
+
+    pc = poptGetContext(argv[0], argc, argv, long_options, 0);
+    while ((opt = poptGetNextOpt(pc)) != -1) {
+        switch (opt) {
+        default:
+            fprintf(stderr, "\nInvalid option %s: %s\n\n",
+                    poptBadOption(pc, 0), poptStrerror(opt));
+            poptPrintUsage(pc, stderr, 0);
+            return 1;
+        }
+    }
+    poptFreeContext(pc);
+
+    DEBUG_CLI_INIT(debug_level);
+
+    rv = cmocka_run_group_tests(tests, NULL, NULL);
+    return rv;
+}
@@ -47,6 +47,10 @@ struct test_ctx {
 
     bool add_online_cb_called;
     bool add_offline_cb_called;
+
+    struct tevent_req *slot_req;
+    enum dp_targets slot_target;
+    bool slot_released;
 };
 
 #define mark_online(test_ctx) do { \
@@ -113,6 +117,63 @@ int be_add_offline_cb(TALLOC_CTX *mem_ctx,
     return ERR_OK;
 }
 
+/* The scheduler is mocked too. A slot is granted when the test finishes
+ * the request stored in test_ctx->slot_req. */
+
+struct test_slot {
+    struct test_ctx *test_ctx;
+};
+
+struct test_slot_state {
+    struct test_ctx *test_ctx;
+};
+
+static int test_slot_destructor(struct test_slot *slot)
+{
+    slot->test_ctx->slot_released = true;
+    return 0;
+}
+
+struct tevent_req *dp_sched_background_send(TALLOC_CTX *mem_ctx,
+                                            struct data_provider *provider,
+                                            enum dp_targets target)
+{
+    struct test_slot_state *state = NULL;
+    struct test_ctx *test_ctx = NULL;
+    struct tevent_req *req = NULL;
+
+    test_ctx = sss_mock_ptr_type(struct test_ctx *);
+
+    req = tevent_req_create(mem_ctx, &state, struct test_slot_state);
+    assert_non_null(req);
+
+    state->test_ctx = test_ctx;
+    test_ctx->slot_req = req;
+    test_ctx->slot_target = target;
+
+    return req;
+}
+
+errno_t dp_sched_background_recv(TALLOC_CTX *mem_ctx,
+                                 struct tevent_req *req,
+                                 struct dp_sched_item **_slot)
+{
+    struct test_slot_state *state = NULL;
+    struct test_slot *slot = NULL;
+
+    state = tevent_req_data(req, struct test_slot_state);
+
+    TEVENT_REQ_RETURN_ON_ERROR(req);
+
+    slot = talloc_zero(mem_ctx, struct test_slot);
+    assert_non_null(slot);
+    slot->test_ctx = state->test_ctx;
+    talloc_set_destructor(slot, test_slot_destructor);
+
+    *_slot = (struct dp_sched_item *)slot;
+    return EOK;
+}
+
 struct test_be_ptask_state {
     struct test_ctx *test_ctx;
 };
@@ -963,6 +1024,56 @@ void test_be_ptask_sync_reschedule_backoff(void **state)
     assert_null(ptask);
 }
 
+void test_be_ptask_dp_target(void **state)
+{
+    struct test_ctx *test_ctx = (struct test_ctx *)(*state);
+    struct be_ptask *ptask = NULL;
+    time_t now;
+    errno_t ret;
+
+    /* The mocked scheduler does not touch the provider. */
+    test_ctx->be_ctx->provider = (struct data_provider *)test_ctx;
+    will_return(dp_sched_background_send, test_ctx);
+
+    now = get_current_time();
+    ret = be_ptask_create(test_ctx, test_ctx->be_ctx, PERIOD, 0, 0, 0, 0,
+                          BE_PTASK_OFFLINE_SKIP, 0, test_be_ptask_send,
+                          test_be_ptask_recv, test_ctx, "Test ptask", &ptask);
+    assert_int_equal(ret, ERR_OK);
+    assert_non_null(ptask);
+
+    be_ptask_set_dp_target(ptask, DPT_SUDO);
+
+    while (test_ctx->slot_req == NULL) {
+        tevent_loop_once(test_ctx->be_ctx->ev);
+    }
+
+    /* The task is not executed until it gets a slot. */
+    assert_int_equal(test_ctx->slot_target, DPT_SUDO);
+    assert_int_equal(test_ctx->when, 0);
+    assert_ptr_equal(ptask->req, test_ctx->slot_req);
+
+    tevent_req_done(test_ctx->slot_req);
+    test_ctx->slot_req = NULL;
+
+    while (!test_ctx->done) {
+        tevent_loop_once(test_ctx->be_ctx->ev);
+    }
+
+    assert_true(now <= test_ctx->when);
+    assert_true(ptask->last_execution <= test_ctx->when);
+
+    /* The slot is returned once the task finishes. */
+    assert_true(test_ctx->slot_released);
+    assert_null(ptask->dp_slot);
+    assert_non_null(ptask->timer);
+
+    be_ptask_destroy(&ptask);
+    assert_null(ptask);
+
+    test_ctx->be_ctx->provider = NULL;
+}
+
 int main(int argc, const char *argv[])
 {
     poptContext pc;
@@ -997,7 +1108,8 @@ int main(int argc, const char *argv[])
         new_test(be_ptask_create_sync),
         new_test(be_ptask_sync_reschedule_ok),
         new_test(be_ptask_sync_reschedule_error),
-        new_test(be_ptask_sync_reschedule_backoff)
+        new_test(be_ptask_sync_reschedule_backoff),
+        new_test(be_ptask_dp_target)
     };
 
     /* Set debug level to invalid value so we can deside if -d 0 was used. */
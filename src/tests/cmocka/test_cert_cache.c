@@ -0,0 +1,745 @@
+/*
+    Copyright (C) 2016 Red Hat
+
+    SSSD tests - cache of certificate validation results
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <stdarg.h>
+#include <stdlib.h>
+#include <stddef.h>
+#include <setjmp.h>
+#include <cmocka.h>
+#include <popt.h>
+
+#include "tests/cmocka/common_mock.h"
+#include "responder/common/cert_cache.c"
+
+#define TEST_CACHE_TIMEOUT 300
+
+/* Behaviour of the wrapped validation, set by the tests */
+static errno_t mock_result;
+static time_t mock_valid_until;
+static size_t mock_calls;
+
+errno_t __wrap_cert_to_ssh_key_ex(TALLOC_CTX *mem_ctx, const char *ca_db,
+                                  const uint8_t *der_blob, size_t der_size,
+                                  struct cert_verify_opts *cert_verify_opts,
+                                  uint8_t **key, size_t *key_size,
+                                  time_t *_valid_until)
+{
+    mock_calls++;
+
+    if (mock_result != EOK) {
+        return mock_result;
+    }
+
+    if (key != NULL) {
+        *key = talloc_memdup(mem_ctx, der_blob, der_size);
+        assert_non_null(*key);
+        *key_size = der_size;
+    }
+    *_valid_until = mock_valid_until;
+
+    return EOK;
+}
+
+errno_t __wrap_cert_to_ssh_key(TALLOC_CTX *mem_ctx, const char *ca_db,
+                               const uint8_t *der_blob, size_t der_size,
+                               struct cert_verify_opts *cert_verify_opts,
+                               uint8_t **key, size_t *key_size)
+{
+    time_t valid_until;
+
+    return __wrap_cert_to_ssh_key_ex(mem_ctx, ca_db, der_blob, der_size,
+                                     cert_verify_opts, key, key_size,
+                                     &valid_until);
+}
+
+errno_t __wrap_cert_der_valid_until(const char *ca_db,
+                                    const uint8_t *der_blob, size_t der_size,
+                                    time_t *_valid_until)
+{
+    if (mock_valid_until == 0) {
+        return EINVAL;
+    }
+
+    *_valid_until = mock_valid_until;
+    return EOK;
+}
+
+struct mock_child_verify_state {
+    time_t valid_until;
+};
+
+/* The revalidation in p11_child finishes in the next event loop iteration */
+struct tevent_req *__wrap_sss_cert_child_verify_send(TALLOC_CTX *mem_ctx,
+                                                     struct tevent_context *ev,
+                                                     int child_debug_fd,
+                                                     const char *ca_db,
+                                                     const char *verify_opts,
+                                                     const uint8_t *der_blob,
+                                                     size_t der_size,
+                                                     time_t timeout)
+{
+    struct mock_child_verify_state *state;
+    struct tevent_req *req;
+
+    mock_calls++;
+
+    req = tevent_req_create(mem_ctx, &state, struct mock_child_verify_state);
+    assert_non_null(req);
+
+    if (mock_result != EOK) {
+        tevent_req_error(req, mock_result);
+    } else {
+        state->valid_until = mock_valid_until;
+        tevent_req_done(req);
+    }
+
+    return tevent_req_post(req, ev);
+}
+
+errno_t __wrap_sss_cert_child_verify_recv(struct tevent_req *req,
+                                          time_t *_valid_until)
+{
+    struct mock_child_verify_state *state =
+                        tevent_req_data(req, struct mock_child_verify_state);
+
+    TEVENT_REQ_RETURN_ON_ERROR(req);
+
+    *_valid_until = state->valid_until;
+    return EOK;
+}
+
+struct cert_cache_test_ctx {
+    struct tevent_context *ev;
+    struct sss_cert_cache *cache;
+    uint8_t cert1[4];
+    uint8_t cert2[4];
+};
+
+static struct sss_cert_cache *test_cache_new(struct cert_cache_test_ctx *test_ctx,
+                                             uint32_t cache_timeout,
+                                             bool want_key)
+{
+    struct cert_verify_opts *opts;
+    struct sss_cert_cache *cache;
+    errno_t ret;
+
+    opts = talloc_zero(test_ctx, struct cert_verify_opts);
+    assert_non_null(opts);
+    opts->do_verification = true;
+    opts->cache_timeout = cache_timeout;
+
+    ret = sss_cert_cache_init(test_ctx, test_ctx->ev, "/no/such/db", NULL,
+                              opts, want_key, -1, &cache);
+    assert_int_equal(ret, EOK);
+
+    return cache;
+}
+
+static int test_cert_cache_setup(void **state)
+{
+    struct cert_cache_test_ctx *test_ctx;
+
+    assert_true(leak_check_setup());
+
+    test_ctx = talloc_zero(global_talloc_context, struct cert_cache_test_ctx);
+    assert_non_null(test_ctx);
+
+    test_ctx->ev = tevent_context_init(test_ctx);
+    assert_non_null(test_ctx->ev);
+
+    test_ctx->cache = test_cache_new(test_ctx, TEST_CACHE_TIMEOUT, true);
+
+    memcpy(test_ctx->cert1, "crt1", sizeof(test_ctx->cert1));
+    memcpy(test_ctx->cert2, "crt2", sizeof(test_ctx->cert2));
+
+    mock_result = EOK;
+    mock_valid_until = time(NULL) + 10 * TEST_CACHE_TIMEOUT;
+    mock_calls = 0;
+
+    *state = test_ctx;
+    return 0;
+}
+
+static int test_cert_cache_teardown(void **state)
+{
+    struct cert_cache_test_ctx *test_ctx = talloc_get_type_abort(*state,
+                                               struct cert_cache_test_ctx);
+
+    talloc_free(test_ctx);
+    assert_true(leak_check_teardown());
+    return 0;
+}
+
+static struct sss_cert_cache_entry *
+test_cache_entry(struct sss_cert_cache *cache,
+                 const uint8_t *der_blob, size_t der_size)
+{
+    struct sss_cert_cache_entry *entry;
+    char *digest;
+    hash_key_t key;
+    hash_value_t value;
+    errno_t ret;
+
+    ret = sss_cert_cache_digest(cache, der_blob, der_size, &digest);
+    assert_int_equal(ret, EOK);
+
+    key.type = HASH_KEY_STRING;
+    key.str = digest;
+    if (hash_lookup(cache->table, &key, &value) != HASH_SUCCESS) {
+        entry = NULL;
+    } else {
+        entry = talloc_get_type(value.ptr, struct sss_cert_cache_entry);
+    }
+
+    talloc_free(digest);
+    return entry;
+}
+
+static void test_cache_fire_refresh(struct sss_cert_cache_entry *entry)
+{
+    struct tevent_context *ev = entry->cache->ev;
+    size_t calls = mock_calls;
+    int ret;
+
+    assert_non_null(entry->refresh_te);
+
+    /* The timer is freed by the handler as if it fired */
+    talloc_zfree(entry->refresh_te);
+    sss_cert_cache_refresh(ev, NULL, tevent_timeval_zero(), entry);
+
+    if (mock_calls != calls) {
+        ret = tevent_loop_once(ev);
+        assert_int_equal(ret, 0);
+    }
+}
+
+static void test_cert_cache_hit(void **state)
+{
+    struct cert_cache_test_ctx *test_ctx = talloc_get_type_abort(*state,
+                                               struct cert_cache_test_ctx);
+    uint8_t *key;
+    size_t key_size;
+    errno_t ret;
+
+    ret = sss_cert_cache_validate(test_ctx, test_ctx->cache,
+                                  test_ctx->cert1, sizeof(test_ctx->cert1),
+                                  &key, &key_size);
+    assert_int_equal(ret, EOK);
+    assert_int_equal(mock_calls, 1);
+    assert_int_equal(key_size, sizeof(test_ctx->cert1));
+    assert_memory_equal(key, test_ctx->cert1, key_size);
+    talloc_free(key);
+
+    /* Hits skip the validation and still return the key */
+    ret = sss_cert_cache_validate(test_ctx, test_ctx->cache,
+                                  test_ctx->cert1, sizeof(test_ctx->cert1),
+                                  &key, &key_size);
+    assert_int_equal(ret, EOK);
+    assert_int_equal(mock_calls, 1);
+    assert_int_equal(key_size, sizeof(test_ctx->cert1));
+    assert_memory_equal(key, test_ctx->cert1, key_size);
+    talloc_free(key);
+
+    ret = sss_cert_cache_validate(test_ctx, test_ctx->cache,
+                                  test_ctx->cert1, sizeof(test_ctx->cert1),
+                                  NULL, NULL);
+    assert_int_equal(ret, EOK);
+    assert_int_equal(mock_calls, 1);
+
+    /* Failures are cached as well */
+    mock_result = EACCES;
+    ret = sss_cert_cache_validate(test_ctx, test_ctx->cache,
+                                  test_ctx->cert2, sizeof(test_ctx->cert2),
+                                  NULL, NULL);
+    assert_int_equal(ret, EACCES);
+    assert_int_equal(mock_calls, 2);
+
+    mock_result = EOK;
+    ret = sss_cert_cache_validate(test_ctx, test_ctx->cache,
+                                  test_ctx->cert2, sizeof(test_ctx->cert2),
+                                  NULL, NULL);
+    assert_int_equal(ret, EACCES);
+    assert_int_equal(mock_calls, 2);
+}
+
+static void test_cert_cache_disabled(void **state)
+{
+    struct cert_cache_test_ctx *test_ctx = talloc_get_type_abort(*state,
+                                               struct cert_cache_test_ctx);
+    struct sss_cert_cache *cache;
+    errno_t ret;
+
+    cache = test_cache_new(test_ctx, 0, false);
+
+    ret = sss_cert_cache_validate(test_ctx, cache,
+                                  test_ctx->cert1, sizeof(test_ctx->cert1),
+                                  NULL, NULL);
+    assert_int_equal(ret, EOK);
+    ret = sss_cert_cache_validate(test_ctx, cache,
+                                  test_ctx->cert1, sizeof(test_ctx->cert1),
+                                  NULL, NULL);
+    assert_int_equal(ret, EOK);
+    assert_int_equal(mock_calls, 2);
+
+    ret = sss_cert_cache_add_valid(cache, test_ctx->cert2,
+                                   sizeof(test_ctx->cert2), NULL);
+    assert_int_equal(ret, EOK);
+
+    assert_int_equal(cache->num_entries, 0);
+    assert_null(sss_cert_cache_valid_digests(test_ctx, cache));
+}
+
+static void test_cert_cache_ttl(void **state)
+{
+    struct cert_cache_test_ctx *test_ctx = talloc_get_type_abort(*state,
+                                               struct cert_cache_test_ctx);
+    struct sss_cert_cache_entry *entry;
+    time_t now;
+    errno_t ret;
+
+    /* A later end of validity does not extend the configured timeout */
+    now = time(NULL);
+    ret = sss_cert_cache_validate(test_ctx, test_ctx->cache,
+                                  test_ctx->cert1, sizeof(test_ctx->cert1),
+                                  NULL, NULL);
+    assert_int_equal(ret, EOK);
+    entry = test_cache_entry(test_ctx->cache,
+                             test_ctx->cert1, sizeof(test_ctx->cert1));
+    assert_non_null(entry);
+    assert_true(entry->expire >= now + TEST_CACHE_TIMEOUT);
+    assert_true(entry->expire <= time(NULL) + TEST_CACHE_TIMEOUT);
+
+    /* The certificate or the CRL ends earlier */
+    now = time(NULL);
+    mock_valid_until = now + 30;
+    ret = sss_cert_cache_validate(test_ctx, test_ctx->cache,
+                                  test_ctx->cert2, sizeof(test_ctx->cert2),
+                                  NULL, NULL);
+    assert_int_equal(ret, EOK);
+    entry = test_cache_entry(test_ctx->cache,
+                             test_ctx->cert2, sizeof(test_ctx->cert2));
+    assert_non_null(entry);
+    assert_int_equal(entry->expire, now + 30);
+
+    /* Neither for a certificate that was validated before */
+    talloc_free(entry);
+    now = time(NULL);
+    mock_valid_until = now + 10 * TEST_CACHE_TIMEOUT;
+    ret = sss_cert_cache_validate(test_ctx, test_ctx->cache,
+                                  test_ctx->cert2, sizeof(test_ctx->cert2),
+                                  NULL, NULL);
+    assert_int_equal(ret, EOK);
+    entry = test_cache_entry(test_ctx->cache,
+                             test_ctx->cert2, sizeof(test_ctx->cert2));
+    assert_non_null(entry);
+    assert_true(entry->expire <= time(NULL) + TEST_CACHE_TIMEOUT);
+
+    /* Failures are kept for a short time only */
+    talloc_free(entry);
+    mock_result = EACCES;
+    ret = sss_cert_cache_validate(test_ctx, test_ctx->cache,
+                                  test_ctx->cert2, sizeof(test_ctx->cert2),
+                                  NULL, NULL);
+    assert_int_equal(ret, EACCES);
+    entry = test_cache_entry(test_ctx->cache,
+                             test_ctx->cert2, sizeof(test_ctx->cert2));
+    assert_non_null(entry);
+    assert_true(entry->expire <= time(NULL) + SSS_CERT_CACHE_NEG_TIMEOUT);
+
+    /* Expired results are not used */
+    mock_result = EOK;
+    entry = test_cache_entry(test_ctx->cache,
+                             test_ctx->cert1, sizeof(test_ctx->cert1));
+    entry->expire = time(NULL) - 1;
+    ret = sss_cert_cache_validate(test_ctx, test_ctx->cache,
+                                  test_ctx->cert1, sizeof(test_ctx->cert1),
+                                  NULL, NULL);
+    assert_int_equal(ret, EOK);
+    assert_int_equal(mock_calls, 5);
+
+    /* Without a known end of validity the result is not reused */
+    talloc_free(test_cache_entry(test_ctx->cache, test_ctx->cert2,
+                                 sizeof(test_ctx->cert2)));
+    mock_valid_until = 0;
+    ret = sss_cert_cache_validate(test_ctx, test_ctx->cache,
+                                  test_ctx->cert2, sizeof(test_ctx->cert2),
+                                  NULL, NULL);
+    assert_int_equal(ret, EOK);
+    ret = sss_cert_cache_validate(test_ctx, test_ctx->cache,
+                                  test_ctx->cert2, sizeof(test_ctx->cert2),
+                                  NULL, NULL);
+    assert_int_equal(ret, EOK);
+    assert_int_equal(mock_calls, 7);
+}
+
+static void test_cert_cache_lru(void **state)
+{
+    struct cert_cache_test_ctx *test_ctx = talloc_get_type_abort(*state,
+                                               struct cert_cache_test_ctx);
+    uint32_t c;
+    errno_t ret;
+
+    for (c = 0; c < SSS_CERT_CACHE_MAX_ENTRIES; c++) {
+        ret = sss_cert_cache_validate(test_ctx, test_ctx->cache,
+                                      (uint8_t *) &c, sizeof(c), NULL, NULL);
+        assert_int_equal(ret, EOK);
+    }
+    assert_int_equal(mock_calls, SSS_CERT_CACHE_MAX_ENTRIES);
+    assert_int_equal(test_ctx->cache->num_entries, SSS_CERT_CACHE_MAX_ENTRIES);
+
+    /* Using the oldest entry makes the second one the least recently used */
+    c = 0;
+    ret = sss_cert_cache_validate(test_ctx, test_ctx->cache,
+                                  (uint8_t *) &c, sizeof(c), NULL, NULL);
+    assert_int_equal(ret, EOK);
+    assert_int_equal(mock_calls, SSS_CERT_CACHE_MAX_ENTRIES);
+
+    c = SSS_CERT_CACHE_MAX_ENTRIES;
+    ret = sss_cert_cache_validate(test_ctx, test_ctx->cache,
+                                  (uint8_t *) &c, sizeof(c), NULL, NULL);
+    assert_int_equal(ret, EOK);
+    assert_int_equal(mock_calls, SSS_CERT_CACHE_MAX_ENTRIES + 1);
+    assert_int_equal(test_ctx->cache->num_entries, SSS_CERT_CACHE_MAX_ENTRIES);
+
+    c = 0;
+    assert_non_null(test_cache_entry(test_ctx->cache,
+                                     (uint8_t *) &c, sizeof(c)));
+    c = 1;
+    assert_null(test_cache_entry(test_ctx->cache, (uint8_t *) &c, sizeof(c)));
+    c = 2;
+    assert_non_null(test_cache_entry(test_ctx->cache,
+                                     (uint8_t *) &c, sizeof(c)));
+
+    /* Certificates recorded from elsewhere are bounded the same way */
+    ret = sss_cert_cache_add_valid(test_ctx->cache, test_ctx->cert1,
+                                   sizeof(test_ctx->cert1), NULL);
+    assert_int_equal(ret, EOK);
+    assert_int_equal(test_ctx->cache->num_entries, SSS_CERT_CACHE_MAX_ENTRIES);
+    assert_null(test_cache_entry(test_ctx->cache, (uint8_t *) &c, sizeof(c)));
+}
+
+static void test_cert_cache_refresh(void **state)
+{
+    struct cert_cache_test_ctx *test_ctx = talloc_get_type_abort(*state,
+                                               struct cert_cache_test_ctx);
+    struct sss_cert_cache_entry *entry;
+    time_t now;
+    errno_t ret;
+
+    now = time(NULL);
+    ret = sss_cert_cache_validate(test_ctx, test_ctx->cache,
+                                  test_ctx->cert1, sizeof(test_ctx->cert1),
+                                  NULL, NULL);
+    assert_int_equal(ret, EOK);
+    entry = test_cache_entry(test_ctx->cache,
+                             test_ctx->cert1, sizeof(test_ctx->cert1));
+    assert_non_null(entry);
+
+    /* The revalidation is scheduled before the result expires */
+    assert_non_null(entry->refresh_te);
+    assert_true(entry->expire >= now + TEST_CACHE_TIMEOUT);
+    assert_false(entry->used);
+
+    /* A certificate in use is validated again in p11_child, the new result
+     * is bounded by what p11_child returned and keeps the key */
+    ret = sss_cert_cache_validate(test_ctx, test_ctx->cache,
+                                  test_ctx->cert1, sizeof(test_ctx->cert1),
+                                  NULL, NULL);
+    assert_int_equal(ret, EOK);
+    assert_int_equal(mock_calls, 1);
+    assert_true(entry->used);
+
+    mock_valid_until = time(NULL) + 30;
+    test_cache_fire_refresh(entry);
+    assert_int_equal(mock_calls, 2);
+    entry = test_cache_entry(test_ctx->cache,
+                             test_ctx->cert1, sizeof(test_ctx->cert1));
+    assert_non_null(entry);
+    assert_int_equal(entry->result, EOK);
+    assert_int_equal(entry->expire, mock_valid_until);
+    assert_non_null(entry->key);
+    assert_non_null(entry->refresh_te);
+    assert_null(entry->refresh_req);
+    assert_false(entry->used);
+
+    /* A revalidation that fails drops the result, the next use validates
+     * the certificate again */
+    ret = sss_cert_cache_validate(test_ctx, test_ctx->cache,
+                                  test_ctx->cert1, sizeof(test_ctx->cert1),
+                                  NULL, NULL);
+    assert_int_equal(ret, EOK);
+
+    mock_result = EACCES;
+    test_cache_fire_refresh(entry);
+    assert_int_equal(mock_calls, 3);
+    assert_null(test_cache_entry(test_ctx->cache,
+                                 test_ctx->cert1, sizeof(test_ctx->cert1)));
+
+    ret = sss_cert_cache_validate(test_ctx, test_ctx->cache,
+                                  test_ctx->cert1, sizeof(test_ctx->cert1),
+                                  NULL, NULL);
+    assert_int_equal(ret, EACCES);
+    assert_int_equal(mock_calls, 4);
+
+    /* Failures are dropped instead of being validated again */
+    entry = test_cache_entry(test_ctx->cache,
+                             test_ctx->cert1, sizeof(test_ctx->cert1));
+    assert_non_null(entry);
+    test_cache_fire_refresh(entry);
+    assert_int_equal(mock_calls, 4);
+    assert_null(test_cache_entry(test_ctx->cache,
+                                 test_ctx->cert1, sizeof(test_ctx->cert1)));
+
+    /* So are the certificates nobody asked for since the last validation */
+    mock_result = EOK;
+    ret = sss_cert_cache_validate(test_ctx, test_ctx->cache,
+                                  test_ctx->cert2, sizeof(test_ctx->cert2),
+                                  NULL, NULL);
+    assert_int_equal(ret, EOK);
+    assert_int_equal(mock_calls, 5);
+    entry = test_cache_entry(test_ctx->cache,
+                             test_ctx->cert2, sizeof(test_ctx->cert2));
+    assert_non_null(entry);
+
+    test_cache_fire_refresh(entry);
+    assert_int_equal(mock_calls, 5);
+    assert_null(test_cache_entry(test_ctx->cache,
+                                 test_ctx->cert2, sizeof(test_ctx->cert2)));
+    assert_int_equal(test_ctx->cache->num_entries, 0);
+}
+
+static void test_cert_cache_add_valid(void **state)
+{
+    struct cert_cache_test_ctx *test_ctx = talloc_get_type_abort(*state,
+                                               struct cert_cache_test_ctx);
+    struct sss_cert_cache_entry *entry;
+    struct sss_cert_cache *cache;
+    uint8_t *key;
+    size_t key_size;
+    time_t expire;
+    char *digest;
+    errno_t ret;
+
+    /* The PAM responder does not ask for keys */
+    cache = test_cache_new(test_ctx, TEST_CACHE_TIMEOUT, false);
+
+    ret = sss_cert_cache_add_valid(cache, test_ctx->cert1,
+                                   sizeof(test_ctx->cert1), NULL);
+    assert_int_equal(ret, EOK);
+
+    ret = sss_cert_cache_validate(test_ctx, cache,
+                                  test_ctx->cert1, sizeof(test_ctx->cert1),
+                                  NULL, NULL);
+    assert_int_equal(ret, EOK);
+    assert_int_equal(mock_calls, 0);
+
+    /* p11_child skips the certificates passed with --verified, returning
+     * one of them again must not extend the lifetime of the result */
+    entry = test_cache_entry(cache, test_ctx->cert1, sizeof(test_ctx->cert1));
+    assert_non_null(entry);
+    expire = time(NULL) + 5;
+    entry->expire = expire;
+
+    ret = sss_cert_cache_add_valid(cache, test_ctx->cert1,
+                                   sizeof(test_ctx->cert1), NULL);
+    assert_int_equal(ret, EOK);
+    assert_int_equal(entry->expire, expire);
+
+    /* A result recorded elsewhere has no key, the SSH responder
+     * validates the certificate itself to get one */
+    ret = sss_cert_cache_add_valid(test_ctx->cache, test_ctx->cert1,
+                                   sizeof(test_ctx->cert1), NULL);
+    assert_int_equal(ret, EOK);
+
+    ret = sss_cert_cache_validate(test_ctx, test_ctx->cache,
+                                  test_ctx->cert1, sizeof(test_ctx->cert1),
+                                  NULL, NULL);
+    assert_int_equal(ret, EOK);
+    assert_int_equal(mock_calls, 0);
+
+    ret = sss_cert_cache_validate(test_ctx, test_ctx->cache,
+                                  test_ctx->cert1, sizeof(test_ctx->cert1),
+                                  &key, &key_size);
+    assert_int_equal(ret, EOK);
+    assert_int_equal(mock_calls, 1);
+    assert_int_equal(key_size, sizeof(test_ctx->cert1));
+    talloc_free(key);
+
+    ret = sss_cert_cache_validate(test_ctx, test_ctx->cache,
+                                  test_ctx->cert1, sizeof(test_ctx->cert1),
+                                  &key, &key_size);
+    assert_int_equal(ret, EOK);
+    assert_int_equal(mock_calls, 1);
+    talloc_free(key);
+
+    /* A result that expired while p11_child skipped the certificate is not
+     * renewed, p11_child has to validate it again first */
+    ret = sss_cert_cache_digest(test_ctx, test_ctx->cert1,
+                                sizeof(test_ctx->cert1), &digest);
+    assert_int_equal(ret, EOK);
+    entry = test_cache_entry(cache, test_ctx->cert1, sizeof(test_ctx->cert1));
+    assert_non_null(entry);
+    entry->expire = time(NULL) - 1;
+
+    ret = sss_cert_cache_add_valid(cache, test_ctx->cert1,
+                                   sizeof(test_ctx->cert1), digest);
+    assert_int_equal(ret, EOK);
+    assert_null(test_cache_entry(cache, test_ctx->cert1,
+                                 sizeof(test_ctx->cert1)));
+    talloc_free(digest);
+
+    /* Results from p11_child are bounded by the validity of the certificate
+     * and the CRL */
+    mock_valid_until = time(NULL) + 30;
+    ret = sss_cert_cache_add_valid(cache, test_ctx->cert1,
+                                   sizeof(test_ctx->cert1), NULL);
+    assert_int_equal(ret, EOK);
+    entry = test_cache_entry(cache, test_ctx->cert1, sizeof(test_ctx->cert1));
+    assert_non_null(entry);
+    assert_int_equal(entry->expire, mock_valid_until);
+
+    /* and are not cached at all if it is not known */
+    mock_valid_until = 0;
+    ret = sss_cert_cache_add_valid(cache, test_ctx->cert2,
+                                   sizeof(test_ctx->cert2), NULL);
+    assert_int_equal(ret, EOK);
+    assert_null(test_cache_entry(cache, test_ctx->cert2,
+                                 sizeof(test_ctx->cert2)));
+    assert_int_equal(mock_calls, 1);
+}
+
+static void test_cert_cache_verified_digests(void **state)
+{
+    struct cert_cache_test_ctx *test_ctx = talloc_get_type_abort(*state,
+                                               struct cert_cache_test_ctx);
+    struct sss_cert_cache_entry *entry;
+    uint8_t cert3[] = "crt3";
+    char *digest1;
+    char *digest2;
+    char *digests;
+    errno_t ret;
+
+    /* The digests are passed to p11_child with --verified, which skips
+     * the validation of the listed certificates */
+    assert_null(sss_cert_cache_valid_digests(test_ctx, test_ctx->cache));
+
+    ret = sss_cert_cache_digest(test_ctx, test_ctx->cert1,
+                                sizeof(test_ctx->cert1), &digest1);
+    assert_int_equal(ret, EOK);
+    assert_int_equal(strlen(digest1), SSS_SHA256_LENGTH * 2);
+    ret = sss_cert_cache_digest(test_ctx, test_ctx->cert2,
+                                sizeof(test_ctx->cert2), &digest2);
+    assert_int_equal(ret, EOK);
+
+    ret = sss_cert_cache_add_valid(test_ctx->cache, test_ctx->cert1,
+                                   sizeof(test_ctx->cert1), NULL);
+    assert_int_equal(ret, EOK);
+
+    /* Failed validations must never be listed */
+    mock_result = EACCES;
+    ret = sss_cert_cache_validate(test_ctx, test_ctx->cache,
+                                  test_ctx->cert2, sizeof(test_ctx->cert2),
+                                  NULL, NULL);
+    assert_int_equal(ret, EACCES);
+
+    digests = sss_cert_cache_valid_digests(test_ctx, test_ctx->cache);
+    assert_non_null(digests);
+    assert_string_equal(digests, digest1);
+    talloc_free(digests);
+
+    /* A failed certificate that p11_child validated later becomes valid */
+    ret = sss_cert_cache_add_valid(test_ctx->cache, test_ctx->cert2,
+                                   sizeof(test_ctx->cert2), NULL);
+    assert_int_equal(ret, EOK);
+
+    mock_result = EOK;
+    ret = sss_cert_cache_validate(test_ctx, test_ctx->cache,
+                                  cert3, sizeof(cert3), NULL, NULL);
+    assert_int_equal(ret, EOK);
+
+    /* Expired results must not be listed either */
+    entry = test_cache_entry(test_ctx->cache, cert3, sizeof(cert3));
+    assert_non_null(entry);
+    entry->expire = time(NULL) - 1;
+
+    digests = sss_cert_cache_valid_digests(test_ctx, test_ctx->cache);
+    assert_non_null(digests);
+    assert_string_equal(digests,
+                        talloc_asprintf(digests, "%s,%s", digest2, digest1));
+    talloc_free(digests);
+
+    talloc_free(digest1);
+    talloc_free(digest2);
+}
+
+int main(int argc, const char *argv[])
+{
+    int rv;
+    poptContext pc;
+    int opt;
+    struct poptOption long_options[] = {
+        POPT_AUTOHELP
+        SSSD_DEBUG_OPTS
+        POPT_TABLEEND
+    };
+
+    const struct CMUnitTest tests[] = {
+        cmocka_unit_test_setup_teardown(test_cert_cache_hit,
+                                        test_cert_cache_setup,
+                                        test_cert_cache_teardown),
+        cmocka_unit_test_setup_teardown(test_cert_cache_disabled,
+                                        test_cert_cache_setup,
+                                        test_cert_cache_teardown),
+        cmocka_unit_test_setup_teardown(test_cert_cache_ttl,
+                                        test_cert_cache_setup,
+                                        test_cert_cache_teardown),
+        cmocka_unit_test_setup_teardown(test_cert_cache_lru,
+                                        test_cert_cache_setup,
+                                        test_cert_cache_teardown),
+        cmocka_unit_test_setup_teardown(test_cert_cache_refresh,
+                                        test_cert_cache_setup,
+                                        test_cert_cache_teardown),
+        cmocka_unit_test_setup_teardown(test_cert_cache_add_valid,
+                                        test_cert_cache_setup,
+                                        test_cert_cache_teardown),
+        cmocka_unit_test_setup_teardown(test_cert_cache_verified_digests,
+                                        test_cert_cache_setup,
+                                        test_cert_cache_teardown),
+    };
+
+    /* Set debug level to invalid value so we can deside if -d 0 was used. */
+    debug_level = SSSDBG_INVALID;
+
+    pc = poptGetContext(argv[0], argc, argv, long_options, 0);
+    while ((opt = poptGetNextOpt(pc)) != -1) {
+        switch (opt) {
+        default:
+            fprintf(stderr, "\nInvalid option %s: %s\n\n",
+                    poptBadOption(pc, 0), poptStrerror(opt));
+            poptPrintUsage(pc, stderr, 0);
+            return 1;
+        }
+    }
+    poptFreeContext(pc);
+
+    DEBUG_CLI_INIT(debug_level);
+
+    rv = cmocka_run_group_tests(tests, NULL, NULL);
+    return rv;
+}
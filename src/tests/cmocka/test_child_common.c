@@ -500,6 +500,246 @@ void sss_child_cb(int pid, int wait_status, void *pvt)
     child_ctx->test_ctx->done = true;
 }
 
+/* The pool tests run dummy-child as a worker that echoes the requests */
+struct pool_test_call {
+    struct child_test_ctx *child_tctx;
+    int *pending;
+    errno_t ret;
+    uint8_t *buf;
+    ssize_t len;
+};
+
+static void pool_test_done(struct tevent_req *req)
+{
+    struct pool_test_call *call;
+
+    call = tevent_req_callback_data(req, struct pool_test_call);
+
+    call->ret = sss_child_pool_recv(req, call->child_tctx, &call->buf,
+                                    &call->len);
+    talloc_free(req);
+
+    (*call->pending)--;
+    if (*call->pending == 0) {
+        call->child_tctx->test_ctx->done = true;
+    }
+}
+
+static void pool_test_run(struct child_test_ctx *child_tctx,
+                          struct sss_child_pool *pool,
+                          struct pool_test_call *calls,
+                          int num_calls)
+{
+    struct tevent_req *req;
+    int pending = num_calls;
+    errno_t ret;
+    int i;
+
+    for (i = 0; i < num_calls; i++) {
+        calls[i].child_tctx = child_tctx;
+        calls[i].pending = &pending;
+        calls[i].ret = EINVAL;
+
+        req = sss_child_pool_send(child_tctx, child_tctx->test_ctx->ev, pool,
+                                  discard_const_p(uint8_t, ECHO_STR),
+                                  sizeof(ECHO_STR), 10);
+        assert_non_null(req);
+        tevent_req_set_callback(req, pool_test_done, &calls[i]);
+    }
+
+    child_tctx->test_ctx->done = false;
+    ret = test_ev_loop(child_tctx->test_ctx);
+    assert_int_equal(ret, EOK);
+}
+
+static void pool_test_check_echo(struct pool_test_call *call)
+{
+    assert_int_equal(call->ret, EOK);
+    assert_int_equal(call->len, sizeof(ECHO_STR));
+    assert_string_equal(call->buf, ECHO_STR);
+}
+
+static struct sss_child_pool *pool_test_create_action(
+                                               struct child_test_ctx *tctx,
+                                               const char *action,
+                                               size_t size,
+                                               uint32_t max_jobs,
+                                               size_t max_queued)
+{
+    struct sss_child_pool *pool;
+    errno_t ret;
+
+    ret = setenv("TEST_CHILD_ACTION", action, 1);
+    assert_int_equal(ret, 0);
+
+    ret = sss_child_pool_create(tctx, tctx->test_ctx->ev,
+                                CHILD_DIR"/"TEST_BIN, 2, NULL,
+                                STDIN_FILENO, 3, size, max_jobs, max_queued,
+                                &pool);
+    assert_int_equal(ret, EOK);
+
+    return pool;
+}
+
+static struct sss_child_pool *pool_test_create(struct child_test_ctx *tctx,
+                                               size_t size,
+                                               uint32_t max_jobs,
+                                               size_t max_queued)
+{
+    return pool_test_create_action(tctx, "echo", size, max_jobs, max_queued);
+}
+
+/* Requests are served by the same worker until it is recycled */
+void test_child_pool_echo(void **state)
+{
+    struct child_test_ctx *child_tctx = talloc_get_type(*state,
+                                                        struct child_test_ctx);
+    struct sss_child_pool_stats stats;
+    struct sss_child_pool *pool;
+    struct pool_test_call calls[1];
+    int i;
+
+    pool = pool_test_create(child_tctx, 1, 2, 0);
+
+    for (i = 0; i < 3; i++) {
+        pool_test_run(child_tctx, pool, calls, 1);
+        pool_test_check_echo(&calls[0]);
+    }
+
+    sss_child_pool_get_stats(pool, &stats);
+    assert_int_equal(stats.jobs, 3);
+    assert_int_equal(stats.failures, 0);
+    assert_int_equal(stats.recycled, 1);
+    assert_int_equal(stats.busy, 0);
+
+    talloc_free(pool);
+}
+
+/* Requests that do not find an idle worker wait in the queue */
+void test_child_pool_queue(void **state)
+{
+    struct child_test_ctx *child_tctx = talloc_get_type(*state,
+                                                        struct child_test_ctx);
+    struct sss_child_pool_stats stats;
+    struct sss_child_pool *pool;
+    struct pool_test_call calls[3];
+    int i;
+
+    pool = pool_test_create(child_tctx, 1, 0, 2);
+
+    pool_test_run(child_tctx, pool, calls, 3);
+    for (i = 0; i < 3; i++) {
+        pool_test_check_echo(&calls[i]);
+    }
+
+    sss_child_pool_get_stats(pool, &stats);
+    assert_int_equal(stats.jobs, 3);
+    assert_int_equal(stats.queue_peak, 2);
+    assert_int_equal(stats.queued, 0);
+    assert_int_equal(stats.workers, 1);
+
+    talloc_free(pool);
+}
+
+/* Requests over the queue limit are rejected right away */
+void test_child_pool_reject(void **state)
+{
+    struct child_test_ctx *child_tctx = talloc_get_type(*state,
+                                                        struct child_test_ctx);
+    struct sss_child_pool_stats stats;
+    struct sss_child_pool *pool;
+    struct pool_test_call calls[2];
+
+    pool = pool_test_create(child_tctx, 1, 0, 0);
+
+    pool_test_run(child_tctx, pool, calls, 2);
+    pool_test_check_echo(&calls[0]);
+    assert_int_equal(calls[1].ret, EAGAIN);
+
+    sss_child_pool_get_stats(pool, &stats);
+    assert_int_equal(stats.jobs, 1);
+    assert_int_equal(stats.rejected, 1);
+    assert_true(sss_child_pool_accepts(pool));
+
+    talloc_free(pool);
+}
+
+/* The worker handles the requests itself instead of forking for them */
+void test_child_pool_same_process(void **state)
+{
+    struct child_test_ctx *child_tctx = talloc_get_type(*state,
+                                                        struct child_test_ctx);
+    struct sss_child_pool *pool;
+    struct pool_test_call calls[1];
+    char *first_pid;
+
+    pool = pool_test_create_action(child_tctx, "pid", 1, 0, 0);
+
+    pool_test_run(child_tctx, pool, calls, 1);
+    assert_int_equal(calls[0].ret, EOK);
+    assert_true(calls[0].len > 1);
+    first_pid = talloc_strdup(child_tctx, (char *) calls[0].buf);
+    assert_non_null(first_pid);
+
+    pool_test_run(child_tctx, pool, calls, 1);
+    assert_int_equal(calls[0].ret, EOK);
+    assert_string_equal(calls[0].buf, first_pid);
+
+    talloc_free(first_pid);
+    talloc_free(pool);
+}
+
+/* A worker that failed a request is not used again */
+void test_child_pool_failure(void **state)
+{
+    struct child_test_ctx *child_tctx = talloc_get_type(*state,
+                                                        struct child_test_ctx);
+    struct sss_child_pool_stats stats;
+    struct sss_child_pool *pool;
+    struct pool_test_call calls[1];
+    int i;
+
+    pool = pool_test_create_action(child_tctx, "fail", 1, 0, 0);
+
+    /* The second request must reach a new worker, not the one that
+     * exited after the first failure. */
+    for (i = 0; i < 2; i++) {
+        pool_test_run(child_tctx, pool, calls, 1);
+        assert_int_equal(calls[0].ret, EPIPE);
+    }
+
+    sss_child_pool_get_stats(pool, &stats);
+    assert_int_equal(stats.jobs, 0);
+    assert_int_equal(stats.failures, 2);
+    assert_int_equal(stats.busy, 0);
+
+    talloc_free(pool);
+}
+
+/* Replies larger than a frame are passed in several frames */
+void test_child_pool_large_reply(void **state)
+{
+    struct child_test_ctx *child_tctx = talloc_get_type(*state,
+                                                        struct child_test_ctx);
+    struct sss_child_pool *pool;
+    struct pool_test_call calls[2];
+    ssize_t i;
+
+    pool = pool_test_create_action(child_tctx, "large", 1, 0, 1);
+
+    /* The worker stays usable for the next request */
+    pool_test_run(child_tctx, pool, calls, 2);
+    assert_int_equal(calls[0].ret, EOK);
+    assert_int_equal(calls[0].len, 2 * SSS_CHILD_POOL_MAX_FRAME + 1);
+    for (i = 0; i < calls[0].len; i++) {
+        assert_int_equal(calls[0].buf[i], i % 251);
+    }
+    assert_int_equal(calls[1].ret, EOK);
+    assert_int_equal(calls[1].len, calls[0].len);
+
+    talloc_free(pool);
+}
+
 int main(int argc, const char *argv[])
 {
     int rv;
@@ -530,6 +770,24 @@ int main(int argc, const char *argv[])
         cmocka_unit_test_setup_teardown(test_sss_child,
                                         child_test_setup,
                                         child_test_teardown),
+        cmocka_unit_test_setup_teardown(test_child_pool_echo,
+                                        child_test_setup,
+                                        child_test_teardown),
+        cmocka_unit_test_setup_teardown(test_child_pool_queue,
+                                        child_test_setup,
+                                        child_test_teardown),
+        cmocka_unit_test_setup_teardown(test_child_pool_reject,
+                                        child_test_setup,
+                                        child_test_teardown),
+        cmocka_unit_test_setup_teardown(test_child_pool_same_process,
+                                        child_test_setup,
+                                        child_test_teardown),
+        cmocka_unit_test_setup_teardown(test_child_pool_large_reply,
+                                        child_test_setup,
+                                        child_test_teardown),
+        cmocka_unit_test_setup_teardown(test_child_pool_failure,
+                                        child_test_setup,
+                                        child_test_teardown),
         cmocka_unit_test_setup_teardown(test_exec_child_only_extra_args,
                                         only_extra_args_setup,
                                         only_extra_args_teardown),
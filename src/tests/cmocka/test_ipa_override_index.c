@@ -0,0 +1,299 @@
+/*
+    SSSD
+
+    IPA provider: Tests for the in-memory index of view overrides
+
+    Copyright (C) 2016 Red Hat
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <stdarg.h>
+#include <stddef.h>
+#include <setjmp.h>
+#include <cmocka.h>
+#include <popt.h>
+
+#include "tests/cmocka/common_mock.h"
+#include "providers/ipa/ipa_override_index.h"
+
+#define TEST_VIEW "test_view"
+#define TEST_OTHER_VIEW "other_view"
+
+#define TEST_SID_1 "S-1-5-21-3044487217-4285925784-991641718-1104"
+#define TEST_SID_2 "S-1-5-21-3044487217-4285925784-991641718-1105"
+#define TEST_SID_3 "S-1-5-21-3044487217-4285925784-991641718-1106"
+
+struct override_index_test_ctx {
+    struct ipa_override_index *index;
+};
+
+static struct sysdb_attrs *create_override(TALLOC_CTX *mem_ctx,
+                                           const char *sid,
+                                           const char *shell,
+                                           const char *modstamp)
+{
+    struct sysdb_attrs *attrs;
+    char *anchor;
+    errno_t ret;
+
+    attrs = sysdb_new_attrs(mem_ctx);
+    assert_non_null(attrs);
+
+    anchor = talloc_asprintf(attrs, ":SID:%s", sid);
+    assert_non_null(anchor);
+
+    ret = sysdb_attrs_add_string(attrs, SYSDB_OVERRIDE_ANCHOR_UUID, anchor);
+    assert_int_equal(ret, EOK);
+
+    ret = sysdb_attrs_add_string(attrs, SYSDB_SHELL, shell);
+    assert_int_equal(ret, EOK);
+
+    if (modstamp != NULL) {
+        ret = sysdb_attrs_add_string(attrs, SYSDB_ORIG_MODSTAMP, modstamp);
+        assert_int_equal(ret, EOK);
+    }
+
+    return attrs;
+}
+
+static void assert_override_shell(struct ipa_override_index *index,
+                                  const char *view_name,
+                                  const char *anchor,
+                                  const char *shell)
+{
+    struct sysdb_attrs *attrs;
+    const char *value;
+    errno_t ret;
+
+    ret = ipa_override_index_lookup(global_talloc_context, index, view_name,
+                                    anchor, &attrs);
+    assert_int_equal(ret, EOK);
+
+    ret = sysdb_attrs_get_string(attrs, SYSDB_SHELL, &value);
+    assert_int_equal(ret, EOK);
+    assert_string_equal(value, shell);
+
+    ret = sysdb_attrs_get_string(attrs, SYSDB_ORIG_MODSTAMP, &value);
+    assert_int_equal(ret, ENOENT);
+
+    talloc_free(attrs);
+}
+
+static int test_override_index_setup(void **state)
+{
+    struct override_index_test_ctx *test_ctx;
+    errno_t ret;
+
+    assert_true(leak_check_setup());
+
+    test_ctx = talloc_zero(global_talloc_context,
+                           struct override_index_test_ctx);
+    assert_non_null(test_ctx);
+
+    ret = ipa_override_index_create(test_ctx, &test_ctx->index);
+    assert_int_equal(ret, EOK);
+
+    check_leaks_push(test_ctx);
+
+    *state = test_ctx;
+    return 0;
+}
+
+static int test_override_index_teardown(void **state)
+{
+    struct override_index_test_ctx *test_ctx;
+
+    test_ctx = talloc_get_type_abort(*state, struct override_index_test_ctx);
+
+    ipa_override_index_invalidate(test_ctx->index);
+    assert_true(check_leaks_pop(test_ctx));
+
+    talloc_free(test_ctx);
+    assert_true(leak_check_teardown());
+    return 0;
+}
+
+static void test_override_index_full(void **state)
+{
+    struct override_index_test_ctx *test_ctx;
+    struct sysdb_attrs *overrides[2];
+    struct sysdb_attrs *attrs;
+    errno_t ret;
+
+    test_ctx = talloc_get_type_abort(*state, struct override_index_test_ctx);
+
+    ret = ipa_override_index_lookup(test_ctx, test_ctx->index, TEST_VIEW,
+                                    ":SID:" TEST_SID_1, &attrs);
+    assert_int_equal(ret, EAGAIN);
+
+    overrides[0] = create_override(test_ctx, TEST_SID_1, "/bin/sh",
+                                   "20160101000000Z");
+    overrides[1] = create_override(test_ctx, TEST_SID_2, "/bin/zsh",
+                                   "20160201000000Z");
+
+    ret = ipa_override_index_update(test_ctx->index, TEST_VIEW, true,
+                                    overrides, 2);
+    assert_int_equal(ret, EOK);
+    talloc_free(overrides[0]);
+    talloc_free(overrides[1]);
+
+    assert_true(ipa_override_index_is_loaded(test_ctx->index, TEST_VIEW));
+    assert_false(ipa_override_index_is_loaded(test_ctx->index,
+                                              TEST_OTHER_VIEW));
+    assert_int_equal(test_ctx->index->count, 2);
+    assert_string_equal(test_ctx->index->modstamp, "20160201000000Z");
+
+    assert_override_shell(test_ctx->index, TEST_VIEW,
+                          ":SID:" TEST_SID_1, "/bin/sh");
+    /* anchors are compared case-insensitively */
+    assert_override_shell(test_ctx->index, TEST_VIEW,
+                          ":sid:" TEST_SID_2, "/bin/zsh");
+
+    ret = ipa_override_index_lookup(test_ctx, test_ctx->index, TEST_VIEW,
+                                    ":SID:" TEST_SID_3, &attrs);
+    assert_int_equal(ret, ENOENT);
+
+    ret = ipa_override_index_lookup(test_ctx, test_ctx->index,
+                                    TEST_OTHER_VIEW, ":SID:" TEST_SID_1,
+                                    &attrs);
+    assert_int_equal(ret, EAGAIN);
+}
+
+static void test_override_index_smart(void **state)
+{
+    struct override_index_test_ctx *test_ctx;
+    struct sysdb_attrs *overrides[2];
+    struct sysdb_attrs *attrs;
+    errno_t ret;
+
+    test_ctx = talloc_get_type_abort(*state, struct override_index_test_ctx);
+
+    overrides[0] = create_override(test_ctx, TEST_SID_1, "/bin/sh",
+                                   "20160101000000Z");
+
+    /* a smart refresh needs a loaded index */
+    ret = ipa_override_index_update(test_ctx->index, TEST_VIEW, false,
+                                    overrides, 1);
+    assert_int_equal(ret, EINVAL);
+
+    ret = ipa_override_index_update(test_ctx->index, TEST_VIEW, true,
+                                    overrides, 1);
+    assert_int_equal(ret, EOK);
+    talloc_free(overrides[0]);
+
+    overrides[0] = create_override(test_ctx, TEST_SID_1, "/bin/bash",
+                                   "20160301000000Z");
+    overrides[1] = create_override(test_ctx, TEST_SID_3, "/bin/csh",
+                                   "20160201000000Z");
+
+    ret = ipa_override_index_update(test_ctx->index, TEST_VIEW, false,
+                                    overrides, 2);
+    assert_int_equal(ret, EOK);
+    talloc_free(overrides[0]);
+    talloc_free(overrides[1]);
+
+    assert_int_equal(test_ctx->index->count, 2);
+    assert_string_equal(test_ctx->index->modstamp, "20160301000000Z");
+    assert_override_shell(test_ctx->index, TEST_VIEW,
+                          ":SID:" TEST_SID_1, "/bin/bash");
+    assert_override_shell(test_ctx->index, TEST_VIEW,
+                          ":SID:" TEST_SID_3, "/bin/csh");
+
+    /* a full refresh drops overrides removed on the server */
+    overrides[0] = create_override(test_ctx, TEST_SID_3, "/bin/csh", NULL);
+    ret = ipa_override_index_update(test_ctx->index, TEST_VIEW, true,
+                                    overrides, 1);
+    assert_int_equal(ret, EOK);
+    talloc_free(overrides[0]);
+
+    assert_int_equal(test_ctx->index->count, 1);
+    assert_null(test_ctx->index->modstamp);
+    ret = ipa_override_index_lookup(test_ctx, test_ctx->index, TEST_VIEW,
+                                    ":SID:" TEST_SID_1, &attrs);
+    assert_int_equal(ret, ENOENT);
+}
+
+static void test_override_index_view_change(void **state)
+{
+    struct override_index_test_ctx *test_ctx;
+    struct sysdb_attrs *overrides[1];
+    errno_t ret;
+
+    test_ctx = talloc_get_type_abort(*state, struct override_index_test_ctx);
+
+    overrides[0] = create_override(test_ctx, TEST_SID_1, "/bin/sh",
+                                   "20160101000000Z");
+    ret = ipa_override_index_update(test_ctx->index, TEST_VIEW, true,
+                                    overrides, 1);
+    assert_int_equal(ret, EOK);
+
+    ret = ipa_override_index_update(test_ctx->index, TEST_OTHER_VIEW, false,
+                                    overrides, 1);
+    assert_int_equal(ret, EINVAL);
+
+    ret = ipa_override_index_update(test_ctx->index, TEST_OTHER_VIEW, true,
+                                    overrides, 1);
+    assert_int_equal(ret, EOK);
+    talloc_free(overrides[0]);
+
+    assert_false(ipa_override_index_is_loaded(test_ctx->index, TEST_VIEW));
+    assert_override_shell(test_ctx->index, TEST_OTHER_VIEW,
+                          ":SID:" TEST_SID_1, "/bin/sh");
+}
+
+int main(int argc, const char *argv[])
+{
+    int rv;
+    poptContext pc;
+    int opt;
+    struct poptOption long_options[] = {
+        POPT_AUTOHELP
+        SSSD_DEBUG_OPTS
+        POPT_TABLEEND
+    };
+
+    const struct CMUnitTest tests[] = {
+        cmocka_unit_test_setup_teardown(test_override_index_full,
+                                        test_override_index_setup,
+                                        test_override_index_teardown),
+        cmocka_unit_test_setup_teardown(test_override_index_smart,
+                                        test_override_index_setup,
+                                        test_override_index_teardown),
+        cmocka_unit_test_setup_teardown(test_override_index_view_change,
+                                        test_override_index_setup,
+                                        test_override_index_teardown),
+    };
+
+    /* Set debug level to invalid value so we can deside if -d 0 was used. */
+    debug_level = SSSDBG_INVALID;
+
+    pc = poptGetContext(argv[0], argc, argv, long_options, 0);
+    while ((opt = poptGetNextOpt(pc)) != -1) {
+        switch (opt) {
+        default:
+            fprintf(stderr, "\nInvalid option %s: %s\n\n",
+                    poptBadOption(pc, 0), poptStrerror(opt));
+            poptPrintUsage(pc, stderr, 0);
+            return 1;
+        }
+    }
+    poptFreeContext(pc);
+
+    DEBUG_CLI_INIT(debug_level);
+
+    rv = cmocka_run_group_tests(tests, NULL, NULL);
+
+    return rv;
+}
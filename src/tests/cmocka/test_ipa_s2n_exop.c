@@ -0,0 +1,628 @@
+/*
+    Copyright (C) 2016 Red Hat
+
+    SSSD tests - pipelined extdom operations of the IPA provider
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <stdlib.h>
+#include <talloc.h>
+#include <tevent.h>
+#include <errno.h>
+#include <popt.h>
+
+#include "providers/ipa/ipa_s2n_exop.c"
+#include "providers/ipa/ipa_opts.h"
+#include "tests/cmocka/common_mock.h"
+
+#define TESTS_PATH "tp_" BASE_FILE_STEM
+#define TEST_CONF_DB "test_ipa_s2n_exop_conf.ldb"
+#define TEST_DOM_NAME "s2n_test"
+#define TEST_ID_PROVIDER "ldap"
+#define TEST_DOM_SID "S-1-5-21-1-2-3"
+
+#define TEST_RID_BASE 1000
+#define TEST_GID_BASE 10000
+#define TEST_MAX_OPS 16
+
+struct s2n_test_op {
+    int msgid;
+    size_t idx;
+    struct sdap_op *op;
+    sdap_op_callback_t *callback;
+    void *data;
+    bool freed;
+};
+
+struct s2n_test_ctx {
+    struct sss_test_ctx *tctx;
+    struct ipa_id_ctx *ipa_ctx;
+    struct sdap_handle *sh;
+
+    /* extdom operations sent, in the order they were sent */
+    struct s2n_test_op ops[TEST_MAX_OPS];
+    size_t num_ops;
+    size_t num_live;
+    size_t max_live;
+    struct berval *reply;
+
+    /* groups in the order they were saved and the batch boundaries */
+    size_t stored[TEST_MAX_OPS];
+    size_t num_stored;
+    size_t commits[TEST_MAX_OPS];
+    size_t num_commits;
+
+    bool done;
+    errno_t error;
+};
+
+/* Must be global because it is needed in the wrappers */
+static struct s2n_test_ctx *s2n_test_ctx;
+
+/* The override lookups are only done for non-default views */
+errno_t get_dp_id_data_for_sid(TALLOC_CTX *mem_ctx, const char *sid,
+                               const char *domain_name,
+                               struct dp_id_data **_ar)
+{
+    fail();
+    return EINVAL;
+}
+
+struct tevent_req *ipa_get_ad_override_send(TALLOC_CTX *mem_ctx,
+                                            struct tevent_context *ev,
+                                            struct sdap_id_ctx *sdap_id_ctx,
+                                            struct ipa_options *ipa_options,
+                                            const char *ipa_realm,
+                                            const char *view_name,
+                                            struct dp_id_data *ar)
+{
+    fail();
+    return NULL;
+}
+
+errno_t ipa_get_ad_override_recv(struct tevent_req *req, int *dp_error_out,
+                                 TALLOC_CTX *mem_ctx,
+                                 struct sysdb_attrs **override_attrs)
+{
+    fail();
+    return EINVAL;
+}
+
+int __wrap_ldap_extended_operation(LDAP *ld, const char *reqoid,
+                                   struct berval *reqdata,
+                                   LDAPControl **serverctrls,
+                                   LDAPControl **clientctrls,
+                                   int *msgidp)
+{
+    struct s2n_test_op *rec;
+    BerElement *ber;
+    ber_tag_t tag;
+    ber_int_t inp;
+    ber_int_t request_type;
+    char *sid;
+    unsigned long rid;
+
+    assert_string_equal(reqoid, EXOP_SID2NAME_OID);
+    assert_true(s2n_test_ctx->num_ops < TEST_MAX_OPS);
+
+    ber = ber_init(reqdata);
+    assert_non_null(ber);
+    tag = ber_scanf(ber, "{eea}", &inp, &request_type, &sid);
+    assert_int_not_equal(tag, LBER_ERROR);
+    ber_free(ber, 1);
+
+    assert_int_equal(inp, INP_SID);
+    assert_int_equal(request_type, REQ_FULL);
+    assert_int_equal(strncmp(sid, TEST_DOM_SID "-",
+                             sizeof(TEST_DOM_SID "-") - 1), 0);
+    rid = strtoul(sid + sizeof(TEST_DOM_SID "-") - 1, NULL, 10);
+    ber_memfree(sid);
+
+    rec = &s2n_test_ctx->ops[s2n_test_ctx->num_ops];
+    rec->msgid = s2n_test_ctx->num_ops + 1;
+    rec->idx = rid - TEST_RID_BASE;
+
+    *msgidp = rec->msgid;
+    return LDAP_SUCCESS;
+}
+
+static int s2n_test_op_destructor(struct sdap_op *op)
+{
+    struct s2n_test_op *rec = &s2n_test_ctx->ops[op->msgid - 1];
+
+    rec->freed = true;
+    s2n_test_ctx->num_live--;
+
+    return 0;
+}
+
+int __wrap_sdap_op_add(TALLOC_CTX *memctx, struct tevent_context *ev,
+                       struct sdap_handle *sh, int msgid,
+                       sdap_op_callback_t *callback, void *data,
+                       int timeout, struct sdap_op **_op)
+{
+    struct s2n_test_op *rec = &s2n_test_ctx->ops[s2n_test_ctx->num_ops];
+    struct sdap_op *op;
+
+    assert_int_equal(msgid, rec->msgid);
+
+    op = talloc_zero(memctx, struct sdap_op);
+    assert_non_null(op);
+    op->sh = sh;
+    op->msgid = msgid;
+    op->callback = callback;
+    op->data = data;
+    op->ev = ev;
+    talloc_set_destructor(op, s2n_test_op_destructor);
+
+    rec->op = op;
+    rec->callback = callback;
+    rec->data = data;
+    s2n_test_ctx->num_ops++;
+
+    s2n_test_ctx->num_live++;
+    if (s2n_test_ctx->num_live > s2n_test_ctx->max_live) {
+        s2n_test_ctx->max_live = s2n_test_ctx->num_live;
+    }
+
+    *_op = op;
+    return EOK;
+}
+
+int __wrap_ldap_parse_result(LDAP *ld, LDAPMessage *res, int *errcodep,
+                             char **matcheddnp, char **errmsgp,
+                             char ***referralsp, LDAPControl ***serverctrls,
+                             int freeit)
+{
+    *errcodep = LDAP_SUCCESS;
+    *errmsgp = NULL;
+    return LDAP_SUCCESS;
+}
+
+int __wrap_ldap_parse_extended_result(LDAP *ld, LDAPMessage *res,
+                                      char **retoidp,
+                                      struct berval **retdatap,
+                                      int freeit)
+{
+    assert_non_null(s2n_test_ctx->reply);
+
+    *retoidp = ber_strdup(EXOP_SID2NAME_OID);
+    assert_non_null(*retoidp);
+    *retdatap = s2n_test_ctx->reply;
+    s2n_test_ctx->reply = NULL;
+
+    return LDAP_SUCCESS;
+}
+
+int __real_sysdb_store_group(struct sss_domain_info *domain,
+                             const char *name,
+                             gid_t gid,
+                             struct sysdb_attrs *attrs,
+                             uint64_t cache_timeout,
+                             time_t now);
+
+int __wrap_sysdb_store_group(struct sss_domain_info *domain,
+                             const char *name,
+                             gid_t gid,
+                             struct sysdb_attrs *attrs,
+                             uint64_t cache_timeout,
+                             time_t now)
+{
+    s2n_test_ctx->stored[s2n_test_ctx->num_stored++] = gid - TEST_GID_BASE;
+
+    return __real_sysdb_store_group(domain, name, gid, attrs, cache_timeout,
+                                    now);
+}
+
+int __real_sysdb_transaction_commit(struct sysdb_ctx *sysdb);
+
+int __wrap_sysdb_transaction_commit(struct sysdb_ctx *sysdb)
+{
+    s2n_test_ctx->commits[s2n_test_ctx->num_commits++] =
+                                                    s2n_test_ctx->num_stored;
+
+    return __real_sysdb_transaction_commit(sysdb);
+}
+
+static int test_s2n_setup(void **state)
+{
+    struct s2n_test_ctx *test_ctx;
+    struct ipa_options *ipa_options;
+    errno_t ret;
+
+    test_dom_suite_setup(TESTS_PATH);
+
+    test_ctx = talloc_zero(NULL, struct s2n_test_ctx);
+    assert_non_null(test_ctx);
+
+    test_ctx->tctx = create_dom_test_ctx(test_ctx, TESTS_PATH, TEST_CONF_DB,
+                                         TEST_DOM_NAME, TEST_ID_PROVIDER,
+                                         NULL);
+    assert_non_null(test_ctx->tctx);
+
+    test_ctx->tctx->dom->domain_id = talloc_strdup(test_ctx->tctx->dom,
+                                                   TEST_DOM_SID);
+    assert_non_null(test_ctx->tctx->dom->domain_id);
+
+    ipa_options = talloc_zero(test_ctx, struct ipa_options);
+    assert_non_null(ipa_options);
+
+    ret = dp_copy_defaults(ipa_options, ipa_basic_opts, IPA_OPTS_BASIC,
+                           &ipa_options->basic);
+    assert_int_equal(ret, EOK);
+
+    test_ctx->ipa_ctx = talloc_zero(test_ctx, struct ipa_id_ctx);
+    assert_non_null(test_ctx->ipa_ctx);
+    test_ctx->ipa_ctx->ipa_options = ipa_options;
+    test_ctx->ipa_ctx->view_name = talloc_strdup(test_ctx->ipa_ctx,
+                                                 SYSDB_DEFAULT_VIEW_NAME);
+    assert_non_null(test_ctx->ipa_ctx->view_name);
+
+    test_ctx->sh = talloc_zero(test_ctx, struct sdap_handle);
+    assert_non_null(test_ctx->sh);
+
+    s2n_test_ctx = test_ctx;
+    *state = test_ctx;
+    return 0;
+}
+
+static int test_s2n_teardown(void **state)
+{
+    struct s2n_test_ctx *test_ctx = talloc_get_type_abort(*state,
+                                                       struct s2n_test_ctx);
+
+    assert_null(test_ctx->reply);
+
+    talloc_free(test_ctx);
+    s2n_test_ctx = NULL;
+
+    test_dom_suite_cleanup(TESTS_PATH, TEST_CONF_DB, TEST_DOM_NAME);
+    return 0;
+}
+
+static void test_s2n_get_list_done(struct tevent_req *req)
+{
+    struct s2n_test_ctx *test_ctx = tevent_req_callback_data(req,
+                                                       struct s2n_test_ctx);
+
+    test_ctx->error = ipa_s2n_get_list_recv(req);
+    test_ctx->done = true;
+    talloc_free(req);
+}
+
+static void test_s2n_get_list(struct s2n_test_ctx *test_ctx,
+                              int max_outstanding,
+                              size_t num_entries)
+{
+    struct tevent_req *req;
+    char **list;
+    size_t c;
+    errno_t ret;
+
+    ret = dp_opt_set_int(test_ctx->ipa_ctx->ipa_options->basic,
+                         IPA_EXTDOM_MAX_OUTSTANDING, max_outstanding);
+    assert_int_equal(ret, EOK);
+
+    list = talloc_zero_array(test_ctx, char *, num_entries + 1);
+    assert_non_null(list);
+    for (c = 0; c < num_entries; c++) {
+        list[c] = talloc_asprintf(list, "%s-%zu", TEST_DOM_SID,
+                                  TEST_RID_BASE + c);
+        assert_non_null(list[c]);
+    }
+
+    req = ipa_s2n_get_list_send(test_ctx, test_ctx->tctx->ev,
+                                test_ctx->ipa_ctx, test_ctx->tctx->dom,
+                                test_ctx->sh, 10, BE_REQ_BY_SECID, REQ_FULL,
+                                REQ_INP_SECID, list);
+    assert_non_null(req);
+    tevent_req_set_callback(req, test_s2n_get_list_done, test_ctx);
+}
+
+/* Answers the operation with the given message ID, with a group whose
+ * name and GID are derived from the position of its SID in the list. */
+static void test_s2n_reply(struct s2n_test_ctx *test_ctx, int msgid,
+                           int error)
+{
+    struct s2n_test_op *rec;
+    struct sdap_msg msg = { 0 };
+    BerElement *ber;
+    char *name;
+    int ret;
+
+    assert_true(msgid > 0 && (size_t) msgid <= test_ctx->num_ops);
+    rec = &test_ctx->ops[msgid - 1];
+    assert_false(rec->freed);
+
+    if (error == 0) {
+        name = talloc_asprintf(test_ctx, "grp%zu", rec->idx);
+        assert_non_null(name);
+
+        ber = ber_alloc_t(LBER_USE_DER);
+        assert_non_null(ber);
+        ret = ber_printf(ber, "{e{ssi}}", RESP_GROUP,
+                         test_ctx->tctx->dom->name, name,
+                         TEST_GID_BASE + rec->idx);
+        assert_int_not_equal(ret, -1);
+        ret = ber_flatten(ber, &test_ctx->reply);
+        assert_int_equal(ret, 0);
+        ber_free(ber, 1);
+        talloc_free(name);
+    }
+
+    rec->callback(rec->op, &msg, error, rec->data);
+}
+
+static void test_s2n_check_stored(struct s2n_test_ctx *test_ctx,
+                                  size_t idx, bool expected)
+{
+    struct ldb_result *res;
+    char *sid;
+    errno_t ret;
+
+    sid = talloc_asprintf(test_ctx, "%s-%zu", TEST_DOM_SID,
+                          TEST_RID_BASE + idx);
+    assert_non_null(sid);
+
+    ret = sysdb_search_object_by_sid(test_ctx, test_ctx->tctx->dom, sid,
+                                     NULL, &res);
+    if (expected) {
+        assert_int_equal(ret, EOK);
+        assert_int_equal(res->count, 1);
+        assert_int_equal(ldb_msg_find_attr_as_uint64(res->msgs[0],
+                                                     SYSDB_GIDNUM, 0),
+                         TEST_GID_BASE + idx);
+        talloc_free(res);
+    } else {
+        assert_int_equal(ret, ENOENT);
+    }
+
+    talloc_free(sid);
+}
+
+static void test_s2n_get_list_window(void **state)
+{
+    struct s2n_test_ctx *test_ctx = talloc_get_type_abort(*state,
+                                                       struct s2n_test_ctx);
+    size_t c;
+
+    test_s2n_get_list(test_ctx, 2, 5);
+
+    /* Only the window is sent upfront */
+    assert_int_equal(test_ctx->num_ops, 2);
+    assert_int_equal(test_ctx->ops[0].idx, 0);
+    assert_int_equal(test_ctx->ops[1].idx, 1);
+
+    /* Every reply makes room for the next entry */
+    test_s2n_reply(test_ctx, 1, 0);
+    assert_int_equal(test_ctx->num_ops, 3);
+    assert_int_equal(test_ctx->num_commits, 0);
+
+    test_s2n_reply(test_ctx, 2, 0);
+    assert_int_equal(test_ctx->num_ops, 4);
+    assert_int_equal(test_ctx->num_commits, 1);
+
+    test_s2n_reply(test_ctx, 3, 0);
+    assert_int_equal(test_ctx->num_ops, 5);
+    test_s2n_reply(test_ctx, 4, 0);
+    assert_int_equal(test_ctx->num_commits, 2);
+    assert_false(test_ctx->done);
+
+    /* The rest is saved once nothing is in flight */
+    test_s2n_reply(test_ctx, 5, 0);
+    assert_true(test_ctx->done);
+    assert_int_equal(test_ctx->error, EOK);
+
+    assert_int_equal(test_ctx->num_ops, 5);
+    assert_int_equal(test_ctx->max_live, 2);
+    assert_int_equal(test_ctx->num_live, 0);
+
+    for (c = 0; c < test_ctx->num_ops; c++) {
+        assert_int_equal(test_ctx->ops[c].idx, c);
+    }
+
+    assert_int_equal(test_ctx->num_commits, 3);
+    assert_int_equal(test_ctx->commits[0], 2);
+    assert_int_equal(test_ctx->commits[1], 4);
+    assert_int_equal(test_ctx->commits[2], 5);
+
+    for (c = 0; c < 5; c++) {
+        test_s2n_check_stored(test_ctx, c, true);
+    }
+}
+
+static void test_s2n_get_list_window_size(void **state)
+{
+    struct s2n_test_ctx *test_ctx = talloc_get_type_abort(*state,
+                                                       struct s2n_test_ctx);
+    size_t c;
+
+    /* A window larger than the list sends everything at once */
+    test_s2n_get_list(test_ctx, 8, 3);
+    assert_int_equal(test_ctx->num_ops, 3);
+
+    test_s2n_reply(test_ctx, 2, 0);
+    test_s2n_reply(test_ctx, 3, 0);
+    assert_int_equal(test_ctx->num_commits, 0);
+    test_s2n_reply(test_ctx, 1, 0);
+    assert_true(test_ctx->done);
+    assert_int_equal(test_ctx->error, EOK);
+
+    assert_int_equal(test_ctx->num_commits, 1);
+    assert_int_equal(test_ctx->commits[0], 3);
+    for (c = 0; c < 3; c++) {
+        assert_int_equal(test_ctx->stored[c], c);
+    }
+
+    /* Values below 1 fall back to one operation at a time */
+    test_ctx->done = false;
+    test_ctx->num_ops = 0;
+    test_ctx->max_live = 0;
+    test_ctx->num_stored = 0;
+    test_ctx->num_commits = 0;
+    memset(test_ctx->ops, 0, sizeof(test_ctx->ops));
+
+    test_s2n_get_list(test_ctx, 0, 3);
+    for (c = 0; c < 3; c++) {
+        assert_int_equal(test_ctx->num_ops, c + 1);
+        assert_false(test_ctx->done);
+        test_s2n_reply(test_ctx, c + 1, 0);
+        assert_int_equal(test_ctx->num_commits, c + 1);
+    }
+    assert_true(test_ctx->done);
+    assert_int_equal(test_ctx->error, EOK);
+    assert_int_equal(test_ctx->max_live, 1);
+}
+
+static void test_s2n_get_list_out_of_order(void **state)
+{
+    struct s2n_test_ctx *test_ctx = talloc_get_type_abort(*state,
+                                                       struct s2n_test_ctx);
+    size_t c;
+
+    test_s2n_get_list(test_ctx, 4, 6);
+    assert_int_equal(test_ctx->num_ops, 4);
+
+    test_s2n_reply(test_ctx, 3, 0);
+    assert_int_equal(test_ctx->num_ops, 5);
+    test_s2n_reply(test_ctx, 1, 0);
+    assert_int_equal(test_ctx->num_ops, 6);
+    test_s2n_reply(test_ctx, 4, 0);
+    assert_int_equal(test_ctx->num_commits, 0);
+    test_s2n_reply(test_ctx, 2, 0);
+    assert_int_equal(test_ctx->num_commits, 1);
+
+    test_s2n_reply(test_ctx, 6, 0);
+    assert_false(test_ctx->done);
+    test_s2n_reply(test_ctx, 5, 0);
+    assert_true(test_ctx->done);
+    assert_int_equal(test_ctx->error, EOK);
+    assert_int_equal(test_ctx->max_live, 4);
+
+    /* Each batch is saved in list order regardless of the reply order */
+    assert_int_equal(test_ctx->num_commits, 2);
+    assert_int_equal(test_ctx->commits[0], 4);
+    assert_int_equal(test_ctx->commits[1], 6);
+    assert_int_equal(test_ctx->num_stored, 6);
+    for (c = 0; c < 6; c++) {
+        assert_int_equal(test_ctx->stored[c], c);
+        test_s2n_check_stored(test_ctx, c, true);
+    }
+}
+
+static void test_s2n_get_list_fail(void **state)
+{
+    struct s2n_test_ctx *test_ctx = talloc_get_type_abort(*state,
+                                                       struct s2n_test_ctx);
+
+    test_s2n_get_list(test_ctx, 2, 6);
+
+    /* The first batch is saved */
+    test_s2n_reply(test_ctx, 2, 0);
+    test_s2n_reply(test_ctx, 1, 0);
+    assert_int_equal(test_ctx->num_commits, 1);
+    assert_int_equal(test_ctx->num_ops, 4);
+
+    /* One ready entry of the second batch, then a failure */
+    test_s2n_reply(test_ctx, 3, 0);
+    assert_int_equal(test_ctx->num_ops, 5);
+    test_s2n_reply(test_ctx, 5, EIO);
+
+    assert_true(test_ctx->done);
+    assert_int_equal(test_ctx->error, EIO);
+
+    /* The other operation in flight is abandoned and nothing new is sent */
+    assert_true(test_ctx->ops[3].freed);
+    assert_int_equal(test_ctx->num_live, 0);
+    assert_int_equal(test_ctx->num_ops, 5);
+
+    /* Only the saved batch is in the cache, the rest is dropped */
+    assert_int_equal(test_ctx->num_commits, 1);
+    assert_int_equal(test_ctx->num_stored, 2);
+    test_s2n_check_stored(test_ctx, 0, true);
+    test_s2n_check_stored(test_ctx, 1, true);
+    test_s2n_check_stored(test_ctx, 2, false);
+    test_s2n_check_stored(test_ctx, 3, false);
+    test_s2n_check_stored(test_ctx, 4, false);
+}
+
+static void test_s2n_get_list_empty(void **state)
+{
+    struct s2n_test_ctx *test_ctx = talloc_get_type_abort(*state,
+                                                       struct s2n_test_ctx);
+
+    test_s2n_get_list(test_ctx, 4, 0);
+    assert_int_equal(test_ctx->num_ops, 0);
+
+    tevent_loop_once(test_ctx->tctx->ev);
+    assert_true(test_ctx->done);
+    assert_int_equal(test_ctx->error, EOK);
+    assert_int_equal(test_ctx->num_commits, 0);
+}
+
+int main(int argc, const char *argv[])
+{
+    int rv;
+    poptContext pc;
+    int opt;
+    struct poptOption long_options[] = {
+        POPT_AUTOHELP
+        SSSD_DEBUG_OPTS
+        POPT_TABLEEND
+    };
+
+    const struct CMUnitTest tests[] = {
+        cmocka_unit_test_setup_teardown(test_s2n_get_list_window,
+                                        test_s2n_setup,
+                                        test_s2n_teardown),
+        cmocka_unit_test_setup_teardown(test_s2n_get_list_window_size,
+                                        test_s2n_setup,
+                                        test_s2n_teardown),
+        cmocka_unit_test_setup_teardown(test_s2n_get_list_out_of_order,
+                                        test_s2n_setup,
+                                        test_s2n_teardown),
+        cmocka_unit_test_setup_teardown(test_s2n_get_list_fail,
+                                        test_s2n_setup,
+                                        test_s2n_teardown),
+        cmocka_unit_test_setup_teardown(test_s2n_get_list_empty,
+                                        test_s2n_setup,
+                                        test_s2n_teardown),
+    };
+
+    /* Set debug level to invalid value so we can deside if -d 0 was used. */
+    debug_level = SSSDBG_INVALID;
+
+    pc = poptGetContext(argv[0], argc, argv, long_options, 0);
+    while ((opt = poptGetNextOpt(pc)) != -1) {
+        switch (opt) {
+        default:
+            fprintf(stderr, "\nInvalid option %s: %s\n\n",
+                    poptBadOption(pc, 0), poptStrerror(opt));
+            poptPrintUsage(pc, stderr, 0);
+            return 1;
+        }
+    }
+    poptFreeContext(pc);
+
+    DEBUG_CLI_INIT(debug_level);
+
+    /* Even though normally the tests should clean up after themselves
+     * they might not after a failed run. Remove the old db to be sure */
+    tests_set_cwd();
+    test_dom_suite_cleanup(TESTS_PATH, TEST_CONF_DB, TEST_DOM_NAME);
+
+    rv = cmocka_run_group_tests(tests, NULL, NULL);
+    return rv;
+}
@@ -0,0 +1,302 @@
+/*
+    Copyright (C) 2016 Red Hat
+
+    SSSD tests - batch account lookups in the LDAP provider
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <stdarg.h>
+#include <stdlib.h>
+#include <stddef.h>
+#include <setjmp.h>
+#include <cmocka.h>
+#include <popt.h>
+
+#include "tests/cmocka/common_mock.h"
+#include "providers/ldap/ldap_common.h"
+#include "providers/ldap/ldap_opts.h"
+#include "db/sysdb.h"
+
+struct batch_test_ctx {
+    struct sdap_id_ctx *id_ctx;
+    struct sdap_options *opts;
+    struct sss_domain_info *domain;
+};
+
+static int test_batch_setup(void **state)
+{
+    struct batch_test_ctx *test_ctx;
+    errno_t ret;
+
+    assert_true(leak_check_setup());
+
+    test_ctx = talloc_zero(global_talloc_context, struct batch_test_ctx);
+    assert_non_null(test_ctx);
+
+    test_ctx->opts = talloc_zero(test_ctx, struct sdap_options);
+    assert_non_null(test_ctx->opts);
+
+    ret = sdap_copy_map(test_ctx->opts, rfc2307_user_map,
+                        SDAP_OPTS_USER, &test_ctx->opts->user_map);
+    assert_int_equal(ret, ERR_OK);
+
+    ret = dp_copy_defaults(test_ctx->opts, default_basic_opts,
+                           SDAP_OPTS_BASIC, &test_ctx->opts->basic);
+    assert_int_equal(ret, ERR_OK);
+
+    test_ctx->opts->schema_type = SDAP_SCHEMA_RFC2307;
+
+    test_ctx->id_ctx = talloc_zero(test_ctx, struct sdap_id_ctx);
+    assert_non_null(test_ctx->id_ctx);
+    test_ctx->id_ctx->opts = test_ctx->opts;
+
+    test_ctx->domain = talloc_zero(test_ctx, struct sss_domain_info);
+    assert_non_null(test_ctx->domain);
+    test_ctx->domain->case_sensitive = true;
+
+    *state = test_ctx;
+    return 0;
+}
+
+static int test_batch_teardown(void **state)
+{
+    struct batch_test_ctx *test_ctx = talloc_get_type_abort(*state,
+                                                   struct batch_test_ctx);
+
+    talloc_free(test_ctx);
+    assert_true(leak_check_teardown());
+    return 0;
+}
+
+static struct dp_id_data *test_id_data(TALLOC_CTX *mem_ctx,
+                                       int entry_type,
+                                       int filter_type,
+                                       const char *filter_value,
+                                       const char *extra_value)
+{
+    struct dp_id_data *data;
+
+    data = talloc_zero(mem_ctx, struct dp_id_data);
+    assert_non_null(data);
+
+    data->entry_type = entry_type;
+    data->filter_type = filter_type;
+    data->filter_value = filter_value;
+    data->extra_value = extra_value;
+    data->domain = "test.dom";
+
+    return data;
+}
+
+static struct sysdb_attrs *test_user_attrs(TALLOC_CTX *mem_ctx,
+                                           const char **names)
+{
+    struct sysdb_attrs *attrs;
+    errno_t ret;
+    int i;
+
+    attrs = sysdb_new_attrs(mem_ctx);
+    assert_non_null(attrs);
+
+    for (i = 0; names[i] != NULL; i++) {
+        ret = sysdb_attrs_add_string(attrs, SYSDB_NAME, names[i]);
+        assert_int_equal(ret, EOK);
+    }
+
+    return attrs;
+}
+
+static void test_batch_can_merge(void **state)
+{
+    struct batch_test_ctx *test_ctx = talloc_get_type_abort(*state,
+                                                   struct batch_test_ctx);
+    struct dp_id_data *data;
+
+    /* Plain user by name. */
+    data = test_id_data(test_ctx, BE_REQ_USER, BE_FILTER_NAME, "user1", NULL);
+    assert_true(sdap_account_batch_can_merge(test_ctx->id_ctx, false, data));
+    assert_true(sdap_account_batch_can_merge(test_ctx->id_ctx, true, data));
+
+    /* Group lookups need nested group processing. */
+    data = test_id_data(test_ctx, BE_REQ_GROUP, BE_FILTER_NAME, "grp1", NULL);
+    assert_false(sdap_account_batch_can_merge(test_ctx->id_ctx, false, data));
+
+    /* Lookups by ID, SID or with an extra value such as UPN. */
+    data = test_id_data(test_ctx, BE_REQ_USER, BE_FILTER_IDNUM, "1000", NULL);
+    assert_false(sdap_account_batch_can_merge(test_ctx->id_ctx, false, data));
+
+    data = test_id_data(test_ctx, BE_REQ_USER, BE_FILTER_SECID,
+                        "S-1-5-21-1-2-3-1000", NULL);
+    assert_false(sdap_account_batch_can_merge(test_ctx->id_ctx, false, data));
+
+    data = test_id_data(test_ctx, BE_REQ_USER, BE_FILTER_NAME,
+                        "user1@TEST.DOM", EXTRA_NAME_IS_UPN);
+    assert_false(sdap_account_batch_can_merge(test_ctx->id_ctx, false, data));
+
+    /* Local fallback works with a single entry only. */
+    data = test_id_data(test_ctx, BE_REQ_USER, BE_FILTER_NAME, "user1", NULL);
+    dp_opt_set_bool(test_ctx->opts->basic,
+                    SDAP_RFC2307_FALLBACK_TO_LOCAL_USERS, true);
+    assert_false(sdap_account_batch_can_merge(test_ctx->id_ctx, false, data));
+    dp_opt_set_bool(test_ctx->opts->basic,
+                    SDAP_RFC2307_FALLBACK_TO_LOCAL_USERS, false);
+
+    /* AD without ID mapping until POSIX attributes were checked. */
+    test_ctx->opts->schema_type = SDAP_SCHEMA_AD;
+    assert_false(sdap_account_batch_can_merge(test_ctx->id_ctx, false, data));
+    assert_true(sdap_account_batch_can_merge(test_ctx->id_ctx, true, data));
+
+    test_ctx->id_ctx->srv_opts = talloc_zero(test_ctx->id_ctx,
+                                             struct sdap_server_opts);
+    assert_non_null(test_ctx->id_ctx->srv_opts);
+    test_ctx->id_ctx->srv_opts->posix_checked = true;
+    assert_true(sdap_account_batch_can_merge(test_ctx->id_ctx, false, data));
+}
+
+static void test_batch_filter(void **state)
+{
+    struct batch_test_ctx *test_ctx = talloc_get_type_abort(*state,
+                                                   struct batch_test_ctx);
+    const char *names[] = { "user1", "user2", NULL };
+    char *filter;
+    errno_t ret;
+
+    ret = sdap_account_batch_filter(test_ctx, test_ctx->opts, false,
+                                    names, 2, &filter);
+    assert_int_equal(ret, EOK);
+    assert_string_equal(filter,
+                        "(&(|(uid=user1)(uid=user2))(objectclass=posixAccount)"
+                        "(uid=*)(&(uidNumber=*)(!(uidNumber=0))))");
+    talloc_free(filter);
+
+    /* The RFC2307 map has no SID attribute by default. */
+    test_ctx->opts->user_map[SDAP_AT_USER_OBJECTSID].name =
+                                        talloc_strdup(test_ctx->opts->user_map,
+                                                      "objectSID");
+    assert_non_null(test_ctx->opts->user_map[SDAP_AT_USER_OBJECTSID].name);
+
+    ret = sdap_account_batch_filter(test_ctx, test_ctx->opts, true,
+                                    names, 2, &filter);
+    assert_int_equal(ret, EOK);
+    assert_string_equal(filter,
+                        "(&(|(uid=user1)(uid=user2))(objectclass=posixAccount)"
+                        "(uid=*)(objectSID=*))");
+    talloc_free(filter);
+}
+
+static void test_batch_filter_sanitize(void **state)
+{
+    struct batch_test_ctx *test_ctx = talloc_get_type_abort(*state,
+                                                   struct batch_test_ctx);
+    const char *names[] = { "us*er", "(user)", NULL };
+    char *filter;
+    errno_t ret;
+
+    /* Special characters must not break out of the OR. */
+    ret = sdap_account_batch_filter(test_ctx, test_ctx->opts, false,
+                                    names, 2, &filter);
+    assert_int_equal(ret, EOK);
+    assert_string_equal(filter,
+                        "(&(|(uid=us\\2aer)(uid=\\28user\\29))"
+                        "(objectclass=posixAccount)"
+                        "(uid=*)(&(uidNumber=*)(!(uidNumber=0))))");
+    talloc_free(filter);
+}
+
+static void test_batch_user_found(void **state)
+{
+    struct batch_test_ctx *test_ctx = talloc_get_type_abort(*state,
+                                                   struct batch_test_ctx);
+    const char *names1[] = { "user1", NULL };
+    const char *names2[] = { "user2", "alias2", NULL };
+    struct sysdb_attrs *users[3];
+
+    users[0] = test_user_attrs(test_ctx, names1);
+    users[1] = test_user_attrs(test_ctx, names2);
+    /* Entries without a name are skipped. */
+    users[2] = sysdb_new_attrs(test_ctx);
+    assert_non_null(users[2]);
+
+    assert_true(sdap_account_batch_user_found(test_ctx->domain, users, 3,
+                                              "user1"));
+    assert_true(sdap_account_batch_user_found(test_ctx->domain, users, 3,
+                                              "user2"));
+    assert_true(sdap_account_batch_user_found(test_ctx->domain, users, 3,
+                                              "alias2"));
+    assert_false(sdap_account_batch_user_found(test_ctx->domain, users, 3,
+                                               "user3"));
+    assert_false(sdap_account_batch_user_found(test_ctx->domain, users, 0,
+                                               "user1"));
+
+    /* Case sensitivity follows the domain. */
+    assert_false(sdap_account_batch_user_found(test_ctx->domain, users, 3,
+                                               "USER1"));
+    test_ctx->domain->case_sensitive = false;
+    assert_true(sdap_account_batch_user_found(test_ctx->domain, users, 3,
+                                              "USER1"));
+    assert_true(sdap_account_batch_user_found(test_ctx->domain, users, 3,
+                                              "Alias2"));
+
+    talloc_free(users[0]);
+    talloc_free(users[1]);
+    talloc_free(users[2]);
+}
+
+int main(int argc, const char *argv[])
+{
+    int rv;
+    poptContext pc;
+    int opt;
+    struct poptOption long_options[] = {
+        POPT_AUTOHELP
+        SSSD_DEBUG_OPTS
+        POPT_TABLEEND
+    };
+
+    const struct CMUnitTest tests[] = {
+        cmocka_unit_test_setup_teardown(test_batch_can_merge,
+                                        test_batch_setup,
+                                        test_batch_teardown),
+        cmocka_unit_test_setup_teardown(test_batch_filter,
+                                        test_batch_setup,
+                                        test_batch_teardown),
+        cmocka_unit_test_setup_teardown(test_batch_filter_sanitize,
+                                        test_batch_setup,
+                                        test_batch_teardown),
+        cmocka_unit_test_setup_teardown(test_batch_user_found,
+                                        test_batch_setup,
+                                        test_batch_teardown),
+    };
+
+    /* Set debug level to invalid value so we can deside if -d 0 was used. */
+    debug_level = SSSDBG_INVALID;
+
+    pc = poptGetContext(argv[0], argc, argv, long_options, 0);
+    while ((opt = poptGetNextOpt(pc)) != -1) {
+        switch (opt) {
+        default:
+            fprintf(stderr, "\nInvalid option %s: %s\n\n",
+                    poptBadOption(pc, 0), poptStrerror(opt));
+            poptPrintUsage(pc, stderr, 0);
+            return 1;
+        }
+    }
+    poptFreeContext(pc);
+
+    DEBUG_CLI_INIT(debug_level);
+
+    rv = cmocka_run_group_tests(tests, NULL, NULL);
+    return rv;
+}
@@ -181,7 +181,7 @@ static void test_id_cleanup_exp_group(void **state)
 {
     errno_t ret;
     struct ldb_message *msg;
-    struct sdap_domain sdom;
+    struct sdap_domain sdom = { 0 };
     char *special_grp;
     char *empty_special_grp;
     char *empty_grp;
@@ -294,6 +294,155 @@ static void test_id_cleanup_exp_group(void **state)
     assert_int_equal(ret, ENOENT);
 }
 
+struct cleanup_async_state {
+    bool done;
+    errno_t ret;
+};
+
+static void test_id_cleanup_async_done(struct tevent_req *req)
+{
+    struct cleanup_async_state *state;
+
+    state = tevent_req_callback_data(req, struct cleanup_async_state);
+    state->ret = ldap_id_cleanup_recv(req);
+    state->done = true;
+    talloc_free(req);
+}
+
+static void test_id_cleanup_async_many_groups(void **state)
+{
+    errno_t ret;
+    struct ldb_message *msg;
+    struct sdap_domain sdom = { 0 };
+    struct tevent_req *req;
+    struct cleanup_async_state async_state = { 0 };
+    char *grp;
+    /* more than fits into a single cleanup slice */
+    const int num_groups = 250;
+    int i;
+    struct sysdb_test_ctx *test_ctx = talloc_get_type_abort(*state,
+                                                            struct sysdb_test_ctx);
+
+    for (i = 0; i < num_groups; i++) {
+        grp = sss_create_internal_fqname(test_ctx,
+                                         talloc_asprintf(test_ctx, "grp%d", i),
+                                         test_ctx->domain->name);
+        assert_non_null(grp);
+
+        ret = sysdb_store_group(test_ctx->domain, grp,
+                                20000 + i, NULL, 30, 0);
+        assert_int_equal(ret, EOK);
+
+        ret = invalidate_group(test_ctx, test_ctx->domain, grp);
+        assert_int_equal(ret, EOK);
+    }
+
+    sdom.dom = test_ctx->domain;
+
+    req = ldap_id_cleanup_send(test_ctx, test_ctx->ev, test_ctx->opts, &sdom);
+    assert_non_null(req);
+    tevent_req_set_callback(req, test_id_cleanup_async_done, &async_state);
+
+    while (!async_state.done) {
+        tevent_loop_once(test_ctx->ev);
+    }
+    assert_int_equal(async_state.ret, EOK);
+    assert_false(sdom.purge_users_done);
+    assert_int_not_equal(sdom.last_purge.tv_sec, 0);
+
+    for (i = 0; i < num_groups; i++) {
+        grp = sss_create_internal_fqname(test_ctx,
+                                         talloc_asprintf(test_ctx, "grp%d", i),
+                                         test_ctx->domain->name);
+        assert_non_null(grp);
+
+        ret = sysdb_search_group_by_name(test_ctx, test_ctx->domain,
+                                         grp, NULL, &msg);
+        assert_int_equal(ret, ENOENT);
+    }
+}
+
+static void test_id_cleanup_async_refreshed(void **state)
+{
+    errno_t ret;
+    struct ldb_message *msg;
+    struct sdap_domain sdom = { 0 };
+    struct tevent_req *req;
+    struct cleanup_async_state async_state = { 0 };
+    char *grp;
+    const int num_groups = 250;
+    int remaining = 0;
+    int i;
+    struct sysdb_test_ctx *test_ctx = talloc_get_type_abort(*state,
+                                                            struct sysdb_test_ctx);
+
+    for (i = 0; i < num_groups; i++) {
+        grp = sss_create_internal_fqname(test_ctx,
+                                         talloc_asprintf(test_ctx, "grp%d", i),
+                                         test_ctx->domain->name);
+        assert_non_null(grp);
+
+        ret = sysdb_store_group(test_ctx->domain, grp,
+                                20000 + i, NULL, 30, 0);
+        assert_int_equal(ret, EOK);
+
+        ret = invalidate_group(test_ctx, test_ctx->domain, grp);
+        assert_int_equal(ret, EOK);
+    }
+
+    sdom.dom = test_ctx->domain;
+
+    req = ldap_id_cleanup_send(test_ctx, test_ctx->ev, test_ctx->opts, &sdom);
+    assert_non_null(req);
+    tevent_req_set_callback(req, test_id_cleanup_async_done, &async_state);
+
+    /* Let the first slice run and then refresh all groups, the ones which
+     * were not processed yet must survive. */
+    tevent_loop_once(test_ctx->ev);
+    assert_false(async_state.done);
+
+    for (i = 0; i < num_groups; i++) {
+        grp = sss_create_internal_fqname(test_ctx,
+                                         talloc_asprintf(test_ctx, "grp%d", i),
+                                         test_ctx->domain->name);
+        assert_non_null(grp);
+
+        ret = sysdb_search_group_by_name(test_ctx, test_ctx->domain,
+                                         grp, NULL, &msg);
+        if (ret == ENOENT) {
+            continue;
+        }
+        assert_int_equal(ret, EOK);
+
+        ret = sysdb_store_group(test_ctx->domain, grp,
+                                20000 + i, NULL, 30, 0);
+        assert_int_equal(ret, EOK);
+    }
+
+    while (!async_state.done) {
+        tevent_loop_once(test_ctx->ev);
+    }
+    assert_int_equal(async_state.ret, EOK);
+
+    for (i = 0; i < num_groups; i++) {
+        grp = sss_create_internal_fqname(test_ctx,
+                                         talloc_asprintf(test_ctx, "grp%d", i),
+                                         test_ctx->domain->name);
+        assert_non_null(grp);
+
+        ret = sysdb_search_group_by_name(test_ctx, test_ctx->domain,
+                                         grp, NULL, &msg);
+        if (ret == EOK) {
+            remaining++;
+        } else {
+            assert_int_equal(ret, ENOENT);
+        }
+    }
+
+    /* only the first slice of 100 groups was removed */
+    assert_int_equal(remaining, num_groups - 100);
+}
+
 int main(int argc, const char *argv[])
 {
     int rv;
@@ -311,6 +460,10 @@ int main(int argc, const char *argv[])
     const struct CMUnitTest tests[] = {
         cmocka_unit_test_setup_teardown(test_id_cleanup_exp_group,
                                         test_sysdb_setup, test_sysdb_teardown),
+        cmocka_unit_test_setup_teardown(test_id_cleanup_async_many_groups,
+                                        test_sysdb_setup, test_sysdb_teardown),
+        cmocka_unit_test_setup_teardown(test_id_cleanup_async_refreshed,
+                                        test_sysdb_setup, test_sysdb_teardown),
     };
 
     /* Set debug level to invalid value so we can deside if -d 0 was used. */
@@ -73,6 +73,7 @@
 
 static char CACHED_AUTH_TIMEOUT_STR[] = "4";
 static const int CACHED_AUTH_TIMEOUT = 4;
+static char CACHED_ACCT_TIMEOUT_STR[] = "30";
 
 struct pam_test_ctx {
     struct sss_test_ctx *tctx;
@@ -183,6 +184,9 @@ struct pam_ctx *mock_pctx(TALLOC_CTX *mem_ctx)
     ret = sss_hash_create(pctx, 10, &pctx->id_table);
     assert_int_equal(ret, EOK);
 
+    ret = sss_hash_create(pctx, 10, &pctx->acct_table);
+    assert_int_equal(ret, EOK);
+
     return pctx;
 }
 
@@ -392,6 +396,57 @@ static int pam_cached_test_setup(void **state)
     return 0;
 }
 
+static int pam_cached_acct_test_setup(void **state)
+{
+    struct sss_test_conf_param dom_params[] = {
+        { "enumerate", "false" },
+        { "cache_credentials", "true" },
+        { "cached_acct_timeout", CACHED_ACCT_TIMEOUT_STR },
+        { NULL, NULL },             /* Sentinel */
+    };
+
+    struct sss_test_conf_param pam_params[] = {
+        { "p11_child_timeout", "30" },
+        { NULL, NULL },             /* Sentinel */
+    };
+
+    struct sss_test_conf_param monitor_params[] = {
+        { "certificate_verification", "no_ocsp"},
+        { NULL, NULL },             /* Sentinel */
+    };
+
+    test_pam_setup(dom_params, pam_params, monitor_params, state);
+
+    pam_test_setup_common();
+    return 0;
+}
+
+static int pam_cached_acct_ldap_test_setup(void **state)
+{
+    struct sss_test_conf_param dom_params[] = {
+        { "enumerate", "false" },
+        { "cache_credentials", "true" },
+        { "access_provider", "ldap" },
+        { "cached_acct_timeout", CACHED_ACCT_TIMEOUT_STR },
+        { NULL, NULL },             /* Sentinel */
+    };
+
+    struct sss_test_conf_param pam_params[] = {
+        { "p11_child_timeout", "30" },
+        { NULL, NULL },             /* Sentinel */
+    };
+
+    struct sss_test_conf_param monitor_params[] = {
+        { "certificate_verification", "no_ocsp"},
+        { NULL, NULL },             /* Sentinel */
+    };
+
+    test_pam_setup(dom_params, pam_params, monitor_params, state);
+
+    pam_test_setup_common();
+    return 0;
+}
+
 static int pam_test_teardown(void **state)
 {
     int ret;
@@ -1118,6 +1173,85 @@ void test_pam_cached_auth_failed_combined_pw_with_cached_2fa(void **state)
     assert_true(pam_test_ctx->provider_contacted);
 }
 
+static void common_test_pam_acct_mgmt(int exp_pam_status)
+{
+    int ret;
+
+    mock_input_pam(pam_test_ctx, "pamuser", NULL, NULL);
+
+    will_return(__wrap_sss_packet_get_cmd, SSS_PAM_ACCT_MGMT);
+    will_return(__wrap_sss_packet_get_body, WRAP_CALL_REAL);
+
+    pam_test_ctx->exp_pam_status = exp_pam_status;
+    pam_test_ctx->provider_contacted = false;
+    set_cmd_cb(test_pam_simple_check);
+
+    ret = sss_cmd_execute(pam_test_ctx->cctx, SSS_PAM_ACCT_MGMT,
+                          pam_test_ctx->pam_cmds);
+    assert_int_equal(ret, EOK);
+
+    /* Wait until the test finishes with EOK */
+    ret = test_ev_loop(pam_test_ctx->tctx);
+    assert_int_equal(ret, EOK);
+}
+
+void test_pam_cached_acct_success(void **state)
+{
+    common_test_pam_acct_mgmt(PAM_SUCCESS);
+    assert_true(pam_test_ctx->provider_contacted);
+
+    /* The decision is reused */
+    common_test_pam_acct_mgmt(PAM_SUCCESS);
+    assert_false(pam_test_ctx->provider_contacted);
+}
+
+void test_pam_cached_acct_denied(void **state)
+{
+    common_test_pam_acct_mgmt(PAM_PERM_DENIED);
+    assert_true(pam_test_ctx->provider_contacted);
+
+    /* Denials are never cached */
+    common_test_pam_acct_mgmt(PAM_PERM_DENIED);
+    assert_true(pam_test_ctx->provider_contacted);
+}
+
+void test_pam_cached_acct_invalidated(void **state)
+{
+    int ret;
+
+    common_test_pam_acct_mgmt(PAM_SUCCESS);
+    assert_true(pam_test_ctx->provider_contacted);
+
+    /* Decisions of other users are kept */
+    ret = pam_acct_cache_invalidate(pam_test_ctx->pctx->acct_table,
+                                    pam_test_ctx->tctx->dom->name,
+                                    pam_test_ctx->wrong_user_fqdn);
+    assert_int_equal(ret, EOK);
+
+    common_test_pam_acct_mgmt(PAM_SUCCESS);
+    assert_false(pam_test_ctx->provider_contacted);
+
+    ret = pam_acct_cache_invalidate(pam_test_ctx->pctx->acct_table,
+                                    pam_test_ctx->tctx->dom->name,
+                                    pam_test_ctx->pam_user_fqdn);
+    assert_int_equal(ret, EOK);
+
+    common_test_pam_acct_mgmt(PAM_SUCCESS);
+    assert_true(pam_test_ctx->provider_contacted);
+}
+
+void test_pam_cached_acct_unsupported(void **state)
+{
+    /* The LDAP access provider checks the account state on the server */
+    assert_int_equal(pam_test_ctx->tctx->dom->cached_acct_timeout, 0);
+
+    common_test_pam_acct_mgmt(PAM_SUCCESS);
+    assert_true(pam_test_ctx->provider_contacted);
+
+    common_test_pam_acct_mgmt(PAM_SUCCESS);
+    assert_true(pam_test_ctx->provider_contacted);
+}
+
 /* Off-line authentication */
 
 void test_pam_offline_auth_no_hash(void **state)
@@ -1845,6 +1979,18 @@ int main(int argc, const char *argv[])
         cmocka_unit_test_setup_teardown(test_pam_cached_auth_failed_combined_pw_with_cached_2fa,
                                         pam_cached_test_setup,
                                         pam_test_teardown),
+        cmocka_unit_test_setup_teardown(test_pam_cached_acct_success,
+                                        pam_cached_acct_test_setup,
+                                        pam_test_teardown),
+        cmocka_unit_test_setup_teardown(test_pam_cached_acct_denied,
+                                        pam_cached_acct_test_setup,
+                                        pam_test_teardown),
+        cmocka_unit_test_setup_teardown(test_pam_cached_acct_invalidated,
+                                        pam_cached_acct_test_setup,
+                                        pam_test_teardown),
+        cmocka_unit_test_setup_teardown(test_pam_cached_acct_unsupported,
+                                        pam_cached_acct_ldap_test_setup,
+                                        pam_test_teardown),
 /* p11_child is not built without NSS */
 #ifdef HAVE_NSS
         cmocka_unit_test_setup_teardown(test_pam_preauth_cert_nocert,
@@ -0,0 +1,488 @@
+/*
+    Copyright (C) 2016 Red Hat
+
+    SSSD tests - lookups of the proxy provider in proxy_id_child
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <talloc.h>
+#include <tevent.h>
+#include <errno.h>
+#include <popt.h>
+
+/* In order to access the request and reply handling of both sides */
+#include "providers/proxy/proxy_id.c"
+#include "providers/proxy/proxy_id_child.c"
+
+#include "tests/cmocka/common_mock.h"
+
+#define TEST_USER "user1"
+#define TEST_GROUP "group1"
+#define TEST_UID 1000
+#define TEST_GID 2000
+
+/* Calls of the NSS functions, the mocks do not keep any other state */
+static int num_calls;
+
+static enum nss_status mock_getpwnam_r(const char *name, struct passwd *result,
+                                       char *buffer, size_t buflen,
+                                       int *errnop)
+{
+    num_calls++;
+
+    if (strcmp(name, TEST_USER) != 0) {
+        return NSS_STATUS_NOTFOUND;
+    }
+
+    /* Ask for a larger buffer once, like a module with a long entry. */
+    if (buflen < 2 * DEFAULT_BUFSIZE) {
+        *errnop = ERANGE;
+        return NSS_STATUS_TRYAGAIN;
+    }
+
+    result->pw_name = discard_const(TEST_USER);
+    result->pw_passwd = discard_const("*");
+    result->pw_uid = TEST_UID;
+    result->pw_gid = TEST_GID;
+    result->pw_gecos = NULL;
+    result->pw_dir = discard_const("/home/" TEST_USER);
+    result->pw_shell = discard_const("/bin/sh");
+
+    return NSS_STATUS_SUCCESS;
+}
+
+static enum nss_status mock_getpwuid_r(uid_t uid, struct passwd *result,
+                                       char *buffer, size_t buflen,
+                                       int *errnop)
+{
+    num_calls++;
+
+    *errnop = ENOENT;
+    return NSS_STATUS_NOTFOUND;
+}
+
+static char test_member1[] = "user1";
+static char test_member2[] = "user2";
+static char *test_members[] = { test_member1, test_member2, NULL };
+static char **mock_members = test_members;
+
+static enum nss_status mock_getgrgid_r(gid_t gid, struct group *result,
+                                       char *buffer, size_t buflen,
+                                       int *errnop)
+{
+    num_calls++;
+
+    if (gid != TEST_GID) {
+        return NSS_STATUS_NOTFOUND;
+    }
+
+    result->gr_name = discard_const(TEST_GROUP);
+    result->gr_passwd = discard_const("x");
+    result->gr_gid = TEST_GID;
+    result->gr_mem = mock_members;
+
+    return NSS_STATUS_SUCCESS;
+}
+
+static enum nss_status mock_getgrnam_r(const char *name, struct group *result,
+                                       char *buffer, size_t buflen,
+                                       int *errnop)
+{
+    num_calls++;
+
+    return NSS_STATUS_NOTFOUND;
+}
+
+static enum nss_status mock_initgroups_dyn(const char *user, gid_t group,
+                                           long int *start, long int *size,
+                                           gid_t **groups, long int limit,
+                                           int *errnop)
+{
+    num_calls++;
+
+    (*groups)[(*start)++] = 3000;
+    (*groups)[(*start)++] = 3001;
+
+    return NSS_STATUS_SUCCESS;
+}
+
+struct proxy_child_test_ctx {
+    struct proxy_nss_ops ops;
+};
+
+static int test_proxy_child_setup(void **state)
+{
+    struct proxy_child_test_ctx *test_ctx;
+
+    assert_true(leak_check_setup());
+
+    test_ctx = talloc_zero(global_talloc_context,
+                           struct proxy_child_test_ctx);
+    assert_non_null(test_ctx);
+
+    test_ctx->ops.getpwnam_r = mock_getpwnam_r;
+    test_ctx->ops.getpwuid_r = mock_getpwuid_r;
+    test_ctx->ops.getgrnam_r = mock_getgrnam_r;
+    test_ctx->ops.getgrgid_r = mock_getgrgid_r;
+    test_ctx->ops.initgroups_dyn = mock_initgroups_dyn;
+
+    num_calls = 0;
+    mock_members = test_members;
+
+    *state = test_ctx;
+    return 0;
+}
+
+static int test_proxy_child_teardown(void **state)
+{
+    struct proxy_child_test_ctx *test_ctx =
+        talloc_get_type_abort(*state, struct proxy_child_test_ctx);
+
+    talloc_free(test_ctx);
+    assert_true(leak_check_teardown());
+    return 0;
+}
+
+/* Packs the request the same way as proxy_child_lookup_send() */
+static uint8_t *test_request(TALLOC_CTX *mem_ctx,
+                             enum proxy_id_child_cmd cmd,
+                             const char *name,
+                             uint32_t id,
+                             uint32_t *_len)
+{
+    uint8_t *buf;
+    size_t name_len = strlen(name);
+    size_t p = 0;
+
+    buf = talloc_size(mem_ctx, 3 * sizeof(uint32_t) + name_len);
+    assert_non_null(buf);
+
+    SAFEALIGN_SET_UINT32(&buf[p], cmd, &p);
+    SAFEALIGN_SET_UINT32(&buf[p], id, &p);
+    SAFEALIGN_SET_UINT32(&buf[p], name_len, &p);
+    safealign_memcpy(&buf[p], name, name_len, &p);
+
+    *_len = p;
+    return buf;
+}
+
+/* Runs the request through the worker handler and parses the reply as
+ * sssd_be would. */
+static struct proxy_child_reply *
+test_lookup(struct proxy_child_test_ctx *test_ctx,
+            enum proxy_id_child_cmd cmd,
+            const char *name,
+            uint32_t id)
+{
+    TALLOC_CTX *tmp_ctx;
+    struct proxy_child_reply *reply;
+    uint8_t *req_buf;
+    uint32_t req_len;
+    uint8_t *buf = NULL;
+    uint32_t len = 0;
+    errno_t ret;
+
+    /* Like the worker loop, which frees everything after each request */
+    tmp_ctx = talloc_new(test_ctx);
+    assert_non_null(tmp_ctx);
+
+    req_buf = test_request(tmp_ctx, cmd, name, id, &req_len);
+
+    ret = proxy_id_child_worker_handler(tmp_ctx, req_buf, req_len,
+                                        &buf, &len, &test_ctx->ops);
+    assert_int_equal(ret, EOK);
+    assert_true(len > 0);
+    assert_true(len <= SSS_CHILD_POOL_MAX_REPLY);
+
+    ret = proxy_child_parse_reply(test_ctx, cmd, buf, len, &reply);
+    assert_int_equal(ret, EOK);
+
+    talloc_free(tmp_ctx);
+    return reply;
+}
+
+static void test_proxy_child_getpwnam(void **state)
+{
+    struct proxy_child_test_ctx *test_ctx =
+        talloc_get_type_abort(*state, struct proxy_child_test_ctx);
+    struct proxy_child_reply *reply;
+
+    reply = test_lookup(test_ctx, PROXY_ID_CHILD_GETPWNAM, TEST_USER, 0);
+    assert_int_equal(reply->status, NSS_STATUS_SUCCESS);
+    assert_non_null(reply->pwd);
+    assert_string_equal(reply->pwd->pw_name, TEST_USER);
+    assert_string_equal(reply->pwd->pw_passwd, "*");
+    assert_int_equal(reply->pwd->pw_uid, TEST_UID);
+    assert_int_equal(reply->pwd->pw_gid, TEST_GID);
+    assert_null(reply->pwd->pw_gecos);
+    assert_string_equal(reply->pwd->pw_dir, "/home/" TEST_USER);
+    assert_string_equal(reply->pwd->pw_shell, "/bin/sh");
+
+    /* The first call asked for a larger buffer. */
+    assert_int_equal(num_calls, 2);
+
+    talloc_free(reply);
+}
+
+static void test_proxy_child_notfound(void **state)
+{
+    struct proxy_child_test_ctx *test_ctx =
+        talloc_get_type_abort(*state, struct proxy_child_test_ctx);
+    struct proxy_child_reply *reply;
+
+    reply = test_lookup(test_ctx, PROXY_ID_CHILD_GETPWUID, "", 4242);
+    assert_int_equal(reply->status, NSS_STATUS_NOTFOUND);
+    assert_int_equal(reply->err, ENOENT);
+    assert_null(reply->pwd);
+
+    talloc_free(reply);
+}
+
+static void test_proxy_child_getgrgid(void **state)
+{
+    struct proxy_child_test_ctx *test_ctx =
+        talloc_get_type_abort(*state, struct proxy_child_test_ctx);
+    struct proxy_child_reply *reply;
+
+    reply = test_lookup(test_ctx, PROXY_ID_CHILD_GETGRGID, "", TEST_GID);
+    assert_int_equal(reply->status, NSS_STATUS_SUCCESS);
+    assert_non_null(reply->grp);
+    assert_string_equal(reply->grp->gr_name, TEST_GROUP);
+    assert_int_equal(reply->grp->gr_gid, TEST_GID);
+    assert_string_equal(reply->grp->gr_mem[0], "user1");
+    assert_string_equal(reply->grp->gr_mem[1], "user2");
+    assert_null(reply->grp->gr_mem[2]);
+
+    talloc_free(reply);
+}
+
+static void test_proxy_child_initgroups(void **state)
+{
+    struct proxy_child_test_ctx *test_ctx =
+        talloc_get_type_abort(*state, struct proxy_child_test_ctx);
+    struct proxy_child_reply *reply;
+
+    reply = test_lookup(test_ctx, PROXY_ID_CHILD_INITGROUPS, TEST_USER,
+                        TEST_GID);
+    assert_int_equal(reply->status, NSS_STATUS_SUCCESS);
+
+    /* The primary group is always added in advance. */
+    assert_int_equal(reply->num_gids, 3);
+    assert_int_equal(reply->gids[0], TEST_GID);
+    assert_int_equal(reply->gids[1], 3000);
+    assert_int_equal(reply->gids[2], 3001);
+
+    talloc_free(reply);
+}
+
+static char **test_members_new(TALLOC_CTX *mem_ctx, size_t num)
+{
+    char **members;
+    size_t i;
+
+    members = talloc_zero_array(mem_ctx, char *, num + 1);
+    assert_non_null(members);
+    for (i = 0; i < num; i++) {
+        members[i] = talloc_asprintf(members, "member-with-a-long-name-%06zu",
+                                     i);
+        assert_non_null(members[i]);
+    }
+
+    return members;
+}
+
+/* Entries larger than a frame are passed in several frames */
+static void test_proxy_child_large(void **state)
+{
+    struct proxy_child_test_ctx *test_ctx =
+        talloc_get_type_abort(*state, struct proxy_child_test_ctx);
+    struct proxy_child_reply *reply;
+    char **members;
+    size_t num;
+    size_t i;
+
+    num = SSS_CHILD_POOL_MAX_FRAME / 32 + 1;
+    members = test_members_new(test_ctx, num);
+    mock_members = members;
+
+    reply = test_lookup(test_ctx, PROXY_ID_CHILD_GETGRGID, "", TEST_GID);
+    assert_int_equal(reply->status, NSS_STATUS_SUCCESS);
+    assert_non_null(reply->grp);
+    for (i = 0; i < num; i++) {
+        assert_string_equal(reply->grp->gr_mem[i], members[i]);
+    }
+    assert_null(reply->grp->gr_mem[num]);
+
+    mock_members = test_members;
+    talloc_free(reply);
+    talloc_free(members);
+}
+
+/* An entry that does not fit into a reply fails the lookup */
+static void test_proxy_child_too_large(void **state)
+{
+    struct proxy_child_test_ctx *test_ctx =
+        talloc_get_type_abort(*state, struct proxy_child_test_ctx);
+    struct proxy_child_reply *reply;
+    char **members;
+
+    members = test_members_new(test_ctx, SSS_CHILD_POOL_MAX_REPLY / 32 + 1);
+    mock_members = members;
+
+    reply = test_lookup(test_ctx, PROXY_ID_CHILD_GETGRGID, "", TEST_GID);
+    assert_int_equal(reply->status, NSS_STATUS_TRYAGAIN);
+    assert_int_equal(reply->err, ERANGE);
+    assert_null(reply->grp);
+
+    mock_members = test_members;
+    talloc_free(reply);
+    talloc_free(members);
+}
+
+/* The worker serves any number of requests with the module loaded once and
+ * fails only requests it cannot handle, which makes it exit. */
+static void test_proxy_child_worker(void **state)
+{
+    struct proxy_child_test_ctx *test_ctx =
+        talloc_get_type_abort(*state, struct proxy_child_test_ctx);
+    struct proxy_child_reply *reply;
+    uint8_t *req_buf;
+    uint32_t req_len;
+    uint8_t *buf = NULL;
+    uint32_t len = 0;
+    errno_t ret;
+    int i;
+
+    for (i = 0; i < 3; i++) {
+        reply = test_lookup(test_ctx, PROXY_ID_CHILD_GETPWNAM, TEST_USER, 0);
+        assert_int_equal(reply->status, NSS_STATUS_SUCCESS);
+        assert_string_equal(reply->pwd->pw_name, TEST_USER);
+        talloc_free(reply);
+    }
+    assert_int_equal(num_calls, 6);
+
+    req_buf = test_request(test_ctx, PROXY_ID_CHILD_INITGROUPS + 1, "", 0,
+                           &req_len);
+    ret = proxy_id_child_worker_handler(test_ctx, req_buf, req_len,
+                                        &buf, &len, &test_ctx->ops);
+    assert_int_equal(ret, EINVAL);
+    talloc_free(req_buf);
+
+    /* A truncated request fails as well. */
+    req_buf = test_request(test_ctx, PROXY_ID_CHILD_GETPWNAM, TEST_USER, 0,
+                           &req_len);
+    ret = proxy_id_child_worker_handler(test_ctx, req_buf, req_len - 2,
+                                        &buf, &len, &test_ctx->ops);
+    assert_int_equal(ret, EINVAL);
+    talloc_free(req_buf);
+}
+
+/* sssd_be must not trust the reply of a misbehaving worker */
+static void test_proxy_child_parse_malformed(void **state)
+{
+    struct proxy_child_test_ctx *test_ctx =
+        talloc_get_type_abort(*state, struct proxy_child_test_ctx);
+    struct proxy_child_reply *reply;
+    uint8_t buf[5 * sizeof(uint32_t)];
+    size_t p;
+    errno_t ret;
+
+    /* Status only, the entry is missing. */
+    p = 0;
+    SAFEALIGN_SET_UINT32(&buf[p], NSS_STATUS_SUCCESS, &p);
+    SAFEALIGN_SET_UINT32(&buf[p], 0, &p);
+    ret = proxy_child_parse_reply(test_ctx, PROXY_ID_CHILD_GETPWNAM,
+                                  buf, p, &reply);
+    assert_int_equal(ret, EINVAL);
+
+    /* More GIDs than the reply contains. */
+    p = 0;
+    SAFEALIGN_SET_UINT32(&buf[p], NSS_STATUS_SUCCESS, &p);
+    SAFEALIGN_SET_UINT32(&buf[p], 0, &p);
+    SAFEALIGN_SET_UINT32(&buf[p], 100, &p);
+    SAFEALIGN_SET_UINT32(&buf[p], 3000, &p);
+    ret = proxy_child_parse_reply(test_ctx, PROXY_ID_CHILD_INITGROUPS,
+                                  buf, p, &reply);
+    assert_int_equal(ret, EINVAL);
+
+    /* A string longer than the reply. */
+    p = 0;
+    SAFEALIGN_SET_UINT32(&buf[p], NSS_STATUS_SUCCESS, &p);
+    SAFEALIGN_SET_UINT32(&buf[p], 0, &p);
+    SAFEALIGN_SET_UINT32(&buf[p], 1000, &p);
+    SAFEALIGN_SET_UINT32(&buf[p], 0, &p);
+    ret = proxy_child_parse_reply(test_ctx, PROXY_ID_CHILD_GETGRNAM,
+                                  buf, p, &reply);
+    assert_int_equal(ret, EINVAL);
+}
+
+int main(int argc, const char *argv[])
+{
+    int rv;
+    poptContext pc;
+    int opt;
+    struct poptOption long_options[] = {
+        POPT_AUTOHELP
+        SSSD_DEBUG_OPTS
+        POPT_TABLEEND
+    };
+
+    const struct CMUnitTest tests[] = {
+        cmocka_unit_test_setup_teardown(test_proxy_child_getpwnam,
+                                        test_proxy_child_setup,
+                                        test_proxy_child_teardown),
+        cmocka_unit_test_setup_teardown(test_proxy_child_notfound,
+                                        test_proxy_child_setup,
+                                        test_proxy_child_teardown),
+        cmocka_unit_test_setup_teardown(test_proxy_child_getgrgid,
+                                        test_proxy_child_setup,
+                                        test_proxy_child_teardown),
+        cmocka_unit_test_setup_teardown(test_proxy_child_initgroups,
+                                        test_proxy_child_setup,
+                                        test_proxy_child_teardown),
+        cmocka_unit_test_setup_teardown(test_proxy_child_large,
+                                        test_proxy_child_setup,
+                                        test_proxy_child_teardown),
+        cmocka_unit_test_setup_teardown(test_proxy_child_too_large,
+                                        test_proxy_child_setup,
+                                        test_proxy_child_teardown),
+        cmocka_unit_test_setup_teardown(test_proxy_child_worker,
+                                        test_proxy_child_setup,
+                                        test_proxy_child_teardown),
+        cmocka_unit_test_setup_teardown(test_proxy_child_parse_malformed,
+                                        test_proxy_child_setup,
+                                        test_proxy_child_teardown),
+    };
+
+    /* Set debug level to invalid value so we can deside if -d 0 was used. */
+    debug_level = SSSDBG_INVALID;
+
+    pc = poptGetContext(argv[0], argc, argv, long_options, 0);
+    while ((opt = poptGetNextOpt(pc)) != -1) {
+        switch (opt) {
+        default:
+            fprintf(stderr, "\nInvalid option %s: %s\n\n",
+                    poptBadOption(pc, 0), poptStrerror(opt));
+            poptPrintUsage(pc, stderr, 0);
+            return 1;
+        }
+    }
+    poptFreeContext(pc);
+
+    DEBUG_CLI_INIT(debug_level);
+
+    rv = cmocka_run_group_tests(tests, NULL, NULL);
+    return rv;
+}
@@ -334,6 +334,145 @@ void test_resolv_fake_srv(void **state)
     assert_int_equal(ret, ERR_OK);
 }
 
+void test_resolv_fake_srv_cached_done(struct tevent_req *req)
+{
+    errno_t ret;
+    TALLOC_CTX *tmp_ctx;
+    int status;
+    uint32_t ttl;
+    struct ares_srv_reply *srv_replies = NULL;
+    struct resolv_fake_ctx *test_ctx =
+        tevent_req_callback_data(req, struct resolv_fake_ctx);
+
+    tmp_ctx = talloc_new(test_ctx);
+    assert_non_null(tmp_ctx);
+
+    ret = resolv_getsrv_recv(tmp_ctx, req, &status, NULL,
+                             &srv_replies, &ttl);
+    assert_int_equal(ret, EOK);
+    assert_int_equal(status, ARES_SUCCESS);
+
+    assert_non_null(srv_replies);
+    assert_string_equal(srv_replies->host, "ldap.sssd.com");
+    assert_non_null(srv_replies->next);
+    assert_string_equal(srv_replies->next->host, "ldap2.sssd.com");
+    assert_null(srv_replies->next->next);
+
+    /* The remaining TTL is returned */
+    assert_true(ttl > 0);
+    assert_true(ttl <= 500);
+
+    talloc_free(tmp_ctx);
+    test_ev_done(test_ctx->ctx, EOK);
+}
+
+void test_resolv_fake_srv_cache(void **state)
+{
+    int ret;
+    struct tevent_req *req;
+    struct resolv_cache_stats stats;
+    struct resolv_fake_ctx *test_ctx =
+        talloc_get_type(*state, struct resolv_fake_ctx);
+
+    unsigned char *buf;
+    size_t buflen;
+
+    struct srv_rrdata rr[2];
+
+    rr[0].prio = 1;
+    rr[0].port = 389;
+    rr[0].weight = 40;
+    rr[0].ttl = 600;
+    rr[0].hostname = "ldap.sssd.com";
+
+    rr[1].prio = 1;
+    rr[1].port = 389;
+    rr[1].weight = 60;
+    rr[1].ttl = 500;
+    rr[1].hostname = "ldap2.sssd.com";
+
+    resolv_set_cache_max_ttl(test_ctx->resolv, 3600);
+
+    buf = create_srv_buffer(test_ctx, TEST_SRV_QUERY, rr, 2, &buflen);
+    assert_non_null(buf);
+    mock_ares_query(0, 0, buf, buflen);
+
+    req = resolv_getsrv_send(test_ctx, test_ctx->ctx->ev,
+                             test_ctx->resolv, TEST_SRV_QUERY);
+    assert_non_null(req);
+    tevent_req_set_callback(req, test_resolv_fake_srv_done, test_ctx);
+
+    ret = test_ev_loop(test_ctx->ctx);
+    assert_int_equal(ret, ERR_OK);
+
+    /* The second query must not reach c-ares */
+    test_ctx->ctx->done = false;
+
+    req = resolv_getsrv_send(test_ctx, test_ctx->ctx->ev,
+                             test_ctx->resolv, TEST_SRV_QUERY);
+    assert_non_null(req);
+    tevent_req_set_callback(req, test_resolv_fake_srv_cached_done, test_ctx);
+
+    ret = test_ev_loop(test_ctx->ctx);
+    assert_int_equal(ret, ERR_OK);
+
+    resolv_get_cache_stats(test_ctx->resolv, &stats);
+    assert_int_equal(stats.hits, 1);
+    assert_int_equal(stats.negative_hits, 0);
+    assert_int_equal(stats.misses, 1);
+    assert_int_equal(stats.entries, 1);
+}
+
+void test_resolv_fake_srv_negative_done(struct tevent_req *req)
+{
+    errno_t ret;
+    int status;
+    struct ares_srv_reply *srv_replies = NULL;
+    struct resolv_fake_ctx *test_ctx =
+        tevent_req_callback_data(req, struct resolv_fake_ctx);
+
+    ret = resolv_getsrv_recv(test_ctx, req, &status, NULL,
+                             &srv_replies, NULL);
+    assert_int_not_equal(ret, EOK);
+    assert_int_equal(status, ARES_ENOTFOUND);
+    assert_null(srv_replies);
+
+    test_ev_done(test_ctx->ctx, EOK);
+}
+
+void test_resolv_fake_srv_negative_cache(void **state)
+{
+    int ret;
+    int i;
+    struct tevent_req *req;
+    struct resolv_cache_stats stats;
+    struct resolv_fake_ctx *test_ctx =
+        talloc_get_type(*state, struct resolv_fake_ctx);
+
+    resolv_set_cache_max_ttl(test_ctx->resolv, 3600);
+
+    /* Only the first query reaches c-ares */
+    mock_ares_query(ARES_ENOTFOUND, 0, NULL, 0);
+
+    for (i = 0; i < 2; i++) {
+        test_ctx->ctx->done = false;
+
+        req = resolv_getsrv_send(test_ctx, test_ctx->ctx->ev,
+                                 test_ctx->resolv, TEST_SRV_QUERY);
+        assert_non_null(req);
+        tevent_req_set_callback(req, test_resolv_fake_srv_negative_done,
+                                test_ctx);
+
+        ret = test_ev_loop(test_ctx->ctx);
+        assert_int_equal(ret, ERR_OK);
+    }
+
+    resolv_get_cache_stats(test_ctx->resolv, &stats);
+    assert_int_equal(stats.hits, 0);
+    assert_int_equal(stats.negative_hits, 1);
+    assert_int_equal(stats.misses, 1);
+}
+
 void test_resolv_is_address(void **state)
 {
     bool ret;
@@ -372,6 +511,12 @@ int main(int argc, const char *argv[])
         cmocka_unit_test_setup_teardown(test_resolv_fake_srv,
                                         test_resolv_fake_setup,
                                         test_resolv_fake_teardown),
+        cmocka_unit_test_setup_teardown(test_resolv_fake_srv_cache,
+                                        test_resolv_fake_setup,
+                                        test_resolv_fake_teardown),
+        cmocka_unit_test_setup_teardown(test_resolv_fake_srv_negative_cache,
+                                        test_resolv_fake_setup,
+                                        test_resolv_fake_teardown),
         cmocka_unit_test(test_resolv_is_address),
     };
 
@@ -0,0 +1,637 @@
+/*
+    SSSD
+
+    Unit tests of the packed transport
+
+    Copyright (C) 2016 Red Hat
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <talloc.h>
+#include <tevent.h>
+#include <errno.h>
+#include <popt.h>
+#include <unistd.h>
+#include <poll.h>
+#include <sys/stat.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/time.h>
+
+#include "sbus/sbus_packed.h"
+#include "tests/cmocka/common_mock.h"
+#include "tests/common.h"
+
+#define TESTS_PATH "tp_" BASE_FILE_STEM
+#define TEST_SOCKET TESTS_PATH "/packed_socket"
+
+#define OP_ECHO 1
+#define OP_FAIL 2
+#define OP_HOLD 3
+#define OP_UNKNOWN 99
+
+struct packed_test_ctx {
+    struct tevent_context *ev;
+    struct sbus_packed_server *server;
+    struct sbus_packed_conn *client;
+
+    /* Request kept by the OP_HOLD handler. */
+    struct sbus_packed_request *held;
+    int num_calls;
+
+    bool done;
+    errno_t error;
+    struct sbus_packed_buf *reply;
+    bool disconnected;
+};
+
+static errno_t test_echo_handler(struct sbus_packed_request *req, void *data)
+{
+    struct packed_test_ctx *test_ctx;
+    struct sbus_packed_buf *reply;
+    const char *str;
+    uint32_t num;
+    errno_t ret;
+
+    test_ctx = talloc_get_type_abort(data, struct packed_test_ctx);
+    test_ctx->num_calls++;
+
+    ret = sbus_packed_get_string(req->body, &str);
+    if (ret != EOK) {
+        return ret;
+    }
+
+    ret = sbus_packed_get_uint32(req->body, &num);
+    if (ret != EOK) {
+        return ret;
+    }
+
+    reply = sbus_packed_buf_new(req);
+    if (reply == NULL) {
+        return ENOMEM;
+    }
+
+    ret = sbus_packed_put_uint32(reply, num + 1);
+    if (ret != EOK) {
+        return ret;
+    }
+
+    ret = sbus_packed_put_string(reply, str);
+    if (ret != EOK) {
+        return ret;
+    }
+
+    return sbus_packed_request_finish(req, reply);
+}
+
+static errno_t test_fail_handler(struct sbus_packed_request *req, void *data)
+{
+    return EPERM;
+}
+
+static int test_held_destructor(struct packed_test_ctx **ptr)
+{
+    (*ptr)->held = NULL;
+    return 0;
+}
+
+static errno_t test_hold_handler(struct sbus_packed_request *req, void *data)
+{
+    struct packed_test_ctx **marker;
+
+    /* Forget the request once it is replied or its connection is freed. */
+    marker = talloc(req, struct packed_test_ctx *);
+    if (marker == NULL) {
+        return ENOMEM;
+    }
+
+    *marker = talloc_get_type_abort(data, struct packed_test_ctx);
+    (*marker)->held = req;
+    talloc_set_destructor(marker, test_held_destructor);
+
+    return EOK;
+}
+
+static const struct sbus_packed_method test_methods[] = {
+    {OP_ECHO, test_echo_handler},
+    {OP_FAIL, test_fail_handler},
+    {OP_HOLD, test_hold_handler},
+    {0, NULL}
+};
+
+static errno_t test_conn_init(struct sbus_packed_conn *conn, void *pvt)
+{
+    sbus_packed_conn_set_data(conn, pvt);
+    return EOK;
+}
+
+static void test_wait(struct packed_test_ctx *test_ctx, bool *flag)
+{
+    while (!*flag) {
+        assert_int_equal(tevent_loop_once(test_ctx->ev), 0);
+    }
+}
+
+static int test_packed_setup(void **state)
+{
+    struct packed_test_ctx *test_ctx;
+    errno_t ret;
+
+    assert_true(leak_check_setup());
+
+    ret = mkdir(TESTS_PATH, 0775);
+    assert_true(ret == 0 || errno == EEXIST);
+
+    test_ctx = talloc_zero(global_talloc_context, struct packed_test_ctx);
+    assert_non_null(test_ctx);
+
+    test_ctx->ev = tevent_context_init(test_ctx);
+    assert_non_null(test_ctx->ev);
+
+    ret = sbus_packed_server_create(test_ctx, test_ctx->ev, TEST_SOCKET,
+                                    geteuid(), getegid(), test_methods,
+                                    test_conn_init, test_ctx,
+                                    &test_ctx->server);
+    assert_int_equal(ret, EOK);
+
+    ret = sbus_packed_connect(test_ctx, test_ctx->ev, TEST_SOCKET,
+                              &test_ctx->client);
+    assert_int_equal(ret, EOK);
+
+    *state = test_ctx;
+    return 0;
+}
+
+static int test_packed_teardown(void **state)
+{
+    struct packed_test_ctx *test_ctx;
+
+    test_ctx = talloc_get_type_abort(*state, struct packed_test_ctx);
+
+    talloc_free(test_ctx);
+    rmdir(TESTS_PATH);
+    assert_true(leak_check_teardown());
+    return 0;
+}
+
+static void test_call_done(struct tevent_req *req)
+{
+    struct packed_test_ctx *test_ctx;
+
+    test_ctx = tevent_req_callback_data(req, struct packed_test_ctx);
+
+    test_ctx->error = sbus_packed_call_recv(test_ctx, req, &test_ctx->reply);
+    test_ctx->done = true;
+    talloc_free(req);
+}
+
+static void test_call(struct packed_test_ctx *test_ctx,
+                      uint16_t opcode,
+                      const char *str,
+                      uint32_t num,
+                      int timeout)
+{
+    struct sbus_packed_buf *body;
+    struct tevent_req *req;
+    errno_t ret;
+
+    body = sbus_packed_buf_new(test_ctx);
+    assert_non_null(body);
+
+    ret = sbus_packed_put_string(body, str);
+    assert_int_equal(ret, EOK);
+
+    ret = sbus_packed_put_uint32(body, num);
+    assert_int_equal(ret, EOK);
+
+    test_ctx->done = false;
+    test_ctx->error = EOK;
+    talloc_zfree(test_ctx->reply);
+
+    req = sbus_packed_call_send(test_ctx, test_ctx->client, opcode, body,
+                                timeout);
+    assert_non_null(req);
+    tevent_req_set_callback(req, test_call_done, test_ctx);
+    talloc_free(body);
+}
+
+static void test_disconnected(struct sbus_packed_conn *conn, void *pvt)
+{
+    struct packed_test_ctx *test_ctx;
+
+    test_ctx = talloc_get_type_abort(pvt, struct packed_test_ctx);
+    test_ctx->disconnected = true;
+}
+
+/* Connects to the server without the client code so that the frames can
+ * be written by the test. */
+static int test_raw_connect(void)
+{
+    struct sockaddr_un addr;
+    struct timeval tv = { 5, 0 };
+    int fd;
+    int ret;
+
+    fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    assert_true(fd >= 0);
+
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strncpy(addr.sun_path, TEST_SOCKET, sizeof(addr.sun_path) - 1);
+
+    ret = connect(fd, (struct sockaddr *)&addr, sizeof(addr));
+    assert_int_equal(ret, 0);
+
+    /* Do not hang if the server does not reply. */
+    ret = setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+    assert_int_equal(ret, 0);
+
+    return fd;
+}
+
+/* Run the server until it sends something to the raw socket or closes it. */
+static void test_raw_wait(struct packed_test_ctx *test_ctx, int fd)
+{
+    struct pollfd pfd = { fd, POLLIN, 0 };
+
+    while (poll(&pfd, 1, 0) == 0) {
+        assert_int_equal(tevent_loop_once(test_ctx->ev), 0);
+    }
+}
+
+static size_t test_raw_frame(uint8_t *frame,
+                             uint32_t serial,
+                             uint16_t opcode,
+                             uint32_t body_len,
+                             const uint8_t *body)
+{
+    uint16_t status = 0;
+    uint64_t trace_id = 0;
+    size_t c = 0;
+
+    SAFEALIGN_SETMEM_UINT32(frame, body_len, &c);
+    SAFEALIGN_SETMEM_UINT32(frame + c, serial, &c);
+    SAFEALIGN_SETMEM_UINT16(frame + c, opcode, &c);
+    SAFEALIGN_SETMEM_UINT16(frame + c, status, &c);
+    SAFEALIGN_SETMEM_VALUE(frame + c, trace_id, uint64_t, &c);
+    if (body_len > 0 && body != NULL) {
+        safealign_memcpy(frame + c, body, body_len, &c);
+    }
+
+    return c;
+}
+
+static void test_raw_read_reply(int fd,
+                                uint32_t exp_serial,
+                                uint16_t exp_opcode,
+                                uint16_t exp_status)
+{
+    uint8_t header[SBUS_PACKED_HEADER_SIZE];
+    uint8_t body[64];
+    uint32_t body_len;
+    uint32_t serial;
+    uint16_t opcode;
+    uint16_t status;
+    size_t c = 0;
+    ssize_t len;
+
+    len = sss_atomic_read_s(fd, header, sizeof(header));
+    assert_int_equal(len, sizeof(header));
+
+    SAFEALIGN_COPY_UINT32(&body_len, header, &c);
+    SAFEALIGN_COPY_UINT32(&serial, header + c, &c);
+    SAFEALIGN_COPY_UINT16(&opcode, header + c, &c);
+    SAFEALIGN_COPY_UINT16(&status, header + c, &c);
+
+    assert_int_equal(serial, exp_serial);
+    assert_int_equal(opcode, exp_opcode);
+    assert_int_equal(status, exp_status);
+    assert_true(body_len <= sizeof(body));
+
+    len = sss_atomic_read_s(fd, body, body_len);
+    assert_int_equal(len, body_len);
+}
+
+static void test_body(struct packed_test_ctx *test_ctx,
+                      uint8_t **_body,
+                      uint32_t *_len)
+{
+    struct sbus_packed_buf *body;
+
+    body = sbus_packed_buf_new(test_ctx);
+    assert_non_null(body);
+    assert_int_equal(sbus_packed_put_string(body, "abc"), EOK);
+    assert_int_equal(sbus_packed_put_uint32(body, 41), EOK);
+
+    *_body = sbus_packed_buf_data(body);
+    *_len = sbus_packed_buf_size(body);
+}
+
+void test_sbus_packed_dispatch(void **state)
+{
+    struct packed_test_ctx *test_ctx;
+    const char *str;
+    uint32_t num;
+
+    test_ctx = talloc_get_type_abort(*state, struct packed_test_ctx);
+
+    test_call(test_ctx, OP_ECHO, "hello", 41, 5000);
+    test_wait(test_ctx, &test_ctx->done);
+    assert_int_equal(test_ctx->error, EOK);
+    assert_int_equal(sbus_packed_get_uint32(test_ctx->reply, &num), EOK);
+    assert_int_equal(num, 42);
+    assert_int_equal(sbus_packed_get_string(test_ctx->reply, &str), EOK);
+    assert_string_equal(str, "hello");
+
+    /* Nothing more in the reply. */
+    assert_int_equal(sbus_packed_get_uint32(test_ctx->reply, &num), EBADMSG);
+
+    /* The error returned by the handler is sent to the caller. */
+    test_call(test_ctx, OP_FAIL, "hello", 1, 5000);
+    test_wait(test_ctx, &test_ctx->done);
+    assert_int_equal(test_ctx->error, EPERM);
+
+    test_call(test_ctx, OP_UNKNOWN, "hello", 1, 5000);
+    test_wait(test_ctx, &test_ctx->done);
+    assert_int_equal(test_ctx->error, ENOTSUP);
+
+    assert_int_equal(test_ctx->num_calls, 1);
+}
+
+void test_sbus_packed_concurrent(void **state)
+{
+    struct packed_test_ctx *test_ctx;
+    struct sbus_packed_buf *body;
+    struct tevent_req *req[3];
+    struct sbus_packed_buf *reply;
+    uint32_t num;
+    int i;
+
+    test_ctx = talloc_get_type_abort(*state, struct packed_test_ctx);
+
+    /* Replies are matched with the calls by serial, even if they are
+     * answered in a different order. */
+    body = sbus_packed_buf_new(test_ctx);
+    assert_non_null(body);
+    assert_int_equal(sbus_packed_put_string(body, "x"), EOK);
+    assert_int_equal(sbus_packed_put_uint32(body, 0), EOK);
+
+    req[0] = sbus_packed_call_send(test_ctx, test_ctx->client, OP_HOLD,
+                                   body, 5000);
+    assert_non_null(req[0]);
+
+    for (i = 1; i < 3; i++) {
+        talloc_zfree(body);
+        body = sbus_packed_buf_new(test_ctx);
+        assert_non_null(body);
+        assert_int_equal(sbus_packed_put_string(body, "x"), EOK);
+        assert_int_equal(sbus_packed_put_uint32(body, i * 10), EOK);
+
+        req[i] = sbus_packed_call_send(test_ctx, test_ctx->client, OP_ECHO,
+                                       body, 5000);
+        assert_non_null(req[i]);
+    }
+    talloc_free(body);
+
+    for (i = 1; i < 3; i++) {
+        while (tevent_req_is_in_progress(req[i])) {
+            assert_int_equal(tevent_loop_once(test_ctx->ev), 0);
+        }
+
+        assert_int_equal(sbus_packed_call_recv(test_ctx, req[i], &reply), EOK);
+        assert_int_equal(sbus_packed_get_uint32(reply, &num), EOK);
+        assert_int_equal(num, i * 10 + 1);
+        talloc_free(reply);
+        talloc_free(req[i]);
+    }
+
+    assert_true(tevent_req_is_in_progress(req[0]));
+    assert_non_null(test_ctx->held);
+
+    reply = sbus_packed_buf_new(test_ctx);
+    assert_non_null(reply);
+    assert_int_equal(sbus_packed_put_uint32(reply, 7), EOK);
+    assert_int_equal(sbus_packed_request_finish(test_ctx->held, reply), EOK);
+    talloc_free(reply);
+
+    while (tevent_req_is_in_progress(req[0])) {
+        assert_int_equal(tevent_loop_once(test_ctx->ev), 0);
+    }
+
+    assert_int_equal(sbus_packed_call_recv(test_ctx, req[0], &reply), EOK);
+    assert_int_equal(sbus_packed_get_uint32(reply, &num), EOK);
+    assert_int_equal(num, 7);
+    talloc_free(reply);
+    talloc_free(req[0]);
+}
+
+void test_sbus_packed_partial_frame(void **state)
+{
+    struct packed_test_ctx *test_ctx;
+    uint8_t frame[256];
+    uint8_t *body;
+    uint32_t body_len;
+    size_t frame_len;
+    ssize_t len;
+    size_t i;
+    int fd;
+
+    test_ctx = talloc_get_type_abort(*state, struct packed_test_ctx);
+
+    fd = test_raw_connect();
+    test_body(test_ctx, &body, &body_len);
+    frame_len = test_raw_frame(frame, 5, OP_ECHO, body_len, body);
+
+    /* The server must not dispatch anything until the whole frame,
+     * header and body, has arrived. */
+    for (i = 0; i < frame_len; i++) {
+        assert_int_equal(test_ctx->num_calls, 0);
+
+        len = sss_atomic_write_s(fd, frame + i, 1);
+        assert_int_equal(len, 1);
+        assert_int_equal(tevent_loop_once(test_ctx->ev), 0);
+    }
+
+    test_raw_wait(test_ctx, fd);
+    assert_int_equal(test_ctx->num_calls, 1);
+    test_raw_read_reply(fd, 5, OP_ECHO, SBUS_PACKED_STATUS_OK);
+
+    close(fd);
+}
+
+void test_sbus_packed_multiple_frames(void **state)
+{
+    struct packed_test_ctx *test_ctx;
+    uint8_t frame[512];
+    uint8_t *body;
+    uint32_t body_len;
+    size_t frame_len;
+    ssize_t len;
+    int fd;
+
+    test_ctx = talloc_get_type_abort(*state, struct packed_test_ctx);
+
+    fd = test_raw_connect();
+    test_body(test_ctx, &body, &body_len);
+
+    /* Two frames written at once are dispatched one by one. */
+    frame_len = test_raw_frame(frame, 1, OP_ECHO, body_len, body);
+    frame_len += test_raw_frame(frame + frame_len, 2, OP_UNKNOWN, 0, NULL);
+
+    len = sss_atomic_write_s(fd, frame, frame_len);
+    assert_int_equal(len, frame_len);
+
+    test_raw_wait(test_ctx, fd);
+    test_raw_read_reply(fd, 1, OP_ECHO, SBUS_PACKED_STATUS_OK);
+
+    test_raw_wait(test_ctx, fd);
+    test_raw_read_reply(fd, 2, OP_UNKNOWN, SBUS_PACKED_STATUS_NOTSUP);
+
+    close(fd);
+}
+
+void test_sbus_packed_oversized_frame(void **state)
+{
+    struct packed_test_ctx *test_ctx;
+    uint8_t frame[SBUS_PACKED_HEADER_SIZE];
+    uint8_t buf[1];
+    ssize_t len;
+    int fd;
+
+    test_ctx = talloc_get_type_abort(*state, struct packed_test_ctx);
+
+    fd = test_raw_connect();
+
+    test_raw_frame(frame, 1, OP_ECHO, SBUS_PACKED_MAX_BODY + 1, NULL);
+    len = sss_atomic_write_s(fd, frame, sizeof(frame));
+    assert_int_equal(len, sizeof(frame));
+
+    /* The server drops the connection instead of allocating the body. */
+    test_raw_wait(test_ctx, fd);
+    len = read(fd, buf, sizeof(buf));
+    assert_int_equal(len, 0);
+    assert_int_equal(test_ctx->num_calls, 0);
+
+    close(fd);
+}
+
+void test_sbus_packed_disconnect(void **state)
+{
+    struct packed_test_ctx *test_ctx;
+    struct sbus_packed_request *held;
+
+    test_ctx = talloc_get_type_abort(*state, struct packed_test_ctx);
+
+    sbus_packed_conn_set_disconnect_fn(test_ctx->client, test_disconnected,
+                                       test_ctx);
+
+    test_call(test_ctx, OP_HOLD, "x", 0, 5000);
+    while (test_ctx->held == NULL) {
+        assert_int_equal(tevent_loop_once(test_ctx->ev), 0);
+    }
+
+    /* Close the server side of the connection while the call waits. */
+    held = test_ctx->held;
+    talloc_free(held->conn);
+    assert_null(test_ctx->held);
+
+    test_wait(test_ctx, &test_ctx->done);
+    assert_int_equal(test_ctx->error, ERR_OFFLINE);
+    assert_true(test_ctx->disconnected);
+
+    /* New calls fail right away. */
+    test_call(test_ctx, OP_ECHO, "x", 0, 5000);
+    test_wait(test_ctx, &test_ctx->done);
+    assert_int_equal(test_ctx->error, ERR_OFFLINE);
+}
+
+void test_sbus_packed_timeout(void **state)
+{
+    struct packed_test_ctx *test_ctx;
+    struct sbus_packed_buf *reply;
+
+    test_ctx = talloc_get_type_abort(*state, struct packed_test_ctx);
+
+    test_call(test_ctx, OP_HOLD, "x", 0, 10);
+    test_wait(test_ctx, &test_ctx->done);
+    assert_int_equal(test_ctx->error, ETIMEDOUT);
+    assert_non_null(test_ctx->held);
+
+    /* A late reply is dropped and does not break the connection. */
+    reply = sbus_packed_buf_new(test_ctx);
+    assert_non_null(reply);
+    assert_int_equal(sbus_packed_request_finish(test_ctx->held, reply), EOK);
+    talloc_free(reply);
+    assert_null(test_ctx->held);
+
+    test_call(test_ctx, OP_ECHO, "x", 1, 5000);
+    test_wait(test_ctx, &test_ctx->done);
+    assert_int_equal(test_ctx->error, EOK);
+}
+
+int main(int argc, const char *argv[])
+{
+    poptContext pc;
+    int opt;
+    struct poptOption long_options[] = {
+        POPT_AUTOHELP
+        SSSD_DEBUG_OPTS
+        POPT_TABLEEND
+    };
+
+    const struct CMUnitTest tests[] = {
+        cmocka_unit_test_setup_teardown(test_sbus_packed_dispatch,
+                                        test_packed_setup,
+                                        test_packed_teardown),
+        cmocka_unit_test_setup_teardown(test_sbus_packed_concurrent,
+                                        test_packed_setup,
+                                        test_packed_teardown),
+        cmocka_unit_test_setup_teardown(test_sbus_packed_partial_frame,
+                                        test_packed_setup,
+                                        test_packed_teardown),
+        cmocka_unit_test_setup_teardown(test_sbus_packed_multiple_frames,
+                                        test_packed_setup,
+                                        test_packed_teardown),
+        cmocka_unit_test_setup_teardown(test_sbus_packed_oversized_frame,
+                                        test_packed_setup,
+                                        test_packed_teardown),
+        cmocka_unit_test_setup_teardown(test_sbus_packed_disconnect,
+                                        test_packed_setup,
+                                        test_packed_teardown),
+        cmocka_unit_test_setup_teardown(test_sbus_packed_timeout,
+                                        test_packed_setup,
+                                        test_packed_teardown),
+    };
+
+    /* Set debug level to invalid value so we can deside if -d 0 was used. */
+    debug_level = SSSDBG_INVALID;
+
+    pc = poptGetContext(argv[0], argc, argv, long_options, 0);
+    while((opt = poptGetNextOpt(pc)) != -1) {
+        switch(opt) {
+        default:
+            fprintf(stderr, "\nInvalid option %s: %s\n\n",
+                    poptBadOption(pc, 0), poptStrerror(opt));
+            poptPrintUsage(pc, stderr, 0);
+            return 1;
+        }
+    }
+    poptFreeContext(pc);
+
+    DEBUG_CLI_INIT(debug_level);
+
+    tests_set_cwd();
+    return cmocka_run_group_tests(tests, NULL, NULL);
+}
@@ -0,0 +1,482 @@
+/*
+    Copyright (C) 2016 Red Hat
+
+    SSSD tests - incremental maintenance of the SSH known_hosts file
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <talloc.h>
+#include <tevent.h>
+#include <errno.h>
+#include <popt.h>
+#include <sys/stat.h>
+
+#define TESTS_PATH "tp_" BASE_FILE_STEM
+#define TEST_CONF_DB "test_ssh_known_hosts_conf.ldb"
+#define TEST_DOM_NAME "ssh_test"
+#define TEST_ID_PROVIDER "ldap"
+
+#define SSS_SSH_KNOWN_HOSTS_PATH TESTS_PATH"/known_hosts"
+#define SSS_SSH_KNOWN_HOSTS_TEMP_TMPL TESTS_PATH"/.known_hosts.XXXXXX"
+
+/* In order to access the known_hosts handling */
+#include "responder/ssh/sshsrv_cmd.c"
+
+#include "tests/cmocka/common_mock.h"
+#include "tests/cmocka/common_mock_resp.h"
+
+#define TEST_KEY1 "ssh-ed25519 AAAAC3NzaC1lZDI1NTE5AAAAIKey1"
+#define TEST_KEY2 "ssh-ed25519 AAAAC3NzaC1lZDI1NTE5AAAAIKey2"
+#define TEST_KEY3 "ssh-ed25519 AAAAC3NzaC1lZDI1NTE5AAAAIKey3"
+
+#define TEST_KNOWN_HOSTS_TIMEOUT 180
+
+struct ssh_known_hosts_test_ctx {
+    struct sss_test_ctx *tctx;
+    struct resp_ctx *rctx;
+    struct ssh_ctx *ssh_ctx;
+};
+
+static int test_known_hosts_setup(void **state)
+{
+    struct ssh_known_hosts_test_ctx *test_ctx;
+
+    test_dom_suite_setup(TESTS_PATH);
+
+    test_ctx = talloc_zero(NULL, struct ssh_known_hosts_test_ctx);
+    assert_non_null(test_ctx);
+
+    test_ctx->tctx = create_dom_test_ctx(test_ctx, TESTS_PATH, TEST_CONF_DB,
+                                         TEST_DOM_NAME, TEST_ID_PROVIDER,
+                                         NULL);
+    assert_non_null(test_ctx->tctx);
+
+    test_ctx->ssh_ctx = talloc_zero(test_ctx, struct ssh_ctx);
+    assert_non_null(test_ctx->ssh_ctx);
+    test_ctx->ssh_ctx->known_hosts_timeout = TEST_KNOWN_HOSTS_TIMEOUT;
+
+    test_ctx->rctx = mock_rctx(test_ctx, test_ctx->tctx->ev,
+                               test_ctx->tctx->dom, test_ctx->ssh_ctx);
+    assert_non_null(test_ctx->rctx);
+    test_ctx->ssh_ctx->rctx = test_ctx->rctx;
+
+    *state = test_ctx;
+    return 0;
+}
+
+static int test_known_hosts_teardown(void **state)
+{
+    struct ssh_known_hosts_test_ctx *test_ctx =
+        talloc_get_type_abort(*state, struct ssh_known_hosts_test_ctx);
+
+    talloc_free(test_ctx);
+
+    unlink(SSS_SSH_KNOWN_HOSTS_PATH);
+    test_dom_suite_cleanup(TESTS_PATH, TEST_CONF_DB, TEST_DOM_NAME);
+    return 0;
+}
+
+/* Stores the host the same way as the back end and marks it as looked up
+ * at the given time. */
+static void test_store_host(struct ssh_known_hosts_test_ctx *test_ctx,
+                            const char *name,
+                            const char *alias,
+                            const char **keys,
+                            time_t now)
+{
+    struct sysdb_attrs *attrs;
+    char *b64;
+    errno_t ret;
+    int i;
+
+    attrs = sysdb_new_attrs(test_ctx);
+    assert_non_null(attrs);
+
+    for (i = 0; keys[i] != NULL; i++) {
+        b64 = sss_base64_encode(attrs, (const uint8_t *)keys[i],
+                                strlen(keys[i]));
+        assert_non_null(b64);
+
+        ret = sysdb_attrs_add_string(attrs, SYSDB_SSH_PUBKEY, b64);
+        assert_int_equal(ret, EOK);
+    }
+
+    ret = sysdb_store_ssh_host(test_ctx->tctx->dom, name, alias, 0, now,
+                               attrs);
+    assert_int_equal(ret, EOK);
+
+    ret = sysdb_update_ssh_known_host_expire(test_ctx->tctx->dom, name, now,
+                                             TEST_KNOWN_HOSTS_TIMEOUT);
+    assert_int_equal(ret, EOK);
+
+    talloc_free(attrs);
+}
+
+static char *test_read_known_hosts(TALLOC_CTX *mem_ctx)
+{
+    char buf[4096];
+    size_t len;
+    FILE *f;
+
+    f = fopen(SSS_SSH_KNOWN_HOSTS_PATH, "r");
+    assert_non_null(f);
+
+    len = fread(buf, 1, sizeof(buf) - 1, f);
+    assert_false(ferror(f));
+    fclose(f);
+
+    return talloc_strndup(mem_ctx, buf, len);
+}
+
+/* Appends keep the file, rewrites replace it */
+static ino_t test_known_hosts_inode(void)
+{
+    struct stat st;
+    int ret;
+
+    ret = stat(SSS_SSH_KNOWN_HOSTS_PATH, &st);
+    assert_int_equal(ret, 0);
+
+    return st.st_ino;
+}
+
+static void test_known_hosts_append(void **state)
+{
+    struct ssh_known_hosts_test_ctx *test_ctx =
+        talloc_get_type_abort(*state, struct ssh_known_hosts_test_ctx);
+    const char *keys1[] = { TEST_KEY1, NULL };
+    const char *keys2[] = { TEST_KEY2, NULL };
+    const char *keys13[] = { TEST_KEY1, TEST_KEY3, NULL };
+    time_t now = time(NULL);
+    char *content;
+    ino_t ino;
+    errno_t ret;
+
+    test_store_host(test_ctx, "host1", NULL, keys1, now);
+
+    ret = ssh_known_hosts_write_all(test_ctx->ssh_ctx, now);
+    assert_int_equal(ret, EOK);
+    assert_non_null(test_ctx->ssh_ctx->known_hosts);
+
+    content = test_read_known_hosts(test_ctx);
+    assert_string_equal(content, "host1 " TEST_KEY1 "\n");
+    ino = test_known_hosts_inode();
+
+    /* A new host is appended. */
+    test_store_host(test_ctx, "host2", NULL, keys2, now);
+    ret = ssh_known_hosts_update_host(test_ctx->ssh_ctx, test_ctx->tctx->dom,
+                                      "host2", now);
+    assert_int_equal(ret, EOK);
+
+    content = test_read_known_hosts(test_ctx);
+    assert_string_equal(content, "host1 " TEST_KEY1 "\n"
+                                 "host2 " TEST_KEY2 "\n");
+    assert_int_equal(test_known_hosts_inode(), ino);
+
+    /* Only the added key of a known host is appended. */
+    test_store_host(test_ctx, "host1", NULL, keys13, now);
+    ret = ssh_known_hosts_update_host(test_ctx->ssh_ctx, test_ctx->tctx->dom,
+                                      "host1", now);
+    assert_int_equal(ret, EOK);
+
+    content = test_read_known_hosts(test_ctx);
+    assert_string_equal(content, "host1 " TEST_KEY1 "\n"
+                                 "host2 " TEST_KEY2 "\n"
+                                 "host1 " TEST_KEY3 "\n");
+    assert_int_equal(test_known_hosts_inode(), ino);
+
+    /* Nothing changed, nothing is written. */
+    ret = ssh_known_hosts_update_host(test_ctx->ssh_ctx, test_ctx->tctx->dom,
+                                      "host1", now);
+    assert_int_equal(ret, EOK);
+
+    content = test_read_known_hosts(test_ctx);
+    assert_string_equal(content, "host1 " TEST_KEY1 "\n"
+                                 "host2 " TEST_KEY2 "\n"
+                                 "host1 " TEST_KEY3 "\n");
+    assert_int_equal(test_known_hosts_inode(), ino);
+}
+
+static void test_known_hosts_rewrite(void **state)
+{
+    struct ssh_known_hosts_test_ctx *test_ctx =
+        talloc_get_type_abort(*state, struct ssh_known_hosts_test_ctx);
+    const char *keys12[] = { TEST_KEY1, TEST_KEY2, NULL };
+    const char *keys2[] = { TEST_KEY2, NULL };
+    const char *keys3[] = { TEST_KEY3, NULL };
+    time_t now = time(NULL);
+    char *content;
+    ino_t ino;
+    errno_t ret;
+
+    test_store_host(test_ctx, "host1", NULL, keys12, now);
+    test_store_host(test_ctx, "host2", NULL, keys3, now);
+
+    ret = ssh_known_hosts_write_all(test_ctx->ssh_ctx, now);
+    assert_int_equal(ret, EOK);
+    ino = test_known_hosts_inode();
+
+    /* A removed key must not stay trusted. */
+    test_store_host(test_ctx, "host1", NULL, keys2, now);
+    ret = ssh_known_hosts_update_host(test_ctx->ssh_ctx, test_ctx->tctx->dom,
+                                      "host1", now);
+    assert_int_equal(ret, EOK);
+
+    content = test_read_known_hosts(test_ctx);
+    assert_null(strstr(content, TEST_KEY1));
+    assert_non_null(strstr(content, "host1 " TEST_KEY2 "\n"));
+    assert_non_null(strstr(content, "host2 " TEST_KEY3 "\n"));
+    assert_int_not_equal(test_known_hosts_inode(), ino);
+    ino = test_known_hosts_inode();
+
+    /* So must a key of a name that is no longer an alias of the host, a
+     * changed list of names rewrites the file as well. */
+    test_store_host(test_ctx, "host1", "alias1", keys2, now);
+    ret = ssh_known_hosts_update_host(test_ctx->ssh_ctx, test_ctx->tctx->dom,
+                                      "host1", now);
+    assert_int_equal(ret, EOK);
+
+    content = test_read_known_hosts(test_ctx);
+    assert_non_null(strstr(content, "host1,alias1 " TEST_KEY2 "\n"));
+    assert_null(strstr(content, "host1 " TEST_KEY2 "\n"));
+    assert_int_not_equal(test_known_hosts_inode(), ino);
+    ino = test_known_hosts_inode();
+
+    /* A host removed from the cache leaves the file. */
+    ret = sysdb_delete_ssh_host(test_ctx->tctx->dom, "host2");
+    assert_int_equal(ret, EOK);
+    ret = ssh_known_hosts_update_host(test_ctx->ssh_ctx, test_ctx->tctx->dom,
+                                      "host2", now);
+    assert_int_equal(ret, EOK);
+
+    content = test_read_known_hosts(test_ctx);
+    assert_string_equal(content, "host1,alias1 " TEST_KEY2 "\n");
+    assert_int_not_equal(test_known_hosts_inode(), ino);
+}
+
+static void test_known_hosts_compact(void **state)
+{
+    struct ssh_known_hosts_test_ctx *test_ctx =
+        talloc_get_type_abort(*state, struct ssh_known_hosts_test_ctx);
+    const char *keys1[] = { TEST_KEY1, NULL };
+    const char *keys2[] = { TEST_KEY2, NULL };
+    struct ssh_known_hosts *kh;
+    time_t now = time(NULL);
+    char *content;
+    ino_t ino;
+    errno_t ret;
+
+    /* host1 expired a while ago, host2 is valid for a long time. */
+    test_store_host(test_ctx, "host1", NULL, keys1,
+                    now - TEST_KNOWN_HOSTS_TIMEOUT
+                        - SSS_SSH_KNOWN_HOSTS_COMPACT_DELAY - 10);
+    test_store_host(test_ctx, "host2", NULL, keys2, now);
+
+    ret = ssh_known_hosts_write_all(test_ctx->ssh_ctx,
+                                    now - TEST_KNOWN_HOSTS_TIMEOUT
+                                        - SSS_SSH_KNOWN_HOSTS_COMPACT_DELAY
+                                        - 20);
+    assert_int_equal(ret, EOK);
+
+    content = test_read_known_hosts(test_ctx);
+    assert_string_equal(content, "host1 " TEST_KEY1 "\n"
+                                 "host2 " TEST_KEY2 "\n");
+
+    kh = test_ctx->ssh_ctx->known_hosts;
+    assert_non_null(kh->compact_te);
+    assert_int_equal(kh->next_expire, now - SSS_SSH_KNOWN_HOSTS_COMPACT_DELAY
+                                      - 10);
+
+    /* The compaction is already due. */
+    ret = tevent_loop_once(test_ctx->tctx->ev);
+    assert_int_equal(ret, 0);
+
+    content = test_read_known_hosts(test_ctx);
+    assert_string_equal(content, "host2 " TEST_KEY2 "\n");
+
+    kh = test_ctx->ssh_ctx->known_hosts;
+    assert_non_null(kh);
+    assert_int_equal(hash_count(kh->entries), 1);
+    assert_int_equal(kh->next_expire, now + TEST_KNOWN_HOSTS_TIMEOUT);
+    assert_non_null(kh->compact_te);
+
+    /* Without expired hosts the compaction only waits for the next one. */
+    ino = test_known_hosts_inode();
+    talloc_zfree(kh->compact_te);
+    ssh_known_hosts_compact(test_ctx->tctx->ev, NULL, tevent_timeval_zero(),
+                            kh);
+
+    assert_ptr_equal(test_ctx->ssh_ctx->known_hosts, kh);
+    assert_non_null(kh->compact_te);
+    assert_int_equal(test_known_hosts_inode(), ino);
+}
+
+/* Checks that the hashed host name matches the name */
+static void test_check_hashed_name(const char *line, const char *name)
+{
+    TALLOC_CTX *tmp_ctx;
+    unsigned char hash[SSS_SHA1_LENGTH];
+    unsigned char *salt;
+    unsigned char *expected;
+    size_t salt_len;
+    size_t expected_len;
+    char **fields;
+    int num_fields;
+    errno_t ret;
+
+    tmp_ctx = talloc_new(NULL);
+    assert_non_null(tmp_ctx);
+
+    /* |1|salt|hash key */
+    ret = split_on_separator(tmp_ctx, line, '|', false, false,
+                             &fields, &num_fields);
+    assert_int_equal(ret, EOK);
+    assert_int_equal(num_fields, 4);
+    assert_string_equal(fields[1], "1");
+    *strchr(fields[3], ' ') = '\0';
+
+    salt = sss_base64_decode(tmp_ctx, fields[2], &salt_len);
+    assert_non_null(salt);
+    expected = sss_base64_decode(tmp_ctx, fields[3], &expected_len);
+    assert_non_null(expected);
+    assert_int_equal(expected_len, SSS_SHA1_LENGTH);
+
+    ret = sss_hmac_sha1(salt, salt_len, (const unsigned char *)name,
+                        strlen(name), hash);
+    assert_int_equal(ret, EOK);
+    assert_memory_equal(hash, expected, SSS_SHA1_LENGTH);
+
+    talloc_free(tmp_ctx);
+}
+
+static void test_known_hosts_hashed(void **state)
+{
+    struct ssh_known_hosts_test_ctx *test_ctx =
+        talloc_get_type_abort(*state, struct ssh_known_hosts_test_ctx);
+    const char *keys1[] = { TEST_KEY1, NULL };
+    const char *keys12[] = { TEST_KEY1, TEST_KEY2, NULL };
+    const char *keys2[] = { TEST_KEY2, NULL };
+    time_t now = time(NULL);
+    char *content;
+    char **lines;
+    char *name_hash;
+    char *alias_hash;
+    int num_lines;
+    errno_t ret;
+
+    test_ctx->ssh_ctx->hash_known_hosts = true;
+
+    test_store_host(test_ctx, "host1", "alias1", keys1, now);
+
+    ret = ssh_known_hosts_write_all(test_ctx->ssh_ctx, now);
+    assert_int_equal(ret, EOK);
+
+    content = test_read_known_hosts(test_ctx);
+    ret = split_on_separator(test_ctx, content, '\n', false, true,
+                             &lines, &num_lines);
+    assert_int_equal(ret, EOK);
+    assert_int_equal(num_lines, 2);
+    test_check_hashed_name(lines[0], "host1");
+    test_check_hashed_name(lines[1], "alias1");
+
+    name_hash = talloc_strndup(test_ctx, lines[0],
+                               strchr(lines[0], ' ') - lines[0]);
+    assert_non_null(name_hash);
+    alias_hash = talloc_strndup(test_ctx, lines[1],
+                                strchr(lines[1], ' ') - lines[1]);
+    assert_non_null(alias_hash);
+
+    /* The appended key reuses the hashed names. */
+    test_store_host(test_ctx, "host1", "alias1", keys12, now);
+    ret = ssh_known_hosts_update_host(test_ctx->ssh_ctx, test_ctx->tctx->dom,
+                                      "host1", now);
+    assert_int_equal(ret, EOK);
+
+    content = test_read_known_hosts(test_ctx);
+    ret = split_on_separator(test_ctx, content, '\n', false, true,
+                             &lines, &num_lines);
+    assert_int_equal(ret, EOK);
+    assert_int_equal(num_lines, 4);
+    assert_string_equal(lines[2],
+                        talloc_asprintf(test_ctx, "%s %s", name_hash,
+                                        TEST_KEY2));
+    assert_string_equal(lines[3],
+                        talloc_asprintf(test_ctx, "%s %s", alias_hash,
+                                        TEST_KEY2));
+
+    /* So does a rewrite. */
+    test_store_host(test_ctx, "host1", "alias1", keys2, now);
+    ret = ssh_known_hosts_update_host(test_ctx->ssh_ctx, test_ctx->tctx->dom,
+                                      "host1", now);
+    assert_int_equal(ret, EOK);
+
+    content = test_read_known_hosts(test_ctx);
+    assert_string_equal(content,
+                        talloc_asprintf(test_ctx, "%s %s\n%s %s\n",
+                                        name_hash, TEST_KEY2,
+                                        alias_hash, TEST_KEY2));
+}
+
+int main(int argc, const char *argv[])
+{
+    int rv;
+    poptContext pc;
+    int opt;
+    struct poptOption long_options[] = {
+        POPT_AUTOHELP
+        SSSD_DEBUG_OPTS
+        POPT_TABLEEND
+    };
+
+    const struct CMUnitTest tests[] = {
+        cmocka_unit_test_setup_teardown(test_known_hosts_append,
+                                        test_known_hosts_setup,
+                                        test_known_hosts_teardown),
+        cmocka_unit_test_setup_teardown(test_known_hosts_rewrite,
+                                        test_known_hosts_setup,
+                                        test_known_hosts_teardown),
+        cmocka_unit_test_setup_teardown(test_known_hosts_compact,
+                                        test_known_hosts_setup,
+                                        test_known_hosts_teardown),
+        cmocka_unit_test_setup_teardown(test_known_hosts_hashed,
+                                        test_known_hosts_setup,
+                                        test_known_hosts_teardown),
+    };
+
+    /* Set debug level to invalid value so we can deside if -d 0 was used. */
+    debug_level = SSSDBG_INVALID;
+
+    pc = poptGetContext(argv[0], argc, argv, long_options, 0);
+    while ((opt = poptGetNextOpt(pc)) != -1) {
+        switch (opt) {
+        default:
+            fprintf(stderr, "\nInvalid option %s: %s\n\n",
+                    poptBadOption(pc, 0), poptStrerror(opt));
+            poptPrintUsage(pc, stderr, 0);
+            return 1;
+        }
+    }
+    poptFreeContext(pc);
+
+    DEBUG_CLI_INIT(debug_level);
+
+    /* Even though normally the tests should clean up after themselves
+     * they might not after a failed run. Remove the old db to be sure */
+    tests_set_cwd();
+    test_dom_suite_cleanup(TESTS_PATH, TEST_CONF_DB, TEST_DOM_NAME);
+
+    rv = cmocka_run_group_tests(tests, NULL, NULL);
+    return rv;
+}
@@ -0,0 +1,379 @@
+/*
+    SSSD
+
+    sudo responder: Tests for the in-memory index of cached rules
+
+    Copyright (C) 2016 Red Hat
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <stdarg.h>
+#include <stddef.h>
+#include <setjmp.h>
+#include <cmocka.h>
+#include <popt.h>
+
+#include "tests/cmocka/common_mock.h"
+#include "db/sysdb_sudo.h"
+#include "responder/sudo/sudosrv_private.h"
+
+#define TESTS_PATH "tp_" BASE_FILE_STEM
+#define TEST_CONF_DB "test_sudo_index.ldb"
+#define TEST_DOM_NAME "test_domain.test"
+
+#define TEST_USER "test_user"
+#define TEST_UID 1001
+#define TEST_GROUP "test_group"
+
+struct test_rule {
+    const char *name;
+    const char *user;
+    const char *order;
+} rules[] = { { "defaults", NULL, "0" },
+              { "rule_all", "ALL", "3" },
+              { "rule_user", TEST_USER, "1" },
+              { "rule_group", "%" TEST_GROUP, "2" },
+              { "rule_netgroup", "+test_netgroup", "4" },
+              { "rule_uid", "#1001", "5" },
+              { "rule_other", "other_user", "6" } };
+
+struct sudo_index_test_ctx {
+    struct sss_test_ctx *tctx;
+    struct sudo_ctx *sudo_ctx;
+};
+
+static struct sysdb_attrs *create_rule(TALLOC_CTX *mem_ctx,
+                                       struct test_rule *rule)
+{
+    struct sysdb_attrs *attrs;
+    errno_t ret;
+
+    attrs = sysdb_new_attrs(mem_ctx);
+    assert_non_null(attrs);
+
+    ret = sysdb_attrs_add_string(attrs, SYSDB_SUDO_CACHE_AT_CN, rule->name);
+    assert_int_equal(ret, EOK);
+
+    ret = sysdb_attrs_add_string(attrs, SYSDB_SUDO_CACHE_AT_ORDER,
+                                 rule->order);
+    assert_int_equal(ret, EOK);
+
+    if (rule->user != NULL) {
+        ret = sysdb_attrs_add_string(attrs, SYSDB_SUDO_CACHE_AT_USER,
+                                     rule->user);
+        assert_int_equal(ret, EOK);
+    }
+
+    return attrs;
+}
+
+static void store_rules(struct sudo_index_test_ctx *test_ctx,
+                        struct test_rule *list, size_t count)
+{
+    struct sysdb_attrs **attrs;
+    size_t i;
+    errno_t ret;
+
+    attrs = talloc_array(test_ctx, struct sysdb_attrs *, count);
+    assert_non_null(attrs);
+
+    for (i = 0; i < count; i++) {
+        attrs[i] = create_rule(attrs, &list[i]);
+    }
+
+    ret = sysdb_sudo_store(test_ctx->tctx->dom, attrs, count);
+    assert_int_equal(ret, EOK);
+
+    talloc_free(attrs);
+}
+
+static void assert_rules(struct sysdb_attrs **result, uint32_t num_result,
+                         const char **expected)
+{
+    const char *name;
+    uint32_t i;
+    errno_t ret;
+
+    for (i = 0; expected[i] != NULL; i++) {
+        assert_true(i < num_result);
+
+        ret = sysdb_attrs_get_string(result[i], SYSDB_NAME, &name);
+        assert_int_equal(ret, EOK);
+        assert_string_equal(name, expected[i]);
+    }
+
+    assert_int_equal(i, num_result);
+}
+
+static int test_sudo_index_setup(void **state)
+{
+    struct sudo_index_test_ctx *test_ctx;
+
+    assert_true(leak_check_setup());
+
+    test_ctx = talloc_zero(global_talloc_context, struct sudo_index_test_ctx);
+    assert_non_null(test_ctx);
+
+    test_dom_suite_setup(TESTS_PATH);
+
+    test_ctx->tctx = create_dom_test_ctx(test_ctx, TESTS_PATH, TEST_CONF_DB,
+                                         TEST_DOM_NAME, "ipa", NULL);
+    assert_non_null(test_ctx->tctx);
+
+    /* The indexes are built on demand, keep them out of the leak checks */
+    test_ctx->sudo_ctx = talloc_zero(NULL, struct sudo_ctx);
+    assert_non_null(test_ctx->sudo_ctx);
+
+    store_rules(test_ctx, rules, sizeof(rules) / sizeof(rules[0]));
+
+    check_leaks_push(test_ctx);
+
+    *state = test_ctx;
+    return 0;
+}
+
+static int test_sudo_index_teardown(void **state)
+{
+    struct sudo_index_test_ctx *test_ctx;
+
+    test_ctx = talloc_get_type_abort(*state, struct sudo_index_test_ctx);
+
+    assert_true(check_leaks_pop(test_ctx));
+
+    talloc_zfree(test_ctx->sudo_ctx);
+    test_dom_suite_cleanup(TESTS_PATH, TEST_CONF_DB, TEST_DOM_NAME);
+
+    talloc_zfree(test_ctx);
+    assert_true(leak_check_teardown());
+
+    return 0;
+}
+
+void test_sudo_index_lookup(void **state)
+{
+    struct sudo_index_test_ctx *test_ctx;
+    struct sudosrv_index *index;
+    struct sysdb_attrs **result;
+    uint32_t num_result;
+    const char *sudo_user;
+    char *groups[] = { discard_const(TEST_GROUP), NULL };
+    const char *expected[] = { "rule_uid", "rule_netgroup", "rule_all",
+                               "rule_group", "rule_user", NULL };
+    errno_t ret;
+
+    test_ctx = talloc_get_type_abort(*state, struct sudo_index_test_ctx);
+
+    ret = sudosrv_index_update(test_ctx->sudo_ctx, test_ctx->tctx->dom,
+                               &index);
+    assert_int_equal(ret, EOK);
+
+    ret = sudosrv_index_lookup(test_ctx, index, TEST_UID, TEST_USER, groups,
+                               &result, &num_result);
+    assert_int_equal(ret, EOK);
+    assert_rules(result, num_result, expected);
+
+    /* Rules matched by user are returned with sudoUser: #uid only */
+    ret = sysdb_attrs_get_string(result[0], SYSDB_SUDO_CACHE_AT_USER,
+                                 &sudo_user);
+    assert_int_equal(ret, EOK);
+    assert_string_equal(sudo_user, "#1001");
+
+    /* Netgroup rules are evaluated by sudo itself */
+    ret = sysdb_attrs_get_string(result[1], SYSDB_SUDO_CACHE_AT_USER,
+                                 &sudo_user);
+    assert_int_equal(ret, EOK);
+    assert_string_equal(sudo_user, "+test_netgroup");
+
+    talloc_free(result);
+}
+
+void test_sudo_index_inverse_order(void **state)
+{
+    struct sudo_index_test_ctx *test_ctx;
+    struct sudosrv_index *index;
+    struct sysdb_attrs **result;
+    uint32_t num_result;
+    const char *expected[] = { "rule_user", "rule_all", "rule_netgroup",
+                               "rule_uid", NULL };
+    errno_t ret;
+
+    test_ctx = talloc_get_type_abort(*state, struct sudo_index_test_ctx);
+    test_ctx->sudo_ctx->inverse_order = true;
+
+    ret = sudosrv_index_update(test_ctx->sudo_ctx, test_ctx->tctx->dom,
+                               &index);
+    assert_int_equal(ret, EOK);
+
+    ret = sudosrv_index_lookup(test_ctx, index, TEST_UID, TEST_USER, NULL,
+                               &result, &num_result);
+    assert_int_equal(ret, EOK);
+    assert_rules(result, num_result, expected);
+
+    talloc_free(result);
+}
+
+void test_sudo_index_generations(void **state)
+{
+    struct sudo_index_test_ctx *test_ctx;
+    struct sudosrv_index *index;
+    struct sysdb_attrs **result;
+    struct sysdb_attrs *attrs;
+    uint32_t num_result;
+    struct test_rule new_rules[] = { { "rule_new", TEST_USER, "0" } };
+    const char *expected_store[] = { "rule_netgroup", "rule_all",
+                                     "rule_user", "rule_new", NULL };
+    const char *expected_modify[] = { "rule_netgroup", "rule_all",
+                                      "rule_new", NULL };
+    const char *expected_purge[] = { "rule_netgroup", "rule_all", NULL };
+    errno_t ret;
+
+    test_ctx = talloc_get_type_abort(*state, struct sudo_index_test_ctx);
+
+    ret = sudosrv_index_update(test_ctx->sudo_ctx, test_ctx->tctx->dom,
+                               &index);
+    assert_int_equal(ret, EOK);
+
+    /* A new rule is picked up by an incremental update */
+    store_rules(test_ctx, new_rules, 1);
+
+    ret = sudosrv_index_update(test_ctx->sudo_ctx, test_ctx->tctx->dom,
+                               &index);
+    assert_int_equal(ret, EOK);
+
+    ret = sudosrv_index_lookup(test_ctx, index, 0, TEST_USER, NULL,
+                               &result, &num_result);
+    assert_int_equal(ret, EOK);
+    assert_rules(result, num_result, expected_store);
+    talloc_zfree(result);
+
+    /* So is a rule that no longer applies to the user */
+    attrs = sysdb_new_attrs(test_ctx);
+    assert_non_null(attrs);
+    ret = sysdb_attrs_add_string(attrs, SYSDB_SUDO_CACHE_AT_USER, TEST_USER);
+    assert_int_equal(ret, EOK);
+
+    ret = sysdb_set_sudo_rule_attr(test_ctx->tctx->dom, "rule_user",
+                                   attrs, SYSDB_MOD_DEL);
+    assert_int_equal(ret, EOK);
+    talloc_zfree(attrs);
+
+    ret = sudosrv_index_update(test_ctx->sudo_ctx, test_ctx->tctx->dom,
+                               &index);
+    assert_int_equal(ret, EOK);
+
+    ret = sudosrv_index_lookup(test_ctx, index, 0, TEST_USER, NULL,
+                               &result, &num_result);
+    assert_int_equal(ret, EOK);
+    assert_rules(result, num_result, expected_modify);
+    talloc_zfree(result);
+
+    /* And a purged one */
+    attrs = create_rule(test_ctx, &new_rules[0]);
+    ret = sysdb_sudo_purge(test_ctx->tctx->dom, NULL, &attrs, 1);
+    assert_int_equal(ret, EOK);
+    talloc_zfree(attrs);
+
+    ret = sudosrv_index_update(test_ctx->sudo_ctx, test_ctx->tctx->dom,
+                               &index);
+    assert_int_equal(ret, EOK);
+
+    ret = sudosrv_index_lookup(test_ctx, index, 0, TEST_USER, NULL,
+                               &result, &num_result);
+    assert_int_equal(ret, EOK);
+    assert_rules(result, num_result, expected_purge);
+    talloc_zfree(result);
+}
+
+void test_sudo_index_expired(void **state)
+{
+    struct sudo_index_test_ctx *test_ctx;
+    struct sudosrv_index *index;
+    struct sysdb_attrs **result;
+    uint32_t num_result;
+    char *groups[] = { discard_const(TEST_GROUP), NULL };
+    const char *expected[] = { "defaults", "rule_uid", "rule_netgroup",
+                               "rule_all", "rule_group", "rule_user",
+                               NULL };
+    errno_t ret;
+
+    test_ctx = talloc_get_type_abort(*state, struct sudo_index_test_ctx);
+
+    ret = sudosrv_index_update(test_ctx->sudo_ctx, test_ctx->tctx->dom,
+                               &index);
+    assert_int_equal(ret, EOK);
+
+    ret = sudosrv_index_expired(test_ctx, index, TEST_UID, TEST_USER, groups,
+                                time(NULL) - 1, &result, &num_result);
+    assert_int_equal(ret, EOK);
+    assert_int_equal(num_result, 0);
+    assert_null(result);
+
+    ret = sudosrv_index_expired(test_ctx, index, TEST_UID, TEST_USER, groups,
+                                time(NULL) + 365 * 24 * 3600,
+                                &result, &num_result);
+    assert_int_equal(ret, EOK);
+    assert_rules(result, num_result, expected);
+    talloc_free(result);
+}
+
+int main(int argc, const char *argv[])
+{
+    int rv;
+    poptContext pc;
+    int opt;
+    struct poptOption long_options[] = {
+        POPT_AUTOHELP
+        SSSD_DEBUG_OPTS
+        POPT_TABLEEND
+    };
+
+    const struct CMUnitTest tests[] = {
+        cmocka_unit_test_setup_teardown(test_sudo_index_lookup,
+                                        test_sudo_index_setup,
+                                        test_sudo_index_teardown),
+        cmocka_unit_test_setup_teardown(test_sudo_index_inverse_order,
+                                        test_sudo_index_setup,
+                                        test_sudo_index_teardown),
+        cmocka_unit_test_setup_teardown(test_sudo_index_generations,
+                                        test_sudo_index_setup,
+                                        test_sudo_index_teardown),
+        cmocka_unit_test_setup_teardown(test_sudo_index_expired,
+                                        test_sudo_index_setup,
+                                        test_sudo_index_teardown),
+    };
+
+    /* Set debug level to invalid value so we can deside if -d 0 was used. */
+    debug_level = SSSDBG_INVALID;
+
+    pc = poptGetContext(argv[0], argc, argv, long_options, 0);
+    while ((opt = poptGetNextOpt(pc)) != -1) {
+        switch (opt) {
+        default:
+            fprintf(stderr, "\nInvalid option %s: %s\n\n",
+                    poptBadOption(pc, 0), poptStrerror(opt));
+            poptPrintUsage(pc, stderr, 0);
+            return 1;
+        }
+    }
+    poptFreeContext(pc);
+
+    DEBUG_CLI_INIT(debug_level);
+
+    tests_set_cwd();
+    test_dom_suite_cleanup(TESTS_PATH, TEST_CONF_DB, TEST_DOM_NAME);
+    rv = cmocka_run_group_tests(tests, NULL, NULL);
+
+    return rv;
+}
@@ -283,6 +283,85 @@ void test_sudo_set_get_last_full_refresh(void **state)
     assert_int_equal(now, loaded_time);
 }
 
+void test_sudo_generation(void **state)
+{
+    errno_t ret;
+    uint32_t generation;
+    uint32_t purge_generation;
+    const char *attrs[] = { SYSDB_SUDO_CACHE_AT_GENERATION, NULL };
+    struct ldb_message **msgs = NULL;
+    size_t msgs_count;
+    struct sysdb_attrs *rule;
+    struct sysdb_attrs *new_attrs;
+    struct sysdb_test_ctx *test_ctx = talloc_get_type_abort(*state,
+                                                         struct sysdb_test_ctx);
+
+    ret = sysdb_sudo_get_generation(test_ctx->tctx->dom, &generation,
+                                    &purge_generation);
+    assert_int_equal(ret, EOK);
+    assert_int_equal(generation, 0);
+    assert_int_equal(purge_generation, 0);
+
+    rule = sysdb_new_attrs(test_ctx);
+    assert_non_null(rule);
+    create_rule_attrs(rule, 0);
+
+    ret = sysdb_sudo_store(test_ctx->tctx->dom, &rule, 1);
+    assert_int_equal(ret, EOK);
+
+    ret = sysdb_sudo_get_generation(test_ctx->tctx->dom, &generation,
+                                    &purge_generation);
+    assert_int_equal(ret, EOK);
+    assert_int_equal(generation, 1);
+    assert_int_equal(purge_generation, 0);
+
+    ret = sysdb_search_sudo_rules(test_ctx, test_ctx->tctx->dom,
+                                  "(objectClass=sudoRule)",
+                                  attrs, &msgs_count, &msgs);
+    assert_int_equal(ret, EOK);
+    assert_int_equal(msgs_count, 1);
+    assert_int_equal(ldb_msg_find_attr_as_uint(msgs[0],
+                                               SYSDB_SUDO_CACHE_AT_GENERATION,
+                                               0), 1);
+    talloc_zfree(msgs);
+
+    /* Modified rules are stamped with the new generation */
+    new_attrs = sysdb_new_attrs(test_ctx);
+    assert_non_null(new_attrs);
+    ret = sysdb_attrs_add_string(new_attrs, SYSDB_SUDO_CACHE_AT_COMMAND,
+                                 "/bin/ls");
+    assert_int_equal(ret, EOK);
+
+    ret = sysdb_set_sudo_rule_attr(test_ctx->tctx->dom, rules[0].name,
+                                   new_attrs, SYSDB_MOD_ADD);
+    assert_int_equal(ret, EOK);
+
+    ret = sysdb_search_sudo_rules(test_ctx, test_ctx->tctx->dom,
+                                  "(objectClass=sudoRule)",
+                                  attrs, &msgs_count, &msgs);
+    assert_int_equal(ret, EOK);
+    assert_int_equal(msgs_count, 1);
+    assert_int_equal(ldb_msg_find_attr_as_uint(msgs[0],
+                                               SYSDB_SUDO_CACHE_AT_GENERATION,
+                                               0), 2);
+    talloc_zfree(msgs);
+
+    /* Purging all rules removes the container but the generation must
+     * not go back */
+    ret = sysdb_sudo_purge(test_ctx->tctx->dom, "(objectClass=sudoRule)",
+                           NULL, 0);
+    assert_int_equal(ret, EOK);
+
+    ret = sysdb_sudo_get_generation(test_ctx->tctx->dom, &generation,
+                                    &purge_generation);
+    assert_int_equal(ret, EOK);
+    assert_int_equal(generation, 3);
+    assert_int_equal(purge_generation, 3);
+
+    talloc_zfree(rule);
+    talloc_zfree(new_attrs);
+}
+
 void test_get_sudo_user_info(void **state)
 {
     errno_t ret;
@@ -666,6 +745,11 @@ int main(int argc, const char *argv[])
                                         test_sysdb_setup,
                                         test_sysdb_teardown),
 
+        /* sysdb_sudo_get_generation() */
+        cmocka_unit_test_setup_teardown(test_sudo_generation,
+                                        test_sysdb_setup,
+                                        test_sysdb_teardown),
+
         /* sysdb_get_sudo_user_info() */
         cmocka_unit_test_setup_teardown(test_get_sudo_user_info,
                                         test_sysdb_setup,
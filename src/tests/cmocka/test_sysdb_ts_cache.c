@@ -1204,6 +1204,96 @@ static void test_sysdb_getpw_merges(void **state)
     talloc_free(msg);
 }
 
+static void test_sysdb_invalidate_ts_entries(void **state)
+{
+    int ret;
+    struct sysdb_ts_test_ctx *test_ctx = talloc_get_type_abort(*state,
+                                                     struct sysdb_ts_test_ctx);
+    const char *attrs[] = { SYSDB_NAME, NULL };
+    const char *initgr_attrs[] = { SYSDB_INITGR_EXPIRE, NULL };
+    struct ldb_result *res = NULL;
+    struct ldb_message **msgs = NULL;
+    struct ldb_message **missing = NULL;
+    size_t msgs_count;
+    size_t num_missing;
+    uint64_t cache_expire_sysdb;
+    uint64_t cache_expire_ts;
+
+    ret = sysdb_store_user(test_ctx->tctx->dom, TEST_USER_NAME, NULL,
+                           TEST_USER_UID, TEST_USER_GID, TEST_USER_NAME,
+                           "/home/"TEST_USER_NAME, "/bin/bash", NULL,
+                           NULL, NULL, TEST_CACHE_TIMEOUT, TEST_NOW_1);
+    assert_int_equal(ret, EOK);
+
+    ret = sysdb_store_group(test_ctx->tctx->dom, TEST_GROUP_NAME,
+                            TEST_GROUP_GID, NULL, TEST_CACHE_TIMEOUT,
+                            TEST_NOW_1);
+    assert_int_equal(ret, EOK);
+
+    ret = sysdb_store_group(test_ctx->tctx->dom, TEST_GROUP_NAME_2,
+                            TEST_GROUP_GID_2, NULL, TEST_CACHE_TIMEOUT,
+                            TEST_NOW_1);
+    assert_int_equal(ret, EOK);
+
+    /* Users get their initgroups expiration reset as well */
+    ret = sysdb_search_users(test_ctx, test_ctx->tctx->dom,
+                             "("SYSDB_NAME"=*)", attrs, &msgs_count, &msgs);
+    assert_int_equal(ret, EOK);
+    assert_int_equal(msgs_count, 1);
+
+    ret = sysdb_invalidate_ts_entries(test_ctx, test_ctx->tctx->dom->sysdb,
+                                      msgs, msgs_count, true,
+                                      &missing, &num_missing);
+    assert_int_equal(ret, EOK);
+    assert_int_equal(num_missing, 0);
+    talloc_free(missing);
+    talloc_free(msgs);
+
+    /* Only the timestamp cache is written */
+    get_pw_timestamp_attrs(test_ctx, TEST_USER_NAME,
+                           &cache_expire_sysdb, &cache_expire_ts);
+    assert_int_equal(cache_expire_sysdb, TEST_CACHE_TIMEOUT + TEST_NOW_1);
+    assert_int_equal(cache_expire_ts, 1);
+
+    ret = sysdb_get_user_attr(test_ctx, test_ctx->tctx->dom,
+                              TEST_USER_NAME, initgr_attrs, &res);
+    assert_int_equal(ret, EOK);
+    assert_int_equal(res->count, 1);
+    assert_int_equal(ldb_msg_find_attr_as_uint64(res->msgs[0],
+                                                 SYSDB_INITGR_EXPIRE, 0), 1);
+    talloc_free(res);
+
+    ret = sysdb_search_groups(test_ctx, test_ctx->tctx->dom,
+                              "("SYSDB_NAME"=*)", attrs, &msgs_count, &msgs);
+    assert_int_equal(ret, EOK);
+    assert_int_equal(msgs_count, 2);
+
+    ret = sysdb_invalidate_ts_entries(test_ctx, test_ctx->tctx->dom->sysdb,
+                                      msgs, msgs_count, false,
+                                      &missing, &num_missing);
+    assert_int_equal(ret, EOK);
+    assert_int_equal(num_missing, 0);
+    talloc_free(missing);
+    talloc_free(msgs);
+
+    get_gr_timestamp_attrs(test_ctx, TEST_GROUP_NAME,
+                           &cache_expire_sysdb, &cache_expire_ts);
+    assert_int_equal(cache_expire_sysdb, TEST_CACHE_TIMEOUT + TEST_NOW_1);
+    assert_int_equal(cache_expire_ts, 1);
+
+    get_gr_timestamp_attrs(test_ctx, TEST_GROUP_NAME_2,
+                           &cache_expire_sysdb, &cache_expire_ts);
+    assert_int_equal(cache_expire_sysdb, TEST_CACHE_TIMEOUT + TEST_NOW_1);
+    assert_int_equal(cache_expire_ts, 1);
+
+    /* Lookups merge the expired timestamp */
+    res = sysdb_getgrnam_res(test_ctx, test_ctx->tctx->dom, TEST_GROUP_NAME);
+    assert_int_equal(res->count, 1);
+    assert_int_equal(ldb_msg_find_attr_as_uint64(res->msgs[0],
+                                                 SYSDB_CACHE_EXPIRE, 0), 1);
+    talloc_free(res);
+}
+
 static void test_user_bysid(void **state)
 {
     int ret;
@@ -1456,6 +1546,9 @@ int main(int argc, const char *argv[])
         cmocka_unit_test_setup_teardown(test_sysdb_getpw_merges,
                                         test_sysdb_ts_setup,
                                         test_sysdb_ts_teardown),
+        cmocka_unit_test_setup_teardown(test_sysdb_invalidate_ts_entries,
+                                        test_sysdb_ts_setup,
+                                        test_sysdb_ts_teardown),
         cmocka_unit_test_setup_teardown(test_user_bysid,
                                         test_sysdb_ts_setup,
                                         test_sysdb_ts_teardown),
@@ -26,6 +26,8 @@
 
 #include "tests/cmocka/common_mock.h"
 #include "util/sss_nss.h"
+#include "util/sss_trace.h"
+#include "util/sss_perf.h"
 #include "test_utils.h"
 
 #define TESTS_PATH "tp_" BASE_FILE_STEM
@@ -1623,7 +1625,24 @@ static void test_parse_cert_verify_opts(void **state)
     assert_true(cv_opts->do_ocsp);
     assert_string_equal(cv_opts->ocsp_default_responder, "abc");
     assert_string_equal(cv_opts->ocsp_default_responder_signing_cert, "def");
+    assert_int_equal(cv_opts->cache_timeout, 0);
     talloc_free(cv_opts);
+
+    ret = parse_cert_verify_opts(global_talloc_context,
+                                 "no_ocsp,cache_timeout=300", &cv_opts);
+    assert_int_equal(ret, EOK);
+    assert_true(cv_opts->do_verification);
+    assert_false(cv_opts->do_ocsp);
+    assert_int_equal(cv_opts->cache_timeout, 300);
+    talloc_free(cv_opts);
+
+    ret = parse_cert_verify_opts(global_talloc_context,
+                                 "cache_timeout=", &cv_opts);
+    assert_int_equal(ret, EINVAL);
+
+    ret = parse_cert_verify_opts(global_talloc_context,
+                                 "cache_timeout=5min", &cv_opts);
+    assert_int_equal(ret, EINVAL);
 }
 
 static void assert_parse_fqname(const char *fqname,
@@ -1861,6 +1880,89 @@ static void test_is_email_from_domain(void **state)
     assert_true(is_email_from_domain("hello@NaMe_0.DoM", d));
 }
 
+static void test_sss_trace_id(void **state)
+{
+    uint64_t id1;
+    uint64_t id2;
+    uint64_t prev;
+
+    id1 = sss_trace_new_id();
+    id2 = sss_trace_new_id();
+    assert_int_not_equal(id1, 0);
+    assert_int_not_equal(id2, 0);
+    assert_int_not_equal(id1, id2);
+    /* the identifier starts with the pid of the process */
+    assert_int_equal(id1 >> 32, getpid());
+
+    assert_int_equal(sss_trace_current(), 0);
+
+    prev = sss_trace_set_current(id1);
+    assert_int_equal(prev, 0);
+    assert_int_equal(sss_trace_current(), id1);
+
+    prev = sss_trace_set_current(id2);
+    assert_int_equal(prev, id1);
+    assert_int_equal(sss_trace_current(), id2);
+
+    sss_trace_set_current(prev);
+    assert_int_equal(sss_trace_current(), id1);
+    sss_trace_set_current(0);
+
+    assert_string_equal(sss_trace_stage_to_str(SSS_TRACE_LDAP), "ldap");
+    assert_string_equal(sss_trace_stage_to_str(SSS_TRACE_SENTINEL),
+                        "unknown");
+}
+
+static void test_sss_perf_hist(void **state)
+{
+    struct sss_perf_hist *hist;
+    struct sss_perf_hist *other;
+    uint64_t i;
+
+    hist = talloc_zero(global_talloc_context, struct sss_perf_hist);
+    assert_non_null(hist);
+
+    assert_int_equal(sss_perf_hist_percentile(hist, 50), 0);
+
+    /* small values are stored exactly */
+    sss_perf_hist_add(hist, 5);
+    assert_int_equal(sss_perf_hist_percentile(hist, 50), 5);
+    assert_int_equal(sss_perf_hist_percentile(hist, 99), 5);
+
+    memset(hist, 0, sizeof(struct sss_perf_hist));
+    for (i = 1; i <= 100; i++) {
+        sss_perf_hist_add(hist, i);
+    }
+
+    assert_int_equal(hist->count, 100);
+    assert_int_equal(hist->sum, 5050);
+    assert_int_equal(hist->max, 100);
+    /* larger values are reported as the upper bound of their bucket */
+    assert_int_equal(sss_perf_hist_percentile(hist, 50), 51);
+    assert_int_equal(sss_perf_hist_percentile(hist, 90), 95);
+    /* but never above the maximum */
+    assert_int_equal(sss_perf_hist_percentile(hist, 99), 100);
+    /* fractional percentiles round the rank up */
+    assert_int_equal(sss_perf_hist_percentile(hist, 0.5), 1);
+    assert_int_equal(sss_perf_hist_percentile(hist, 99.9), 100);
+
+    other = talloc_zero(hist, struct sss_perf_hist);
+    assert_non_null(other);
+    sss_perf_hist_add(other, 1000);
+    sss_perf_hist_merge(other, hist);
+    assert_int_equal(other->count, 101);
+    assert_int_equal(other->sum, 6050);
+    assert_int_equal(other->max, 1000);
+    assert_int_equal(sss_perf_hist_percentile(other, 50), 51);
+    assert_int_equal(sss_perf_hist_percentile(other, 100), 1000);
+
+    /* values out of range end in the last bucket */
+    sss_perf_hist_add(hist, UINT64_MAX);
+    assert_int_equal(hist->buckets[SSS_PERF_BUCKETS - 1], 1);
+
+    talloc_free(hist);
+}
+
 int main(int argc, const char *argv[])
 {
     poptContext pc;
@@ -1957,6 +2059,8 @@ int main(int argc, const char *argv[])
         cmocka_unit_test_setup_teardown(test_sss_get_domain_mappings_content,
                                         setup_dom_list_with_subdomains,
                                         teardown_dom_list),
+        cmocka_unit_test(test_sss_trace_id),
+        cmocka_unit_test(test_sss_perf_hist),
     };
 
     /* Set debug level to invalid value so we can deside if -d 0 was used. */
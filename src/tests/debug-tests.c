@@ -27,6 +27,8 @@
 #include <talloc.h>
 #include <errno.h>
 #include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
 #include "util/util.h"
 #include "tests/common.h"
 
@@ -651,6 +653,144 @@ START_TEST(test_debug_is_set_false)
 }
 END_TEST
 
+static int test_helper_debug_open_file(char *filename)
+{
+    mode_t old_umask;
+    int fd;
+
+    strncpy(filename, "sssd_debug_tests.XXXXXX", 24);
+
+    old_umask = umask(SSS_DFL_UMASK);
+    fd = mkstemp(filename);
+    umask(old_umask);
+    fail_if(fd == -1, "mkstemp failed");
+
+    fail_unless(set_debug_file_from_fd(fd) == EOK,
+                "set_debug_file_from_fd failed");
+
+    return fd;
+}
+
+static char *test_helper_debug_read_file(TALLOC_CTX *mem_ctx, int fd)
+{
+    struct stat st;
+    char *content;
+    ssize_t len;
+
+    fail_unless(fstat(fd, &st) == 0, "fstat failed");
+
+    content = talloc_zero_array(mem_ctx, char, st.st_size + 1);
+    fail_if(content == NULL, "talloc_zero_array failed");
+
+    len = pread(fd, content, st.st_size, 0);
+    fail_unless(len == st.st_size, "pread failed");
+
+    return content;
+}
+
+START_TEST(test_debug_buffered)
+{
+    TALLOC_CTX *tmp_ctx;
+    char filename[24] = {'\0'};
+    const char *expected = "[sssd] [test_debug_buffered] (0x0400): buffered\n";
+    char *content;
+    int fd;
+    errno_t ret;
+
+    tmp_ctx = talloc_new(NULL);
+    fail_if(tmp_ctx == NULL, "talloc_new failed");
+
+    debug_timestamps = 0;
+    debug_microseconds = 0;
+    debug_to_file = 1;
+    debug_prg_name = "sssd";
+    debug_level = SSSDBG_MASK_ALL;
+    fd = test_helper_debug_open_file(filename);
+
+    ret = debug_set_buffered(true);
+    fail_unless(ret == EOK, "debug_set_buffered failed");
+
+    DEBUG(SSSDBG_TRACE_FUNC, "buffered\n");
+    content = test_helper_debug_read_file(tmp_ctx, fd);
+    fail_unless(strcmp(content, "") == 0,
+                "Message was written before flush [%s]", content);
+
+    debug_flush_buffer();
+    content = test_helper_debug_read_file(tmp_ctx, fd);
+    fail_unless(strcmp(content, expected) == 0,
+                "Unexpected log content [%s]", content);
+
+    /* error-level messages are written out immediately */
+    DEBUG(SSSDBG_CRIT_FAILURE, "error\n");
+    content = test_helper_debug_read_file(tmp_ctx, fd);
+    fail_if(strstr(content, "error\n") == NULL,
+            "Error message was not written [%s]", content);
+
+    ret = debug_set_buffered(false);
+    fail_unless(ret == EOK, "debug_set_buffered failed");
+
+    remove(filename);
+    talloc_free(tmp_ctx);
+}
+END_TEST
+
+START_TEST(test_debug_backtrace)
+{
+    TALLOC_CTX *tmp_ctx;
+    char filename[24] = {'\0'};
+    char *content;
+    char *begin;
+    char *hidden;
+    char *error;
+    int fd;
+    errno_t ret;
+
+    tmp_ctx = talloc_new(NULL);
+    fail_if(tmp_ctx == NULL, "talloc_new failed");
+
+    debug_timestamps = 0;
+    debug_microseconds = 0;
+    debug_to_file = 1;
+    debug_prg_name = "sssd";
+    debug_level = debug_convert_old_level(2);
+    fd = test_helper_debug_open_file(filename);
+
+    ret = debug_set_backtrace_level(9);
+    fail_unless(ret == EOK, "debug_set_backtrace_level failed");
+    fail_unless(DEBUG_IS_SET(SSSDBG_TRACE_ALL), "Trace level is not set");
+    fail_if(DEBUG_IS_LOGGED(SSSDBG_TRACE_ALL), "Trace level is logged");
+
+    DEBUG(SSSDBG_TRACE_ALL, "hidden\n");
+    content = test_helper_debug_read_file(tmp_ctx, fd);
+    fail_unless(strcmp(content, "") == 0,
+                "Recorded message was written [%s]", content);
+
+    DEBUG(SSSDBG_OP_FAILURE, "error\n");
+    content = test_helper_debug_read_file(tmp_ctx, fd);
+    begin = strstr(content, "BACKTRACE DUMP BEGIN");
+    hidden = strstr(content, "(0x4000): hidden\n");
+    error = strstr(content, "(0x0040): error\n");
+    fail_if(begin == NULL || hidden == NULL || error == NULL,
+            "Backtrace was not dumped [%s]", content);
+    fail_unless(begin < hidden && hidden < error,
+                "Unexpected order of messages [%s]", content);
+
+    /* the recorder is emptied by the dump */
+    DEBUG(SSSDBG_OP_FAILURE, "error\n");
+    content = test_helper_debug_read_file(tmp_ctx, fd);
+    hidden = strstr(content, "hidden");
+    fail_unless(hidden != NULL && strstr(hidden + 1, "hidden") == NULL,
+                "Backtrace was dumped twice [%s]", content);
+
+    ret = debug_set_backtrace_level(0);
+    fail_unless(ret == EOK, "debug_set_backtrace_level failed");
+    fail_if(DEBUG_IS_SET(SSSDBG_TRACE_ALL), "Trace level is set");
+
+    remove(filename);
+    talloc_free(tmp_ctx);
+}
+END_TEST
+
 Suite *debug_suite(void)
 {
     Suite *s = suite_create("debug");
@@ -667,6 +807,8 @@ Suite *debug_suite(void)
     tcase_add_test(tc_debug, test_debug_is_notset_timestamp_microseconds);
     tcase_add_test(tc_debug, test_debug_is_set_true);
     tcase_add_test(tc_debug, test_debug_is_set_false);
+    tcase_add_test(tc_debug, test_debug_buffered);
+    tcase_add_test(tc_debug, test_debug_backtrace);
     tcase_set_timeout(tc_debug, 60);
 
     suite_add_tcase(s, tc_debug);
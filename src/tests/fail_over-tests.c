@@ -23,6 +23,8 @@
 */
 
 #include <arpa/inet.h>
+#include <sys/socket.h>
+#include <unistd.h>
 
 #include <check.h>
 #include <popt.h>
@@ -268,6 +270,84 @@ START_TEST(test_fo_resolve_service)
 }
 END_TEST
 
+static int
+test_bind_localhost(bool do_listen, int *_port)
+{
+    struct sockaddr_in addr;
+    socklen_t addr_len = sizeof(addr);
+    int sd;
+
+    sd = socket(AF_INET, SOCK_STREAM, 0);
+    fail_if(sd == -1, "socket() failed");
+
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    fail_if(bind(sd, (struct sockaddr *) &addr, sizeof(addr)) != 0,
+            "bind() failed");
+    fail_if(getsockname(sd, (struct sockaddr *) &addr, &addr_len) != 0,
+            "getsockname() failed");
+
+    if (do_listen) {
+        fail_if(listen(sd, 5) != 0, "listen() failed");
+    }
+
+    *_port = ntohs(addr.sin_port);
+    return sd;
+}
+
+START_TEST(test_fo_probe_service)
+{
+    struct test_ctx *ctx;
+    struct fo_options fopts;
+    struct fo_service *service;
+    struct fo_server *server;
+    int closed_port;
+    int open_port;
+    int closed_sd;
+    int open_sd;
+
+    ctx = setup_test();
+    fail_if(ctx == NULL);
+
+    memset(&fopts, 0, sizeof(fopts));
+    fopts.retry_timeout = 30;
+    fopts.family_order = IPV4_ONLY;
+    fopts.service_resolv_timeout = 5;
+    fopts.probe_count = 2;
+    fopts.probe_stagger = 100;
+    fopts.probe_timeout = 5;
+
+    ctx->fo_ctx = fo_context_init(ctx, &fopts);
+    fail_if(ctx->fo_ctx == NULL);
+
+    /* Bound but not listening, connecting to it is refused. */
+    closed_sd = test_bind_localhost(false, &closed_port);
+    open_sd = test_bind_localhost(true, &open_port);
+
+    fail_if(fo_new_service(ctx->fo_ctx, "probe", NULL, &service) != EOK);
+    fo_set_service_probe(service, 0);
+
+    fail_if(fo_add_server(service, "127.0.0.1", closed_port,
+                          NULL, true) != EOK);
+    fail_if(fo_add_server(service, "localhost", open_port, NULL, true) != EOK);
+
+    /* The first server refuses the connection, the second one wins. */
+    get_request(ctx, service, EOK, open_port, PORT_WORKING, -1);
+
+    server = fo_get_active_server(service);
+    fail_if(server == NULL, "Missing active server");
+    fail_if(fo_get_server_latency(server) == 0, "Latency was not recorded");
+
+    /* The working server is used without probing. */
+    get_request(ctx, service, EOK, open_port, -1, -1);
+
+    close(closed_sd);
+    close(open_sd);
+    talloc_free(ctx);
+}
+END_TEST
+
 Suite *
 create_suite(void)
 {
@@ -279,6 +359,7 @@ create_suite(void)
     /* Do some testing */
     tcase_add_test(tc, test_fo_new_service);
     tcase_add_test(tc, test_fo_resolve_service);
+    tcase_add_test(tc, test_fo_probe_service);
     if (use_net_test) {
     }
     /* Add all test cases to the test suite */
@@ -0,0 +1,314 @@
+/*
+    SSSD
+
+    Evaluation time of linear and compiled HBAC rule sets
+
+    Copyright (C) 2016 Red Hat
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <inttypes.h>
+#include <time.h>
+#include <popt.h>
+#include <talloc.h>
+
+#include "lib/ipa_hbac/ipa_hbac.h"
+
+#define DEFAULT_RULES 1000
+#define DEFAULT_ITERATIONS 10000
+#define BENCH_GROUPS 50
+#define BENCH_SERVICES 10
+
+struct bench_stats {
+    const char *name;
+    unsigned int count;
+    unsigned int allowed;
+    uint64_t total;
+};
+
+static uint64_t bench_now_usec(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+static void bench_stats_print(struct bench_stats *stats)
+{
+    printf("%-9s %8u requests  %6u allowed  total %10"PRIu64" us  "
+           "avg %8.2f us\n", stats->name, stats->count, stats->allowed,
+           stats->total, (double)stats->total / stats->count);
+}
+
+/* Returns a list with a single formatted string or an empty list if
+ * fmt is NULL. */
+static const char **bench_string_list(TALLOC_CTX *mem_ctx,
+                                      const char *fmt, int num)
+{
+    const char **list;
+
+    list = talloc_zero_array(mem_ctx, const char *, 2);
+    if (list == NULL || fmt == NULL) {
+        return list;
+    }
+
+    list[0] = talloc_asprintf(list, fmt, num);
+    if (list[0] == NULL) {
+        talloc_free(list);
+        return NULL;
+    }
+
+    return list;
+}
+
+static struct hbac_rule_element *bench_element(TALLOC_CTX *mem_ctx,
+                                               const char *name_fmt,
+                                               const char *group_fmt,
+                                               int num)
+{
+    struct hbac_rule_element *el;
+
+    el = talloc_zero(mem_ctx, struct hbac_rule_element);
+    if (el == NULL) {
+        return NULL;
+    }
+
+    if (name_fmt == NULL && group_fmt == NULL) {
+        el->category |= HBAC_CATEGORY_ALL;
+        return el;
+    }
+
+    el->category = HBAC_CATEGORY_NULL;
+    el->names = bench_string_list(el, name_fmt, num);
+    el->groups = bench_string_list(el, group_fmt, num);
+    if (el->names == NULL || el->groups == NULL) {
+        talloc_free(el);
+        return NULL;
+    }
+
+    return el;
+}
+
+/* Every tenth rule grants a service to a user group, the others grant
+ * a service to a single user, all of them on every host. */
+static struct hbac_rule **bench_rules(TALLOC_CTX *mem_ctx, int num_rules)
+{
+    struct hbac_rule **rules;
+    struct hbac_rule *rule;
+    int i;
+
+    rules = talloc_zero_array(mem_ctx, struct hbac_rule *, num_rules + 1);
+    if (rules == NULL) {
+        return NULL;
+    }
+
+    for (i = 0; i < num_rules; i++) {
+        rule = talloc_zero(rules, struct hbac_rule);
+        if (rule == NULL) {
+            return NULL;
+        }
+
+        rule->name = talloc_asprintf(rule, "rule%d", i);
+        rule->enabled = true;
+        if (i % 10 == 0) {
+            rule->users = bench_element(rule, NULL, "group%d",
+                                        i % BENCH_GROUPS);
+        } else {
+            rule->users = bench_element(rule, "user%d", NULL, i);
+        }
+        rule->services = bench_element(rule, "service%d", NULL,
+                                       i % BENCH_SERVICES);
+        rule->targethosts = bench_element(rule, NULL, NULL, 0);
+        rule->srchosts = bench_element(rule, NULL, NULL, 0);
+        if (rule->name == NULL || rule->users == NULL
+                || rule->services == NULL || rule->targethosts == NULL
+                || rule->srchosts == NULL) {
+            return NULL;
+        }
+
+        rules[i] = rule;
+    }
+
+    return rules;
+}
+
+static struct hbac_eval_req *bench_request(TALLOC_CTX *mem_ctx,
+                                           int num_rules, int i)
+{
+    struct hbac_eval_req *req;
+    int user;
+
+    req = talloc_zero(mem_ctx, struct hbac_eval_req);
+    if (req == NULL) {
+        return NULL;
+    }
+
+    req->user = talloc_zero(req, struct hbac_request_element);
+    req->service = talloc_zero(req, struct hbac_request_element);
+    req->targethost = talloc_zero(req, struct hbac_request_element);
+    req->srchost = talloc_zero(req, struct hbac_request_element);
+    if (req->user == NULL || req->service == NULL
+            || req->targethost == NULL || req->srchost == NULL) {
+        talloc_free(req);
+        return NULL;
+    }
+
+    /* Half of the requests come from users without a rule of their own */
+    user = (i * 7919) % (num_rules * 2);
+    req->user->name = talloc_asprintf(req->user, "user%d", user);
+    req->user->groups = bench_string_list(req->user, "group%d",
+                                          user % (BENCH_GROUPS * 2));
+    req->service->name = talloc_asprintf(req->service, "service%d",
+                                         user % BENCH_SERVICES);
+    req->targethost->name = "host.example.com";
+    req->srchost->name = "client.example.com";
+    if (req->user->name == NULL || req->user->groups == NULL
+            || req->service->name == NULL) {
+        talloc_free(req);
+        return NULL;
+    }
+
+    return req;
+}
+
+static int bench_run(int num_rules, int iterations)
+{
+    TALLOC_CTX *tmp_ctx;
+    struct hbac_rule **rules;
+    struct hbac_compiled_rules *compiled = NULL;
+    struct hbac_eval_req **reqs;
+    struct hbac_info *info;
+    struct bench_stats linear = { "linear", 0, 0, 0 };
+    struct bench_stats compiled_stats = { "compiled", 0, 0, 0 };
+    enum hbac_eval_result *results;
+    enum hbac_eval_result result;
+    uint64_t start;
+    int ret = 1;
+    int i;
+
+    tmp_ctx = talloc_new(NULL);
+    if (tmp_ctx == NULL) {
+        return 1;
+    }
+
+    rules = bench_rules(tmp_ctx, num_rules);
+    reqs = talloc_zero_array(tmp_ctx, struct hbac_eval_req *, iterations);
+    results = talloc_zero_array(tmp_ctx, enum hbac_eval_result, iterations);
+    if (rules == NULL || reqs == NULL || results == NULL) {
+        fprintf(stderr, "Out of memory\n");
+        goto done;
+    }
+
+    for (i = 0; i < iterations; i++) {
+        reqs[i] = bench_request(reqs, num_rules, i);
+        if (reqs[i] == NULL) {
+            fprintf(stderr, "Out of memory\n");
+            goto done;
+        }
+    }
+
+    start = bench_now_usec();
+    for (i = 0; i < iterations; i++) {
+        info = NULL;
+        results[i] = hbac_evaluate(rules, reqs[i], &info);
+        hbac_free_info(info);
+    }
+    linear.total = bench_now_usec() - start;
+
+    start = bench_now_usec();
+    if (hbac_compile_rules(rules, &compiled) != HBAC_SUCCESS) {
+        fprintf(stderr, "Cannot compile the rules\n");
+        goto done;
+    }
+    printf("Compiled %d rules in %"PRIu64" us\n",
+           num_rules, bench_now_usec() - start);
+
+    start = bench_now_usec();
+    for (i = 0; i < iterations; i++) {
+        info = NULL;
+        result = hbac_evaluate_compiled(compiled, reqs[i], &info);
+        hbac_free_info(info);
+
+        if (result != results[i]) {
+            fprintf(stderr, "Request %d: linear %s, compiled %s\n", i,
+                    hbac_result_string(results[i]),
+                    hbac_result_string(result));
+            goto done;
+        }
+    }
+    compiled_stats.total = bench_now_usec() - start;
+
+    for (i = 0; i < iterations; i++) {
+        linear.allowed += results[i] == HBAC_EVAL_ALLOW ? 1 : 0;
+    }
+    linear.count = iterations;
+    compiled_stats.count = iterations;
+    compiled_stats.allowed = linear.allowed;
+
+    printf("HBAC evaluation of %d rules:\n", num_rules);
+    bench_stats_print(&linear);
+    bench_stats_print(&compiled_stats);
+
+    ret = 0;
+
+done:
+    hbac_free_compiled_rules(compiled);
+    talloc_free(tmp_ctx);
+    return ret;
+}
+
+int main(int argc, const char *argv[])
+{
+    int opt;
+    poptContext pc;
+    int num_rules = DEFAULT_RULES;
+    int iterations = DEFAULT_ITERATIONS;
+
+    struct poptOption long_options[] = {
+        POPT_AUTOHELP
+        { "rules", 'r', POPT_ARG_INT | POPT_ARGFLAG_SHOW_DEFAULT,
+                    &num_rules, 0,
+                    "Number of HBAC rules", NULL },
+        { "iterations", 'n', POPT_ARG_INT | POPT_ARGFLAG_SHOW_DEFAULT,
+                    &iterations, 0,
+                    "Number of evaluated requests", NULL },
+        POPT_TABLEEND
+    };
+
+    /* parse the params */
+    pc = poptGetContext(argv[0], argc, argv, long_options, 0);
+    while ((opt = poptGetNextOpt(pc)) != -1) {
+        switch (opt) {
+        default:
+            fprintf(stderr, "\nInvalid option %s: %s\n\n",
+                    poptBadOption(pc, 0), poptStrerror(opt));
+            poptPrintUsage(pc, stderr, 0);
+            return 1;
+        }
+    }
+    poptFreeContext(pc);
+
+    if (num_rules <= 0 || iterations <= 0) {
+        fprintf(stderr,
+                "The number of rules and iterations must be positive\n");
+        return 1;
+    }
+
+    return bench_run(num_rules, iterations);
+}
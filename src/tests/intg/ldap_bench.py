@@ -0,0 +1,311 @@
+#
+# SSSD LDAP provider benchmark
+#
+# Copyright (c) 2016 Red Hat, Inc.
+#
+# This is free software; you can redistribute it and/or modify it
+# under the terms of the GNU General Public License as published by
+# the Free Software Foundation; version 2 only
+#
+# This program is distributed in the hope that it will be useful, but
+# WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+# General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program.  If not, see <http://www.gnu.org/licenses/>.
+#
+"""
+Fills a local slapd with a synthetic directory and measures how the LDAP
+provider copes with it. The directory has a configurable number of users
+and groups. With RFC2307bis the groups form trees with the given nesting
+depth and fan-out, every user is a member of one or more of them.
+
+Every scenario runs against a freshly started SSSD with an empty cache:
+
+    enumeration     waits for the first enumeration of the domain
+    initgroups      looks up the groups of every user
+    nested_group    looks up the top-level group of every tree
+
+For every scenario the harness reports the wall time, the number and the
+average time of the matching LDAP provider requests
+(sdap_dom_enum_ex_send, sdap_get_initgr_send, sdap_nested_group_send), the
+LDAP operations by result type, the number of sysdb transactions, the
+growth of the cache files and the peak RSS of sssd_be. The backend
+counters are read from the performance statistics it logs on SIGUSR2.
+
+Run through "make intgbench-ldap-run", which sets up the same environment
+as the integration tests.
+"""
+import os
+import re
+import sys
+import grp
+import json
+import time
+import signal
+import argparse
+import config
+import ds_openldap
+import ldap_ent
+import sssd_id
+from util import unindent
+from test_ldap import create_conf_file, cleanup_conf_file, \
+    create_sssd_process, cleanup_sssd_process, \
+    SCHEMA_RFC2307, SCHEMA_RFC2307_BIS
+
+LDAP_BASE_DN = "dc=example,dc=com"
+DOMAIN = "LDAP"
+UID_BASE = 100000
+GID_BASE = 200000
+USER_FMT = "bench_user%d"
+GROUP_FMT = "bench_group%d"
+
+SCENARIOS = ["enumeration", "initgroups", "nested_group"]
+
+PERF_LINE_RE = re.compile(r"(counter|histogram)=(\S+) (.*)$")
+
+
+class Shape(object):
+    """Users and groups of the synthetic directory"""
+
+    def __init__(self, users, groups, depth, fanout, memberships):
+        self.users = users
+        self.groups = groups
+        self.depth = depth
+        self.fanout = fanout
+        self.memberships = min(memberships, groups)
+        self.tree_size = sum(fanout ** level for level in range(depth + 1))
+
+    def child_groups(self, g):
+        """Groups directly nested in group g"""
+        pos = g % self.tree_size
+        root = g - pos
+        children = []
+        for child in range(pos * self.fanout + 1,
+                           pos * self.fanout + self.fanout + 1):
+            if child < self.tree_size and root + child < self.groups:
+                children.append(root + child)
+        return children
+
+    def top_groups(self):
+        """Roots of the group trees"""
+        return range(0, self.groups, self.tree_size)
+
+    def user_groups(self, u):
+        """Groups user u is a direct member of"""
+        return sorted(set((u * self.memberships + k) % self.groups
+                          for k in range(self.memberships)))
+
+
+def create_directory(ldap_conn, shape, schema):
+    members = dict((g, []) for g in range(shape.groups))
+    ent_list = ldap_ent.List(LDAP_BASE_DN)
+    for u in range(shape.users):
+        user_groups = shape.user_groups(u)
+        ent_list.add_user(USER_FMT % u, UID_BASE + u,
+                          GID_BASE + user_groups[0])
+        for g in user_groups:
+            members[g].append(USER_FMT % u)
+
+    for g in range(shape.groups):
+        if schema == SCHEMA_RFC2307_BIS:
+            ent_list.add_group_bis(GROUP_FMT % g, GID_BASE + g, members[g],
+                                   [GROUP_FMT % c
+                                    for c in shape.child_groups(g)])
+        else:
+            ent_list.add_group(GROUP_FMT % g, GID_BASE + g, members[g])
+
+    for entry in ent_list:
+        ldap_conn.add_s(entry[0], entry[1])
+
+
+def format_conf(ldap_conn, schema, depth, enumerate):
+    schema_conf = "ldap_schema         = " + schema + "\n"
+    if schema == SCHEMA_RFC2307_BIS:
+        schema_conf += "ldap_group_object_class = groupOfNames\n"
+    return unindent("""\
+        [sssd]
+        domains             = {DOMAIN}
+        services            = nss
+
+        [nss]
+        memcache_timeout    = 0
+
+        [domain/{DOMAIN}]
+        debug_level         = 0x0070
+        {schema_conf}
+        id_provider         = ldap
+        ldap_uri            = {ldap_conn.ds_inst.ldap_url}
+        ldap_search_base    = {ldap_conn.ds_inst.base_dn}
+        ldap_group_nesting_level = {depth}
+        enumerate           = {enumerate}
+    """).format(DOMAIN=DOMAIN, **locals())
+
+
+def sssd_be_pid():
+    for pid in os.listdir("/proc"):
+        if not pid.isdigit():
+            continue
+        try:
+            with open("/proc/%s/cmdline" % pid) as cmdline_file:
+                cmdline = cmdline_file.read().split("\0")
+        except IOError:
+            continue
+        if os.path.basename(cmdline[0]) == "sssd_be" and DOMAIN in cmdline:
+            return int(pid)
+    raise Exception("sssd_be is not running")
+
+
+def peak_rss_kb(pid):
+    with open("/proc/%d/status" % pid) as status_file:
+        for line in status_file:
+            if line.startswith("VmHWM:"):
+                return int(line.split()[1])
+    return 0
+
+
+def cache_size():
+    size = 0
+    for name in ("cache_%s.ldb" % DOMAIN, "timestamps_%s.ldb" % DOMAIN):
+        path = os.path.join(config.DB_PATH, name)
+        if os.path.exists(path):
+            size += os.path.getsize(path)
+    return size
+
+
+def perf_stats(pid):
+    """
+    Make sssd_be log its performance statistics and parse them. Returns
+    ({counter: value}, {histogram: {field: value}}).
+    """
+    log_path = os.path.join(config.LOG_PATH, "sssd_%s.log" % DOMAIN)
+    offset = os.path.getsize(log_path) if os.path.exists(log_path) else 0
+    os.kill(pid, signal.SIGUSR2)
+    time.sleep(1)
+
+    counters = dict()
+    histograms = dict()
+    with open(log_path) as log_file:
+        log_file.seek(offset)
+        for line in log_file:
+            match = PERF_LINE_RE.search(line)
+            if match is None:
+                continue
+            fields = dict(item.split("=", 1)
+                          for item in match.group(3).split())
+            if match.group(1) == "counter":
+                counters[match.group(2)] = int(fields["value"])
+            else:
+                histograms[match.group(2)] = fields
+    return counters, histograms
+
+
+def wait_for_enumeration(pid, timeout):
+    deadline = time.time() + timeout
+    while time.time() < deadline:
+        histograms = perf_stats(pid)[1]
+        if "sdap_req:enumeration" in histograms:
+            return
+    raise Exception("Enumeration did not finish in %d seconds" % timeout)
+
+
+def run_scenario(ldap_conn, args, shape, scenario):
+    create_conf_file(format_conf(ldap_conn, args.schema, args.depth,
+                                 scenario == "enumeration"))
+    try:
+        create_sssd_process()
+        pid = sssd_be_pid()
+        size_before = cache_size()
+
+        start = time.time()
+        if scenario == "enumeration":
+            wait_for_enumeration(pid, args.timeout)
+        elif scenario == "initgroups":
+            for u in range(shape.users):
+                sssd_id.call_sssd_initgroups(USER_FMT % u, GID_BASE)
+        else:
+            for g in shape.top_groups():
+                grp.getgrnam(GROUP_FMT % g)
+        wall_sec = time.time() - start
+
+        counters, histograms = perf_stats(pid)
+        result = dict(
+            wall_sec=round(wall_sec, 3),
+            sysdb_commits=counters.get("sysdb_commit", 0),
+            cache_bytes=cache_size() - size_before,
+            peak_rss_kb=peak_rss_kb(pid))
+        request = histograms.get("sdap_req:" + scenario, {})
+        result["requests"] = int(request.get("count", 0))
+        result["request_avg_usec"] = int(request.get("avg_usec", 0))
+        result["request_max_usec"] = int(request.get("max_usec", 0))
+        for name, fields in histograms.items():
+            if name.startswith("ldap_op:"):
+                result[name.replace(":", "_")] = int(fields["count"])
+    finally:
+        cleanup_sssd_process()
+        cleanup_conf_file()
+
+    return result
+
+
+def main():
+    parser = argparse.ArgumentParser(description="SSSD LDAP provider "
+                                                 "benchmark")
+    parser.add_argument("--users", type=int, default=1000)
+    parser.add_argument("--groups", type=int, default=100)
+    parser.add_argument("--depth", type=int, default=2,
+                        help="group nesting depth, RFC2307bis only")
+    parser.add_argument("--fanout", type=int, default=3,
+                        help="groups nested in every group, RFC2307bis only")
+    parser.add_argument("--memberships", type=int, default=2,
+                        help="groups every user is a direct member of")
+    parser.add_argument("--schema", default=SCHEMA_RFC2307_BIS,
+                        choices=[SCHEMA_RFC2307, SCHEMA_RFC2307_BIS])
+    parser.add_argument("--scenario", action="append", choices=SCENARIOS,
+                        help="scenario to run, all of them by default")
+    parser.add_argument("--timeout", type=int, default=600,
+                        help="seconds to wait for the enumeration")
+    parser.add_argument("--save", help="write the results to this file")
+    args = parser.parse_args()
+
+    if args.users <= 0 or args.groups <= 0 or args.depth < 0 or \
+       args.fanout <= 0 or args.memberships <= 0:
+        parser.error("the directory shape must be positive")
+    if args.schema == SCHEMA_RFC2307:
+        args.depth = 0
+
+    shape = Shape(args.users, args.groups, args.depth, args.fanout,
+                  args.memberships)
+
+    ds_inst = ds_openldap.DSOpenLDAP(config.PREFIX, 10389, LDAP_BASE_DN,
+                                     "cn=admin", "Secret123")
+    results = dict()
+    try:
+        ds_inst.setup()
+        ldap_conn = ds_inst.bind()
+        ldap_conn.ds_inst = ds_inst
+        create_directory(ldap_conn, shape, args.schema)
+
+        for scenario in args.scenario or SCENARIOS:
+            result = run_scenario(ldap_conn, args, shape, scenario)
+            results[scenario] = result
+            sys.stdout.write("scenario=%s schema=%s users=%d groups=%d "
+                             "depth=%d fanout=%d %s\n" %
+                             (scenario, args.schema, args.users, args.groups,
+                              args.depth, args.fanout,
+                              " ".join("%s=%s" % item
+                                       for item in sorted(result.items()))))
+        ldap_conn.unbind_s()
+    finally:
+        ds_inst.teardown()
+
+    if args.save:
+        with open(args.save, "w") as save_file:
+            json.dump(results, save_file, indent=4, sort_keys=True)
+
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
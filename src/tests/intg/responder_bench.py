@@ -0,0 +1,196 @@
+#
+# SSSD responder benchmark
+#
+# Copyright (c) 2016 Red Hat, Inc.
+#
+# This is free software; you can redistribute it and/or modify it
+# under the terms of the GNU General Public License as published by
+# the Free Software Foundation; version 2 only
+#
+# This program is distributed in the hope that it will be useful, but
+# WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+# General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program.  If not, see <http://www.gnu.org/licenses/>.
+#
+"""
+Runs the responder-bench load generator against the NSS and PAM responders
+serving a pre-populated LOCAL domain, once with and once without the memory
+cache. The results can be saved as a baseline and later runs compared with
+it, a run is a regression when the throughput of an operation drops or its
+p99 latency grows by more than the tolerance.
+
+Run through "make intgbench-run", which sets up the same environment as
+the integration tests.
+"""
+import os
+import sys
+import stat
+import crypt
+import json
+import argparse
+import subprocess
+import config
+import sssd_ldb
+from test_local_domain import stop_sssd
+from util import unindent
+
+DOMAIN = "LOCAL"
+UID_BASE = 20000
+GID_BASE = 30000
+USER_FMT = "bench_user%d"
+GROUP_FMT = "bench_group%d"
+PASSWORD = "Secret123"
+
+MODES = [("memcache", []), ("no_memcache", ["--no-memcache"])]
+
+
+def write_conf():
+    conf = unindent("""\
+        [sssd]
+        domains             = {DOMAIN}
+        services            = nss, pam
+
+        [nss]
+        memcache_timeout    = 300
+
+        [pam]
+
+        [domain/{DOMAIN}]
+        id_provider         = local
+        min_id              = {UID_BASE}
+        max_id              = {max_id}
+    """).format(DOMAIN=DOMAIN, UID_BASE=UID_BASE, max_id=GID_BASE * 2)
+    conf_file = open(config.CONF_PATH, "w")
+    conf_file.write(conf)
+    conf_file.close()
+    os.chmod(config.CONF_PATH, stat.S_IRUSR | stat.S_IWUSR)
+
+
+def cleanup():
+    try:
+        stop_sssd()
+    except:
+        pass
+    for path in os.listdir(config.DB_PATH):
+        os.unlink(config.DB_PATH + "/" + path)
+    for path in os.listdir(config.MCACHE_PATH):
+        os.unlink(config.MCACHE_PATH + "/" + path)
+    if os.path.exists(config.CONF_PATH):
+        os.unlink(config.CONF_PATH)
+
+
+def populate(num_users, num_groups):
+    """Every user is a member of two groups and has the same password"""
+    for i in range(num_groups):
+        subprocess.check_call(["sss_groupadd", "-g", str(GID_BASE + i),
+                               GROUP_FMT % i])
+
+    pwhash = crypt.crypt(PASSWORD, "$6$benchsalt$")
+    ldb_conn = sssd_ldb.SssdLdb(DOMAIN)
+    for i in range(num_users):
+        name = USER_FMT % i
+        groups = "%s,%s" % (GROUP_FMT % (i % num_groups),
+                            GROUP_FMT % ((i + 1) % num_groups))
+        subprocess.check_call(["sss_useradd", "-M", "-u", str(UID_BASE + i),
+                               "-G", groups, name])
+        ldb_conn.set_entry_attr(sssd_ldb.CacheType.sysdb,
+                                sssd_ldb.TsCacheEntry.user,
+                                name, DOMAIN, "userPassword", pwhash)
+
+
+def run_bench(args, extra_args):
+    """Returns {op: {metric: value}} parsed from the responder-bench output"""
+    cmd = [args.bench,
+           "--clients", str(args.clients),
+           "--duration", str(args.duration),
+           "--users", str(args.users),
+           "--groups", str(args.groups),
+           "--uid-base", str(UID_BASE),
+           "--user-format", USER_FMT,
+           "--group-format", GROUP_FMT,
+           "--password", PASSWORD]
+    if args.mix:
+        cmd += ["--mix", args.mix]
+    output = subprocess.check_output(cmd + extra_args)
+    sys.stdout.write(output)
+
+    results = dict()
+    for line in output.splitlines():
+        fields = dict(item.split("=", 1) for item in line.split())
+        if "op" not in fields:
+            continue
+        op = fields.pop("op")
+        results[op] = dict((k, float(v)) for k, v in fields.items())
+    return results
+
+
+def compare(results, baseline, tolerance):
+    """Returns the list of regressions against the baseline"""
+    regressions = []
+    for mode, ops in baseline.items():
+        for op, base in ops.items():
+            cur = results.get(mode, {}).get(op)
+            if cur is None:
+                continue
+            if cur["ops_per_sec"] < base["ops_per_sec"] * (1 - tolerance):
+                regressions.append("%s %s: %.2f ops/s, baseline %.2f" %
+                                   (mode, op, cur["ops_per_sec"],
+                                    base["ops_per_sec"]))
+            if "p99_usec" in base and \
+               cur["p99_usec"] > base["p99_usec"] * (1 + tolerance):
+                regressions.append("%s %s: p99 %d us, baseline %d us" %
+                                   (mode, op, cur["p99_usec"],
+                                    base["p99_usec"]))
+    return regressions
+
+
+def main():
+    parser = argparse.ArgumentParser(description="SSSD responder benchmark")
+    parser.add_argument("--bench", required=True,
+                        help="path to the responder-bench program")
+    parser.add_argument("--clients", type=int, default=8)
+    parser.add_argument("--duration", type=int, default=10)
+    parser.add_argument("--users", type=int, default=1000)
+    parser.add_argument("--groups", type=int, default=100)
+    parser.add_argument("--mix", help="operation weights, see "
+                                      "responder-bench --help")
+    parser.add_argument("--baseline", help="compare with this result file")
+    parser.add_argument("--tolerance", type=float, default=0.2,
+                        help="allowed relative regression")
+    parser.add_argument("--save", help="write the results to this file")
+    args = parser.parse_args()
+
+    write_conf()
+    try:
+        if subprocess.call(["sssd", "-D", "-f"]) != 0:
+            raise Exception("sssd start failed")
+        populate(args.users, args.groups)
+
+        results = dict()
+        for mode, extra_args in MODES:
+            sys.stdout.write("# %s\n" % mode)
+            results[mode] = run_bench(args, extra_args)
+    finally:
+        cleanup()
+
+    if args.save:
+        with open(args.save, "w") as save_file:
+            json.dump(results, save_file, indent=4, sort_keys=True)
+
+    if args.baseline:
+        with open(args.baseline) as baseline_file:
+            baseline = json.load(baseline_file)
+        regressions = compare(results, baseline, args.tolerance)
+        for regression in regressions:
+            sys.stderr.write("Regression: %s\n" % regression)
+        if regressions:
+            return 1
+
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -84,3 +84,13 @@ class SssdLdb(object):
             return None
 
         return res.msgs[0].get(attr).get(0)
+
+    def set_entry_attr(self, cache_type, entry_type, name, domain, attr,
+                       value):
+        dbconn = self._get_dbconn(cache_type)
+        basedn = self._basedn(name, domain, entry_type)
+
+        msg = ldb.Message()
+        msg.dn = ldb.Dn(dbconn, basedn)
+        msg[attr] = ldb.MessageElement(value, ldb.FLAG_MOD_REPLACE, attr)
+        dbconn.modify(msg)
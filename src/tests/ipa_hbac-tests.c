@@ -20,6 +20,7 @@
     along with this program.  If not, see <http://www.gnu.org/licenses/>.
 */
 #include <stdlib.h>
+#include <string.h>
 #include <check.h>
 #include <unistd.h>
 #include <sys/types.h>
@@ -843,6 +844,174 @@ START_TEST(ipa_hbac_test_incomplete)
 }
 END_TEST
 
+static void compiled_eval_check(struct hbac_rule **rules,
+                                struct hbac_eval_req *eval_req,
+                                enum hbac_eval_result expected,
+                                const char *expected_rule)
+{
+    enum hbac_eval_result result;
+    struct hbac_compiled_rules *compiled = NULL;
+    struct hbac_info *info = NULL;
+    enum hbac_error_code code;
+
+    code = hbac_compile_rules(rules, &compiled);
+    fail_unless(code == HBAC_SUCCESS);
+
+    result = hbac_evaluate_compiled(compiled, eval_req, &info);
+    fail_unless(result == expected,
+                "Expected [%s], got [%s]; "
+                "Error: [%s]",
+                hbac_result_string(expected),
+                hbac_result_string(result),
+                info ? hbac_error_string(info->code):"Unknown");
+    if (expected_rule != NULL) {
+        fail_if(info->rule_name == NULL);
+        fail_unless(strcmp(info->rule_name, expected_rule) == 0,
+                    "Expected rule [%s], got [%s]",
+                    expected_rule, info->rule_name);
+    }
+    hbac_free_info(info);
+    info = NULL;
+
+    /* The compiled rules must give the same result as the plain ones */
+    result = hbac_evaluate(rules, eval_req, &info);
+    fail_unless(result == expected,
+                "Expected [%s], got [%s]; "
+                "Error: [%s]",
+                hbac_result_string(expected),
+                hbac_result_string(result),
+                info ? hbac_error_string(info->code):"Unknown");
+    hbac_free_info(info);
+
+    hbac_free_compiled_rules(compiled);
+}
+
+START_TEST(ipa_hbac_test_compiled)
+{
+    TALLOC_CTX *test_ctx;
+    struct hbac_rule **rules;
+    struct hbac_eval_req *eval_req;
+    const char *other_users[] = { "otheruser", NULL };
+    const char *user_names[] = { "TestUser", NULL };
+    const char *group_names[] = { HBAC_TEST_GROUP2, NULL };
+    const char *svc_groups[] = { HBAC_TEST_SERVICEGROUP1, NULL };
+    const char *utf8_users[] = { (const char *) user_utf8_upcase, NULL };
+    const char *malformed_users[] = { "\xff\xfeuser", NULL };
+    const char *other_svcs[] = { "otherservice", NULL };
+    const char *svc_names[] = { HBAC_TEST_SERVICE, NULL };
+    struct hbac_rule **malformed;
+    struct hbac_info *info = NULL;
+    enum hbac_eval_result result;
+
+    test_ctx = talloc_new(global_talloc_context);
+
+    /* Create a request */
+    eval_req = talloc_zero(test_ctx, struct hbac_eval_req);
+    fail_if (eval_req == NULL);
+
+    get_test_user(eval_req, &eval_req->user);
+    get_test_service(eval_req, &eval_req->service);
+    get_test_srchost(eval_req, &eval_req->srchost);
+    get_test_srchost(eval_req, &eval_req->targethost);
+
+    /* Create the rules to evaluate against */
+    rules = talloc_array(test_ctx, struct hbac_rule *, 6);
+    fail_if (rules == NULL);
+
+    /* Matches another user only */
+    get_allow_all_rule(rules, &rules[0]);
+    rules[0]->name = "Other user";
+    rules[0]->users->category = HBAC_CATEGORY_NULL;
+    rules[0]->users->names = other_users;
+
+    /* Matches the user case-insensitively, but is disabled */
+    get_allow_all_rule(rules, &rules[1]);
+    rules[1]->name = "Disabled";
+    rules[1]->enabled = false;
+    rules[1]->users->category = HBAC_CATEGORY_NULL;
+    rules[1]->users->names = user_names;
+
+    /* Matches the user's group, but not the service group */
+    get_allow_all_rule(rules, &rules[2]);
+    rules[2]->name = "Group, other services";
+    rules[2]->users->category = HBAC_CATEGORY_NULL;
+    rules[2]->users->groups = group_names;
+    rules[2]->services->category = HBAC_CATEGORY_NULL;
+    rules[2]->services->groups = other_users;
+
+    /* Matches a non-ASCII user name only */
+    get_allow_all_rule(rules, &rules[3]);
+    rules[3]->name = "UTF-8 user";
+    rules[3]->users->category = HBAC_CATEGORY_NULL;
+    rules[3]->users->names = utf8_users;
+
+    /* Matches the user's group and the service group */
+    get_allow_all_rule(rules, &rules[4]);
+    rules[4]->name = "Group and service group";
+    rules[4]->users->category = HBAC_CATEGORY_NULL;
+    rules[4]->users->groups = group_names;
+    rules[4]->services->category = HBAC_CATEGORY_NULL;
+    rules[4]->services->groups = svc_groups;
+
+    rules[5] = NULL;
+
+    compiled_eval_check(rules, eval_req, HBAC_EVAL_ALLOW,
+                        "Group and service group");
+
+    /* Enabling the rule with the user name makes it match first */
+    rules[1]->enabled = true;
+    compiled_eval_check(rules, eval_req, HBAC_EVAL_ALLOW, "Disabled");
+
+    /* A non-ASCII user is only matched by the non-ASCII rule */
+    eval_req->user->name = (const char *) user_utf8_lowcase;
+    eval_req->user->groups[0] = NULL;
+    compiled_eval_check(rules, eval_req, HBAC_EVAL_ALLOW, "UTF-8 user");
+
+    /* Nothing matches */
+    eval_req->user->name = HBAC_TEST_INVALID_USER;
+    compiled_eval_check(rules, eval_req, HBAC_EVAL_DENY, NULL);
+
+    /* An incomplete rule is reported even though it is not indexed */
+    rules[0]->srchosts = NULL;
+    compiled_eval_check(rules, eval_req, HBAC_EVAL_ERROR, NULL);
+
+    /* A rule with a name that is not valid UTF-8 is evaluated even though
+     * the service index alone would skip it */
+    malformed = talloc_array(test_ctx, struct hbac_rule *, 3);
+    fail_if (malformed == NULL);
+
+    get_allow_all_rule(malformed, &malformed[0]);
+    malformed[0]->name = "Malformed user";
+    malformed[0]->users->category = HBAC_CATEGORY_NULL;
+    malformed[0]->users->names = malformed_users;
+    malformed[0]->services->category = HBAC_CATEGORY_NULL;
+    malformed[0]->services->names = other_svcs;
+
+    get_allow_all_rule(malformed, &malformed[1]);
+    malformed[1]->name = "Service";
+    malformed[1]->services->category = HBAC_CATEGORY_NULL;
+    malformed[1]->services->names = svc_names;
+
+    malformed[2] = NULL;
+
+    /* Whether the comparison fails depends on the Unicode library, the
+     * compiled rules must only agree with the plain evaluation */
+    result = hbac_evaluate(malformed, eval_req, &info);
+    hbac_free_info(info);
+    info = NULL;
+    compiled_eval_check(malformed, eval_req, result, NULL);
+
+    /* The same holds for a request with a malformed name */
+    malformed[0]->users->names = other_users;
+    eval_req->user->name = "\xff\xfeuser";
+    result = hbac_evaluate(malformed, eval_req, &info);
+    hbac_free_info(info);
+    compiled_eval_check(malformed, eval_req, result, NULL);
+
+    talloc_free(test_ctx);
+}
+END_TEST
+
 Suite *hbac_test_suite (void)
 {
     Suite *s = suite_create ("HBAC");
@@ -861,6 +1030,7 @@ Suite *hbac_test_suite (void)
     tcase_add_test(tc_hbac, ipa_hbac_test_allow_srchostgroup);
     tcase_add_test(tc_hbac, ipa_hbac_test_allow_utf8);
     tcase_add_test(tc_hbac, ipa_hbac_test_incomplete);
+    tcase_add_test(tc_hbac, ipa_hbac_test_compiled);
 
     suite_add_tcase(s, tc_hbac);
     return s;
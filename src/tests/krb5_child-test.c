@@ -29,6 +29,7 @@
 #include <errno.h>
 #include <unistd.h>
 #include <limits.h>
+#include <time.h>
 
 #include "util/util.h"
 #include "src/tools/tools_util.h"
@@ -387,9 +388,15 @@ main(int argc, const char *argv[])
     errno_t ret;
     struct krb5_child_test_ctx *ctx = NULL;
     struct tevent_req *req;
+    struct timespec start;
+    struct timespec end;
+    double elapsed;
+    int i;
 
     int pc_debug = 0;
     int pc_timeout = 0;
+    int pc_iterations = 1;
+    int pc_pool_size = 0;
     const char *pc_user = NULL;
     const char *pc_passwd = NULL;
     const char *pc_realm = NULL;
@@ -419,6 +426,11 @@ main(int argc, const char *argv[])
           "Do not delete the ccache when the tool finishes", NULL },
         { "timeout", '\0', POPT_ARG_INT, &pc_timeout, 0,
           "The timeout for the child, in seconds", NULL },
+        { "iterations", 'n', POPT_ARG_INT, &pc_iterations, 0,
+          "Authenticate repeatedly and report the throughput", NULL },
+        { "pool-size", '\0', POPT_ARG_INT, &pc_pool_size, 0,
+          "Use a pool of krb5_child workers instead of forking "
+          "a new krb5_child for every request", NULL },
         POPT_TABLEEND
     };
 
@@ -470,6 +482,13 @@ main(int argc, const char *argv[])
         return 1;
     }
 
+    if (pc_iterations <= 0) {
+        DEBUG(SSSDBG_FATAL_FAILURE,
+              "The number of iterations must be positive\n");
+        poptPrintUsage(pc, stderr, 0);
+        return 1;
+    }
+
     if (pc_ccname && pc_ccname_tp) {
         DEBUG(SSSDBG_MINOR_FAILURE,
               "Both ccname and ccname template specified, "
@@ -491,20 +510,55 @@ main(int argc, const char *argv[])
         goto done;
     }
 
-    req = handle_child_send(ctx, ctx->ev, ctx->kr);
-    if (!req) {
-        DEBUG(SSSDBG_FATAL_FAILURE, "Cannot create child request\n");
-        ret = 4;
-        goto done;
+    if (pc_pool_size > 0) {
+        ret = dp_opt_set_int(ctx->kr->krb5_ctx->opts, KRB5_CHILD_POOL_SIZE,
+                             pc_pool_size);
+        if (ret == EOK) {
+            ret = krb5_child_pool_init(ctx->kr->krb5_ctx, ctx->ev);
+        }
+        if (ret != EOK) {
+            DEBUG(SSSDBG_FATAL_FAILURE, "Cannot set up krb5_child pool\n");
+            ret = 4;
+            goto done;
+        }
     }
-    tevent_req_set_callback(req, child_done, ctx);
 
-    while (ctx->done == false) {
-         tevent_loop_once(ctx->ev);
+    clock_gettime(CLOCK_MONOTONIC, &start);
+
+    for (i = 0; i < pc_iterations; i++) {
+        ctx->done = false;
+        talloc_zfree(ctx->buf);
+
+        req = handle_child_send(ctx, ctx->ev, ctx->kr);
+        if (!req) {
+            DEBUG(SSSDBG_FATAL_FAILURE, "Cannot create child request\n");
+            ret = 4;
+            goto done;
+        }
+        tevent_req_set_callback(req, child_done, ctx);
+
+        while (ctx->done == false) {
+             tevent_loop_once(ctx->ev);
+        }
+
+        if (ctx->child_ret != EOK) {
+            break;
+        }
     }
 
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
     printf("Child returned %d\n", ctx->child_ret);
 
+    if (pc_iterations > 1) {
+        elapsed = (end.tv_sec - start.tv_sec)
+                  + (end.tv_nsec - start.tv_nsec) / 1e9;
+        printf("%d requests %s in %.3f s, %.2f requests/s\n", i,
+               pc_pool_size > 0 ? "served by the krb5_child pool"
+                                : "with a forked krb5_child each",
+               elapsed, elapsed > 0 ? i / elapsed : 0);
+    }
+
     ret = parse_krb5_child_response(ctx, ctx->buf, ctx->len,
                                     ctx->kr->pd, 0, &ctx->res);
     if (ret != EOK) {
@@ -463,6 +463,67 @@ class PyHbacRequestTest(unittest.TestCase):
         # catch invalid rule type
         self.assertRaises(TypeError, req.evaluate, (allow_rule, None))
 
+    def testEvaluateCompiled(self):
+        name = "someuser"
+        service = "ssh"
+        srchost = "host1"
+        targethost = "host2"
+
+        other_rule = pyhbac.HbacRule("otherRule", enabled=True)
+        other_rule.users.names = [ "someotheruser" ]
+        other_rule.services.names = [ service ]
+        other_rule.srchosts.names = [ srchost ]
+        other_rule.targethosts.names = [ targethost ]
+
+        allow_rule = pyhbac.HbacRule("allowRule", enabled=True)
+        allow_rule.users.names = [ name ]
+        allow_rule.services.names = [ service ]
+        allow_rule.srchosts.names = [ srchost ]
+        allow_rule.targethosts.names = [ targethost ]
+
+        compiled = pyhbac.HbacCompiledRules((other_rule, allow_rule))
+
+        req = pyhbac.HbacRequest()
+        req.user.name = name
+        req.service.name = service
+        req.srchost.name = srchost
+        req.targethost.name = targethost
+
+        res = req.evaluate_compiled(compiled)
+        self.assertEqual(res, pyhbac.HBAC_EVAL_ALLOW)
+        self.assertEqual(req.rule_name, "allowRule")
+
+        # Test that a user not in any rule is not allowed
+        req.user.name = "nosuchuser"
+        res = req.evaluate_compiled(compiled)
+        self.assertEqual(res, pyhbac.HBAC_EVAL_DENY)
+        self.assertEqual(req.rule_name, None)
+
+        # The rules were copied, changing them requires recompiling
+        allow_rule.users.category.add(pyhbac.HBAC_CATEGORY_ALL)
+        res = req.evaluate_compiled(compiled)
+        self.assertEqual(res, pyhbac.HBAC_EVAL_DENY)
+
+        compiled = pyhbac.HbacCompiledRules((other_rule, allow_rule))
+        res = req.evaluate_compiled(compiled)
+        self.assertEqual(res, pyhbac.HBAC_EVAL_ALLOW)
+        self.assertEqual(req.rule_name, "allowRule")
+
+        # Both evaluations must agree
+        self.assertEqual(req.evaluate((other_rule, allow_rule)), res)
+
+    def testEvaluateCompiledNegative(self):
+        allow_rule = pyhbac.HbacRule("allowRule", enabled=True)
+        req = pyhbac.HbacRequest()
+
+        # catch invalid rule type
+        self.assertRaises(TypeError, pyhbac.HbacCompiledRules,
+                          (allow_rule, None))
+        self.assertRaises(TypeError, pyhbac.HbacCompiledRules, None)
+
+        # catch invalid compiled rules type
+        self.assertRaises(TypeError, req.evaluate_compiled, (allow_rule,))
+
 class PyHbacModuleTest(unittest.TestCase):
     @classmethod
     def tearDownClass(cls):
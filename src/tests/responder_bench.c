@@ -0,0 +1,615 @@
+/*
+    SSSD
+
+    Throughput and latency of the NSS and PAM responders
+
+    Copyright (C) 2016 Red Hat
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/*
+ * Every client is a separate process that talks to the running responders
+ * through the sss_client code, the same way libnss_sss and pam_sss do. The
+ * operations are picked randomly according to the requested mix and the
+ * latency of each one is recorded in a histogram. When the run is over the
+ * clients send their histograms to the parent which merges and prints them.
+ *
+ * The users and groups must already exist, src/tests/intg/responder_bench.py
+ * creates them and compares the results with a baseline.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <inttypes.h>
+#include <time.h>
+#include <nss.h>
+#include <pwd.h>
+#include <grp.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <security/pam_appl.h>
+#include <popt.h>
+#include <talloc.h>
+
+#include "util/util.h"
+#include "util/atomic_io.h"
+#include "util/sss_perf.h"
+#include "sss_client/sss_cli.h"
+#include "sss_client/pam_message.h"
+
+#define DEFAULT_CLIENTS 8
+#define DEFAULT_DURATION 10
+#define DEFAULT_WARMUP 2
+#define DEFAULT_USERS 1000
+#define DEFAULT_GROUPS 100
+#define DEFAULT_UID_BASE 20000
+#define DEFAULT_MIX "getpwnam=4,getpwuid=2,initgroups=2,getgrnam=1," \
+                    "pam_auth=1,pam_acct=1"
+
+#define BENCH_BUFSIZE 4096
+
+/* The NSS entry points are exported by libnss_sss only. */
+enum nss_status _nss_sss_getpwnam_r(const char *name, struct passwd *result,
+                                    char *buffer, size_t buflen,
+                                    int *errnop);
+enum nss_status _nss_sss_getpwuid_r(uid_t uid, struct passwd *result,
+                                    char *buffer, size_t buflen,
+                                    int *errnop);
+enum nss_status _nss_sss_getgrnam_r(const char *name, struct group *result,
+                                    char *buffer, size_t buflen,
+                                    int *errnop);
+enum nss_status _nss_sss_initgroups_dyn(const char *user, gid_t group,
+                                        long int *start, long int *size,
+                                        gid_t **groups, long int limit,
+                                        int *errnop);
+
+/* Connection state of sss_client, see common.c. */
+extern int sss_cli_sd;
+extern struct stat sss_cli_sb;
+
+enum bench_op {
+    BENCH_GETPWNAM,
+    BENCH_GETPWUID,
+    BENCH_INITGROUPS,
+    BENCH_GETGRNAM,
+    BENCH_PAM_AUTH,
+    BENCH_PAM_ACCT,
+
+    BENCH_OP_SENTINEL
+};
+
+static const char *bench_op_names[] = {
+    "getpwnam",
+    "getpwuid",
+    "initgroups",
+    "getgrnam",
+    "pam_auth",
+    "pam_acct",
+};
+
+struct bench_opts {
+    int num_users;
+    int num_groups;
+    int uid_base;
+    const char *user_fmt;
+    const char *group_fmt;
+    const char *password;
+    const char *pam_service;
+    unsigned int weights[BENCH_OP_SENTINEL];
+    unsigned int total_weight;
+};
+
+/* Sent from a client to the parent when the run is over. */
+struct bench_result {
+    uint64_t errors[BENCH_OP_SENTINEL];
+    struct sss_perf_hist hist[BENCH_OP_SENTINEL];
+};
+
+/* libnss_sss and pam_sss are separate libraries, each of them with its own
+ * copy of the sss_client connection. Both are linked into this program, so
+ * the connection is swapped to the one of the responder that is about to be
+ * asked. */
+struct bench_conn {
+    int sd;
+    struct stat sb;
+};
+
+static struct bench_conn bench_nss_conn = { -1 };
+static struct bench_conn bench_pam_conn = { -1 };
+static struct bench_conn *bench_cur_conn = &bench_nss_conn;
+
+static void bench_use_conn(struct bench_conn *conn)
+{
+    if (conn == bench_cur_conn) {
+        return;
+    }
+
+    bench_cur_conn->sd = sss_cli_sd;
+    bench_cur_conn->sb = sss_cli_sb;
+    sss_cli_sd = conn->sd;
+    sss_cli_sb = conn->sb;
+    bench_cur_conn = conn;
+}
+
+static uint64_t bench_now_usec(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+/* Parses "op=weight,op=weight,...", operations which are not listed are
+ * not run. */
+static int bench_parse_mix(const char *mix, struct bench_opts *opts)
+{
+    char *copy;
+    char *item;
+    char *value;
+    char *endptr;
+    char *saveptr;
+    unsigned long weight;
+    int i;
+    int ret = 1;
+
+    copy = strdup(mix);
+    if (copy == NULL) {
+        return 1;
+    }
+
+    opts->total_weight = 0;
+    for (item = strtok_r(copy, ",", &saveptr);
+         item != NULL;
+         item = strtok_r(NULL, ",", &saveptr)) {
+        value = strchr(item, '=');
+        if (value == NULL) {
+            fprintf(stderr, "Missing weight of [%s]\n", item);
+            goto done;
+        }
+        *value = '\0';
+        value++;
+
+        for (i = 0; i < BENCH_OP_SENTINEL; i++) {
+            if (strcmp(item, bench_op_names[i]) == 0) {
+                break;
+            }
+        }
+        if (i == BENCH_OP_SENTINEL) {
+            fprintf(stderr, "Unknown operation [%s]\n", item);
+            goto done;
+        }
+
+        errno = 0;
+        weight = strtoul(value, &endptr, 10);
+        if (errno != 0 || *endptr != '\0' || weight > 1000) {
+            fprintf(stderr, "Invalid weight of [%s]\n", item);
+            goto done;
+        }
+
+        opts->weights[i] = weight;
+        opts->total_weight += weight;
+    }
+
+    if (opts->total_weight == 0) {
+        fprintf(stderr, "No operation to run\n");
+        goto done;
+    }
+
+    ret = 0;
+
+done:
+    free(copy);
+    return ret;
+}
+
+static enum bench_op bench_pick_op(struct bench_opts *opts,
+                                   unsigned int *seed)
+{
+    unsigned int r;
+    int i;
+
+    r = rand_r(seed) % opts->total_weight;
+    for (i = 0; i < BENCH_OP_SENTINEL - 1; i++) {
+        if (r < opts->weights[i]) {
+            break;
+        }
+        r -= opts->weights[i];
+    }
+
+    return i;
+}
+
+static int bench_pam(struct bench_opts *opts,
+                     enum sss_cli_command cmd,
+                     const char *user)
+{
+    struct pam_items pi = { 0 };
+    struct sss_cli_req_data rd;
+    uint8_t *buf = NULL;
+    uint8_t *repbuf = NULL;
+    size_t replen;
+    int32_t pam_status;
+    int errnop;
+    int ret;
+
+    pi.pam_service = opts->pam_service;
+    pi.pam_service_size = strlen(pi.pam_service) + 1;
+    pi.pam_user = user;
+    pi.pam_user_size = strlen(pi.pam_user) + 1;
+    pi.pam_tty = "";
+    pi.pam_tty_size = 1;
+    pi.pam_ruser = "";
+    pi.pam_ruser_size = 1;
+    pi.pam_rhost = "";
+    pi.pam_rhost_size = 1;
+    pi.login_name = "";
+    pi.requested_domains = "";
+    pi.requested_domains_size = 1;
+    pi.cli_pid = getpid();
+
+    if (cmd == SSS_PAM_AUTHENTICATE) {
+        pi.pam_authtok = discard_const(opts->password);
+        pi.pam_authtok_size = strlen(opts->password);
+        pi.pam_authtok_type = SSS_AUTHTOK_TYPE_PASSWORD;
+    } else {
+        pi.pam_authtok_type = SSS_AUTHTOK_TYPE_EMPTY;
+    }
+    pi.pam_newauthtok_type = SSS_AUTHTOK_TYPE_EMPTY;
+
+    ret = pack_message_v3(&pi, &rd.len, &buf);
+    if (ret != 0) {
+        return EIO;
+    }
+    rd.data = buf;
+
+    errnop = 0;
+    ret = sss_pam_make_request(cmd, &rd, &repbuf, &replen, &errnop);
+    free(buf);
+    if (ret != PAM_SUCCESS) {
+        return errnop != 0 ? errnop : EIO;
+    }
+
+    if (replen < sizeof(int32_t)) {
+        ret = EBADMSG;
+        goto done;
+    }
+
+    SAFEALIGN_COPY_INT32(&pam_status, repbuf, NULL);
+    ret = pam_status == PAM_SUCCESS ? EOK : EACCES;
+
+done:
+    free(repbuf);
+    return ret;
+}
+
+static int bench_op_run(struct bench_opts *opts, enum bench_op op,
+                        int num, char *buffer, gid_t **groups,
+                        long int *groups_size)
+{
+    char name[NAME_MAX];
+    struct passwd pwd;
+    struct group grp;
+    enum nss_status status;
+    long int start;
+    int errnop = 0;
+
+    if (op == BENCH_GETGRNAM) {
+        snprintf(name, sizeof(name), opts->group_fmt, num % opts->num_groups);
+    } else {
+        snprintf(name, sizeof(name), opts->user_fmt, num % opts->num_users);
+    }
+
+    switch (op) {
+    case BENCH_GETPWNAM:
+        bench_use_conn(&bench_nss_conn);
+        status = _nss_sss_getpwnam_r(name, &pwd, buffer, BENCH_BUFSIZE,
+                                     &errnop);
+        break;
+    case BENCH_GETPWUID:
+        bench_use_conn(&bench_nss_conn);
+        status = _nss_sss_getpwuid_r(opts->uid_base + num % opts->num_users,
+                                     &pwd, buffer, BENCH_BUFSIZE, &errnop);
+        break;
+    case BENCH_INITGROUPS:
+        bench_use_conn(&bench_nss_conn);
+        start = 0;
+        status = _nss_sss_initgroups_dyn(name, opts->uid_base, &start,
+                                         groups_size, groups, -1, &errnop);
+        break;
+    case BENCH_GETGRNAM:
+        bench_use_conn(&bench_nss_conn);
+        status = _nss_sss_getgrnam_r(name, &grp, buffer, BENCH_BUFSIZE,
+                                     &errnop);
+        break;
+    case BENCH_PAM_AUTH:
+        bench_use_conn(&bench_pam_conn);
+        return bench_pam(opts, SSS_PAM_AUTHENTICATE, name);
+    case BENCH_PAM_ACCT:
+        bench_use_conn(&bench_pam_conn);
+        return bench_pam(opts, SSS_PAM_ACCT_MGMT, name);
+    default:
+        return EINVAL;
+    }
+
+    if (status != NSS_STATUS_SUCCESS) {
+        return errnop != 0 ? errnop : ENOENT;
+    }
+
+    return EOK;
+}
+
+static int bench_client(struct bench_opts *opts, unsigned int id,
+                        uint64_t warmup_end, uint64_t end, int fd)
+{
+    struct bench_result *result;
+    char *buffer;
+    gid_t *groups;
+    long int groups_size = 64;
+    unsigned int seed = id;
+    enum bench_op op;
+    uint64_t start;
+    uint64_t now;
+    int num;
+    int ret;
+
+    result = calloc(1, sizeof(struct bench_result));
+    buffer = malloc(BENCH_BUFSIZE);
+    groups = malloc(groups_size * sizeof(gid_t));
+    if (result == NULL || buffer == NULL || groups == NULL) {
+        fprintf(stderr, "Out of memory\n");
+        return 1;
+    }
+
+    do {
+        op = bench_pick_op(opts, &seed);
+        num = rand_r(&seed);
+
+        start = bench_now_usec();
+        ret = bench_op_run(opts, op, num, buffer, &groups, &groups_size);
+        now = bench_now_usec();
+
+        if (now < warmup_end) {
+            continue;
+        }
+
+        if (ret != EOK) {
+            result->errors[op]++;
+        }
+        sss_perf_hist_add(&result->hist[op], now - start);
+    } while (now < end);
+
+    ret = sss_atomic_write_s(fd, result, sizeof(struct bench_result));
+    if (ret != sizeof(struct bench_result)) {
+        fprintf(stderr, "Cannot send the result to the parent\n");
+        return 1;
+    }
+
+    free(result);
+    free(buffer);
+    free(groups);
+    return 0;
+}
+
+static void bench_print(struct bench_result *result, double duration)
+{
+    struct sss_perf_hist *hist;
+    uint64_t total = 0;
+    int i;
+
+    for (i = 0; i < BENCH_OP_SENTINEL; i++) {
+        hist = &result->hist[i];
+        if (hist->count == 0) {
+            continue;
+        }
+        total += hist->count;
+
+        printf("op=%s ops=%"PRIu64" ops_per_sec=%.2f errors=%"PRIu64" "
+               "avg_usec=%"PRIu64" p50_usec=%"PRIu64" p99_usec=%"PRIu64" "
+               "p999_usec=%"PRIu64" max_usec=%"PRIu64"\n",
+               bench_op_names[i], hist->count, hist->count / duration,
+               result->errors[i], hist->sum / hist->count,
+               sss_perf_hist_percentile(hist, 50),
+               sss_perf_hist_percentile(hist, 99),
+               sss_perf_hist_percentile(hist, 99.9),
+               hist->max);
+    }
+
+    printf("op=total ops=%"PRIu64" ops_per_sec=%.2f\n",
+           total, total / duration);
+}
+
+static int bench_run(struct bench_opts *opts, int num_clients,
+                     int duration, int warmup)
+{
+    struct bench_result *result = NULL;
+    struct bench_result *merged = NULL;
+    uint64_t warmup_end;
+    uint64_t end;
+    pid_t pid;
+    int status;
+    int *fds;
+    int pipefd[2];
+    int failed = 0;
+    int ret = 1;
+    int i;
+    int j;
+
+    result = malloc(sizeof(struct bench_result));
+    merged = calloc(1, sizeof(struct bench_result));
+    fds = malloc(num_clients * sizeof(int));
+    if (result == NULL || merged == NULL || fds == NULL) {
+        fprintf(stderr, "Out of memory\n");
+        goto done;
+    }
+
+    warmup_end = bench_now_usec() + (uint64_t)warmup * 1000000;
+    end = warmup_end + (uint64_t)duration * 1000000;
+
+    /* The result is larger than PIPE_BUF, every client gets its own pipe
+     * so that the writes are not interleaved. */
+    for (i = 0; i < num_clients; i++) {
+        fds[i] = -1;
+        if (pipe(pipefd) != 0) {
+            fprintf(stderr, "pipe failed: %s\n", strerror(errno));
+            failed++;
+            continue;
+        }
+
+        pid = fork();
+        if (pid == 0) {
+            close(pipefd[0]);
+            _exit(bench_client(opts, i + 1, warmup_end, end, pipefd[1]));
+        } else if (pid == -1) {
+            fprintf(stderr, "fork failed: %s\n", strerror(errno));
+            close(pipefd[0]);
+            failed++;
+        } else {
+            fds[i] = pipefd[0];
+        }
+        close(pipefd[1]);
+    }
+
+    for (i = 0; i < num_clients; i++) {
+        if (fds[i] == -1) {
+            continue;
+        }
+
+        if (sss_atomic_read_s(fds[i], result, sizeof(struct bench_result))
+                == sizeof(struct bench_result)) {
+            for (j = 0; j < BENCH_OP_SENTINEL; j++) {
+                merged->errors[j] += result->errors[j];
+                sss_perf_hist_merge(&merged->hist[j], &result->hist[j]);
+            }
+        }
+        close(fds[i]);
+    }
+
+    while ((pid = wait(&status)) > 0) {
+        if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+            failed++;
+        }
+    }
+
+    if (failed > 0) {
+        fprintf(stderr, "%d clients failed\n", failed);
+        goto done;
+    }
+
+    printf("clients=%d duration_sec=%d memcache=%s\n", num_clients, duration,
+           getenv("SSS_NSS_USE_MEMCACHE") == NULL ? "yes" : "no");
+    bench_print(merged, duration);
+
+    ret = 0;
+
+done:
+    free(fds);
+    free(result);
+    free(merged);
+    return ret;
+}
+
+int main(int argc, const char *argv[])
+{
+    int opt;
+    poptContext pc;
+    int num_clients = DEFAULT_CLIENTS;
+    int duration = DEFAULT_DURATION;
+    int warmup = DEFAULT_WARMUP;
+    int no_memcache = 0;
+    const char *mix = DEFAULT_MIX;
+    struct bench_opts opts = {
+        .num_users = DEFAULT_USERS,
+        .num_groups = DEFAULT_GROUPS,
+        .uid_base = DEFAULT_UID_BASE,
+        .user_fmt = "bench_user%d",
+        .group_fmt = "bench_group%d",
+        .password = "Secret123",
+        .pam_service = "sssd_bench",
+    };
+
+    struct poptOption long_options[] = {
+        POPT_AUTOHELP
+        { "clients", 'c', POPT_ARG_INT | POPT_ARGFLAG_SHOW_DEFAULT,
+                    &num_clients, 0,
+                    "Number of concurrent client processes", NULL },
+        { "duration", 't', POPT_ARG_INT | POPT_ARGFLAG_SHOW_DEFAULT,
+                    &duration, 0,
+                    "Measured time in seconds", NULL },
+        { "warmup", 'w', POPT_ARG_INT | POPT_ARGFLAG_SHOW_DEFAULT,
+                    &warmup, 0,
+                    "Seconds of load before the measurement starts", NULL },
+        { "mix", 'm', POPT_ARG_STRING | POPT_ARGFLAG_SHOW_DEFAULT,
+                    &mix, 0,
+                    "Relative weights of the operations", NULL },
+        { "users", 'u', POPT_ARG_INT | POPT_ARGFLAG_SHOW_DEFAULT,
+                    &opts.num_users, 0,
+                    "Number of users to look up", NULL },
+        { "groups", 'g', POPT_ARG_INT | POPT_ARGFLAG_SHOW_DEFAULT,
+                    &opts.num_groups, 0,
+                    "Number of groups to look up", NULL },
+        { "uid-base", 0, POPT_ARG_INT | POPT_ARGFLAG_SHOW_DEFAULT,
+                    &opts.uid_base, 0,
+                    "UID of the first user", NULL },
+        { "user-format", 0, POPT_ARG_STRING | POPT_ARGFLAG_SHOW_DEFAULT,
+                    &opts.user_fmt, 0,
+                    "printf format of the user names", NULL },
+        { "group-format", 0, POPT_ARG_STRING | POPT_ARGFLAG_SHOW_DEFAULT,
+                    &opts.group_fmt, 0,
+                    "printf format of the group names", NULL },
+        { "password", 'p', POPT_ARG_STRING | POPT_ARGFLAG_SHOW_DEFAULT,
+                    &opts.password, 0,
+                    "Password of all users", NULL },
+        { "pam-service", 0, POPT_ARG_STRING | POPT_ARGFLAG_SHOW_DEFAULT,
+                    &opts.pam_service, 0,
+                    "PAM service sent with the PAM requests", NULL },
+        { "no-memcache", 0, POPT_ARG_NONE, &no_memcache, 0,
+                    "Do not use the memory cache", NULL },
+        POPT_TABLEEND
+    };
+
+    /* parse the params */
+    pc = poptGetContext(argv[0], argc, argv, long_options, 0);
+    while ((opt = poptGetNextOpt(pc)) != -1) {
+        switch (opt) {
+        default:
+            fprintf(stderr, "\nInvalid option %s: %s\n\n",
+                    poptBadOption(pc, 0), poptStrerror(opt));
+            poptPrintUsage(pc, stderr, 0);
+            return 1;
+        }
+    }
+    poptFreeContext(pc);
+
+    if (num_clients <= 0 || duration <= 0 || warmup < 0
+            || opts.num_users <= 0 || opts.num_groups <= 0) {
+        fprintf(stderr, "The number of clients, users and groups and the "
+                        "duration must be positive\n");
+        return 1;
+    }
+
+    if (bench_parse_mix(mix, &opts) != 0) {
+        return 1;
+    }
+
+    if (no_memcache) {
+        setenv("SSS_NSS_USE_MEMCACHE", "NO", 1);
+    } else {
+        unsetenv("SSS_NSS_USE_MEMCACHE");
+    }
+
+    return bench_run(&opts, num_clients, duration, warmup);
+}
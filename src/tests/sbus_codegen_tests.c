@@ -33,6 +33,7 @@
 #include "tests/common.h"
 #include "tests/sbus_codegen_tests_generated.h"
 #include "util/util_errors.h"
+#include "util/sss_trace.h"
 
 /* The following 2 macros were taken from check's project source files (0.9.10)
  * http://check.sourceforge.net/
@@ -98,6 +99,13 @@ START_TEST(test_methods)
     ck_assert(arg != NULL);
     ck_assert_str_eq(arg->name, "where_we_crashed");
     ck_assert_str_eq(arg->type, "s");
+    ck_assert(method->traced == false);
+
+    /* The trace ID is not a declared argument */
+    method = sbus_meta_find_method(&test_pilot_meta, "Blink");
+    ck_assert(method != NULL);
+    ck_assert(method->traced == true);
+    ck_assert(find_arg(method->in_args, "trace_id") == NULL);
 }
 END_TEST
 
@@ -202,6 +210,55 @@ START_TEST(test_constants)
     /* constants for com.planetexpress.Pilot */
     ck_assert_str_eq(TEST_PILOT, "com.planetexpress.Pilot");
     ck_assert_str_eq(TEST_PILOT_FULLNAME, "FullName");
+
+    /* packed opcodes */
+    ck_assert_int_eq(TEST_PILOT_BLINK_OPCODE, 1);
+    ck_assert_int_eq(COM_PLANETEXPRESS_SHIP_LAND_OPCODE, 2);
+}
+END_TEST
+
+START_TEST(test_packed)
+{
+    struct sbus_packed_buf *buf;
+    struct sbus_packed_buf *rbuf;
+    uint32_t duration;
+    bool crashed;
+    errno_t ret;
+
+    buf = sbus_packed_buf_new(NULL);
+    ck_assert(buf != NULL);
+
+    ret = test_pilot_Blink_pack(buf, 42);
+    ck_assert_int_eq(ret, EOK);
+    ck_assert_uint_eq(sbus_packed_buf_size(buf), sizeof(uint32_t));
+
+    rbuf = sbus_packed_buf_wrap(buf, sbus_packed_buf_data(buf),
+                                sbus_packed_buf_size(buf));
+    ck_assert(rbuf != NULL);
+
+    ret = test_pilot_Blink_unpack(rbuf, &duration);
+    ck_assert_int_eq(ret, EOK);
+    ck_assert_uint_eq(duration, 42);
+
+    /* Nothing left to read. */
+    ret = test_pilot_Blink_unpack(rbuf, &duration);
+    ck_assert_int_eq(ret, EBADMSG);
+    talloc_free(buf);
+
+    buf = sbus_packed_buf_new(NULL);
+    ck_assert(buf != NULL);
+
+    ret = test_pilot_Blink_pack_reply(buf, true);
+    ck_assert_int_eq(ret, EOK);
+
+    rbuf = sbus_packed_buf_wrap(buf, sbus_packed_buf_data(buf),
+                                sbus_packed_buf_size(buf));
+    ck_assert(rbuf != NULL);
+
+    ret = test_pilot_Blink_unpack_reply(rbuf, &crashed);
+    ck_assert_int_eq(ret, EOK);
+    ck_assert(crashed == true);
+    talloc_free(buf);
 }
 END_TEST
 
@@ -216,10 +273,23 @@ TCase *create_defs_tests(void)
     tcase_add_test(tc, test_signals);
     tcase_add_test(tc, test_vtable);
     tcase_add_test(tc, test_constants);
+    tcase_add_test(tc, test_packed);
 
     return tc;
 }
 
+#define BLINK_TRACE_ID UINT64_C(0x0000162e00000007)
+
+/* Replies whether the call runs as part of the traced request */
+static int blink_handler(struct sbus_request *req, void *instance_data,
+                         uint32_t arg_duration)
+{
+    ck_assert_uint_eq(arg_duration, 42);
+    ck_assert(req->trace_id == sss_trace_current());
+
+    return test_pilot_Blink_finish(req, sss_trace_current() == BLINK_TRACE_ID);
+}
+
 /* This is a handler which has all the basic arguments types */
 static int eject_handler(struct sbus_request *req, void *instance_data,
                          uint8_t arg_byte, bool arg_boolean,
@@ -595,6 +665,7 @@ void special_get_array_dict_sas(struct sbus_request *sbus_req,
 
 struct test_pilot pilot_iface = {
     { &test_pilot_meta, 0 },
+    .Blink = blink_handler,
     .Eject = eject_handler,
 
     .get_FullName = pilot_get_full_name_handler,
@@ -1505,6 +1576,58 @@ START_TEST(test_getall_basic_types)
 }
 END_TEST
 
+START_TEST(test_traced_method)
+{
+    TALLOC_CTX *ctx;
+    DBusConnection *client;
+    DBusError error = DBUS_ERROR_INIT;
+    DBusMessage *reply;
+    dbus_uint32_t arg_duration = 42;
+    dbus_uint64_t arg_trace_id = BLINK_TRACE_ID;
+    dbus_bool_t traced;
+
+    ctx = talloc_new(NULL);
+    ck_assert(ctx != NULL);
+
+    client = test_dbus_setup_mock(ctx, NULL, pilot_test_server_init, NULL);
+    ck_assert(client != NULL);
+
+    reply = test_dbus_call_sync(client,
+                                "/test/leela",
+                                TEST_PILOT,
+                                TEST_PILOT_BLINK,
+                                &error,
+                                DBUS_TYPE_UINT32, &arg_duration,
+                                DBUS_TYPE_UINT64, &arg_trace_id,
+                                DBUS_TYPE_INVALID);
+    ck_assert(reply != NULL);
+    ck_assert(!dbus_error_is_set(&error));
+    ck_assert(dbus_message_get_args(reply, NULL,
+                                    DBUS_TYPE_BOOLEAN, &traced,
+                                    DBUS_TYPE_INVALID));
+    ck_assert(traced == TRUE);
+    dbus_message_unref(reply);
+
+    /* Callers that do not append the trace ID are still served */
+    reply = test_dbus_call_sync(client,
+                                "/test/leela",
+                                TEST_PILOT,
+                                TEST_PILOT_BLINK,
+                                &error,
+                                DBUS_TYPE_UINT32, &arg_duration,
+                                DBUS_TYPE_INVALID);
+    ck_assert(reply != NULL);
+    ck_assert(!dbus_error_is_set(&error));
+    ck_assert(dbus_message_get_args(reply, NULL,
+                                    DBUS_TYPE_BOOLEAN, &traced,
+                                    DBUS_TYPE_INVALID));
+    ck_assert(traced == FALSE);
+    dbus_message_unref(reply);
+
+    talloc_free(ctx);
+}
+END_TEST
+
 TCase *create_handler_tests(void)
 {
     TCase *tc = tcase_create("handler");
@@ -1514,6 +1637,7 @@ TCase *create_handler_tests(void)
     tcase_add_test(tc, test_getall_basic_types);
     tcase_add_test(tc, test_get_basic_array_types);
     tcase_add_test(tc, test_get_array_dict_sas);
+    tcase_add_test(tc, test_traced_method);
 
     return tc;
 }
@@ -134,6 +134,54 @@ int test_pilot_Blink_finish(struct sbus_request *req, bool arg_crashed)
                                          DBUS_TYPE_INVALID);
 }
 
+errno_t test_pilot_Blink_pack(struct sbus_packed_buf *buf, uint32_t arg_duration)
+{
+    errno_t ret;
+
+    ret = sbus_packed_put_uint32(buf, arg_duration);
+    if (ret != EOK) {
+        return ret;
+    }
+
+    return EOK;
+}
+
+errno_t test_pilot_Blink_unpack(struct sbus_packed_buf *buf, uint32_t *arg_duration)
+{
+    errno_t ret;
+
+    ret = sbus_packed_get_uint32(buf, arg_duration);
+    if (ret != EOK) {
+        return ret;
+    }
+
+    return EOK;
+}
+
+errno_t test_pilot_Blink_pack_reply(struct sbus_packed_buf *buf, bool arg_crashed)
+{
+    errno_t ret;
+
+    ret = sbus_packed_put_bool(buf, arg_crashed);
+    if (ret != EOK) {
+        return ret;
+    }
+
+    return EOK;
+}
+
+errno_t test_pilot_Blink_unpack_reply(struct sbus_packed_buf *buf, bool *arg_crashed)
+{
+    errno_t ret;
+
+    ret = sbus_packed_get_bool(buf, arg_crashed);
+    if (ret != EOK) {
+        return ret;
+    }
+
+    return EOK;
+}
+
 /* arguments for com.planetexpress.Pilot.Eject */
 const struct sbus_arg_meta test_pilot_Eject__in[] = {
     { "byte", "y" },
@@ -222,6 +270,7 @@ const struct sbus_method_meta test_pilot__methods[] = {
         test_pilot_Blink__out,
         offsetof(struct test_pilot, Blink),
         invoke_u_method,
+        true, /* traced */
     },
     {
         "Eject", /* name */
@@ -4,6 +4,7 @@
 #define __SBUS_CODEGEN_TESTS_XML__
 
 #include "sbus/sssd_dbus.h"
+#include "sbus/sbus_packed.h"
 
 /* ------------------------------------------------------------------------
  * DBus Constants
@@ -16,6 +17,7 @@
 #define COM_PLANETEXPRESS_SHIP_MOVEUNIVERSE "MoveUniverse"
 #define COM_PLANETEXPRESS_SHIP_CRASH_NOW "Crash"
 #define COM_PLANETEXPRESS_SHIP_LAND "Land"
+#define COM_PLANETEXPRESS_SHIP_LAND_OPCODE 2
 #define COM_PLANETEXPRESS_SHIP_BECAMESENTIENT "BecameSentient"
 #define COM_PLANETEXPRESS_SHIP_COLOR "Color"
 
@@ -23,6 +25,7 @@
 #define TEST_PILOT "com.planetexpress.Pilot"
 #define TEST_PILOT_BLINK "Blink"
 #define TEST_PILOT_EJECT "Eject"
+#define TEST_PILOT_BLINK_OPCODE 1
 #define TEST_PILOT_FULLNAME "FullName"
 #define TEST_PILOT_BYTE "byte"
 #define TEST_PILOT_BOOLEAN "boolean"
@@ -128,6 +131,21 @@ struct test_special {
     void (*get_array_dict_sas)(struct sbus_request *, void *data, hash_table_t **);
 };
 
+/* ------------------------------------------------------------------------
+ * Packed transport
+ *
+ * Methods annotated with org.freedesktop.sssd.Packed can be also called
+ * over the packed binary transport. The xxx_pack() and xxx_unpack()
+ * functions (un)marshall arguments of the call, xxx_pack_reply() and
+ * xxx_unpack_reply() its output. Unpacked strings point inside the buffer.
+ */
+
+/* packed transport functions for Blink */
+errno_t test_pilot_Blink_pack(struct sbus_packed_buf *buf, uint32_t arg_duration);
+errno_t test_pilot_Blink_unpack(struct sbus_packed_buf *buf, uint32_t *arg_duration);
+errno_t test_pilot_Blink_pack_reply(struct sbus_packed_buf *buf, bool arg_crashed);
+errno_t test_pilot_Blink_unpack_reply(struct sbus_packed_buf *buf, bool *arg_crashed);
+
 /* ------------------------------------------------------------------------
  * DBus Interface Metadata
  *
@@ -0,0 +1,427 @@
+/*
+    SSSD
+
+    Round-trip latency of the D-Bus and packed data provider transports
+
+    Copyright (C) 2016 Red Hat
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <signal.h>
+#include <sys/wait.h>
+#include <popt.h>
+#include <talloc.h>
+#include <tevent.h>
+
+#include "util/util.h"
+#include "sbus/sssd_dbus.h"
+#include "sbus/sbus_packed.h"
+#include "providers/data_provider/dp_iface_generated.h"
+#include "providers/data_provider/dp_iface.h"
+#include "tests/common.h"
+
+#define DEFAULT_ITERATIONS 10000
+#define BENCH_FILTER "name=benchmark-user"
+#define BENCH_DOMAIN "benchmark.test"
+
+struct bench_stats {
+    const char *name;
+    unsigned int count;
+    uint64_t total;
+    uint64_t min;
+    uint64_t max;
+};
+
+static uint64_t bench_now_usec(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+static void bench_stats_add(struct bench_stats *stats, uint64_t start)
+{
+    uint64_t elapsed;
+
+    elapsed = bench_now_usec() - start;
+
+    if (stats->count == 0 || elapsed < stats->min) {
+        stats->min = elapsed;
+    }
+
+    if (elapsed > stats->max) {
+        stats->max = elapsed;
+    }
+
+    stats->total += elapsed;
+    stats->count++;
+}
+
+static void bench_stats_print(struct bench_stats *stats)
+{
+    if (stats->count == 0) {
+        printf("%-8s no successful round trips\n", stats->name);
+        return;
+    }
+
+    printf("%-8s %8u calls  avg %8.2f us  min %6"PRIu64" us  "
+           "max %6"PRIu64" us\n", stats->name, stats->count,
+           (double)stats->total / stats->count, stats->min, stats->max);
+}
+
+/* ==D-Bus================================================================ */
+
+static int bench_dbus_account_handler(struct sbus_request *sbus_req,
+                                      void *data,
+                                      uint32_t dp_flags,
+                                      uint32_t entry_type,
+                                      uint32_t attr_type,
+                                      const char *filter,
+                                      const char *domain,
+                                      const char *extra)
+{
+    return iface_dp_getAccountInfo_finish(sbus_req, DP_ERR_OK, EOK,
+                                          "Success");
+}
+
+static int bench_dbus_server_init(struct sbus_connection *server, void *pvt)
+{
+    static struct iface_dp iface_dp = {
+        { &iface_dp_meta, 0 },
+        .getAccountInfo = bench_dbus_account_handler,
+    };
+
+    return sbus_conn_register_iface(server, &iface_dp.vtable, DP_PATH, NULL);
+}
+
+static errno_t bench_dbus(int iterations, struct bench_stats *stats)
+{
+    TALLOC_CTX *tmp_ctx;
+    DBusConnection *client;
+    DBusError error = DBUS_ERROR_INIT;
+    DBusMessage *reply;
+    const char *filter = BENCH_FILTER;
+    const char *domain = BENCH_DOMAIN;
+    const char *extra = "";
+    uint32_t dp_flags = 0;
+    uint32_t entry_type = BE_REQ_USER;
+    uint32_t attr_type = BE_ATTR_CORE;
+    uint64_t start;
+    int i;
+
+    tmp_ctx = talloc_new(NULL);
+    if (tmp_ctx == NULL) {
+        return ENOMEM;
+    }
+
+    client = test_dbus_setup_mock(tmp_ctx, NULL, bench_dbus_server_init, NULL);
+
+    for (i = 0; i < iterations; i++) {
+        start = bench_now_usec();
+        reply = test_dbus_call_sync(client, DP_PATH, IFACE_DP,
+                                    IFACE_DP_GETACCOUNTINFO, &error,
+                                    DBUS_TYPE_UINT32, &dp_flags,
+                                    DBUS_TYPE_UINT32, &entry_type,
+                                    DBUS_TYPE_UINT32, &attr_type,
+                                    DBUS_TYPE_STRING, &filter,
+                                    DBUS_TYPE_STRING, &domain,
+                                    DBUS_TYPE_STRING, &extra,
+                                    DBUS_TYPE_INVALID);
+        if (reply == NULL) {
+            fprintf(stderr, "D-Bus call failed: %s\n", error.message);
+            dbus_error_free(&error);
+            continue;
+        }
+
+        dbus_message_unref(reply);
+        bench_stats_add(stats, start);
+    }
+
+    talloc_free(tmp_ctx);
+    return EOK;
+}
+
+/* ==Packed=============================================================== */
+
+static errno_t bench_packed_account_handler(struct sbus_packed_request *req,
+                                            void *data)
+{
+    struct sbus_packed_buf *reply;
+    uint32_t dp_flags;
+    uint32_t entry_type;
+    uint32_t attr_type;
+    const char *filter;
+    const char *domain;
+    const char *extra;
+    errno_t ret;
+
+    ret = iface_dp_getAccountInfo_unpack(req->body, &dp_flags, &entry_type,
+                                         &attr_type, &filter, &domain, &extra);
+    if (ret != EOK) {
+        return ret;
+    }
+
+    reply = sbus_packed_buf_new(req);
+    if (reply == NULL) {
+        return ENOMEM;
+    }
+
+    ret = iface_dp_getAccountInfo_pack_reply(reply, DP_ERR_OK, EOK,
+                                             "Success");
+    if (ret != EOK) {
+        return ret;
+    }
+
+    return sbus_packed_request_finish(req, reply);
+}
+
+static void bench_packed_server(const char *address, int sync_fd)
+{
+    static const struct sbus_packed_method methods[] = {
+        {IFACE_DP_GETACCOUNTINFO_OPCODE, bench_packed_account_handler},
+        {0, NULL}
+    };
+    struct sbus_packed_server *server;
+    struct tevent_context *ev;
+    TALLOC_CTX *ctx;
+    errno_t ret;
+
+    ctx = talloc_new(NULL);
+    ev = tevent_context_init(ctx);
+    if (ev == NULL) {
+        _exit(1);
+    }
+
+    ret = sbus_packed_server_create(ctx, ev, address, geteuid(), getegid(),
+                                    methods, NULL, NULL, &server);
+    if (ret != EOK) {
+        _exit(1);
+    }
+
+    /* Synchronization point: the server is listening. */
+    if (write(sync_fd, "X", 1) != 1) {
+        _exit(1);
+    }
+
+    /* The parent kills us when it is done. */
+    while (tevent_loop_once(ev) == 0);
+
+    _exit(0);
+}
+
+struct bench_packed_call {
+    bool done;
+    errno_t ret;
+};
+
+static void bench_packed_call_done(struct tevent_req *req)
+{
+    struct bench_packed_call *call;
+    struct sbus_packed_buf *reply;
+    uint16_t dp_error;
+    uint32_t error;
+    const char *message;
+
+    call = tevent_req_callback_data(req, struct bench_packed_call);
+
+    call->ret = sbus_packed_call_recv(req, req, &reply);
+    if (call->ret == EOK) {
+        call->ret = iface_dp_getAccountInfo_unpack_reply(reply, &dp_error,
+                                                         &error, &message);
+    }
+
+    talloc_free(req);
+    call->done = true;
+}
+
+static errno_t bench_packed(int iterations, struct bench_stats *stats)
+{
+    TALLOC_CTX *tmp_ctx;
+    struct tevent_context *ev;
+    struct sbus_packed_conn *conn;
+    struct sbus_packed_buf *body;
+    struct bench_packed_call call;
+    struct tevent_req *req;
+    char *temp_dir;
+    char *address;
+    int sync_fds[2];
+    uint64_t start;
+    pid_t pid;
+    char dummy;
+    errno_t ret;
+    int i;
+
+    tmp_ctx = talloc_new(NULL);
+    if (tmp_ctx == NULL) {
+        return ENOMEM;
+    }
+
+    temp_dir = mkdtemp(talloc_strdup(tmp_ctx, "/tmp/sssd-packed-bench.XXXXXX"));
+    if (temp_dir == NULL) {
+        ret = errno;
+        goto done;
+    }
+
+    address = talloc_asprintf(tmp_ctx, "%s/packed", temp_dir);
+    if (address == NULL) {
+        ret = ENOMEM;
+        goto done;
+    }
+
+    if (socketpair(PF_LOCAL, SOCK_STREAM, 0, sync_fds) != 0) {
+        ret = errno;
+        goto done;
+    }
+
+    pid = fork();
+    if (pid == 0) {
+        close(sync_fds[0]);
+        bench_packed_server(address, sync_fds[1]);
+    } else if (pid == -1) {
+        ret = errno;
+        goto done;
+    }
+
+    close(sync_fds[1]);
+    if (read(sync_fds[0], &dummy, 1) != 1) {
+        ret = EIO;
+        goto done;
+    }
+
+    ev = tevent_context_init(tmp_ctx);
+    if (ev == NULL) {
+        ret = ENOMEM;
+        goto done;
+    }
+
+    ret = sbus_packed_connect(tmp_ctx, ev, address, &conn);
+    if (ret != EOK) {
+        goto done;
+    }
+
+    for (i = 0; i < iterations; i++) {
+        start = bench_now_usec();
+
+        body = sbus_packed_buf_new(tmp_ctx);
+        if (body == NULL) {
+            ret = ENOMEM;
+            goto done;
+        }
+
+        ret = iface_dp_getAccountInfo_pack(body, 0, BE_REQ_USER, BE_ATTR_CORE,
+                                           BENCH_FILTER, BENCH_DOMAIN, "");
+        if (ret != EOK) {
+            goto done;
+        }
+
+        req = sbus_packed_call_send(tmp_ctx, conn,
+                                    IFACE_DP_GETACCOUNTINFO_OPCODE,
+                                    body, 5000);
+        talloc_free(body);
+        if (req == NULL) {
+            ret = ENOMEM;
+            goto done;
+        }
+
+        call.done = false;
+        tevent_req_set_callback(req, bench_packed_call_done, &call);
+
+        while (!call.done) {
+            if (tevent_loop_once(ev) != 0) {
+                ret = EIO;
+                goto done;
+            }
+        }
+
+        if (call.ret != EOK) {
+            fprintf(stderr, "Packed call failed: %s\n",
+                    sss_strerror(call.ret));
+            continue;
+        }
+
+        bench_stats_add(stats, start);
+    }
+
+    kill(pid, SIGTERM);
+    waitpid(pid, NULL, 0);
+    unlink(address);
+    rmdir(temp_dir);
+
+    ret = EOK;
+
+done:
+    talloc_free(tmp_ctx);
+    return ret;
+}
+
+int main(int argc, const char *argv[])
+{
+    int opt;
+    poptContext pc;
+    int iterations = DEFAULT_ITERATIONS;
+    struct bench_stats dbus_stats = { "D-Bus", 0, 0, 0, 0 };
+    struct bench_stats packed_stats = { "packed", 0, 0, 0, 0 };
+    errno_t ret;
+
+    struct poptOption long_options[] = {
+        POPT_AUTOHELP
+        SSSD_DEBUG_OPTS
+        { "iterations", 'n', POPT_ARG_INT | POPT_ARGFLAG_SHOW_DEFAULT,
+                    &iterations, 0,
+                    "Number of getAccountInfo round trips", NULL },
+        POPT_TABLEEND
+    };
+
+    /* parse the params */
+    pc = poptGetContext(argv[0], argc, argv, long_options, 0);
+    while ((opt = poptGetNextOpt(pc)) != -1) {
+        switch (opt) {
+        default:
+            fprintf(stderr, "\nInvalid option %s: %s\n\n",
+                    poptBadOption(pc, 0), poptStrerror(opt));
+            poptPrintUsage(pc, stderr, 0);
+            return 1;
+        }
+    }
+    poptFreeContext(pc);
+
+    DEBUG_CLI_INIT(debug_level);
+
+    if (iterations <= 0) {
+        fprintf(stderr, "The number of iterations must be positive\n");
+        return 1;
+    }
+
+    ret = bench_dbus(iterations, &dbus_stats);
+    if (ret != EOK) {
+        fprintf(stderr, "D-Bus benchmark failed: %s\n", sss_strerror(ret));
+        return 1;
+    }
+
+    ret = bench_packed(iterations, &packed_stats);
+    if (ret != EOK) {
+        fprintf(stderr, "Packed benchmark failed: %s\n", sss_strerror(ret));
+        return 1;
+    }
+
+    printf("getAccountInfo round-trip latency:\n");
+    bench_stats_print(&dbus_stats);
+    bench_stats_print(&packed_stats);
+
+    return 0;
+}
@@ -1300,6 +1300,48 @@ START_TEST (test_sysdb_search_users)
 }
 END_TEST
 
+START_TEST (test_sysdb_search_users_limit)
+{
+    struct sysdb_test_ctx *test_ctx;
+    struct test_data *data;
+    int ret;
+    const char *attrs[] = { SYSDB_NAME, NULL };
+    const char *filter = "(&("SYSDB_UIDNUM">=27100)("SYSDB_UIDNUM"<=27102))";
+    size_t count;
+    struct ldb_message **msgs;
+    uid_t uid;
+
+    /* Setup */
+    ret = setup_sysdb_tests(&test_ctx);
+    fail_if(ret != EOK, "Could not set up the test");
+
+    for (uid = 27100; uid <= 27102; uid++) {
+        data = test_data_new_user(test_ctx, uid);
+        fail_if(data == NULL, "OOM");
+
+        ret = test_add_user(data);
+        fail_if(ret != EOK, "Could not add user %u", uid);
+    }
+
+    ret = sysdb_search_users_limit(test_ctx, test_ctx->domain,
+                                   filter, attrs, 2, &count, &msgs);
+    fail_if(ret != EOK, "Search failed: %d", ret);
+    fail_if(count != 2, "Expected 2 users, got %zu\n", count);
+
+    ret = sysdb_search_users_limit(test_ctx, test_ctx->domain,
+                                   filter, attrs, 0, &count, &msgs);
+    fail_if(ret != EOK, "Search failed: %d", ret);
+    fail_if(count != 3, "Expected 3 users, got %zu\n", count);
+
+    ret = sysdb_search_users_limit(test_ctx, test_ctx->domain,
+                                   "("SYSDB_UIDNUM"=27103)", attrs, 2,
+                                   &count, &msgs);
+    fail_if(ret != ENOENT, "Expected ENOENT, got %d", ret);
+
+    talloc_free(test_ctx);
+}
+END_TEST
+
 START_TEST (test_sysdb_remove_attrs)
 {
     struct sysdb_test_ctx *test_ctx;
@@ -6568,6 +6610,7 @@ Suite *create_sysdb_suite(void)
 
     /* Find the users by their new attribute */
     tcase_add_loop_test(tc_sysdb, test_sysdb_search_users, 27010, 27020);
+    tcase_add_test(tc_sysdb, test_sysdb_search_users_limit);
 
     /* Verify the change */
     tcase_add_loop_test(tc_sysdb, test_sysdb_get_user_attr, 27010, 27020);
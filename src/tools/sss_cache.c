@@ -424,6 +424,8 @@ static bool invalidate_entries(TALLOC_CTX *ctx,
     const char *attrs[] = {SYSDB_NAME, NULL};
     size_t msg_count;
     struct ldb_message **msgs;
+    size_t slow_count;
+    struct ldb_message **slow_msgs;
     const char *type_string = "unknown";
     errno_t ret = EINVAL;
     int i;
@@ -488,9 +490,27 @@ static bool invalidate_entries(TALLOC_CTX *ctx,
         return false;
     }
 
+    slow_msgs = msgs;
+    slow_count = msg_count;
+
+    if (entry_type == TYPE_USER || entry_type == TYPE_GROUP) {
+        /* Only the timestamp cache has to be written for most users and
+         * groups, which is much cheaper than modifying every entry in the
+         * main cache. */
+        ret = sysdb_invalidate_ts_entries(msgs, dinfo->sysdb, msgs, msg_count,
+                                          entry_type == TYPE_USER,
+                                          &slow_msgs, &slow_count);
+        if (ret != EOK && ret != ENOSYS) {
+            DEBUG(SSSDBG_MINOR_FAILURE,
+                  "Cannot invalidate %ss in the timestamp cache of domain "
+                  "%s, invalidating them one by one\n",
+                  type_string, dinfo->name);
+        }
+    }
+
     iret = true;
-    for (i = 0; i < msg_count; i++) {
-        c_name = ldb_msg_find_attr_as_string(msgs[i], SYSDB_NAME, NULL);
+    for (i = 0; i < slow_count; i++) {
+        c_name = ldb_msg_find_attr_as_string(slow_msgs[i], SYSDB_NAME, NULL);
         if (c_name == NULL) {
             DEBUG(SSSDBG_MINOR_FAILURE,
                   "Something bad happened, can't find attribute %s\n",
@@ -261,12 +261,174 @@ done:
     return ret;
 }
 
+static errno_t sssctl_domain_status_scheduler(struct sss_tool_ctx *tool_ctx,
+                                              sss_sifp_ctx *sifp,
+                                              const char *domain_path)
+{
+    TALLOC_CTX *tmp_ctx;
+    sss_sifp_error error;
+    DBusMessage *reply;
+    const char **targets;
+    uint32_t *limits;
+    uint32_t *active;
+    uint32_t *queued;
+    uint32_t *max_queued;
+    uint64_t *started;
+    uint64_t *delayed;
+    uint64_t *wait_total;
+    uint64_t *wait_max;
+    int num_targets;
+    int num_limits;
+    int num_active;
+    int num_queued;
+    int num_max_queued;
+    int num_started;
+    int num_delayed;
+    int num_wait_total;
+    int num_wait_max;
+    char limit[32];
+    errno_t ret;
+    int i;
+
+    tmp_ctx = talloc_new(NULL);
+    if (tmp_ctx == NULL) {
+        DEBUG(SSSDBG_CRIT_FAILURE, "talloc_new() failed\n");
+        return ENOMEM;
+    }
+
+    error = sssctl_sifp_send(tmp_ctx, sifp, &reply, domain_path,
+                             IFACE_IFP_DOMAINS_DOMAIN,
+                             IFACE_IFP_DOMAINS_DOMAIN_SCHEDULERSTATS);
+    if (error != SSS_SIFP_OK) {
+        sssctl_sifp_error(sifp, error, "Unable to get scheduler statistics");
+        ret = EIO;
+        goto done;
+    }
+
+    ret = sbus_parse_reply(reply,
+                           DBUS_TYPE_ARRAY, DBUS_TYPE_STRING,
+                           &targets, &num_targets,
+                           DBUS_TYPE_ARRAY, DBUS_TYPE_UINT32,
+                           &limits, &num_limits,
+                           DBUS_TYPE_ARRAY, DBUS_TYPE_UINT32,
+                           &active, &num_active,
+                           DBUS_TYPE_ARRAY, DBUS_TYPE_UINT32,
+                           &queued, &num_queued,
+                           DBUS_TYPE_ARRAY, DBUS_TYPE_UINT32,
+                           &max_queued, &num_max_queued,
+                           DBUS_TYPE_ARRAY, DBUS_TYPE_UINT64,
+                           &started, &num_started,
+                           DBUS_TYPE_ARRAY, DBUS_TYPE_UINT64,
+                           &delayed, &num_delayed,
+                           DBUS_TYPE_ARRAY, DBUS_TYPE_UINT64,
+                           &wait_total, &num_wait_total,
+                           DBUS_TYPE_ARRAY, DBUS_TYPE_UINT64,
+                           &wait_max, &num_wait_max);
+    if (ret != EOK) {
+        goto done;
+    }
+
+    if (num_limits != num_targets || num_active != num_targets
+            || num_queued != num_targets || num_max_queued != num_targets
+            || num_started != num_targets || num_delayed != num_targets
+            || num_wait_total != num_targets
+            || num_wait_max != num_targets) {
+        DEBUG(SSSDBG_CRIT_FAILURE, "Malformed scheduler statistics\n");
+        ret = EIO;
+        goto done;
+    }
+
+    printf(_("Request scheduler:\n"));
+    printf("%-12s %6s %6s %6s %10s %10s %10s %12s %12s\n",
+           _("Target"), _("Limit"), _("Active"), _("Queued"),
+           _("Max queued"), _("Started"), _("Delayed"),
+           _("Avg wait us"), _("Max wait us"));
+    for (i = 0; i < num_targets; i++) {
+        if (limits[i] == 0) {
+            snprintf(limit, sizeof(limit), "-");
+        } else {
+            snprintf(limit, sizeof(limit), "%"PRIu32, limits[i]);
+        }
+
+        printf("%-12s %6s %6"PRIu32" %6"PRIu32" %10"PRIu32
+               " %10"PRIu64" %10"PRIu64" %12"PRIu64" %12"PRIu64"\n",
+               targets[i], limit, active[i], queued[i], max_queued[i],
+               started[i], delayed[i],
+               delayed[i] == 0 ? 0 : wait_total[i] / delayed[i],
+               wait_max[i]);
+    }
+
+    ret = EOK;
+
+done:
+    talloc_free(tmp_ctx);
+    return ret;
+}
+
+static errno_t sssctl_domain_status_dns_cache(struct sss_tool_ctx *tool_ctx,
+                                              sss_sifp_ctx *sifp,
+                                              const char *domain_path)
+{
+    TALLOC_CTX *tmp_ctx;
+    sss_sifp_error error;
+    DBusMessage *reply;
+    uint64_t hits;
+    uint64_t negative_hits;
+    uint64_t misses;
+    uint64_t lookups;
+    uint32_t entries;
+    errno_t ret;
+
+    tmp_ctx = talloc_new(NULL);
+    if (tmp_ctx == NULL) {
+        DEBUG(SSSDBG_CRIT_FAILURE, "talloc_new() failed\n");
+        return ENOMEM;
+    }
+
+    error = sssctl_sifp_send(tmp_ctx, sifp, &reply, domain_path,
+                             IFACE_IFP_DOMAINS_DOMAIN,
+                             IFACE_IFP_DOMAINS_DOMAIN_DNSCACHESTATS);
+    if (error != SSS_SIFP_OK) {
+        sssctl_sifp_error(sifp, error, "Unable to get DNS cache statistics");
+        ret = EIO;
+        goto done;
+    }
+
+    ret = sbus_parse_reply(reply,
+                           DBUS_TYPE_UINT64, &hits,
+                           DBUS_TYPE_UINT64, &negative_hits,
+                           DBUS_TYPE_UINT64, &misses,
+                           DBUS_TYPE_UINT32, &entries);
+    if (ret != EOK) {
+        goto done;
+    }
+
+    lookups = hits + negative_hits + misses;
+
+    printf(_("DNS cache:\n"));
+    printf(_("Cached names: %"PRIu32"\n"), entries);
+    printf(_("Lookups: %"PRIu64"\n"), lookups);
+    printf(_("Positive hits: %"PRIu64"\n"), hits);
+    printf(_("Negative hits: %"PRIu64"\n"), negative_hits);
+    printf(_("Misses: %"PRIu64"\n"), misses);
+    printf(_("Hit rate: %.1f%%\n"),
+           lookups == 0 ? 0.0 : 100.0 * (hits + negative_hits) / lookups);
+
+    ret = EOK;
+
+done:
+    talloc_free(tmp_ctx);
+    return ret;
+}
+
 struct sssctl_domain_status_opts {
     const char *domain;
     int online;
     int last;
     int active;
     int servers;
+    int scheduler;
+    int dns_cache;
     int force_start;
 };
 
@@ -286,6 +448,8 @@ errno_t sssctl_domain_status(struct sss_cmdline *cmdline,
         {"online", 'o', POPT_ARG_NONE , &opts.online, 0, _("Show online status"), NULL },
         {"active-server", 'a', POPT_ARG_NONE, &opts.active, 0, _("Show information about active server"), NULL },
         {"servers", 'r', POPT_ARG_NONE, &opts.servers, 0, _("Show list of discovered servers"), NULL },
+        {"scheduler", 'q', POPT_ARG_NONE, &opts.scheduler, 0, _("Show data provider request queues"), NULL },
+        {"dns-cache", 'n', POPT_ARG_NONE, &opts.dns_cache, 0, _("Show DNS cache statistics"), NULL },
         {"start", 's', POPT_ARG_NONE, &opts.force_start, 0, _("Start SSSD if it is not running"), NULL },
         POPT_TABLEEND
     };
@@ -349,5 +513,29 @@ errno_t sssctl_domain_status(struct sss_cmdline *cmdline,
         }
     }
 
+    if (opts.scheduler) {
+        if (opts.online || opts.active || opts.servers) {
+            printf("\n");
+        }
+
+        ret = sssctl_domain_status_scheduler(tool_ctx, sifp, path);
+        if (ret != EOK) {
+            fprintf(stderr, _("Unable to get scheduler statistics\n"));
+            return ret;
+        }
+    }
+
+    if (opts.dns_cache) {
+        if (opts.online || opts.active || opts.servers || opts.scheduler) {
+            printf("\n");
+        }
+
+        ret = sssctl_domain_status_dns_cache(tool_ctx, sifp, path);
+        if (ret != EOK) {
+            fprintf(stderr, _("Unable to get DNS cache statistics\n"));
+            return ret;
+        }
+    }
+
     return EOK;
 }
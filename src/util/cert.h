@@ -49,4 +49,21 @@ errno_t cert_to_ssh_key(TALLOC_CTX *mem_ctx, const char *ca_db,
                         const uint8_t *der_blob, size_t der_size,
                         struct cert_verify_opts *cert_verify_opts,
                         uint8_t **key, size_t *key_size);
+
+/* Like cert_to_ssh_key() but also returns until when the validation result
+ * may be reused, 0 if that is not known. If key is NULL the certificate is
+ * only validated. */
+errno_t cert_to_ssh_key_ex(TALLOC_CTX *mem_ctx, const char *ca_db,
+                           const uint8_t *der_blob, size_t der_size,
+                           struct cert_verify_opts *cert_verify_opts,
+                           uint8_t **key, size_t *key_size,
+                           time_t *_valid_until);
+
+/* Returns until when a successful validation of the certificate may be
+ * reused without validating it, i.e. the earlier of the end of its validity
+ * and the next update of the CRL of its issuer found in ca_db. The
+ * certificate itself is not validated. */
+errno_t cert_der_valid_until(const char *ca_db,
+                             const uint8_t *der_blob, size_t der_size,
+                             time_t *_valid_until);
 #endif /* __CERT_H__ */
@@ -22,6 +22,7 @@
 #include <openssl/pem.h>
 
 #include "util/util.h"
+#include "util/cert.h"
 
 errno_t sss_cert_der_to_pem(TALLOC_CTX *mem_ctx, const uint8_t *der_blob,
                             size_t der_size, char **pem, size_t *pem_size)
@@ -170,10 +171,64 @@ done:
 #define SSH_RSA_HEADER "ssh-rsa"
 #define SSH_RSA_HEADER_LEN (sizeof(SSH_RSA_HEADER) - 1)
 
+static time_t cert_valid_until(X509 *cert)
+{
+    int days;
+    int secs;
+
+    if (!ASN1_TIME_diff(&days, &secs, NULL, X509_get_notAfter(cert))) {
+        DEBUG(SSSDBG_OP_FAILURE, "ASN1_TIME_diff failed.\n");
+        return 0;
+    }
+
+    return time(NULL) + (time_t) days * 24 * 60 * 60 + secs;
+}
+
+errno_t cert_der_valid_until(const char *ca_db,
+                             const uint8_t *der_blob, size_t der_size,
+                             time_t *_valid_until)
+{
+    const unsigned char *d;
+    X509 *cert;
+    time_t valid_until;
+
+    if (der_blob == NULL || der_size == 0) {
+        return EINVAL;
+    }
+
+    d = (const unsigned char *) der_blob;
+
+    cert = d2i_X509(NULL, &d, (int) der_size);
+    if (cert == NULL) {
+        DEBUG(SSSDBG_OP_FAILURE, "d2i_X509 failed.\n");
+        return EINVAL;
+    }
+
+    valid_until = cert_valid_until(cert);
+    X509_free(cert);
+
+    if (valid_until == 0) {
+        return EINVAL;
+    }
+
+    *_valid_until = valid_until;
+    return EOK;
+}
+
 errno_t cert_to_ssh_key(TALLOC_CTX *mem_ctx, const char *ca_db,
                         const uint8_t *der_blob, size_t der_size,
                         struct cert_verify_opts *cert_verify_opts,
                         uint8_t **key, size_t *key_size)
+{
+    return cert_to_ssh_key_ex(mem_ctx, ca_db, der_blob, der_size,
+                              cert_verify_opts, key, key_size, NULL);
+}
+
+errno_t cert_to_ssh_key_ex(TALLOC_CTX *mem_ctx, const char *ca_db,
+                           const uint8_t *der_blob, size_t der_size,
+                           struct cert_verify_opts *cert_verify_opts,
+                           uint8_t **key, size_t *key_size,
+                           time_t *_valid_until)
 {
     int ret;
     size_t size;
@@ -203,6 +258,16 @@ errno_t cert_to_ssh_key(TALLOC_CTX *mem_ctx, const char *ca_db,
 
     /* TODO: verify certificate !!!!! */
 
+    if (_valid_until != NULL) {
+        *_valid_until = cert_valid_until(cert);
+    }
+
+    if (key == NULL) {
+        /* only the validation was requested */
+        ret = EOK;
+        goto done;
+    }
+
     cert_pub_key = X509_get_pubkey(cert);
     if (cert_pub_key == NULL) {
         DEBUG(SSSDBG_OP_FAILURE, "X509_get_pubkey failed.\n");
@@ -22,6 +22,8 @@
 
 #include <nss.h>
 #include <cert.h>
+#include <certdb.h>
+#include <secder.h>
 #include <base64.h>
 #include <key.h>
 #include <prerror.h>
@@ -221,10 +223,105 @@ done:
 #define SSH_RSA_HEADER "ssh-rsa"
 #define SSH_RSA_HEADER_LEN (sizeof(SSH_RSA_HEADER) - 1)
 
+/* The result of the validation can be trusted until the certificate
+ * expires or the CRL of its issuer is updated, whichever comes first. */
+static time_t cert_valid_until(CERTCertDBHandle *handle,
+                               CERTCertificate *cert)
+{
+    PRTime not_before;
+    PRTime not_after;
+    PRTime next_update;
+    CERTSignedCrl *crl;
+    SECStatus rv;
+
+    rv = CERT_GetCertTimes(cert, &not_before, &not_after);
+    if (rv != SECSuccess) {
+        DEBUG(SSSDBG_OP_FAILURE, "CERT_GetCertTimes failed [%d].\n",
+                                 PR_GetError());
+        return 0;
+    }
+
+    crl = SEC_FindCrlByName(handle, &cert->derIssuer, SEC_CRL_TYPE);
+    if (crl != NULL) {
+        if (crl->crl.nextUpdate.len != 0) {
+            rv = DER_DecodeTimeChoice(&next_update, &crl->crl.nextUpdate);
+            if (rv == SECSuccess && next_update < not_after) {
+                not_after = next_update;
+            }
+        }
+        SEC_DestroyCrl(crl);
+    }
+
+    return not_after / PR_USEC_PER_SEC;
+}
+
+errno_t cert_der_valid_until(const char *ca_db,
+                             const uint8_t *der_blob, size_t der_size,
+                             time_t *_valid_until)
+{
+    CERTCertDBHandle *handle;
+    CERTCertificate *cert;
+    SECItem der_item;
+    NSSInitContext *nss_ctx;
+    NSSInitParameters parameters = { 0 };
+    parameters.length =  sizeof (parameters);
+    time_t valid_until;
+    SECStatus rv;
+
+    if (der_blob == NULL || der_size == 0) {
+        return EINVAL;
+    }
+
+    nss_ctx = NSS_InitContext(ca_db, "", "", SECMOD_DB, &parameters,
+                              NSS_INIT_READONLY);
+    if (nss_ctx == NULL) {
+        DEBUG(SSSDBG_OP_FAILURE, "NSS_InitContext failed [%d].\n",
+                                 PR_GetError());
+        return EIO;
+    }
+
+    handle = CERT_GetDefaultCertDB();
+
+    der_item.len = der_size;
+    der_item.data = discard_const(der_blob);
+
+    cert = CERT_NewTempCertificate(handle, &der_item, NULL, PR_FALSE, PR_TRUE);
+    if (cert == NULL) {
+        DEBUG(SSSDBG_OP_FAILURE, "CERT_NewTempCertificate failed.\n");
+        valid_until = 0;
+    } else {
+        valid_until = cert_valid_until(handle, cert);
+        CERT_DestroyCertificate(cert);
+    }
+
+    rv = NSS_ShutdownContext(nss_ctx);
+    if (rv != SECSuccess) {
+        DEBUG(SSSDBG_OP_FAILURE, "NSS_ShutdownContext failed [%d].\n",
+                                 PR_GetError());
+    }
+
+    if (valid_until == 0) {
+        return EINVAL;
+    }
+
+    *_valid_until = valid_until;
+    return EOK;
+}
+
 errno_t cert_to_ssh_key(TALLOC_CTX *mem_ctx, const char *ca_db,
                         const uint8_t *der_blob, size_t der_size,
                         struct cert_verify_opts *cert_verify_opts,
                         uint8_t **key, size_t *key_size)
+{
+    return cert_to_ssh_key_ex(mem_ctx, ca_db, der_blob, der_size,
+                              cert_verify_opts, key, key_size, NULL);
+}
+
+errno_t cert_to_ssh_key_ex(TALLOC_CTX *mem_ctx, const char *ca_db,
+                           const uint8_t *der_blob, size_t der_size,
+                           struct cert_verify_opts *cert_verify_opts,
+                           uint8_t **key, size_t *key_size,
+                           time_t *_valid_until)
 {
     CERTCertDBHandle *handle;
     CERTCertificate *cert = NULL;
@@ -328,6 +425,16 @@ errno_t cert_to_ssh_key(TALLOC_CTX *mem_ctx, const char *ca_db,
         }
     }
 
+    if (_valid_until != NULL) {
+        *_valid_until = cert_valid_until(handle, cert);
+    }
+
+    if (key == NULL) {
+        /* only the validation was requested */
+        ret = EOK;
+        goto done;
+    }
+
     cert_pub_key = CERT_ExtractPublicKey(cert);
     if (cert_pub_key == NULL) {
         DEBUG(SSSDBG_OP_FAILURE, "CERT_ExtractPublicKey failed.\n");
@@ -834,3 +834,901 @@ errno_t child_debug_init(const char *logfile, int *debug_fd)
 
     return EOK;
 }
+
+/* ==Pool=of=pre-forked=helpers=========================================== */
+
+/*
+ * The helpers are started once with --worker and then serve framed requests
+ * (uint32_t length and payload) read from child_in_fd, see
+ * sss_child_worker(). Each worker initializes the helper once and handles
+ * the requests one by one in the same process. A worker that fails a
+ * request exits without a reply and is replaced on demand.
+ * Requests that do not find an idle worker wait in a FIFO queue until a
+ * worker is released.
+ */
+
+struct sss_child_pool_state;
+
+struct sss_child_pool_worker {
+    struct sss_child_pool_worker *prev;
+    struct sss_child_pool_worker *next;
+
+    struct sss_child_pool *pool;
+    struct sss_child_ctx_old *child_ctx;
+    struct child_io_fds *io;
+    pid_t pid;
+
+    /* The request being served, if any */
+    struct sss_child_pool_state *state;
+
+    uint32_t num_jobs;
+    bool exited;
+};
+
+struct sss_child_pool {
+    struct tevent_context *ev;
+
+    const char *binary;
+    const char **extra_argv;
+    int debug_fd;
+    int child_in_fd;
+    int child_out_fd;
+
+    struct sss_child_pool_worker *workers;
+    size_t num_workers;
+    size_t max_workers;
+    uint32_t max_jobs;
+
+    struct sss_child_pool_state *queue;
+    size_t num_queued;
+    size_t max_queued;
+
+    struct tevent_immediate *dispatch_imm;
+    bool dispatch_scheduled;
+
+    struct sss_child_pool_stats stats;
+};
+
+struct sss_child_pool_state {
+    struct sss_child_pool_state *prev;
+    struct sss_child_pool_state *next;
+
+    struct tevent_context *ev;
+    struct tevent_req *req;
+    struct sss_child_pool *pool;
+    struct sss_child_pool_worker *worker;
+    struct tevent_req *call_req;
+    bool queued;
+
+    uint8_t *frame;
+    size_t frame_len;
+
+    struct timeval queued_at;
+    struct timeval started_at;
+
+    uint8_t *buf;
+    size_t len;
+};
+
+static void sss_child_pool_schedule_dispatch(struct sss_child_pool *pool);
+static void sss_child_pool_release(struct sss_child_pool_worker *worker,
+                                   bool reusable);
+
+static uint64_t sss_child_pool_elapsed(struct timeval *start)
+{
+    struct timeval now;
+    struct timeval diff;
+
+    now = tevent_timeval_current();
+    diff = tevent_timeval_until(start, &now);
+
+    return (uint64_t)diff.tv_sec * 1000000 + diff.tv_usec;
+}
+
+static void sss_child_pool_worker_exited(int child_status,
+                                         struct tevent_signal *sige,
+                                         void *pvt)
+{
+    struct sss_child_pool_worker *worker;
+    struct sss_child_pool *pool;
+
+    worker = talloc_get_type(pvt, struct sss_child_pool_worker);
+    pool = worker->pool;
+
+    DEBUG(SSSDBG_TRACE_FUNC, "%s worker [%d] exited.\n",
+          pool->binary, worker->pid);
+
+    /* The signal context is freed by the caller. */
+    worker->child_ctx = NULL;
+    worker->exited = true;
+
+    /* A busy worker is released when its request fails. */
+    if (worker->state == NULL) {
+        talloc_free(worker);
+        sss_child_pool_schedule_dispatch(pool);
+    }
+}
+
+static int sss_child_pool_worker_destructor(struct sss_child_pool_worker *w)
+{
+    DLIST_REMOVE(w->pool->workers, w);
+    w->pool->num_workers--;
+
+    if (w->state != NULL) {
+        w->pool->stats.busy--;
+        w->state->worker = NULL;
+        talloc_zfree(w->state->call_req);
+    }
+
+    if (w->exited) {
+        return 0;
+    }
+
+    /* The worker serves the requests itself and leads its own process
+     * group, killing the group also terminates any process the request
+     * in progress started. Kill the worker alone if there is no group. */
+    if (kill(-w->pid, SIGKILL) == -1) {
+        if (errno != ESRCH || kill(w->pid, SIGKILL) == -1) {
+            DEBUG(SSSDBG_MINOR_FAILURE,
+                  "kill failed [%d][%s].\n", errno, strerror(errno));
+        }
+    }
+
+    if (w->child_ctx != NULL) {
+        child_handler_destroy(w->child_ctx);
+    }
+
+    return 0;
+}
+
+static errno_t sss_child_pool_spawn(struct sss_child_pool *pool)
+{
+    int pipefd_to_child[2] = PIPE_INIT;
+    int pipefd_from_child[2] = PIPE_INIT;
+    struct sss_child_pool_worker *worker;
+    pid_t pid;
+    errno_t ret;
+
+    worker = talloc_zero(pool, struct sss_child_pool_worker);
+    if (worker == NULL) {
+        return ENOMEM;
+    }
+
+    worker->pool = pool;
+    worker->io = talloc(worker, struct child_io_fds);
+    if (worker->io == NULL) {
+        talloc_free(worker);
+        return ENOMEM;
+    }
+    worker->io->write_to_child_fd = -1;
+    worker->io->read_from_child_fd = -1;
+    talloc_set_destructor((void *) worker->io, child_io_destructor);
+
+    if (pipe(pipefd_from_child) == -1 || pipe(pipefd_to_child) == -1) {
+        ret = errno;
+        DEBUG(SSSDBG_CRIT_FAILURE,
+              "pipe failed [%d][%s].\n", ret, strerror(ret));
+        goto fail;
+    }
+
+    pid = fork();
+    if (pid == 0) { /* child */
+        exec_child_ex(worker, pipefd_to_child, pipefd_from_child,
+                      pool->binary, pool->debug_fd, pool->extra_argv, false,
+                      pool->child_in_fd, pool->child_out_fd);
+
+        /* We should never get here */
+        DEBUG(SSSDBG_CRIT_FAILURE, "BUG: Could not exec %s\n", pool->binary);
+        _exit(1);
+    } else if (pid == -1) {
+        ret = errno;
+        DEBUG(SSSDBG_CRIT_FAILURE,
+              "fork failed [%d][%s].\n", ret, strerror(ret));
+        goto fail;
+    }
+
+    /* The worker does the same, whichever runs first creates the group so
+     * that it exists as soon as the worker can be killed. EACCES means the
+     * worker already called exec(). */
+    if (setpgid(pid, pid) == -1 && errno != EACCES) {
+        DEBUG(SSSDBG_MINOR_FAILURE,
+              "setpgid failed [%d][%s].\n", errno, strerror(errno));
+    }
+
+    worker->pid = pid;
+    worker->io->read_from_child_fd = pipefd_from_child[0];
+    PIPE_FD_CLOSE(pipefd_from_child[1]);
+    worker->io->write_to_child_fd = pipefd_to_child[1];
+    PIPE_FD_CLOSE(pipefd_to_child[0]);
+    sss_fd_nonblocking(worker->io->read_from_child_fd);
+    sss_fd_nonblocking(worker->io->write_to_child_fd);
+
+    DLIST_ADD(pool->workers, worker);
+    pool->num_workers++;
+    talloc_set_destructor(worker, sss_child_pool_worker_destructor);
+
+    ret = child_handler_setup(pool->ev, worker->pid,
+                              sss_child_pool_worker_exited, worker,
+                              &worker->child_ctx);
+    if (ret != EOK) {
+        DEBUG(SSSDBG_CRIT_FAILURE,
+              "Could not set up child signal handler\n");
+        kill(worker->pid, SIGKILL);
+        talloc_free(worker);
+        return ret;
+    }
+
+    pool->stats.workers = pool->num_workers;
+
+    DEBUG(SSSDBG_TRACE_FUNC, "Started %s worker [%d].\n",
+          pool->binary, worker->pid);
+
+    return EOK;
+
+fail:
+    PIPE_CLOSE(pipefd_from_child);
+    PIPE_CLOSE(pipefd_to_child);
+    talloc_free(worker);
+    return ret;
+}
+
+static struct sss_child_pool_worker *
+sss_child_pool_get_idle(struct sss_child_pool *pool)
+{
+    struct sss_child_pool_worker *worker;
+    errno_t ret;
+
+    DLIST_FOR_EACH(worker, pool->workers) {
+        if (worker->state == NULL && !worker->exited) {
+            return worker;
+        }
+    }
+
+    if (pool->num_workers >= pool->max_workers) {
+        return NULL;
+    }
+
+    ret = sss_child_pool_spawn(pool);
+    if (ret != EOK) {
+        return NULL;
+    }
+
+    return pool->workers;
+}
+
+static void sss_child_pool_log_stats(struct sss_child_pool *pool)
+{
+    struct sss_child_pool_stats *s = &pool->stats;
+
+    DEBUG(SSSDBG_TRACE_FUNC, "%s pool: %"PRIu64" jobs, %"PRIu64" failed, "
+          "%"PRIu64" timed out, %"PRIu64" rejected, %"PRIu64" workers "
+          "recycled, queue peak %zu, average wait %"PRIu64" us, average "
+          "latency %"PRIu64" us\n", pool->binary, s->jobs, s->failures,
+          s->timeouts, s->rejected, s->recycled, s->queue_peak,
+          s->jobs == 0 ? 0 : s->wait_total / s->jobs,
+          s->jobs == 0 ? 0 : s->latency_total / s->jobs);
+}
+
+static void sss_child_pool_release(struct sss_child_pool_worker *worker,
+                                   bool reusable)
+{
+    struct sss_child_pool *pool = worker->pool;
+
+    if (worker->state != NULL) {
+        worker->state->worker = NULL;
+        worker->state = NULL;
+        pool->stats.busy--;
+    }
+
+    if (!reusable || worker->exited) {
+        talloc_free(worker);
+    } else if (worker->num_jobs >= pool->max_jobs) {
+        DEBUG(SSSDBG_TRACE_FUNC,
+              "Recycling %s worker [%d] after %"PRIu32" jobs.\n",
+              pool->binary, worker->pid, worker->num_jobs);
+        pool->stats.recycled++;
+        sss_child_pool_log_stats(pool);
+        talloc_free(worker);
+    }
+
+    pool->stats.workers = pool->num_workers;
+
+    /* Do not start the queued requests from within the callers, they may
+     * be running destructors. A replacement worker is forked on demand. */
+    sss_child_pool_schedule_dispatch(pool);
+}
+
+static void sss_child_pool_call_written(struct tevent_req *subreq);
+static void sss_child_pool_read_handler(struct tevent_context *ev,
+                                        struct tevent_fd *fde,
+                                        uint16_t flags, void *pvt);
+
+struct sss_child_pool_call_state {
+    struct tevent_context *ev;
+    int fd;
+
+    uint8_t header[sizeof(uint32_t)];
+    size_t header_len;
+    /* another frame of the reply follows the current one */
+    bool more;
+
+    uint8_t *buf;
+    size_t size;
+    size_t len;
+};
+
+/* Send a framed request to a worker, the reply is framed the same way but
+ * may consist of several frames. */
+static struct tevent_req *
+sss_child_pool_call_send(TALLOC_CTX *mem_ctx,
+                         struct tevent_context *ev,
+                         struct sss_child_pool_worker *worker,
+                         uint8_t *frame, size_t frame_len)
+{
+    struct sss_child_pool_call_state *state;
+    struct tevent_req *req;
+    struct tevent_req *subreq;
+
+    req = tevent_req_create(mem_ctx, &state,
+                            struct sss_child_pool_call_state);
+    if (req == NULL) {
+        return NULL;
+    }
+
+    state->ev = ev;
+    state->fd = worker->io->read_from_child_fd;
+
+    subreq = write_pipe_send(state, ev, frame, frame_len,
+                             worker->io->write_to_child_fd);
+    if (subreq == NULL) {
+        talloc_free(req);
+        return NULL;
+    }
+
+    tevent_req_set_callback(subreq, sss_child_pool_call_written, req);
+
+    return req;
+}
+
+static void sss_child_pool_call_written(struct tevent_req *subreq)
+{
+    struct sss_child_pool_call_state *state;
+    struct tevent_req *req;
+    struct tevent_fd *fde;
+    errno_t ret;
+
+    req = tevent_req_callback_data(subreq, struct tevent_req);
+    state = tevent_req_data(req, struct sss_child_pool_call_state);
+
+    ret = write_pipe_recv(subreq);
+    talloc_zfree(subreq);
+    if (ret != EOK) {
+        tevent_req_error(req, ret);
+        return;
+    }
+
+    fde = tevent_add_fd(state->ev, state, state->fd,
+                        TEVENT_FD_READ, sss_child_pool_read_handler, req);
+    if (fde == NULL) {
+        DEBUG(SSSDBG_CRIT_FAILURE, "tevent_add_fd failed.\n");
+        tevent_req_error(req, ENOMEM);
+        return;
+    }
+}
+
+static void sss_child_pool_read_handler(struct tevent_context *ev,
+                                        struct tevent_fd *fde,
+                                        uint16_t flags, void *pvt)
+{
+    struct sss_child_pool_call_state *state;
+    struct tevent_req *req;
+    uint32_t reply_len;
+    uint8_t *dest;
+    size_t count;
+    ssize_t size;
+    errno_t ret;
+
+    req = talloc_get_type(pvt, struct tevent_req);
+    state = tevent_req_data(req, struct sss_child_pool_call_state);
+
+    if (state->header_len < sizeof(uint32_t)) {
+        dest = &state->header[state->header_len];
+        count = sizeof(uint32_t) - state->header_len;
+    } else {
+        dest = &state->buf[state->len];
+        count = state->size - state->len;
+    }
+
+    errno = 0;
+    size = read(state->fd, dest, count);
+    if (size == -1) {
+        ret = errno;
+        if (ret == EAGAIN || ret == EINTR) {
+            return;
+        }
+        DEBUG(SSSDBG_CRIT_FAILURE,
+              "read failed [%d][%s].\n", ret, strerror(ret));
+        tevent_req_error(req, ret);
+        return;
+    } else if (size == 0) {
+        DEBUG(SSSDBG_CRIT_FAILURE, "Worker closed the pipe.\n");
+        tevent_req_error(req, EPIPE);
+        return;
+    }
+
+    if (state->header_len < sizeof(uint32_t)) {
+        state->header_len += size;
+        if (state->header_len < sizeof(uint32_t)) {
+            return;
+        }
+
+        SAFEALIGN_COPY_UINT32(&reply_len, state->header, NULL);
+        state->more = (reply_len & SSS_CHILD_POOL_FRAME_MORE) != 0;
+        reply_len &= ~SSS_CHILD_POOL_FRAME_MORE;
+        if (reply_len > SSS_CHILD_POOL_MAX_FRAME
+                || state->len + reply_len > SSS_CHILD_POOL_MAX_REPLY) {
+            DEBUG(SSSDBG_CRIT_FAILURE, "Reply is too large.\n");
+            tevent_req_error(req, EMSGSIZE);
+            return;
+        }
+
+        state->size = state->len + reply_len;
+        if (reply_len > 0) {
+            dest = talloc_realloc(state, state->buf, uint8_t, state->size);
+            if (dest == NULL) {
+                tevent_req_error(req, ENOMEM);
+                return;
+            }
+            state->buf = dest;
+        }
+    } else {
+        state->len += size;
+    }
+
+    if (state->len == state->size) {
+        if (state->more) {
+            /* Read the header of the next frame */
+            state->header_len = 0;
+            return;
+        }
+
+        tevent_req_done(req);
+    }
+}
+
+static errno_t sss_child_pool_call_recv(struct tevent_req *req,
+                                        TALLOC_CTX *mem_ctx,
+                                        uint8_t **_buf,
+                                        size_t *_len)
+{
+    struct sss_child_pool_call_state *state;
+    state = tevent_req_data(req, struct sss_child_pool_call_state);
+
+    TEVENT_REQ_RETURN_ON_ERROR(req);
+
+    *_buf = talloc_steal(mem_ctx, state->buf);
+    *_len = state->len;
+
+    return EOK;
+}
+
+static void sss_child_pool_done(struct tevent_req *subreq);
+
+static errno_t sss_child_pool_start(struct sss_child_pool_state *state,
+                                    struct sss_child_pool_worker *worker)
+{
+    struct sss_child_pool *pool = state->pool;
+    uint64_t wait;
+
+    state->call_req = sss_child_pool_call_send(state, state->ev, worker,
+                                               state->frame, state->frame_len);
+    if (state->call_req == NULL) {
+        return ENOMEM;
+    }
+    tevent_req_set_callback(state->call_req, sss_child_pool_done, state->req);
+
+    worker->state = state;
+    worker->num_jobs++;
+    state->worker = worker;
+    pool->stats.busy++;
+
+    state->started_at = tevent_timeval_current();
+    wait = sss_child_pool_elapsed(&state->queued_at);
+    pool->stats.wait_total += wait;
+    if (wait > pool->stats.wait_max) {
+        pool->stats.wait_max = wait;
+    }
+
+    DEBUG(SSSDBG_TRACE_INTERNAL, "Request passed to %s worker [%d].\n",
+          pool->binary, worker->pid);
+
+    return EOK;
+}
+
+static void sss_child_pool_dequeue(struct sss_child_pool_state *state)
+{
+    if (!state->queued) {
+        return;
+    }
+
+    DLIST_REMOVE(state->pool->queue, state);
+    state->pool->num_queued--;
+    state->pool->stats.queued = state->pool->num_queued;
+    state->queued = false;
+}
+
+static void sss_child_pool_dispatch(struct tevent_context *ev,
+                                    struct tevent_immediate *imm,
+                                    void *pvt)
+{
+    struct sss_child_pool *pool;
+    struct sss_child_pool_state *state;
+    struct sss_child_pool_worker *worker;
+    errno_t ret;
+
+    pool = talloc_get_type(pvt, struct sss_child_pool);
+    pool->dispatch_scheduled = false;
+
+    while (pool->queue != NULL) {
+        worker = sss_child_pool_get_idle(pool);
+        if (worker == NULL) {
+            break;
+        }
+
+        state = pool->queue;
+        sss_child_pool_dequeue(state);
+
+        ret = sss_child_pool_start(state, worker);
+        if (ret != EOK) {
+            pool->stats.failures++;
+            tevent_req_error(state->req, ret);
+        }
+    }
+}
+
+static void sss_child_pool_schedule_dispatch(struct sss_child_pool *pool)
+{
+    if (pool->queue == NULL || pool->dispatch_scheduled) {
+        return;
+    }
+
+    tevent_schedule_immediate(pool->dispatch_imm, pool->ev,
+                              sss_child_pool_dispatch, pool);
+    pool->dispatch_scheduled = true;
+}
+
+static int sss_child_pool_state_destructor(struct sss_child_pool_state *state)
+{
+    if (state->pool == NULL) {
+        return 0;
+    }
+
+    sss_child_pool_dequeue(state);
+
+    if (state->worker != NULL) {
+        /* The caller is not interested in the result anymore and the
+         * worker is in the middle of the request, do not reuse it. */
+        talloc_zfree(state->call_req);
+        sss_child_pool_release(state->worker, false);
+    }
+
+    return 0;
+}
+
+static void sss_child_pool_timeout(struct tevent_context *ev,
+                                   struct tevent_timer *te,
+                                   struct timeval tv, void *pvt)
+{
+    struct tevent_req *req;
+    struct sss_child_pool_state *state;
+
+    req = talloc_get_type(pvt, struct tevent_req);
+    state = tevent_req_data(req, struct sss_child_pool_state);
+
+    if (state->pool == NULL) {
+        /* The pool is gone. */
+        tevent_req_error(req, ETIMEDOUT);
+        return;
+    }
+
+    if (state->queued) {
+        DEBUG(SSSDBG_MINOR_FAILURE,
+              "Request timed out while waiting for a %s worker.\n",
+              state->pool->binary);
+        sss_child_pool_dequeue(state);
+    } else if (state->worker != NULL) {
+        DEBUG(SSSDBG_CRIT_FAILURE,
+              "Timeout reached for %s worker [%d], killing it.\n",
+              state->pool->binary, state->worker->pid);
+        talloc_zfree(state->call_req);
+        sss_child_pool_release(state->worker, false);
+    }
+
+    state->pool->stats.timeouts++;
+    tevent_req_error(req, ETIMEDOUT);
+}
+
+static int sss_child_pool_destructor(struct sss_child_pool *pool)
+{
+    struct sss_child_pool_state *state;
+
+    /* Pending requests are left to their timeouts. */
+    while ((state = pool->queue) != NULL) {
+        sss_child_pool_dequeue(state);
+        state->pool = NULL;
+    }
+
+    while (pool->workers != NULL) {
+        if (pool->workers->state != NULL) {
+            pool->workers->state->pool = NULL;
+        }
+        talloc_free(pool->workers);
+    }
+
+    return 0;
+}
+
+errno_t sss_child_pool_create(TALLOC_CTX *mem_ctx,
+                              struct tevent_context *ev,
+                              const char *binary,
+                              int debug_fd,
+                              const char *extra_argv[],
+                              int child_in_fd,
+                              int child_out_fd,
+                              size_t size,
+                              uint32_t max_jobs,
+                              size_t max_queued,
+                              struct sss_child_pool **_pool)
+{
+    struct sss_child_pool *pool;
+    size_t argc = 0;
+    size_t i;
+    errno_t ret;
+
+    if (size == 0) {
+        return EINVAL;
+    }
+
+    pool = talloc_zero(mem_ctx, struct sss_child_pool);
+    if (pool == NULL) {
+        return ENOMEM;
+    }
+
+    pool->ev = ev;
+    pool->debug_fd = debug_fd;
+    pool->child_in_fd = child_in_fd;
+    pool->child_out_fd = child_out_fd;
+    pool->max_workers = size;
+    pool->max_jobs = max_jobs > 0 ? max_jobs : UINT32_MAX;
+    pool->max_queued = max_queued;
+
+    pool->binary = talloc_strdup(pool, binary);
+    if (pool->binary == NULL) {
+        ret = ENOMEM;
+        goto done;
+    }
+
+    pool->dispatch_imm = tevent_create_immediate(pool);
+    if (pool->dispatch_imm == NULL) {
+        ret = ENOMEM;
+        goto done;
+    }
+
+    if (extra_argv != NULL) {
+        for (argc = 0; extra_argv[argc] != NULL; argc++);
+    }
+
+    pool->extra_argv = talloc_zero_array(pool, const char *, argc + 2);
+    if (pool->extra_argv == NULL) {
+        ret = ENOMEM;
+        goto done;
+    }
+
+    for (i = 0; i < argc; i++) {
+        pool->extra_argv[i] = talloc_strdup(pool->extra_argv, extra_argv[i]);
+        if (pool->extra_argv[i] == NULL) {
+            ret = ENOMEM;
+            goto done;
+        }
+    }
+    pool->extra_argv[argc] = "--worker";
+
+    talloc_set_destructor(pool, sss_child_pool_destructor);
+
+    for (i = 0; i < size; i++) {
+        ret = sss_child_pool_spawn(pool);
+        if (ret != EOK) {
+            /* Not fatal, the workers are started on demand as well. */
+            DEBUG(SSSDBG_MINOR_FAILURE,
+                  "Cannot pre-fork %s worker [%d]: %s\n",
+                  binary, ret, sss_strerror(ret));
+            break;
+        }
+    }
+
+    DEBUG(SSSDBG_CONF_SETTINGS, "%s pool of %zu workers, recycled after "
+          "%"PRIu32" jobs, up to %zu queued requests.\n",
+          binary, size, pool->max_jobs, max_queued);
+
+    *_pool = pool;
+    ret = EOK;
+
+done:
+    if (ret != EOK) {
+        talloc_free(pool);
+    }
+
+    return ret;
+}
+
+bool sss_child_pool_accepts(struct sss_child_pool *pool)
+{
+    struct sss_child_pool_worker *worker;
+
+    if (pool == NULL) {
+        return false;
+    }
+
+    if (pool->num_queued < pool->max_queued
+            || pool->num_workers < pool->max_workers) {
+        return true;
+    }
+
+    DLIST_FOR_EACH(worker, pool->workers) {
+        if (worker->state == NULL && !worker->exited) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+struct tevent_req *sss_child_pool_send(TALLOC_CTX *mem_ctx,
+                                       struct tevent_context *ev,
+                                       struct sss_child_pool *pool,
+                                       uint8_t *buf, size_t len,
+                                       int timeout)
+{
+    struct sss_child_pool_state *state;
+    struct sss_child_pool_worker *worker = NULL;
+    struct tevent_req *req;
+    struct tevent_timer *te;
+    size_t rp = 0;
+    errno_t ret;
+
+    req = tevent_req_create(mem_ctx, &state, struct sss_child_pool_state);
+    if (req == NULL) {
+        return NULL;
+    }
+
+    state->ev = ev;
+    state->req = req;
+    state->queued_at = tevent_timeval_current();
+
+    if (len > SSS_CHILD_POOL_MAX_FRAME) {
+        DEBUG(SSSDBG_CRIT_FAILURE, "Request is too large.\n");
+        ret = EMSGSIZE;
+        goto immediately;
+    }
+
+    state->frame_len = sizeof(uint32_t) + len;
+    state->frame = talloc_size(state, state->frame_len);
+    if (state->frame == NULL) {
+        ret = ENOMEM;
+        goto immediately;
+    }
+
+    SAFEALIGN_SET_UINT32(&state->frame[rp], len, &rp);
+    if (len > 0) {
+        safealign_memcpy(&state->frame[rp], buf, len, &rp);
+    }
+
+    /* Keep the FIFO order if other requests are already waiting. */
+    if (pool->queue == NULL) {
+        worker = sss_child_pool_get_idle(pool);
+    }
+
+    if (worker == NULL && pool->num_queued >= pool->max_queued) {
+        DEBUG(SSSDBG_TRACE_FUNC, "All %s workers are busy.\n", pool->binary);
+        pool->stats.rejected++;
+        ret = EAGAIN;
+        goto immediately;
+    }
+
+    state->pool = pool;
+    talloc_set_destructor(state, sss_child_pool_state_destructor);
+
+    if (timeout > 0) {
+        te = tevent_add_timer(ev, state, tevent_timeval_current_ofs(timeout, 0),
+                              sss_child_pool_timeout, req);
+        if (te == NULL) {
+            ret = ENOMEM;
+            goto immediately;
+        }
+    }
+
+    if (worker != NULL) {
+        ret = sss_child_pool_start(state, worker);
+        if (ret != EOK) {
+            goto immediately;
+        }
+
+        return req;
+    }
+
+    DLIST_ADD_END(pool->queue, state, struct sss_child_pool_state *);
+    state->queued = true;
+    pool->num_queued++;
+    pool->stats.queued = pool->num_queued;
+    if (pool->num_queued > pool->stats.queue_peak) {
+        pool->stats.queue_peak = pool->num_queued;
+    }
+
+    DEBUG(SSSDBG_TRACE_FUNC, "All %s workers are busy, request queued as "
+          "number %zu.\n", pool->binary, pool->num_queued);
+
+    return req;
+
+immediately:
+    tevent_req_error(req, ret);
+    tevent_req_post(req, ev);
+
+    return req;
+}
+
+static void sss_child_pool_done(struct tevent_req *subreq)
+{
+    struct tevent_req *req;
+    struct sss_child_pool_state *state;
+    struct sss_child_pool *pool;
+    uint64_t latency;
+    errno_t ret;
+
+    req = tevent_req_callback_data(subreq, struct tevent_req);
+    state = tevent_req_data(req, struct sss_child_pool_state);
+    pool = state->pool;
+
+    ret = sss_child_pool_call_recv(subreq, state, &state->buf, &state->len);
+    talloc_zfree(subreq);
+    state->call_req = NULL;
+
+    /* A worker that failed to pass the reply is in an unknown state. */
+    sss_child_pool_release(state->worker, ret == EOK);
+
+    if (ret != EOK) {
+        pool->stats.failures++;
+        tevent_req_error(req, ret);
+        return;
+    }
+
+    latency = sss_child_pool_elapsed(&state->started_at);
+    pool->stats.jobs++;
+    pool->stats.latency_total += latency;
+    if (latency > pool->stats.latency_max) {
+        pool->stats.latency_max = latency;
+    }
+
+    tevent_req_done(req);
+}
+
+errno_t sss_child_pool_recv(struct tevent_req *req,
+                            TALLOC_CTX *mem_ctx,
+                            uint8_t **_buf,
+                            ssize_t *_len)
+{
+    struct sss_child_pool_state *state;
+    state = tevent_req_data(req, struct sss_child_pool_state);
+
+    TEVENT_REQ_RETURN_ON_ERROR(req);
+
+    *_buf = talloc_steal(mem_ctx, state->buf);
+    *_len = state->len;
+
+    return EOK;
+}
+
+void sss_child_pool_get_stats(struct sss_child_pool *pool,
+                              struct sss_child_pool_stats *stats)
+{
+    *stats = pool->stats;
+}
@@ -121,4 +121,90 @@ int child_io_destructor(void *ptr);
 
 errno_t child_debug_init(const char *logfile, int *debug_fd);
 
+/* POOL OF PRE-FORKED HELPERS */
+
+/* Largest frame passed between the pool and a worker. Requests must fit
+ * into one frame, larger replies are split into several frames, all but
+ * the last one with SSS_CHILD_POOL_FRAME_MORE set in the length. */
+#define SSS_CHILD_POOL_MAX_FRAME (64 * 1024)
+#define SSS_CHILD_POOL_FRAME_MORE 0x80000000
+
+/* Largest reply of a worker */
+#define SSS_CHILD_POOL_MAX_REPLY (4 * 1024 * 1024)
+
+/* Default number of requests a worker serves before it is replaced */
+#define SSS_CHILD_POOL_MAX_JOBS 100
+
+/* Handles a single request of a worker. The reply is allocated on mem_ctx,
+ * which is freed once the reply was sent. Returning an error makes the
+ * worker exit without a reply, the pool then fails the request with EPIPE
+ * and replaces the worker. */
+typedef errno_t (*sss_child_worker_fn)(TALLOC_CTX *mem_ctx,
+                                       uint8_t *req_buf, uint32_t req_len,
+                                       uint8_t **_reply, uint32_t *_reply_len,
+                                       void *pvt);
+
+/* Called by a helper started with --worker once it is initialized. Reads
+ * framed requests from in_fd, passes them to handler in this process and
+ * writes the replies to out_fd. Never returns. */
+void sss_child_worker(const char *name, int in_fd, int out_fd,
+                      sss_child_worker_fn handler, void *pvt);
+
+struct sss_child_pool;
+
+/* Times are in microseconds */
+struct sss_child_pool_stats {
+    uint64_t jobs;
+    uint64_t failures;
+    uint64_t timeouts;
+    uint64_t rejected;
+    uint64_t recycled;
+
+    size_t workers;
+    size_t busy;
+    size_t queued;
+    size_t queue_peak;
+
+    uint64_t wait_total;
+    uint64_t wait_max;
+    uint64_t latency_total;
+    uint64_t latency_max;
+};
+
+/* Start size helpers as binary --worker [extra_argv]. A worker is replaced
+ * after max_jobs requests (0 means never) or whenever a request fails. If
+ * all workers are busy up to max_queued requests wait for one. */
+errno_t sss_child_pool_create(TALLOC_CTX *mem_ctx,
+                              struct tevent_context *ev,
+                              const char *binary,
+                              int debug_fd,
+                              const char *extra_argv[],
+                              int child_in_fd,
+                              int child_out_fd,
+                              size_t size,
+                              uint32_t max_jobs,
+                              size_t max_queued,
+                              struct sss_child_pool **_pool);
+
+/* True if a request sent now would not be rejected with EAGAIN */
+bool sss_child_pool_accepts(struct sss_child_pool *pool);
+
+/* Pass the request buffer a helper would read from child_in_fd to a worker.
+ * Fails with EAGAIN if the queue is full and with ETIMEDOUT if the request
+ * does not finish within timeout seconds, including the time spent in the
+ * queue. An empty reply means that the helper failed. */
+struct tevent_req *sss_child_pool_send(TALLOC_CTX *mem_ctx,
+                                       struct tevent_context *ev,
+                                       struct sss_child_pool *pool,
+                                       uint8_t *buf, size_t len,
+                                       int timeout);
+
+errno_t sss_child_pool_recv(struct tevent_req *req,
+                            TALLOC_CTX *mem_ctx,
+                            uint8_t **_buf,
+                            ssize_t *_len);
+
+void sss_child_pool_get_stats(struct sss_child_pool *pool,
+                              struct sss_child_pool_stats *stats);
+
 #endif /* __CHILD_COMMON_H__ */
@@ -0,0 +1,153 @@
+/*
+    SSSD
+
+    Helper process side of the pool of pre-forked helpers
+
+    Copyright (C) 2016 Red Hat
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <sys/types.h>
+#include <unistd.h>
+
+#include "util/util.h"
+#include "util/child_common.h"
+
+static errno_t child_worker_send_frame(int fd, uint8_t *buf, uint32_t len,
+                                       bool more)
+{
+    uint32_t header;
+    ssize_t written;
+
+    header = len | (more ? SSS_CHILD_POOL_FRAME_MORE : 0);
+
+    errno = 0;
+    written = sss_atomic_write_s(fd, &header, sizeof(uint32_t));
+    if (written == sizeof(uint32_t) && len > 0) {
+        written = sss_atomic_write_s(fd, buf, len);
+        if (written != (ssize_t) len) {
+            written = -1;
+        }
+    }
+
+    if (written == -1) {
+        return errno == 0 ? EIO : errno;
+    }
+
+    return EOK;
+}
+
+static errno_t child_worker_send_reply(int fd, uint8_t *buf, uint32_t len)
+{
+    uint32_t chunk;
+    errno_t ret;
+
+    do {
+        chunk = len > SSS_CHILD_POOL_MAX_FRAME ? SSS_CHILD_POOL_MAX_FRAME
+                                               : len;
+        ret = child_worker_send_frame(fd, buf, chunk, chunk < len);
+        if (ret != EOK) {
+            return ret;
+        }
+
+        buf += chunk;
+        len -= chunk;
+    } while (len > 0);
+
+    return EOK;
+}
+
+void sss_child_worker(const char *name, int in_fd, int out_fd,
+                      sss_child_worker_fn handler, void *pvt)
+{
+    TALLOC_CTX *tmp_ctx;
+    uint8_t *buf;
+    uint8_t *reply;
+    uint32_t reply_len;
+    uint32_t len;
+    ssize_t size;
+    errno_t ret;
+
+    /* Let the parent kill the worker together with the processes started
+     * by the request in progress if it times out. The parent sets the
+     * group as well, this covers the case where exec() came first. */
+    if (setpgid(0, 0) != 0) {
+        DEBUG(SSSDBG_MINOR_FAILURE, "setpgid failed.\n");
+    }
+
+    buf = talloc_size(NULL, SSS_CHILD_POOL_MAX_FRAME);
+    if (buf == NULL) {
+        DEBUG(SSSDBG_CRIT_FAILURE, "talloc_size failed.\n");
+        _exit(1);
+    }
+
+    DEBUG(SSSDBG_TRACE_FUNC, "%s is waiting for requests.\n", name);
+
+    while (true) {
+        errno = 0;
+        size = sss_atomic_read_s(in_fd, &len, sizeof(uint32_t));
+        if (size == 0) {
+            DEBUG(SSSDBG_TRACE_FUNC, "Parent closed the pipe, exiting.\n");
+            _exit(0);
+        } else if (size != sizeof(uint32_t)) {
+            DEBUG(SSSDBG_CRIT_FAILURE, "Cannot read request length.\n");
+            _exit(1);
+        }
+
+        if (len > SSS_CHILD_POOL_MAX_FRAME) {
+            DEBUG(SSSDBG_CRIT_FAILURE,
+                  "Request of %"PRIu32" bytes is too large.\n", len);
+            _exit(1);
+        }
+
+        errno = 0;
+        size = sss_atomic_read_s(in_fd, buf, len);
+        if (size != (ssize_t) len) {
+            DEBUG(SSSDBG_CRIT_FAILURE, "Cannot read request.\n");
+            _exit(1);
+        }
+
+        tmp_ctx = talloc_new(NULL);
+        if (tmp_ctx == NULL) {
+            DEBUG(SSSDBG_CRIT_FAILURE, "talloc_new failed.\n");
+            _exit(1);
+        }
+
+        reply = NULL;
+        reply_len = 0;
+        ret = handler(tmp_ctx, buf, len, &reply, &reply_len, pvt);
+        if (ret == EOK && reply_len > SSS_CHILD_POOL_MAX_REPLY) {
+            DEBUG(SSSDBG_CRIT_FAILURE, "Reply is too large.\n");
+            ret = EMSGSIZE;
+        }
+
+        if (ret != EOK) {
+            /* The state of the helper is unknown after a failure. Exit
+             * without a reply, the pool fails the request and replaces
+             * this worker. */
+            DEBUG(SSSDBG_CRIT_FAILURE, "Request failed [%d]: %s, exiting.\n",
+                  ret, sss_strerror(ret));
+            _exit(1);
+        }
+
+        ret = child_worker_send_reply(out_fd, reply, reply_len);
+        talloc_free(tmp_ctx);
+        if (ret != EOK) {
+            DEBUG(SSSDBG_CRIT_FAILURE,
+                  "Cannot send reply [%d][%s].\n", ret, strerror(ret));
+            _exit(1);
+        }
+    }
+}
@@ -0,0 +1,54 @@
+/*
+    SSSD
+
+    SHA-256 digest - openssl version
+
+    Copyright (C) 2016 Red Hat
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "util/util.h"
+#include "util/crypto/sss_crypto.h"
+
+#include <openssl/evp.h>
+
+#include "sss_openssl.h"
+
+int sss_sha256(const unsigned char *in,
+               size_t in_len,
+               unsigned char *out)
+{
+    int ret;
+    EVP_MD_CTX *ctx;
+    unsigned int res_len;
+
+    ctx = EVP_MD_CTX_new();
+    if (ctx == NULL) {
+        return ENOMEM;
+    }
+
+    if (!EVP_DigestInit_ex(ctx, EVP_sha256(), NULL)) {
+        ret = EIO;
+        goto done;
+    }
+
+    EVP_DigestUpdate(ctx, in, in_len);
+    EVP_DigestFinal_ex(ctx, out, &res_len);
+    ret = EOK;
+
+done:
+    EVP_MD_CTX_free(ctx);
+    return ret;
+}
@@ -0,0 +1,53 @@
+/*
+    SSSD
+
+    SHA-256 digest - NSS version
+
+    Copyright (C) 2016 Red Hat
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "util/util.h"
+#include "util/crypto/sss_crypto.h"
+#include "util/crypto/nss/nss_util.h"
+
+#include <sechash.h>
+
+int sss_sha256(const unsigned char *in,
+               size_t in_len,
+               unsigned char *out)
+{
+    int ret;
+    HASHContext *sha256;
+    unsigned int res_len;
+
+    ret = nspr_nss_init();
+    if (ret != EOK) {
+        return ret;
+    }
+
+    sha256 = HASH_Create(HASH_AlgSHA256);
+    if (!sha256) {
+        return ENOMEM;
+    }
+
+    HASH_Begin(sha256);
+    HASH_Update(sha256, in, in_len);
+    HASH_End(sha256, out, &res_len, SSS_SHA256_LENGTH);
+
+    HASH_Destroy(sha256);
+
+    return EOK;
+}
@@ -48,6 +48,12 @@ int sss_hmac_sha1(const unsigned char *key,
                   size_t in_len,
                   unsigned char *out);
 
+#define SSS_SHA256_LENGTH 32
+
+int sss_sha256(const unsigned char *in,
+               size_t in_len,
+               unsigned char *out);
+
 int sss_password_encrypt(TALLOC_CTX *mem_ctx, const char *password, int plen,
                          enum obfmethod meth, char **obfpwd);
 
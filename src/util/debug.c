@@ -29,6 +29,7 @@
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <sys/time.h>
+#include <time.h>
 
 #ifdef WITH_JOURNALD
 #include <systemd/sd-journal.h>
@@ -45,6 +46,42 @@ int debug_to_file = 0;
 int debug_to_stderr = 0;
 const char *debug_log_file = "sssd";
 FILE *debug_file = NULL;
+int debug_backtrace_level = 0;
+
+/* Size of the buffer holding messages not yet written in the buffered mode */
+#define DEBUG_BUFFER_SIZE (64 * 1024)
+/* Size of each of the two halves of the flight recorder */
+#define DEBUG_BACKTRACE_SIZE (512 * 1024)
+
+/* Messages of these levels are written out immediately even in the buffered
+ * mode and dump the flight recorder to the log */
+#define DEBUG_BACKTRACE_TRIGGER (SSSDBG_FATAL_FAILURE | SSSDBG_CRIT_FAILURE | \
+                                 SSSDBG_OP_FAILURE)
+
+struct debug_buffer {
+    char *data;
+    size_t size;
+    size_t used;
+};
+
+/* SSSD processes log from a single thread, so the buffers below need no
+ * locking. A forked child that did not exec yet discards the content it
+ * inherited from its parent instead of writing it once more. */
+static pid_t debug_buffer_pid;
+
+/* Messages waiting to be written to the log in the buffered mode */
+static struct debug_buffer debug_out;
+
+/* The flight recorder keeps recent messages that are not logged with the
+ * current debug_level. It is filled in turns so that at least one half
+ * of recent history is always available. */
+static struct debug_buffer debug_bt[2];
+static int debug_bt_cur;
+
+/* Timestamp of the current event loop iteration, see debug_loop_tick() */
+static struct timeval debug_tick_tv;
+static bool debug_tick_valid;
+static bool debug_tick_driven;
 
 errno_t set_debug_file_from_fd(const int fd)
 {
@@ -65,6 +102,7 @@ errno_t set_debug_file_from_fd(const int fd)
         return ret;
     }
 
+    debug_flush_buffer();
     debug_file = dummy;
 
     return EOK;
@@ -143,6 +181,277 @@ static void debug_printf(const char *format, ...)
     va_end(ap);
 }
 
+static void debug_timestamp(struct timeval *_tv,
+                            const char **_datetime,
+                            int *_year)
+{
+    static const char *days[] = {
+        "Sun", "Mon", "Tue", "Wed", "Thu", "Fri", "Sat"
+    };
+    static const char *months[] = {
+        "Jan", "Feb", "Mar", "Apr", "May", "Jun",
+        "Jul", "Aug", "Sep", "Oct", "Nov", "Dec"
+    };
+    static time_t cached_sec = -1;
+    static char cached_datetime[20];
+    static int cached_year;
+    struct tm tm;
+
+    if (!debug_tick_valid) {
+        gettimeofday(&debug_tick_tv, NULL);
+        debug_tick_valid = debug_tick_driven;
+    }
+
+    /* localtime() is expensive, only convert when the second changes */
+    if (debug_tick_tv.tv_sec != cached_sec) {
+        localtime_r(&debug_tick_tv.tv_sec, &tm);
+        /* same as ctime() without the year */
+        snprintf(cached_datetime, sizeof(cached_datetime),
+                 "%.3s %.3s%3d %.2d:%.2d:%.2d",
+                 days[tm.tm_wday], months[tm.tm_mon], tm.tm_mday,
+                 tm.tm_hour, tm.tm_min, tm.tm_sec);
+        cached_year = tm.tm_year + 1900;
+        cached_sec = debug_tick_tv.tv_sec;
+    }
+
+    *_tv = debug_tick_tv;
+    *_datetime = cached_datetime;
+    *_year = cached_year;
+}
+
+static int debug_format_prefix(char *out, size_t size,
+                               const char *function, int level)
+{
+    struct timeval tv;
+    const char *datetime;
+    int year;
+
+    if (!debug_timestamps) {
+        return snprintf(out, size, "[%s] [%s] (%#.4x): ",
+                        debug_prg_name, function, level);
+    }
+
+    debug_timestamp(&tv, &datetime, &year);
+    if (debug_microseconds) {
+        return snprintf(out, size, "(%s:%.6ld %d) [%s] [%s] (%#.4x): ",
+                        datetime, tv.tv_usec, year, debug_prg_name,
+                        function, level);
+    }
+
+    return snprintf(out, size, "(%s %d) [%s] [%s] (%#.4x): ",
+                    datetime, year, debug_prg_name, function, level);
+}
+
+static void debug_buffer_check_pid(void)
+{
+    pid_t pid;
+
+    pid = getpid();
+    if (pid != debug_buffer_pid) {
+        debug_out.used = 0;
+        debug_bt[0].used = 0;
+        debug_bt[1].used = 0;
+        debug_buffer_pid = pid;
+    }
+}
+
+/* Formats the whole message at the end of the buffer. Returns false and
+ * leaves the buffer untouched if the message does not fit. */
+static bool debug_buffer_format(struct debug_buffer *buf,
+                                const char *function,
+                                int level,
+                                int flags,
+                                const char *format,
+                                va_list ap)
+{
+    size_t start = buf->used;
+    va_list ap_copy;
+    int n;
+
+    n = debug_format_prefix(buf->data + buf->used, buf->size - buf->used,
+                            function, level);
+    if (n < 0 || (size_t) n >= buf->size - buf->used) {
+        goto fail;
+    }
+    buf->used += n;
+
+    va_copy(ap_copy, ap);
+    n = vsnprintf(buf->data + buf->used, buf->size - buf->used,
+                  format, ap_copy);
+    va_end(ap_copy);
+    if (n < 0 || (size_t) n >= buf->size - buf->used) {
+        goto fail;
+    }
+    buf->used += n;
+
+    if (flags & APPEND_LINE_FEED) {
+        if (buf->used + 1 >= buf->size) {
+            goto fail;
+        }
+        buf->data[buf->used++] = '\n';
+    }
+
+    return true;
+
+fail:
+    buf->used = start;
+    return false;
+}
+
+void debug_flush_buffer(void)
+{
+    FILE *f;
+
+    if (debug_out.used == 0) {
+        return;
+    }
+
+    debug_buffer_check_pid();
+
+    f = debug_file ? debug_file : stderr;
+    fwrite(debug_out.data, 1, debug_out.used, f);
+    fflush(f);
+    debug_out.used = 0;
+}
+
+static void debug_write(const char *data, size_t len)
+{
+    if (debug_out.data != NULL) {
+        if (len <= debug_out.size - debug_out.used) {
+            memcpy(debug_out.data + debug_out.used, data, len);
+            debug_out.used += len;
+            return;
+        }
+        debug_flush_buffer();
+    }
+
+    fwrite(data, 1, len, debug_file ? debug_file : stderr);
+}
+
+static void debug_backtrace_record(const char *function,
+                                   int level,
+                                   int flags,
+                                   const char *format,
+                                   va_list ap)
+{
+    if (debug_buffer_format(&debug_bt[debug_bt_cur], function, level, flags,
+                            format, ap)) {
+        return;
+    }
+
+    /* Drop the older half. Messages longer than a half are not recorded. */
+    debug_bt_cur = !debug_bt_cur;
+    debug_bt[debug_bt_cur].used = 0;
+    (void) debug_buffer_format(&debug_bt[debug_bt_cur], function, level,
+                               flags, format, ap);
+}
+
+static void debug_backtrace_dump(void)
+{
+    static const char begin[] =
+        "********************** BACKTRACE DUMP BEGIN **********************\n";
+    static const char end[] =
+        "********************** BACKTRACE DUMP END ************************\n";
+    struct debug_buffer *older = &debug_bt[!debug_bt_cur];
+    struct debug_buffer *newer = &debug_bt[debug_bt_cur];
+
+    if (older->used == 0 && newer->used == 0) {
+        return;
+    }
+
+    debug_write(begin, sizeof(begin) - 1);
+    debug_write(older->data, older->used);
+    debug_write(newer->data, newer->used);
+    debug_write(end, sizeof(end) - 1);
+
+    older->used = 0;
+    newer->used = 0;
+}
+
+static void debug_buffer_free(struct debug_buffer *buf)
+{
+    free(buf->data);
+    buf->data = NULL;
+    buf->size = 0;
+    buf->used = 0;
+}
+
+static errno_t debug_buffer_alloc(struct debug_buffer *buf, size_t size)
+{
+    if (buf->data != NULL) {
+        return EOK;
+    }
+
+    buf->data = malloc(size);
+    if (buf->data == NULL) {
+        return ENOMEM;
+    }
+    buf->size = size;
+    buf->used = 0;
+
+    return EOK;
+}
+
+errno_t debug_set_buffered(bool enable)
+{
+    static bool atexit_done = false;
+    errno_t ret;
+
+    if (!enable) {
+        debug_flush_buffer();
+        debug_buffer_free(&debug_out);
+        return EOK;
+    }
+
+    ret = debug_buffer_alloc(&debug_out, DEBUG_BUFFER_SIZE);
+    if (ret != EOK) {
+        return ret;
+    }
+    debug_buffer_pid = getpid();
+
+    if (!atexit_done) {
+        if (atexit(debug_flush_buffer) != 0) {
+            debug_buffer_free(&debug_out);
+            return EIO;
+        }
+        atexit_done = true;
+    }
+
+    return EOK;
+}
+
+errno_t debug_set_backtrace_level(int level)
+{
+    errno_t ret;
+
+    if (level == 0) {
+        debug_backtrace_level = 0;
+        debug_buffer_free(&debug_bt[0]);
+        debug_buffer_free(&debug_bt[1]);
+        return EOK;
+    }
+
+    ret = debug_buffer_alloc(&debug_bt[0], DEBUG_BACKTRACE_SIZE);
+    if (ret == EOK) {
+        ret = debug_buffer_alloc(&debug_bt[1], DEBUG_BACKTRACE_SIZE);
+    }
+    if (ret != EOK) {
+        debug_buffer_free(&debug_bt[0]);
+        return ret;
+    }
+    debug_buffer_pid = getpid();
+
+    debug_backtrace_level = debug_convert_old_level(level);
+
+    return EOK;
+}
+
+void debug_loop_tick(void)
+{
+    debug_tick_driven = true;
+    debug_tick_valid = false;
+}
+
 #ifdef WITH_JOURNALD
 errno_t journal_send(const char *file,
         long line,
@@ -215,14 +524,29 @@ void sss_vdebug_fn(const char *file,
                    va_list ap)
 {
     struct timeval tv;
-    struct tm *tm;
-    char datetime[20];
+    const char *datetime;
     int year;
 
 #ifdef WITH_JOURNALD
     errno_t ret;
     va_list ap_fallback;
+#endif
+
+    if (debug_bt[0].data != NULL) {
+        debug_buffer_check_pid();
 
+        if (!DEBUG_IS_LOGGED(level)) {
+            /* only messages of debug_backtrace_level get here */
+            debug_backtrace_record(function, level, flags, format, ap);
+            return;
+        }
+
+        if (level & DEBUG_BACKTRACE_TRIGGER) {
+            debug_backtrace_dump();
+        }
+    }
+
+#ifdef WITH_JOURNALD
     if (!debug_file && !debug_to_stderr) {
         /* If we are not outputting logs to files, we should be sending them
          * to journald.
@@ -235,6 +559,7 @@ void sss_vdebug_fn(const char *file,
         ret = journal_send(file, line, function, level, format, ap);
         if (ret != EOK) {
             /* Emergency fallback, send to STDERR */
+            debug_flush_buffer();
             debug_vprintf(format, ap_fallback);
             debug_fflush();
         }
@@ -243,13 +568,28 @@ void sss_vdebug_fn(const char *file,
     }
 #endif
 
+    if (debug_out.data != NULL) {
+        debug_buffer_check_pid();
+
+        if (!debug_buffer_format(&debug_out, function, level, flags,
+                                 format, ap)) {
+            debug_flush_buffer();
+            if (!debug_buffer_format(&debug_out, function, level, flags,
+                                     format, ap)) {
+                /* longer than the whole buffer, write it directly below */
+                goto unbuffered;
+            }
+        }
+
+        if (level & DEBUG_BACKTRACE_TRIGGER) {
+            debug_flush_buffer();
+        }
+        return;
+    }
+
+unbuffered:
     if (debug_timestamps) {
-        gettimeofday(&tv, NULL);
-        tm = localtime(&tv.tv_sec);
-        year = tm->tm_year + 1900;
-        /* get date time without year */
-        memcpy(datetime, ctime(&tv.tv_sec), 19);
-        datetime[19] = '\0';
+        debug_timestamp(&tv, &datetime, &year);
         if (debug_microseconds) {
             debug_printf("(%s:%.6ld %d) [%s] [%s] (%#.4x): ",
                          datetime, tv.tv_usec,
@@ -372,7 +712,10 @@ int open_debug_file_ex(const char *filename, FILE **filep, bool want_cloexec)
         return ENOMEM;
     }
 
-    if (debug_file && !filep) fclose(debug_file);
+    if (debug_file && !filep) {
+        debug_flush_buffer();
+        fclose(debug_file);
+    }
 
     old_umask = umask(SSS_DFL_UMASK);
     errno = 0;
@@ -418,6 +761,8 @@ int rotate_debug_files(void)
 
     if (!debug_to_file) return EOK;
 
+    debug_flush_buffer();
+
     do {
         error = 0;
         ret = fclose(debug_file);
@@ -38,6 +38,7 @@ extern int debug_microseconds;
 extern int debug_to_file;
 extern int debug_to_stderr;
 extern const char *debug_log_file;
+extern int debug_backtrace_level;
 void sss_vdebug_fn(const char *file,
                    long line,
                    const char *function,
@@ -54,6 +55,21 @@ int debug_convert_old_level(int old_level);
 errno_t set_debug_file_from_fd(const int fd);
 int get_fd_from_debug_file(void);
 
+/* In the buffered mode messages are collected in memory and written to the
+ * log in batches by debug_flush_buffer(), which is called when the buffer is
+ * full, after error-level messages and once per event loop iteration when
+ * the process runs one. */
+errno_t debug_set_buffered(bool enable);
+void debug_flush_buffer(void);
+/* Starts a new event loop iteration, the timestamp of the debug messages is
+ * then only taken once per iteration */
+void debug_loop_tick(void);
+
+/* Messages of the given level which are not logged with the current
+ * debug_level are kept in memory and dumped to the log when an error-level
+ * message is logged. Level 0 disables the recorder. */
+errno_t debug_set_backtrace_level(int level);
+
 #define SSS_DOM_ENV           "_SSS_DOM"
 
 #define SSSDBG_FATAL_FAILURE  0x0010   /* level 0 */
@@ -67,6 +83,7 @@ int get_fd_from_debug_file(void);
 #define SSSDBG_TRACE_INTERNAL 0x2000   /* level 8 */
 #define SSSDBG_TRACE_ALL      0x4000   /* level 9 */
 #define SSSDBG_BE_FO          0x8000   /* level 9 */
+#define SSSDBG_PERF_STAT      0x20000  /* only enabled explicitly */
 #define SSSDBG_IMPORTANT_INFO SSSDBG_OP_FAILURE
 
 #define SSSDBG_INVALID        -1
@@ -110,11 +127,19 @@ int get_fd_from_debug_file(void);
 } while (0)
 
 /** \def DEBUG_IS_SET(level)
-    \brief checks whether level is set in debug_level
+    \brief checks whether level is set in debug_level or debug_backtrace_level
+
+    \param level the debug level, please use one of the SSSDBG*_ macros
+*/
+#define DEBUG_IS_SET(level) (DEBUG_IS_LOGGED(level) || \
+                             debug_backtrace_level & (level))
+
+/** \def DEBUG_IS_LOGGED(level)
+    \brief checks whether messages of level are written to the log
 
     \param level the debug level, please use one of the SSSDBG*_ macros
 */
-#define DEBUG_IS_SET(level) (debug_level & (level) || \
+#define DEBUG_IS_LOGGED(level) (debug_level & (level) || \
                             (debug_level == SSSDBG_UNRESOLVED && \
                                             (level & (SSSDBG_FATAL_FAILURE | \
                                                       SSSDBG_CRIT_FAILURE))))
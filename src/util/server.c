@@ -32,6 +32,7 @@
 #include "util/util.h"
 #include "confdb/confdb.h"
 #include "monitor/monitor_interfaces.h"
+#include "util/sss_perf.h"
 
 #ifdef HAVE_PRCTL
 #include <sys/prctl.h>
@@ -443,6 +444,34 @@ static const char *get_pid_path(void)
 #endif
 }
 
+static void te_server_perf_dump(struct tevent_context *ev,
+                                struct tevent_signal *se,
+                                int signum,
+                                int count,
+                                void *siginfo,
+                                void *private_data)
+{
+    DEBUG(SSSDBG_IMPORTANT_INFO, "Received SIGUSR2. Dumping performance "
+          "statistics.\n");
+    sss_perf_dump();
+}
+
+static void server_debug_trace(enum tevent_trace_point point,
+                               void *private_data)
+{
+    switch (point) {
+    case TEVENT_TRACE_BEFORE_WAIT:
+        /* write out everything logged in this iteration before sleeping */
+        debug_flush_buffer();
+        break;
+    case TEVENT_TRACE_AFTER_WAIT:
+        debug_loop_tick();
+        break;
+    default:
+        break;
+    }
+}
+
 int server_setup(const char *name, int flags,
                  uid_t uid, gid_t gid,
                  const char *conf_entry,
@@ -456,6 +485,8 @@ int server_setup(const char *name, int flags,
     bool dt;
     bool dl;
     bool dm;
+    bool db;
+    int bt_level;
     struct tevent_signal *tes;
     struct logrotate_ctx *lctx;
     char *locale;
@@ -647,6 +678,15 @@ int server_setup(const char *name, int flags,
         return EIO;
     }
 
+    /* SIGUSR2 dumps performance statistics, backends and the monitor
+     * additionally use it to reset the offline state */
+    BlockSignals(false, SIGUSR2);
+    tes = tevent_add_signal(ctx->event_ctx, ctx, SIGUSR2, 0,
+                            te_server_perf_dump, NULL);
+    if (tes == NULL) {
+        return EIO;
+    }
+
     /* open log file if told so */
     if (debug_to_file) {
         ret = open_debug_file();
@@ -657,6 +697,41 @@ int server_setup(const char *name, int flags,
         }
     }
 
+    /* collect debug messages in memory and write them in batches */
+    ret = confdb_get_bool(ctx->confdb_ctx, conf_entry,
+                          CONFDB_SERVICE_DEBUG_BUFFERED,
+                          false, &db);
+    if (ret != EOK) {
+        DEBUG(SSSDBG_FATAL_FAILURE, "Error reading from confdb (%d) [%s]\n",
+                                     ret, strerror(ret));
+        return ret;
+    }
+    if (db) {
+        ret = debug_set_buffered(true);
+        if (ret != EOK) {
+            DEBUG(SSSDBG_FATAL_FAILURE, "Error setting up buffered logging "
+                                        "(%d) [%s]\n", ret, strerror(ret));
+            return ret;
+        }
+        tevent_set_trace_callback(ctx->event_ctx, server_debug_trace, NULL);
+    }
+
+    /* keep messages above debug_level in memory for error analysis */
+    ret = confdb_get_int(ctx->confdb_ctx, conf_entry,
+                         CONFDB_SERVICE_DEBUG_BACKTRACE_LEVEL,
+                         0, &bt_level);
+    if (ret != EOK) {
+        DEBUG(SSSDBG_FATAL_FAILURE, "Error reading from confdb (%d) [%s]\n",
+                                     ret, strerror(ret));
+        return ret;
+    }
+    ret = debug_set_backtrace_level(bt_level);
+    if (ret != EOK) {
+        DEBUG(SSSDBG_FATAL_FAILURE, "Error setting up the debug backtrace "
+                                    "(%d) [%s]\n", ret, strerror(ret));
+        return ret;
+    }
+
     /* Setup the internal watchdog */
     ret = confdb_get_int(ctx->confdb_ctx, conf_entry,
                          CONFDB_DOMAIN_TIMEOUT,
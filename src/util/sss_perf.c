@@ -0,0 +1,331 @@
+/*
+    SSSD
+
+    Performance counters and latency histograms
+
+    Copyright (C) 2016 Red Hat
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <inttypes.h>
+
+#include "util/util.h"
+#include "util/sss_perf.h"
+
+struct sss_perf_entry {
+    enum sss_perf_hist_type type;
+    uint32_t key;
+    const char *name;
+    struct sss_perf_hist hist;
+};
+
+static uint64_t sss_perf_counters[SSS_PERF_COUNTER_SENTINEL];
+static struct sss_perf_entry **sss_perf_entries;
+static size_t sss_perf_num_entries;
+static struct timeval sss_perf_start;
+
+static const char *sss_perf_counter_to_str(enum sss_perf_counter counter)
+{
+    switch (counter) {
+    case SSS_PERF_MC_STORE:
+        return "mc_store";
+    case SSS_PERF_NCACHE_HIT:
+        return "ncache_hit";
+    case SSS_PERF_DP_REQUEST:
+        return "dp_request";
+    case SSS_PERF_LDAP_CONNECT:
+        return "ldap_connect";
+    case SSS_PERF_SYSDB_COMMIT:
+        return "sysdb_commit";
+    case SSS_PERF_COUNTER_SENTINEL:
+        break;
+    }
+
+    return "unknown";
+}
+
+static const char *sss_perf_hist_type_to_str(enum sss_perf_hist_type type)
+{
+    switch (type) {
+    case SSS_PERF_HIST_COMMAND:
+        return "command";
+    case SSS_PERF_HIST_DP_TARGET:
+        return "dp_target";
+    case SSS_PERF_HIST_LDAP_OP:
+        return "ldap_op";
+    case SSS_PERF_HIST_SDAP_REQ:
+        return "sdap_req";
+    case SSS_PERF_HIST_SENTINEL:
+        break;
+    }
+
+    return "unknown";
+}
+
+static void sss_perf_init_start(void)
+{
+    if (sss_perf_start.tv_sec == 0) {
+        sss_perf_start = tevent_timeval_current();
+    }
+}
+
+void sss_perf_count(enum sss_perf_counter counter)
+{
+    if (counter >= SSS_PERF_COUNTER_SENTINEL) {
+        return;
+    }
+
+    sss_perf_init_start();
+    sss_perf_counters[counter]++;
+}
+
+static unsigned int sss_perf_bucket(uint64_t value)
+{
+    unsigned int msb;
+    unsigned int shift;
+
+    if (value < SSS_PERF_SUB_BUCKETS) {
+        return value;
+    }
+
+    if ((value >> SSS_PERF_MAX_BITS) != 0) {
+        return SSS_PERF_BUCKETS - 1;
+    }
+
+    for (msb = SSS_PERF_SUB_BITS; (value >> (msb + 1)) != 0; msb++);
+
+    shift = msb - SSS_PERF_SUB_BITS;
+    return (shift + 1) * SSS_PERF_SUB_BUCKETS
+           + (value >> shift) - SSS_PERF_SUB_BUCKETS;
+}
+
+static uint64_t sss_perf_bucket_upper(unsigned int bucket)
+{
+    unsigned int shift;
+    uint64_t sub;
+
+    if (bucket < SSS_PERF_SUB_BUCKETS) {
+        return bucket;
+    }
+
+    shift = bucket / SSS_PERF_SUB_BUCKETS - 1;
+    sub = bucket % SSS_PERF_SUB_BUCKETS;
+
+    return ((SSS_PERF_SUB_BUCKETS + sub + 1) << shift) - 1;
+}
+
+void sss_perf_hist_add(struct sss_perf_hist *hist, uint64_t value)
+{
+    hist->buckets[sss_perf_bucket(value)]++;
+    hist->count++;
+    hist->sum += value;
+    if (value > hist->max) {
+        hist->max = value;
+    }
+}
+
+void sss_perf_hist_merge(struct sss_perf_hist *dst,
+                         const struct sss_perf_hist *src)
+{
+    unsigned int i;
+
+    for (i = 0; i < SSS_PERF_BUCKETS; i++) {
+        dst->buckets[i] += src->buckets[i];
+    }
+
+    dst->count += src->count;
+    dst->sum += src->sum;
+    if (src->max > dst->max) {
+        dst->max = src->max;
+    }
+}
+
+uint64_t sss_perf_hist_percentile(struct sss_perf_hist *hist,
+                                  double percentile)
+{
+    double exact;
+    uint64_t target;
+    uint64_t seen = 0;
+    uint64_t upper;
+    unsigned int i;
+
+    if (hist->count == 0) {
+        return 0;
+    }
+
+    /* rank of the value, rounded up */
+    exact = hist->count * percentile / 100;
+    target = exact;
+    if (target < exact) {
+        target++;
+    }
+    if (target == 0) {
+        target = 1;
+    }
+
+    for (i = 0; i < SSS_PERF_BUCKETS; i++) {
+        seen += hist->buckets[i];
+        if (seen >= target) {
+            break;
+        }
+    }
+
+    upper = sss_perf_bucket_upper(i);
+    return upper < hist->max ? upper : hist->max;
+}
+
+static struct sss_perf_entry *sss_perf_entry(enum sss_perf_hist_type type,
+                                             uint32_t key,
+                                             const char *name)
+{
+    struct sss_perf_entry **entries;
+    struct sss_perf_entry *entry;
+    size_t i;
+
+    for (i = 0; i < sss_perf_num_entries; i++) {
+        if (sss_perf_entries[i]->type == type
+                && sss_perf_entries[i]->key == key) {
+            return sss_perf_entries[i];
+        }
+    }
+
+    entries = talloc_realloc(NULL, sss_perf_entries, struct sss_perf_entry *,
+                             sss_perf_num_entries + 1);
+    if (entries == NULL) {
+        return NULL;
+    }
+    sss_perf_entries = entries;
+
+    entry = talloc_zero(sss_perf_entries, struct sss_perf_entry);
+    if (entry == NULL) {
+        return NULL;
+    }
+
+    entry->type = type;
+    entry->key = key;
+    entry->name = name;
+
+    sss_perf_entries[sss_perf_num_entries] = entry;
+    sss_perf_num_entries++;
+
+    return entry;
+}
+
+void sss_perf_record(enum sss_perf_hist_type type,
+                     uint32_t key,
+                     const char *name,
+                     const struct timeval *start)
+{
+    struct sss_perf_entry *entry;
+    struct timeval now;
+    struct timeval diff;
+
+    sss_perf_init_start();
+
+    entry = sss_perf_entry(type, key, name);
+    if (entry == NULL) {
+        /* Losing one sample is better than failing the request. */
+        return;
+    }
+
+    now = tevent_timeval_current();
+    diff = tevent_timeval_until(start, &now);
+    sss_perf_hist_add(&entry->hist,
+                      (uint64_t) diff.tv_sec * 1000000 + diff.tv_usec);
+}
+
+static double sss_perf_rate(uint64_t count, double uptime)
+{
+    return uptime > 0 ? count / uptime : 0;
+}
+
+errno_t sss_perf_report(TALLOC_CTX *mem_ctx, char **_report)
+{
+    struct sss_perf_entry *entry;
+    struct timeval now;
+    struct timeval diff;
+    double uptime;
+    char *report;
+    size_t i;
+
+    sss_perf_init_start();
+
+    now = tevent_timeval_current();
+    diff = tevent_timeval_until(&sss_perf_start, &now);
+    uptime = diff.tv_sec + diff.tv_usec / 1000000.0;
+
+    report = talloc_asprintf(mem_ctx, "uptime_sec=%ld\n", (long) diff.tv_sec);
+    if (report == NULL) {
+        return ENOMEM;
+    }
+
+    for (i = 0; i < SSS_PERF_COUNTER_SENTINEL; i++) {
+        report = talloc_asprintf_append(report,
+                    "counter=%s value=%"PRIu64" rate_per_sec=%.2f\n",
+                    sss_perf_counter_to_str(i), sss_perf_counters[i],
+                    sss_perf_rate(sss_perf_counters[i], uptime));
+        if (report == NULL) {
+            return ENOMEM;
+        }
+    }
+
+    for (i = 0; i < sss_perf_num_entries; i++) {
+        entry = sss_perf_entries[i];
+        report = talloc_asprintf_append(report,
+                    "histogram=%s:%s count=%"PRIu64" rate_per_sec=%.2f "
+                    "avg_usec=%"PRIu64" p50_usec=%"PRIu64" "
+                    "p90_usec=%"PRIu64" p99_usec=%"PRIu64" "
+                    "max_usec=%"PRIu64"\n",
+                    sss_perf_hist_type_to_str(entry->type), entry->name,
+                    entry->hist.count,
+                    sss_perf_rate(entry->hist.count, uptime),
+                    entry->hist.count ? entry->hist.sum / entry->hist.count
+                                      : 0,
+                    sss_perf_hist_percentile(&entry->hist, 50),
+                    sss_perf_hist_percentile(&entry->hist, 90),
+                    sss_perf_hist_percentile(&entry->hist, 99),
+                    entry->hist.max);
+        if (report == NULL) {
+            return ENOMEM;
+        }
+    }
+
+    *_report = report;
+
+    return EOK;
+}
+
+void sss_perf_dump(void)
+{
+    char *report;
+    char *line;
+    char *saveptr;
+    errno_t ret;
+
+    ret = sss_perf_report(NULL, &report);
+    if (ret != EOK) {
+        DEBUG(SSSDBG_OP_FAILURE, "Unable to create performance report "
+              "[%d]: %s\n", ret, sss_strerror(ret));
+        return;
+    }
+
+    for (line = strtok_r(report, "\n", &saveptr);
+         line != NULL;
+         line = strtok_r(NULL, "\n", &saveptr)) {
+        DEBUG(SSSDBG_IMPORTANT_INFO, "%s\n", line);
+    }
+
+    talloc_free(report);
+}
@@ -0,0 +1,114 @@
+/*
+    SSSD
+
+    Performance counters and latency histograms
+
+    Copyright (C) 2016 Red Hat
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef _SSS_PERF_H_
+#define _SSS_PERF_H_
+
+#include <stdint.h>
+#include <sys/time.h>
+#include <talloc.h>
+
+#include "util/util_errors.h"
+
+/*
+ * Every process keeps counters and latency histograms in memory. They are
+ * never reset, rates are computed from the time the process started.
+ *
+ * The histograms have logarithmic buckets: values are grouped by their
+ * highest set bit and each power of two is split into
+ * SSS_PERF_SUB_BUCKETS linear sub-buckets. The relative error of the
+ * reported percentiles is therefore at most 1/SSS_PERF_SUB_BUCKETS while
+ * one histogram covers 1us to more than an hour in 240 buckets.
+ *
+ * Recording a value is a bucket lookup and an increment, there is no
+ * locking as SSSD processes are single threaded.
+ */
+
+#define SSS_PERF_SUB_BITS 3
+#define SSS_PERF_SUB_BUCKETS (1 << SSS_PERF_SUB_BITS)
+#define SSS_PERF_MAX_BITS 32
+#define SSS_PERF_BUCKETS \
+    ((SSS_PERF_MAX_BITS - SSS_PERF_SUB_BITS + 1) * SSS_PERF_SUB_BUCKETS)
+
+enum sss_perf_counter {
+    /* entries written to the memory cache */
+    SSS_PERF_MC_STORE,
+    /* lookups answered by the negative cache */
+    SSS_PERF_NCACHE_HIT,
+    /* requests sent to (responders) or received by (backends) the data
+     * provider */
+    SSS_PERF_DP_REQUEST,
+    /* connections established to the LDAP server */
+    SSS_PERF_LDAP_CONNECT,
+    /* committed top-level sysdb transactions */
+    SSS_PERF_SYSDB_COMMIT,
+
+    SSS_PERF_COUNTER_SENTINEL
+};
+
+enum sss_perf_hist_type {
+    /* client commands, the key is enum sss_cli_command */
+    SSS_PERF_HIST_COMMAND,
+    /* data provider requests, the key is enum dp_targets */
+    SSS_PERF_HIST_DP_TARGET,
+    /* LDAP operations, the key is the LDAP result message type */
+    SSS_PERF_HIST_LDAP_OP,
+    /* LDAP provider requests, the key is enum sdap_perf_req */
+    SSS_PERF_HIST_SDAP_REQ,
+
+    SSS_PERF_HIST_SENTINEL
+};
+
+struct sss_perf_hist {
+    uint64_t count;
+    uint64_t sum;
+    uint64_t max;
+    uint32_t buckets[SSS_PERF_BUCKETS];
+};
+
+void sss_perf_count(enum sss_perf_counter counter);
+
+/* Adds the time elapsed since @start to the histogram identified by @type
+ * and @key. @name describes the key in reports and must be a static
+ * string. */
+void sss_perf_record(enum sss_perf_hist_type type,
+                     uint32_t key,
+                     const char *name,
+                     const struct timeval *start);
+
+void sss_perf_hist_add(struct sss_perf_hist *hist, uint64_t value);
+
+/* Adds all values recorded in @src to @dst. */
+void sss_perf_hist_merge(struct sss_perf_hist *dst,
+                         const struct sss_perf_hist *src);
+
+/* Returns the upper bound of the bucket that contains the given
+ * percentile (0-100, e.g. 99.9) of the recorded values. */
+uint64_t sss_perf_hist_percentile(struct sss_perf_hist *hist,
+                                  double percentile);
+
+/* Text report of all counters and histograms, one item per line. */
+errno_t sss_perf_report(TALLOC_CTX *mem_ctx, char **_report);
+
+/* Writes the report into the debug log. */
+void sss_perf_dump(void);
+
+#endif /* _SSS_PERF_H_ */
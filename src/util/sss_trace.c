@@ -0,0 +1,103 @@
+/*
+    SSSD
+
+    Request tracing
+
+    Copyright (C) 2016 Red Hat
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <inttypes.h>
+#include <unistd.h>
+
+#include "util/util.h"
+#include "util/probes.h"
+#include "util/sss_trace.h"
+
+static uint64_t sss_trace_current_id;
+static uint32_t sss_trace_counter;
+
+uint64_t sss_trace_new_id(void)
+{
+    /* Process ID in the upper half keeps the IDs of different
+     * responders apart. */
+    sss_trace_counter++;
+    if (sss_trace_counter == 0) {
+        sss_trace_counter++;
+    }
+
+    return ((uint64_t) getpid() << 32) | sss_trace_counter;
+}
+
+uint64_t sss_trace_current(void)
+{
+    return sss_trace_current_id;
+}
+
+uint64_t sss_trace_set_current(uint64_t id)
+{
+    uint64_t prev = sss_trace_current_id;
+
+    sss_trace_current_id = id;
+
+    return prev;
+}
+
+const char *sss_trace_stage_to_str(enum sss_trace_stage stage)
+{
+    switch (stage) {
+    case SSS_TRACE_REQUEST:
+        return "request";
+    case SSS_TRACE_CACHE:
+        return "cache";
+    case SSS_TRACE_DP_WAIT:
+        return "dp_wait";
+    case SSS_TRACE_QUEUE:
+        return "queue";
+    case SSS_TRACE_HANDLER:
+        return "handler";
+    case SSS_TRACE_LDAP:
+        return "ldap";
+    case SSS_TRACE_SYSDB_WRITE:
+        return "sysdb_write";
+    case SSS_TRACE_SENTINEL:
+        break;
+    }
+
+    return "unknown";
+}
+
+void sss_trace_span(uint64_t id,
+                    enum sss_trace_stage stage,
+                    const struct timeval *start)
+{
+    struct timeval now;
+    struct timeval diff;
+    uint64_t usec;
+
+    if (id == 0) {
+        return;
+    }
+
+    now = tevent_timeval_current();
+    diff = tevent_timeval_until(start, &now);
+    usec = (uint64_t) diff.tv_sec * 1000000 + diff.tv_usec;
+
+    PROBE(TRACE_SPAN, id, sss_trace_stage_to_str(stage), usec);
+
+    DEBUG(SSSDBG_PERF_STAT, "trace_id=" SSS_TRACE_ID_FMT " stage=%s "
+          "duration_usec=%" PRIu64 "\n",
+          id, sss_trace_stage_to_str(stage), usec);
+}
@@ -0,0 +1,81 @@
+/*
+    SSSD
+
+    Request tracing
+
+    Copyright (C) 2016 Red Hat
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef _SSS_TRACE_H_
+#define _SSS_TRACE_H_
+
+#include <stdint.h>
+#include <sys/time.h>
+
+/*
+ * Every client request gets an ID when a responder reads it from the
+ * socket. The ID is sent along with the request to the data provider and
+ * is attached to the LDAP operations and cache writes that are done on its
+ * behalf, so the time spent in each stage of one request can be followed
+ * across processes.
+ *
+ * The ID of the request being processed is kept in a global variable.
+ * Code that continues a request asynchronously stores the ID and makes it
+ * current again with sss_trace_set_current() before calling code that may
+ * start another stage. ID 0 means that no request is traced.
+ *
+ * The stages are reported with the trace_span systemtap probe and logged
+ * as key=value lines with the SSSDBG_PERF_STAT debug level.
+ */
+
+#define SSS_TRACE_ID_FMT "%016" PRIx64
+
+enum sss_trace_stage {
+    /* whole client request in the responder */
+    SSS_TRACE_REQUEST,
+    /* one lookup in the responder cache */
+    SSS_TRACE_CACHE,
+    /* responder waiting for the data provider */
+    SSS_TRACE_DP_WAIT,
+    /* request waiting in the data provider queue */
+    SSS_TRACE_QUEUE,
+    /* request handler in the data provider */
+    SSS_TRACE_HANDLER,
+    /* one LDAP operation */
+    SSS_TRACE_LDAP,
+    /* one cache transaction */
+    SSS_TRACE_SYSDB_WRITE,
+
+    SSS_TRACE_SENTINEL
+};
+
+/* Returns a new ID that is unique on this machine. */
+uint64_t sss_trace_new_id(void);
+
+uint64_t sss_trace_current(void);
+
+/* Returns the previous ID so it can be restored afterwards. */
+uint64_t sss_trace_set_current(uint64_t id);
+
+const char *sss_trace_stage_to_str(enum sss_trace_stage stage);
+
+/* Reports that @stage of request @id started at @start and ends now.
+ * Nothing is reported for ID 0. */
+void sss_trace_span(uint64_t id,
+                    enum sss_trace_stage stage,
+                    const struct timeval *start);
+
+#endif /* _SSS_TRACE_H_ */
@@ -1123,6 +1123,7 @@ static struct cert_verify_opts *init_cert_verify_opts(TALLOC_CTX *mem_ctx)
     cert_verify_opts->do_verification = true;
     cert_verify_opts->ocsp_default_responder = NULL;
     cert_verify_opts->ocsp_default_responder_signing_cert = NULL;
+    cert_verify_opts->cache_timeout = 0;
 
     return cert_verify_opts;
 }
@@ -1135,6 +1136,9 @@ static struct cert_verify_opts *init_cert_verify_opts(TALLOC_CTX *mem_ctx)
 #define OCSP_DEFAUL_RESPONDER_SIGNING_CERT_LEN \
                                 (sizeof(OCSP_DEFAUL_RESPONDER_SIGNING_CERT) - 1)
 
+#define CERT_CACHE_TIMEOUT "cache_timeout="
+#define CERT_CACHE_TIMEOUT_LEN (sizeof(CERT_CACHE_TIMEOUT) - 1)
+
 errno_t parse_cert_verify_opts(TALLOC_CTX *mem_ctx, const char *verify_opts,
                                struct cert_verify_opts **_cert_verify_opts)
 {
@@ -1143,6 +1147,8 @@ errno_t parse_cert_verify_opts(TALLOC_CTX *mem_ctx, const char *verify_opts,
     char **opts;
     size_t c;
     struct cert_verify_opts *cert_verify_opts;
+    unsigned long timeout;
+    char *endptr;
 
     tmp_ctx = talloc_new(NULL);
     if (tmp_ctx == NULL) {
@@ -1215,6 +1221,23 @@ errno_t parse_cert_verify_opts(TALLOC_CTX *mem_ctx, const char *verify_opts,
             DEBUG(SSSDBG_TRACE_ALL,
                   "Using OCSP default responder signing cert nickname [%s]\n",
                   cert_verify_opts->ocsp_default_responder_signing_cert);
+        } else if (strncasecmp(opts[c], CERT_CACHE_TIMEOUT,
+                               CERT_CACHE_TIMEOUT_LEN) == 0) {
+            errno = 0;
+            timeout = strtoul(&opts[c][CERT_CACHE_TIMEOUT_LEN], &endptr, 10);
+            if (errno != 0 || *endptr != '\0' || timeout > UINT32_MAX
+                    || opts[c][CERT_CACHE_TIMEOUT_LEN] == '\0') {
+                DEBUG(SSSDBG_CRIT_FAILURE,
+                      "Failed to parse cache_timeout option [%s].\n",
+                      opts[c]);
+                ret = EINVAL;
+                goto done;
+            }
+            cert_verify_opts->cache_timeout = timeout;
+
+            DEBUG(SSSDBG_TRACE_ALL,
+                  "Caching verification results for [%"PRIu32"] seconds\n",
+                  cert_verify_opts->cache_timeout);
         } else {
             DEBUG(SSSDBG_CRIT_FAILURE,
                   "Unsupported certificate verification option [%s], " \
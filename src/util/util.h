@@ -356,6 +356,8 @@ struct cert_verify_opts {
     bool do_verification;
     char *ocsp_default_responder;
     char *ocsp_default_responder_signing_cert;
+    /* seconds to reuse validation results for, 0 if they are not cached */
+    uint32_t cache_timeout;
 };
 
 errno_t parse_cert_verify_opts(TALLOC_CTX *mem_ctx, const char *verify_opts,